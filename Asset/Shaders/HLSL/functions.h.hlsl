@@ -16,6 +16,23 @@ float3 linePlaneIntersect(float3 line_start, float3 line_dir, float3 center_of_p
     return line_start + (line_dir * (dot(center_of_plane - line_start, normal_of_plane) / dot(line_dir, normal_of_plane)));
 }
 
+#if !defined(OS_WEBASSEMBLY)
+// cluster of a view space position, must match LightClusterGrid
+uint get_light_cluster(float4 v)
+{
+    float4 clip = mul(v, projectionMatrix);
+    float2 ndc = clip.xy / clip.w;
+    float2 tile = floor((ndc * 0.5f + 0.5f) * float2(LIGHT_CLUSTER_COUNT_X, LIGHT_CLUSTER_COUNT_Y));
+    tile = clamp(tile, 0.0f.xx, float2(LIGHT_CLUSTER_COUNT_X - 1, LIGHT_CLUSTER_COUNT_Y - 1));
+
+    float depth = max(-v.z, clusterDepthParams.x);
+    float slice = floor(log(depth) * clusterDepthParams.z + clusterDepthParams.w);
+    slice = clamp(slice, 0.0f, LIGHT_CLUSTER_COUNT_Z - 1);
+
+    return ((uint)slice * LIGHT_CLUSTER_COUNT_Y + (uint)tile.y) * LIGHT_CLUSTER_COUNT_X + (uint)tile.x;
+}
+#endif
+
 float linear_interpolate(float t, float begin, float end)
 {
     if (t < begin)
@@ -157,16 +174,31 @@ float shadow_test(float4 p, Light light, float cosTheta, int clip_space_type) {
                 }
                 break;
             case 2: // infinity
-                // adjust from [-1, 1] to [0, 1]
-                v_light_space = mul(v_light_space, depth_bias);
-                for (i = 0; i < 4; i++)
                 {
-                    near_occ = globalShadowMap.Sample(samp0, float3(v_light_space.xy + (poissonDisk[i] / 700.0f.xx), float(light.lightShadowMapIndex))).x;
-
-                    if (v_light_space.z - near_occ > bias)
+                    // the first cascade reaching the view depth of the point
+                    float depth = -mul(p, viewMatrix).z;
+                    if (depth > shadowCascadeSplits[SHADOW_CASCADE_COUNT - 1])
                     {
-                        // we are in the shadow
-                        visibility -= 0.22f;
+                        // beyond the shadow distance
+                        break;
+                    }
+                    int cascade = 0;
+                    while (cascade < SHADOW_CASCADE_COUNT - 1 && depth > shadowCascadeSplits[cascade])
+                    {
+                        cascade++;
+                    }
+                    v_light_space = mul(p, shadowCascadeMatrices[cascade]);
+                    // adjust from [-1, 1] to [0, 1]
+                    v_light_space = mul(v_light_space, depth_bias);
+                    for (i = 0; i < 4; i++)
+                    {
+                        near_occ = globalShadowMap.Sample(samp0, float3(v_light_space.xy + (poissonDisk[i] / 700.0f.xx), float(light.lightShadowMapIndex + cascade))).x;
+
+                        if (v_light_space.z - near_occ > bias)
+                        {
+                            // we are in the shadow
+                            visibility -= 0.22f;
+                        }
                     }
                 }
                 break;
@@ -1,6 +1,14 @@
 #include "functions.h.hlsl"
 #include "vsoutput.h.hlsl"
 
+// the permutations listed in ShaderVariants.txt are compiled with
+// SHADER_VARIANT and the defines of their material features, the shader
+// built without samples every map
+#if !defined(SHADER_VARIANT)
+#define HAS_NORMAL_MAP 1
+#define HAS_METALLIC_MAP 1
+#endif
+
 [RootSignature(MyRS1)] float4 pbr_frag_main(pbr_vert_output _entryPointOutput)
     : SV_Target {
   // offset texture coordinates with Parallax Mapping
@@ -12,14 +20,39 @@
   float3 albedo =
       inverse_gamma_correction(diffuseMap.Sample(samp0, texCoords).rgb);
   float alpha = diffuseMap.Sample(samp0, texCoords).a;
-  float meta = metallicMap.Sample(samp0, texCoords).r;
-  float rough = metallicMap.Sample(samp0, texCoords).g;
+#if defined(ALPHA_TEST)
+  clip(alpha - 0.5f);
+#endif
+
+  // the metallic map packs metalness, roughness and ambient occlusion,
+  // separate maps of the latter two take precedence
+#if defined(HAS_METALLIC_MAP)
+  float3 packed = metallicMap.Sample(samp0, texCoords).rgb;
+#else
+  float3 packed = float3(0.0f, 0.5f, 1.0f);
+#endif
+  float meta = packed.r;
+#if defined(HAS_ROUGHNESS_MAP)
+  float rough = roughnessMap.Sample(samp0, texCoords).r;
+#else
+  float rough = packed.g;
+#endif
+#if defined(HAS_AO_MAP)
+  float ambientOcc = aoMap.Sample(samp0, texCoords).r;
+#else
+  float ambientOcc = packed.b;
+#endif
+
+#if defined(HAS_NORMAL_MAP)
   float3 tangent_normal;
   tangent_normal.xy = normalMap.Sample(samp0, texCoords).rg;
   tangent_normal = tangent_normal * 2.0f - 1.00392f;
   tangent_normal.z = sqrt(clamp(1.0f - tangent_normal.x * tangent_normal.x -
     tangent_normal.y * tangent_normal.y, 0.0f, 1.0f));
   float3 N = mul(tangent_normal, _entryPointOutput.TBN);
+#else
+  float3 N = normalize(_entryPointOutput.normal_world.xyz);
+#endif
 
   float3 V = normalize(camPos.xyz - _entryPointOutput.v_world.xyz);
   float3 R = reflect(-V, N);
@@ -29,8 +62,15 @@
 
   // reflectance equation
   float3 Lo = 0.0f.xxx;
+#if defined(OS_WEBASSEMBLY)
   for (int i = 0; i < numLights; i++) {
     Light light = lights[i];
+#else
+  // only the lights reaching the cluster of the fragment
+  uint2 cluster = lightClusters[get_light_cluster(_entryPointOutput.v)];
+  for (uint i = 0; i < cluster.y; i++) {
+    Light light = clusteredLights[lightClusterIndices[cluster.x + i]];
+#endif
 
     // calculate per-light radiance
     float3 L =
@@ -76,8 +116,6 @@
   float3 ambient;
   {
     // ambient diffuse
-    float ambientOcc = metallicMap.Sample(samp0, texCoords).b;
-
     float3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0f), F0, rough);
     float3 kS = F;
     float3 kD = 1.0f - kS;
@@ -10,8 +10,14 @@ pos_only_vert_output shadowmap_vert_main(a2v_pos_only a)
 	// Calculate the position of the vertex against the world, view, and projection matrices.
 	float4 v = float4(a.inputPosition.xyz, 1.0f);
 	v = mul(v, modelMatrix);
-	v = mul(v, lights[light_index].lightViewMatrix);
-	o.pos = mul(v, lights[light_index].lightProjectionMatrix);
+	if (lights[light_index].lightType == 2) {
+		// the sun draws a layer per cascade
+		int cascade = int(shadowmap_layer_index) - lights[light_index].lightShadowMapIndex;
+		o.pos = mul(v, shadowCascadeMatrices[cascade]);
+	} else {
+		v = mul(v, lights[light_index].lightViewMatrix);
+		o.pos = mul(v, lights[light_index].lightProjectionMatrix);
+	}
 
     return o;
 }
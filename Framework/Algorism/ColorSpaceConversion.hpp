@@ -33,4 +33,102 @@ inline RGBf ConvertYCbCr2RGB(const YCbCrf& ycbcr) {
                  std::clamp<float>(result[1] + 0.5f, 0.0f, 255.0f),
                  std::clamp<float>(result[2] + 0.5f, 0.0f, 255.0f)});
 }
+
+// ConvertYCbCr2RGB in fixed point for `count` pixels of 8-bit samples,
+// written as RGBA8 with an opaque alpha
+inline void ConvertYCbCr2RGBA8(const uint8_t* y, const uint8_t* cb,
+                               const uint8_t* cr, uint8_t* rgba,
+                               const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertYCbCr2RGBA8(y, cb, cr, rgba, count);
+#else
+    Dummy::ConvertYCbCr2RGBA8(y, cb, cr, rgba, count);
+#endif
+}
+
+// `count` Radiance RGBE pixels from separate planes of mantissas and
+// exponents, written as RGB floats equal to those of ldexp
+inline void ConvertRGBE2RGBf(const uint8_t* r, const uint8_t* g,
+                             const uint8_t* b, const uint8_t* e, float* rgb,
+                             const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertRGBE2RGBf(r, g, b, e, rgb, count);
+#else
+    Dummy::ConvertRGBE2RGBf(r, g, b, e, rgb, count);
+#endif
+}
+
+// the same as RGBA half floats with an alpha of 1, rounded to nearest even
+inline void ConvertRGBE2RGBAh(const uint8_t* r, const uint8_t* g,
+                              const uint8_t* b, const uint8_t* e,
+                              uint16_t* rgba, const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertRGBE2RGBAh(r, g, b, e, rgba, count);
+#else
+    Dummy::ConvertRGBE2RGBAh(r, g, b, e, rgba, count);
+#endif
+}
+
+// Upsamples `count` chroma samples of a row from the output sample `first`.
+// The row of `width` samples is subsampled by `h_factor`, filtered with the
+// triangle of the IJG fancy upsampling when the factor is 2 and replicated
+// otherwise. When `blend` the row is subsampled by 2 vertically as well,
+// `near` and `far` being the rows above and below the output row weighted
+// 3:1.
+inline void UpsampleChroma(const uint8_t* near, const uint8_t* far,
+                           const int32_t width, const int32_t h_factor,
+                           const bool blend, const int32_t first,
+                           const int32_t count, uint8_t* out) {
+    if (h_factor == 2) {
+        for (int32_t i = 0; i < count; i++) {
+            const int32_t x = first + i;
+            const int32_t odd = x & 1;
+            const int32_t center = std::min(x >> 1, width - 1);
+            const int32_t side = std::clamp((x >> 1) + (odd ? 1 : -1), 0,
+                                            width - 1);
+            if (blend) {
+                const int32_t c = 3 * near[center] + far[center];
+                const int32_t s = 3 * near[side] + far[side];
+                out[i] = static_cast<uint8_t>((3 * c + s + 8 - odd) >> 4);
+            } else {
+                out[i] = static_cast<uint8_t>(
+                    (3 * near[center] + near[side] + 1 + odd) >> 2);
+            }
+        }
+    } else {
+        for (int32_t i = 0; i < count; i++) {
+            const int32_t x = std::min((first + i) / h_factor, width - 1);
+            out[i] = blend ? static_cast<uint8_t>(
+                                 (3 * near[x] + far[x] + 2) >> 2)
+                           : near[x];
+        }
+    }
+}
+
+// Converts a row of `count` pixels into RGBA8 with the chroma upsampled as
+// in UpsampleChroma. The chroma is upsampled a chunk at a time right before
+// its conversion, so it never leaves the cache.
+inline void ConvertYCbCr2RGBA8Row(const uint8_t* y, const uint8_t* cb,
+                                  const uint8_t* cb_far, const uint8_t* cr,
+                                  const uint8_t* cr_far,
+                                  const int32_t chroma_width,
+                                  const int32_t h_factor, const bool blend,
+                                  uint8_t* rgba, const int32_t count) {
+    if (h_factor == 1 && !blend) {
+        ConvertYCbCr2RGBA8(y, cb, cr, rgba, count);
+        return;
+    }
+
+    constexpr int32_t kChunkSize = 64;
+    uint8_t cb_chunk[kChunkSize];
+    uint8_t cr_chunk[kChunkSize];
+    for (int32_t x = 0; x < count; x += kChunkSize) {
+        const int32_t n = std::min(kChunkSize, count - x);
+        UpsampleChroma(cb, cb_far, chroma_width, h_factor, blend, x, n,
+                       cb_chunk);
+        UpsampleChroma(cr, cr_far, chroma_width, h_factor, blend, x, n,
+                       cr_chunk);
+        ConvertYCbCr2RGBA8(y + x, cb_chunk, cr_chunk, rgba + x * 4, n);
+    }
+}
 }  // namespace My
@@ -0,0 +1,245 @@
+#include "HiZBuffer.hpp"
+
+#include <future>
+#include <limits>
+
+using namespace My;
+using namespace std;
+
+namespace {
+// the clip space w below which a vertex is considered behind the camera
+constexpr float kNearW = 1e-5f;
+}  // namespace
+
+HiZBuffer::HiZBuffer(uint32_t width, uint32_t height)
+    : m_Width(width), m_Height(height) {
+    assert(width > 0 && height > 0);
+
+    while (true) {
+        Level level;
+        level.width = width;
+        level.height = height;
+        level.depth.resize(static_cast<size_t>(width) * height);
+        m_Levels.push_back(std::move(level));
+
+        if (width == 1 && height == 1) break;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+
+    m_Bins.resize((m_Height + kBandHeight - 1) / kBandHeight);
+
+    Clear();
+}
+
+void HiZBuffer::Clear() {
+    for (auto& level : m_Levels) {
+        fill(level.depth.begin(), level.depth.end(),
+             numeric_limits<float>::max());
+    }
+
+    m_Triangles.clear();
+    for (auto& bin : m_Bins) {
+        bin.clear();
+    }
+}
+
+void HiZBuffer::AddOccluder(const float* positions,
+                            const size_t position_stride,
+                            const uint16_t* indices, const size_t index_count,
+                            const Matrix4X4f& model_view_projection) {
+    addOccluder(positions, position_stride, indices, index_count,
+                model_view_projection);
+}
+
+void HiZBuffer::AddOccluder(const float* positions,
+                            const size_t position_stride,
+                            const uint32_t* indices, const size_t index_count,
+                            const Matrix4X4f& model_view_projection) {
+    addOccluder(positions, position_stride, indices, index_count,
+                model_view_projection);
+}
+
+template <typename T>
+void HiZBuffer::addOccluder(const float* positions,
+                            const size_t position_stride, const T* indices,
+                            const size_t index_count,
+                            const Matrix4X4f& model_view_projection) {
+    for (size_t i = 0; i + 2 < index_count; i += 3) {
+        Vector4f clip[3];
+        bool behind = false;
+        for (size_t k = 0; k < 3; k++) {
+            const float* p = positions + indices[i + k] * position_stride;
+            clip[k] = Vector4f({p[0], p[1], p[2], 1.0f});
+            Transform(clip[k], model_view_projection);
+            if (clip[k][3] <= kNearW) behind = true;
+        }
+
+        if (!behind) setupTriangle(clip);
+    }
+}
+
+void HiZBuffer::setupTriangle(const Vector4f clip[3]) {
+    // screen space, y pointing downwards
+    float x[3], y[3], z[3];
+    for (size_t k = 0; k < 3; k++) {
+        const float inv_w = 1.0f / clip[k][3];
+        x[k] = (clip[k][0] * inv_w * 0.5f + 0.5f) * (float)m_Width;
+        y[k] = (0.5f - clip[k][1] * inv_w * 0.5f) * (float)m_Height;
+        z[k] = clip[k][2] * inv_w;
+    }
+
+    const float area =
+        (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (fabs(area) < 1e-8f) return;
+
+    Triangle triangle;
+
+    const auto min_x = std::max(0.0f, floor(std::min({x[0], x[1], x[2]})));
+    const auto max_x =
+        std::min((float)m_Width - 1.0f, ceil(std::max({x[0], x[1], x[2]})));
+    const auto min_y = std::max(0.0f, floor(std::min({y[0], y[1], y[2]})));
+    const auto max_y =
+        std::min((float)m_Height - 1.0f, ceil(std::max({y[0], y[1], y[2]})));
+    if (min_x > max_x || min_y > max_y) return;
+
+    triangle.min_x = (int32_t)min_x;
+    triangle.max_x = (int32_t)max_x;
+    triangle.min_y = (int32_t)min_y;
+    triangle.max_y = (int32_t)max_y;
+
+    // both windings are accepted: every edge function evaluates to `area`
+    // at the opposite vertex, so its sign makes them positive inside. the
+    // coverage is sampled at the pixel centers, so that the triangles of a
+    // mesh leave no gap between them.
+    const float sign = (area > 0.0f) ? 1.0f : -1.0f;
+    for (size_t k = 0; k < 3; k++) {
+        const size_t j = (k + 1) % 3;
+        const float a = sign * (y[k] - y[j]);
+        const float b = sign * (x[j] - x[k]);
+        const float c = sign * (x[k] * y[j] - y[k] * x[j]);
+        triangle.edges[k * 3] = a;
+        triangle.edges[k * 3 + 1] = b;
+        triangle.edges[k * 3 + 2] = c;
+    }
+
+    // z / w is linear in screen space, take the farthest value over the
+    // pixel so that the occluder is never closer than it really is
+    const float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) -
+                        (z[2] - z[0]) * (y[1] - y[0])) /
+                       area;
+    const float dzdy = ((z[2] - z[0]) * (x[1] - x[0]) -
+                        (z[1] - z[0]) * (x[2] - x[0])) /
+                       area;
+    triangle.depth_plane[0] = dzdx;
+    triangle.depth_plane[1] = dzdy;
+    triangle.depth_plane[2] = z[0] - dzdx * x[0] - dzdy * y[0] +
+                              0.5f * (fabs(dzdx) + fabs(dzdy));
+
+    const auto index = static_cast<uint32_t>(m_Triangles.size());
+    m_Triangles.push_back(triangle);
+
+    for (auto band = (uint32_t)triangle.min_y / kBandHeight;
+         band <= (uint32_t)triangle.max_y / kBandHeight; band++) {
+        m_Bins[band].push_back(index);
+    }
+}
+
+void HiZBuffer::rasterizeBand(const uint32_t band) {
+    auto& depth = m_Levels[0].depth;
+    const auto band_min_y = static_cast<int32_t>(band * kBandHeight);
+    const auto band_max_y = std::min(static_cast<int32_t>(m_Height) - 1,
+                                     band_min_y + (int32_t)kBandHeight - 1);
+
+    for (const auto index : m_Bins[band]) {
+        const auto& triangle = m_Triangles[index];
+        RasterizeTriangleDepth(depth.data(), static_cast<int32_t>(m_Width),
+                               triangle.min_x,
+                               std::max(triangle.min_y, band_min_y),
+                               triangle.max_x,
+                               std::min(triangle.max_y, band_max_y),
+                               triangle.edges, triangle.depth_plane);
+    }
+}
+
+void HiZBuffer::Rasterize() {
+    // the bands do not overlap, so they can be written concurrently
+    vector<future<void>> jobs;
+    jobs.reserve(m_Bins.size());
+    for (uint32_t band = 0; band < m_Bins.size(); band++) {
+        if (m_Bins[band].empty()) continue;
+        jobs.push_back(
+            async(launch::async, &HiZBuffer::rasterizeBand, this, band));
+    }
+
+    for (auto& job : jobs) {
+        job.wait();
+    }
+
+    for (size_t i = 1; i < m_Levels.size(); i++) {
+        const auto& src = m_Levels[i - 1];
+        auto& dst = m_Levels[i];
+        DownsampleDepthMax(src.depth.data(), (int32_t)src.width,
+                           (int32_t)src.height, dst.depth.data(),
+                           (int32_t)dst.width, (int32_t)dst.height);
+    }
+}
+
+bool HiZBuffer::IsVisible(const Vector3f& bbmin, const Vector3f& bbmax,
+                          const Matrix4X4f& model_view_projection) const {
+    float min_x = numeric_limits<float>::max();
+    float min_y = numeric_limits<float>::max();
+    float max_x = numeric_limits<float>::lowest();
+    float max_y = numeric_limits<float>::lowest();
+    float min_z = numeric_limits<float>::max();
+
+    for (uint32_t corner = 0; corner < 8; corner++) {
+        Vector4f p({(corner & 1) ? bbmax[0] : bbmin[0],
+                    (corner & 2) ? bbmax[1] : bbmin[1],
+                    (corner & 4) ? bbmax[2] : bbmin[2], 1.0f});
+        Transform(p, model_view_projection);
+
+        // the box crosses the near plane
+        if (p[3] <= kNearW) return true;
+
+        const float inv_w = 1.0f / p[3];
+        const float x = (p[0] * inv_w * 0.5f + 0.5f) * (float)m_Width;
+        const float y = (0.5f - p[1] * inv_w * 0.5f) * (float)m_Height;
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+        min_z = std::min(min_z, p[2] * inv_w);
+    }
+
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= (float)m_Width ||
+        min_y >= (float)m_Height) {
+        return false;
+    }
+
+    const auto x0 = (uint32_t)std::max(0.0f, floor(min_x));
+    const auto y0 = (uint32_t)std::max(0.0f, floor(min_y));
+    const auto x1 = (uint32_t)std::min((float)m_Width - 1.0f, floor(max_x));
+    const auto y1 = (uint32_t)std::min((float)m_Height - 1.0f, floor(max_y));
+
+    // pick the level at which the rectangle covers at most 2x2 texels
+    size_t level = 0;
+    while (level + 1 < m_Levels.size() &&
+           std::max(x1 - x0, y1 - y0) >> level > 1) {
+        level++;
+    }
+
+    for (uint32_t y = y0 >> level; y <= y1 >> level; y++) {
+        for (uint32_t x = x0 >> level; x <= x1 >> level; x++) {
+            if (min_z <= GetDepth(level, x, y)) return true;
+        }
+    }
+
+    return false;
+}
+
+float HiZBuffer::GetDepth(const size_t level, const uint32_t x,
+                          const uint32_t y) const {
+    const auto& l = m_Levels[level];
+    return l.depth[static_cast<size_t>(y) * l.width + x];
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "geommath.hpp"
+
+namespace My {
+// A low resolution software depth buffer with a max depth pyramid, used for
+// conservative occlusion queries on the CPU. The depth stored is the post
+// projection z / w, so larger values are farther away with both the OpenGL
+// and the D3D depth range.
+class HiZBuffer {
+   public:
+    static const uint32_t kDefaultWidth = 256;
+    static const uint32_t kDefaultHeight = 128;
+    // rows of pixels rasterized by one job
+    static const uint32_t kBandHeight = 16;
+
+    explicit HiZBuffer(uint32_t width = kDefaultWidth,
+                       uint32_t height = kDefaultHeight);
+
+    void Clear();
+
+    // Transforms the triangles of an occluder to the screen and bins them.
+    // Triangles crossing the near plane are dropped, which only makes the
+    // occlusion less aggressive.
+    void AddOccluder(const float* positions, const size_t position_stride,
+                     const uint16_t* indices, const size_t index_count,
+                     const Matrix4X4f& model_view_projection);
+    void AddOccluder(const float* positions, const size_t position_stride,
+                     const uint32_t* indices, const size_t index_count,
+                     const Matrix4X4f& model_view_projection);
+
+    // Rasterizes the occluders added since the last Clear, one job per band
+    // of rows, then builds the depth pyramid.
+    void Rasterize();
+
+    // Returns false only if the box (in object space) is entirely hidden
+    // behind the occluders or outside of the screen.
+    [[nodiscard]] bool IsVisible(const Vector3f& bbmin, const Vector3f& bbmax,
+                                 const Matrix4X4f& model_view_projection) const;
+
+    [[nodiscard]] uint32_t GetWidth() const { return m_Width; }
+    [[nodiscard]] uint32_t GetHeight() const { return m_Height; }
+    [[nodiscard]] size_t GetLevelCount() const { return m_Levels.size(); }
+    [[nodiscard]] size_t GetTriangleCount() const {
+        return m_Triangles.size();
+    }
+    [[nodiscard]] float GetDepth(const size_t level, const uint32_t x,
+                                 const uint32_t y) const;
+
+   private:
+    struct Triangle {
+        float edges[9];
+        float depth_plane[3];
+        int32_t min_x, min_y, max_x, max_y;
+    };
+
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        std::vector<float> depth;
+    };
+
+    template <typename T>
+    void addOccluder(const float* positions, const size_t position_stride,
+                     const T* indices, const size_t index_count,
+                     const Matrix4X4f& model_view_projection);
+    void setupTriangle(const Vector4f clip[3]);
+    void rasterizeBand(const uint32_t band);
+
+    uint32_t m_Width;
+    uint32_t m_Height;
+    // level 0 is the full resolution depth buffer
+    std::vector<Level> m_Levels;
+    std::vector<Triangle> m_Triangles;
+    // indices of the triangles touching each band
+    std::vector<std::vector<uint32_t>> m_Bins;
+};
+}  // namespace My
@@ -0,0 +1,222 @@
+#include "LightClusterGrid.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <future>
+
+using namespace My;
+using namespace std;
+
+LightClusterGrid::LightClusterGrid(uint32_t count_x, uint32_t count_y,
+                                   uint32_t count_z)
+    : m_CountX(count_x), m_CountY(count_y), m_CountZ(count_z) {
+    assert(count_x && count_y && count_z);
+}
+
+void LightClusterGrid::Build(const float tan_half_fov_x,
+                             const float tan_half_fov_y, const float near_clip,
+                             const float far_clip) {
+    assert(near_clip > 0.0f && far_clip > near_clip);
+
+    m_TanHalfFovX = tan_half_fov_x;
+    m_TanHalfFovY = tan_half_fov_y;
+    m_NearClip = near_clip;
+    m_FarClip = far_clip;
+
+    const float log_ratio = log(far_clip / near_clip);
+    m_SliceScale = m_CountZ / log_ratio;
+    m_SliceBias = -(m_CountZ * log(near_clip) / log_ratio);
+
+    m_SliceDepths.resize(m_CountZ + 1);
+    for (uint32_t z = 0; z <= m_CountZ; z++) {
+        m_SliceDepths[z] =
+            near_clip * pow(far_clip / near_clip, float(z) / m_CountZ);
+    }
+    m_SliceDepths[m_CountZ] = far_clip;
+
+    m_Clusters.resize(GetClusterCount());
+
+    for (uint32_t z = 0; z < m_CountZ; z++) {
+        const float d0 = m_SliceDepths[z];
+        const float d1 = m_SliceDepths[z + 1];
+
+        for (uint32_t y = 0; y < m_CountY; y++) {
+            const float y0 = (-1.0f + 2.0f * y / m_CountY) * m_TanHalfFovY;
+            const float y1 = (-1.0f + 2.0f * (y + 1) / m_CountY) * m_TanHalfFovY;
+
+            for (uint32_t x = 0; x < m_CountX; x++) {
+                const float x0 =
+                    (-1.0f + 2.0f * x / m_CountX) * m_TanHalfFovX;
+                const float x1 =
+                    (-1.0f + 2.0f * (x + 1) / m_CountX) * m_TanHalfFovX;
+
+                // the froxel is a truncated pyramid, bound its 8 corners
+                auto& cluster = m_Clusters[GetClusterIndex(x, y, z)];
+                cluster.min = {min(x0 * d0, x0 * d1), min(y0 * d0, y0 * d1),
+                               -d1};
+                cluster.max = {max(x1 * d0, x1 * d1), max(y1 * d0, y1 * d1),
+                               -d0};
+            }
+        }
+    }
+}
+
+uint32_t LightClusterGrid::GetSlice(const float depth) const {
+    const float slice =
+        floor(log(max(depth, m_NearClip)) * m_SliceScale + m_SliceBias);
+    return static_cast<uint32_t>(
+        std::clamp(slice, 0.0f, static_cast<float>(m_CountZ - 1)));
+}
+
+uint32_t LightClusterGrid::GetClusterIndex(const Vector3f& position) const {
+    const float depth = max(-position[2], m_NearClip);
+
+    auto tile = [](const float ndc, const uint32_t count) {
+        const float t = floor((ndc * 0.5f + 0.5f) * count);
+        return static_cast<uint32_t>(
+            std::clamp(t, 0.0f, static_cast<float>(count - 1)));
+    };
+
+    return GetClusterIndex(
+        tile(position[0] / (depth * m_TanHalfFovX), m_CountX),
+        tile(position[1] / (depth * m_TanHalfFovY), m_CountY),
+        GetSlice(depth));
+}
+
+void LightClusterGrid::assignSlices(const vector<LightBounds>& lights,
+                                    const uint32_t begin, const uint32_t end,
+                                    SliceBins& bins) const {
+    const uint32_t tiles_per_slice = m_CountX * m_CountY;
+
+    // lights of each tile of the slice being binned, kept across slices so
+    // the storage is reused
+    vector<vector<uint32_t>> tiles(tiles_per_slice);
+
+    bins.clusters.reserve((end - begin) * tiles_per_slice);
+
+    for (uint32_t z = begin; z < end; z++) {
+        for (auto& tile : tiles) {
+            tile.clear();
+        }
+
+        const float d0 = m_SliceDepths[z];
+        const float d1 = m_SliceDepths[z + 1];
+
+        for (uint32_t i = 0; i < lights.size(); i++) {
+            const auto& light = lights[i];
+
+            if (light.radius < 0.0f) {
+                for (auto& tile : tiles) {
+                    tile.push_back(i);
+                }
+                continue;
+            }
+
+            const float depth = -light.center[2];
+            const float near_depth = max(d0, depth - light.radius);
+            const float far_depth = min(d1, depth + light.radius);
+            if (near_depth > far_depth) continue;
+
+            // range of tiles covered by the bounding box of the sphere,
+            // over the depth range it shares with the slice
+            auto tile_range = [&](const float center, const float tan_half_fov,
+                                  const uint32_t count, uint32_t& first,
+                                  uint32_t& last) {
+                const float lo = center - light.radius;
+                const float hi = center + light.radius;
+                const float ndc_lo =
+                    lo / ((lo < 0.0f ? near_depth : far_depth) * tan_half_fov);
+                const float ndc_hi =
+                    hi / ((hi > 0.0f ? near_depth : far_depth) * tan_half_fov);
+                if (ndc_hi < -1.0f || ndc_lo > 1.0f) return false;
+
+                const float scale = 0.5f * count;
+                first = static_cast<uint32_t>(
+                    max(floor((ndc_lo + 1.0f) * scale), 0.0f));
+                last = static_cast<uint32_t>(min(
+                    floor((ndc_hi + 1.0f) * scale), float(count - 1)));
+                return true;
+            };
+
+            uint32_t x_first, x_last, y_first, y_last;
+            if (!tile_range(light.center[0], m_TanHalfFovX, m_CountX, x_first,
+                            x_last) ||
+                !tile_range(light.center[1], m_TanHalfFovY, m_CountY, y_first,
+                            y_last)) {
+                continue;
+            }
+
+            const float radius_squared = light.radius * light.radius;
+
+            for (uint32_t y = y_first; y <= y_last; y++) {
+                for (uint32_t x = x_first; x <= x_last; x++) {
+                    const auto& cluster = m_Clusters[GetClusterIndex(x, y, z)];
+
+                    // squared distance from the center to the box
+                    float distance_squared = 0.0f;
+                    for (int32_t axis = 0; axis < 3; axis++) {
+                        const float v = light.center[axis];
+                        const float d =
+                            max(max(cluster.min[axis] - v, v - cluster.max[axis]),
+                                0.0f);
+                        distance_squared += d * d;
+                    }
+
+                    if (distance_squared <= radius_squared) {
+                        tiles[y * m_CountX + x].push_back(i);
+                    }
+                }
+            }
+        }
+
+        for (const auto& tile : tiles) {
+            bins.clusters.push_back(
+                {static_cast<uint32_t>(bins.indices.size()),
+                 static_cast<uint32_t>(tile.size())});
+            bins.indices.insert(bins.indices.end(), tile.begin(), tile.end());
+        }
+    }
+}
+
+void LightClusterGrid::Assign(const vector<LightBounds>& lights,
+                              const uint32_t jobs,
+                              vector<LightClusterRange>& clusters,
+                              vector<uint32_t>& indices) const {
+    assert(!m_Clusters.empty());
+
+    clusters.clear();
+    indices.clear();
+
+    const uint32_t job_count = std::clamp(jobs, 1u, m_CountZ);
+    vector<SliceBins> bins(job_count);
+
+    if (job_count == 1) {
+        assignSlices(lights, 0, m_CountZ, bins[0]);
+    } else {
+        vector<future<void>> futures;
+        futures.reserve(job_count);
+        for (uint32_t i = 0; i < job_count; i++) {
+            const uint32_t begin = m_CountZ * i / job_count;
+            const uint32_t end = m_CountZ * (i + 1) / job_count;
+            futures.push_back(async(launch::async,
+                                    &LightClusterGrid::assignSlices, this,
+                                    cref(lights), begin, end, ref(bins[i])));
+        }
+
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+
+    // slices are binned in cluster order, so the results only need to be
+    // concatenated
+    clusters.reserve(GetClusterCount());
+    for (const auto& bin : bins) {
+        const auto base = static_cast<uint32_t>(indices.size());
+        for (const auto& cluster : bin.clusters) {
+            clusters.push_back({cluster.offset + base, cluster.count});
+        }
+        indices.insert(indices.end(), bin.indices.begin(), bin.indices.end());
+    }
+}
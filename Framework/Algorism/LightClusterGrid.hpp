@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "geommath.hpp"
+
+namespace My {
+// lights of a cluster are indices[offset, offset + count)
+struct LightClusterRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// A 3D grid of froxels covering the view frustum, used to bin lights on the
+// CPU for clustered shading. Clusters split the screen evenly in x and y and
+// the view depth exponentially, so a cluster is found from the normalized
+// device coordinates and the view depth of a pixel:
+//     slice = floor(log(depth) * slice_scale + slice_bias)
+// Positions are in the right handed view space, looking down -z.
+class LightClusterGrid {
+   public:
+    static const uint32_t kDefaultCountX = 16;
+    static const uint32_t kDefaultCountY = 8;
+    static const uint32_t kDefaultCountZ = 24;
+
+    // a sphere in view space, a negative radius reaches every cluster
+    struct LightBounds {
+        Vector3f center;
+        float radius;
+    };
+
+    explicit LightClusterGrid(uint32_t count_x = kDefaultCountX,
+                              uint32_t count_y = kDefaultCountY,
+                              uint32_t count_z = kDefaultCountZ);
+
+    // Computes the bounds of the clusters of a perspective frustum. The
+    // tangents come from the projection, tan_half_fov = 1 / projection[i][i].
+    void Build(const float tan_half_fov_x, const float tan_half_fov_y,
+               const float near_clip, const float far_clip);
+
+    // Bins the lights into the clusters, slices of the grid in parallel
+    // when more than one job is allowed. The indices of a cluster are
+    // sorted.
+    void Assign(const std::vector<LightBounds>& lights, const uint32_t jobs,
+                std::vector<LightClusterRange>& clusters,
+                std::vector<uint32_t>& indices) const;
+
+    [[nodiscard]] uint32_t GetClusterIndex(const uint32_t x, const uint32_t y,
+                                           const uint32_t z) const {
+        return (z * m_CountY + y) * m_CountX + x;
+    }
+    // cluster holding the view space position, which must be in the frustum
+    [[nodiscard]] uint32_t GetClusterIndex(const Vector3f& position) const;
+    [[nodiscard]] uint32_t GetSlice(const float depth) const;
+
+    [[nodiscard]] uint32_t GetClusterCount() const {
+        return m_CountX * m_CountY * m_CountZ;
+    }
+    [[nodiscard]] float GetSliceScale() const { return m_SliceScale; }
+    [[nodiscard]] float GetSliceBias() const { return m_SliceBias; }
+
+   private:
+    struct Cluster {
+        Vector3f min;
+        Vector3f max;
+    };
+
+    struct SliceBins {
+        std::vector<LightClusterRange> clusters;
+        std::vector<uint32_t> indices;
+    };
+
+    void assignSlices(const std::vector<LightBounds>& lights,
+                      const uint32_t begin, const uint32_t end,
+                      SliceBins& bins) const;
+
+    uint32_t m_CountX;
+    uint32_t m_CountY;
+    uint32_t m_CountZ;
+
+    float m_TanHalfFovX{1.0f};
+    float m_TanHalfFovY{1.0f};
+    float m_NearClip{1.0f};
+    float m_FarClip{1000.0f};
+    float m_SliceScale{0.0f};
+    float m_SliceBias{0.0f};
+
+    // view depth of the boundaries between slices, m_CountZ + 1 of them
+    std::vector<float> m_SliceDepths;
+    std::vector<Cluster> m_Clusters;
+};
+}  // namespace My
@@ -0,0 +1,500 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+using namespace My;
+using namespace std;
+
+namespace {
+// Forsyth scoring parameters
+constexpr uint32_t kMaxScoringCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+// simulated L1 for vertex fetch analysis
+constexpr size_t kCacheLineSize = 64;
+constexpr size_t kCacheLineCount = 64;
+
+float vertex_score(const int32_t cache_position,
+                   const uint32_t remaining_valence) {
+    if (remaining_valence == 0) {
+        // no triangle needs this vertex anymore
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // the vertex was used in the last triangle, give it a fixed
+            // score so that the strip does not just jump back and forth
+            score = kLastTriScore;
+        } else {
+            const float scaler = 1.0f / (kMaxScoringCacheSize - 3);
+            score = 1.0f - (cache_position - 3) * scaler;
+            score = powf(score, kCacheDecayPower);
+        }
+    }
+
+    // bonus for vertices with few remaining triangles, so that lone
+    // triangles are not left behind
+    score += kValenceBoostScale *
+             powf(static_cast<float>(remaining_valence), -kValenceBoostPower);
+
+    return score;
+}
+
+// Simulated FIFO post-transform cache. A vertex is in it if it was
+// inserted after the cache was last cleared and fewer than cache_size
+// vertices have been inserted since, so clearing only moves the base.
+class FifoCache {
+   public:
+    FifoCache(const size_t vertex_count, const uint32_t cache_size)
+        : m_InsertedAt(vertex_count, 0), m_nCacheSize(cache_size) {}
+
+    // returns true if the vertex missed and has been inserted
+    bool Access(const uint32_t index) {
+        assert(index < m_InsertedAt.size());
+
+        const size_t inserted_at = m_InsertedAt[index];
+        if (inserted_at > m_nBase &&
+            m_nInsertions - inserted_at < m_nCacheSize) {
+            return false;
+        }
+
+        m_InsertedAt[index] = ++m_nInsertions;
+        return true;
+    }
+
+    void Clear() { m_nBase = m_nInsertions; }
+
+    // vertices inserted since the last clear
+    [[nodiscard]] size_t GetMisses() const { return m_nInsertions - m_nBase; }
+
+   private:
+    vector<size_t> m_InsertedAt;
+    size_t m_nInsertions{0};
+    size_t m_nBase{0};
+    const uint32_t m_nCacheSize;
+};
+
+struct Cluster {
+    size_t begin;
+    size_t end;
+    float sort_key;
+};
+}  // namespace
+
+VertexCacheStatistics My::AnalyzeVertexCache(const vector<uint32_t>& indices,
+                                             const size_t vertex_count,
+                                             const uint32_t cache_size) {
+    assert(indices.size() % 3 == 0);
+
+    VertexCacheStatistics result;
+
+    FifoCache cache(vertex_count, cache_size);
+    for (const auto index : indices) {
+        cache.Access(index);
+    }
+
+    const size_t insertions = cache.GetMisses();
+    result.vertices_transformed = insertions;
+
+    const size_t triangle_count = indices.size() / 3;
+    result.acmr = triangle_count ? static_cast<float>(insertions) /
+                                       static_cast<float>(triangle_count)
+                                 : 0.0f;
+    result.atvr = vertex_count ? static_cast<float>(insertions) /
+                                     static_cast<float>(vertex_count)
+                               : 0.0f;
+
+    return result;
+}
+
+VertexFetchStatistics My::AnalyzeVertexFetch(const vector<uint32_t>& indices,
+                                             const size_t vertex_count,
+                                             const size_t vertex_size) {
+    VertexFetchStatistics result;
+
+    // only the vertices that miss the post-transform cache are fetched
+    FifoCache cache(vertex_count, kDefaultVertexCacheSize);
+
+    // FIFO of cache line addresses
+    vector<size_t> lines(kCacheLineCount, numeric_limits<size_t>::max());
+    size_t line_cursor = 0;
+
+    for (const auto index : indices) {
+        if (!cache.Access(index)) continue;
+
+        const size_t first_line = index * vertex_size / kCacheLineSize;
+        const size_t last_line =
+            ((index + 1) * vertex_size - 1) / kCacheLineSize;
+
+        for (size_t line = first_line; line <= last_line; line++) {
+            if (find(lines.begin(), lines.end(), line) == lines.end()) {
+                lines[line_cursor] = line;
+                line_cursor = (line_cursor + 1) % kCacheLineCount;
+                result.bytes_fetched += kCacheLineSize;
+            }
+        }
+    }
+
+    const size_t buffer_size = vertex_count * vertex_size;
+    result.overfetch = buffer_size ? static_cast<float>(result.bytes_fetched) /
+                                         static_cast<float>(buffer_size)
+                                   : 0.0f;
+
+    return result;
+}
+
+vector<uint32_t> My::OptimizeVertexCache(const vector<uint32_t>& indices,
+                                         const size_t vertex_count) {
+    assert(indices.size() % 3 == 0);
+
+    const size_t triangle_count = indices.size() / 3;
+
+    vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    if (triangle_count == 0) return result;
+
+    // build vertex -> triangle adjacency
+    vector<uint32_t> triangle_offsets(vertex_count + 1, 0);
+    for (const auto index : indices) {
+        assert(index < vertex_count);
+        triangle_offsets[index + 1]++;
+    }
+
+    vector<uint32_t> remaining_valence(vertex_count);
+    for (size_t i = 0; i < vertex_count; i++) {
+        remaining_valence[i] = triangle_offsets[i + 1];
+        triangle_offsets[i + 1] += triangle_offsets[i];
+    }
+
+    vector<uint32_t> adjacent_triangles(indices.size());
+    {
+        vector<uint32_t> fill(triangle_offsets.begin(),
+                              triangle_offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacent_triangles[fill[indices[i]]++] =
+                static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    vector<float> vertex_scores(vertex_count);
+    for (size_t i = 0; i < vertex_count; i++) {
+        vertex_scores[i] = vertex_score(-1, remaining_valence[i]);
+    }
+
+    vector<float> triangle_scores(triangle_count);
+    for (size_t i = 0; i < triangle_count; i++) {
+        triangle_scores[i] = vertex_scores[indices[i * 3]] +
+                             vertex_scores[indices[i * 3 + 1]] +
+                             vertex_scores[indices[i * 3 + 2]];
+    }
+
+    vector<bool> emitted(triangle_count, false);
+
+    // the cache holds up to kMaxScoringCacheSize entries, plus room for the
+    // three vertices pushed in by the new triangle
+    vector<uint32_t> cache;
+    vector<uint32_t> new_cache;
+    cache.reserve(kMaxScoringCacheSize + 3);
+    new_cache.reserve(kMaxScoringCacheSize + 3);
+
+    size_t input_cursor = 0;
+    uint32_t best_triangle = 0;
+
+    // seed with the highest scoring triangle
+    for (size_t i = 1; i < triangle_count; i++) {
+        if (triangle_scores[i] > triangle_scores[best_triangle]) {
+            best_triangle = static_cast<uint32_t>(i);
+        }
+    }
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count;
+         emitted_count++) {
+        if (best_triangle == numeric_limits<uint32_t>::max()) {
+            // nothing in the cache is adjacent to a remaining triangle,
+            // fall back to the next triangle in input order
+            while (emitted[input_cursor]) input_cursor++;
+            best_triangle = static_cast<uint32_t>(input_cursor);
+        }
+
+        const uint32_t a = indices[best_triangle * 3];
+        const uint32_t b = indices[best_triangle * 3 + 1];
+        const uint32_t c = indices[best_triangle * 3 + 2];
+
+        result.push_back(a);
+        result.push_back(b);
+        result.push_back(c);
+        emitted[best_triangle] = true;
+
+        // push the vertices of the emitted triangle to the front of the
+        // cache and keep the rest in LRU order
+        new_cache.clear();
+        new_cache.push_back(a);
+        new_cache.push_back(b);
+        new_cache.push_back(c);
+        for (const auto v : cache) {
+            if (v != a && v != b && v != c) new_cache.push_back(v);
+        }
+        swap(cache, new_cache);
+
+        // remove the emitted triangle from the adjacency of its vertices
+        for (const auto v : {a, b, c}) {
+            auto* begin = &adjacent_triangles[triangle_offsets[v]];
+            auto* end = begin + remaining_valence[v];
+            auto* it = find(begin, end, best_triangle);
+            assert(it != end);
+            *it = *(end - 1);
+            remaining_valence[v]--;
+        }
+
+        // update scores of the vertices in the cache and of the triangles
+        // adjacent to them
+        for (size_t i = 0; i < cache.size(); i++) {
+            const uint32_t v = cache[i];
+            const int32_t position =
+                (i < kMaxScoringCacheSize) ? static_cast<int32_t>(i) : -1;
+            const float score = vertex_score(position, remaining_valence[v]);
+            const float delta = score - vertex_scores[v];
+            vertex_scores[v] = score;
+
+            const uint32_t* adjacent =
+                &adjacent_triangles[triangle_offsets[v]];
+            for (uint32_t j = 0; j < remaining_valence[v]; j++) {
+                triangle_scores[adjacent[j]] += delta;
+            }
+        }
+
+        if (cache.size() > kMaxScoringCacheSize) {
+            cache.resize(kMaxScoringCacheSize);
+        }
+
+        // the best next triangle is one adjacent to the cache
+        best_triangle = numeric_limits<uint32_t>::max();
+        float best_score = -numeric_limits<float>::max();
+        for (const auto v : cache) {
+            const uint32_t* adjacent =
+                &adjacent_triangles[triangle_offsets[v]];
+            for (uint32_t j = 0; j < remaining_valence[v]; j++) {
+                if (triangle_scores[adjacent[j]] > best_score) {
+                    best_score = triangle_scores[adjacent[j]];
+                    best_triangle = adjacent[j];
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+vector<uint32_t> My::OptimizeOverdraw(const vector<uint32_t>& indices,
+                                      const float* positions,
+                                      const size_t vertex_count,
+                                      const size_t position_stride,
+                                      const float threshold) {
+    assert(indices.size() % 3 == 0);
+    assert(positions);
+
+    const size_t triangle_count = indices.size() / 3;
+
+    if (triangle_count < 2) return indices;
+
+    // find hard boundaries, where all three vertices of a triangle miss
+    // the cache, so starting a new cluster there costs nothing. A second
+    // cache, cleared at every boundary, gives the ACMR of each hard
+    // cluster on its own in the same pass
+    vector<size_t> hard_boundaries;
+    vector<float> hard_acmrs;
+    {
+        FifoCache cache(vertex_count, kDefaultVertexCacheSize);
+        FifoCache cluster_cache(vertex_count, kDefaultVertexCacheSize);
+
+        for (size_t i = 0; i < triangle_count; i++) {
+            uint32_t misses = 0;
+            for (size_t k = 0; k < 3; k++) {
+                if (cache.Access(indices[i * 3 + k])) misses++;
+            }
+
+            if (i == 0 || misses == 3) {
+                if (i) {
+                    hard_acmrs.push_back(
+                        static_cast<float>(cluster_cache.GetMisses()) /
+                        static_cast<float>(i - hard_boundaries.back()));
+                }
+                hard_boundaries.push_back(i);
+                cluster_cache.Clear();
+            }
+
+            for (size_t k = 0; k < 3; k++) {
+                cluster_cache.Access(indices[i * 3 + k]);
+            }
+        }
+
+        hard_acmrs.push_back(
+            static_cast<float>(cluster_cache.GetMisses()) /
+            static_cast<float>(triangle_count - hard_boundaries.back()));
+    }
+    hard_boundaries.push_back(triangle_count);
+
+    // split the hard clusters further wherever the ACMR of the part so far
+    // is already within the threshold of the whole cluster
+    vector<Cluster> clusters;
+    FifoCache cache(vertex_count, kDefaultVertexCacheSize);
+    for (size_t h = 0; h + 1 < hard_boundaries.size(); h++) {
+        const size_t begin = hard_boundaries[h];
+        const size_t end = hard_boundaries[h + 1];
+        const float target = hard_acmrs[h] * threshold;
+
+        cache.Clear();
+        size_t cluster_begin = begin;
+
+        for (size_t i = begin; i < end; i++) {
+            for (size_t k = 0; k < 3; k++) {
+                cache.Access(indices[i * 3 + k]);
+            }
+
+            const float acmr = static_cast<float>(cache.GetMisses()) /
+                               static_cast<float>(i - cluster_begin + 1);
+            if (acmr <= target && i + 1 < end) {
+                clusters.push_back({cluster_begin, i + 1, 0.0f});
+                cluster_begin = i + 1;
+                cache.Clear();
+            }
+        }
+
+        clusters.push_back({cluster_begin, end, 0.0f});
+    }
+
+    // compute the area weighted centroid and normal of every cluster
+    auto position_of = [&](const uint32_t index) {
+        return positions + index * position_stride;
+    };
+
+    vector<float> cluster_data(clusters.size() * 7, 0.0f);
+    float mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+    float mesh_area = 0.0f;
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        float* centroid = &cluster_data[c * 7];
+        float* normal = centroid + 3;
+        float& area = centroid[6];
+
+        for (size_t i = clusters[c].begin; i < clusters[c].end; i++) {
+            const float* p0 = position_of(indices[i * 3]);
+            const float* p1 = position_of(indices[i * 3 + 1]);
+            const float* p2 = position_of(indices[i * 3 + 2]);
+
+            const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            const float n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                                e1[2] * e2[0] - e1[0] * e2[2],
+                                e1[0] * e2[1] - e1[1] * e2[0]};
+            const float a = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (size_t k = 0; k < 3; k++) {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) * (a / 3.0f);
+                normal[k] += n[k];
+            }
+            area += a;
+        }
+
+        for (size_t k = 0; k < 3; k++) {
+            mesh_centroid[k] += centroid[k];
+        }
+        mesh_area += area;
+
+        if (area > 0.0f) {
+            for (size_t k = 0; k < 3; k++) {
+                centroid[k] /= area;
+            }
+        }
+    }
+
+    if (mesh_area > 0.0f) {
+        for (float& k : mesh_centroid) {
+            k /= mesh_area;
+        }
+    }
+
+    // clusters facing away from the mesh center are likely to occlude
+    // the rest, so draw them first
+    for (size_t c = 0; c < clusters.size(); c++) {
+        const float* centroid = &cluster_data[c * 7];
+        const float* normal = centroid + 3;
+        const float length = sqrtf(normal[0] * normal[0] +
+                                   normal[1] * normal[1] +
+                                   normal[2] * normal[2]);
+
+        float key = 0.0f;
+        if (length > 0.0f) {
+            for (size_t k = 0; k < 3; k++) {
+                key += (centroid[k] - mesh_centroid[k]) * normal[k];
+            }
+            key /= length;
+        }
+
+        clusters[c].sort_key = key;
+    }
+
+    stable_sort(clusters.begin(), clusters.end(),
+                [](const Cluster& a, const Cluster& b) {
+                    return a.sort_key > b.sort_key;
+                });
+
+    vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const auto& cluster : clusters) {
+        result.insert(result.end(), indices.begin() + cluster.begin * 3,
+                      indices.begin() + cluster.end * 3);
+    }
+
+    return result;
+}
+
+size_t My::OptimizeVertexFetchRemap(vector<uint32_t>& remap,
+                                    const vector<uint32_t>& indices,
+                                    const size_t vertex_count) {
+    remap.assign(vertex_count, numeric_limits<uint32_t>::max());
+
+    uint32_t next_vertex = 0;
+    for (const auto index : indices) {
+        assert(index < vertex_count);
+
+        if (remap[index] == numeric_limits<uint32_t>::max()) {
+            remap[index] = next_vertex++;
+        }
+    }
+
+    return next_vertex;
+}
+
+void My::RemapIndexBuffer(vector<uint32_t>& indices,
+                          const vector<uint32_t>& remap) {
+    for (auto& index : indices) {
+        assert(remap[index] != numeric_limits<uint32_t>::max());
+        index = remap[index];
+    }
+}
+
+void My::RemapVertexBuffer(uint8_t* destination, const uint8_t* vertices,
+                           const size_t vertex_count, const size_t vertex_size,
+                           const vector<uint32_t>& remap) {
+    assert(destination != vertices);
+
+    for (size_t i = 0; i < vertex_count; i++) {
+        if (remap[i] != numeric_limits<uint32_t>::max()) {
+            memcpy(destination + remap[i] * vertex_size,
+                   vertices + i * vertex_size, vertex_size);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace My {
+// Statistics of a simulated post-transform vertex cache.
+// ACMR: average cache miss ratio (transformed vertices / triangles)
+// ATVR: average transformed vertex ratio (transformed vertices / vertices)
+struct VertexCacheStatistics {
+    size_t vertices_transformed{0};
+    float acmr{0.0f};
+    float atvr{0.0f};
+};
+
+// Statistics of the vertex fetch pattern. overfetch is the ratio of the
+// bytes fetched through a simulated L1 cache to the size of the vertex
+// buffer, 1.0 being ideal.
+struct VertexFetchStatistics {
+    size_t bytes_fetched{0};
+    float overfetch{0.0f};
+};
+
+constexpr uint32_t kDefaultVertexCacheSize = 16;
+
+// Runs the index buffer (triangle list) through a FIFO cache of
+// `cache_size` entries and reports the transform cost.
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices,
+                                         const size_t vertex_count,
+                                         const uint32_t cache_size =
+                                             kDefaultVertexCacheSize);
+
+VertexFetchStatistics AnalyzeVertexFetch(const std::vector<uint32_t>& indices,
+                                         const size_t vertex_count,
+                                         const size_t vertex_size);
+
+// Reorders triangles for post-transform cache locality using the
+// scoring heuristic from Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation".
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices,
+                                          const size_t vertex_count);
+
+// Splits the cache optimized index buffer into clusters at the points
+// where the cache is cold again, then sorts the clusters so that the ones
+// facing away from the mesh center are drawn first (Sander et al. "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw").
+// `threshold` controls how much ACMR may degrade (1.05 = 5%).
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices,
+                                       const float* positions,
+                                       const size_t vertex_count,
+                                       const size_t position_stride,
+                                       const float threshold = 1.05f);
+
+// Builds a remap table which renumbers the vertices in the order of first
+// reference in the index buffer. Unreferenced vertices are mapped to ~0u.
+// Returns the number of referenced vertices.
+size_t OptimizeVertexFetchRemap(std::vector<uint32_t>& remap,
+                                const std::vector<uint32_t>& indices,
+                                const size_t vertex_count);
+
+// Applies a remap table generated by OptimizeVertexFetchRemap
+void RemapIndexBuffer(std::vector<uint32_t>& indices,
+                      const std::vector<uint32_t>& remap);
+
+void RemapVertexBuffer(uint8_t* destination, const uint8_t* vertices,
+                       const size_t vertex_count, const size_t vertex_size,
+                       const std::vector<uint32_t>& remap);
+}  // namespace My
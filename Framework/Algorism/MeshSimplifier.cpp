@@ -0,0 +1,322 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+using namespace My;
+using namespace std;
+
+namespace {
+// symmetric 4x4 matrix of a sum of squared plane distances
+struct Quadric {
+    double a2{0}, ab{0}, ac{0}, ad{0};
+    double b2{0}, bc{0}, bd{0};
+    double c2{0}, cd{0};
+    double d2{0};
+
+    Quadric& operator+=(const Quadric& q) {
+        a2 += q.a2;
+        ab += q.ab;
+        ac += q.ac;
+        ad += q.ad;
+        b2 += q.b2;
+        bc += q.bc;
+        bd += q.bd;
+        c2 += q.c2;
+        cd += q.cd;
+        d2 += q.d2;
+        return *this;
+    }
+
+    [[nodiscard]] double Error(const float* p) const {
+        const double x = p[0], y = p[1], z = p[2];
+        return x * x * a2 + y * y * b2 + z * z * c2 +
+               2.0 * (x * y * ab + x * z * ac + y * z * bc) +
+               2.0 * (x * ad + y * bd + z * cd) + d2;
+    }
+};
+
+Quadric plane_quadric(const double a, const double b, const double c,
+                      const double d, const double weight) {
+    Quadric q;
+    q.a2 = weight * a * a;
+    q.ab = weight * a * b;
+    q.ac = weight * a * c;
+    q.ad = weight * a * d;
+    q.b2 = weight * b * b;
+    q.bc = weight * b * c;
+    q.bd = weight * b * d;
+    q.c2 = weight * c * c;
+    q.cd = weight * c * d;
+    q.d2 = weight * d * d;
+    return q;
+}
+
+void triangle_normal(const float* p0, const float* p1, const float* p2,
+                     double n[3]) {
+    const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+}  // namespace
+
+vector<uint32_t> My::SimplifyMesh(const vector<uint32_t>& indices,
+                                  const float* positions,
+                                  const size_t vertex_count,
+                                  const size_t position_stride,
+                                  const size_t target_index_count,
+                                  const float target_error,
+                                  float* result_error) {
+    assert(indices.size() % 3 == 0);
+    assert(positions);
+
+    vector<uint32_t> result = indices;
+
+    if (result_error) *result_error = 0.0f;
+
+    if (result.size() <= target_index_count) return result;
+
+    auto position_of = [&](const uint32_t index) {
+        return positions + index * position_stride;
+    };
+
+    // the error limit is given relative to the mesh extent
+    float extent = 0.0f;
+    {
+        float bbmin[3] = {numeric_limits<float>::max(),
+                          numeric_limits<float>::max(),
+                          numeric_limits<float>::max()};
+        float bbmax[3] = {numeric_limits<float>::lowest(),
+                          numeric_limits<float>::lowest(),
+                          numeric_limits<float>::lowest()};
+        for (const auto index : indices) {
+            const float* p = position_of(index);
+            for (size_t k = 0; k < 3; k++) {
+                bbmin[k] = min(bbmin[k], p[k]);
+                bbmax[k] = max(bbmax[k], p[k]);
+            }
+        }
+        for (size_t k = 0; k < 3; k++) {
+            extent = max(extent, bbmax[k] - bbmin[k]);
+        }
+    }
+
+    if (extent <= 0.0f) return result;
+
+    const double error_limit =
+        static_cast<double>(target_error) * target_error * extent * extent;
+
+    // lock the vertices on open borders, which includes the attribute seams
+    // since the vertices there are split
+    vector<bool> locked(vertex_count, false);
+    {
+        unordered_map<uint64_t, uint32_t> edge_count;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (size_t k = 0; k < 3; k++) {
+                const uint64_t a = result[i + k];
+                const uint64_t b = result[i + (k + 1) % 3];
+                edge_count[(min(a, b) << 32) | max(a, b)]++;
+            }
+        }
+
+        for (const auto& [edge, count] : edge_count) {
+            if (count == 1) {
+                locked[edge >> 32] = true;
+                locked[edge & 0xFFFFFFFFu] = true;
+            }
+        }
+
+        // vertices sharing a position with another vertex are seams even
+        // when the topology around them is closed
+        unordered_map<uint64_t, uint32_t> first_at_position;
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            const float* p = position_of(v);
+            uint32_t bits[3];
+            memcpy(bits, p, sizeof(bits));
+            const uint64_t key = (static_cast<uint64_t>(bits[0]) * 73856093u) ^
+                                 (static_cast<uint64_t>(bits[1]) * 19349663u) ^
+                                 (static_cast<uint64_t>(bits[2]) * 83492791u);
+            auto it = first_at_position.find(key);
+            if (it == first_at_position.end()) {
+                first_at_position.emplace(key, v);
+            } else if (memcmp(position_of(it->second), p,
+                              sizeof(float) * 3) == 0) {
+                locked[v] = true;
+                locked[it->second] = true;
+            }
+        }
+    }
+
+    // accumulate the area weighted plane quadrics of every vertex
+    vector<Quadric> quadrics(vertex_count);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const float* p0 = position_of(result[i]);
+        double n[3];
+        triangle_normal(p0, position_of(result[i + 1]),
+                        position_of(result[i + 2]), n);
+        const double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0) continue;
+
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        const double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        const Quadric q = plane_quadric(n[0], n[1], n[2], d, length * 0.5);
+
+        for (size_t k = 0; k < 3; k++) {
+            quadrics[result[i + k]] += q;
+        }
+    }
+
+    vector<uint32_t> remap(vertex_count);
+    vector<uint32_t> triangle_offsets(vertex_count + 1);
+    vector<uint32_t> adjacent_triangles;
+    vector<Collapse> collapses;
+    vector<bool> touched(vertex_count);
+    double max_error = 0.0;
+
+    while (result.size() > target_index_count) {
+        // vertex -> triangle adjacency of the current index buffer
+        fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+        for (const auto index : result) {
+            triangle_offsets[index + 1]++;
+        }
+        for (size_t v = 0; v < vertex_count; v++) {
+            triangle_offsets[v + 1] += triangle_offsets[v];
+        }
+        adjacent_triangles.resize(result.size());
+        {
+            vector<uint32_t> cursor(triangle_offsets.begin(),
+                                    triangle_offsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacent_triangles[cursor[result[i]]++] =
+                    static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // rank all the edge collapses by their quadric error
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t a = result[i + k];
+                const uint32_t b = result[i + (k + 1) % 3];
+
+                Quadric q = quadrics[a];
+                q += quadrics[b];
+
+                if (!locked[a]) {
+                    collapses.push_back({a, b, q.Error(position_of(b))});
+                }
+                if (!locked[b]) {
+                    collapses.push_back({b, a, q.Error(position_of(a))});
+                }
+            }
+        }
+
+        sort(collapses.begin(), collapses.end(),
+             [](const Collapse& x, const Collapse& y) {
+                 return x.cost < y.cost;
+             });
+
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            remap[v] = v;
+        }
+        fill(touched.begin(), touched.end(), false);
+
+        const size_t triangles_to_remove =
+            (result.size() - target_index_count + 2) / 3;
+        size_t triangles_removed = 0;
+        size_t collapses_applied = 0;
+
+        for (const auto& collapse : collapses) {
+            if (collapse.cost > error_limit) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            const uint32_t* adjacent =
+                &adjacent_triangles[triangle_offsets[collapse.from]];
+            const uint32_t adjacent_count =
+                triangle_offsets[collapse.from + 1] -
+                triangle_offsets[collapse.from];
+
+            // reject the collapse if any remaining triangle would flip
+            bool flipped = false;
+            size_t removed = 0;
+            for (uint32_t j = 0; j < adjacent_count && !flipped; j++) {
+                const uint32_t* t = &result[adjacent[j] * 3];
+                if (t[0] == collapse.to || t[1] == collapse.to ||
+                    t[2] == collapse.to) {
+                    removed++;
+                    continue;
+                }
+
+                const float* p[3];
+                const float* q[3];
+                for (size_t k = 0; k < 3; k++) {
+                    p[k] = position_of(t[k]);
+                    q[k] = (t[k] == collapse.from) ? position_of(collapse.to)
+                                                   : p[k];
+                }
+
+                double n0[3], n1[3];
+                triangle_normal(p[0], p[1], p[2], n0);
+                triangle_normal(q[0], q[1], q[2], n1);
+                if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0) {
+                    flipped = true;
+                }
+            }
+
+            if (flipped) continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            max_error = max(max_error, collapse.cost);
+
+            // the neighborhood of both vertices has changed, they will be
+            // re-evaluated on the next pass
+            touched[collapse.from] = true;
+            touched[collapse.to] = true;
+            for (uint32_t j = 0; j < adjacent_count; j++) {
+                const uint32_t* t = &result[adjacent[j] * 3];
+                touched[t[0]] = touched[t[1]] = touched[t[2]] = true;
+            }
+
+            collapses_applied++;
+            triangles_removed += removed;
+            if (triangles_removed >= triangles_to_remove) break;
+        }
+
+        if (collapses_applied == 0) break;
+
+        // rewrite the index buffer and drop the degenerated triangles
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t a = remap[result[i]];
+            const uint32_t b = remap[result[i + 1]];
+            const uint32_t c = remap[result[i + 2]];
+            if (a != b && b != c && c != a) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    if (result_error) {
+        *result_error = static_cast<float>(sqrt(max_error)) / extent;
+    }
+
+    return result;
+}
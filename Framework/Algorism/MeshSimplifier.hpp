@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace My {
+// Simplifies a triangle list with quadric error metric (Garland & Heckbert)
+// edge collapses. Vertices are only ever collapsed onto other existing
+// vertices, so the vertex buffer is left untouched and only a new index
+// buffer is produced. Open borders and attribute seams (vertices that share
+// a position) are locked to avoid cracks.
+//
+// target_index_count: the simplification stops once the index count drops
+//                     to or below this value
+// target_error:       the maximum error allowed, relative to the mesh extent
+// result_error:       if not null, receives the relative error reached
+std::vector<uint32_t> SimplifyMesh(const std::vector<uint32_t>& indices,
+                                   const float* positions,
+                                   const size_t vertex_count,
+                                   const size_t position_stride,
+                                   const size_t target_index_count,
+                                   const float target_error,
+                                   float* result_error = nullptr);
+}  // namespace My
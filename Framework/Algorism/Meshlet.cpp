@@ -0,0 +1,291 @@
+#include "Meshlet.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using namespace My;
+using namespace std;
+
+namespace {
+// the normal cone is not worth testing when it is wider than this
+constexpr float kMinConeDot = 0.1f;
+
+void compute_bounds(Meshlet& meshlet, const uint32_t* indices,
+                    const vector<uint32_t>& meshlet_vertices,
+                    const float* positions, const size_t position_stride) {
+    auto position_of = [&](const uint32_t index) {
+        return positions + index * position_stride;
+    };
+
+    // bounding sphere around the center of the aabb
+    float bbmin[3] = {numeric_limits<float>::max(),
+                      numeric_limits<float>::max(),
+                      numeric_limits<float>::max()};
+    float bbmax[3] = {numeric_limits<float>::lowest(),
+                      numeric_limits<float>::lowest(),
+                      numeric_limits<float>::lowest()};
+    for (const auto v : meshlet_vertices) {
+        const float* p = position_of(v);
+        for (size_t k = 0; k < 3; k++) {
+            bbmin[k] = min(bbmin[k], p[k]);
+            bbmax[k] = max(bbmax[k], p[k]);
+        }
+    }
+
+    for (size_t k = 0; k < 3; k++) {
+        meshlet.center[k] = (bbmin[k] + bbmax[k]) * 0.5f;
+    }
+
+    float radius2 = 0.0f;
+    for (const auto v : meshlet_vertices) {
+        const float* p = position_of(v);
+        const float dx = p[0] - meshlet.center[0];
+        const float dy = p[1] - meshlet.center[1];
+        const float dz = p[2] - meshlet.center[2];
+        radius2 = max(radius2, dx * dx + dy * dy + dz * dz);
+    }
+    meshlet.radius = sqrtf(radius2);
+
+    // normal cone around the area weighted average normal
+    vector<Vector3f> normals;
+    normals.reserve(meshlet.index_count / 3);
+    Vector3f axis;
+    for (uint32_t i = 0; i < meshlet.index_count; i += 3) {
+        const float* p0 = position_of(indices[i]);
+        const float* p1 = position_of(indices[i + 1]);
+        const float* p2 = position_of(indices[i + 2]);
+        Vector3f e1({p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]});
+        Vector3f e2({p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]});
+        Vector3f n;
+        CrossProduct(n, e1, e2);
+
+        const float length = Length(n);
+        if (length == 0.0f) continue;
+
+        axis = axis + n;
+        normals.push_back(n * (1.0f / length));
+    }
+
+    meshlet.cone_axis = Vector3f();
+    meshlet.cone_cutoff = 1.0f;
+
+    const float axis_length = Length(axis);
+    if (normals.empty() || axis_length == 0.0f) return;
+    axis = axis * (1.0f / axis_length);
+
+    float min_dot = 1.0f;
+    for (const auto& n : normals) {
+        float d;
+        DotProduct(d, n, axis);
+        min_dot = min(min_dot, d);
+    }
+
+    if (min_dot <= kMinConeDot) return;
+
+    meshlet.cone_axis = axis;
+    meshlet.cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+}
+}  // namespace
+
+vector<Meshlet> My::BuildMeshlets(vector<uint32_t>& indices,
+                                  const float* positions,
+                                  const size_t vertex_count,
+                                  const size_t position_stride,
+                                  const size_t max_vertices,
+                                  const size_t max_triangles) {
+    assert(indices.size() % 3 == 0);
+    assert(max_vertices >= 3 && max_triangles >= 1);
+
+    const size_t triangle_count = indices.size() / 3;
+
+    // vertex -> triangle adjacency
+    vector<uint32_t> triangle_offsets(vertex_count + 1, 0);
+    for (const auto index : indices) {
+        triangle_offsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+        triangle_offsets[v + 1] += triangle_offsets[v];
+    }
+    vector<uint32_t> adjacent_triangles(indices.size());
+    {
+        vector<uint32_t> cursor(triangle_offsets.begin(),
+                                triangle_offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacent_triangles[cursor[indices[i]]++] =
+                static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    vector<bool> emitted(triangle_count, false);
+    // the meshlet a vertex was last added to
+    vector<uint32_t> vertex_meshlet(vertex_count, ~0u);
+    vector<uint32_t> meshlet_vertices;
+    vector<uint32_t> candidates;
+
+    vector<uint32_t> result;
+    result.reserve(indices.size());
+    vector<Meshlet> meshlets;
+
+    size_t seed = 0;
+    size_t emitted_count = 0;
+
+    while (emitted_count < triangle_count) {
+        const auto meshlet_index = static_cast<uint32_t>(meshlets.size());
+
+        Meshlet meshlet;
+        meshlet.index_offset = static_cast<uint32_t>(result.size());
+        meshlet_vertices.clear();
+        candidates.clear();
+
+        // start from the first free triangle in the index buffer order, the
+        // index buffer is expected to be optimized for locality already
+        while (emitted[seed]) seed++;
+        auto triangle = static_cast<uint32_t>(seed);
+
+        while (true) {
+            emitted[triangle] = true;
+            emitted_count++;
+
+            for (size_t k = 0; k < 3; k++) {
+                const uint32_t v = indices[triangle * 3 + k];
+                result.push_back(v);
+
+                if (vertex_meshlet[v] != meshlet_index) {
+                    vertex_meshlet[v] = meshlet_index;
+                    meshlet_vertices.push_back(v);
+
+                    candidates.insert(
+                        candidates.end(),
+                        adjacent_triangles.begin() + triangle_offsets[v],
+                        adjacent_triangles.begin() + triangle_offsets[v + 1]);
+                }
+            }
+
+            meshlet.index_count += 3;
+            if (meshlet.index_count / 3 >= max_triangles) break;
+
+            // pick the candidate adding the fewest new vertices, the most
+            // recent candidates first
+            uint32_t best = ~0u;
+            uint32_t best_new_vertices = 4;
+            size_t write = 0;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                const uint32_t t = candidates[i];
+                if (emitted[t]) continue;
+                candidates[write++] = t;
+            }
+            candidates.resize(write);
+
+            for (auto it = candidates.rbegin(); it != candidates.rend();
+                 it++) {
+                const uint32_t t = *it;
+                uint32_t new_vertices = 0;
+                for (size_t k = 0; k < 3; k++) {
+                    if (vertex_meshlet[indices[t * 3 + k]] != meshlet_index) {
+                        new_vertices++;
+                    }
+                }
+
+                if (meshlet_vertices.size() + new_vertices > max_vertices)
+                    continue;
+
+                if (new_vertices < best_new_vertices) {
+                    best = t;
+                    best_new_vertices = new_vertices;
+                    if (new_vertices == 0) break;
+                }
+            }
+
+            if (best == ~0u) break;
+            triangle = best;
+        }
+
+        meshlet.vertex_count = static_cast<uint32_t>(meshlet_vertices.size());
+        compute_bounds(meshlet, &result[meshlet.index_offset],
+                       meshlet_vertices, positions, position_stride);
+
+        meshlets.push_back(meshlet);
+    }
+
+    indices = std::move(result);
+
+    return meshlets;
+}
+
+void My::ExtractFrustumPlanes(Vector4f planes[6], const Matrix4X4f& matrix) {
+    // clip = v * matrix, so every clip space component is a column
+    auto column = [&](const int32_t j) {
+        return Vector4f({matrix[0][j], matrix[1][j], matrix[2][j],
+                         matrix[3][j]});
+    };
+
+    const Vector4f x = column(0);
+    const Vector4f y = column(1);
+    const Vector4f z = column(2);
+    const Vector4f w = column(3);
+
+    planes[0] = w + x;  // left
+    planes[1] = w - x;  // right
+    planes[2] = w + y;  // bottom
+    planes[3] = w - y;  // top
+    // use -w <= z for the near plane, which is exact for the OpenGL depth
+    // range and conservative for the [0, 1] one
+    planes[4] = w + z;  // near
+    planes[5] = w - z;  // far
+
+    for (int32_t i = 0; i < 6; i++) {
+        const float length =
+            sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] +
+                  planes[i][2] * planes[i][2]);
+        if (length > 0.0f) {
+            planes[i] = planes[i] * (1.0f / length);
+        }
+    }
+}
+
+bool My::IsMeshletVisible(const Meshlet& meshlet, const Vector4f planes[6],
+                          const Vector3f& camera_position) {
+    for (int32_t i = 0; i < 6; i++) {
+        const float distance = planes[i][0] * meshlet.center[0] +
+                               planes[i][1] * meshlet.center[1] +
+                               planes[i][2] * meshlet.center[2] + planes[i][3];
+        if (distance < -meshlet.radius) return false;
+    }
+
+    // back facing cluster
+    const Vector3f view = meshlet.center - camera_position;
+    float d;
+    DotProduct(d, view, meshlet.cone_axis);
+    if (d >= meshlet.cone_cutoff * Length(view) + meshlet.radius) return false;
+
+    return true;
+}
+
+size_t My::CullMeshlets(vector<IndexRange>& ranges,
+                        const vector<Meshlet>& meshlets,
+                        const Matrix4X4f& model_view_projection,
+                        const Vector3f& camera_position) {
+    Vector4f planes[6];
+    ExtractFrustumPlanes(planes, model_view_projection);
+
+    ranges.clear();
+    size_t visible = 0;
+
+    for (const auto& meshlet : meshlets) {
+        if (!IsMeshletVisible(meshlet, planes, camera_position)) continue;
+
+        visible++;
+
+        // merge with the previous range if they are adjacent
+        if (!ranges.empty() && ranges.back().offset + ranges.back().count ==
+                                   meshlet.index_offset) {
+            ranges.back().count += meshlet.index_count;
+        } else {
+            ranges.push_back({meshlet.index_offset, meshlet.index_count});
+        }
+    }
+
+    return visible;
+}
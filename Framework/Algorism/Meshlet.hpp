@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "geommath.hpp"
+
+namespace My {
+constexpr size_t kMeshletMaxVertices = 64;
+constexpr size_t kMeshletMaxTriangles = 124;
+
+// A cluster of triangles, stored as a contiguous range of the index buffer
+// it was built from.
+struct Meshlet {
+    uint32_t index_offset{0};
+    uint32_t index_count{0};
+    uint32_t vertex_count{0};
+
+    // bounding sphere
+    Vector3f center;
+    float radius{0.0f};
+
+    // normal cone, the cluster faces away from every viewer inside the cone
+    // around -cone_axis. a zero axis means the cone is too wide to be used.
+    Vector3f cone_axis;
+    float cone_cutoff{1.0f};
+};
+
+// A range of the index buffer to draw
+struct IndexRange {
+    uint32_t offset{0};
+    uint32_t count{0};
+};
+
+// Splits a triangle list into meshlets of at most `max_vertices` unique
+// vertices and `max_triangles` triangles, growing each one greedily over
+// the triangles sharing vertices with it. `indices` is reordered in place
+// so that every meshlet is a contiguous range.
+std::vector<Meshlet> BuildMeshlets(
+    std::vector<uint32_t>& indices, const float* positions,
+    const size_t vertex_count, const size_t position_stride,
+    const size_t max_vertices = kMeshletMaxVertices,
+    const size_t max_triangles = kMeshletMaxTriangles);
+
+// Extracts the 6 frustum planes (a, b, c, d) of a row-vector
+// view-projection matrix. A point is inside if a*x + b*y + c*z + d >= 0
+// for every plane.
+void ExtractFrustumPlanes(Vector4f planes[6], const Matrix4X4f& matrix);
+
+// Conservative visibility test against the frustum and the normal cone.
+// The planes and the camera position are in the space of the meshlet.
+bool IsMeshletVisible(const Meshlet& meshlet, const Vector4f planes[6],
+                      const Vector3f& camera_position);
+
+// Culls the meshlets and merges the visible ones into as few index ranges
+// as possible. `model_view_projection` transforms the mesh to clip space and
+// `camera_position` is given in the space of the mesh.
+// Returns the number of visible meshlets.
+size_t CullMeshlets(std::vector<IndexRange>& ranges,
+                    const std::vector<Meshlet>& meshlets,
+                    const Matrix4X4f& model_view_projection,
+                    const Vector3f& camera_position);
+}  // namespace My
@@ -0,0 +1,428 @@
+#include "MipmapGenerator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "PixelConversion.hpp"
+#include "geommath.hpp"
+#include "portable.hpp"
+
+using namespace My;
+using namespace std;
+
+namespace {
+// texels of a level filtered by one job
+constexpr size_t kMinTexelsPerJob = 64 * 1024;
+// half of the support of the windowed sinc filters, in texels of the
+// smaller level
+constexpr float kFilterRadius = 3.0f;
+constexpr float kKaiserAlpha = 4.0f;
+
+float srgbToLinear(const float value) {
+    return value <= 0.04045f ? value / 12.92f
+                             : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(const float value) {
+    return value <= 0.0031308f ? value * 12.92f
+                               : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+struct SrgbTables {
+    float decode[256];
+    // the linear values half way between consecutive codes
+    float thresholds[255];
+
+    SrgbTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            decode[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+        }
+        for (uint32_t i = 0; i < 255; i++) {
+            thresholds[i] = srgbToLinear((static_cast<float>(i) + 0.5f) /
+                                         255.0f);
+        }
+    }
+
+    // the nearest code in the sRGB encoding
+    [[nodiscard]] uint8_t encode(const float value) const {
+        return static_cast<uint8_t>(
+            upper_bound(thresholds, thresholds + 255, value) - thresholds);
+    }
+};
+
+const SrgbTables& srgbTables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+// a row of texels to linear RGBA floats
+void decodeRow(const uint8_t* in, float* out, const uint32_t width,
+               const PixelLayout& layout, const bool srgb) {
+    DecodePixels(in, layout, out, width);
+    if (!srgb) return;
+    const float* srgb_decode = srgbTables().decode;
+    for (uint32_t x = 0; x < width; x++, out += 4) {
+        for (uint32_t c = 0; c < 3; c++) {
+            out[c] = layout.type == CHANNEL_TYPE::UNORM8
+                         ? srgb_decode[static_cast<uint32_t>(out[c] * 255.0f +
+                                                             0.5f)]
+                         : srgbToLinear(out[c]);
+        }
+    }
+}
+
+// linear RGBA floats to a row of texels, the alpha scaled by alpha_scale.
+// scratch holds a row of RGBA floats
+void encodeRow(const float* in, uint8_t* out, const uint32_t width,
+               const PixelLayout& layout, const bool srgb,
+               const float alpha_scale, float* scratch) {
+    if (!srgb && alpha_scale == 1.0f) {
+        EncodePixels(in, out, layout, width);
+        return;
+    }
+
+    const SrgbTables& tables = srgbTables();
+    for (uint32_t x = 0; x < width; x++) {
+        const float* rgba = in + (size_t)x * 4;
+        float* encoded = scratch + (size_t)x * 4;
+        for (uint32_t c = 0; c < 3; c++) {
+            if (!srgb) {
+                encoded[c] = rgba[c];
+            } else if (layout.type == CHANNEL_TYPE::UNORM8) {
+                // the nearest code, which EncodePixels rounds back to
+                encoded[c] = tables.encode(rgba[c]) / 255.0f;
+            } else {
+                encoded[c] = linearToSrgb(max(rgba[c], 0.0f));
+            }
+        }
+        encoded[3] = min(rgba[3] * alpha_scale, 1.0f);
+    }
+    EncodePixels(scratch, out, layout, width);
+}
+
+// the z of unit vectors from x and y
+void rebuildNormalZ(float* rgba, const uint32_t width) {
+    for (uint32_t x = 0; x < width; x++, rgba += 4) {
+        const float nx = rgba[0] * 2.0f - 1.0f;
+        const float ny = rgba[1] * 2.0f - 1.0f;
+        rgba[2] = 0.5f + 0.5f * sqrtf(max(0.0f, 1.0f - nx * nx - ny * ny));
+    }
+}
+
+void normalizeRow(float* rgba, const uint32_t width) {
+    for (uint32_t x = 0; x < width; x++, rgba += 4) {
+        float n[3] = {rgba[0] * 2.0f - 1.0f, rgba[1] * 2.0f - 1.0f,
+                      rgba[2] * 2.0f - 1.0f};
+        const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 1e-6f) {
+            for (float& v : n) v /= length;
+        } else {
+            n[0] = n[1] = 0.0f;
+            n[2] = 1.0f;
+        }
+        for (uint32_t c = 0; c < 3; c++) {
+            rgba[c] = n[c] * 0.5f + 0.5f;
+        }
+    }
+}
+
+float sinc(float x) {
+    if (fabsf(x) < 1e-6f) return 1.0f;
+    x *= static_cast<float>(PI);
+    return sinf(x) / x;
+}
+
+float besselI0(const float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int32_t k = 1; k < 32 && term > sum * 1e-8f; k++) {
+        const float half = x / (2.0f * k);
+        term *= half * half;
+        sum += term;
+    }
+    return sum;
+}
+
+float filterWeight(const MIPMAP_FILTER filter, const float t) {
+    const float distance = fabsf(t);
+    if (distance >= kFilterRadius) return 0.0f;
+    if (filter == MIPMAP_FILTER::Lanczos) {
+        return sinc(distance) * sinc(distance / kFilterRadius);
+    }
+    const float r = distance / kFilterRadius;
+    return sinc(distance) * besselI0(kKaiserAlpha * sqrtf(1.0f - r * r)) /
+           besselI0(kKaiserAlpha);
+}
+
+// the input texels and weights of every output texel along an axis, the
+// same count for each
+struct Taps {
+    int32_t count{0};
+    vector<int32_t> indices;
+    vector<float> weights;
+};
+
+Taps buildTaps(const uint32_t src, const uint32_t dst,
+               const MipmapOptions& options) {
+    const double scale = static_cast<double>(src) / dst;
+    vector<vector<pair<int32_t, float>>> texels(dst);
+    for (uint32_t x = 0; x < dst; x++) {
+        auto& taps = texels[x];
+        if (options.filter == MIPMAP_FILTER::Box) {
+            // the share of each input texel in the footprint
+            const double begin = x * scale;
+            const double end = (x + 1) * scale;
+            for (auto i = static_cast<int32_t>(floor(begin)); i < end; i++) {
+                const double weight = min(end, i + 1.0) - max(begin, (double)i);
+                if (weight > 0.0) taps.emplace_back(i, (float)weight);
+            }
+        } else {
+            const double center = (x + 0.5) * scale;
+            const double radius = kFilterRadius * scale;
+            for (auto i = static_cast<int32_t>(floor(center - radius));
+                 i <= static_cast<int32_t>(ceil(center + radius)); i++) {
+                const float weight = filterWeight(
+                    options.filter, (float)((i + 0.5 - center) / scale));
+                if (weight != 0.0f) taps.emplace_back(i, weight);
+            }
+        }
+
+        float sum = 0.0f;
+        for (auto& tap : taps) {
+            sum += tap.second;
+            tap.first = options.wrap
+                            ? ((tap.first % (int32_t)src) + (int32_t)src) %
+                                  (int32_t)src
+                            : clamp(tap.first, 0, (int32_t)src - 1);
+        }
+        for (auto& tap : taps) {
+            tap.second /= sum;
+        }
+    }
+
+    Taps result;
+    for (const auto& taps : texels) {
+        result.count = max(result.count, (int32_t)taps.size());
+    }
+    // padded with texel 0 weighted 0
+    result.indices.resize((size_t)dst * result.count, 0);
+    result.weights.resize((size_t)dst * result.count, 0.0f);
+    for (uint32_t x = 0; x < dst; x++) {
+        for (size_t k = 0; k < texels[x].size(); k++) {
+            result.indices[x * result.count + k] = texels[x][k].first;
+            result.weights[x * result.count + k] = texels[x][k].second;
+        }
+    }
+    return result;
+}
+
+// calls function(begin, end) for bands of rows, concurrently when the level
+// is large enough
+void forEachBand(const uint32_t rows, const uint32_t width,
+                 const function<void(uint32_t, uint32_t)>& function) {
+    const uint32_t job_count = (uint32_t)min<size_t>(
+        {max(1u, thread::hardware_concurrency()), rows,
+         (size_t)rows * width / kMinTexelsPerJob});
+    if (job_count <= 1) {
+        function(0, rows);
+        return;
+    }
+
+    vector<future<void>> jobs;
+    jobs.reserve(job_count);
+    for (uint32_t i = 0; i < job_count; i++) {
+        jobs.push_back(async(launch::async, function,
+                             (uint32_t)((uint64_t)rows * i / job_count),
+                             (uint32_t)((uint64_t)rows * (i + 1) / job_count)));
+    }
+    for (auto& job : jobs) {
+        job.get();
+    }
+}
+
+// the alpha scale that lets count texels of the level pass the reference
+float alphaScale(const vector<float>& texels, const size_t count,
+                 const float reference) {
+    const size_t texel_count = texels.size() / 4;
+    if (!count) return 1.0f;
+    vector<float> alphas(texel_count);
+    for (size_t i = 0; i < texel_count; i++) {
+        alphas[i] = texels[i * 4 + 3];
+    }
+    const auto nth = alphas.begin() + (min(count, texel_count) - 1);
+    nth_element(alphas.begin(), nth, alphas.end(), greater<>());
+    return *nth > 0.0f ? reference / *nth : 1.0f;
+}
+}  // namespace
+
+bool My::GenerateMipmaps(Image& image, const MipmapOptions& options) {
+    PixelLayout layout;
+    if (!image.data || !image.Width || !image.Height ||
+        !GetPixelLayout(image, layout)) {
+        return false;
+    }
+
+    uint32_t levels = 1;
+    while ((max(image.Width, image.Height) >> levels) > 0) levels++;
+    if (options.max_levels) levels = min(levels, options.max_levels);
+
+    const bool srgb = options.srgb && layout.type != CHANNEL_TYPE::HALF &&
+                      layout.type != CHANNEL_TYPE::FLOAT;
+    const bool normal_map = options.normal_map && layout.channels >= 2;
+    const bool keep_coverage =
+        options.alpha_reference > 0.0f && layout.channels == 4;
+
+    // level 0 of every face of every layer
+    const uint32_t subresources = image.face_count * image.array_size;
+    vector<Image::Mipmap> sources;
+    for (uint32_t i = 0; i < subresources; i++) {
+        sources.push_back(image.mipmaps.empty()
+                              ? Image::Mipmap(image.Width, image.Height,
+                                              image.pitch, 0, image.data_size)
+                              : image.mipmaps[i * image.GetMipLevels()]);
+    }
+
+    vector<Image::Mipmap> mipmaps;
+    size_t data_size = 0;
+    for (uint32_t i = 0; i < subresources; i++) {
+        for (uint32_t level = 0; level < levels; level++) {
+            const uint32_t width = max(1u, image.Width >> level);
+            const uint32_t height = max(1u, image.Height >> level);
+            const size_t pitch = ALIGN((size_t)width * layout.bytes, 4);
+            mipmaps.emplace_back(width, height, pitch, data_size,
+                                 pitch * height);
+            data_size += pitch * height;
+        }
+    }
+    auto* data = new uint8_t[data_size]();
+
+    for (uint32_t i = 0; i < subresources; i++) {
+        const Image::Mipmap& source = sources[i];
+        const uint8_t* pSource = image.data + source.offset;
+        const size_t row_size = (size_t)image.Width * layout.bytes;
+
+        // level 0 as is
+        const Image::Mipmap& top = mipmaps[(size_t)i * levels];
+        for (uint32_t y = 0; y < image.Height; y++) {
+            memcpy(data + top.offset + y * top.pitch,
+                   pSource + y * source.pitch, row_size);
+        }
+
+        const auto decode = [&](const uint32_t y, float* row) {
+            decodeRow(pSource + y * source.pitch, row, image.Width, layout,
+                      srgb);
+            if (normal_map && layout.channels == 2) {
+                rebuildNormalZ(row, image.Width);
+            }
+        };
+
+        // the texels of level 0 passing the alpha test
+        double coverage = 0.0;
+        if (keep_coverage) {
+            atomic<size_t> passed{0};
+            forEachBand(image.Height, image.Width,
+                        [&](const uint32_t begin, const uint32_t end) {
+                            vector<float> row((size_t)image.Width * 4);
+                            size_t count = 0;
+                            for (uint32_t y = begin; y < end; y++) {
+                                decode(y, row.data());
+                                for (uint32_t x = 0; x < image.Width; x++) {
+                                    count += row[x * 4 + 3] >=
+                                             options.alpha_reference;
+                                }
+                            }
+                            passed += count;
+                        });
+            coverage = (double)passed / ((double)image.Width * image.Height);
+        }
+
+        // each level filtered from the previous one, level 0 decoded as
+        // the rows are needed
+        vector<float> current;
+        vector<float> next;
+        for (uint32_t level = 1; level < levels; level++) {
+            const Image::Mipmap& mip = mipmaps[(size_t)i * levels + level];
+            const uint32_t src_width = max(1u, image.Width >> (level - 1));
+            const uint32_t src_height = max(1u, image.Height >> (level - 1));
+            const uint32_t width = mip.Width;
+            const uint32_t height = mip.Height;
+            const Taps columns = buildTaps(src_width, width, options);
+            const Taps rows = buildTaps(src_height, height, options);
+
+            next.assign((size_t)width * height * 4, 0.0f);
+            forEachBand(height, width, [&](const uint32_t begin,
+                                           const uint32_t end) {
+                // the input rows the band needs, filtered horizontally
+                vector<int32_t> slots(src_height, -1);
+                int32_t slot_count = 0;
+                for (size_t k = (size_t)begin * rows.count;
+                     k < (size_t)end * rows.count; k++) {
+                    if (slots[rows.indices[k]] < 0) {
+                        slots[rows.indices[k]] = slot_count++;
+                    }
+                }
+                vector<float> filtered((size_t)slot_count * width * 4);
+                vector<float> decoded(level == 1 ? (size_t)src_width * 4 : 0);
+                for (uint32_t y = 0; y < src_height; y++) {
+                    if (slots[y] < 0) continue;
+                    const float* row;
+                    if (level == 1) {
+                        decode(y, decoded.data());
+                        row = decoded.data();
+                    } else {
+                        row = current.data() + (size_t)y * src_width * 4;
+                    }
+                    ResampleRowRGBAf(
+                        row, filtered.data() + (size_t)slots[y] * width * 4,
+                        (int32_t)width, columns.indices.data(),
+                        columns.weights.data(), columns.count);
+                }
+
+                for (uint32_t y = begin; y < end; y++) {
+                    float* out = next.data() + (size_t)y * width * 4;
+                    for (int32_t k = 0; k < rows.count; k++) {
+                        const size_t tap = (size_t)y * rows.count + k;
+                        AccumulateRowf(filtered.data() +
+                                           (size_t)slots[rows.indices[tap]] *
+                                               width * 4,
+                                       rows.weights[tap], out,
+                                       (int32_t)width * 4);
+                    }
+                    if (normal_map) normalizeRow(out, width);
+                }
+            });
+
+            const float alpha_scale =
+                keep_coverage
+                    ? alphaScale(next,
+                                 (size_t)llround(coverage * width * height),
+                                 options.alpha_reference)
+                    : 1.0f;
+            forEachBand(height, width, [&](const uint32_t begin,
+                                           const uint32_t end) {
+                vector<float> scratch((size_t)width * 4);
+                for (uint32_t y = begin; y < end; y++) {
+                    encodeRow(next.data() + (size_t)y * width * 4,
+                              data + mip.offset + y * mip.pitch, width,
+                              layout, srgb, alpha_scale, scratch.data());
+                }
+            });
+
+            current.swap(next);
+        }
+    }
+
+    image.ReleaseData();
+    image.data = data;
+    image.data_size = data_size;
+    image.pitch = mipmaps[0].pitch;
+    image.mipmaps = std::move(mipmaps);
+
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+#include "Image.hpp"
+
+namespace My {
+enum class MIPMAP_FILTER : uint8_t { Box, Kaiser, Lanczos };
+
+struct MipmapOptions {
+    MIPMAP_FILTER filter{MIPMAP_FILTER::Kaiser};
+    // the color channels are sRGB encoded, filtered as linear light
+    bool srgb{false};
+    // the levels keep the share of texels with an alpha above this
+    // reference that level 0 has, so alpha tested cut-outs do not fade out
+    // with the distance. 0 to filter the alpha as is
+    float alpha_reference{0.0f};
+    // the color channels are unit vectors biased to [0, 1], renormalized on
+    // every level. z is rebuilt for 2 channel images
+    bool normal_map{false};
+    // the texture repeats, so the filter wraps around the edges instead of
+    // clamping
+    bool wrap{true};
+    // 0 for a full chain down to 1x1
+    uint32_t max_levels{0};
+};
+
+// Replaces the levels of every face and layer of an uncompressed image with
+// a chain filtered down from level 0, one level from the previous one in
+// float. The rows are 4 byte aligned and the subresources laid out like in
+// a DDS file. Every level is split in bands of rows filtered concurrently.
+// Returns false and leaves the image untouched for compressed, depth and
+// unknown formats.
+bool GenerateMipmaps(Image& image, const MipmapOptions& options = {});
+}  // namespace My
@@ -0,0 +1,440 @@
+#include "PixelConversion.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "portable.hpp"
+
+using namespace My;
+using namespace std;
+
+namespace {
+// pixels converted through floats at a time, 4KB of floats on the stack
+constexpr uint32_t kChunkSize = 256;
+
+bool isPacked(const CHANNEL_TYPE type) {
+    return type == CHANNEL_TYPE::R10G10B10A2 || type == CHANNEL_TYPE::R5G6B5;
+}
+
+// the bits of 1 in a channel
+uint32_t channelOne(const CHANNEL_TYPE type) {
+    switch (type) {
+        case CHANNEL_TYPE::UNORM8:
+            return 0xFF;
+        case CHANNEL_TYPE::UNORM16:
+            return 0xFFFF;
+        case CHANNEL_TYPE::HALF:
+            return 0x3C00;
+        default:
+            return 0x3F800000;  // 1.0f
+    }
+}
+
+// Channel counts known at compile time. Channels are moved one at a time,
+// through a pixel sized buffer the stores would not forward to its load.
+template <typename T, uint32_t S, uint32_t D>
+void swizzle(const uint8_t* src, uint8_t* dst, const int8_t map[4],
+             const T one, const uint32_t count) {
+    // the channels in order, the missing ones 0 and alpha 1, as when
+    // ConvertPixels adds or drops channels
+    bool in_order = true;
+    for (uint32_t c = 0; c < D; c++) {
+        in_order &= map[c] == (c < S ? int8_t(c)
+                                     : (c == 3 ? kSwizzleOne : kSwizzleZero));
+    }
+    if (in_order) {
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint32_t c = 0; c < D; c++) {
+                T value = c == 3 ? one : T(0);
+                if (c < S) memcpy(&value, src + c * sizeof(T), sizeof(T));
+                memcpy(dst + c * sizeof(T), &value, sizeof(T));
+            }
+            src += S * sizeof(T);
+            dst += D * sizeof(T);
+        }
+        return;
+    }
+
+    int32_t index[D];
+    T constant[D];
+    for (uint32_t c = 0; c < D; c++) {
+        index[c] = map[c];
+        constant[c] = map[c] == kSwizzleOne ? one : T(0);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t c = 0; c < D; c++) {
+            T value = constant[c];
+            if (index[c] >= 0) {
+                memcpy(&value, src + index[c] * sizeof(T), sizeof(T));
+            }
+            memcpy(dst + c * sizeof(T), &value, sizeof(T));
+        }
+        src += S * sizeof(T);
+        dst += D * sizeof(T);
+    }
+}
+
+template <typename T, uint32_t S>
+void swizzle(const uint8_t* src, uint8_t* dst, const uint32_t dst_channels,
+             const int8_t map[4], const T one, const uint32_t count) {
+    switch (dst_channels) {
+        case 1:
+            swizzle<T, S, 1>(src, dst, map, one, count);
+            break;
+        case 2:
+            swizzle<T, S, 2>(src, dst, map, one, count);
+            break;
+        case 3:
+            swizzle<T, S, 3>(src, dst, map, one, count);
+            break;
+        default:
+            swizzle<T, S, 4>(src, dst, map, one, count);
+    }
+}
+
+template <typename T>
+void swizzle(const uint8_t* src, const uint32_t src_channels, uint8_t* dst,
+             const uint32_t dst_channels, const int8_t map[4], const T one,
+             const uint32_t count) {
+    switch (src_channels) {
+        case 1:
+            swizzle<T, 1>(src, dst, dst_channels, map, one, count);
+            break;
+        case 2:
+            swizzle<T, 2>(src, dst, dst_channels, map, one, count);
+            break;
+        case 3:
+            swizzle<T, 3>(src, dst, dst_channels, map, one, count);
+            break;
+        default:
+            swizzle<T, 4>(src, dst, dst_channels, map, one, count);
+    }
+}
+
+template <typename T>
+void insert(const uint8_t* src, const uint32_t src_channels,
+            const uint32_t src_channel, uint8_t* dst,
+            const uint32_t dst_channels, const uint32_t dst_channel,
+            const uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(dst + (i * dst_channels + dst_channel) * sizeof(T),
+               src + (i * src_channels + src_channel) * sizeof(T), sizeof(T));
+    }
+}
+
+void decodePacked(const uint8_t* src, const CHANNEL_TYPE type, float* rgba,
+                  const uint32_t count) {
+    for (uint32_t i = 0; i < count; i++, rgba += 4) {
+        if (type == CHANNEL_TYPE::R10G10B10A2) {
+            uint32_t value;
+            memcpy(&value, src + i * 4, sizeof(value));
+            rgba[0] = (value & 0x3FF) / 1023.0f;
+            rgba[1] = ((value >> 10) & 0x3FF) / 1023.0f;
+            rgba[2] = ((value >> 20) & 0x3FF) / 1023.0f;
+            rgba[3] = (value >> 30) / 3.0f;
+        } else {
+            uint16_t value;
+            memcpy(&value, src + i * 2, sizeof(value));
+            rgba[0] = (value >> 11) / 31.0f;
+            rgba[1] = ((value >> 5) & 0x3F) / 63.0f;
+            rgba[2] = (value & 0x1F) / 31.0f;
+            rgba[3] = 1.0f;
+        }
+    }
+}
+
+uint32_t quantize(const float value, const uint32_t max) {
+    const float low = value > 0.0f ? value : 0.0f;
+    return static_cast<uint32_t>(min(low, 1.0f) * max + 0.5f);
+}
+
+void encodePacked(const float* rgba, uint8_t* dst, const CHANNEL_TYPE type,
+                  const uint32_t count) {
+    for (uint32_t i = 0; i < count; i++, rgba += 4) {
+        if (type == CHANNEL_TYPE::R10G10B10A2) {
+            const uint32_t value =
+                quantize(rgba[0], 1023) | (quantize(rgba[1], 1023) << 10) |
+                (quantize(rgba[2], 1023) << 20) | (quantize(rgba[3], 3) << 30);
+            memcpy(dst + i * 4, &value, sizeof(value));
+        } else {
+            const auto value = static_cast<uint16_t>(
+                (quantize(rgba[0], 31) << 11) | (quantize(rgba[1], 63) << 5) |
+                quantize(rgba[2], 31));
+            memcpy(dst + i * 2, &value, sizeof(value));
+        }
+    }
+}
+
+// count values of the channel type from floats
+void encodeChannels(const float* src, uint8_t* dst, const CHANNEL_TYPE type,
+                    const int32_t count) {
+    switch (type) {
+        case CHANNEL_TYPE::UNORM8:
+            ConvertFloatToUnorm8(src, dst, count);
+            break;
+        case CHANNEL_TYPE::UNORM16:
+            ConvertFloatToUnorm16(src, reinterpret_cast<uint16_t*>(dst), count);
+            break;
+        case CHANNEL_TYPE::HALF:
+            ConvertFloatToHalf(src, reinterpret_cast<uint16_t*>(dst), count);
+            break;
+        default:
+            memcpy(dst, src, (size_t)count * sizeof(float));
+    }
+}
+}  // namespace
+
+bool My::GetPixelLayout(const PIXEL_FORMAT format, const bool is_float,
+                        PixelLayout& layout) {
+    uint32_t channels;
+    CHANNEL_TYPE type;
+    switch (format) {
+        case PIXEL_FORMAT::R8:
+        case PIXEL_FORMAT::RG8:
+        case PIXEL_FORMAT::RGB8:
+        case PIXEL_FORMAT::RGBA8:
+            channels = static_cast<uint32_t>(format) -
+                       static_cast<uint32_t>(PIXEL_FORMAT::R8) + 1;
+            type = CHANNEL_TYPE::UNORM8;
+            break;
+        case PIXEL_FORMAT::R16:
+        case PIXEL_FORMAT::RG16:
+        case PIXEL_FORMAT::RGB16:
+        case PIXEL_FORMAT::RGBA16:
+            channels = static_cast<uint32_t>(format) -
+                       static_cast<uint32_t>(PIXEL_FORMAT::R16) + 1;
+            type = is_float ? CHANNEL_TYPE::HALF : CHANNEL_TYPE::UNORM16;
+            break;
+        case PIXEL_FORMAT::R32:
+        case PIXEL_FORMAT::RG32:
+        case PIXEL_FORMAT::RGB32:
+        case PIXEL_FORMAT::RGBA32:
+            channels = static_cast<uint32_t>(format) -
+                       static_cast<uint32_t>(PIXEL_FORMAT::R32) + 1;
+            type = CHANNEL_TYPE::FLOAT;
+            break;
+        case PIXEL_FORMAT::R10G10B10A2:
+            layout = {CHANNEL_TYPE::R10G10B10A2, 4, 4};
+            return true;
+        case PIXEL_FORMAT::R5G6B5:
+            layout = {CHANNEL_TYPE::R5G6B5, 3, 2};
+            return true;
+        default:
+            return false;
+    }
+
+    const uint32_t channel_size = type == CHANNEL_TYPE::UNORM8   ? 1
+                                  : type == CHANNEL_TYPE::FLOAT ? 4
+                                                                : 2;
+    layout = {type, channels, channels * channel_size};
+    return true;
+}
+
+void My::DecodePixels(const uint8_t* src, const PixelLayout& layout,
+                      float* rgba, const uint32_t count) {
+    if (isPacked(layout.type)) {
+        decodePacked(src, layout.type, rgba, count);
+        return;
+    }
+
+    // the channels land at the end of rgba and are spread from the front,
+    // each pixel read before its slot is written
+    const uint32_t channels = layout.channels;
+    float* values = rgba + (size_t)count * (4 - channels);
+    const auto total = static_cast<int32_t>(count * channels);
+    switch (layout.type) {
+        case CHANNEL_TYPE::UNORM8:
+            ConvertUnorm8ToFloat(src, values, total);
+            break;
+        case CHANNEL_TYPE::UNORM16:
+            ConvertUnorm16ToFloat(reinterpret_cast<const uint16_t*>(src),
+                                  values, total);
+            break;
+        case CHANNEL_TYPE::HALF:
+            ConvertHalfToFloat(reinterpret_cast<const uint16_t*>(src), values,
+                               total);
+            break;
+        default:
+            memmove(values, src, (size_t)total * sizeof(float));
+    }
+
+    if (channels == 4) return;
+    for (uint32_t i = 0; i < count; i++) {
+        const float* pixel = values + i * channels;
+        const float r = pixel[0];
+        const float g = channels > 1 ? pixel[1] : 0.0f;
+        const float b = channels > 2 ? pixel[2] : 0.0f;
+        rgba[i * 4] = r;
+        rgba[i * 4 + 1] = g;
+        rgba[i * 4 + 2] = b;
+        rgba[i * 4 + 3] = 1.0f;
+    }
+}
+
+void My::EncodePixels(const float* rgba, uint8_t* dst,
+                      const PixelLayout& layout, const uint32_t count) {
+    if (isPacked(layout.type)) {
+        encodePacked(rgba, dst, layout.type, count);
+        return;
+    }
+
+    const uint32_t channels = layout.channels;
+    if (channels == 4) {
+        encodeChannels(rgba, dst, layout.type,
+                       static_cast<int32_t>(count * 4));
+        return;
+    }
+
+    // the channels kept gathered a chunk at a time
+    float values[kChunkSize * 4];
+    for (uint32_t begin = 0; begin < count; begin += kChunkSize) {
+        const uint32_t n = min(kChunkSize, count - begin);
+        for (uint32_t i = 0; i < n; i++) {
+            for (uint32_t c = 0; c < channels; c++) {
+                values[i * channels + c] = rgba[(size_t)(begin + i) * 4 + c];
+            }
+        }
+        encodeChannels(values, dst + (size_t)begin * layout.bytes,
+                       layout.type, static_cast<int32_t>(n * channels));
+    }
+}
+
+void My::ConvertPixels(const uint8_t* src, const PixelLayout& src_layout,
+                       uint8_t* dst, const PixelLayout& dst_layout,
+                       const uint32_t count) {
+    if (src_layout.type == dst_layout.type) {
+        if (src_layout.channels == dst_layout.channels) {
+            memcpy(dst, src, (size_t)count * src_layout.bytes);
+            return;
+        }
+        if (!isPacked(src_layout.type)) {
+            const int8_t map[4] = {
+                src_layout.channels > 0 ? int8_t(0) : kSwizzleZero,
+                src_layout.channels > 1 ? int8_t(1) : kSwizzleZero,
+                src_layout.channels > 2 ? int8_t(2) : kSwizzleZero,
+                src_layout.channels > 3 ? int8_t(3) : kSwizzleOne};
+            SwizzlePixels(src, src_layout, dst, dst_layout, map, count);
+            return;
+        }
+    }
+
+    float rgba[kChunkSize * 4];
+    for (uint32_t begin = 0; begin < count; begin += kChunkSize) {
+        const uint32_t n = min(kChunkSize, count - begin);
+        DecodePixels(src + (size_t)begin * src_layout.bytes, src_layout, rgba,
+                     n);
+        EncodePixels(rgba, dst + (size_t)begin * dst_layout.bytes, dst_layout,
+                     n);
+    }
+}
+
+bool My::SwizzlePixels(const uint8_t* src, const PixelLayout& src_layout,
+                       uint8_t* dst, const PixelLayout& dst_layout,
+                       const int8_t swizzle[4], const uint32_t count) {
+    if (src_layout.type != dst_layout.type || isPacked(src_layout.type)) {
+        return false;
+    }
+    for (uint32_t c = 0; c < dst_layout.channels; c++) {
+        if (swizzle[c] >= (int8_t)src_layout.channels ||
+            swizzle[c] < kSwizzleOne) {
+            return false;
+        }
+    }
+
+    const uint32_t one = channelOne(src_layout.type);
+    switch (src_layout.type) {
+        case CHANNEL_TYPE::UNORM8:
+            ::swizzle<uint8_t>(src, src_layout.channels, dst,
+                               dst_layout.channels, swizzle,
+                               static_cast<uint8_t>(one), count);
+            break;
+        case CHANNEL_TYPE::UNORM16:
+        case CHANNEL_TYPE::HALF:
+            ::swizzle<uint16_t>(src, src_layout.channels, dst,
+                                dst_layout.channels, swizzle,
+                                static_cast<uint16_t>(one), count);
+            break;
+        default:
+            ::swizzle<uint32_t>(src, src_layout.channels, dst,
+                                dst_layout.channels, swizzle, one, count);
+    }
+    return true;
+}
+
+bool My::InsertChannel(const uint8_t* src, const PixelLayout& src_layout,
+                       const uint32_t src_channel, uint8_t* dst,
+                       const PixelLayout& dst_layout,
+                       const uint32_t dst_channel, const uint32_t count) {
+    if (src_layout.type != dst_layout.type || isPacked(src_layout.type) ||
+        src_channel >= src_layout.channels ||
+        dst_channel >= dst_layout.channels) {
+        return false;
+    }
+
+    switch (src_layout.type) {
+        case CHANNEL_TYPE::UNORM8:
+            insert<uint8_t>(src, src_layout.channels, src_channel, dst,
+                            dst_layout.channels, dst_channel, count);
+            break;
+        case CHANNEL_TYPE::UNORM16:
+        case CHANNEL_TYPE::HALF:
+            insert<uint16_t>(src, src_layout.channels, src_channel, dst,
+                             dst_layout.channels, dst_channel, count);
+            break;
+        default:
+            insert<uint32_t>(src, src_layout.channels, src_channel, dst,
+                             dst_layout.channels, dst_channel, count);
+    }
+    return true;
+}
+
+bool My::ConvertImage(Image& image, const PIXEL_FORMAT format,
+                      const bool is_float) {
+    PixelLayout src_layout;
+    PixelLayout dst_layout;
+    if (!image.data || !GetPixelLayout(image, src_layout) ||
+        !GetPixelLayout(format, is_float, dst_layout)) {
+        return false;
+    }
+
+    // every level of every face and layer
+    const vector<Image::Mipmap> sources =
+        image.mipmaps.empty()
+            ? vector<Image::Mipmap>{Image::Mipmap(image.Width, image.Height,
+                                                  image.pitch, 0,
+                                                  image.data_size)}
+            : image.mipmaps;
+    vector<Image::Mipmap> mipmaps;
+    size_t data_size = 0;
+    for (const auto& source : sources) {
+        const size_t pitch = ALIGN((size_t)source.Width * dst_layout.bytes, 4);
+        mipmaps.emplace_back(source.Width, source.Height, pitch, data_size,
+                             pitch * source.Height);
+        data_size += pitch * source.Height;
+    }
+
+    auto* data = new uint8_t[data_size]();
+    for (size_t i = 0; i < sources.size(); i++) {
+        for (uint32_t y = 0; y < sources[i].Height; y++) {
+            ConvertPixels(image.data + sources[i].offset + y * sources[i].pitch,
+                          src_layout,
+                          data + mipmaps[i].offset + y * mipmaps[i].pitch,
+                          dst_layout, sources[i].Width);
+        }
+    }
+
+    image.ReleaseData();
+    image.data = data;
+    image.data_size = data_size;
+    image.pitch = mipmaps[0].pitch;
+    image.bitcount = static_cast<uint16_t>(dst_layout.bytes * 8);
+    image.bitdepth = static_cast<uint16_t>(
+        isPacked(dst_layout.type) ? image.bitcount
+                                  : image.bitcount / dst_layout.channels);
+    image.pixel_format = format;
+    image.is_float = dst_layout.type == CHANNEL_TYPE::HALF ||
+                     dst_layout.type == CHANNEL_TYPE::FLOAT;
+    if (!image.mipmaps.empty()) image.mipmaps = std::move(mipmaps);
+    return true;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+
+#include "Image.hpp"
+#include "geommath.hpp"
+
+namespace My {
+// how the channels of a pixel are stored. 32-bit channels are float
+enum class CHANNEL_TYPE : uint8_t {
+    UNORM8,
+    UNORM16,
+    HALF,
+    FLOAT,
+    R10G10B10A2,  // one 32-bit word, R in the low bits
+    R5G6B5        // one 16-bit word, R in the high bits
+};
+
+struct PixelLayout {
+    CHANNEL_TYPE type{CHANNEL_TYPE::UNORM8};
+    uint32_t channels{0};
+    uint32_t bytes{0};  // per pixel
+};
+
+// The layout of an uncompressed pixel format, the 16-bit channels half when
+// is_float. Returns false for depth and unknown formats.
+bool GetPixelLayout(PIXEL_FORMAT format, bool is_float, PixelLayout& layout);
+
+inline bool GetPixelLayout(const Image& image, PixelLayout& layout) {
+    return !image.compressed &&
+           GetPixelLayout(image.pixel_format, image.is_float, layout);
+}
+
+// `count` bytes of unorm8 channels to floats in [0, 1]
+inline void ConvertUnorm8ToFloat(const uint8_t* src, float* dst,
+                                 const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertUnorm8ToFloat(src, dst, count);
+#else
+    Dummy::ConvertUnorm8ToFloat(src, dst, count);
+#endif
+}
+
+// the floats saturated to [0, 1] and rounded to nearest, NaN to 0
+inline void ConvertFloatToUnorm8(const float* src, uint8_t* dst,
+                                 const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertFloatToUnorm8(src, dst, count);
+#else
+    Dummy::ConvertFloatToUnorm8(src, dst, count);
+#endif
+}
+
+inline void ConvertUnorm16ToFloat(const uint16_t* src, float* dst,
+                                  const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertUnorm16ToFloat(src, dst, count);
+#else
+    Dummy::ConvertUnorm16ToFloat(src, dst, count);
+#endif
+}
+
+inline void ConvertFloatToUnorm16(const float* src, uint16_t* dst,
+                                  const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertFloatToUnorm16(src, dst, count);
+#else
+    Dummy::ConvertFloatToUnorm16(src, dst, count);
+#endif
+}
+
+// every half exactly, subnormals, infinities and NaN included
+inline void ConvertHalfToFloat(const uint16_t* src, float* dst,
+                               const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertHalfToFloat(src, dst, count);
+#else
+    Dummy::ConvertHalfToFloat(src, dst, count);
+#endif
+}
+
+// rounded to nearest even, overflowing to infinity
+inline void ConvertFloatToHalf(const float* src, uint16_t* dst,
+                               const int32_t count) {
+#ifdef USE_ISPC
+    ispc::ConvertFloatToHalf(src, dst, count);
+#else
+    Dummy::ConvertFloatToHalf(src, dst, count);
+#endif
+}
+
+// `count` pixels to RGBA floats, the missing channels 0 and alpha 1
+void DecodePixels(const uint8_t* src, const PixelLayout& layout, float* rgba,
+                  uint32_t count);
+
+// RGBA floats to `count` pixels, the extra channels dropped. Unorm channels
+// are saturated and rounded to nearest, halves to nearest even.
+void EncodePixels(const float* rgba, uint8_t* dst, const PixelLayout& layout,
+                  uint32_t count);
+
+// Converts `count` pixels between any two layouts with the semantics of
+// DecodePixels and EncodePixels. Layouts of the same channel type only move
+// the channels, the others go through floats a chunk at a time.
+void ConvertPixels(const uint8_t* src, const PixelLayout& src_layout,
+                   uint8_t* dst, const PixelLayout& dst_layout,
+                   uint32_t count);
+
+constexpr int8_t kSwizzleZero = -1;
+constexpr int8_t kSwizzleOne = -2;
+
+// Channel c of each dst pixel takes channel swizzle[c] of the src pixel, or
+// 0 or 1 for kSwizzleZero and kSwizzleOne. Both layouts have the same
+// channel type, neither packed. Returns false otherwise.
+bool SwizzlePixels(const uint8_t* src, const PixelLayout& src_layout,
+                   uint8_t* dst, const PixelLayout& dst_layout,
+                   const int8_t swizzle[4], uint32_t count);
+
+// Copies channel src_channel of `count` pixels into channel dst_channel of
+// the dst pixels, leaving their other channels as they are. Both layouts
+// have the same channel type, neither packed. Returns false otherwise.
+bool InsertChannel(const uint8_t* src, const PixelLayout& src_layout,
+                   uint32_t src_channel, uint8_t* dst,
+                   const PixelLayout& dst_layout, uint32_t dst_channel,
+                   uint32_t count);
+
+// Converts every subresource of an uncompressed image into another format,
+// the rows 4 byte aligned. Returns false when either format has no layout.
+bool ConvertImage(Image& image, PIXEL_FORMAT format, bool is_float);
+}  // namespace My
@@ -0,0 +1,327 @@
+#include "RenderGraph.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <map>
+#include <queue>
+
+using namespace My;
+using namespace std;
+
+uint32_t RenderGraph::AddResource(const RenderGraphResourceDesc& desc) {
+    Resource resource;
+    resource.desc = desc;
+    m_Resources.push_back(resource);
+    return static_cast<uint32_t>(m_Resources.size() - 1);
+}
+
+uint32_t RenderGraph::AddPass(const RenderGraphPassDesc& desc) {
+#ifndef NDEBUG
+    for (const auto& access : desc.reads) {
+        assert(access.resource < m_Resources.size());
+    }
+    for (const auto& access : desc.writes) {
+        assert(access.resource < m_Resources.size());
+    }
+#endif
+    Pass pass;
+    pass.desc = desc;
+    m_Passes.push_back(pass);
+    return static_cast<uint32_t>(m_Passes.size() - 1);
+}
+
+void RenderGraph::Clear() {
+    m_Passes.clear();
+    m_Resources.clear();
+    m_Order.clear();
+    m_PhysicalSizes.clear();
+}
+
+bool RenderGraph::Compile(const uint32_t canvas_width,
+                          const uint32_t canvas_height) {
+    m_Order.clear();
+    m_PhysicalSizes.clear();
+    for (auto& pass : m_Passes) {
+        pass.culled = false;
+        pass.dependencies.clear();
+        pass.waits.clear();
+        pass.barriers.clear();
+    }
+    for (auto& resource : m_Resources) {
+        resource.size = 0;
+        resource.lifetime = {kInvalidIndex, 0};
+        resource.physical = kInvalidIndex;
+    }
+
+    buildDependencies();
+    cullPasses();
+    if (!sortPasses()) {
+        m_Order.clear();
+        return false;
+    }
+    computeLifetimes(canvas_width, canvas_height);
+    aliasResources();
+    insertBarriers();
+
+    return true;
+}
+
+void RenderGraph::buildDependencies() {
+    auto writes = [](const Pass& pass, const uint32_t resource) {
+        return any_of(pass.desc.writes.begin(), pass.desc.writes.end(),
+                      [resource](const RenderGraphAccess& access) {
+                          return access.resource == resource;
+                      });
+    };
+
+    // writers of each resource, in the order the passes were added
+    vector<vector<uint32_t>> writers(m_Resources.size());
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        for (const auto& access : m_Passes[i].desc.writes) {
+            auto& list = writers[access.resource];
+            if (list.empty() || list.back() != i) list.push_back(i);
+        }
+    }
+
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        auto& pass = m_Passes[i];
+
+        // after the previous writer, which also covers passes modifying the
+        // resource in place
+        for (const auto& access : pass.desc.writes) {
+            const auto& list = writers[access.resource];
+            auto it = lower_bound(list.begin(), list.end(), i);
+            if (it != list.begin()) pass.dependencies.push_back(*(it - 1));
+        }
+
+        // after every writer
+        for (const auto& access : pass.desc.reads) {
+            if (writes(pass, access.resource)) continue;
+            for (const uint32_t writer : writers[access.resource]) {
+                pass.dependencies.push_back(writer);
+            }
+        }
+
+        sort(pass.dependencies.begin(), pass.dependencies.end());
+        pass.dependencies.erase(
+            unique(pass.dependencies.begin(), pass.dependencies.end()),
+            pass.dependencies.end());
+
+        for (const uint32_t dependency : pass.dependencies) {
+            if (m_Passes[dependency].desc.queue != pass.desc.queue) {
+                pass.waits.push_back(dependency);
+            }
+        }
+    }
+}
+
+void RenderGraph::cullPasses() {
+    // passes writing imported resources are what the frame is rendered for,
+    // passes writing nothing have side effects of their own
+    vector<uint32_t> stack;
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        const auto& writes = m_Passes[i].desc.writes;
+        if (writes.empty() ||
+            any_of(writes.begin(), writes.end(),
+                   [this](const RenderGraphAccess& access) {
+                       return m_Resources[access.resource].desc.imported;
+                   })) {
+            stack.push_back(i);
+        }
+    }
+
+    vector<bool> kept(m_Passes.size(), false);
+    while (!stack.empty()) {
+        const uint32_t i = stack.back();
+        stack.pop_back();
+        if (kept[i]) continue;
+        kept[i] = true;
+        for (const uint32_t dependency : m_Passes[i].dependencies) {
+            stack.push_back(dependency);
+        }
+    }
+
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        m_Passes[i].culled = !kept[i];
+    }
+}
+
+bool RenderGraph::sortPasses() {
+    vector<uint32_t> in_degree(m_Passes.size(), 0);
+    vector<vector<uint32_t>> dependents(m_Passes.size());
+    uint32_t kept_count = 0;
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        if (m_Passes[i].culled) continue;
+        kept_count++;
+        for (const uint32_t dependency : m_Passes[i].dependencies) {
+            dependents[dependency].push_back(i);
+            in_degree[i]++;
+        }
+    }
+
+    // Kahn's algorithm, the ready pass added first goes first so the order
+    // is stable
+    priority_queue<uint32_t, vector<uint32_t>, greater<uint32_t>> ready;
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        if (!m_Passes[i].culled && in_degree[i] == 0) ready.push(i);
+    }
+
+    while (!ready.empty()) {
+        const uint32_t i = ready.top();
+        ready.pop();
+        m_Order.push_back(i);
+        for (const uint32_t dependent : dependents[i]) {
+            if (--in_degree[dependent] == 0) ready.push(dependent);
+        }
+    }
+
+    return m_Order.size() == kept_count;
+}
+
+void RenderGraph::computeLifetimes(const uint32_t canvas_width,
+                                   const uint32_t canvas_height) {
+    for (auto& resource : m_Resources) {
+        const auto& desc = resource.desc;
+        const uint32_t width =
+            desc.width ? desc.width
+                       : std::max(1u, static_cast<uint32_t>(canvas_width *
+                                                            desc.scaleX));
+        const uint32_t height =
+            desc.height ? desc.height
+                        : std::max(1u, static_cast<uint32_t>(canvas_height *
+                                                             desc.scaleY));
+        resource.size = size_t(width) * height * desc.layers *
+                        desc.bytesPerPixel;
+    }
+
+    for (uint32_t position = 0; position < m_Order.size(); position++) {
+        const auto& desc = m_Passes[m_Order[position]].desc;
+        auto use = [&](const RenderGraphAccess& access) {
+            auto& lifetime = m_Resources[access.resource].lifetime;
+            if (lifetime.first == kInvalidIndex) lifetime.first = position;
+            lifetime.last = position;
+        };
+        for_each(desc.reads.begin(), desc.reads.end(), use);
+        for_each(desc.writes.begin(), desc.writes.end(), use);
+    }
+}
+
+void RenderGraph::aliasResources() {
+    vector<uint32_t> transients;
+    for (uint32_t i = 0; i < m_Resources.size(); i++) {
+        const auto& resource = m_Resources[i];
+        if (!resource.desc.imported &&
+            resource.lifetime.first != kInvalidIndex) {
+            transients.push_back(i);
+        }
+    }
+    stable_sort(transients.begin(), transients.end(),
+                [this](const uint32_t a, const uint32_t b) {
+                    return m_Resources[a].lifetime.first <
+                           m_Resources[b].lifetime.first;
+                });
+
+    // last position each allocation is used at
+    vector<uint32_t> busy_until;
+
+    for (const uint32_t i : transients) {
+        auto& resource = m_Resources[i];
+
+        // the smallest free allocation it fits in, otherwise the largest
+        // free one grows
+        uint32_t fit = kInvalidIndex;
+        uint32_t largest = kInvalidIndex;
+        for (uint32_t j = 0; j < m_PhysicalSizes.size(); j++) {
+            if (busy_until[j] >= resource.lifetime.first) continue;
+            const size_t size = m_PhysicalSizes[j];
+            if (size >= resource.size &&
+                (fit == kInvalidIndex || size < m_PhysicalSizes[fit])) {
+                fit = j;
+            }
+            if (largest == kInvalidIndex || size > m_PhysicalSizes[largest]) {
+                largest = j;
+            }
+        }
+
+        if (fit == kInvalidIndex) fit = largest;
+        if (fit == kInvalidIndex) {
+            fit = static_cast<uint32_t>(m_PhysicalSizes.size());
+            m_PhysicalSizes.push_back(0);
+            busy_until.push_back(0);
+        }
+
+        m_PhysicalSizes[fit] = std::max(m_PhysicalSizes[fit], resource.size);
+        busy_until[fit] = resource.lifetime.last;
+        resource.physical = fit;
+    }
+}
+
+void RenderGraph::insertBarriers() {
+    vector<RenderGraphResourceState> states(m_Resources.size());
+    for (uint32_t i = 0; i < m_Resources.size(); i++) {
+        states[i] = m_Resources[i].desc.initialState;
+    }
+
+    // resource each allocation currently holds
+    vector<uint32_t> occupants(m_PhysicalSizes.size(), kInvalidIndex);
+
+    for (const uint32_t i : m_Order) {
+        auto& pass = m_Passes[i];
+
+        // a resource written and read by the pass ends up in the state it is
+        // written in
+        map<uint32_t, RenderGraphResourceState> accesses;
+        for (const auto& access : pass.desc.reads) {
+            accesses[access.resource] = access.state;
+        }
+        for (const auto& access : pass.desc.writes) {
+            accesses[access.resource] = access.state;
+        }
+
+        for (const auto& [resource, state] : accesses) {
+            const uint32_t physical = m_Resources[resource].physical;
+            if (physical != kInvalidIndex && occupants[physical] != resource) {
+                const bool aliasing = occupants[physical] != kInvalidIndex;
+                occupants[physical] = resource;
+                pass.barriers.push_back({resource,
+                                         RenderGraphResourceState::Undefined,
+                                         state, aliasing});
+            } else if (states[resource] != state) {
+                pass.barriers.push_back(
+                    {resource, states[resource], state, false});
+            }
+            states[resource] = state;
+        }
+    }
+}
+
+size_t RenderGraph::GetTransientMemory() const {
+    size_t total = 0;
+    for (const size_t size : m_PhysicalSizes) {
+        total += size;
+    }
+    return total;
+}
+
+size_t RenderGraph::GetUnaliasedTransientMemory() const {
+    size_t total = 0;
+    for (const auto& resource : m_Resources) {
+        if (resource.physical != kInvalidIndex) total += resource.size;
+    }
+    return total;
+}
+
+uint32_t RenderGraph::FindPass(const string& name) const {
+    for (uint32_t i = 0; i < m_Passes.size(); i++) {
+        if (m_Passes[i].desc.name == name) return i;
+    }
+    return kInvalidIndex;
+}
+
+uint32_t RenderGraph::FindResource(const string& name) const {
+    for (uint32_t i = 0; i < m_Resources.size(); i++) {
+        if (m_Resources[i].desc.name == name) return i;
+    }
+    return kInvalidIndex;
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace My {
+// mirror the QueueType and ResourceState enums of
+// Asset/Schema/RenderDefinitions.fbs
+enum class RenderGraphQueue : uint8_t { Graphics, Compute, CopyTransfer };
+
+enum class RenderGraphResourceState : uint8_t {
+    Undefined,
+    RenderTarget,
+    DepthWrite,
+    ShaderRead,
+    UnorderedAccess,
+    CopySource,
+    CopyDest,
+    Present
+};
+
+// A texture of the graph, sized like the RenderTarget of the schema: a
+// width or height of 0 follows the canvas, times the scale.
+struct RenderGraphResourceDesc {
+    std::string name;
+    uint32_t width{0};
+    uint32_t height{0};
+    float scaleX{1.0f};
+    float scaleY{1.0f};
+    uint32_t layers{1};
+    uint32_t bytesPerPixel{4};
+    // lives outside of the graph, e.g. the back buffer or the shadow maps,
+    // so it is never aliased and keeps its contents between frames
+    bool imported{false};
+    RenderGraphResourceState initialState{RenderGraphResourceState::Undefined};
+};
+
+struct RenderGraphAccess {
+    uint32_t resource;
+    RenderGraphResourceState state;
+};
+
+// A pass reading a resource it does not write sees it after every pass
+// writing it. Passes writing the same resource run in the order they were
+// added.
+struct RenderGraphPassDesc {
+    std::string name;
+    RenderGraphQueue queue{RenderGraphQueue::Graphics};
+    std::vector<RenderGraphAccess> reads;
+    std::vector<RenderGraphAccess> writes;
+};
+
+// a transition before the pass, from the undefined state when the memory of
+// the resource held another resource before
+struct RenderGraphBarrier {
+    uint32_t resource;
+    RenderGraphResourceState before;
+    RenderGraphResourceState after;
+    bool aliasing{false};
+};
+
+// positions in the execution order of the first and the last pass using the
+// resource
+struct RenderGraphLifetime {
+    uint32_t first;
+    uint32_t last;
+};
+
+// Orders the passes of a frame from the resources they read and write,
+// culls the passes nothing depends on, places the transient resources in
+// shared memory when their lifetimes do not overlap and derives the
+// barriers between the passes.
+class RenderGraph {
+   public:
+    static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+    uint32_t AddResource(const RenderGraphResourceDesc& desc);
+    uint32_t AddPass(const RenderGraphPassDesc& desc);
+    void Clear();
+
+    // Returns false if the passes depend on each other in a cycle.
+    bool Compile(const uint32_t canvas_width, const uint32_t canvas_height);
+
+    // indices of the passes which are kept, in execution order
+    [[nodiscard]] const std::vector<uint32_t>& GetPassOrder() const {
+        return m_Order;
+    }
+    [[nodiscard]] const std::vector<RenderGraphBarrier>& GetBarriers(
+        const uint32_t pass) const {
+        return m_Passes[pass].barriers;
+    }
+    // passes on other queues the pass has to wait for
+    [[nodiscard]] const std::vector<uint32_t>& GetQueueWaits(
+        const uint32_t pass) const {
+        return m_Passes[pass].waits;
+    }
+    [[nodiscard]] bool IsCulled(const uint32_t pass) const {
+        return m_Passes[pass].culled;
+    }
+
+    [[nodiscard]] const RenderGraphResourceDesc& GetResourceDesc(
+        const uint32_t resource) const {
+        return m_Resources[resource].desc;
+    }
+    [[nodiscard]] RenderGraphLifetime GetLifetime(
+        const uint32_t resource) const {
+        return m_Resources[resource].lifetime;
+    }
+    [[nodiscard]] size_t GetResourceSize(const uint32_t resource) const {
+        return m_Resources[resource].size;
+    }
+    // allocation holding the transient resource, kInvalidIndex for imported
+    // and unused resources
+    [[nodiscard]] uint32_t GetPhysicalIndex(const uint32_t resource) const {
+        return m_Resources[resource].physical;
+    }
+    [[nodiscard]] size_t GetPhysicalCount() const {
+        return m_PhysicalSizes.size();
+    }
+    [[nodiscard]] size_t GetPhysicalSize(const uint32_t physical) const {
+        return m_PhysicalSizes[physical];
+    }
+
+    // memory of the transient resources with and without aliasing
+    [[nodiscard]] size_t GetTransientMemory() const;
+    [[nodiscard]] size_t GetUnaliasedTransientMemory() const;
+
+    [[nodiscard]] uint32_t FindPass(const std::string& name) const;
+    [[nodiscard]] uint32_t FindResource(const std::string& name) const;
+
+   private:
+    struct Pass {
+        RenderGraphPassDesc desc;
+        bool culled{false};
+        std::vector<uint32_t> dependencies;
+        std::vector<uint32_t> waits;
+        std::vector<RenderGraphBarrier> barriers;
+    };
+
+    struct Resource {
+        RenderGraphResourceDesc desc;
+        size_t size{0};
+        RenderGraphLifetime lifetime{kInvalidIndex, 0};
+        uint32_t physical{kInvalidIndex};
+    };
+
+    void buildDependencies();
+    void cullPasses();
+    bool sortPasses();
+    void computeLifetimes(const uint32_t canvas_width,
+                          const uint32_t canvas_height);
+    void aliasResources();
+    void insertBarriers();
+
+   private:
+    std::vector<Pass> m_Passes;
+    std::vector<Resource> m_Resources;
+    std::vector<uint32_t> m_Order;
+    std::vector<size_t> m_PhysicalSizes;
+};
+}  // namespace My
@@ -1,6 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <vector>
 
+#include "GfxConfiguration.hpp"
+#include "LightClusterGrid.hpp"
 #include "Scene.hpp"
 #include "cbuffer.h"
 
@@ -10,16 +13,138 @@ struct DrawFrameContext : PerFrameConstants, frame_textures {};
 struct DrawBatchContext : PerBatchConstants {
     int32_t batchIndex{0};
     std::shared_ptr<SceneGeometryNode> node;
+    // index array (index group) of the mesh the batch draws, the same in
+    // every level of detail
+    uint32_t indexGroup{0};
     material_textures material;
+    // ShaderVariantKey of the material in the forward pass, set by the
+    // back-ends which draw with the permutations. kBaseShaderVariant draws
+    // with the shader which samples every map
+    uint32_t shaderVariant{UINT32_MAX};
+
+    // level of detail selected for the current frame, never above the
+    // levels the back-end uploaded. Only OpenGL uploads the lower levels,
+    // D3D12, Metal and Vulkan keep lodCount at 1 and draw LOD 0
+    uint32_t lod{0};
+    uint32_t lodCount{1};
+    uint32_t triangleCount[GfxConfiguration::kMaxLodCount]{};
+    BoundingBox boundingBox;
+    // projected radius relative to half of the screen height
+    float screenSize{0.0f};
+
+    // hidden behind the occluders from the camera, still drawn into the
+    // shadow maps
+    bool occluded{false};
+
+    // the model matrix changed since the previous frame, the shadow maps it
+    // is drawn into have to be drawn again
+    bool moved{true};
+
+    // where the PerBatchConstants of the current frame were written in the
+    // constant buffer of the back-end. kInvalidConstantsOffset when they did
+    // not fit, and the batch is not drawn, or when the back-end has no
+    // GraphicsManager::m_pBatchConstantAllocator
+    static constexpr size_t kInvalidConstantsOffset = SIZE_MAX;
+    size_t constantsOffset{kInvalidConstantsOffset};
+
+    // clusters of LOD 0 and the ranges of them which survived culling,
+    // only valid when LOD 0 is selected
+    std::vector<Meshlet> meshlets;
+    std::vector<IndexRange> indexRanges;
 
     virtual ~DrawBatchContext() = default;
 };
 
+// A contiguous range [begin, end) of a list of batches
+struct BatchRange {
+    size_t begin{0};
+    size_t end{0};
+};
+
+// Splits `batch_count` batches into at most `max_ranges` ranges of at least
+// `min_batches_per_range` batches each (except when there are fewer
+// batches than that). The ranges are returned in batch order.
+inline std::vector<BatchRange> SplitBatchRanges(
+    const size_t batch_count, const size_t max_ranges,
+    const size_t min_batches_per_range) {
+    std::vector<BatchRange> ranges;
+    if (batch_count == 0) return ranges;
+
+    size_t range_count =
+        batch_count / std::max<size_t>(1, min_batches_per_range);
+    range_count =
+        std::clamp<size_t>(range_count, 1, std::max<size_t>(1, max_ranges));
+
+    // spread the remainder over the first ranges
+    const size_t base = batch_count / range_count;
+    const size_t remainder = batch_count % range_count;
+    size_t begin = 0;
+    for (size_t i = 0; i < range_count; i++) {
+        const size_t end = begin + base + (i < remainder ? 1 : 0);
+        ranges.push_back({begin, end});
+        begin = end;
+    }
+
+    return ranges;
+}
+
+// Batches drawn into a layer of the shadow map of a light, indices into the
+// batch contexts. A cached layer still holds from a previous frame and is
+// not drawn at all.
+struct ShadowCasterList {
+    int32_t lightIndex{0};
+    int32_t layer{0};
+    std::vector<uint32_t> batches;
+    bool cached{false};
+};
+
+// Batches drawn with the same permutation of the forward shader, indices
+// into the batch contexts in batch order
+struct ShaderVariantBatches {
+    uint32_t shaderVariant{UINT32_MAX};
+    std::vector<uint32_t> batches;
+};
+
+struct DrawStatistics {
+    uint32_t batchCount{0};
+    uint32_t triangleCount{0};
+    // what would have been drawn with LOD 0 everywhere
+    uint32_t fullDetailTriangleCount{0};
+    uint32_t meshletCount{0};
+    uint32_t culledMeshletCount{0};
+    uint32_t occluderCount{0};
+    uint32_t occludedBatchCount{0};
+    uint32_t lightCount{0};
+    uint32_t lightClusterIndexCount{0};
+    // light/batch pairs drawn into shadow maps, skipped because the batch is
+    // out of reach of the light and skipped because the map was cached
+    uint32_t shadowCasterCount{0};
+    uint32_t culledShadowCasterCount{0};
+    uint32_t cachedShadowCasterCount{0};
+    uint32_t cachedShadowMapCount{0};
+    // bytes of the render targets of the pool, now, once it settles and at
+    // most
+    size_t renderTargetMemory{0};
+    size_t steadyRenderTargetMemory{0};
+    size_t peakRenderTargetMemory{0};
+};
+
 struct Frame : global_textures {
     int32_t frameIndex{0};
     DrawFrameContext frameContext;
     std::vector<std::shared_ptr<DrawBatchContext>> batchContexts;
-    LightInfo lightInfo;
+    // every light of the scene, the shadow casters first so they are also
+    // in the MAX_LIGHTS uploaded as LightInfo
+    std::vector<Light> lights;
+    // lights of each cluster of the view frustum
+    std::vector<LightClusterRange> lightClusters;
+    std::vector<uint32_t> lightClusterIndices;
+    // one per shadow map layer to draw, in light order. The sun draws one
+    // per cascade.
+    std::vector<ShadowCasterList> shadowCasters;
+    // the batches grouped by DrawBatchContext::shaderVariant, in key order
+    std::vector<ShaderVariantBatches> shaderVariants;
+    DrawStatistics stats;
     Vector4f clearColor {0.2f, 0.3f, 0.4f, 1.0f};
     std::vector<Texture2D> colorTextures;
     Texture2D depthTexture;
@@ -43,8 +43,9 @@ struct GfxConfiguration {
     static const uint32_t kMaxSceneObjectCount{2048};
     static const uint32_t kMaxTexturePerMaterialCount{16};
     static const uint32_t kMaxShadowMapCount{8};
-    static const uint32_t kMaxGlobalShadowMapCount{1};
+    static const uint32_t kMaxGlobalShadowMapCount{4};  // cascades
     static const uint32_t kMaxCubeShadowMapCount{2};
+    static const uint32_t kMaxLodCount{4};
 
     static const uint32_t kShadowMapWidth = 512;       // normal shadow map
     static const uint32_t kShadowMapHeight = 512;      // normal shadow map
@@ -59,6 +60,10 @@ struct GfxConfiguration {
 
     bool fixOpenGLPerspectiveMatrix = false;
 
+    // where compiled pipelines are kept between runs, empty to compile them
+    // every run
+    const char* pipelineCacheDirectory = "PipelineCache";
+
     friend std::ostream& operator<<(std::ostream& out,
                                     const GfxConfiguration& conf) {
         out << "App Name:" << conf.appName << std::endl;
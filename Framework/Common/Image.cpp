@@ -17,11 +17,15 @@ Image::Image(Image&& rhs) noexcept {
     pixel_format = rhs.pixel_format;
     is_signed = rhs.is_signed;
     mipmaps = std::move(rhs.mipmaps);
+    face_count = rhs.face_count;
+    array_size = rhs.array_size;
+    storage = std::move(rhs.storage);
     rhs.data = nullptr;
 }
 
 Image& Image::operator=(Image&& rhs) noexcept {
     if (this != &rhs) {
+        ReleaseData();
         Width = rhs.Width;
         Height = rhs.Height;
         data = rhs.data;
@@ -35,6 +39,9 @@ Image& Image::operator=(Image&& rhs) noexcept {
         pixel_format = rhs.pixel_format;
         is_signed = rhs.is_signed;
         mipmaps = std::move(rhs.mipmaps);
+        face_count = rhs.face_count;
+        array_size = rhs.array_size;
+        storage = std::move(rhs.storage);
         rhs.data = nullptr;
     }
     return *this;
@@ -185,106 +192,173 @@ ostream& operator<<(ostream& out, const Image& image) {
     out << "Data Size: " << image.data_size << endl;
     out << "Compressed: " << image.compressed << endl;
     out << "Compressed Format: " << image.compress_format << endl;
+    out << "Mip Levels: " << image.GetMipLevels() << endl;
+    out << "Faces: " << image.face_count << endl;
+    out << "Array Size: " << image.array_size << endl;
 
     return out;
 }
 
-void adjust_image(Image& image) {
+size_t GetMipSize(const Image& image, const uint32_t width,
+                  const uint32_t height, size_t& pitch) {
     if (!image.compressed) {
-        if (image.pixel_format == PIXEL_FORMAT::RGB8) {
-            // DXGI does not have 24bit formats so we have to extend it to 32bit
-            auto new_pitch = image.pitch / 3 * 4;
-            auto data_size = (size_t)new_pitch * image.Height;
-            auto* data = new uint8_t[data_size];
-            uint8_t* buf;
-            uint8_t* src;
-            for (decltype(image.Height) row = 0; row < image.Height; row++) {
-                buf = data + (ptrdiff_t)row * new_pitch;
-                src = image.data + (ptrdiff_t)row * image.pitch;
-                for (decltype(image.Width) col = 0; col < image.Width; col++) {
-                    memcpy(buf, src, 3);
-                    memset(buf + 3, 0xFF, 1);  // set alpha to 255
-                    buf += 4;
-                    src += 3;
-                }
-            }
+        pitch = ((size_t)width * image.bitcount + 7) >> 3;
+        return pitch * height;
+    }
 
-            delete[] image.data;
-            image.data = data;
-            image.data_size = data_size;
-            image.pitch = new_pitch;
-            image.bitcount = 32;
-            image.pixel_format = PIXEL_FORMAT::RGBA8;
+    // texels and bytes of a block
+    uint32_t block_width = 4;
+    uint32_t block_height = 4;
+    uint32_t block_bytes = 16;
+    switch (image.compress_format) {
+        case COMPRESSED_FORMAT::DXT1:
+        case COMPRESSED_FORMAT::BC1:
+        case COMPRESSED_FORMAT::BC1A:
+        case COMPRESSED_FORMAT::BC4:
+        case COMPRESSED_FORMAT::ETC:
+            block_bytes = 8;
+            break;
+        case COMPRESSED_FORMAT::DXT2:
+        case COMPRESSED_FORMAT::DXT3:
+        case COMPRESSED_FORMAT::DXT4:
+        case COMPRESSED_FORMAT::DXT5:
+        case COMPRESSED_FORMAT::BC2:
+        case COMPRESSED_FORMAT::BC3:
+        case COMPRESSED_FORMAT::BC5:
+        case COMPRESSED_FORMAT::BC6H:
+        case COMPRESSED_FORMAT::BC7:
+        case COMPRESSED_FORMAT::ASTC_4x4:
+            break;
+        case COMPRESSED_FORMAT::ASTC_5x4:
+            block_width = 5;
+            break;
+        case COMPRESSED_FORMAT::ASTC_5x5:
+            block_width = block_height = 5;
+            break;
+        case COMPRESSED_FORMAT::ASTC_6x5:
+            block_width = 6;
+            block_height = 5;
+            break;
+        case COMPRESSED_FORMAT::ASTC_6x6:
+            block_width = block_height = 6;
+            break;
+        case COMPRESSED_FORMAT::ASTC_8x5:
+            block_width = 8;
+            block_height = 5;
+            break;
+        case COMPRESSED_FORMAT::ASTC_8x6:
+            block_width = 8;
+            block_height = 6;
+            break;
+        case COMPRESSED_FORMAT::ASTC_8x8:
+            block_width = block_height = 8;
+            break;
+        case COMPRESSED_FORMAT::ASTC_10x5:
+            block_width = 10;
+            block_height = 5;
+            break;
+        case COMPRESSED_FORMAT::ASTC_10x6:
+            block_width = 10;
+            block_height = 6;
+            break;
+        case COMPRESSED_FORMAT::ASTC_10x8:
+            block_width = 10;
+            block_height = 8;
+            break;
+        case COMPRESSED_FORMAT::ASTC_10x10:
+            block_width = block_height = 10;
+            break;
+        case COMPRESSED_FORMAT::ASTC_12x10:
+            block_width = 12;
+            block_height = 10;
+            break;
+        case COMPRESSED_FORMAT::ASTC_12x12:
+            block_width = block_height = 12;
+            break;
+        default:
+            // PVRTC, 3D ASTC and the DX10 placeholder
+            pitch = 0;
+            return 0;
+    }
 
-            // adjust mipmaps
-            for (auto& mip : image.mipmaps) {
-                mip.pitch = mip.pitch / 3 * 4;
-                mip.offset = mip.offset / 3 * 4;
-                mip.data_size = mip.data_size / 3 * 4;
-            }
-        } else if (image.pixel_format == PIXEL_FORMAT::RGB16) {
-            // DXGI does not have 48bit formats so we have to extend it to 64bit
-            auto new_pitch = image.pitch / 3 * 4;
-            auto data_size = new_pitch * image.Height;
-            auto* data = new uint8_t[data_size];
-            uint8_t* buf;
-            uint8_t* src;
-            for (decltype(image.Height) row = 0; row < image.Height; row++) {
-                buf = data + (ptrdiff_t)row * new_pitch;
-                src = image.data + (ptrdiff_t)row * image.pitch;
-                for (decltype(image.Width) col = 0; col < image.Width; col++) {
-                    memcpy(buf, src, 6);
-                    *reinterpret_cast<int16_t*>(buf + 6) = 0b0000'0100'0000'0000; // set alpha to (fp16)1.0 = 0b 0 00001 0000 0000 00
-                    buf += 8;
-                    src += 6;
-                }
-            }
+    const size_t blocks_x = (width + block_width - 1) / block_width;
+    const size_t blocks_y = (height + block_height - 1) / block_height;
+    pitch = blocks_x * block_bytes;
+    return pitch * blocks_y;
+}
 
-            delete[] image.data;
-            image.data = data;
-            image.data_size = data_size;
-            image.pitch = new_pitch;
-            image.bitcount = 64;
-            image.pixel_format = PIXEL_FORMAT::RGBA16;
+void adjust_image(Image& image) {
+    if (image.compressed) return;
 
-            // adjust mipmaps
-            for (auto& mip : image.mipmaps) {
-                mip.pitch = mip.pitch / 3 * 4;
-                mip.offset = mip.offset / 3 * 4;
-                mip.data_size = mip.data_size / 3 * 4;
-            }
-        } else if (image.pixel_format == PIXEL_FORMAT::RGB32) {
-            // DXGI does not have 48bit formats so we have to extend it to 64bit
-            auto new_pitch = image.pitch / 3 * 4;
-            auto data_size = new_pitch * image.Height;
-            auto* data = new uint8_t[data_size];
-            uint8_t* buf;
-            uint8_t* src;
-            for (decltype(image.Height) row = 0; row < image.Height; row++) {
-                buf = data + (ptrdiff_t)row * new_pitch;
-                src = image.data + (ptrdiff_t)row * image.pitch;
-                for (decltype(image.Width) col = 0; col < image.Width; col++) {
-                    memcpy(buf, src, 12);
-                    *reinterpret_cast<float*>(buf + 12) = 1.0f;
-                    buf += 16;
-                    src += 12;
-                }
-            }
+    // DXGI does not have 24, 48 or 96 bit formats so we have to extend them
+    // to 32, 64 or 128 bit with an opaque alpha
+    uint32_t channel_size;
+    PIXEL_FORMAT pixel_format;
+    switch (image.pixel_format) {
+        case PIXEL_FORMAT::RGB8:
+            channel_size = 1;
+            pixel_format = PIXEL_FORMAT::RGBA8;
+            break;
+        case PIXEL_FORMAT::RGB16:
+            channel_size = 2;
+            pixel_format = PIXEL_FORMAT::RGBA16;
+            break;
+        case PIXEL_FORMAT::RGB32:
+            channel_size = 4;
+            pixel_format = PIXEL_FORMAT::RGBA32;
+            break;
+        default:
+            return;
+    }
 
-            delete[] image.data;
-            image.data = data;
-            image.data_size = data_size;
-            image.pitch = new_pitch;
-            image.bitcount = 128;
-            image.pixel_format = PIXEL_FORMAT::RGBA32;
+    uint8_t alpha[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+    if (channel_size == 2 && image.is_float) {
+        const uint16_t one = 0x3C00;  // (fp16)1.0
+        memcpy(alpha, &one, sizeof(one));
+    } else if (channel_size == 4) {
+        const float one = 1.0f;
+        memcpy(alpha, &one, sizeof(one));
+    }
 
-            // adjust mipmaps
-            for (auto& mip : image.mipmaps) {
-                mip.pitch = mip.pitch / 3 * 4;
-                mip.offset = mip.offset / 3 * 4;
-                mip.data_size = mip.data_size / 3 * 4;
+    // every level of every face and layer, rows packed
+    const vector<Image::Mipmap> sources =
+        image.mipmaps.empty()
+            ? vector<Image::Mipmap>{Image::Mipmap(image.Width, image.Height,
+                                                  image.pitch, 0,
+                                                  image.data_size)}
+            : image.mipmaps;
+    const uint32_t src_texel = channel_size * 3;
+    const uint32_t dst_texel = channel_size * 4;
+    vector<Image::Mipmap> mipmaps;
+    size_t data_size = 0;
+    for (const auto& source : sources) {
+        const size_t pitch = (size_t)source.Width * dst_texel;
+        mipmaps.emplace_back(source.Width, source.Height, pitch, data_size,
+                             pitch * source.Height);
+        data_size += pitch * source.Height;
+    }
+
+    auto* data = new uint8_t[data_size];
+    for (size_t i = 0; i < sources.size(); i++) {
+        for (uint32_t row = 0; row < sources[i].Height; row++) {
+            uint8_t* buf = data + mipmaps[i].offset + row * mipmaps[i].pitch;
+            const uint8_t* src =
+                image.data + sources[i].offset + row * sources[i].pitch;
+            for (uint32_t col = 0; col < sources[i].Width; col++) {
+                memcpy(buf, src, src_texel);
+                memcpy(buf + src_texel, alpha, channel_size);
+                buf += dst_texel;
+                src += src_texel;
             }
         }
     }
+
+    image.ReleaseData();
+    image.data = data;
+    image.data_size = data_size;
+    image.pitch = mipmaps[0].pitch;
+    image.bitcount = dst_texel * 8;
+    image.pixel_format = pixel_format;
+    if (!image.mipmaps.empty()) image.mipmaps = move(mipmaps);
 }
 }  // namespace My
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <vector>
 
+#include "Buffer.hpp"
 #include "config.h"
 #include "geommath.hpp"
 
@@ -103,15 +104,43 @@ struct Image {
             data_size = data_size_;
         }
     };
+    // every level of every face of every layer, offsets from data. the
+    // levels of a face are next to each other, then the faces of a layer,
+    // whatever the order in the file
     std::vector<Mipmap> mipmaps;
+    uint32_t face_count{1};  // 6 for a cubemap
+    uint32_t array_size{1};  // layers of a texture array
+    // the parsed file when data points into it instead of owning a copy
+    Buffer storage;
 
     Image() = default;
     Image(const Image& rhs) = delete;  // disable copy contruct
     Image(Image&& rhs) noexcept;
     Image& operator=(const Image& rhs) = delete;  // disable copy assignment
     Image& operator=(Image&& rhs) noexcept;
-    ~Image() {
-        if (data) delete[] data;
+    ~Image() { ReleaseData(); }
+
+    void ReleaseData() {
+        if (!storage.GetData()) delete[] data;
+        storage = Buffer();
+        data = nullptr;
+    }
+
+    [[nodiscard]] uint32_t GetMipLevels() const {
+        return static_cast<uint32_t>(mipmaps.size()) /
+               (face_count * array_size);
+    }
+
+    [[nodiscard]] const Mipmap& GetSubresource(const uint32_t level,
+                                               const uint32_t face = 0,
+                                               const uint32_t layer = 0) const {
+        return mipmaps[(layer * face_count + face) * GetMipLevels() + level];
+    }
+
+    [[nodiscard]] const uint8_t* GetSubresourceData(
+        const uint32_t level, const uint32_t face = 0,
+        const uint32_t layer = 0) const {
+        return data + GetSubresource(level, face, layer).offset;
     }
 
     uint8_t GetR(uint32_t x, uint32_t y) const {
@@ -299,5 +328,10 @@ struct Image {
 
 std::ostream& operator<<(std::ostream& out, const Image& image);
 
+// the row pitch and size of a mip level in the format of the image, whole
+// blocks for the compressed formats. 0 when the size is not known
+size_t GetMipSize(const Image& image, uint32_t width, uint32_t height,
+                  size_t& pitch);
+
 void adjust_image(Image& image);
 }  // namespace My
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "PipelineStateCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace My;
+using namespace std;
+
+namespace {
+constexpr char kMagic[4] = {'M', 'P', 'S', 'C'};
+// bump when the layout of the files changes
+constexpr uint32_t kVersion = 1;
+
+struct EntryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t device;
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+uint64_t checksum(const void* data, const size_t size) {
+    Fnv1aHash hash;
+    hash.Update(data, size);
+    return hash.Get();
+}
+}  // namespace
+
+void Fnv1aHash::Update(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        m_nHash ^= bytes[i];
+        m_nHash *= 0x100000001b3ull;
+    }
+}
+
+uint64_t My::HashPipelineState(const PipelineState& state,
+                               const vector<PipelineShaderStage>& stages) {
+    Fnv1aHash hash;
+    hash.Update(state.pipelineType);
+    hash.Update(state.a2vType);
+    hash.Update(state.depthTestMode);
+    hash.Update(state.bDepthWrite);
+    hash.Update(state.stencilTestMode);
+    hash.Update(state.cullFaceMode);
+    hash.Update(state.pixelFormat);
+    hash.Update(state.sampleCount);
+    // shadow and debug pipelines blend and write their targets differently
+    hash.Update(state.flag);
+
+    hash.Update(stages.size());
+    for (const auto& stage : stages) {
+        hash.Update(stage.stage);
+        hash.Update(stage.size);
+        hash.Update(stage.code, stage.size);
+    }
+
+    return hash.Get();
+}
+
+bool PipelineStateCache::Open(const string& directory, const string& device) {
+    error_code ec;
+    filesystem::create_directories(directory, ec);
+    if (ec) {
+        cerr << "[PipelineStateCache] can not create " << directory << ": "
+             << ec.message() << endl;
+        return false;
+    }
+
+    m_strDirectory = directory;
+    Fnv1aHash hash;
+    hash.Update(device);
+    m_nDeviceHash = hash.Get();
+
+    return true;
+}
+
+void PipelineStateCache::Close() {
+    if (!IsOpen()) return;
+
+    cerr << "[PipelineStateCache] " << m_nHitCount << " loaded, "
+         << m_nMissCount << " compiled, " << m_nRejectedCount << " rejected"
+         << endl;
+
+    m_strDirectory.clear();
+}
+
+string PipelineStateCache::GetEntryPath(const uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin",
+             static_cast<unsigned long long>(key));
+    return (filesystem::path(m_strDirectory) / name).string();
+}
+
+bool PipelineStateCache::Load(const uint64_t key, uint32_t& format,
+                              vector<uint8_t>& data) {
+    if (!IsOpen()) return false;
+
+    const auto path = GetEntryPath(key);
+    ifstream file(path, ios::binary);
+    if (!file) {
+        m_nMissCount++;
+        return false;
+    }
+
+    error_code ec;
+    const auto file_size = filesystem::file_size(path, ec);
+
+    EntryHeader header;
+    bool valid = static_cast<bool>(
+        file.read(reinterpret_cast<char*>(&header), sizeof(header)));
+    // the size is checked against the file before anything is allocated
+    valid = valid && !ec && memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+            header.version == kVersion && header.key == key &&
+            header.device == m_nDeviceHash &&
+            header.size == file_size - sizeof(header);
+
+    if (valid) {
+        data.resize(header.size);
+        valid = static_cast<bool>(file.read(
+                    reinterpret_cast<char*>(data.data()), header.size)) &&
+                checksum(data.data(), data.size()) == header.checksum;
+    }
+
+    file.close();
+
+    if (!valid) {
+        data.clear();
+        m_nRejectedCount++;
+        m_nMissCount++;
+        filesystem::remove(path, ec);
+        return false;
+    }
+
+    format = header.format;
+    m_nHitCount++;
+    return true;
+}
+
+bool PipelineStateCache::Store(const uint64_t key, const uint32_t format,
+                               const void* data, const size_t size) {
+    if (!IsOpen()) return false;
+
+    EntryHeader header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.key = key;
+    header.device = m_nDeviceHash;
+    header.format = format;
+    header.size = size;
+    header.checksum = checksum(data, size);
+
+    // written aside and renamed, so a crash never leaves a partial entry
+    const auto path = GetEntryPath(key);
+    const auto temp_path = path + ".tmp";
+    {
+        ofstream file(temp_path, ios::binary | ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(static_cast<const char*>(data), size);
+        if (!file) {
+            cerr << "[PipelineStateCache] can not write " << temp_path
+                 << endl;
+            return false;
+        }
+    }
+
+    error_code ec;
+    filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    return true;
+}
+
+void PipelineStateCache::Remove(const uint64_t key) {
+    if (!IsOpen()) return;
+
+    m_nRejectedCount++;
+    error_code ec;
+    filesystem::remove(GetEntryPath(key), ec);
+}
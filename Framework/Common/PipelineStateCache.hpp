@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "IPipelineStateManager.hpp"
+
+namespace My {
+// 64 bit FNV-1a, fed with the parts of a key in turn
+class Fnv1aHash {
+   public:
+    void Update(const void* data, size_t size);
+    void Update(const std::string& value) {
+        Update(value.size());
+        Update(value.data(), value.size());
+    }
+    template <typename T>
+    void Update(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Update(&value, sizeof(T));
+    }
+
+    [[nodiscard]] uint64_t Get() const { return m_nHash; }
+
+   private:
+    uint64_t m_nHash{0xcbf29ce484222325ull};
+};
+
+// what a stage of a pipeline is compiled from, bytecode or source
+struct PipelineShaderStage {
+    uint32_t stage;
+    const void* code;
+    size_t size;
+};
+
+// Key of the compiled pipeline: the code of its stages, the vertex layout,
+// the depth, stencil and raster states and the format and sample count of
+// the targets. The name is left out, so states which only differ by their
+// name share an entry.
+uint64_t HashPipelineState(const PipelineState& state,
+                           const std::vector<PipelineShaderStage>& stages);
+
+// Stores compiled pipelines (program binaries, pipeline cache blobs, cached
+// PSOs) in a directory, a file per key. Each file records the device it was
+// compiled for and a checksum, and is only handed back when both match.
+class PipelineStateCache {
+   public:
+    // Uses the directory, created if needed, for the pipelines of the
+    // device, which names the GPU and the driver.
+    bool Open(const std::string& directory, const std::string& device);
+    void Close();
+    [[nodiscard]] bool IsOpen() const { return !m_strDirectory.empty(); }
+
+    // Reads the entry of the key. An entry which is truncated, corrupted or
+    // from another device is removed.
+    bool Load(const uint64_t key, uint32_t& format, std::vector<uint8_t>& data);
+    // format tells the kind of binary, e.g. the GL program binary format
+    bool Store(const uint64_t key, const uint32_t format, const void* data,
+               const size_t size);
+    // drops an entry the driver refused to load
+    void Remove(const uint64_t key);
+
+    [[nodiscard]] std::string GetEntryPath(const uint64_t key) const;
+
+    [[nodiscard]] uint32_t GetHitCount() const { return m_nHitCount; }
+    [[nodiscard]] uint32_t GetMissCount() const { return m_nMissCount; }
+    [[nodiscard]] uint32_t GetRejectedCount() const {
+        return m_nRejectedCount;
+    }
+
+   private:
+    std::string m_strDirectory;
+    uint64_t m_nDeviceHash{0};
+
+    uint32_t m_nHitCount{0};
+    uint32_t m_nMissCount{0};
+    uint32_t m_nRejectedCount{0};
+};
+}  // namespace My
@@ -2,6 +2,14 @@
 #define __CBUFFER_H__
 
 #define MAX_LIGHTS 100
+// lights shaded through the clusters of the view frustum, see
+// LightClusterGrid
+#define MAX_CLUSTERED_LIGHTS 4096
+#define LIGHT_CLUSTER_COUNT_X 16
+#define LIGHT_CLUSTER_COUNT_Y 8
+#define LIGHT_CLUSTER_COUNT_Z 24
+// cascades of the shadow map of the sun, layers of globalShadowMap
+#define SHADOW_CASCADE_COUNT 4
 
 #include "config.h"
 
@@ -55,9 +63,12 @@ unistruct PerFrameConstants REGISTER(b10) {
     Matrix4X4f viewMatrix;        // 64 bytes
     Matrix4X4f projectionMatrix;  // 64 bytes
     Vector4f camPos;              // 16 bytes
-    int32_t numLights;            // 4 bytes
-    int32_t clip_space_type;      // 0 : OpenGL, 1 : others
-};                                // totle 152 bytes
+    Vector4f clusterDepthParams;  // near, far, slice scale, slice bias
+    Matrix4X4f shadowCascadeMatrices[SHADOW_CASCADE_COUNT];  // 256 bytes
+    Vector4f shadowCascadeSplits;  // far view depth of each cascade
+    int32_t numLights;             // 4 bytes
+    int32_t clip_space_type;       // 0 : OpenGL, 1 : others
+};                                 // totle 440 bytes
 
 unistruct PerBatchConstants REGISTER(b11) {
     Matrix4X4f modelMatrix;  // 64 bytes
@@ -200,6 +211,14 @@ TextureCubeArray skybox REGISTER(t10);
 #endif
 Texture2D terrainHeightMap REGISTER(t11);
 
+#if !defined(OS_WEBASSEMBLY)
+// every light of the frame, and the lights of each cluster as a range of
+// lightClusterIndices
+StructuredBuffer<Light> clusteredLights REGISTER(t14);
+StructuredBuffer<uint2> lightClusters REGISTER(t15);
+StructuredBuffer<uint> lightClusterIndices REGISTER(t16);
+#endif
+
 // samplers
 SamplerState samp0 REGISTER(s0);
 #endif
@@ -212,6 +231,8 @@ SamplerState samp0 REGISTER(s0);
     "        flags = DESCRIPTORS_VOLATILE), "           \
     "SRV(t0, numDescriptors = 12, "                     \
     "        flags = DESCRIPTORS_VOLATILE), "           \
+    "SRV(t14, numDescriptors = 3, "                     \
+    "        flags = DESCRIPTORS_VOLATILE), "           \
     "UAV(u0, numDescriptors = unbounded, "              \
     "        flags = DESCRIPTORS_VOLATILE)), "          \
     "DescriptorTable( Sampler(s0, space=0, numDescriptors = 8))"
@@ -1,5 +1,6 @@
 #include "ShadowMapPass.hpp"
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
@@ -9,76 +10,67 @@ using namespace std;
 using namespace My;
 
 void ShadowMapPass::Draw(Frame& frame) {
-    uint32_t shadowmap_index = 0;
-    uint32_t global_shadowmap_index = 0;
-    uint32_t cube_shadowmap_index = 0;
-
-    for (int32_t i = 0; i < frame.frameContext.numLights; i++) {
-        auto& light = frame.lightInfo.lights[i];
-
-        if (light.lightCastShadow) {
-            TextureBase* pShadowmap;
-
-            const char* pipelineStateName;
-
-            switch (light.lightType) {
-                case LightType::Omni:
-                    if (cube_shadowmap_index >=
-                        GfxConfiguration::kMaxCubeShadowMapCount) {
-                        continue;
-                    }
-                    pipelineStateName = "Omni Light Shadow Map";
-                    pShadowmap = &frame.frameContext.cubeShadowMap;
-                    light.lightShadowMapIndex = cube_shadowmap_index++;
-                    break;
-                case LightType::Spot:
-                    if (shadowmap_index >=
-                        GfxConfiguration::kMaxShadowMapCount) {
-                        continue;
-                    }
-                    pipelineStateName = "Spot Light Shadow Map";
-                    pShadowmap = &frame.frameContext.shadowMap;
-                    light.lightShadowMapIndex = shadowmap_index++;
-                    break;
-                case LightType::Area:
-                    if (shadowmap_index >=
-                        GfxConfiguration::kMaxShadowMapCount) {
-                        continue;
-                    }
-                    pipelineStateName = "Area Light Shadow Map";
-                    pShadowmap = &frame.frameContext.shadowMap;
-                    light.lightShadowMapIndex = shadowmap_index++;
-                    break;
-                case LightType::Infinity:
-                    if (global_shadowmap_index >=
-                        GfxConfiguration::kMaxShadowMapCount) {
-                        continue;
-                    }
-                    pipelineStateName = "Sun Light Shadow Map";
-                    pShadowmap = &frame.frameContext.globalShadowMap;
-                    light.lightShadowMapIndex = global_shadowmap_index++;
-                    break;
-                default:
-                    assert(0);
-            }
-
-            m_pGraphicsManager->BeginShadowMap(
-                i, pShadowmap, light.lightShadowMapIndex, frame);
-
-            // Set the color shader as the current shader program and set the
-            // matrices that it will use for rendering.
-            auto& pPipelineState =
-                m_pPipelineStateManager->GetPipelineState(pipelineStateName);
-            m_pGraphicsManager->SetPipelineState(pPipelineState, frame);
-
-            m_pGraphicsManager->DrawBatch(frame);
-
-            m_pGraphicsManager->EndShadowMap(pShadowmap,
-                                             light.lightShadowMapIndex, frame);
+    uint32_t shadowmap_count = 0;
+    uint32_t global_shadowmap_count = 0;
+    uint32_t cube_shadowmap_count = 0;
+
+    // the shadow map slots are assigned with the lights and every layer to
+    // draw comes with its casters, the cascades of the sun each have a layer
+    for (const auto& casters : frame.shadowCasters) {
+        const auto& light = frame.lights[casters.lightIndex];
+
+        // the shadow map shaders read the light from LightInfo
+        assert(casters.lightIndex < MAX_LIGHTS);
+
+        TextureBase* pShadowmap;
+
+        const char* pipelineStateName;
+
+        const auto count = static_cast<uint32_t>(casters.layer + 1);
+
+        switch (light.lightType) {
+            case LightType::Omni:
+                pipelineStateName = "Omni Light Shadow Map";
+                pShadowmap = &frame.frameContext.cubeShadowMap;
+                cube_shadowmap_count = max(cube_shadowmap_count, count);
+                break;
+            case LightType::Spot:
+                pipelineStateName = "Spot Light Shadow Map";
+                pShadowmap = &frame.frameContext.shadowMap;
+                shadowmap_count = max(shadowmap_count, count);
+                break;
+            case LightType::Area:
+                pipelineStateName = "Area Light Shadow Map";
+                pShadowmap = &frame.frameContext.shadowMap;
+                shadowmap_count = max(shadowmap_count, count);
+                break;
+            case LightType::Infinity:
+                pipelineStateName = "Sun Light Shadow Map";
+                pShadowmap = &frame.frameContext.globalShadowMap;
+                global_shadowmap_count = max(global_shadowmap_count, count);
+                break;
+            default:
+                assert(0);
         }
+
+        // the layer still holds what was drawn in a previous frame
+        if (casters.cached) continue;
+
+        m_pGraphicsManager->BeginShadowMap(casters.lightIndex, pShadowmap,
+                                           casters.layer, frame);
+
+        // Set the color shader as the current shader program and set the
+        // matrices that it will use for rendering.
+        auto& pPipelineState =
+            m_pPipelineStateManager->GetPipelineState(pipelineStateName);
+        m_pGraphicsManager->SetPipelineState(pPipelineState, frame);
+
+        m_pGraphicsManager->DrawBatch(frame, casters.batches);
+
+        m_pGraphicsManager->EndShadowMap(pShadowmap, casters.layer, frame);
     }
 
-    frame.frameContext.globalShadowMap.size = global_shadowmap_index;
-    frame.frameContext.cubeShadowMap.size = cube_shadowmap_index;
-    frame.frameContext.shadowMap.size = shadowmap_index;
+    frame.frameContext.globalShadowMap.size = global_shadowmap_count;
+    frame.frameContext.cubeShadowMap.size = cube_shadowmap_count;
+    frame.frameContext.shadowMap.size = shadowmap_count;
 }
@@ -6,11 +6,15 @@ using namespace My;
 using namespace std;
 
 void GeometrySubPass::Draw(Frame& frame) {
-    auto& pPipelineState = m_pPipelineStateManager->GetPipelineState("PBR");
+    // the batches sharing a permutation of the shader are drawn together
+    for (const auto& variant : frame.shaderVariants) {
+        auto pPipelineState = m_pPipelineStateManager->GetPipelineStateVariant(
+            "PBR", variant.shaderVariant);
 
-    // Set the color shader as the current shader program and set the matrices
-    // that it will use for rendering.
-    m_pGraphicsManager->SetPipelineState(pPipelineState, frame);
-    m_pGraphicsManager->SetShadowMaps(frame);
-    m_pGraphicsManager->DrawBatch(frame);
+        // Set the color shader as the current shader program and set the
+        // matrices that it will use for rendering.
+        m_pGraphicsManager->SetPipelineState(pPipelineState, frame);
+        m_pGraphicsManager->SetShadowMaps(frame);
+        m_pGraphicsManager->DrawBatch(frame, variant.batches);
+    }
 }
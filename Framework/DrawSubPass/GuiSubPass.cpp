@@ -119,6 +119,29 @@ void GuiSubPass::Draw(Frame& frame) {
                 };
 
                 ImGui::PlotLines((const char*)u8"帧率", getData, (void *)&fps_data, fps_data.size(), 0, "FPS", 0.0f);
+
+                ImGui::Text((const char*)u8"绘制批次 %u, 三角形 %u (LOD 0: %u)",
+                            frame.stats.batchCount,
+                            frame.stats.triangleCount,
+                            frame.stats.fullDetailTriangleCount);
+                ImGui::Text((const char*)u8"簇 %u, 剔除 %u",
+                            frame.stats.meshletCount,
+                            frame.stats.culledMeshletCount);
+                ImGui::Text((const char*)u8"遮挡体 %u, 被遮挡批次 %u",
+                            frame.stats.occluderCount,
+                            frame.stats.occludedBatchCount);
+                ImGui::Text((const char*)u8"光源 %u, 分簇光源索引 %u",
+                            frame.stats.lightCount,
+                            frame.stats.lightClusterIndexCount);
+                ImGui::Text((const char*)u8"阴影投射 %u, 超出范围 %u, 缓存 %u (阴影贴图 %u)",
+                            frame.stats.shadowCasterCount,
+                            frame.stats.culledShadowCasterCount,
+                            frame.stats.cachedShadowCasterCount,
+                            frame.stats.cachedShadowMapCount);
+                ImGui::Text((const char*)u8"渲染目标 %.1f MB (稳定 %.1f MB, 峰值 %.1f MB)",
+                            frame.stats.renderTargetMemory / 1048576.0,
+                            frame.stats.steadyRenderTargetMemory / 1048576.0,
+                            frame.stats.peakRenderTargetMemory / 1048576.0);
             }
 
 
@@ -0,0 +1,299 @@
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CHANNEL_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CHANNEL_NEON 1
+#endif
+
+namespace {
+constexpr float kUnorm8Scale = 1.0f / 255.0f;
+constexpr float kUnorm16Scale = 1.0f / 65535.0f;
+
+// NaN and below 0 to 0, above 1 to 1
+inline float saturate(const float value) {
+    const float low = value > 0.0f ? value : 0.0f;
+    return low < 1.0f ? low : 1.0f;
+}
+
+inline float halfToFloat(const uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t magnitude = static_cast<uint32_t>(half & 0x7FFF) << 13;
+    // the exponent rebiased by 2^112, which also scales the subnormals
+    float value;
+    memcpy(&value, &magnitude, sizeof(value));
+    value *= 0x1p112f;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((half & 0x7C00) == 0x7C00) bits |= 0x7F800000;
+    bits |= sign;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// rounds to nearest even and overflows to infinity
+inline uint16_t floatToHalf(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    bits &= 0x7FFFFFFF;
+    if (bits > 0x7F800000) return sign | 0x7E00;
+    if (bits >= (143u << 23)) return sign | 0x7C00;
+    if (bits < (113u << 23)) {
+        // the addition of 0.5 rounds the subnormal mantissa into place
+        float magnitude;
+        memcpy(&magnitude, &bits, sizeof(magnitude));
+        const float aligned = magnitude + 0.5f;
+        memcpy(&bits, &aligned, sizeof(bits));
+        return sign | static_cast<uint16_t>(bits - (126u << 23));
+    }
+    const uint32_t odd = (bits >> 13) & 1;
+    bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + odd;
+    return sign | static_cast<uint16_t>(bits >> 13);
+}
+
+#if defined(CHANNEL_SSE2)
+inline __m128i select(const __m128i mask, const __m128i a, const __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline __m128 saturate(const __m128 value) {
+    // maxps returns the second operand for NaN
+    return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+// 4 halves in the low 16 bits of the lanes
+inline __m128 halfToFloat(const __m128i half) {
+    const __m128i sign =
+        _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16);
+    const __m128i magnitude =
+        _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x7FFF)), 13);
+    __m128i bits = _mm_castps_si128(
+        _mm_mul_ps(_mm_castsi128_ps(magnitude), _mm_set1_ps(0x1p112f)));
+    const __m128i special =
+        _mm_cmpeq_epi32(_mm_and_si128(half, _mm_set1_epi32(0x7C00)),
+                        _mm_set1_epi32(0x7C00));
+    bits = _mm_or_si128(bits,
+                        _mm_and_si128(special, _mm_set1_epi32(0x7F800000)));
+    return _mm_castsi128_ps(_mm_or_si128(bits, sign));
+}
+
+// the halves sign extended in 32-bit lanes, ready for packs
+inline __m128i floatToHalf(const __m128 value) {
+    const __m128i all = _mm_castps_si128(value);
+    const __m128i sign =
+        _mm_srli_epi32(_mm_and_si128(all, _mm_set1_epi32(INT32_MIN)), 16);
+    const __m128i bits = _mm_and_si128(all, _mm_set1_epi32(0x7FFFFFFF));
+
+    const __m128i nan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(0x7F800000));
+    const __m128i overflow =
+        _mm_cmpgt_epi32(bits, _mm_set1_epi32((143 << 23) - 1));
+    const __m128i subnormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+    const __m128i aligned = _mm_sub_epi32(
+        _mm_castps_si128(
+            _mm_add_ps(_mm_castsi128_ps(bits), _mm_set1_ps(0.5f))),
+        _mm_set1_epi32(126 << 23));
+    const __m128i odd =
+        _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+    const __m128i normal = _mm_srli_epi32(
+        _mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32(((15 - 127) << 23) +
+                                                         0xFFF)),
+                      odd),
+        13);
+
+    __m128i half = select(subnormal, aligned, normal);
+    half = select(overflow, _mm_set1_epi32(0x7C00), half);
+    half = select(nan, _mm_set1_epi32(0x7E00), half);
+    half = _mm_or_si128(half, sign);
+    return _mm_srai_epi32(_mm_slli_epi32(half, 16), 16);
+}
+#endif
+}  // namespace
+
+namespace Dummy {
+void ConvertUnorm8ToFloat(const uint8_t* src, float* dst,
+                          const int32_t count) {
+    int32_t i = 0;
+#if defined(CHANNEL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(kUnorm8Scale);
+    const auto store = [&](float* p, const __m128i words) {
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_cvtepi32_ps(words), scale));
+    };
+    for (; i + 16 <= count; i += 16) {
+        const __m128i bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        store(dst + i, _mm_unpacklo_epi16(lo, zero));
+        store(dst + i + 4, _mm_unpackhi_epi16(lo, zero));
+        store(dst + i + 8, _mm_unpacklo_epi16(hi, zero));
+        store(dst + i + 12, _mm_unpackhi_epi16(hi, zero));
+    }
+#elif defined(CHANNEL_NEON)
+    for (; i + 8 <= count; i += 8) {
+        const uint16x8_t words = vmovl_u8(vld1_u8(src + i));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(
+                                           vget_low_u16(words))),
+                                       kUnorm8Scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(
+                                               vget_high_u16(words))),
+                                           kUnorm8Scale));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = src[i] * kUnorm8Scale;
+    }
+}
+
+void ConvertFloatToUnorm8(const float* src, uint8_t* dst,
+                          const int32_t count) {
+    int32_t i = 0;
+#if defined(CHANNEL_SSE2)
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const auto quantize = [&](const float* p) {
+        return _mm_cvttps_epi32(
+            _mm_add_ps(_mm_mul_ps(saturate(_mm_loadu_ps(p)), scale), half));
+    };
+    for (; i + 16 <= count; i += 16) {
+        const __m128i lo =
+            _mm_packs_epi32(quantize(src + i), quantize(src + i + 4));
+        const __m128i hi =
+            _mm_packs_epi32(quantize(src + i + 8), quantize(src + i + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(lo, hi));
+    }
+#elif defined(CHANNEL_NEON)
+    const auto quantize = [](const float* p) {
+        const float32x4_t value =
+            vminq_f32(vmaxq_f32(vld1q_f32(p), vdupq_n_f32(0.0f)),
+                      vdupq_n_f32(1.0f));
+        return vmovn_u32(
+            vcvtq_u32_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), value, 255.0f)));
+    };
+    for (; i + 8 <= count; i += 8) {
+        vst1_u8(dst + i, vmovn_u16(vcombine_u16(quantize(src + i),
+                                                quantize(src + i + 4))));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = static_cast<uint8_t>(saturate(src[i]) * 255.0f + 0.5f);
+    }
+}
+
+void ConvertUnorm16ToFloat(const uint16_t* src, float* dst,
+                           const int32_t count) {
+    int32_t i = 0;
+#if defined(CHANNEL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(kUnorm16Scale);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i words =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i,
+                      _mm_mul_ps(_mm_cvtepi32_ps(
+                                     _mm_unpacklo_epi16(words, zero)),
+                                 scale));
+        _mm_storeu_ps(dst + i + 4,
+                      _mm_mul_ps(_mm_cvtepi32_ps(
+                                     _mm_unpackhi_epi16(words, zero)),
+                                 scale));
+    }
+#elif defined(CHANNEL_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(
+                                           vld1_u16(src + i))),
+                                       kUnorm16Scale));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = src[i] * kUnorm16Scale;
+    }
+}
+
+void ConvertFloatToUnorm16(const float* src, uint16_t* dst,
+                           const int32_t count) {
+    int32_t i = 0;
+#if defined(CHANNEL_SSE2)
+    // packs saturates signed, so the words are biased by 32768 around it
+    const __m128 scale = _mm_set1_ps(65535.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i bias = _mm_set1_epi32(32768);
+    const auto quantize = [&](const float* p) {
+        return _mm_sub_epi32(
+            _mm_cvttps_epi32(
+                _mm_add_ps(_mm_mul_ps(saturate(_mm_loadu_ps(p)), scale), half)),
+            bias);
+    };
+    for (; i + 8 <= count; i += 8) {
+        const __m128i words =
+            _mm_packs_epi32(quantize(src + i), quantize(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_xor_si128(words, _mm_set1_epi16(INT16_MIN)));
+    }
+#elif defined(CHANNEL_NEON)
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t value =
+            vminq_f32(vmaxq_f32(vld1q_f32(src + i), vdupq_n_f32(0.0f)),
+                      vdupq_n_f32(1.0f));
+        vst1_u16(dst + i, vmovn_u32(vcvtq_u32_f32(vmlaq_n_f32(
+                              vdupq_n_f32(0.5f), value, 65535.0f))));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = static_cast<uint16_t>(saturate(src[i]) * 65535.0f + 0.5f);
+    }
+}
+
+void ConvertHalfToFloat(const uint16_t* src, float* dst, const int32_t count) {
+    int32_t i = 0;
+#if defined(CHANNEL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        const __m128i halves =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i, halfToFloat(_mm_unpacklo_epi16(halves, zero)));
+        _mm_storeu_ps(dst + i + 4,
+                      halfToFloat(_mm_unpackhi_epi16(halves, zero)));
+    }
+#elif defined(CHANNEL_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i,
+                  vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = halfToFloat(src[i]);
+    }
+}
+
+void ConvertFloatToHalf(const float* src, uint16_t* dst, const int32_t count) {
+    int32_t i = 0;
+#if defined(CHANNEL_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        const __m128i halves =
+            _mm_packs_epi32(floatToHalf(_mm_loadu_ps(src + i)),
+                            floatToHalf(_mm_loadu_ps(src + i + 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), halves);
+    }
+#elif defined(CHANNEL_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1_u16(dst + i,
+                 vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = floatToHalf(src[i]);
+    }
+}
+}  // namespace Dummy
@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define CONVERT_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+// coefficients of the JFIF conversion scaled by 16384
+constexpr int16_t kCrToR = 22970;
+constexpr int16_t kCbToG = -5638;
+constexpr int16_t kCrToG = -11700;
+constexpr int16_t kCbToB = 29032;
+constexpr int16_t kOne = 1 << 14;
+constexpr int32_t kShift = 14;
+constexpr int32_t kBias = 1 << (kShift - 1);
+
+inline uint8_t clampToByte(const int32_t value) {
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+// RGBE is m * 2^(e - 136), computed as (m / 256) * 2^(e - 128) so that the
+// power of two is a normal float for every e but 1. Both products are exact,
+// like ldexp.
+constexpr float kMantissaScale = 1.0f / 256.0f;
+constexpr uint32_t kHalfOne = 0x3C00;
+
+inline float rgbeScale(const int32_t exponent) {
+    if (!exponent) return 0.0f;
+    const uint32_t bits = exponent == 1
+                              ? 0x00400000u
+                              : static_cast<uint32_t>(exponent - 1) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return scale;
+}
+
+// non-negative floats to half, rounding to nearest even and overflowing to
+// infinity
+inline uint16_t floatToHalf(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits >= (143u << 23)) return 0x7C00;
+    if (bits < (113u << 23)) {
+        // the addition of 0.5 rounds the subnormal mantissa into place
+        const float aligned = value + 0.5f;
+        memcpy(&bits, &aligned, sizeof(bits));
+        return static_cast<uint16_t>(bits - (126u << 23));
+    }
+    const uint32_t odd = (bits >> 13) & 1;
+    bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + odd;
+    return static_cast<uint16_t>(bits >> 13);
+}
+
+#if defined(CONVERT_SSE2)
+// 4 bytes widened to 32-bit lanes
+inline __m128i widen4(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(
+        _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int32_t>(value)),
+                          zero),
+        zero);
+}
+
+inline __m128 rgbeScale(const __m128i exponent) {
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i bits = _mm_slli_epi32(_mm_sub_epi32(exponent, one), 23);
+    bits = _mm_or_si128(bits, _mm_and_si128(_mm_cmpeq_epi32(exponent, one),
+                                            _mm_set1_epi32(0x00400000)));
+    bits = _mm_andnot_si128(
+        _mm_cmpeq_epi32(exponent, _mm_setzero_si128()), bits);
+    return _mm_castsi128_ps(bits);
+}
+
+inline __m128 rgbeChannel(const uint8_t* p, const __m128 scale) {
+    return _mm_mul_ps(
+        _mm_mul_ps(_mm_cvtepi32_ps(widen4(p)), _mm_set1_ps(kMantissaScale)),
+        scale);
+}
+
+inline __m128i floatToHalf(const __m128 value) {
+    const __m128i bits = _mm_castps_si128(value);
+    const __m128i overflow =
+        _mm_cmpgt_epi32(bits, _mm_set1_epi32((143 << 23) - 1));
+    const __m128i subnormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+    const __m128i aligned = _mm_sub_epi32(
+        _mm_castps_si128(_mm_add_ps(value, _mm_set1_ps(0.5f))),
+        _mm_set1_epi32(126 << 23));
+    const __m128i odd =
+        _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+    const __m128i normal = _mm_srli_epi32(
+        _mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32(((15 - 127) << 23) +
+                                                         0xFFF)),
+                      odd),
+        13);
+    const __m128i finite =
+        _mm_or_si128(_mm_and_si128(subnormal, aligned),
+                     _mm_andnot_si128(subnormal, normal));
+    return _mm_or_si128(_mm_and_si128(overflow, _mm_set1_epi32(0x7C00)),
+                        _mm_andnot_si128(overflow, finite));
+}
+#elif defined(__ARM_NEON)
+inline uint32x4_t widen4(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return vmovl_u16(
+        vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(value)))));
+}
+
+inline float32x4_t rgbeScale(const uint32x4_t exponent) {
+    const uint32x4_t one = vdupq_n_u32(1);
+    uint32x4_t bits = vshlq_n_u32(vsubq_u32(exponent, one), 23);
+    bits = vbslq_u32(vceqq_u32(exponent, one), vdupq_n_u32(0x00400000), bits);
+    bits = vbslq_u32(vceqq_u32(exponent, vdupq_n_u32(0)), vdupq_n_u32(0),
+                     bits);
+    return vreinterpretq_f32_u32(bits);
+}
+
+inline float32x4_t rgbeChannel(const uint8_t* p, const float32x4_t scale) {
+    return vmulq_f32(
+        vmulq_n_f32(vcvtq_f32_u32(widen4(p)), kMantissaScale), scale);
+}
+#endif
+}  // namespace
+
+namespace Dummy {
+void ConvertYCbCr2RGBA8(const uint8_t* y, const uint8_t* cb, const uint8_t* cr,
+                        uint8_t* rgba, const int32_t count) {
+    int32_t i = 0;
+#if defined(__AVX2__)
+    // 8 pixels in 32-bit lanes
+    const __m256i center = _mm256_set1_epi32(128);
+    const __m256i bias = _mm256_set1_epi32(kBias);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(255);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int32_t>(0xFF000000));
+    for (; i + 8 <= count; i += 8) {
+        const __m256i luma = _mm256_add_epi32(
+            _mm256_slli_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+                    reinterpret_cast<const __m128i*>(y + i))),
+                kShift),
+            bias);
+        const __m256i b = _mm256_sub_epi32(
+            _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + i))),
+            center);
+        const __m256i r = _mm256_sub_epi32(
+            _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + i))),
+            center);
+
+        const auto saturate = [&](const __m256i v) {
+            return _mm256_min_epi32(
+                _mm256_max_epi32(_mm256_srai_epi32(v, kShift), zero), max);
+        };
+        const __m256i red = saturate(_mm256_add_epi32(
+            luma, _mm256_mullo_epi32(r, _mm256_set1_epi32(kCrToR))));
+        const __m256i green = saturate(_mm256_add_epi32(
+            _mm256_add_epi32(
+                luma, _mm256_mullo_epi32(b, _mm256_set1_epi32(kCbToG))),
+            _mm256_mullo_epi32(r, _mm256_set1_epi32(kCrToG))));
+        const __m256i blue = saturate(_mm256_add_epi32(
+            luma, _mm256_mullo_epi32(b, _mm256_set1_epi32(kCbToB))));
+
+        const __m256i pixels = _mm256_or_si256(
+            _mm256_or_si256(red, _mm256_slli_epi32(green, 8)),
+            _mm256_or_si256(_mm256_slli_epi32(blue, 16), alpha));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), pixels);
+    }
+#elif defined(CONVERT_SSE2)
+    // 8 pixels, the products are summed in pairs by pmaddwd
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i center = _mm_set1_epi16(128);
+    const __m128i bias = _mm_set1_epi32(kBias);
+    const __m128i to_r = _mm_setr_epi16(kCrToR, kOne, kCrToR, kOne, kCrToR,
+                                        kOne, kCrToR, kOne);
+    const __m128i to_g = _mm_setr_epi16(kCbToG, kCrToG, kCbToG, kCrToG,
+                                        kCbToG, kCrToG, kCbToG, kCrToG);
+    const __m128i to_b = _mm_setr_epi16(kCbToB, kOne, kCbToB, kOne, kCbToB,
+                                        kOne, kCbToB, kOne);
+    const __m128i alpha = _mm_set1_epi16(255);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i luma = _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i)), zero);
+        const __m128i b = _mm_sub_epi16(
+            _mm_unpacklo_epi8(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + i)),
+                zero),
+            center);
+        const __m128i r = _mm_sub_epi16(
+            _mm_unpacklo_epi8(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + i)),
+                zero),
+            center);
+
+        const auto narrow = [&](const __m128i lo, const __m128i hi) {
+            return _mm_packs_epi32(
+                _mm_srai_epi32(_mm_add_epi32(lo, bias), kShift),
+                _mm_srai_epi32(_mm_add_epi32(hi, bias), kShift));
+        };
+        const __m128i red =
+            narrow(_mm_madd_epi16(_mm_unpacklo_epi16(r, luma), to_r),
+                   _mm_madd_epi16(_mm_unpackhi_epi16(r, luma), to_r));
+        const __m128i green = narrow(
+            _mm_add_epi32(
+                _mm_madd_epi16(_mm_unpacklo_epi16(b, r), to_g),
+                _mm_slli_epi32(_mm_unpacklo_epi16(luma, zero), kShift)),
+            _mm_add_epi32(
+                _mm_madd_epi16(_mm_unpackhi_epi16(b, r), to_g),
+                _mm_slli_epi32(_mm_unpackhi_epi16(luma, zero), kShift)));
+        const __m128i blue =
+            narrow(_mm_madd_epi16(_mm_unpacklo_epi16(b, luma), to_b),
+                   _mm_madd_epi16(_mm_unpackhi_epi16(b, luma), to_b));
+
+        // R0..R7 G0..G7 and B0..B7 A0..A7, then interleaved
+        const __m128i rg = _mm_packus_epi16(red, green);
+        const __m128i ba = _mm_packus_epi16(blue, alpha);
+        const __m128i rg_pairs = _mm_unpacklo_epi8(rg, _mm_srli_si128(rg, 8));
+        const __m128i ba_pairs = _mm_unpacklo_epi8(ba, _mm_srli_si128(ba, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4),
+                         _mm_unpacklo_epi16(rg_pairs, ba_pairs));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4 + 16),
+                         _mm_unpackhi_epi16(rg_pairs, ba_pairs));
+    }
+#elif defined(__ARM_NEON)
+    const int16x8_t center = vdupq_n_s16(128);
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t luma = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i)));
+        const int16x8_t b = vsubq_s16(
+            vreinterpretq_s16_u16(vmovl_u8(vld1_u8(cb + i))), center);
+        const int16x8_t r = vsubq_s16(
+            vreinterpretq_s16_u16(vmovl_u8(vld1_u8(cr + i))), center);
+
+        const int32x4_t luma_lo = vshll_n_s16(vget_low_s16(luma), kShift);
+        const int32x4_t luma_hi = vshll_n_s16(vget_high_s16(luma), kShift);
+        const int32x4_t red_lo = vmlal_n_s16(luma_lo, vget_low_s16(r), kCrToR);
+        const int32x4_t red_hi =
+            vmlal_n_s16(luma_hi, vget_high_s16(r), kCrToR);
+        const int32x4_t green_lo = vmlal_n_s16(
+            vmlal_n_s16(luma_lo, vget_low_s16(b), kCbToG), vget_low_s16(r),
+            kCrToG);
+        const int32x4_t green_hi = vmlal_n_s16(
+            vmlal_n_s16(luma_hi, vget_high_s16(b), kCbToG), vget_high_s16(r),
+            kCrToG);
+        const int32x4_t blue_lo =
+            vmlal_n_s16(luma_lo, vget_low_s16(b), kCbToB);
+        const int32x4_t blue_hi =
+            vmlal_n_s16(luma_hi, vget_high_s16(b), kCbToB);
+
+        // the rounding shift adds kBias
+        uint8x8x4_t pixels;
+        pixels.val[0] = vqmovun_s16(vcombine_s16(
+            vqrshrn_n_s32(red_lo, kShift), vqrshrn_n_s32(red_hi, kShift)));
+        pixels.val[1] = vqmovun_s16(vcombine_s16(
+            vqrshrn_n_s32(green_lo, kShift), vqrshrn_n_s32(green_hi, kShift)));
+        pixels.val[2] = vqmovun_s16(vcombine_s16(
+            vqrshrn_n_s32(blue_lo, kShift), vqrshrn_n_s32(blue_hi, kShift)));
+        pixels.val[3] = vdup_n_u8(255);
+        vst4_u8(rgba + i * 4, pixels);
+    }
+#endif
+
+    for (; i < count; i++) {
+        const int32_t luma = (y[i] << kShift) + kBias;
+        const int32_t b = cb[i] - 128;
+        const int32_t r = cr[i] - 128;
+        rgba[i * 4 + 0] = clampToByte((luma + r * kCrToR) >> kShift);
+        rgba[i * 4 + 1] =
+            clampToByte((luma + b * kCbToG + r * kCrToG) >> kShift);
+        rgba[i * 4 + 2] = clampToByte((luma + b * kCbToB) >> kShift);
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+void ConvertRGBE2RGBf(const uint8_t* r, const uint8_t* g, const uint8_t* b,
+                      const uint8_t* e, float* rgb, const int32_t count) {
+    int32_t i = 0;
+#if defined(CONVERT_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        const __m128 scale = rgbeScale(widen4(e + i));
+        const __m128 red = rgbeChannel(r + i, scale);
+        const __m128 green = rgbeChannel(g + i, scale);
+        const __m128 blue = rgbeChannel(b + i, scale);
+
+        // r0 g0 b0 r1, g1 b1 r2 g2 and b2 r3 g3 b3
+        const __m128 rg_lo = _mm_unpacklo_ps(red, green);
+        const __m128 rg_hi = _mm_unpackhi_ps(red, green);
+        const __m128 b0r1 =
+            _mm_shuffle_ps(blue, rg_lo, _MM_SHUFFLE(2, 2, 0, 0));
+        const __m128 g1b1 =
+            _mm_shuffle_ps(rg_lo, blue, _MM_SHUFFLE(1, 1, 3, 3));
+        const __m128 b2r3 =
+            _mm_shuffle_ps(blue, rg_hi, _MM_SHUFFLE(2, 2, 2, 2));
+        const __m128 g3b3 =
+            _mm_shuffle_ps(rg_hi, blue, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_ps(rgb + i * 3,
+                      _mm_shuffle_ps(rg_lo, b0r1, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(rgb + i * 3 + 4,
+                      _mm_shuffle_ps(g1b1, rg_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+        _mm_storeu_ps(rgb + i * 3 + 8,
+                      _mm_shuffle_ps(b2r3, g3b3, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t scale = rgbeScale(widen4(e + i));
+        float32x4x3_t pixels;
+        pixels.val[0] = rgbeChannel(r + i, scale);
+        pixels.val[1] = rgbeChannel(g + i, scale);
+        pixels.val[2] = rgbeChannel(b + i, scale);
+        vst3q_f32(rgb + i * 3, pixels);
+    }
+#endif
+
+    for (; i < count; i++) {
+        const float scale = rgbeScale(e[i]);
+        rgb[i * 3 + 0] = (r[i] * kMantissaScale) * scale;
+        rgb[i * 3 + 1] = (g[i] * kMantissaScale) * scale;
+        rgb[i * 3 + 2] = (b[i] * kMantissaScale) * scale;
+    }
+}
+
+void ConvertRGBE2RGBAh(const uint8_t* r, const uint8_t* g, const uint8_t* b,
+                       const uint8_t* e, uint16_t* rgba, const int32_t count) {
+    int32_t i = 0;
+#if defined(CONVERT_SSE2)
+    const __m128i one = _mm_set1_epi32(static_cast<int32_t>(kHalfOne << 16));
+    for (; i + 4 <= count; i += 4) {
+        const __m128 scale = rgbeScale(widen4(e + i));
+        const __m128i red = floatToHalf(rgbeChannel(r + i, scale));
+        const __m128i green = floatToHalf(rgbeChannel(g + i, scale));
+        const __m128i blue = floatToHalf(rgbeChannel(b + i, scale));
+
+        // the halves are below 0x8000, a pixel is two 32-bit words
+        const __m128i rg = _mm_or_si128(red, _mm_slli_epi32(green, 16));
+        const __m128i ba = _mm_or_si128(blue, one);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4),
+                         _mm_unpacklo_epi32(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4 + 8),
+                         _mm_unpackhi_epi32(rg, ba));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t scale = rgbeScale(widen4(e + i));
+        uint16x4x4_t pixels;
+        pixels.val[0] = vreinterpret_u16_f16(
+            vcvt_f16_f32(rgbeChannel(r + i, scale)));
+        pixels.val[1] = vreinterpret_u16_f16(
+            vcvt_f16_f32(rgbeChannel(g + i, scale)));
+        pixels.val[2] = vreinterpret_u16_f16(
+            vcvt_f16_f32(rgbeChannel(b + i, scale)));
+        pixels.val[3] = vdup_n_u16(kHalfOne);
+        vst4_u16(rgba + i * 4, pixels);
+    }
+#endif
+
+    for (; i < count; i++) {
+        const float scale = rgbeScale(e[i]);
+        rgba[i * 4 + 0] = floatToHalf((r[i] * kMantissaScale) * scale);
+        rgba[i * 4 + 1] = floatToHalf((g[i] * kMantissaScale) * scale);
+        rgba[i * 4 + 2] = floatToHalf((b[i] * kMantissaScale) * scale);
+        rgba[i * 4 + 3] = kHalfOne;
+    }
+}
+}  // namespace Dummy
@@ -1,4 +1,15 @@
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IDCT_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IDCT_NEON 1
+#endif
 
 const double PI = 3.14159265358979323846;
 const double PI_over_sixteen = PI / 16.0;
@@ -55,3 +66,344 @@ void IDCT8X8(const float G[64], float g[64]) {
     }
 }
 }  // namespace Dummy
+
+// Fixed-point IDCT of 8-bit samples, the islow method of the IJG with the
+// constants scaled by 4096 and the rotations folded into pairs of products.
+// Every path below computes the same integers.
+namespace {
+// even part, (row 2, row 6)
+constexpr int16_t kEven2[2] = {2217, 2217 - 7568};
+constexpr int16_t kEven3[2] = {2217 + 3135, 2217};
+// odd part, (row 7, row 3), (row 5, row 1) and (row 1 + row 7, row 3 + row 5)
+constexpr int16_t kOdd0[2] = {-8035 + 1223, -8035};
+constexpr int16_t kOdd2[2] = {-8035, -8035 + 12586};
+constexpr int16_t kOdd1[2] = {-1598 + 8410, -1598};
+constexpr int16_t kOdd3[2] = {-1598, -1598 + 6149};
+constexpr int16_t kOdd4[2] = {4816 - 3686, 4816};
+constexpr int16_t kOdd5[2] = {4816, 4816 - 10498};
+
+// the first pass keeps 2 more bits, the second one removes the scale of both
+// and adds the level shift
+constexpr int32_t kPass1Shift = 10;
+constexpr int32_t kPass1Bias = 1 << (kPass1Shift - 1);
+constexpr int32_t kPass2Shift = 17;
+constexpr int32_t kPass2Bias = (1 << (kPass2Shift - 1)) + (128 << kPass2Shift);
+
+#if defined(IDCT_SSE2)
+struct Wide {
+    __m128i lo;
+    __m128i hi;
+};
+
+inline Wide rotate(const __m128i x, const __m128i y, const int16_t c[2]) {
+    const __m128i constants = _mm_setr_epi16(c[0], c[1], c[0], c[1], c[0],
+                                             c[1], c[0], c[1]);
+    return {_mm_madd_epi16(_mm_unpacklo_epi16(x, y), constants),
+            _mm_madd_epi16(_mm_unpackhi_epi16(x, y), constants)};
+}
+
+// x * 4096
+inline Wide widen(const __m128i x) {
+    return {_mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), x), 4),
+            _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), x), 4)};
+}
+
+inline Wide add(const Wide& a, const Wide& b) {
+    return {_mm_add_epi32(a.lo, b.lo), _mm_add_epi32(a.hi, b.hi)};
+}
+
+inline Wide sub(const Wide& a, const Wide& b) {
+    return {_mm_sub_epi32(a.lo, b.lo), _mm_sub_epi32(a.hi, b.hi)};
+}
+
+template <int32_t Shift>
+inline void butterfly(const Wide& a, const Wide& b, const __m128i bias,
+                      __m128i& sum, __m128i& difference) {
+    const Wide biased = {_mm_add_epi32(a.lo, bias), _mm_add_epi32(a.hi, bias)};
+    const Wide s = add(biased, b);
+    const Wide d = sub(biased, b);
+    sum = _mm_packs_epi32(_mm_srai_epi32(s.lo, Shift),
+                          _mm_srai_epi32(s.hi, Shift));
+    difference = _mm_packs_epi32(_mm_srai_epi32(d.lo, Shift),
+                                 _mm_srai_epi32(d.hi, Shift));
+}
+
+// 1-D IDCT of the 8 lanes, row[i] holds the i-th input of every lane
+template <int32_t Shift>
+inline void idctPass(__m128i row[8], const __m128i bias) {
+    const Wide t2 = rotate(row[2], row[6], kEven2);
+    const Wide t3 = rotate(row[2], row[6], kEven3);
+    const Wide t0 = widen(_mm_add_epi16(row[0], row[4]));
+    const Wide t1 = widen(_mm_sub_epi16(row[0], row[4]));
+    const Wide x0 = add(t0, t3);
+    const Wide x3 = sub(t0, t3);
+    const Wide x1 = add(t1, t2);
+    const Wide x2 = sub(t1, t2);
+
+    const Wide y0 = rotate(row[7], row[3], kOdd0);
+    const Wide y2 = rotate(row[7], row[3], kOdd2);
+    const Wide y1 = rotate(row[5], row[1], kOdd1);
+    const Wide y3 = rotate(row[5], row[1], kOdd3);
+    const __m128i sum17 = _mm_add_epi16(row[1], row[7]);
+    const __m128i sum35 = _mm_add_epi16(row[3], row[5]);
+    const Wide y4 = rotate(sum17, sum35, kOdd4);
+    const Wide y5 = rotate(sum17, sum35, kOdd5);
+    const Wide x4 = add(y0, y4);
+    const Wide x5 = add(y1, y5);
+    const Wide x6 = add(y2, y5);
+    const Wide x7 = add(y3, y4);
+
+    butterfly<Shift>(x0, x7, bias, row[0], row[7]);
+    butterfly<Shift>(x1, x6, bias, row[1], row[6]);
+    butterfly<Shift>(x2, x5, bias, row[2], row[5]);
+    butterfly<Shift>(x3, x4, bias, row[3], row[4]);
+}
+
+inline void transpose(__m128i row[8]) {
+    const __m128i a0 = _mm_unpacklo_epi16(row[0], row[1]);
+    const __m128i a1 = _mm_unpackhi_epi16(row[0], row[1]);
+    const __m128i a2 = _mm_unpacklo_epi16(row[2], row[3]);
+    const __m128i a3 = _mm_unpackhi_epi16(row[2], row[3]);
+    const __m128i a4 = _mm_unpacklo_epi16(row[4], row[5]);
+    const __m128i a5 = _mm_unpackhi_epi16(row[4], row[5]);
+    const __m128i a6 = _mm_unpacklo_epi16(row[6], row[7]);
+    const __m128i a7 = _mm_unpackhi_epi16(row[6], row[7]);
+    const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+    row[0] = _mm_unpacklo_epi64(b0, b4);
+    row[1] = _mm_unpackhi_epi64(b0, b4);
+    row[2] = _mm_unpacklo_epi64(b1, b5);
+    row[3] = _mm_unpackhi_epi64(b1, b5);
+    row[4] = _mm_unpacklo_epi64(b2, b6);
+    row[5] = _mm_unpackhi_epi64(b2, b6);
+    row[6] = _mm_unpacklo_epi64(b3, b7);
+    row[7] = _mm_unpackhi_epi64(b3, b7);
+}
+#elif defined(IDCT_NEON)
+struct Wide {
+    int32x4_t lo;
+    int32x4_t hi;
+};
+
+inline Wide rotate(const int16x8_t x, const int16x8_t y, const int16_t c[2]) {
+    return {vmlal_n_s16(vmull_n_s16(vget_low_s16(x), c[0]), vget_low_s16(y),
+                        c[1]),
+            vmlal_n_s16(vmull_n_s16(vget_high_s16(x), c[0]),
+                        vget_high_s16(y), c[1])};
+}
+
+// x * 4096
+inline Wide widen(const int16x8_t x) {
+    return {vshll_n_s16(vget_low_s16(x), 12),
+            vshll_n_s16(vget_high_s16(x), 12)};
+}
+
+inline Wide add(const Wide& a, const Wide& b) {
+    return {vaddq_s32(a.lo, b.lo), vaddq_s32(a.hi, b.hi)};
+}
+
+inline Wide sub(const Wide& a, const Wide& b) {
+    return {vsubq_s32(a.lo, b.lo), vsubq_s32(a.hi, b.hi)};
+}
+
+template <int32_t Shift>
+inline void butterfly(const Wide& a, const Wide& b, const int32x4_t bias,
+                      int16x8_t& sum, int16x8_t& difference) {
+    const Wide biased = {vaddq_s32(a.lo, bias), vaddq_s32(a.hi, bias)};
+    const Wide s = add(biased, b);
+    const Wide d = sub(biased, b);
+    sum = vcombine_s16(vqmovn_s32(vshrq_n_s32(s.lo, Shift)),
+                       vqmovn_s32(vshrq_n_s32(s.hi, Shift)));
+    difference = vcombine_s16(vqmovn_s32(vshrq_n_s32(d.lo, Shift)),
+                              vqmovn_s32(vshrq_n_s32(d.hi, Shift)));
+}
+
+// 1-D IDCT of the 8 lanes, row[i] holds the i-th input of every lane
+template <int32_t Shift>
+inline void idctPass(int16x8_t row[8], const int32x4_t bias) {
+    const Wide t2 = rotate(row[2], row[6], kEven2);
+    const Wide t3 = rotate(row[2], row[6], kEven3);
+    const Wide t0 = widen(vaddq_s16(row[0], row[4]));
+    const Wide t1 = widen(vsubq_s16(row[0], row[4]));
+    const Wide x0 = add(t0, t3);
+    const Wide x3 = sub(t0, t3);
+    const Wide x1 = add(t1, t2);
+    const Wide x2 = sub(t1, t2);
+
+    const Wide y0 = rotate(row[7], row[3], kOdd0);
+    const Wide y2 = rotate(row[7], row[3], kOdd2);
+    const Wide y1 = rotate(row[5], row[1], kOdd1);
+    const Wide y3 = rotate(row[5], row[1], kOdd3);
+    const int16x8_t sum17 = vaddq_s16(row[1], row[7]);
+    const int16x8_t sum35 = vaddq_s16(row[3], row[5]);
+    const Wide y4 = rotate(sum17, sum35, kOdd4);
+    const Wide y5 = rotate(sum17, sum35, kOdd5);
+    const Wide x4 = add(y0, y4);
+    const Wide x5 = add(y1, y5);
+    const Wide x6 = add(y2, y5);
+    const Wide x7 = add(y3, y4);
+
+    butterfly<Shift>(x0, x7, bias, row[0], row[7]);
+    butterfly<Shift>(x1, x6, bias, row[1], row[6]);
+    butterfly<Shift>(x2, x5, bias, row[2], row[5]);
+    butterfly<Shift>(x3, x4, bias, row[3], row[4]);
+}
+
+inline int16x8_t combineLow(const int32x4_t a, const int32x4_t b) {
+    return vcombine_s16(vget_low_s16(vreinterpretq_s16_s32(a)),
+                        vget_low_s16(vreinterpretq_s16_s32(b)));
+}
+
+inline int16x8_t combineHigh(const int32x4_t a, const int32x4_t b) {
+    return vcombine_s16(vget_high_s16(vreinterpretq_s16_s32(a)),
+                        vget_high_s16(vreinterpretq_s16_s32(b)));
+}
+
+inline void transpose(int16x8_t row[8]) {
+    const int16x8x2_t t01 = vtrnq_s16(row[0], row[1]);
+    const int16x8x2_t t23 = vtrnq_s16(row[2], row[3]);
+    const int16x8x2_t t45 = vtrnq_s16(row[4], row[5]);
+    const int16x8x2_t t67 = vtrnq_s16(row[6], row[7]);
+    const int32x4x2_t u02 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]),
+                                      vreinterpretq_s32_s16(t23.val[0]));
+    const int32x4x2_t u13 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]),
+                                      vreinterpretq_s32_s16(t23.val[1]));
+    const int32x4x2_t u46 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]),
+                                      vreinterpretq_s32_s16(t67.val[0]));
+    const int32x4x2_t u57 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]),
+                                      vreinterpretq_s32_s16(t67.val[1]));
+    row[0] = combineLow(u02.val[0], u46.val[0]);
+    row[1] = combineLow(u13.val[0], u57.val[0]);
+    row[2] = combineLow(u02.val[1], u46.val[1]);
+    row[3] = combineLow(u13.val[1], u57.val[1]);
+    row[4] = combineHigh(u02.val[0], u46.val[0]);
+    row[5] = combineHigh(u13.val[0], u57.val[0]);
+    row[6] = combineHigh(u02.val[1], u46.val[1]);
+    row[7] = combineHigh(u13.val[1], u57.val[1]);
+}
+#else
+inline int32_t rotate(const int32_t x, const int32_t y, const int16_t c[2]) {
+    return x * c[0] + y * c[1];
+}
+
+// 1-D IDCT of the 8 inputs `stride` apart, the sums wrap around to 16 bits
+// like the SIMD paths
+template <int32_t Shift>
+inline void idct1D(const int16_t* s, const ptrdiff_t stride,
+                   const int32_t bias, int32_t out[8]) {
+    const int32_t s0 = s[0];
+    const int32_t s1 = s[stride];
+    const int32_t s2 = s[stride * 2];
+    const int32_t s3 = s[stride * 3];
+    const int32_t s4 = s[stride * 4];
+    const int32_t s5 = s[stride * 5];
+    const int32_t s6 = s[stride * 6];
+    const int32_t s7 = s[stride * 7];
+
+    const int32_t t2 = rotate(s2, s6, kEven2);
+    const int32_t t3 = rotate(s2, s6, kEven3);
+    const int32_t t0 = static_cast<int16_t>(s0 + s4) * 4096;
+    const int32_t t1 = static_cast<int16_t>(s0 - s4) * 4096;
+    const int32_t x0 = t0 + t3 + bias;
+    const int32_t x3 = t0 - t3 + bias;
+    const int32_t x1 = t1 + t2 + bias;
+    const int32_t x2 = t1 - t2 + bias;
+
+    const int32_t sum17 = static_cast<int16_t>(s1 + s7);
+    const int32_t sum35 = static_cast<int16_t>(s3 + s5);
+    const int32_t y4 = rotate(sum17, sum35, kOdd4);
+    const int32_t y5 = rotate(sum17, sum35, kOdd5);
+    const int32_t x4 = rotate(s7, s3, kOdd0) + y4;
+    const int32_t x5 = rotate(s5, s1, kOdd1) + y5;
+    const int32_t x6 = rotate(s7, s3, kOdd2) + y5;
+    const int32_t x7 = rotate(s5, s1, kOdd3) + y4;
+
+    out[0] = (x0 + x7) >> Shift;
+    out[7] = (x0 - x7) >> Shift;
+    out[1] = (x1 + x6) >> Shift;
+    out[6] = (x1 - x6) >> Shift;
+    out[2] = (x2 + x5) >> Shift;
+    out[5] = (x2 - x5) >> Shift;
+    out[3] = (x3 + x4) >> Shift;
+    out[4] = (x3 - x4) >> Shift;
+}
+#endif
+}  // namespace
+
+namespace Dummy {
+void IDCT8X8i16(const int16_t coefficients[64],
+                const uint16_t quantization[64], uint8_t* samples,
+                const int32_t pitch) {
+#if defined(IDCT_SSE2)
+    __m128i row[8];
+    for (int32_t i = 0; i < 8; i++) {
+        row[i] = _mm_mullo_epi16(
+            _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(coefficients + i * 8)),
+            _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(quantization + i * 8)));
+    }
+
+    idctPass<kPass1Shift>(row, _mm_set1_epi32(kPass1Bias));
+    transpose(row);
+    idctPass<kPass2Shift>(row, _mm_set1_epi32(kPass2Bias));
+    transpose(row);
+
+    for (int32_t i = 0; i < 8; i += 2) {
+        const __m128i packed = _mm_packus_epi16(row[i], row[i + 1]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(samples + i * pitch),
+                         packed);
+        _mm_storel_epi64(
+            reinterpret_cast<__m128i*>(samples + (i + 1) * pitch),
+            _mm_unpackhi_epi64(packed, packed));
+    }
+#elif defined(IDCT_NEON)
+    int16x8_t row[8];
+    for (int32_t i = 0; i < 8; i++) {
+        row[i] = vmulq_s16(
+            vld1q_s16(coefficients + i * 8),
+            vreinterpretq_s16_u16(vld1q_u16(quantization + i * 8)));
+    }
+
+    idctPass<kPass1Shift>(row, vdupq_n_s32(kPass1Bias));
+    transpose(row);
+    idctPass<kPass2Shift>(row, vdupq_n_s32(kPass2Bias));
+    transpose(row);
+
+    for (int32_t i = 0; i < 8; i++) {
+        vst1_u8(samples + i * pitch, vqmovun_s16(row[i]));
+    }
+#else
+    int16_t dequantized[64];
+    for (int32_t i = 0; i < 64; i++) {
+        dequantized[i] =
+            static_cast<int16_t>(coefficients[i] * quantization[i]);
+    }
+
+    // columns first, then rows
+    int16_t workspace[64];
+    int32_t out[8];
+    for (int32_t i = 0; i < 8; i++) {
+        idct1D<kPass1Shift>(dequantized + i, 8, kPass1Bias, out);
+        for (int32_t j = 0; j < 8; j++) {
+            workspace[j * 8 + i] =
+                static_cast<int16_t>(std::clamp(out[j], -32768, 32767));
+        }
+    }
+
+    for (int32_t i = 0; i < 8; i++) {
+        idct1D<kPass2Shift>(workspace + i * 8, 1, kPass2Bias, out);
+        for (int32_t j = 0; j < 8; j++) {
+            samples[i * pitch + j] =
+                static_cast<uint8_t>(std::clamp(out[j], 0, 255));
+        }
+    }
+#endif
+}
+}  // namespace Dummy
@@ -1,6 +1,15 @@
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATRIX_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MATRIX_NEON 1
+#endif
+
 using namespace std;
 
 namespace Dummy {
@@ -22,4 +31,38 @@ void MatrixExchangeYandZ(float *data, const int32_t rows, const int32_t cols) {
         *p ^= *q;
     }
 }
+
+void CopyMatrices4X4f(const float *const *src, float *dst, const size_t stride,
+                      const size_t count) {
+#if defined(MATRIX_SSE2)
+    // the destination is usually write combined memory shared with the GPU,
+    // which non-temporal stores fill without reading it into the cache
+    if ((reinterpret_cast<uintptr_t>(dst) & 15) == 0 && (stride & 3) == 0) {
+        for (size_t i = 0; i < count; i++) {
+            const float *s = src[i];
+            float *d = dst + i * stride;
+            _mm_stream_ps(d, _mm_loadu_ps(s));
+            _mm_stream_ps(d + 4, _mm_loadu_ps(s + 4));
+            _mm_stream_ps(d + 8, _mm_loadu_ps(s + 8));
+            _mm_stream_ps(d + 12, _mm_loadu_ps(s + 12));
+        }
+        // the stores are done before the buffer is handed to the GPU
+        _mm_sfence();
+        return;
+    }
+#elif defined(MATRIX_NEON)
+    for (size_t i = 0; i < count; i++) {
+        const float *s = src[i];
+        float *d = dst + i * stride;
+        vst1q_f32(d, vld1q_f32(s));
+        vst1q_f32(d + 4, vld1q_f32(s + 4));
+        vst1q_f32(d + 8, vld1q_f32(s + 8));
+        vst1q_f32(d + 12, vld1q_f32(s + 12));
+    }
+    return;
+#endif
+    for (size_t i = 0; i < count; i++) {
+        memcpy(dst + i * stride, src[i], sizeof(float) * 16);
+    }
+}
 }  // namespace Dummy
\ No newline at end of file
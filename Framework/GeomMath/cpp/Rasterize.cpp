@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+namespace Dummy {
+void RasterizeTriangleDepth(float* depth, const int32_t pitch,
+                            const int32_t min_x, const int32_t min_y,
+                            const int32_t max_x, const int32_t max_y,
+                            const float edges[9], const float depth_plane[3]) {
+    for (int32_t y = min_y; y <= max_y; y++) {
+        const float py = (float)y + 0.5f;
+        for (int32_t x = min_x; x <= max_x; x++) {
+            const float px = (float)x + 0.5f;
+            const float e0 = edges[0] * px + edges[1] * py + edges[2];
+            const float e1 = edges[3] * px + edges[4] * py + edges[5];
+            const float e2 = edges[6] * px + edges[7] * py + edges[8];
+            if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+                const float z = depth_plane[0] * px + depth_plane[1] * py +
+                                depth_plane[2];
+                float& d = depth[y * pitch + x];
+                d = min(d, z);
+            }
+        }
+    }
+}
+
+void DownsampleDepthMax(const float* src, const int32_t src_width,
+                        const int32_t src_height, float* dst,
+                        const int32_t dst_width, const int32_t dst_height) {
+    for (int32_t y = 0; y < dst_height; y++) {
+        const int32_t y0 = min(y * 2, src_height - 1);
+        const int32_t y1 = min(y * 2 + 1, src_height - 1);
+        for (int32_t x = 0; x < dst_width; x++) {
+            const int32_t x0 = min(x * 2, src_width - 1);
+            const int32_t x1 = min(x * 2 + 1, src_width - 1);
+            const float d0 =
+                max(src[y0 * src_width + x0], src[y0 * src_width + x1]);
+            const float d1 =
+                max(src[y1 * src_width + x0], src[y1 * src_width + x1]);
+            dst[y * dst_width + x] = max(d0, d1);
+        }
+    }
+}
+}  // namespace Dummy
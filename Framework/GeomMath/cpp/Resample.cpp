@@ -0,0 +1,69 @@
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLE_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RESAMPLE_NEON 1
+#endif
+
+namespace Dummy {
+void ResampleRowRGBAf(const float* src, float* dst, const int32_t dst_width,
+                      const int32_t* taps, const float* weights,
+                      const int32_t tap_count) {
+    for (int32_t x = 0; x < dst_width; x++) {
+        const int32_t* tap = taps + x * tap_count;
+        const float* weight = weights + x * tap_count;
+#if defined(RESAMPLE_SSE2)
+        // a pixel is a vector
+        __m128 sum = _mm_setzero_ps();
+        for (int32_t k = 0; k < tap_count; k++) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]),
+                                             _mm_loadu_ps(src + tap[k] * 4)));
+        }
+        _mm_storeu_ps(dst + x * 4, sum);
+#elif defined(RESAMPLE_NEON)
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int32_t k = 0; k < tap_count; k++) {
+            sum = vmlaq_n_f32(sum, vld1q_f32(src + tap[k] * 4), weight[k]);
+        }
+        vst1q_f32(dst + x * 4, sum);
+#else
+        float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int32_t k = 0; k < tap_count; k++) {
+            for (int32_t c = 0; c < 4; c++) {
+                sum[c] += weight[k] * src[tap[k] * 4 + c];
+            }
+        }
+        for (int32_t c = 0; c < 4; c++) {
+            dst[x * 4 + c] = sum[c];
+        }
+#endif
+    }
+}
+
+void AccumulateRowf(const float* src, const float weight, float* dst,
+                    const int32_t count) {
+    int32_t i = 0;
+#if defined(RESAMPLE_SSE2)
+    const __m128 w = _mm_set1_ps(weight);
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(dst + i,
+                      _mm_add_ps(_mm_loadu_ps(dst + i),
+                                 _mm_mul_ps(w, _mm_loadu_ps(src + i))));
+        _mm_storeu_ps(dst + i + 4,
+                      _mm_add_ps(_mm_loadu_ps(dst + i + 4),
+                                 _mm_mul_ps(w, _mm_loadu_ps(src + i + 4))));
+    }
+#elif defined(RESAMPLE_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i,
+                  vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), weight));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] += weight * src[i];
+    }
+}
+}  // namespace Dummy
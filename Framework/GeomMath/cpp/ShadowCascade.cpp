@@ -0,0 +1,34 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+namespace Dummy {
+void SplitCascades(float splits[], const int32_t count, const float near_plane,
+                   const float far_plane, const float lambda) {
+    const float ratio = far_plane / near_plane;
+    const float range = far_plane - near_plane;
+    for (int32_t i = 0; i <= count; i++) {
+        const float t = (float)i / count;
+        const float log_split = near_plane * pow(ratio, t);
+        const float uniform_split = near_plane + range * t;
+        splits[i] = lambda * log_split + (1.0f - lambda) * uniform_split;
+    }
+}
+
+void FitCascadeSpheres(const float splits[], const int32_t count,
+                       const float tan_half_fov_x, const float tan_half_fov_y,
+                       float depths[], float radii[]) {
+    const float k2 =
+        tan_half_fov_x * tan_half_fov_x + tan_half_fov_y * tan_half_fov_y;
+    for (int32_t i = 0; i < count; i++) {
+        const float n = splits[i];
+        const float f = splits[i + 1];
+        const float d = min(0.5f * (n + f) * (1.0f + k2), f);
+        const float dz = f - d;
+        depths[i] = d;
+        radii[i] = sqrt(dz * dz + k2 * f * f);
+    }
+}
+}  // namespace Dummy
@@ -44,13 +44,49 @@ void Transpose(const float* a, float* r, const uint32_t row_count,
                const uint32_t column_count);
 void BuildIdentityMatrix(float* data, const int32_t n);
 void MatrixExchangeYandZ(float* data, const int32_t rows, const int32_t cols);
+void CopyMatrices4X4f(const float* const* src, float* dst, const size_t stride,
+                      const size_t count);
 bool InverseMatrix3X3f(float matrix[9]);
 bool InverseMatrix4X4f(float matrix[16]);
 void DCT8X8(const float g[64], float G[64]);
 void IDCT8X8(const float G[64], float g[64]);
+void IDCT8X8i16(const int16_t coefficients[64],
+                const uint16_t quantization[64], uint8_t* samples,
+                const int32_t pitch);
+void ConvertYCbCr2RGBA8(const uint8_t* y, const uint8_t* cb, const uint8_t* cr,
+                        uint8_t* rgba, const int32_t count);
+void ConvertRGBE2RGBf(const uint8_t* r, const uint8_t* g, const uint8_t* b,
+                      const uint8_t* e, float* rgb, const int32_t count);
+void ConvertRGBE2RGBAh(const uint8_t* r, const uint8_t* g, const uint8_t* b,
+                       const uint8_t* e, uint16_t* rgba, const int32_t count);
 void Absolute(float* result, const float* a, const size_t count);
 void Pow(const float* v, const size_t count, const float exponent,
          float* result);
+void RasterizeTriangleDepth(float* depth, const int32_t pitch,
+                            const int32_t min_x, const int32_t min_y,
+                            const int32_t max_x, const int32_t max_y,
+                            const float edges[9], const float depth_plane[3]);
+void DownsampleDepthMax(const float* src, const int32_t src_width,
+                        const int32_t src_height, float* dst,
+                        const int32_t dst_width, const int32_t dst_height);
+void ResampleRowRGBAf(const float* src, float* dst, const int32_t dst_width,
+                      const int32_t* taps, const float* weights,
+                      const int32_t tap_count);
+void AccumulateRowf(const float* src, const float weight, float* dst,
+                    const int32_t count);
+void ConvertUnorm8ToFloat(const uint8_t* src, float* dst, const int32_t count);
+void ConvertFloatToUnorm8(const float* src, uint8_t* dst, const int32_t count);
+void ConvertUnorm16ToFloat(const uint16_t* src, float* dst,
+                           const int32_t count);
+void ConvertFloatToUnorm16(const float* src, uint16_t* dst,
+                           const int32_t count);
+void ConvertHalfToFloat(const uint16_t* src, float* dst, const int32_t count);
+void ConvertFloatToHalf(const float* src, uint16_t* dst, const int32_t count);
+void SplitCascades(float splits[], const int32_t count, const float near_plane,
+                   const float far_plane, const float lambda);
+void FitCascadeSpheres(const float splits[], const int32_t count,
+                       const float tan_half_fov_x, const float tan_half_fov_y,
+                       float depths[], float radii[]);
 #ifdef USE_ISPC
 } /* end extern C */
 #endif
@@ -765,6 +801,17 @@ inline void ExchangeYandZ(Matrix<T, ROWS, COLS>& matrix) {
 #endif
 }
 
+// Copies `count` matrices to `dst`, `stride` floats apart, such as into a
+// constant buffer mapped for the GPU
+inline void CopyMatrices4X4f(const float* const* src, float* dst,
+                             const size_t stride, const size_t count) {
+#ifdef USE_ISPC
+    ispc::CopyMatrices4X4f(src, dst, stride, count);
+#else
+    Dummy::CopyMatrices4X4f(src, dst, stride, count);
+#endif
+}
+
 inline void BuildViewLHMatrix(Matrix4X4f& result, const Vector3f position,
                               const Vector3f lookAt, const Vector3f up) {
     Vector3f zAxis, xAxis, yAxis;
@@ -1059,6 +1106,154 @@ inline Matrix8X8f IDCT8X8(const Matrix8X8f& matrix) {
     return result;
 }
 
+// Dequantizes a block of coefficients in natural order and transforms it
+// into 8-bit samples with the level shift, `pitch` bytes apart per row.
+// Fixed point, within 1 of the float version rounded.
+inline void IDCT8X8(const int16_t coefficients[64],
+                    const uint16_t quantization[64], uint8_t* samples,
+                    const int32_t pitch) {
+#ifdef USE_ISPC
+    ispc::IDCT8X8i16(coefficients, quantization, samples, pitch);
+#else
+    Dummy::IDCT8X8i16(coefficients, quantization, samples, pitch);
+#endif
+}
+
+inline void RasterizeTriangleDepth(float* depth, const int32_t pitch,
+                                   const int32_t min_x, const int32_t min_y,
+                                   const int32_t max_x, const int32_t max_y,
+                                   const float edges[9],
+                                   const float depth_plane[3]) {
+#ifdef USE_ISPC
+    ispc::RasterizeTriangleDepth(depth, pitch, min_x, min_y, max_x, max_y,
+                                 edges, depth_plane);
+#else
+    Dummy::RasterizeTriangleDepth(depth, pitch, min_x, min_y, max_x, max_y,
+                                  edges, depth_plane);
+#endif
+}
+
+inline void DownsampleDepthMax(const float* src, const int32_t src_width,
+                               const int32_t src_height, float* dst,
+                               const int32_t dst_width,
+                               const int32_t dst_height) {
+#ifdef USE_ISPC
+    ispc::DownsampleDepthMax(src, src_width, src_height, dst, dst_width,
+                             dst_height);
+#else
+    Dummy::DownsampleDepthMax(src, src_width, src_height, dst, dst_width,
+                              dst_height);
+#endif
+}
+
+// Filters a row of RGBA float pixels. Output pixel x is the sum of the
+// input pixels taps[x * tap_count + k] weighted by weights[x * tap_count + k]
+inline void ResampleRowRGBAf(const float* src, float* dst,
+                             const int32_t dst_width, const int32_t* taps,
+                             const float* weights, const int32_t tap_count) {
+#ifdef USE_ISPC
+    ispc::ResampleRowRGBAf(src, dst, dst_width, taps, weights, tap_count);
+#else
+    Dummy::ResampleRowRGBAf(src, dst, dst_width, taps, weights, tap_count);
+#endif
+}
+
+// dst += weight * src for count floats
+inline void AccumulateRowf(const float* src, const float weight, float* dst,
+                           const int32_t count) {
+#ifdef USE_ISPC
+    ispc::AccumulateRowf(src, weight, dst, count);
+#else
+    Dummy::AccumulateRowf(src, weight, dst, count);
+#endif
+}
+
+// Splits the view depth range [near_plane, far_plane] into count cascades,
+// the logarithmic splits blended with the uniform ones by lambda. splits
+// receives the count + 1 boundaries.
+inline void SplitCascades(float splits[], const int32_t count,
+                          const float near_plane, const float far_plane,
+                          const float lambda) {
+#ifdef USE_ISPC
+    ispc::SplitCascades(splits, count, near_plane, far_plane, lambda);
+#else
+    Dummy::SplitCascades(splits, count, near_plane, far_plane, lambda);
+#endif
+}
+
+// Bounding spheres of the slices of a symmetric view frustum between
+// consecutive splits, centered on the view axis at depths[i].
+inline void FitCascadeSpheres(const float splits[], const int32_t count,
+                              const float tan_half_fov_x,
+                              const float tan_half_fov_y, float depths[],
+                              float radii[]) {
+#ifdef USE_ISPC
+    ispc::FitCascadeSpheres(splits, count, tan_half_fov_x, tan_half_fov_y,
+                            depths, radii);
+#else
+    Dummy::FitCascadeSpheres(splits, count, tan_half_fov_x, tan_half_fov_y,
+                             depths, radii);
+#endif
+}
+
+// Builds the shadow cascades of a directional light shining along
+// light_direction, for a camera at camera_position looking along
+// camera_forward. view only rotates into the light space and is shared by
+// the cascades. Each projection bounds the sphere fitted to a slice of the
+// camera frustum, which keeps its size as the camera turns, and moves by
+// whole texels of a shadow map of the given resolution only, so the
+// shadows do not shimmer as the camera moves. Casters up to caster_distance
+// towards the light are kept in front of the spheres.
+inline void BuildShadowCascades(Matrix4X4f& view, Matrix4X4f projections[],
+                                const float splits[], const int32_t count,
+                                const Vector3f& camera_position,
+                                const Vector3f& camera_forward,
+                                const float tan_half_fov_x,
+                                const float tan_half_fov_y,
+                                const Vector3f& light_direction,
+                                const uint32_t resolution,
+                                const float caster_distance,
+                                const bool opengl_clip_space) {
+    std::vector<float> depths(count);
+    std::vector<float> radii(count);
+    FitCascadeSpheres(splits, count, tan_half_fov_x, tan_half_fov_y,
+                      depths.data(), radii.data());
+
+    const Vector3f origin = {0.0f, 0.0f, 0.0f};
+    const Vector3f up = (std::abs(light_direction[2]) < 0.9f)
+                            ? Vector3f({0.0f, 0.0f, 1.0f})
+                            : Vector3f({0.0f, 1.0f, 0.0f});
+    BuildViewRHMatrix(view, origin, light_direction, up);
+
+    for (int32_t i = 0; i < count; i++) {
+        Vector4f center = {
+            camera_position[0] + camera_forward[0] * depths[i],
+            camera_position[1] + camera_forward[1] * depths[i],
+            camera_position[2] + camera_forward[2] * depths[i], 1.0f};
+        Transform(center, view);
+
+        // rounded up so float noise does not change the texel size
+        const float radius = std::ceil(radii[i] * 16.0f) / 16.0f;
+        const float texel = 2.0f * radius / resolution;
+        const float x = std::floor(center[0] / texel) * texel;
+        const float y = std::floor(center[1] / texel) * texel;
+
+        // the light looks down the -z axis
+        const float near_plane = -center[2] - radius - caster_distance;
+        const float far_plane = -center[2] + radius;
+
+        if (opengl_clip_space) {
+            BuildOpenglOrthographicRHMatrix(projections[i], x - radius,
+                                            x + radius, y + radius, y - radius,
+                                            near_plane, far_plane);
+        } else {
+            BuildOrthographicRHMatrix(projections[i], x - radius, x + radius,
+                                      y + radius, y - radius, near_plane,
+                                      far_plane);
+        }
+    }
+}
+
 using Point2D = Vector<float, 2>;
 using Point2DPtr = std::shared_ptr<Point2D>;
 using Point2DList = std::vector<Point2DPtr>;
@@ -20,7 +20,9 @@ _Interface_ IGraphicsManager : _inherits_ IRuntimeModule {
         const std::shared_ptr<PipelineState>& pipelineState,
         const Frame& frame) = 0;
 
-    virtual void DrawBatch(const Frame& frame) = 0;
+    // draws the batches of the frame with these indices, in that order
+    virtual void DrawBatch(const Frame& frame,
+                           const std::vector<uint32_t>& batches) = 0;
 
     virtual void BeginPass(Frame& frame) = 0;
     virtual void EndPass(Frame& frame) = 0;
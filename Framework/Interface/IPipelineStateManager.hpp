@@ -51,5 +51,10 @@ _Interface_ IPipelineStateManager : _inherits_ IRuntimeModule {
 
     [[nodiscard]] virtual const std::shared_ptr<PipelineState> GetPipelineState(
         std::string name) const = 0;
+
+    // the permutation of a pipeline state whose pixel shader was compiled
+    // with the material features of the key, see ShaderVariant.hpp
+    [[nodiscard]] virtual const std::shared_ptr<PipelineState>
+    GetPipelineStateVariant(std::string name, uint32_t key) = 0;
 };
 }  // namespace My
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "FrameRingAllocator.hpp"
+
+#include <cassert>
+
+using namespace My;
+using namespace std;
+
+static size_t align_up(const size_t value, const size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+FrameRingAllocator::FrameRingAllocator(uint8_t* memory, const size_t size,
+                                       const uint32_t frame_count,
+                                       const size_t alignment,
+                                       IFrameFence* pFence)
+    : m_pMemory(memory),
+      m_szAlignment(alignment ? alignment : 1),
+      m_nFrameCount(frame_count),
+      m_pFence(pFence),
+      m_bPending(frame_count, false) {
+    assert(memory && frame_count > 0);
+
+    // keep every slice aligned
+    m_szSliceSize = size / frame_count / m_szAlignment * m_szAlignment;
+}
+
+void FrameRingAllocator::BeginFrame(const uint32_t frame_index) {
+    assert(frame_index < m_nFrameCount);
+    assert(!m_bInFrame);
+
+    if (m_pFence && m_bPending[frame_index]) {
+        m_pFence->Wait(frame_index);
+    }
+    m_bPending[frame_index] = false;
+
+    m_nCurrentFrame = frame_index;
+    m_szUsed = 0;
+    m_bInFrame = true;
+}
+
+void FrameRingAllocator::EndFrame() {
+    assert(m_bInFrame);
+
+    if (m_pFence) {
+        m_pFence->Signal(m_nCurrentFrame);
+        m_bPending[m_nCurrentFrame] = true;
+    }
+
+    m_bInFrame = false;
+}
+
+FrameRingAllocator::Allocation FrameRingAllocator::Allocate(const size_t size) {
+    assert(m_bInFrame);
+
+    Allocation allocation;
+
+    const size_t begin = align_up(m_szUsed, m_szAlignment);
+    if (begin + size > m_szSliceSize) return allocation;
+
+    allocation.offset = GetSliceOffset(m_nCurrentFrame) + begin;
+    allocation.data = m_pMemory + allocation.offset;
+    m_szUsed = begin + size;
+
+    return allocation;
+}
+
+size_t FrameRingAllocator::GetAvailableSize() const {
+    const size_t begin = align_up(m_szUsed, m_szAlignment);
+    return begin < m_szSliceSize ? m_szSliceSize - begin : 0;
+}
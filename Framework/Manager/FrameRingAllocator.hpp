@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Interface.hpp"
+
+namespace My {
+// Tells when the GPU is done with the commands of a frame. Back-ends
+// implement it with their own fences.
+_Interface_ IFrameFence {
+   public:
+    virtual ~IFrameFence() = default;
+
+    // called once the commands of the frame are submitted
+    virtual void Signal(const uint32_t frame_index) = 0;
+    // blocks until the GPU has consumed what was signaled for the frame
+    virtual void Wait(const uint32_t frame_index) = 0;
+};
+
+// A linear allocator over memory shared with the GPU (usually a
+// persistently mapped buffer), split into one slice per frame in flight.
+// Everything allocated for a frame is released at once when the same frame
+// index comes around again, after waiting on its fence.
+class FrameRingAllocator {
+   public:
+    struct Allocation {
+        // CPU address to write to, nullptr if the slice is full
+        uint8_t* data{nullptr};
+        // offset from the start of the buffer, to hand to the GPU
+        size_t offset{0};
+    };
+
+    FrameRingAllocator(uint8_t* memory, const size_t size,
+                       const uint32_t frame_count, const size_t alignment,
+                       IFrameFence* pFence = nullptr);
+
+    // Starts writing the slice of `frame_index`, waiting first for the GPU
+    // to be done with what was written there last time.
+    void BeginFrame(const uint32_t frame_index);
+    // Signals the fence of the current frame, once its commands have been
+    // submitted.
+    void EndFrame();
+
+    [[nodiscard]] Allocation Allocate(const size_t size);
+    // the largest size Allocate can still hand out in the current frame
+    [[nodiscard]] size_t GetAvailableSize() const;
+
+    [[nodiscard]] size_t GetAlignment() const { return m_szAlignment; }
+    [[nodiscard]] uint32_t GetFrameCount() const { return m_nFrameCount; }
+    [[nodiscard]] size_t GetSliceSize() const { return m_szSliceSize; }
+    [[nodiscard]] size_t GetSliceOffset(const uint32_t frame_index) const {
+        return frame_index * m_szSliceSize;
+    }
+    // bytes allocated in the current frame, including the padding
+    [[nodiscard]] size_t GetUsedSize() const { return m_szUsed; }
+    [[nodiscard]] uint32_t GetCurrentFrame() const { return m_nCurrentFrame; }
+
+   private:
+    uint8_t* m_pMemory;
+    size_t m_szAlignment;
+    size_t m_szSliceSize;
+    uint32_t m_nFrameCount;
+    IFrameFence* m_pFence;
+
+    uint32_t m_nCurrentFrame{0};
+    size_t m_szUsed{0};
+    bool m_bInFrame{false};
+    // whether a fence has been signaled for the frame and not waited yet
+    std::vector<bool> m_bPending;
+};
+}  // namespace My
@@ -1,11 +1,17 @@
 #include "GraphicsManager.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
+#include <future>
 #include <iostream>
+#include <set>
+#include <thread>
 
 #include "BRDFIntegrator.hpp"
 #include "BaseApplication.hpp"
 #include "SceneManager.hpp"
+#include "portable.hpp"
 
 #include "ForwardGeometryPass.hpp"
 #include "ShadowMapPass.hpp"
@@ -16,8 +22,103 @@
 using namespace My;
 using namespace std;
 
+namespace {
+// occluders are the biggest batches on the screen which are cheap enough to
+// be rasterized on the CPU
+constexpr size_t kMaxOccluderCount = 16;
+constexpr size_t kMaxOccluderTriangleCount = 4096;
+constexpr float kMinOccluderScreenSize = 0.1f;
+
+// not worth a worker thread below this
+constexpr size_t kMinBatchesPerCommandList = 16;
+
+// the cascades of the sun cover the view up to this distance at most
+constexpr float kMaxShadowDistance = 1000.0f;
+// blend of the logarithmic and the uniform cascade splits
+constexpr float kCascadeSplitLambda = 0.75f;
+
+static_assert(GfxConfiguration::kMaxGlobalShadowMapCount >=
+                  SHADOW_CASCADE_COUNT,
+              "the cascades of the sun are layers of the global shadow map");
+
+static_assert(LightClusterGrid::kDefaultCountX == LIGHT_CLUSTER_COUNT_X &&
+                  LightClusterGrid::kDefaultCountY == LIGHT_CLUSTER_COUNT_Y &&
+                  LightClusterGrid::kDefaultCountZ == LIGHT_CLUSTER_COUNT_Z,
+              "the shaders look up the clusters with the default grid");
+
+// Declares the draw passes, in the order of the vector they come in, and
+// the textures they use. The shadow maps and the back buffer outlive the
+// frame.
+void declare_draw_passes(RenderGraph& graph) {
+    using State = RenderGraphResourceState;
+
+    auto imported = [&](const char* name, const uint32_t width,
+                        const uint32_t height, const uint32_t layers,
+                        const State initial_state) {
+        RenderGraphResourceDesc desc;
+        desc.name = name;
+        desc.width = width;
+        desc.height = height;
+        desc.layers = layers;
+        desc.imported = true;
+        desc.initialState = initial_state;
+        return graph.AddResource(desc);
+    };
+
+    const uint32_t shadow_map =
+        imported("ShadowMap", GfxConfiguration::kShadowMapWidth,
+                 GfxConfiguration::kShadowMapHeight,
+                 GfxConfiguration::kMaxShadowMapCount, State::ShaderRead);
+    const uint32_t cube_shadow_map =
+        imported("CubeShadowMap", GfxConfiguration::kCubeShadowMapWidth,
+                 GfxConfiguration::kCubeShadowMapHeight,
+                 GfxConfiguration::kMaxCubeShadowMapCount * 6,
+                 State::ShaderRead);
+    const uint32_t global_shadow_map =
+        imported("GlobalShadowMap", GfxConfiguration::kGlobalShadowMapWidth,
+                 GfxConfiguration::kGlobalShadowMapHeight,
+                 GfxConfiguration::kMaxGlobalShadowMapCount,
+                 State::ShaderRead);
+    const uint32_t back_buffer =
+        imported("BackBuffer", 0, 0, 1, State::Present);
+
+    // the forward pass renders into a texture of the size of the canvas
+    RenderGraphResourceDesc scene_color;
+    scene_color.name = "SceneColor";
+    const uint32_t color = graph.AddResource(scene_color);
+    RenderGraphResourceDesc scene_depth;
+    scene_depth.name = "SceneDepth";
+    const uint32_t depth = graph.AddResource(scene_depth);
+
+    graph.AddPass({"ShadowMap",
+                   RenderGraphQueue::Graphics,
+                   {},
+                   {{shadow_map, State::DepthWrite},
+                    {cube_shadow_map, State::DepthWrite},
+                    {global_shadow_map, State::DepthWrite}}});
+    graph.AddPass({"ForwardGeometry",
+                   RenderGraphQueue::Graphics,
+                   {{shadow_map, State::ShaderRead},
+                    {cube_shadow_map, State::ShaderRead},
+                    {global_shadow_map, State::ShaderRead}},
+                   {{color, State::RenderTarget}, {depth, State::DepthWrite}}});
+    graph.AddPass({"Overlay",
+                   RenderGraphQueue::Graphics,
+                   {{color, State::ShaderRead}},
+                   {{back_buffer, State::RenderTarget}}});
+}
+}  // namespace
+
 GraphicsManager::GraphicsManager() {
     m_Frames.resize(GfxConfiguration::kMaxInFlightFrameCount);
+    m_nMaxRecordingJobs = std::max(1u, thread::hardware_concurrency());
+
+    m_RenderTargetPool.SetCreateTextureCB(
+        [this](const RenderTargetDesc& desc, TextureBase& texture) {
+            createRenderTarget(desc, texture);
+        });
+    m_RenderTargetPool.SetReleaseTextureCB(
+        [this](TextureBase& texture) { ReleaseTexture(texture); });
 }
 
 int GraphicsManager::Initialize() {
@@ -36,16 +137,26 @@ int GraphicsManager::Initialize() {
 #endif
         // m_DispatchPasses.push_back(make_shared<RayTracePass>(this,
         // pPipelineStateMgr));
-        m_DrawPasses.push_back(
-            make_shared<ShadowMapPass>(this, pPipelineStateMgr));
-
         auto forward_pass = make_shared<ForwardGeometryPass>(this, pPipelineStateMgr);
 
         forward_pass->EnableRenderToTexture();
 
-        m_DrawPasses.push_back(forward_pass);
-        m_DrawPasses.push_back(
-            make_shared<OverlayPass>(this, pPipelineStateMgr));
+        const vector<shared_ptr<IDrawPass>> draw_passes = {
+            make_shared<ShadowMapPass>(this, pPipelineStateMgr), forward_pass,
+            make_shared<OverlayPass>(this, pPipelineStateMgr)};
+
+        m_RenderGraph.Clear();
+        declare_draw_passes(m_RenderGraph);
+        if (m_RenderGraph.Compile(m_canvasWidth, m_canvasHeight)) {
+            for (const uint32_t pass : m_RenderGraph.GetPassOrder()) {
+                m_DrawPasses.push_back(draw_passes[pass]);
+            }
+        } else {
+            cerr << "[GraphicsManager] the draw passes depend on each other "
+                    "in a cycle"
+                 << endl;
+            result = -1;
+        }
     }
 
     InitConstants();
@@ -57,12 +168,15 @@ int GraphicsManager::Initialize() {
 
 void GraphicsManager::Finalize() {
     EndScene();
+    m_RenderTargetPool.Clear();
 }
 
 void GraphicsManager::Tick() {
     auto pSceneManager =
         dynamic_cast<BaseApplication*>(m_pApp)->GetSceneManager();
 
+    m_RenderTargetPool.BeginFrame();
+
     if (pSceneManager) {
         auto rev = pSceneManager->GetSceneRevision();
         if (rev == 0) return;  // scene is not loaded yet
@@ -82,6 +196,11 @@ void GraphicsManager::Tick() {
 
     UpdateConstants();
 
+    auto& stats = m_Frames[m_nFrameIndex].stats;
+    stats.renderTargetMemory = m_RenderTargetPool.GetAllocatedMemory();
+    stats.steadyRenderTargetMemory = m_RenderTargetPool.GetSteadyStateMemory();
+    stats.peakRenderTargetMemory = m_RenderTargetPool.GetPeakMemory();
+
     BeginFrame(m_Frames[m_nFrameIndex]);
     ImGui::NewFrame();
     Draw();
@@ -102,54 +221,37 @@ void GraphicsManager::createFramebuffers() {
     assert(m_pApp);
     auto conf = m_pApp->GetConfiguration();
 
-    for (int32_t i = 0; i < GfxConfiguration::kMaxInFlightFrameCount; i++) {
-        for (int32_t j = 0; j < m_Frames[i].colorTextures.size(); j++) {
-            if (j == 0) {
-                ReleaseTexture(m_Frames[i].colorTextures[0]);
-            } else {
-                if (i == 0) {
-                    ReleaseTexture(m_Frames[0].colorTextures[j]);
-                }
-            }
-        }
-
-        m_Frames[i].colorTextures.clear();
-    }
+    releaseFramebuffers();
 
-    if (m_Frames[0].depthTexture.handler) {
-        ReleaseTexture(m_Frames[0].depthTexture);
-    }
+    RenderTargetDesc color_desc;
+    color_desc.width = m_canvasWidth;
+    color_desc.height = m_canvasHeight;
+    color_desc.format = PIXEL_FORMAT::RGBA8;
 
     for (int32_t i = 0; i < GfxConfiguration::kMaxInFlightFrameCount; i++) {
         Texture2D color_texture;
-        color_texture.width = m_canvasWidth;
-        color_texture.height = m_canvasHeight;
-        color_texture.mips = 1;
-        color_texture.pixel_format = PIXEL_FORMAT::RGBA8;
-        color_texture.samples = 1;
-
-        GenerateTexture(color_texture);
+        m_RenderTargetPool.Acquire(color_desc, color_texture);
 
         m_Frames[i].colorTextures.push_back(color_texture);
 
         if (i == 0) {
             // Generate msaa intermediate RT
             if (conf.msaaSamples > 1) {
-                color_texture.samples = conf.msaaSamples;
-                GenerateTexture(color_texture);
+                RenderTargetDesc msaa_desc = color_desc;
+                msaa_desc.samples = conf.msaaSamples;
+                m_RenderTargetPool.Acquire(msaa_desc, color_texture);
                 m_Frames[0].colorTextures.push_back(color_texture);
                 m_Frames[0].enableMSAA = true;
             }
 
             // Generate depth RT
-            Texture2D depth_buffer;
-            depth_buffer.width = m_canvasWidth;
-            depth_buffer.height = m_canvasHeight;
-            depth_buffer.mips = 1;
-            depth_buffer.pixel_format = PIXEL_FORMAT::D32;
-            depth_buffer.samples = conf.msaaSamples;
+            RenderTargetDesc depth_desc = color_desc;
+            depth_desc.format = PIXEL_FORMAT::D32;
+            depth_desc.samples = conf.msaaSamples;
+            depth_desc.usage = RenderTargetUsage::Depth;
 
-            GenerateTexture(depth_buffer);
+            Texture2D depth_buffer;
+            m_RenderTargetPool.Acquire(depth_desc, depth_buffer);
 
             m_Frames[0].depthTexture = depth_buffer;
         } else {
@@ -160,6 +262,54 @@ void GraphicsManager::createFramebuffers() {
     }
 }
 
+void GraphicsManager::releaseFramebuffers() {
+    // the textures shared by the frames are released once, which the pool
+    // ignores
+    for (auto& frame : m_Frames) {
+        for (const auto& texture : frame.colorTextures) {
+            m_RenderTargetPool.Release(texture);
+        }
+        frame.colorTextures.clear();
+
+        m_RenderTargetPool.Release(frame.depthTexture);
+        frame.depthTexture = Texture2D();
+    }
+}
+
+void GraphicsManager::createRenderTarget(const RenderTargetDesc& desc,
+                                         TextureBase& texture) {
+    auto describe = [&desc](TextureBase& texture) {
+        texture.width = desc.width;
+        texture.height = desc.height;
+        texture.mips = 1;
+        texture.pixel_format = desc.format;
+        texture.samples = desc.samples;
+    };
+
+    switch (desc.type) {
+        case RenderTargetType::Texture2D: {
+            Texture2D texture_2d;
+            describe(texture_2d);
+            GenerateTexture(texture_2d);
+            texture = texture_2d;
+        } break;
+        case RenderTargetType::Texture2DArray: {
+            Texture2DArray texture_array;
+            describe(texture_array);
+            texture_array.size = desc.layers;
+            GenerateTextureArray(texture_array);
+            texture = texture_array;
+        } break;
+        case RenderTargetType::TextureCubeArray: {
+            TextureCubeArray texture_array;
+            describe(texture_array);
+            texture_array.size = desc.layers;
+            GenerateCubemapArray(texture_array);
+            texture = texture_array;
+        } break;
+    }
+}
+
 void GraphicsManager::ResizeCanvas(int32_t width, int32_t height) {
     if (m_canvasWidth != width || m_canvasHeight != height) {
         cerr << "[GraphicsManager] Resize Canvas to " << width << "x" << height
@@ -204,15 +354,83 @@ void GraphicsManager::UpdateConstants() {
                 memcpy(trans[3], simulated_result[3], sizeof(float) * 3);
             }
 
+            pDbc->moved = (pDbc->modelMatrix != trans);
             pDbc->modelMatrix = trans;
         } else {
-            pDbc->modelMatrix = *pDbc->node->GetCalculatedTransform();
+            const auto& trans = *pDbc->node->GetCalculatedTransform();
+            pDbc->moved = (pDbc->modelMatrix != trans);
+            pDbc->modelMatrix = trans;
         }
     }
 
     // Generate the view matrix based on the camera's position.
     CalculateCameraMatrix();
+    CalculateLods();
+    if (m_bCullsOccludedBatches) {
+        CullOccludedBatches();
+    }
+    CullClusters();
     CalculateLights();
+    CullShadowCasters();
+    GroupShaderVariants();
+    WriteBatchConstants();
+}
+
+void GraphicsManager::WriteBatchConstants() {
+    auto& frame = m_Frames[m_nFrameIndex];
+
+    if (!m_pBatchConstantAllocator) {
+        // the back-end passes the constants with each draw itself
+        for (auto& pDbc : frame.batchContexts) {
+            pDbc->constantsOffset = DrawBatchContext::kInvalidConstantsOffset;
+        }
+        return;
+    }
+
+    // the constants are only the model matrix, copied in one go
+    static_assert(sizeof(PerBatchConstants) == sizeof(Matrix4X4f));
+
+    // waits until the GPU is done with the last frame using the same slice
+    m_pBatchConstantAllocator->BeginFrame(m_nFrameIndex);
+
+    // the batches take one block, their constants `stride` apart
+    constexpr size_t size = sizeof(PerBatchConstants);
+    const size_t stride =
+        ALIGN(size, m_pBatchConstantAllocator->GetAlignment());
+    assert(stride % sizeof(float) == 0);
+
+    const size_t batch_count = frame.batchContexts.size();
+    const size_t available = m_pBatchConstantAllocator->GetAvailableSize();
+    const size_t fitting =
+        available < size ? 0 : (available - size) / stride + 1;
+    const size_t count = min(batch_count, fitting);
+    if (count < batch_count) {
+        cerr << "[GraphicsManager] Out of memory for the per batch constants"
+             << endl;
+    }
+
+    FrameRingAllocator::Allocation allocation;
+    if (count) {
+        allocation =
+            m_pBatchConstantAllocator->Allocate((count - 1) * stride + size);
+        assert(allocation.data);
+    }
+
+    m_BatchConstantSources.clear();
+    for (size_t i = 0; i < batch_count; i++) {
+        auto& pDbc = frame.batchContexts[i];
+        if (i < count) {
+            m_BatchConstantSources.push_back(pDbc->modelMatrix);
+            pDbc->constantsOffset = allocation.offset + i * stride;
+        } else {
+            // the offset of the last frame holds another batch's constants
+            pDbc->constantsOffset = DrawBatchContext::kInvalidConstantsOffset;
+        }
+    }
+
+    CopyMatrices4X4f(m_BatchConstantSources.data(),
+                     reinterpret_cast<float*>(allocation.data),
+                     stride / sizeof(float), count);
 }
 
 void GraphicsManager::Draw() {
@@ -231,6 +449,34 @@ void GraphicsManager::Draw() {
     }
 }
 
+void GraphicsManager::DrawBatch(const Frame& frame,
+                                const vector<uint32_t>& batches) {
+    const auto ranges = SplitBatchRanges(batches.size(), m_nMaxRecordingJobs,
+                                         kMinBatchesPerCommandList);
+    if (ranges.empty()) return;
+
+    const auto count = static_cast<uint32_t>(ranges.size());
+    if (!beginCommandLists(frame, count)) return;
+
+    if (count == 1) {
+        recordBatches(frame, batches, ranges[0], 0);
+    } else {
+        vector<future<void>> jobs;
+        jobs.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            jobs.push_back(async(launch::async, &GraphicsManager::recordBatches,
+                                 this, cref(frame), cref(batches),
+                                 cref(ranges[i]), i));
+        }
+
+        for (auto& job : jobs) {
+            job.get();
+        }
+    }
+
+    executeCommandLists(frame, count);
+}
+
 void GraphicsManager::CalculateCameraMatrix() {
     auto pSceneManager =
         dynamic_cast<BaseApplication*>(m_pApp)->GetSceneManager();
@@ -253,6 +499,8 @@ void GraphicsManager::CalculateCameraMatrix() {
             Vector3f position = {0.0f, -5.0f, 0.0f},
                      lookAt = {0.0f, 0.0f, 0.0f}, up = {0.0f, 0.0f, 1.0f};
             BuildViewRHMatrix(frameContext.viewMatrix, position, lookAt, up);
+
+            frameContext.camPos = {position[0], position[1], position[2], 0.0f};
         }
 
         float fieldOfView = PI / 3.0f;
@@ -285,14 +533,201 @@ void GraphicsManager::CalculateCameraMatrix() {
                                         fieldOfView, screenAspect,
                                         nearClipDistance, farClipDistance);
         }
+
+        frameContext.clusterDepthParams[0] = nearClipDistance;
+        frameContext.clusterDepthParams[1] = farClipDistance;
+    }
+}
+
+void GraphicsManager::CalculateLods() {
+    auto& frame = m_Frames[m_nFrameIndex];
+    const auto& frameContext = frame.frameContext;
+
+    frame.stats = DrawStatistics();
+
+    for (auto& pDbc : frame.batchContexts) {
+        // bounding sphere of the batch in view space
+        Vector4f center = {pDbc->boundingBox.centroid[0],
+                           pDbc->boundingBox.centroid[1],
+                           pDbc->boundingBox.centroid[2], 1.0f};
+        Transform(center, pDbc->modelMatrix);
+        Transform(center, frameContext.viewMatrix);
+
+        float scale = 0.0f;
+        for (int32_t i = 0; i < 3; i++) {
+            Vector3f axis({pDbc->modelMatrix[i][0], pDbc->modelMatrix[i][1],
+                           pDbc->modelMatrix[i][2]});
+            scale = std::max(scale, Length(axis));
+        }
+        const float radius = Length(pDbc->boundingBox.extent) * scale;
+
+        // projected radius relative to half of the screen height, the
+        // camera looks down the -z axis
+        const float depth = -center[2];
+        const float screen_size =
+            (depth > radius)
+                ? radius * frameContext.projectionMatrix[1][1] / depth
+                : 1.0f;
+
+        // step down one level each time the screen size halves
+        uint32_t lod = 0;
+        float threshold = 0.5f;
+        while (lod + 1 < pDbc->lodCount && screen_size < threshold) {
+            lod++;
+            threshold *= 0.5f;
+        }
+        pDbc->lod = lod;
+        pDbc->screenSize = screen_size;
+
+        frame.stats.batchCount++;
+        frame.stats.triangleCount += pDbc->triangleCount[lod];
+        frame.stats.fullDetailTriangleCount += pDbc->triangleCount[0];
+    }
+}
+
+void GraphicsManager::CullClusters() {
+    auto& frame = m_Frames[m_nFrameIndex];
+    const auto& frameContext = frame.frameContext;
+
+    for (auto& pDbc : frame.batchContexts) {
+        // only LOD 0 is split into clusters
+        if (pDbc->meshlets.empty() || pDbc->lod != 0 || pDbc->occluded)
+            continue;
+
+        // cull in the space of the mesh, the camera sits at the origin of
+        // the view space
+        Matrix4X4f model_view = pDbc->modelMatrix * frameContext.viewMatrix;
+        const Matrix4X4f model_view_projection =
+            model_view * frameContext.projectionMatrix;
+        if (!InverseMatrix4X4f(model_view)) {
+            // draw every cluster rather than the ones of an earlier frame
+            pDbc->indexRanges.assign(1, {0, pDbc->triangleCount[0] * 3});
+            continue;
+        }
+        const Vector3f camera_position(
+            {model_view[3][0], model_view[3][1], model_view[3][2]});
+
+        const auto visible =
+            My::CullMeshlets(pDbc->indexRanges, pDbc->meshlets,
+                             model_view_projection, camera_position);
+
+        uint32_t index_count = 0;
+        for (const auto& range : pDbc->indexRanges) {
+            index_count += range.count;
+        }
+
+        const auto meshlet_count =
+            static_cast<uint32_t>(pDbc->meshlets.size());
+        frame.stats.meshletCount += meshlet_count;
+        frame.stats.culledMeshletCount +=
+            meshlet_count - static_cast<uint32_t>(visible);
+        frame.stats.triangleCount -= pDbc->triangleCount[0] - index_count / 3;
+    }
+}
+
+void GraphicsManager::CullOccludedBatches() {
+    auto& frame = m_Frames[m_nFrameIndex];
+    const auto& frameContext = frame.frameContext;
+    const Matrix4X4f view_projection =
+        frameContext.viewMatrix * frameContext.projectionMatrix;
+
+    m_HiZBuffer.Clear();
+
+    auto pSceneManager =
+        dynamic_cast<BaseApplication*>(m_pApp)->GetSceneManager();
+
+    if (pSceneManager) {
+        auto& scene = pSceneManager->GetSceneForRendering();
+
+        vector<shared_ptr<DrawBatchContext>> candidates;
+        for (auto& pDbc : frame.batchContexts) {
+            if (pDbc->screenSize >= kMinOccluderScreenSize) {
+                candidates.push_back(pDbc);
+            }
+        }
+        sort(candidates.begin(), candidates.end(),
+             [](const auto& a, const auto& b) {
+                 return a->screenSize > b->screenSize;
+             });
+
+        // rasterize the full detail mesh of every selected node once
+        set<SceneGeometryNode*> occluders;
+        for (const auto& pDbc : candidates) {
+            if (occluders.size() >= kMaxOccluderCount) break;
+            if (occluders.count(pDbc->node.get())) continue;
+
+            const auto pGeometry =
+                scene->GetGeometry(pDbc->node->GetSceneObjectRef());
+            if (!pGeometry) continue;
+            const auto pMesh = pGeometry->GetMesh().lock();
+            if (!pMesh ||
+                pMesh->GetPrimitiveType() !=
+                    PrimitiveType::kPrimitiveTypeTriList ||
+                pMesh->GetTotalIndexCount() / 3 > kMaxOccluderTriangleCount)
+                continue;
+
+            size_t position_stride;
+            const float* positions = pMesh->GetPositions(position_stride);
+            if (!positions) continue;
+
+            occluders.insert(pDbc->node.get());
+
+            const Matrix4X4f model_view_projection =
+                pDbc->modelMatrix * view_projection;
+            for (size_t i = 0; i < pMesh->GetIndexGroupCount(); i++) {
+                const auto& index_array = pMesh->GetIndexArray(i);
+                switch (index_array.GetIndexType()) {
+                    case IndexDataType::kIndexDataTypeInt16:
+                        m_HiZBuffer.AddOccluder(
+                            positions, position_stride,
+                            reinterpret_cast<const uint16_t*>(
+                                index_array.GetData()),
+                            index_array.GetIndexCount(),
+                            model_view_projection);
+                        break;
+                    case IndexDataType::kIndexDataTypeInt32:
+                        m_HiZBuffer.AddOccluder(
+                            positions, position_stride,
+                            reinterpret_cast<const uint32_t*>(
+                                index_array.GetData()),
+                            index_array.GetIndexCount(),
+                            model_view_projection);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        frame.stats.occluderCount = static_cast<uint32_t>(occluders.size());
+    }
+
+    m_HiZBuffer.Rasterize();
+
+    for (auto& pDbc : frame.batchContexts) {
+        const auto& bbox = pDbc->boundingBox;
+        // no bounding box, keep it
+        if (Length(bbox.extent) == 0.0f) {
+            pDbc->occluded = false;
+            continue;
+        }
+
+        pDbc->occluded = !m_HiZBuffer.IsVisible(
+            bbox.centroid - bbox.extent, bbox.centroid + bbox.extent,
+            pDbc->modelMatrix * view_projection);
+
+        if (pDbc->occluded) {
+            frame.stats.occludedBatchCount++;
+            frame.stats.triangleCount -= pDbc->triangleCount[pDbc->lod];
+        }
     }
 }
 
 void GraphicsManager::CalculateLights() {
     DrawFrameContext& frameContext = m_Frames[m_nFrameIndex].frameContext;
-    auto& light_info = m_Frames[m_nFrameIndex].lightInfo;
+    auto& lights = m_Frames[m_nFrameIndex].lights;
 
-    frameContext.numLights = 0;
+    lights.clear();
 
     auto pSceneManager =
         dynamic_cast<BaseApplication*>(m_pApp)->GetSceneManager();
@@ -308,7 +743,9 @@ void GraphicsManager::CalculateLights() {
     if (pSceneManager) {
         auto& scene = pSceneManager->GetSceneForRendering();
         for (const auto& LightNode : scene->LightNodes) {
-            Light& light = light_info.lights[frameContext.numLights];
+            if (lights.size() >= MAX_CLUSTERED_LIGHTS) break;
+
+            Light light{};
             auto pLightNode = LightNode.second.lock();
             if (!pLightNode) continue;
             auto trans_ptr = pLightNode->GetCalculatedTransform();
@@ -361,31 +798,10 @@ void GraphicsManager::CalculateLights() {
 
                     light.lightPosition =
                         target - light.lightDirection * farClipDistance;
-                    Vector3f position;
-                    position.Set((float*)light.lightPosition);
-                    Vector3f lookAt;
-                    lookAt.Set((float*)target);
-                    Vector3f up = {0.0f, 0.0f, 1.0f};
-                    if (abs(light.lightDirection[0]) <= 0.2f &&
-                        abs(light.lightDirection[1]) <= 0.2f) {
-                        up = {0.1f, 0.1f, 1.0f};
-                    }
-                    BuildViewRHMatrix(view, position, lookAt, up);
 
-                    float sm_half_dist = min(farClipDistance * 0.25f, 800.0f);
-
-                    if (conf.fixOpenGLPerspectiveMatrix) {
-                        BuildOpenglOrthographicRHMatrix(projection, -sm_half_dist,
-                                                sm_half_dist, sm_half_dist,
-                                                -sm_half_dist, nearClipDistance,
-                                                farClipDistance + sm_half_dist);
-                    } else {
-                        BuildOrthographicRHMatrix(projection, -sm_half_dist,
-                                                sm_half_dist, sm_half_dist,
-                                                -sm_half_dist, nearClipDistance,
-                                                farClipDistance + sm_half_dist);
-
-                    }
+                    // the cascades are fitted to the camera once the shadow
+                    // maps are assigned, see CalculateShadowCascades
+                    BuildIdentityMatrix(view);
 
                     // notify shader about the infinity light by setting 4th
                     // field to 0
@@ -463,12 +879,265 @@ void GraphicsManager::CalculateLights() {
 
                 light.lightViewMatrix = view;
                 light.lightProjectionMatrix = projection;
-                frameContext.numLights++;
+                lights.push_back(light);
             } else {
                 assert(0);
             }
         }
     }
+
+    AssignShadowMaps();
+    CalculateShadowCascades();
+
+    // the shaders without clustering only loop over the LightInfo block
+    frameContext.numLights =
+        static_cast<int32_t>(std::min<size_t>(lights.size(), MAX_LIGHTS));
+
+    AssignLightClusters();
+}
+
+void GraphicsManager::AssignShadowMaps() {
+    auto& lights = m_Frames[m_nFrameIndex].lights;
+
+    // shadow casters go first, the shadow map passes index the LightInfo
+    // block which only holds the first MAX_LIGHTS
+    stable_partition(lights.begin(), lights.end(), [](const Light& light) {
+        return light.lightCastShadow != 0;
+    });
+
+    uint32_t shadowmap_index = 0;
+    uint32_t global_shadowmap_index = 0;
+    uint32_t cube_shadowmap_index = 0;
+
+    for (auto& light : lights) {
+        light.lightShadowMapIndex = -1;
+        if (!light.lightCastShadow) continue;
+
+        switch (light.lightType) {
+            case LightType::Omni:
+                if (cube_shadowmap_index <
+                    GfxConfiguration::kMaxCubeShadowMapCount) {
+                    light.lightShadowMapIndex = cube_shadowmap_index++;
+                }
+                break;
+            case LightType::Spot:
+            case LightType::Area:
+                if (shadowmap_index < GfxConfiguration::kMaxShadowMapCount) {
+                    light.lightShadowMapIndex = shadowmap_index++;
+                }
+                break;
+            case LightType::Infinity:
+                // a layer per cascade
+                if (global_shadowmap_index + SHADOW_CASCADE_COUNT <=
+                    GfxConfiguration::kMaxGlobalShadowMapCount) {
+                    light.lightShadowMapIndex = global_shadowmap_index;
+                    global_shadowmap_index += SHADOW_CASCADE_COUNT;
+                }
+                break;
+            default:
+                assert(0);
+        }
+
+        // out of shadow maps, the light is lit as if nothing was in the way
+        if (light.lightShadowMapIndex < 0) {
+            light.lightCastShadow = 0;
+        }
+    }
+}
+
+void GraphicsManager::CalculateShadowCascades() {
+    auto& frame = m_Frames[m_nFrameIndex];
+    auto& frameContext = frame.frameContext;
+
+    const float near_clip = frameContext.clusterDepthParams[0];
+    const float far_clip = frameContext.clusterDepthParams[1];
+    const float shadow_distance = std::min(far_clip, kMaxShadowDistance);
+
+    for (auto& light : frame.lights) {
+        if (light.lightType != LightType::Infinity || !light.lightCastShadow) {
+            continue;
+        }
+
+        // no camera yet, lit as if nothing was in the way
+        if (near_clip <= 0.0f || shadow_distance <= near_clip) {
+            light.lightCastShadow = 0;
+            light.lightShadowMapIndex = -1;
+            continue;
+        }
+
+        float splits[SHADOW_CASCADE_COUNT + 1];
+        SplitCascades(splits, SHADOW_CASCADE_COUNT, near_clip, shadow_distance,
+                      kCascadeSplitLambda);
+
+        // the camera looks down the -z axis of its view space
+        const auto& view = frameContext.viewMatrix;
+        const Vector3f position = {frameContext.camPos[0],
+                                   frameContext.camPos[1],
+                                   frameContext.camPos[2]};
+        const Vector3f forward = {-view[0][2], -view[1][2], -view[2][2]};
+        const Vector3f direction = {light.lightDirection[0],
+                                    light.lightDirection[1],
+                                    light.lightDirection[2]};
+
+        Matrix4X4f projections[SHADOW_CASCADE_COUNT];
+        BuildShadowCascades(light.lightViewMatrix, projections, splits,
+                            SHADOW_CASCADE_COUNT, position, forward,
+                            1.0f / frameContext.projectionMatrix[0][0],
+                            1.0f / frameContext.projectionMatrix[1][1],
+                            direction, GfxConfiguration::kGlobalShadowMapWidth,
+                            far_clip, frameContext.clip_space_type == 0);
+        light.lightProjectionMatrix = projections[0];
+
+        for (int32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            frameContext.shadowCascadeMatrices[i] =
+                light.lightViewMatrix * projections[i];
+            frameContext.shadowCascadeSplits[i] = splits[i + 1];
+        }
+    }
+}
+
+void GraphicsManager::CullShadowCasters() {
+    auto& frame = m_Frames[m_nFrameIndex];
+    const auto& frameContext = frame.frameContext;
+
+    // the lists are reused across frames to keep their storage
+    size_t list_count = 0;
+    bool cube_shadowmap_dirty = false;
+
+    for (int32_t i = 0; i < static_cast<int32_t>(frame.lights.size()); i++) {
+        const auto& light = frame.lights[i];
+
+        if (!light.lightCastShadow) continue;
+
+        const bool cascaded = (light.lightType == LightType::Infinity);
+        const int32_t layer_count = cascaded ? SHADOW_CASCADE_COUNT : 1;
+
+        for (int32_t j = 0; j < layer_count; j++) {
+            if (list_count == frame.shadowCasters.size()) {
+                frame.shadowCasters.emplace_back();
+            }
+            auto& casters = frame.shadowCasters[list_count++];
+            casters.lightIndex = i;
+            casters.layer = light.lightShadowMapIndex + j;
+            casters.batches.clear();
+
+            const Matrix4X4f view_projection =
+                cascaded ? frameContext.shadowCascadeMatrices[j]
+                         : light.lightViewMatrix * light.lightProjectionMatrix;
+
+            for (uint32_t k = 0; k < frame.batchContexts.size(); k++) {
+                const auto& dbc = *frame.batchContexts[k];
+                if (cascaded ? IsInShadowFrustum(view_projection, dbc)
+                             : IsShadowCaster(light, dbc)) {
+                    casters.batches.push_back(k);
+                } else {
+                    frame.stats.culledShadowCasterCount++;
+                }
+            }
+
+            casters.cached =
+                m_ShadowMapCache.Update(light, casters.layer, view_projection,
+                                        casters.batches, frame.batchContexts);
+            if (!casters.cached && light.lightType == LightType::Omni) {
+                cube_shadowmap_dirty = true;
+            }
+        }
+    }
+
+    frame.shadowCasters.resize(list_count);
+
+    for (auto& casters : frame.shadowCasters) {
+        // the cube maps are cleared all at once when the first one is drawn,
+        // so they are drawn again all together
+        if (cube_shadowmap_dirty &&
+            frame.lights[casters.lightIndex].lightType == LightType::Omni) {
+            casters.cached = false;
+        }
+
+        const auto count = static_cast<uint32_t>(casters.batches.size());
+        if (casters.cached) {
+            frame.stats.cachedShadowMapCount++;
+            frame.stats.cachedShadowCasterCount += count;
+        } else {
+            frame.stats.shadowCasterCount += count;
+        }
+    }
+}
+
+void GraphicsManager::GroupShaderVariants() {
+    auto& frame = m_Frames[m_nFrameIndex];
+
+    // the lists are kept between frames, so they keep their capacity
+    for (auto& variant : frame.shaderVariants) {
+        variant.batches.clear();
+    }
+
+    for (uint32_t i = 0; i < frame.batchContexts.size(); i++) {
+        const uint32_t key = frame.batchContexts[i]->shaderVariant;
+        auto it = lower_bound(frame.shaderVariants.begin(),
+                              frame.shaderVariants.end(), key,
+                              [](const ShaderVariantBatches& variant,
+                                 const uint32_t key) {
+                                  return variant.shaderVariant < key;
+                              });
+        if (it == frame.shaderVariants.end() || it->shaderVariant != key) {
+            it = frame.shaderVariants.insert(it, {key, {}});
+        }
+        it->batches.push_back(i);
+    }
+
+    // permutations no batch uses anymore
+    frame.shaderVariants.erase(
+        remove_if(frame.shaderVariants.begin(), frame.shaderVariants.end(),
+                  [](const ShaderVariantBatches& variant) {
+                      return variant.batches.empty();
+                  }),
+        frame.shaderVariants.end());
+}
+
+void GraphicsManager::AssignLightClusters() {
+    auto& frame = m_Frames[m_nFrameIndex];
+    auto& frameContext = frame.frameContext;
+
+    const float near_clip = frameContext.clusterDepthParams[0];
+    const float far_clip = frameContext.clusterDepthParams[1];
+    if (near_clip <= 0.0f || far_clip <= near_clip) {
+        // no camera yet, the shaders still find empty clusters
+        frame.lightClusters.assign(m_LightClusterGrid.GetClusterCount(),
+                                   {0, 0});
+        frame.lightClusterIndices.clear();
+        return;
+    }
+
+    const auto& projection = frameContext.projectionMatrix;
+    m_LightClusterGrid.Build(1.0f / projection[0][0], 1.0f / projection[1][1],
+                             near_clip, far_clip);
+    frameContext.clusterDepthParams[2] = m_LightClusterGrid.GetSliceScale();
+    frameContext.clusterDepthParams[3] = m_LightClusterGrid.GetSliceBias();
+
+    vector<LightClusterGrid::LightBounds> bounds;
+    bounds.reserve(frame.lights.size());
+    for (const auto& light : frame.lights) {
+        LightClusterGrid::LightBounds light_bounds;
+        if (light.lightType == LightType::Infinity) {
+            light_bounds.center = {0.0f, 0.0f, 0.0f};
+            light_bounds.radius = -1.0f;
+        } else {
+            Vector4f center = light.lightPosition;
+            center[3] = 1.0f;
+            Transform(center, frameContext.viewMatrix);
+            light_bounds.center = {center[0], center[1], center[2]};
+            light_bounds.radius = GetLightRange(light);
+        }
+        bounds.push_back(light_bounds);
+    }
+
+    m_LightClusterGrid.Assign(bounds, m_nMaxRecordingJobs, frame.lightClusters,
+                              frame.lightClusterIndices);
+
+    frame.stats.lightCount = static_cast<uint32_t>(frame.lights.size());
+    frame.stats.lightClusterIndexCount =
+        static_cast<uint32_t>(frame.lightClusterIndices.size());
 }
 
 void GraphicsManager::BeginScene(const Scene& scene) {
@@ -479,35 +1148,59 @@ void GraphicsManager::BeginScene(const Scene& scene) {
         pPass->EndPass(m_Frames[0]);
     }
 
-    // generate shadow map array
-    if (!m_Frames[0].frameContext.shadowMap.handler) {
-        m_Frames[0].frameContext.shadowMap.width = GfxConfiguration::kShadowMapWidth;
-        m_Frames[0].frameContext.shadowMap.height = GfxConfiguration::kShadowMapHeight;
-        m_Frames[0].frameContext.shadowMap.size = GfxConfiguration::kMaxShadowMapCount;
-        m_Frames[0].frameContext.shadowMap.pixel_format = PIXEL_FORMAT::D32;
-        GenerateTextureArray(m_Frames[0].frameContext.shadowMap);
-    }
-
-    // generate global shadow map array
-    if (!m_Frames[0].frameContext.globalShadowMap.handler) {
-        m_Frames[0].frameContext.globalShadowMap.width = GfxConfiguration::kShadowMapWidth;
-        m_Frames[0].frameContext.globalShadowMap.height = GfxConfiguration::kShadowMapHeight;
-        m_Frames[0].frameContext.globalShadowMap.size = GfxConfiguration::kMaxShadowMapCount;
-        m_Frames[0].frameContext.globalShadowMap.pixel_format = PIXEL_FORMAT::D32;
-        GenerateTextureArray(m_Frames[0].frameContext.globalShadowMap);
-    }
-
-    // generate cube shadow map array
-    if (!m_Frames[0].frameContext.cubeShadowMap.handler) {
-        m_Frames[0].frameContext.cubeShadowMap.width = GfxConfiguration::kShadowMapWidth;
-        m_Frames[0].frameContext.cubeShadowMap.height = GfxConfiguration::kShadowMapHeight;
-        m_Frames[0].frameContext.cubeShadowMap.size = GfxConfiguration::kMaxShadowMapCount;
-        m_Frames[0].frameContext.cubeShadowMap.pixel_format = PIXEL_FORMAT::D32;
-        GenerateCubemapArray(m_Frames[0].frameContext.cubeShadowMap);
-    }
+    // shadow map arrays, kept by the pool between scenes
+    auto acquire_shadow_map = [this](TextureArrayBase& texture,
+                                     const RenderTargetType type,
+                                     const uint32_t width,
+                                     const uint32_t height,
+                                     const uint32_t layers) {
+        if (texture.handler) return;
+        m_RenderTargetPool.Acquire({type, PIXEL_FORMAT::D32, width, height,
+                                    layers, 1, RenderTargetUsage::Depth},
+                                   texture);
+        texture.size = layers;
+    };
+
+    auto& frame_context = m_Frames[0].frameContext;
+    acquire_shadow_map(frame_context.shadowMap,
+                       RenderTargetType::Texture2DArray,
+                       GfxConfiguration::kShadowMapWidth,
+                       GfxConfiguration::kShadowMapHeight,
+                       GfxConfiguration::kMaxShadowMapCount);
+    acquire_shadow_map(frame_context.globalShadowMap,
+                       RenderTargetType::Texture2DArray,
+                       GfxConfiguration::kGlobalShadowMapWidth,
+                       GfxConfiguration::kGlobalShadowMapHeight,
+                       GfxConfiguration::kMaxGlobalShadowMapCount);
+    acquire_shadow_map(frame_context.cubeShadowMap,
+                       RenderTargetType::TextureCubeArray,
+                       GfxConfiguration::kCubeShadowMapWidth,
+                       GfxConfiguration::kCubeShadowMapHeight,
+                       GfxConfiguration::kMaxCubeShadowMapCount);
 
     if (scene.Geometries.size()) {
         initializeGeometries(scene);
+
+        // bounding boxes are used to select the level of detail, the
+        // triangle counts of the levels feed the frame statistics. Only the
+        // levels the back-end uploaded are counted, lodCount stays 1 for
+        // the back-ends which draw the full mesh
+        for (auto& pDbc : m_Frames[0].batchContexts) {
+            const auto& pGeometry =
+                scene.GetGeometry(pDbc->node->GetSceneObjectRef());
+            if (!pGeometry) continue;
+            pDbc->boundingBox = pGeometry->GetBoundingBox();
+            for (uint32_t lod = 0; lod < pDbc->lodCount; lod++) {
+                const auto pMesh = pGeometry->GetMeshLOD(lod).lock();
+                if (!pMesh || pMesh->GetPrimitiveType() !=
+                                  PrimitiveType::kPrimitiveTypeTriList)
+                    continue;
+                if (pDbc->indexGroup < pMesh->GetIndexGroupCount()) {
+                    pDbc->triangleCount[lod] = static_cast<uint32_t>(
+                        pMesh->GetIndexCount(pDbc->indexGroup) / 3);
+                }
+            }
+        }
     }
     if (scene.SkyBox) {
         initializeSkyBox(scene);
@@ -525,15 +1218,23 @@ void GraphicsManager::BeginScene(const Scene& scene) {
 }
 
 void GraphicsManager::EndScene() {
+    m_ShadowMapCache.Invalidate();
+
     for (auto& texture : m_Textures) {
         ReleaseTexture(texture);
     }
 
-    for (auto& frame : m_Frames) {
-        for (auto& texture : frame.colorTextures) {
-            ReleaseTexture(texture);
-        }
+    releaseFramebuffers();
+
+    // the frames share the shadow maps of frame 0
+    const auto& frame_context = m_Frames[0].frameContext;
+    m_RenderTargetPool.Release(frame_context.shadowMap);
+    m_RenderTargetPool.Release(frame_context.globalShadowMap);
+    m_RenderTargetPool.Release(frame_context.cubeShadowMap);
 
-        ReleaseTexture(frame.depthTexture);
+    for (auto& frame : m_Frames) {
+        frame.frameContext.shadowMap = Texture2DArray();
+        frame.frameContext.globalShadowMap = Texture2DArray();
+        frame.frameContext.cubeShadowMap = TextureCubeArray();
     }
 }
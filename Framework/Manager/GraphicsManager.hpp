@@ -5,14 +5,20 @@
 #include <unordered_map>
 #include <vector>
 
+#include "FrameRingAllocator.hpp"
 #include "FrameStructure.hpp"
 #include "GfxConfiguration.hpp"
+#include "HiZBuffer.hpp"
 #include "IApplication.hpp"
 #include "IDispatchPass.hpp"
 #include "IDrawPass.hpp"
 #include "IGraphicsManager.hpp"
+#include "LightClusterGrid.hpp"
 #include "Polyhedron.hpp"
+#include "RenderGraph.hpp"
+#include "RenderTargetPool.hpp"
 #include "Scene.hpp"
+#include "ShadowMapCache.hpp"
 #include "cbuffer.h"
 #include "geommath.hpp"
 
@@ -34,7 +40,11 @@ class GraphicsManager : _implements_ IGraphicsManager {
     void SetPipelineState(const std::shared_ptr<PipelineState>& pipelineState,
                           const Frame& frame) override {}
 
-    void DrawBatch(const Frame& frame) override {}
+    // Records the batches into secondary command lists, one per range of
+    // the list, from worker threads. Back-ends which can't record from
+    // other threads override it.
+    void DrawBatch(const Frame& frame,
+                   const std::vector<uint32_t>& batches) override;
 
     void BeginPass(Frame& frame) override {}
     void EndPass(Frame& frame) override {}
@@ -85,22 +95,61 @@ class GraphicsManager : _implements_ IGraphicsManager {
     virtual void initializeGeometries(const Scene& scene) {}
     virtual void initializeSkyBox(const Scene& scene) {}
 
+    // secondary command lists used by DrawBatch. recordBatches is called
+    // concurrently for different lists, each with its range of `batches`,
+    // the lists are then executed in list order, which is the batch order.
+    // Only the Empty RHI records through them so far, emulating the lists
+    // on the CPU. OpenGL, Metal and D3D12 override DrawBatch and draw on
+    // the calling thread, D3D12 bundles and Vulkan secondary command
+    // buffers would go here once those back-ends draw per batch.
+    virtual bool beginCommandLists(const Frame& frame, const uint32_t count) {
+        return false;
+    }
+    virtual void recordBatches(const Frame& frame,
+                               const std::vector<uint32_t>& batches,
+                               const BatchRange& range,
+                               const uint32_t list_index) {}
+    virtual void executeCommandLists(const Frame& frame,
+                                     const uint32_t count) {}
+
    private:
     void InitConstants() {}
     void CalculateCameraMatrix();
     void CalculateLights();
+    void AssignShadowMaps();
+    void CalculateShadowCascades();
+    void AssignLightClusters();
+    void CullShadowCasters();
+    void GroupShaderVariants();
+    void CalculateLods();
+    void CullClusters();
+    void CullOccludedBatches();
+    void WriteBatchConstants();
 
     void UpdateConstants();
 
    protected:
     uint64_t m_nSceneRevision{0};
     uint32_t m_nFrameIndex{0};
+    // upper bound of the command lists recorded in parallel by DrawBatch
+    uint32_t m_nMaxRecordingJobs{1};
+    // set by the back-ends which skip the batches hidden behind the
+    // occluders. The others draw every batch, so nothing is culled and the
+    // statistics count all of them.
+    bool m_bCullsOccludedBatches{false};
+    // memory shared with the GPU the per batch constants are written into,
+    // provided by the back-end. DrawBatchContext::constantsOffset points
+    // into it. Back-ends without one pass the constants with each draw.
+    std::unique_ptr<FrameRingAllocator> m_pBatchConstantAllocator;
 
     std::vector<Frame> m_Frames;
     std::vector<std::shared_ptr<IDispatchPass>> m_InitPasses;
     std::vector<std::shared_ptr<IDispatchPass>> m_DispatchPasses;
     std::vector<std::shared_ptr<IDrawPass>> m_DrawPasses;
-    
+    // resources read and written by the draw passes, which run in the
+    // order it compiles to
+    RenderGraph m_RenderGraph;
+
     std::map<std::string, material_textures> material_map;
 
     std::vector<TextureBase> m_Textures;
@@ -109,8 +158,20 @@ class GraphicsManager : _implements_ IGraphicsManager {
 
    private:
     void createFramebuffers();
+    void releaseFramebuffers();
+    void createRenderTarget(const RenderTargetDesc& desc,
+                            TextureBase& texture);
 
    private:
     bool m_bInitialize = false;
+
+    HiZBuffer m_HiZBuffer;
+    LightClusterGrid m_LightClusterGrid;
+    ShadowMapCache m_ShadowMapCache;
+    // model matrices of the batches written by WriteBatchConstants, kept to
+    // reuse the capacity
+    std::vector<const float*> m_BatchConstantSources;
+    // the frame buffers and the shadow maps
+    RenderTargetPool m_RenderTargetPool;
 };
 }  // namespace My
@@ -1,6 +1,8 @@
 #include "PipelineStateManager.hpp"
 
+#include "AssetLoader.hpp"
 #include "IApplication.hpp"
+#include "ShaderVariant.hpp"
 
 using namespace My;
 using namespace std;
@@ -31,8 +33,25 @@ using namespace std;
 #define TESE_TERRAIN_SOURCE_FILE "terrain.tese"
 #define CS_RAYTRACE_SOURCE_FILE "raytrace.comp"
 
+#define SHADER_REFLECTION_ROOT "Shaders/Reflection/"
+#define SHADER_REFLECTION_SUFFIX ".refl"
+
 PipelineStateManager::~PipelineStateManager() {}
 
+bool PipelineStateManager::LoadShaderReflection(const string& shaderName,
+                                                ShaderReflection& reflection) {
+    AssetLoader assetLoader;
+    const auto text = assetLoader.SyncOpenAndReadTextFileToString(
+        (SHADER_REFLECTION_ROOT + shaderName + SHADER_REFLECTION_SUFFIX)
+            .c_str());
+    if (text.empty() || !ParseShaderReflection(text, reflection)) {
+        cerr << "No reflection of shader " << shaderName << endl;
+        return false;
+    }
+
+    return true;
+}
+
 bool PipelineStateManager::RegisterPipelineState(PipelineState& pipelineState) {
     PipelineState* pPipelineState;
     pPipelineState = &pipelineState;
@@ -63,6 +82,7 @@ void PipelineStateManager::Clear() {
     }
 
     m_pipelineStates.clear();
+    m_missingVariants.clear();
 
     assert(m_pipelineStates.empty());
 
@@ -80,6 +100,40 @@ const std::shared_ptr<PipelineState> PipelineStateManager::GetPipelineState(
     }
 }
 
+const std::shared_ptr<PipelineState>
+PipelineStateManager::GetPipelineStateVariant(std::string name,
+                                              const uint32_t key) {
+    if (key == kBaseShaderVariant) {
+        return GetPipelineState(name);
+    }
+
+    const auto variant_name = GetShaderVariantName(name, key);
+    const auto& it = m_pipelineStates.find(variant_name);
+    if (it != m_pipelineStates.end()) {
+        return it->second;
+    }
+
+    const auto& pBaseState = GetPipelineState(name);
+    if (m_missingVariants.count(variant_name)) {
+        return pBaseState;
+    }
+
+    // registered on first use, the build only compiles the permutations
+    // listed in ShaderVariants.txt
+    PipelineState pipelineState = *pBaseState;
+    pipelineState.pipelineStateName = variant_name;
+    pipelineState.pixelShaderName =
+        GetShaderVariantName(pBaseState->pixelShaderName, key);
+    if (!RegisterPipelineState(pipelineState)) {
+        cerr << "Missing shader variant " << pipelineState.pixelShaderName
+             << ", falling back to " << name << endl;
+        m_missingVariants.insert(variant_name);
+        return pBaseState;
+    }
+
+    return m_pipelineStates[variant_name];
+}
+
 int PipelineStateManager::Initialize() {
     PipelineState pipelineState;
     pipelineState.pipelineStateName = "BASIC";
@@ -186,4 +240,7 @@ int PipelineStateManager::Initialize() {
     return 0;
 }
 
-void PipelineStateManager::Finalize() { Clear(); }
+void PipelineStateManager::Finalize() {
+    Clear();
+    m_PipelineStateCache.Close();
+}
@@ -1,6 +1,9 @@
 #include <map>
+#include <set>
 #include "IApplication.hpp"
 #include "IPipelineStateManager.hpp"
+#include "PipelineStateCache.hpp"
+#include "ShaderReflection.hpp"
 
 namespace My {
 class PipelineStateManager : _implements_ IPipelineStateManager {
@@ -17,6 +20,10 @@ class PipelineStateManager : _implements_ IPipelineStateManager {
 
     const std::shared_ptr<PipelineState> GetPipelineState(
         std::string name) const final;
+    const std::shared_ptr<PipelineState> GetPipelineStateVariant(
+        std::string name, uint32_t key) final;
+
+    PipelineStateCache& GetPipelineStateCache() { return m_PipelineStateCache; }
 
    protected:
     virtual bool InitializePipelineState(PipelineState** ppPipelineState) {
@@ -24,7 +31,15 @@ class PipelineStateManager : _implements_ IPipelineStateManager {
     }
     virtual void DestroyPipelineState(PipelineState& pipelineState) {}
 
+    // reads the manifest ShaderTool wrote for the shader at build time
+    static bool LoadShaderReflection(const std::string& shaderName,
+                                     ShaderReflection& reflection);
+
    protected:
     std::map<std::string, std::shared_ptr<PipelineState>> m_pipelineStates;
+    // permutations which failed to register, drawn with the base state
+    std::set<std::string> m_missingVariants;
+    // opened by the back-ends which can reload compiled pipelines
+    PipelineStateCache m_PipelineStateCache;
 };
 }  // namespace My
@@ -0,0 +1,124 @@
+#include "RenderTargetPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace My;
+using namespace std;
+
+namespace {
+size_t bytes_per_pixel(const PIXEL_FORMAT format) {
+    switch (format) {
+        case PIXEL_FORMAT::R8:
+            return 1;
+        case PIXEL_FORMAT::RG8:
+        case PIXEL_FORMAT::R16:
+        case PIXEL_FORMAT::R5G6B5:
+            return 2;
+        case PIXEL_FORMAT::RGB8:
+            return 3;
+        case PIXEL_FORMAT::RGBA8:
+        case PIXEL_FORMAT::RG16:
+        case PIXEL_FORMAT::R32:
+        case PIXEL_FORMAT::R10G10B10A2:
+        case PIXEL_FORMAT::D24R8:
+        case PIXEL_FORMAT::D32:
+            return 4;
+        case PIXEL_FORMAT::RGB16:
+            return 6;
+        case PIXEL_FORMAT::RGBA16:
+        case PIXEL_FORMAT::RG32:
+            return 8;
+        case PIXEL_FORMAT::RGB32:
+            return 12;
+        case PIXEL_FORMAT::RGBA32:
+            return 16;
+        default:
+            return 0;
+    }
+}
+}  // namespace
+
+size_t My::GetRenderTargetSize(const RenderTargetDesc& desc) {
+    const size_t faces =
+        (desc.type == RenderTargetType::TextureCubeArray) ? 6 : 1;
+    return size_t(desc.width) * desc.height * desc.layers * faces *
+           desc.samples * bytes_per_pixel(desc.format);
+}
+
+void RenderTargetPool::Acquire(const RenderTargetDesc& desc,
+                               TextureBase& texture) {
+    auto it = find_if(m_Entries.begin(), m_Entries.end(),
+                      [&desc](const Entry& entry) {
+                          return !entry.inUse && entry.desc == desc;
+                      });
+
+    if (it != m_Entries.end()) {
+        m_nReusedCount++;
+    } else {
+        Entry entry;
+        entry.desc = desc;
+        entry.size = GetRenderTargetSize(desc);
+        assert(m_fCreateTexture);
+        m_fCreateTexture(desc, entry.texture);
+        m_Entries.push_back(entry);
+        it = m_Entries.end() - 1;
+
+        m_nCreatedCount++;
+        m_nAllocatedMemory += entry.size;
+        m_nPeakMemory = std::max(m_nPeakMemory, m_nAllocatedMemory);
+    }
+
+    it->inUse = true;
+    it->lastUsedFrame = m_nFrame;
+    m_nInUseMemory += it->size;
+    m_nFrameMemory = std::max(m_nFrameMemory, m_nInUseMemory);
+
+    texture = it->texture;
+}
+
+void RenderTargetPool::Release(const TextureBase& texture) {
+    if (!texture.handler) return;
+
+    for (auto& entry : m_Entries) {
+        if (entry.texture.handler == texture.handler) {
+            if (entry.inUse) {
+                entry.inUse = false;
+                entry.lastUsedFrame = m_nFrame;
+                m_nInUseMemory -= entry.size;
+            }
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::BeginFrame() {
+    m_nFrame++;
+    m_nSteadyStateMemory = m_nFrameMemory;
+    m_nFrameMemory = m_nInUseMemory;
+
+    auto it = m_Entries.begin();
+    while (it != m_Entries.end()) {
+        if (!it->inUse && m_nFrame - it->lastUsedFrame > m_nMaxIdleFrames) {
+            release(*it);
+            it = m_Entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RenderTargetPool::Clear() {
+    for (auto& entry : m_Entries) {
+        assert(!entry.inUse);
+        release(entry);
+    }
+    m_Entries.clear();
+    m_nInUseMemory = 0;
+    m_nFrameMemory = 0;
+}
+
+void RenderTargetPool::release(Entry& entry) {
+    if (m_fReleaseTexture) m_fReleaseTexture(entry.texture);
+    m_nAllocatedMemory -= entry.size;
+}
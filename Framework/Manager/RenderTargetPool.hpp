@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <vector>
+
+#include "GfxConfiguration.hpp"
+#include "Image.hpp"
+#include "cbuffer.h"
+
+namespace My {
+enum class RenderTargetType : uint8_t {
+    Texture2D,
+    Texture2DArray,
+    TextureCubeArray
+};
+
+enum class RenderTargetUsage : uint8_t { Color, Depth };
+
+// textures are only recycled for the same description
+struct RenderTargetDesc {
+    RenderTargetType type{RenderTargetType::Texture2D};
+    PIXEL_FORMAT format{PIXEL_FORMAT::RGBA8};
+    uint32_t width{0};
+    uint32_t height{0};
+    // elements of an array, cubes for cube arrays
+    uint32_t layers{1};
+    uint32_t samples{1};
+    RenderTargetUsage usage{RenderTargetUsage::Color};
+
+    bool operator==(const RenderTargetDesc& rhs) const {
+        return std::tie(type, format, width, height, layers, samples,
+                        usage) == std::tie(rhs.type, rhs.format, rhs.width,
+                                           rhs.height, rhs.layers,
+                                           rhs.samples, rhs.usage);
+    }
+};
+
+// GPU memory of a texture of the description
+size_t GetRenderTargetSize(const RenderTargetDesc& desc);
+
+// Recycles render targets across frames and passes. A texture released to
+// the pool is handed out again for the same description, and destroyed once
+// it has not been used for a few frames. The textures are created and
+// destroyed through callbacks, by the graphics manager or a fake in the
+// tests.
+class RenderTargetPool {
+   public:
+    using CreateTextureFunc =
+        std::function<void(const RenderTargetDesc&, TextureBase&)>;
+    using ReleaseTextureFunc = std::function<void(TextureBase&)>;
+
+    // textures may still be in use by the frames in flight
+    static const uint32_t kDefaultMaxIdleFrames =
+        GfxConfiguration::kMaxInFlightFrameCount + 1;
+
+    explicit RenderTargetPool(uint32_t max_idle_frames = kDefaultMaxIdleFrames)
+        : m_nMaxIdleFrames(max_idle_frames) {}
+
+    void SetCreateTextureCB(const CreateTextureFunc& func) {
+        m_fCreateTexture = func;
+    }
+    void SetReleaseTextureCB(const ReleaseTextureFunc& func) {
+        m_fReleaseTexture = func;
+    }
+
+    // Hands out a texture of the description, which is only created when
+    // none is free. The fields of TextureBase are set, the caller sets the
+    // size of arrays.
+    void Acquire(const RenderTargetDesc& desc, TextureBase& texture);
+    // gives the texture back to the pool, ignored if it is not from the pool
+    // or already released
+    void Release(const TextureBase& texture);
+
+    // starts the next frame, destroying the textures idle for too long
+    void BeginFrame();
+    // destroys every texture, which must all have been released
+    void Clear();
+
+    // memory of the textures the pool holds, free or not
+    [[nodiscard]] size_t GetAllocatedMemory() const {
+        return m_nAllocatedMemory;
+    }
+    [[nodiscard]] size_t GetPeakMemory() const { return m_nPeakMemory; }
+    // most memory in use during the last frame, which is what the pool
+    // holds once the textures it does not need any more are destroyed
+    [[nodiscard]] size_t GetSteadyStateMemory() const {
+        return m_nSteadyStateMemory;
+    }
+    [[nodiscard]] size_t GetTextureCount() const { return m_Entries.size(); }
+    [[nodiscard]] uint32_t GetCreatedCount() const { return m_nCreatedCount; }
+    [[nodiscard]] uint32_t GetReusedCount() const { return m_nReusedCount; }
+
+   private:
+    struct Entry {
+        RenderTargetDesc desc;
+        TextureBase texture;
+        size_t size{0};
+        bool inUse{false};
+        uint64_t lastUsedFrame{0};
+    };
+
+    void release(Entry& entry);
+
+   private:
+    CreateTextureFunc m_fCreateTexture;
+    ReleaseTextureFunc m_fReleaseTexture;
+
+    std::vector<Entry> m_Entries;
+    uint32_t m_nMaxIdleFrames;
+    uint64_t m_nFrame{0};
+
+    size_t m_nAllocatedMemory{0};
+    size_t m_nInUseMemory{0};
+    size_t m_nPeakMemory{0};
+    size_t m_nFrameMemory{0};
+    size_t m_nSteadyStateMemory{0};
+    uint32_t m_nCreatedCount{0};
+    uint32_t m_nReusedCount{0};
+};
+}  // namespace My
@@ -0,0 +1,189 @@
+#include "ShaderReflection.hpp"
+
+#include <cstddef>
+#include <sstream>
+
+#include "cbuffer.h"
+
+using namespace My;
+using namespace std;
+
+namespace {
+const pair<ShaderResourceType, const char*> kResourceTypeNames[] = {
+    {ShaderResourceType::UniformBlock, "uniform_block"},
+    {ShaderResourceType::Texture, "texture"},
+    {ShaderResourceType::Sampler, "sampler"},
+    {ShaderResourceType::CombinedSampler, "combined_sampler"},
+    {ShaderResourceType::StorageBuffer, "storage_buffer"},
+    {ShaderResourceType::StorageImage, "storage_image"}};
+
+const char* resource_type_name(const ShaderResourceType type) {
+    for (const auto& [value, name] : kResourceTypeNames) {
+        if (value == type) return name;
+    }
+    return "";
+}
+
+bool parse_resource_type(const string& name, ShaderResourceType& type) {
+    for (const auto& [value, type_name] : kResourceTypeNames) {
+        if (name == type_name) {
+            type = value;
+            return true;
+        }
+    }
+    return false;
+}
+}  // namespace
+
+const ShaderResource* ShaderReflection::Find(const ShaderResourceType type,
+                                             const string& name) const {
+    for (const auto& resource : resources) {
+        if (resource.type == type && resource.name == name) return &resource;
+    }
+    return nullptr;
+}
+
+void ShaderReflection::Merge(const ShaderReflection& other) {
+    for (const auto& resource : other.resources) {
+        if (!Find(resource.type, resource.name)) {
+            resources.push_back(resource);
+        }
+    }
+}
+
+string My::SerializeShaderReflection(const ShaderReflection& reflection) {
+    ostringstream out;
+
+    for (const auto& resource : reflection.resources) {
+        out << resource_type_name(resource.type) << ' ' << resource.name << ' '
+            << resource.set << ' ' << resource.binding;
+        if (resource.type == ShaderResourceType::UniformBlock) {
+            out << ' ' << resource.size;
+        }
+        out << '\n';
+
+        for (const auto& member : resource.members) {
+            out << "member " << member.name << ' ' << member.offset << ' '
+                << member.size << '\n';
+        }
+    }
+
+    return out.str();
+}
+
+bool My::ParseShaderReflection(const string& text,
+                               ShaderReflection& reflection) {
+    istringstream in(text);
+    string line;
+
+    while (getline(in, line)) {
+        istringstream fields(line);
+        string keyword;
+        if (!(fields >> keyword)) continue;
+
+        if (keyword == "member") {
+            if (reflection.resources.empty() ||
+                reflection.resources.back().type !=
+                    ShaderResourceType::UniformBlock) {
+                return false;
+            }
+
+            ShaderBlockMember member;
+            if (!(fields >> member.name >> member.offset >> member.size)) {
+                return false;
+            }
+            reflection.resources.back().members.push_back(member);
+            continue;
+        }
+
+        ShaderResource resource;
+        if (!parse_resource_type(keyword, resource.type) ||
+            !(fields >> resource.name >> resource.set >> resource.binding)) {
+            return false;
+        }
+        if (resource.type == ShaderResourceType::UniformBlock &&
+            !(fields >> resource.size)) {
+            return false;
+        }
+        reflection.resources.push_back(resource);
+    }
+
+    return true;
+}
+
+#define MEMBER_OFFSET(s, m) \
+    { #m, static_cast<uint32_t>(offsetof(s, m)) }
+
+const vector<ConstantBufferLayout>& My::GetConstantBufferLayouts() {
+    static const vector<ConstantBufferLayout> layouts = {
+        {"PerFrameConstants",
+         sizeof(PerFrameConstants),
+         {MEMBER_OFFSET(PerFrameConstants, viewMatrix),
+          MEMBER_OFFSET(PerFrameConstants, projectionMatrix),
+          MEMBER_OFFSET(PerFrameConstants, camPos),
+          MEMBER_OFFSET(PerFrameConstants, clusterDepthParams),
+          MEMBER_OFFSET(PerFrameConstants, shadowCascadeMatrices),
+          MEMBER_OFFSET(PerFrameConstants, shadowCascadeSplits),
+          MEMBER_OFFSET(PerFrameConstants, numLights),
+          MEMBER_OFFSET(PerFrameConstants, clip_space_type)}},
+        {"PerBatchConstants",
+         sizeof(PerBatchConstants),
+         {MEMBER_OFFSET(PerBatchConstants, modelMatrix)}},
+        {"LightInfo", sizeof(LightInfo), {MEMBER_OFFSET(LightInfo, lights)}},
+        {"DebugConstants",
+         sizeof(DebugConstants),
+         {MEMBER_OFFSET(DebugConstants, front_color),
+          MEMBER_OFFSET(DebugConstants, back_color),
+          MEMBER_OFFSET(DebugConstants, layer_index),
+          MEMBER_OFFSET(DebugConstants, mip_level),
+          MEMBER_OFFSET(DebugConstants, line_width),
+          MEMBER_OFFSET(DebugConstants, padding0)}},
+        {"ShadowMapConstants",
+         sizeof(ShadowMapConstants),
+         {MEMBER_OFFSET(ShadowMapConstants, light_index),
+          MEMBER_OFFSET(ShadowMapConstants, shadowmap_layer_index),
+          MEMBER_OFFSET(ShadowMapConstants, near_plane),
+          MEMBER_OFFSET(ShadowMapConstants, far_plane)}}};
+
+    return layouts;
+}
+
+bool My::CheckShaderReflection(const ShaderReflection& reflection,
+                               const vector<ConstantBufferLayout>& layouts,
+                               vector<string>& errors) {
+    const size_t error_count = errors.size();
+
+    for (const auto& layout : layouts) {
+        const auto* block =
+            reflection.Find(ShaderResourceType::UniformBlock, layout.name);
+        if (!block) continue;
+
+        if (block->size != layout.size) {
+            errors.push_back(layout.name + " is " + to_string(block->size) +
+                             " bytes in the shader but " +
+                             to_string(layout.size) + " in cbuffer.h");
+        }
+
+        for (const auto& [name, offset] : layout.memberOffsets) {
+            const ShaderBlockMember* member = nullptr;
+            for (const auto& block_member : block->members) {
+                if (block_member.name == name) {
+                    member = &block_member;
+                    break;
+                }
+            }
+
+            if (!member) {
+                errors.push_back(layout.name + "::" + name +
+                                 " is missing in the shader");
+            } else if (member->offset != offset) {
+                errors.push_back(layout.name + "::" + name + " is at " +
+                                 to_string(member->offset) +
+                                 " in the shader but at " + to_string(offset) +
+                                 " in cbuffer.h");
+            }
+        }
+    }
+
+    return errors.size() == error_count;
+}
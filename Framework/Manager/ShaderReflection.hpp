@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace My {
+enum class ShaderResourceType : uint8_t {
+    UniformBlock,
+    Texture,
+    Sampler,
+    // a texture and a sampler merged for GL, bound to the texture unit of
+    // the texture
+    CombinedSampler,
+    StorageBuffer,
+    StorageImage
+};
+
+struct ShaderBlockMember {
+    std::string name;
+    uint32_t offset{0};
+    uint32_t size{0};
+};
+
+struct ShaderResource {
+    ShaderResourceType type{ShaderResourceType::UniformBlock};
+    std::string name;
+    uint32_t set{0};
+    uint32_t binding{0};
+    // bytes and members of uniform blocks
+    uint32_t size{0};
+    std::vector<ShaderBlockMember> members;
+};
+
+// What a compiled shader binds, written next to the cross-compiled shaders
+// by ShaderTool and read back by the pipeline state managers.
+struct ShaderReflection {
+    std::vector<ShaderResource> resources;
+
+    [[nodiscard]] const ShaderResource* Find(const ShaderResourceType type,
+                                             const std::string& name) const;
+    // adds the resources of another stage of the same program
+    void Merge(const ShaderReflection& other);
+};
+
+// The manifest is a text file, a resource per line, members of a uniform
+// block on the lines following it:
+//   uniform_block PerFrameConstants 0 10 440
+//   member viewMatrix 0 64
+//   texture diffuseMap 0 0
+std::string SerializeShaderReflection(const ShaderReflection& reflection);
+bool ParseShaderReflection(const std::string& text,
+                           ShaderReflection& reflection);
+
+// a constant buffer as cbuffer.h declares it to C++
+struct ConstantBufferLayout {
+    std::string name;
+    uint32_t size;
+    std::vector<std::pair<std::string, uint32_t>> memberOffsets;
+};
+
+const std::vector<ConstantBufferLayout>& GetConstantBufferLayouts();
+
+// Compares the uniform blocks named after a constant buffer with its C++
+// layout, adding a message to errors for each size or offset which differs.
+bool CheckShaderReflection(const ShaderReflection& reflection,
+                           const std::vector<ConstantBufferLayout>& layouts,
+                           std::vector<std::string>& errors);
+}  // namespace My
@@ -0,0 +1,99 @@
+#include "ShaderVariant.hpp"
+
+#include <bit>
+#include <cstdio>
+
+using namespace My;
+using namespace std;
+
+namespace {
+const pair<ShaderFeature, const char*> kShaderFeatureDefines[] = {
+    {SHADER_FEATURE_NORMAL_MAP, "HAS_NORMAL_MAP"},
+    {SHADER_FEATURE_METALLIC_MAP, "HAS_METALLIC_MAP"},
+    {SHADER_FEATURE_ROUGHNESS_MAP, "HAS_ROUGHNESS_MAP"},
+    {SHADER_FEATURE_AO_MAP, "HAS_AO_MAP"},
+    {SHADER_FEATURE_ALPHA_TEST, "ALPHA_TEST"},
+    {SHADER_FEATURE_SKINNED, "SKINNED"}};
+}  // namespace
+
+ShaderVariantKey My::GetMaterialShaderFeatures(
+    const SceneObjectMaterial& material) {
+    ShaderVariantKey features = 0;
+
+    if (material.GetNormal().ValueMap) features |= SHADER_FEATURE_NORMAL_MAP;
+    if (material.GetMetallic().ValueMap) {
+        features |= SHADER_FEATURE_METALLIC_MAP;
+    }
+    if (material.GetRoughness().ValueMap) {
+        features |= SHADER_FEATURE_ROUGHNESS_MAP;
+    }
+    if (material.GetAO().ValueMap) features |= SHADER_FEATURE_AO_MAP;
+    if (material.GetOpacity().ValueMap) features |= SHADER_FEATURE_ALPHA_TEST;
+
+    return features;
+}
+
+ShaderVariantKey My::GetShaderPassFeatureMask(const ShaderPass pass) {
+    switch (pass) {
+        case ShaderPass::Forward:
+            return (1u << SHADER_FEATURE_COUNT) - 1;
+        case ShaderPass::Shadow:
+            // the shadow maps are drawn with positions only, there are no
+            // texture coordinates to test the alpha with
+            return SHADER_FEATURE_SKINNED;
+    }
+
+    return 0;
+}
+
+ShaderVariantKey My::MakeShaderVariantKey(const ShaderVariantKey features,
+                                          const ShaderPass pass) {
+    return features & GetShaderPassFeatureMask(pass);
+}
+
+uint32_t My::GetShaderVariantCount(const ShaderPass pass) {
+    return 1u << popcount(GetShaderPassFeatureMask(pass));
+}
+
+vector<string> My::GetShaderVariantDefines(const ShaderVariantKey key) {
+    vector<string> defines;
+
+    for (const auto& [feature, define] : kShaderFeatureDefines) {
+        if (key & feature) defines.emplace_back(define);
+    }
+
+    return defines;
+}
+
+string My::GetShaderVariantName(const string& shaderName,
+                                const ShaderVariantKey key) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".v%02x", key);
+    return shaderName + suffix;
+}
+
+set<ShaderVariantKey> My::CollectShaderVariants(const Scene& scene,
+                                                const ShaderPass pass) {
+    set<ShaderVariantKey> keys;
+
+    for (const auto& _it : scene.GeometryNodes) {
+        const auto& pGeometryNode = _it.second.lock();
+        if (!pGeometryNode || !pGeometryNode->Visible()) continue;
+
+        const auto& pGeometry =
+            scene.GetGeometry(pGeometryNode->GetSceneObjectRef());
+        if (!pGeometry) continue;
+        const auto& pMesh = pGeometry->GetMesh().lock();
+        if (!pMesh) continue;
+
+        for (uint32_t i = 0; i < pMesh->GetIndexGroupCount(); i++) {
+            const auto& material_key = pGeometryNode->GetMaterialRef(
+                pMesh->GetIndexArray(i).GetMaterialIndex());
+            const auto& material = scene.GetMaterial(material_key);
+            keys.insert(MakeShaderVariantKey(
+                material ? GetMaterialShaderFeatures(*material) : 0, pass));
+        }
+    }
+
+    return keys;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Scene.hpp"
+
+namespace My {
+// A bit per material feature a shader is compiled with or without. A
+// permutation of a shader is identified by the features it was compiled
+// with, and built from the same source with the defines of the set bits.
+using ShaderVariantKey = uint32_t;
+
+enum ShaderFeature : ShaderVariantKey {
+    SHADER_FEATURE_NORMAL_MAP = 1 << 0,
+    SHADER_FEATURE_METALLIC_MAP = 1 << 1,
+    SHADER_FEATURE_ROUGHNESS_MAP = 1 << 2,
+    SHADER_FEATURE_AO_MAP = 1 << 3,
+    SHADER_FEATURE_ALPHA_TEST = 1 << 4,
+    // no mesh carries bone weights yet, reserved for skinned meshes
+    SHADER_FEATURE_SKINNED = 1 << 5,
+    SHADER_FEATURE_COUNT = 6
+};
+
+// not a permutation, the shader compiled without SHADER_VARIANT
+constexpr ShaderVariantKey kBaseShaderVariant = UINT32_MAX;
+
+// the pass a batch is drawn in decides which features matter
+enum class ShaderPass : uint8_t { Forward, Shadow };
+
+ShaderVariantKey GetMaterialShaderFeatures(const SceneObjectMaterial& material);
+
+// the features a pass is compiled with, the others are dropped from the key
+ShaderVariantKey GetShaderPassFeatureMask(ShaderPass pass);
+
+ShaderVariantKey MakeShaderVariantKey(ShaderVariantKey features,
+                                      ShaderPass pass);
+
+// permutations a pass could need at most
+uint32_t GetShaderVariantCount(ShaderPass pass);
+
+// preprocessor defines of a permutation, e.g. HAS_NORMAL_MAP
+std::vector<std::string> GetShaderVariantDefines(ShaderVariantKey key);
+
+// name of the compiled permutation of a shader, e.g. pbr.frag.v0b
+std::string GetShaderVariantName(const std::string& shaderName,
+                                 ShaderVariantKey key);
+
+// the permutations the materials of the geometries in a scene need
+std::set<ShaderVariantKey> CollectShaderVariants(const Scene& scene,
+                                                 ShaderPass pass);
+}  // namespace My
@@ -0,0 +1,202 @@
+#include "ShadowMapCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace My;
+using namespace std;
+
+namespace {
+// a light stops reaching a point when it is attenuated below this
+constexpr float kLightCutoff = 1.0f / 256.0f;
+
+// bounding sphere of the batch in world space
+void world_bounding_sphere(const DrawBatchContext& dbc, Vector3f& center,
+                           float& radius) {
+    Vector4f c = {dbc.boundingBox.centroid[0], dbc.boundingBox.centroid[1],
+                  dbc.boundingBox.centroid[2], 1.0f};
+    Transform(c, dbc.modelMatrix);
+    center = {c[0], c[1], c[2]};
+
+    float scale = 0.0f;
+    for (int32_t i = 0; i < 3; i++) {
+        Vector3f axis({dbc.modelMatrix[i][0], dbc.modelMatrix[i][1],
+                       dbc.modelMatrix[i][2]});
+        scale = std::max(scale, Length(axis));
+    }
+    radius = Length(dbc.boundingBox.extent) * scale;
+}
+
+bool is_in_sphere(const Light& light, const DrawBatchContext& dbc) {
+    const float range = GetLightRange(light);
+    if (range < 0.0f) return true;
+
+    Vector3f center;
+    float radius;
+    world_bounding_sphere(dbc, center, radius);
+
+    const Vector3f position = {light.lightPosition[0], light.lightPosition[1],
+                               light.lightPosition[2]};
+    return Length(center - position) <= range + radius;
+}
+
+bool is_in_cone(const Light& light, const DrawBatchContext& dbc) {
+    Vector3f center;
+    float radius;
+    world_bounding_sphere(dbc, center, radius);
+
+    const Vector3f apex = {light.lightPosition[0], light.lightPosition[1],
+                           light.lightPosition[2]};
+    Vector3f direction = {light.lightDirection[0], light.lightDirection[1],
+                          light.lightDirection[2]};
+    Normalize(direction);
+
+    // distance of the center along the axis of the cone and away from it
+    const Vector3f v = center - apex;
+    float along = 0.0f;
+    DotProduct(along, v, direction);
+    if (along < -radius) return false;
+
+    const float range = GetLightRange(light);
+    if (range >= 0.0f && along > range + radius) return false;
+
+    // the shadow map covers twice the end angle of the spot light
+    const float half_angle = light.lightAngleAttenCurveParams[0][1];
+    if (half_angle >= PI / 2.0f) return true;
+
+    const float length = Length(v);
+    const float away = sqrt(std::max(length * length - along * along, 0.0f));
+    return cos(half_angle) * away - sin(half_angle) * along <= radius;
+}
+}  // namespace
+
+float My::GetLightRange(const Light& light) {
+    const auto& params = light.lightDistAttenCurveParams;
+    // dimmer lights fade out sooner
+    const float cutoff =
+        kLightCutoff / std::max(light.lightIntensity, kLightCutoff);
+
+    float range = -1.0f;
+
+    switch (light.lightDistAttenCurveType) {
+        case AttenCurveType::kLinear:
+        case AttenCurveType::kSmooth:
+            // end_atten
+            range = params[0][1];
+            break;
+        case AttenCurveType::kInverse: {
+            // scale / (kl * d + kc * scale) + offset
+            const float scale = params[0][0];
+            const float offset = params[0][1];
+            const float kl = params[0][2];
+            const float kc = params[0][3];
+            if (kl > 0.0f && cutoff > offset) {
+                range = std::max((scale / (cutoff - offset) - kc * scale) / kl,
+                                 0.0f);
+            }
+        } break;
+        case AttenCurveType::kInverseSquare: {
+            // scale^2 / (kq * d^2 + kl * scale * d + kc * scale^2 + offset)
+            const float scale = params[0][0];
+            const float offset = params[0][1];
+            const float a = params[0][2];
+            const float b = params[0][3] * scale;
+            const float c =
+                params[1][0] * scale * scale + offset - scale * scale / cutoff;
+            if (c >= 0.0f) {
+                range = 0.0f;
+            } else if (a > 0.0f) {
+                range = (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+            } else if (b > 0.0f) {
+                range = -c / b;
+            }
+        } break;
+        default:
+            break;
+    }
+
+    // the light is emitted from the whole area
+    if (range >= 0.0f && light.lightType == LightType::Area) {
+        range += 0.5f * Length(light.lightSize);
+    }
+
+    return range;
+}
+
+bool My::IsInShadowFrustum(const Matrix4X4f& view_projection,
+                           const DrawBatchContext& dbc) {
+    const Matrix4X4f mvp = dbc.modelMatrix * view_projection;
+
+    // the batch is outside if all the corners of its box are outside of
+    // the same clip plane
+    uint32_t outside[6] = {};
+    for (int32_t i = 0; i < 8; i++) {
+        Vector4f corner = {
+            dbc.boundingBox.centroid[0] +
+                ((i & 1) ? 1.0f : -1.0f) * dbc.boundingBox.extent[0],
+            dbc.boundingBox.centroid[1] +
+                ((i & 2) ? 1.0f : -1.0f) * dbc.boundingBox.extent[1],
+            dbc.boundingBox.centroid[2] +
+                ((i & 4) ? 1.0f : -1.0f) * dbc.boundingBox.extent[2],
+            1.0f};
+        Transform(corner, mvp);
+
+        const float w = corner[3];
+        outside[0] += corner[0] < -w;
+        outside[1] += corner[0] > w;
+        outside[2] += corner[1] < -w;
+        outside[3] += corner[1] > w;
+        // the OpenGL near plane, which holds for the other clip spaces too
+        outside[4] += corner[2] < -w;
+        outside[5] += corner[2] > w;
+    }
+
+    return none_of(begin(outside), end(outside),
+                   [](const uint32_t count) { return count == 8; });
+}
+
+bool My::IsShadowCaster(const Light& light, const DrawBatchContext& dbc) {
+    switch (light.lightType) {
+        case LightType::Omni:
+        case LightType::Area:
+            return is_in_sphere(light, dbc);
+        case LightType::Spot:
+            return is_in_cone(light, dbc);
+        case LightType::Infinity:
+            return IsInShadowFrustum(
+                light.lightViewMatrix * light.lightProjectionMatrix, dbc);
+        default:
+            return true;
+    }
+}
+
+bool ShadowMapCache::Update(
+    const Light& light, const int32_t layer, const Matrix4X4f& view_projection,
+    const vector<uint32_t>& casters,
+    const vector<shared_ptr<DrawBatchContext>>& batches) {
+    // spot and area lights share the layers of the same shadow map array
+    const int32_t kind = (light.lightType == LightType::Area)
+                             ? LightType::Spot
+                             : light.lightType;
+    auto& entry = m_Entries[{kind, layer}];
+
+    bool valid = entry.valid && entry.viewProjection == view_projection &&
+                 entry.casters == casters;
+
+    for (size_t i = 0; valid && i < casters.size(); i++) {
+        const auto& dbc = *batches[casters[i]];
+        valid = !dbc.moved && dbc.lod == entry.lods[i];
+    }
+
+    if (!valid) {
+        entry.valid = true;
+        entry.viewProjection = view_projection;
+        entry.casters = casters;
+        entry.lods.resize(casters.size());
+        for (size_t i = 0; i < casters.size(); i++) {
+            entry.lods[i] = batches[casters[i]]->lod;
+        }
+    }
+
+    return valid;
+}
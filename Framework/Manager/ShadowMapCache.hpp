@@ -0,0 +1,53 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "FrameStructure.hpp"
+
+namespace My {
+// Distance at which the light fades out, following the attenuation curves
+// of the shaders. Negative when the light reaches everywhere.
+float GetLightRange(const Light& light);
+
+// Whether the batch may cast a shadow into the shadow map of the light,
+// from its bounds in world space. Omni and area lights test the sphere they
+// reach, spot lights their cone and infinity lights the box of their
+// shadow map.
+bool IsShadowCaster(const Light& light, const DrawBatchContext& dbc);
+
+// Whether the bounding box of the batch is in the clip volume of the view
+// projection, e.g. of a cascade of the sun.
+bool IsInShadowFrustum(const Matrix4X4f& view_projection,
+                       const DrawBatchContext& dbc);
+
+// Remembers what was drawn into each shadow map, so a map is only rendered
+// again when the light changed or a caster moved, came or left.
+class ShadowMapCache {
+   public:
+    // Returns true if the layer of the shadow map of the light still holds
+    // for the view projection it is drawn with and these casters (indices
+    // into batches). Otherwise they are recorded as what the layer is about
+    // to be rendered with.
+    bool Update(const Light& light, const int32_t layer,
+                const Matrix4X4f& view_projection,
+                const std::vector<uint32_t>& casters,
+                const std::vector<std::shared_ptr<DrawBatchContext>>& batches);
+
+    // forgets every map, e.g. when the shadow maps are created again
+    void Invalidate() { m_Entries.clear(); }
+
+   private:
+    struct Entry {
+        bool valid{false};
+        Matrix4X4f viewProjection;
+        std::vector<uint32_t> casters;
+        // the shadow maps are drawn with the LOD selected for the camera
+        std::vector<uint32_t> lods;
+    };
+
+    // keyed by the kind of shadow map and its layer
+    std::map<std::pair<int32_t, int32_t>, Entry> m_Entries;
+};
+}  // namespace My
@@ -1,5 +1,7 @@
 #pragma once
 #include <algorithm>
+#include <iostream>
+#include <vector>
 
 #ifdef _WIN32
 #include <dxgiformat.h>
@@ -184,143 +186,444 @@ typedef struct {
 
 class DdsParser : _implements_ ImageParser {
    public:
+    // describes the levels, faces and layers in place, the image takes over
+    // the buffer
     Image Parse(Buffer& buf) override {
         Image img;
-        uint8_t* pData = buf.GetData();
+        const uint8_t* pData = buf.GetData();
+        const uint8_t* pDataEnd = pData + buf.GetDataSize();
 
-        [[maybe_unused]] const auto* pdwMagic =
-            reinterpret_cast<const uint32_t*>(pData);
+        if (buf.GetDataSize() < sizeof(uint32_t) + sizeof(DDS_HEADER) ||
+            *reinterpret_cast<const uint32_t*>(pData) !=
+                endian_net_unsigned_int("DDS "_u32)) {
+            std::cerr << "Not a DDS file." << std::endl;
+            return img;
+        }
         pData += sizeof(uint32_t);
-        assert(*pdwMagic == endian_net_unsigned_int("DDS "_u32));
         std::cerr << "The image is DDS format" << std::endl;
 
         const auto* pHeader = reinterpret_cast<const DDS_HEADER*>(pData);
         pData += sizeof(DDS_HEADER);
 
-        assert(pHeader->dwSize == 124);
+        if (pHeader->dwSize != 124 || pHeader->ddspf.dwSize != 32) {
+            std::cerr << "Corrupt DDS header." << std::endl;
+            return img;
+        }
         img.Width = pHeader->dwWidth;
         img.Height = pHeader->dwHeight;
-        img.pitch = pHeader->dwPitchOrLinearSize;  // unreliable
-        auto mipmap_count = pHeader->dwMipMapCount;
-        assert(pHeader->ddspf.dwSize == 32);
+        // many writers leave out DDSD_MIPMAPCOUNT, the count is used as is
+        const uint32_t mipmap_count = std::max(1u, pHeader->dwMipMapCount);
 
+        bool supported;
+        bool volume = pHeader->dwCaps2 & 0x200000 /* DDSCAPS2_VOLUME */;
         if (pHeader->ddspf.dwFlags & 0x4 /* DDPF_FOURCC */) {
-            const uint32_t* pdwFourCC = &pHeader->ddspf.dwFourCC;
-            const char* pCC = reinterpret_cast<const char*>(pdwFourCC);
-            auto format = (MY_D3DFMT)*pdwFourCC;
-            img.bitcount = pHeader->ddspf.dwRGBBitCount;
-
-            switch (format) {
-                case MY_D3DFMT::D3DFMT_A16B16G16R16F:
-                    std::cerr << "D3DFMT_A16B16G16R16F" << std::endl;
-                    img.compressed = false;
-                    img.is_float = true;
-                    img.pixel_format = PIXEL_FORMAT::RGBA16;
-                    assert(img.bitcount == 64);
-                    break;
-                case MY_D3DFMT::D3DFMT_A32B32G32R32F:
-                    std::cerr << "D3DFMT_A32B32G32R32F" << std::endl;
-                    img.compressed = false;
-                    img.is_float = true;
-                    img.pixel_format = PIXEL_FORMAT::RGBA32;
-                    assert(img.bitcount == 128);
-                    break;
-                default:
-                    std::cerr << "Compressed: ";
-                    std::cerr << pCC[0] << pCC[1] << pCC[2] << pCC[3]
-                              << std::endl;
-
-                    img.compressed = true;
-            }
-        }
-
-        img.mipmaps.reserve(mipmap_count);
-
-        if (img.compressed) {
-            const uint32_t* pdwFourCC = &pHeader->ddspf.dwFourCC;
-            if (*pdwFourCC == endian_net_unsigned_int("DXT1"_u32)) {
-                img.compress_format = COMPRESSED_FORMAT::DXT1;
-                img.pitch = std::max(1u, ALIGN(img.Width, 4)) * 2;
-                img.bitcount = 4;
-            } else if (*pdwFourCC == endian_net_unsigned_int("DXT2"_u32)) {
-                img.compress_format = COMPRESSED_FORMAT::DXT2;
-                img.pitch = std::max(1u, ALIGN(img.Width, 4)) * 4;
-                img.bitcount = 8;
-            } else if (*pdwFourCC == endian_net_unsigned_int("DXT3"_u32)) {
-                img.compress_format = COMPRESSED_FORMAT::DXT3;
-                img.pitch = std::max(1u, ALIGN(img.Width, 4)) * 4;
-                img.bitcount = 8;
-            } else if (*pdwFourCC == endian_net_unsigned_int("DXT4"_u32)) {
-                img.compress_format = COMPRESSED_FORMAT::DXT4;
-                img.pitch = std::max(1u, ALIGN(img.Width, 4)) * 4;
-                img.bitcount = 8;
-            } else if (*pdwFourCC == endian_net_unsigned_int("DXT5"_u32)) {
-                img.compress_format = COMPRESSED_FORMAT::DXT5;
-                img.pitch = std::max(1u, ALIGN(img.Width, 4)) * 4;
-                img.bitcount = 8;
-            } else if (*pdwFourCC == endian_net_unsigned_int("DX10"_u32)) {
-                img.compress_format = COMPRESSED_FORMAT::DXT10;
+            const uint32_t four_cc = pHeader->ddspf.dwFourCC;
+            if (four_cc == endian_net_unsigned_int("DX10"_u32)) {
+                if ((size_t)(pDataEnd - pData) < sizeof(DDS_HEADER_DXT10)) {
+                    std::cerr << "Corrupt DDS header." << std::endl;
+                    return img;
+                }
                 const auto* pHeaderDXT10 =
                     reinterpret_cast<const DDS_HEADER_DXT10*>(pData);
                 pData += sizeof(DDS_HEADER_DXT10);
                 std::cerr << "DXGI_FORMAT: " << pHeaderDXT10->dxgiFormat
                           << std::endl;
-            } else if (*pdwFourCC == endian_net_unsigned_int("ATI2"_u32)) {
-                img.compress_format = COMPRESSED_FORMAT::BC5;
-                img.pitch = std::max(1u, ALIGN(img.Width, 4)) * 4;
-                img.bitcount = 8;
-            }
 
-            if (mipmap_count > 0) {
-                uint32_t width = img.Width;
-                uint32_t height = img.Height;
-
-                for (decltype(mipmap_count) i = 0; i < mipmap_count; i++) {
-                    if (width > 0 && height > 0) {
-                        auto pitch = std::max(1u, (ALIGN(width, 4)) >> 2) * ((img.compress_format == COMPRESSED_FORMAT::DXT1)? 8 : 16);
-                        img.mipmaps.emplace_back(
-                            width, height, pitch,
-                            img.data_size, pitch * (ALIGN(height, 4) >> 2));
-                        img.data_size += img.mipmaps[i].data_size;
-
-                        width >>= 1;   // /2
-                        height >>= 1;  // /2
-                    } else {
-                        break;
-                    }
+                supported = setDxgiFormat(pHeaderDXT10->dxgiFormat, img);
+                img.array_size = std::max(1u, pHeaderDXT10->arraySize);
+                if (pHeaderDXT10->miscFlag & 0x4 /* TEXTURECUBE */) {
+                    img.face_count = 6;
                 }
+                volume = pHeaderDXT10->resourceDimension ==
+                         D3D10_RESOURCE_DIMENSION_TEXTURE3D;
+            } else {
+                supported = setFourCCFormat(four_cc, img);
+                const auto* pCC = reinterpret_cast<const char*>(&four_cc);
+                std::cerr << "FourCC: " << pCC[0] << pCC[1] << pCC[2]
+                          << pCC[3] << std::endl;
             }
         } else {
-            img.pitch = ALIGN(img.Width * img.bitcount, 8) / 8;
-
-            if (mipmap_count > 0) {
-                uint32_t width = img.Width;
-                uint32_t height = img.Height;
-
-                for (decltype(mipmap_count) i = 0; i < mipmap_count; i++) {
-                    if (width > 0 && height > 0) {
-                        auto pitch = ALIGN(width * img.bitcount, 8) / 8;
-                        img.mipmaps.emplace_back(
-                            width, height, pitch, img.data_size /* as offset */,
-                            pitch * height /* as data_size */);
-                        img.data_size += img.mipmaps[i].data_size;
-
-                        width >>= 1;
-                        height >>= 1;
-                    } else {
-                        break;
-                    }
-                }
+            supported = setMaskFormat(pHeader->ddspf, img);
+        }
+
+        if (!supported) {
+            std::cerr << "Unsupported DDS pixel format." << std::endl;
+            return img;
+        }
+        if (volume) {
+            std::cerr << "Volume textures are not supported." << std::endl;
+            return img;
+        }
+
+        if (img.face_count == 1 && (pHeader->dwCaps2 & 0x200) /* CUBEMAP */) {
+            // a legacy cubemap may leave out faces
+            img.face_count = 0;
+            for (uint32_t face = 0; face < 6; face++) {
+                if (pHeader->dwCaps2 & (0x400u << face)) img.face_count++;
             }
         }
 
-        assert(img.data_size < buf.GetDataSize());
+        if (!img.Width || !img.Height || !img.face_count ||
+            mipmap_count > 32 ||
+            (std::max(img.Width, img.Height) >> (mipmap_count - 1)) == 0 ||
+            (uint64_t)img.array_size * img.face_count * mipmap_count >
+                (uint64_t)(pDataEnd - pData)) {
+            std::cerr << "Corrupt DDS dimensions." << std::endl;
+            return img;
+        }
 
-        img.data = new uint8_t[img.data_size];
+        // every face of every layer holds a whole mip chain
+        const size_t payload_offset = pData - buf.GetData();
+        img.mipmaps.reserve((size_t)img.array_size * img.face_count *
+                            mipmap_count);
+        for (uint32_t layer = 0; layer < img.array_size; layer++) {
+            for (uint32_t face = 0; face < img.face_count; face++) {
+                for (uint32_t level = 0; level < mipmap_count; level++) {
+                    const uint32_t width = std::max(1u, img.Width >> level);
+                    const uint32_t height = std::max(1u, img.Height >> level);
+                    size_t pitch;
+                    const size_t size = GetMipSize(img, width, height, pitch);
+                    img.mipmaps.emplace_back(width, height, pitch,
+                                             img.data_size, size);
+                    img.data_size += size;
+                }
+            }
+        }
+
+        if ((size_t)(pDataEnd - pData) < img.data_size) {
+            std::cerr << "DDS file is truncated, " << img.data_size
+                      << " bytes expected and " << (pDataEnd - pData)
+                      << " found." << std::endl;
+            img.mipmaps.clear();
+            img.data_size = 0;
+            return img;
+        }
 
-        memcpy(img.data, pData, img.data_size);
+        img.pitch = img.mipmaps[0].pitch;
+        img.storage = std::move(buf);
+        img.data = img.storage.GetData() + payload_offset;
 
         return img;
     }
+
+   private:
+    static void setPixelFormat(Image& img, const PIXEL_FORMAT format,
+                               const uint16_t bitcount, const bool is_float) {
+        img.pixel_format = format;
+        img.bitcount = bitcount;
+        img.is_float = is_float;
+        switch (format) {
+            case PIXEL_FORMAT::R8:
+            case PIXEL_FORMAT::RG8:
+            case PIXEL_FORMAT::RGB8:
+            case PIXEL_FORMAT::RGBA8:
+                img.bitdepth = 8;
+                break;
+            case PIXEL_FORMAT::R16:
+            case PIXEL_FORMAT::RG16:
+            case PIXEL_FORMAT::RGB16:
+            case PIXEL_FORMAT::RGBA16:
+                img.bitdepth = 16;
+                break;
+            default:
+                img.bitdepth = 32;
+        }
+    }
+
+    static void setCompressedFormat(Image& img, const COMPRESSED_FORMAT format,
+                                    const uint16_t bitcount) {
+        img.compressed = true;
+        img.compress_format = format;
+        img.bitcount = bitcount;  // per texel
+    }
+
+    static bool setFourCCFormat(const uint32_t four_cc, Image& img) {
+        switch (static_cast<MY_D3DFMT>(four_cc)) {
+            case MY_D3DFMT::D3DFMT_A16B16G16R16F:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA16, 64, true);
+                return true;
+            case MY_D3DFMT::D3DFMT_A32B32G32R32F:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA32, 128, true);
+                return true;
+            default:;
+        }
+
+        if (four_cc == endian_net_unsigned_int("DXT1"_u32)) {
+            setCompressedFormat(img, COMPRESSED_FORMAT::DXT1, 4);
+        } else if (four_cc == endian_net_unsigned_int("DXT2"_u32)) {
+            setCompressedFormat(img, COMPRESSED_FORMAT::DXT2, 8);
+        } else if (four_cc == endian_net_unsigned_int("DXT3"_u32)) {
+            setCompressedFormat(img, COMPRESSED_FORMAT::DXT3, 8);
+        } else if (four_cc == endian_net_unsigned_int("DXT4"_u32)) {
+            setCompressedFormat(img, COMPRESSED_FORMAT::DXT4, 8);
+        } else if (four_cc == endian_net_unsigned_int("DXT5"_u32)) {
+            setCompressedFormat(img, COMPRESSED_FORMAT::DXT5, 8);
+        } else if (four_cc == endian_net_unsigned_int("ATI1"_u32) ||
+                   four_cc == endian_net_unsigned_int("BC4U"_u32)) {
+            setCompressedFormat(img, COMPRESSED_FORMAT::BC4, 4);
+        } else if (four_cc == endian_net_unsigned_int("ATI2"_u32) ||
+                   four_cc == endian_net_unsigned_int("BC5U"_u32)) {
+            setCompressedFormat(img, COMPRESSED_FORMAT::BC5, 8);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // only the layouts that need no swizzle
+    static bool setMaskFormat(const DDS_PIXELFORMAT& ddspf, Image& img) {
+        if ((ddspf.dwFlags & 0x40 /* DDPF_RGB */) &&
+            ddspf.dwRGBBitCount == 32 && ddspf.dwRBitMask == 0x000000FF &&
+            ddspf.dwGBitMask == 0x0000FF00 && ddspf.dwBBitMask == 0x00FF0000) {
+            setPixelFormat(img, PIXEL_FORMAT::RGBA8, 32, false);
+            return true;
+        }
+        if (ddspf.dwFlags & 0x20000 /* DDPF_LUMINANCE */) {
+            if (ddspf.dwRGBBitCount == 8) {
+                setPixelFormat(img, PIXEL_FORMAT::R8, 8, false);
+                return true;
+            }
+            if (ddspf.dwRGBBitCount == 16 && ddspf.dwRBitMask == 0x00FF &&
+                ddspf.dwABitMask == 0xFF00) {
+                setPixelFormat(img, PIXEL_FORMAT::RG8, 16, false);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool setDxgiFormat(const MY_DXGI_FORMAT format, Image& img) {
+        switch (format) {
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA32, 128, true);
+                break;
+            case DXGI_FORMAT_R32G32B32_FLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RGB32, 96, true);
+                break;
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA16, 64, true);
+                break;
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA16, 64, false);
+                break;
+            case DXGI_FORMAT_R32G32_FLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RG32, 64, true);
+                break;
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA8, 32, false);
+                break;
+            case DXGI_FORMAT_R16G16_FLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RG16, 32, true);
+                break;
+            case DXGI_FORMAT_R16G16_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::RG16, 32, false);
+                break;
+            case DXGI_FORMAT_R32_FLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::R32, 32, true);
+                break;
+            case DXGI_FORMAT_R8G8_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::RG8, 16, false);
+                break;
+            case DXGI_FORMAT_R16_FLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::R16, 16, true);
+                break;
+            case DXGI_FORMAT_R16_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::R16, 16, false);
+                break;
+            case DXGI_FORMAT_R8_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::R8, 8, false);
+                break;
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC1, 4);
+                break;
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC2, 8);
+                break;
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC3, 8);
+                break;
+            case DXGI_FORMAT_BC4_UNORM:
+            case DXGI_FORMAT_BC4_SNORM:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC4, 4);
+                img.is_signed = format == DXGI_FORMAT_BC4_SNORM;
+                break;
+            case DXGI_FORMAT_BC5_UNORM:
+            case DXGI_FORMAT_BC5_SNORM:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC5, 8);
+                img.is_signed = format == DXGI_FORMAT_BC5_SNORM;
+                break;
+            case DXGI_FORMAT_BC6H_UF16:
+            case DXGI_FORMAT_BC6H_SF16:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC6H, 8);
+                img.is_float = true;
+                img.is_signed = format == DXGI_FORMAT_BC6H_SF16;
+                break;
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC7, 8);
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
+};
+
+class DdsWriter {
+   public:
+    // Writes every subresource of the image behind a DX10 header, the rows
+    // of uncompressed levels packed. Returns false for the formats DXGI has
+    // no value for, RGB8 and ASTC among them.
+    bool Write(std::ostream& out, const Image& image,
+               const bool srgb = false) {
+        const MY_DXGI_FORMAT format = getDxgiFormat(image, srgb);
+        if (format == DXGI_FORMAT_UNKNOWN || !image.data) return false;
+
+        // a parsed file without a chain is a single level
+        std::vector<Image::Mipmap> mipmaps = image.mipmaps;
+        if (mipmaps.empty()) {
+            mipmaps.emplace_back(image.Width, image.Height, image.pitch, 0,
+                                 image.data_size);
+        }
+        const uint32_t levels = static_cast<uint32_t>(mipmaps.size()) /
+                                (image.face_count * image.array_size);
+
+        DDS_HEADER header{};
+        header.dwSize = 124;
+        // CAPS, HEIGHT, WIDTH and PIXELFORMAT
+        header.dwFlags = 0x1 | 0x2 | 0x4 | 0x1000;
+        header.dwHeight = image.Height;
+        header.dwWidth = image.Width;
+        if (image.compressed) {
+            header.dwFlags |= 0x80000;  // LINEARSIZE
+            header.dwPitchOrLinearSize =
+                static_cast<uint32_t>(mipmaps[0].data_size);
+        } else {
+            header.dwFlags |= 0x8;  // PITCH
+            header.dwPitchOrLinearSize = filePitch(image, image.Width);
+        }
+        header.dwMipMapCount = levels;
+        header.ddspf.dwSize = 32;
+        header.ddspf.dwFlags = 0x4;  // DDPF_FOURCC
+        header.ddspf.dwFourCC = endian_net_unsigned_int("DX10"_u32);
+        header.dwCaps = 0x1000;  // TEXTURE
+        if (levels > 1) {
+            header.dwFlags |= 0x20000;        // MIPMAPCOUNT
+            header.dwCaps |= 0x8 | 0x400000;  // COMPLEX and MIPMAP
+        }
+        if (image.face_count == 6) {
+            header.dwCaps |= 0x8;
+            header.dwCaps2 = 0x200 | 0xFC00;  // CUBEMAP and every face
+        }
+
+        DDS_HEADER_DXT10 header_dxt10{};
+        header_dxt10.dxgiFormat = format;
+        header_dxt10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+        header_dxt10.miscFlag = image.face_count == 6 ? 0x4 : 0;
+        header_dxt10.arraySize = image.array_size;
+
+        const uint32_t magic = endian_net_unsigned_int("DDS "_u32);
+        out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(&header_dxt10),
+                  sizeof(header_dxt10));
+
+        // the levels of a face, then the faces of a layer, as Image
+        for (const auto& mip : mipmaps) {
+            const auto* data =
+                reinterpret_cast<const char*>(image.data + mip.offset);
+            if (image.compressed) {
+                out.write(data, static_cast<std::streamsize>(mip.data_size));
+                continue;
+            }
+            const uint32_t pitch = filePitch(image, mip.Width);
+            for (uint32_t y = 0; y < mip.Height; y++) {
+                out.write(data + y * mip.pitch, pitch);
+            }
+        }
+        return out.good();
+    }
+
+   private:
+    static uint32_t filePitch(const Image& image, const uint32_t width) {
+        return (width * image.bitcount + 7) >> 3;
+    }
+
+    static MY_DXGI_FORMAT getDxgiFormat(const Image& image, const bool srgb) {
+        if (image.compressed) {
+            switch (image.compress_format) {
+                case COMPRESSED_FORMAT::DXT1:
+                case COMPRESSED_FORMAT::BC1:
+                case COMPRESSED_FORMAT::BC1A:
+                    return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB
+                                : DXGI_FORMAT_BC1_UNORM;
+                case COMPRESSED_FORMAT::DXT2:
+                case COMPRESSED_FORMAT::DXT3:
+                case COMPRESSED_FORMAT::BC2:
+                    return srgb ? DXGI_FORMAT_BC2_UNORM_SRGB
+                                : DXGI_FORMAT_BC2_UNORM;
+                case COMPRESSED_FORMAT::DXT4:
+                case COMPRESSED_FORMAT::DXT5:
+                case COMPRESSED_FORMAT::BC3:
+                    return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB
+                                : DXGI_FORMAT_BC3_UNORM;
+                case COMPRESSED_FORMAT::BC7:
+                    return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB
+                                : DXGI_FORMAT_BC7_UNORM;
+                default:;
+            }
+            if (srgb) return DXGI_FORMAT_UNKNOWN;
+            switch (image.compress_format) {
+                case COMPRESSED_FORMAT::BC4:
+                    return image.is_signed ? DXGI_FORMAT_BC4_SNORM
+                                           : DXGI_FORMAT_BC4_UNORM;
+                case COMPRESSED_FORMAT::BC5:
+                    return image.is_signed ? DXGI_FORMAT_BC5_SNORM
+                                           : DXGI_FORMAT_BC5_UNORM;
+                case COMPRESSED_FORMAT::BC6H:
+                    return image.is_signed ? DXGI_FORMAT_BC6H_SF16
+                                           : DXGI_FORMAT_BC6H_UF16;
+                default:
+                    return DXGI_FORMAT_UNKNOWN;
+            }
+        }
+
+        if (image.pixel_format == PIXEL_FORMAT::RGBA8) {
+            return srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+                        : DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+        if (srgb) return DXGI_FORMAT_UNKNOWN;
+        switch (image.pixel_format) {
+            case PIXEL_FORMAT::R8:
+                return DXGI_FORMAT_R8_UNORM;
+            case PIXEL_FORMAT::RG8:
+                return DXGI_FORMAT_R8G8_UNORM;
+            case PIXEL_FORMAT::R16:
+                return image.is_float ? DXGI_FORMAT_R16_FLOAT
+                                      : DXGI_FORMAT_R16_UNORM;
+            case PIXEL_FORMAT::RG16:
+                return image.is_float ? DXGI_FORMAT_R16G16_FLOAT
+                                      : DXGI_FORMAT_R16G16_UNORM;
+            case PIXEL_FORMAT::RGBA16:
+                return image.is_float ? DXGI_FORMAT_R16G16B16A16_FLOAT
+                                      : DXGI_FORMAT_R16G16B16A16_UNORM;
+            case PIXEL_FORMAT::R32:
+                return DXGI_FORMAT_R32_FLOAT;
+            case PIXEL_FORMAT::RG32:
+                return DXGI_FORMAT_R32G32_FLOAT;
+            case PIXEL_FORMAT::RGB32:
+                return DXGI_FORMAT_R32G32B32_FLOAT;
+            case PIXEL_FORMAT::RGBA32:
+                return DXGI_FORMAT_R32G32B32A32_FLOAT;
+            case PIXEL_FORMAT::R10G10B10A2:
+                return DXGI_FORMAT_R10G10B10A2_UNORM;
+            default:
+                return DXGI_FORMAT_UNKNOWN;
+        }
+    }
 };
 }  // namespace My
@@ -1,8 +1,14 @@
 #pragma once
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <future>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
+#include "ColorSpaceConversion.hpp"
 #include "IImageParser.hpp"
 
 namespace My {
@@ -37,21 +43,86 @@ static inline void rgbe2float(float out[3],
 }
 
 class HdrParser : _implements_ ImageParser {
+   public:
+    // RGBA16F output instead of RGB32F, for uploading without conversion
+    explicit HdrParser(bool half_float = false) : m_bHalfFloat(half_float) {}
+
+   protected:
+    // not worth a worker thread below this
+    static constexpr uint32_t kMinRowsPerJob = 64;
+
+    bool m_bHalfFloat;
+
+    // skips a new-style run length encoded scanline, which starts with
+    // 2, 2 and its width, returns nullptr if it is corrupted
+    static const uint8_t* skipScanLine(const uint8_t* p, const uint8_t* pEnd,
+                                       const uint32_t width) {
+        p += 4;
+        for (uint32_t j = 0; j < 4; j++) {
+            uint32_t x = 0;
+            while (x < width) {
+                if (pEnd - p < 2) return nullptr;
+                uint32_t count = p[0];
+                if (count > 128) {
+                    count -= 128;
+                    p += 2;
+                } else {
+                    if ((size_t)(pEnd - p) < count + 1) return nullptr;
+                    p += count + 1;
+                }
+                if (!count || count > width - x) return nullptr;
+                x += count;
+            }
+        }
+        return p;
+    }
+
+    // a run length encoded scanline into 4 planes of `width` samples
+    static void decodeScanLine(const uint8_t* p, const uint32_t width,
+                               uint8_t* planes) {
+        p += 4;
+        for (uint32_t j = 0; j < 4; j++) {
+            uint8_t* pPlane = planes + (size_t)j * width;
+            uint8_t* pPlaneEnd = pPlane + width;
+            while (pPlane < pPlaneEnd) {
+                uint32_t count = p[0];
+                if (count > 128) {
+                    count -= 128;
+                    memset(pPlane, p[1], count);
+                    p += 2;
+                } else {
+                    memcpy(pPlane, p + 1, count);
+                    p += count + 1;
+                }
+                pPlane += count;
+            }
+        }
+    }
+
+    static bool isRunLengthEncoded(const uint8_t* p, const uint8_t* pEnd,
+                                   const uint32_t width) {
+        return pEnd - p >= 4 && p[0] == 2 && p[1] == 2 && !(p[2] & 0x80) &&
+               ((uint32_t)p[2] << 8 | p[3]) == width;
+    }
+
    public:
     Image Parse(Buffer& buf) override {
         Image img;
         std::string_view sbuf((char *)buf.GetData(), buf.GetDataSize());
 
-        if (sbuf.starts_with("#?RADIANCE\n")) {
+        if (sbuf.starts_with("#?RADIANCE\n") || sbuf.starts_with("#?RGBE\n")) {
             std::cerr << "Image File is HDR format" << std::endl;
-            sbuf.remove_prefix(strlen("#?RADIANCE\n"));
+            sbuf.remove_prefix(sbuf.find_first_of('\n') + 1);
 
             // process the header
-            while (sbuf[0] != '\n') {
+            while (!sbuf.empty() && sbuf[0] != '\n') {
                 // find the line end
-                auto line_end = sbuf.find_first_of('\n') + 1;
-                if (line_end == sbuf.npos)
-                    assert(false && "file is currputed!\n");
+                auto line_end = sbuf.find_first_of('\n');
+                if (line_end == sbuf.npos) {
+                    std::cerr << "HDR file is corrupted!" << std::endl;
+                    return img;
+                }
+                line_end++;
                 if (sbuf[0] == '#') {
                     // comment line, just ignore it
                     std::cerr << sbuf.substr(0, line_end) << std::endl;
@@ -66,18 +137,25 @@ class HdrParser : _implements_ ImageParser {
             // process dimension
 
             // bypass '\n'
-            sbuf.remove_prefix(1);
+            if (!sbuf.empty()) sbuf.remove_prefix(1);
 
             // find the line end
-            auto line_end = sbuf.find_first_of('\n') + 1;
-            if (line_end == sbuf.npos) assert(false && "file is currputed!\n");
+            auto line_end = sbuf.find_first_of('\n');
+            if (line_end == sbuf.npos) {
+                std::cerr << "HDR file is corrupted!" << std::endl;
+                return img;
+            }
 
             char axis1[2];
             char axis2[2];
             uint32_t dimension1;
             uint32_t dimension2;
-            std::sscanf(sbuf.data(), "%2c %u %2c %u", axis1, &dimension1, axis2,
-                        &dimension2);
+            const std::string resolution(sbuf.substr(0, line_end));
+            if (std::sscanf(resolution.c_str(), "%2c %u %2c %u", axis1,
+                            &dimension1, axis2, &dimension2) != 4) {
+                std::cerr << "HDR file is corrupted!" << std::endl;
+                return img;
+            }
 
             if (axis1[1] == 'Y') {
                 img.Height = dimension1;
@@ -90,76 +168,119 @@ class HdrParser : _implements_ ImageParser {
                 img.Height = dimension2;
             }
 
-            sbuf.remove_prefix(line_end);
+            sbuf.remove_prefix(line_end + 1);
 
-            img.bitcount = 32 * 3;  // float[3]
-            img.bitdepth = 32;
+            if (m_bHalfFloat) {
+                img.bitcount = 16 * 4;  // half[4]
+                img.bitdepth = 16;
+                img.pixel_format = PIXEL_FORMAT::RGBA16;
+            } else {
+                img.bitcount = 32 * 3;  // float[3]
+                img.bitdepth = 32;
+                img.pixel_format = PIXEL_FORMAT::RGB32;
+            }
             img.pitch = (img.bitcount >> 3) * img.Width;
-            img.pixel_format = PIXEL_FORMAT::RGB32;
             img.is_float = true;
             img.data_size = (size_t)img.pitch * img.Height;
             img.data = new uint8_t[img.data_size];
 
             // now data section
-            assert(sbuf.size() <= (size_t)4 * img.Height * img.Width);
-            auto* pRGBE =
-                reinterpret_cast<const unsigned char(*)[4]>(sbuf.data());
-            auto* pOutData = reinterpret_cast<float(*)[3]>(img.data);
-
-            if (img.Width < 8 || img.Width > 0x7fff) {
-                // run length encoding is not allowed so read flat
-                for (uint32_t y = 0; y < img.Height; y++) {
-                    for (uint32_t x = 0; x < img.Width; x++) {
-                        rgbe2float(*pOutData++, *pRGBE++);
+            const auto* pData = reinterpret_cast<const uint8_t*>(sbuf.data());
+            const auto* pDataEnd = pData + sbuf.size();
+            const uint32_t width = img.Width;
+            const size_t flat_size = (size_t)width * 4;
+
+            // first pass, where each scanline starts. Run length encoding
+            // is not allowed for some widths, and once a scanline is not
+            // encoded the rest of the image is read flat.
+            std::vector<const uint8_t*> scanlines(img.Height);
+            uint32_t encoded_rows = 0;
+            bool corrupted = false;
+            if (width >= 8 && width <= 0x7fff) {
+                const uint8_t* p = pData;
+                while (encoded_rows < img.Height &&
+                       isRunLengthEncoded(p, pDataEnd, width)) {
+                    scanlines[encoded_rows] = p;
+                    p = skipScanLine(p, pDataEnd, width);
+                    if (!p) {
+                        corrupted = true;
+                        break;
                     }
+                    encoded_rows++;
                 }
-            } else {
-                auto scanline = new uint8_t[4 * img.Width];
-
-                for (uint32_t i = 0; i < img.Height; i++) {
-                    assert(sbuf.size() >= 4 && "corrupted file");
-
-                    if ((*pRGBE)[0] != 2 || (*pRGBE)[1] != 2 ||
-                        (*pRGBE)[2] & 0x80) {
-                        // the remain part is not run length encoded
-                        for (uint32_t y = i; y < img.Height; y++) {
-                            for (uint32_t x = 0; x < img.Width; x++) {
-                                rgbe2float(*pOutData++, *pRGBE++);
-                            }
-                        }
+                pData = p;
+            }
+
+            uint32_t rows = encoded_rows;
+            if (!corrupted) {
+                for (; rows < img.Height &&
+                       (size_t)(pDataEnd - pData) >= flat_size;
+                     rows++) {
+                    scanlines[rows] = pData;
+                    pData += flat_size;
+                }
+            }
+
+            if (rows < img.Height) {
+                std::cerr << "HDR file is corrupted, " << rows << " of "
+                          << img.Height << " scanlines are read."
+                          << std::endl;
+                memset(img.data + (size_t)img.pitch * rows, 0,
+                       (size_t)img.pitch * (img.Height - rows));
+            }
+
+            // second pass, the scanlines decode in parallel
+            const auto decode_rows = [&](const uint32_t begin,
+                                         const uint32_t end) {
+                std::vector<uint8_t> planes(flat_size);
+                uint8_t* r = planes.data();
+                uint8_t* g = r + width;
+                uint8_t* b = g + width;
+                uint8_t* e = b + width;
+                for (uint32_t y = begin; y < end; y++) {
+                    if (y < encoded_rows) {
+                        decodeScanLine(scanlines[y], width, planes.data());
                     } else {
-                        assert (((*pRGBE)[2] << 8) + (*pRGBE)[3] == img.Width && "wrong scanline width");
-                        sbuf.remove_prefix(4); // move forward by 4 bytes
-                        uint8_t *pdat = scanline;
-                        for (uint32_t j = 0; j < 4; j++) {
-                            uint8_t *pend = scanline + (j + 1) * img.Width;
-                            while(pdat < pend) {
-                                if (sbuf.size() < 2) assert(false && "corrupted file");
-                                if (static_cast<unsigned char>(sbuf[0]) > 128) {
-                                    int count = static_cast<unsigned char>(sbuf[0]) - 128;
-                                    assert(count && count <= pend - pdat && "corrupted file");
-                                    while (count--) {
-                                        *pdat++ = sbuf[1];
-                                    }
-                                } else {
-                                    int count = static_cast<unsigned char>(sbuf[0]);
-                                    assert(count && count <= pend - pdat && "corrupted file");
-                                    *pdat++ = sbuf[1];
-                                    if (--count > 0) {
-                                        assert(sbuf.size() >= count && "corrupted file");
-                                        memcpy(pdat, sbuf.data(), count);
-                                        sbuf.remove_prefix(count);
-                                        pdat += count;
-                                    }
-                                }
-                                sbuf.remove_prefix(2);
-                            }
+                        const uint8_t* p = scanlines[y];
+                        for (uint32_t x = 0; x < width; x++) {
+                            r[x] = p[x * 4];
+                            g[x] = p[x * 4 + 1];
+                            b[x] = p[x * 4 + 2];
+                            e[x] = p[x * 4 + 3];
                         }
-                        rgbe2float(reinterpret_cast<float *>(img.data), scanline, img.Width);
+                    }
+
+                    uint8_t* pOut = img.data + (size_t)img.pitch * y;
+                    if (m_bHalfFloat) {
+                        ConvertRGBE2RGBAh(r, g, b, e,
+                                          reinterpret_cast<uint16_t*>(pOut),
+                                          width);
+                    } else {
+                        ConvertRGBE2RGBf(r, g, b, e,
+                                         reinterpret_cast<float*>(pOut),
+                                         width);
                     }
                 }
+            };
 
-                delete[] scanline;
+            const uint32_t job_count = std::min(
+                std::max(1u, std::thread::hardware_concurrency()),
+                rows / kMinRowsPerJob);
+            if (job_count <= 1) {
+                decode_rows(0, rows);
+            } else {
+                std::vector<std::future<void>> jobs;
+                jobs.reserve(job_count);
+                for (uint32_t i = 0; i < job_count; i++) {
+                    jobs.push_back(std::async(
+                        std::launch::async, decode_rows,
+                        (uint32_t)((uint64_t)rows * i / job_count),
+                        (uint32_t)((uint64_t)rows * (i + 1) / job_count)));
+                }
+
+                for (auto& job : jobs) {
+                    job.get();
+                }
             }
         }
 
@@ -169,4 +290,4 @@ class HdrParser : _implements_ ImageParser {
         return img;
     }
 };
-}  // namespace My
\ No newline at end of file
+}  // namespace My
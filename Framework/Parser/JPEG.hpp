@@ -2,13 +2,15 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <future>
 #include <iostream>
 #include <queue>
 #include <string>
+#include <thread>
 
 #include "ColorSpaceConversion.hpp"
-#include "HuffmanTree.hpp"
 #include "IImageParser.hpp"
+#include "JpegHuffman.hpp"
 #include "portable.hpp"
 
 // Enable this to print out very detailed decode information
@@ -80,7 +82,7 @@ struct SCAN_COMPONENT_SPEC_PARAMS {
         return EntropyCodingTableDestSelector >> 4;
     };
     [[nodiscard]] uint16_t AcEntropyCodingTableDestSelector() const {
-        return EntropyCodingTableDestSelector & 0x07;
+        return EntropyCodingTableDestSelector & 0x0F;
     };
 };
 
@@ -108,7 +110,7 @@ struct HUFFMAN_TABLE_SPEC {
 
     [[nodiscard]] uint16_t TableClass() const { return data >> 4; };
     [[nodiscard]] uint16_t DestinationIdentifier() const {
-        return data & 0x07;
+        return data & 0x0F;
     };
 };
 
@@ -119,318 +121,331 @@ struct RESTART_INTERVAL_DEF : public JPEG_SEGMENT_HEADER {
 #pragma pack(pop)
 
 class JfifParser : _implements_ ImageParser {
-   private:
-    const uint8_t m_zigzagIndex[64] = {
-        0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
-        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
-        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
-        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
-
    protected:
-    HuffmanTree<uint8_t> m_treeHuffman[4];
-    Matrix8X8f m_tableQuantization[4];
+    // not worth a worker thread below this
+    static constexpr int kMinMcusPerJob = 256;
+
+    // the DC and the AC tables have destinations 0 to 3 each
+    JpegHuffmanTable m_dcTables[4];
+    JpegHuffmanTable m_acTables[4];
+    // in natural order
+    uint16_t m_tableQuantization[4][64];
     std::vector<FRAME_COMPONENT_SPEC_PARAMS> m_tableFrameComponentsSpec;
+    // samples of each component of the frame, padded to whole MCUs
+    std::vector<uint8_t> m_componentSamples[4];
+    int32_t m_componentPitch[4];
     uint16_t m_nSamplePrecision;
     uint16_t m_nLines;
     uint16_t m_nSamplesPerLine;
     uint16_t m_nComponentsInFrame;
+    uint16_t m_nMaxHorizontalSamplingFactor;
+    uint16_t m_nMaxVerticalSamplingFactor;
     uint16_t m_nRestartInterval = 0;
-    int mcu_index;
+    bool m_bProgressive = false;
+    // the coefficients of every block of each component in natural order,
+    // gathered over the scans of a progressive frame
+    std::vector<int16_t> m_componentCoefficients[4];
+    // MCUs of the frame
     int mcu_count_x;
     int mcu_count_y;
+    // MCUs of the current scan, a scan of a single component has one block
+    // per MCU
+    int scan_mcu_count_x;
     int mcu_count;
+    uint8_t m_nComponentsInScan;
+    // frame component of each component of the scan
+    uint8_t m_scanComponents[4];
+    // spectral selection and successive approximation of the scan
+    uint8_t m_nSpectralStart;
+    uint8_t m_nSpectralEnd;
+    uint8_t m_nApproximationHigh;
+    uint8_t m_nApproximationLow;
     const SCAN_COMPONENT_SPEC_PARAMS* pScsp;
 
    protected:
-    size_t parseScanData(const uint8_t* pScanData, const uint8_t* pDataEnd,
-                         Image& img) {
-        std::vector<uint8_t> scan_data;
-        size_t scanLength = 0;
-
-        {
-            const uint8_t* p = pScanData;
-
-            // scan for scan data buffer size and remove bitstuff
-            bool bitstuff = false;
-            while (p < pDataEnd && (*p != 0xFF || *(p + 1) == 0x00)) {
-                if (!bitstuff) {
-                    scan_data.push_back(*p);
-                } else {
-                    // ignore it and reset the flag
-                    assert(*p == 0x00);
-                    bitstuff = false;
-                }
-
-                if (*(uint16_t*)p ==
-                    endian_net_unsigned_int((uint16_t)0xFF00)) {
-                    bitstuff = true;
-                }
-
-                p++;
-                scanLength++;
-            }
-
-            if (*p == 0xFF && *(p + 1) >= 0xD0 && *(p + 1) <= 0xD7) {
-                // found restart mark
-#if DUMP_DETAILS
-                std::cerr << "Found RST while scan the ECS." << std::endl;
-#endif
-            }
-
-#if DUMP_DETAILS
-            std::cerr << "Size Of Scan: " << scanLength << " bytes"
-                      << std::endl;
-            std::cerr << "Size Of Scan (after remove bitstuff): "
-                      << scan_data.size() << " bytes" << std::endl;
-#endif
+    // the entropy-coded data ends at the first marker, the 0xFF of the data
+    // are followed by a stuffed 0x00
+    static const uint8_t* findMarker(const uint8_t* p,
+                                     const uint8_t* pDataEnd) {
+        while (p < pDataEnd) {
+            p = static_cast<const uint8_t*>(
+                memchr(p, 0xFF, static_cast<size_t>(pDataEnd - p)));
+            if (!p || p + 1 >= pDataEnd) return pDataEnd;
+            if (*(p + 1) != 0x00) return p;
+            p += 2;
         }
+        return pDataEnd;
+    }
 
-        int16_t
-            previous_dc[4];  // 4 is max num of components defined by ITU-T81
-        memset(previous_dc, 0x00, sizeof(previous_dc));
-
-        size_t byte_offset = 0;
-        uint8_t bit_offset = 0;
-
-        while (byte_offset < scan_data.size() && mcu_index < mcu_count) {
-#if DUMP_DETAILS
-            std::cerr << "MCU: " << mcu_index << std::endl;
-#endif
-            Matrix8X8f
-                block[4];  // 4 is max num of components defined by ITU-T81
-            memset(&block, 0x00, sizeof(block));
-
-            for (uint8_t i = 0; i < m_nComponentsInFrame; i++) {
-                const FRAME_COMPONENT_SPEC_PARAMS& fcsp =
-                    m_tableFrameComponentsSpec[i];
+    void decodeMcu(JpegBitReader& reader, const int mcu,
+                   int16_t previous_dc[4], int32_t& eobrun) {
 #if DUMP_DETAILS
-                std::cerr << "\tComponent Selector: "
-                          << (uint16_t)pScsp[i].ComponentSelector << std::endl;
-                std::cerr << "\tQuantization Table Destination Selector: "
-                          << (uint16_t)fcsp.QuantizationTableDestSelector
-                          << std::endl;
-                std::cerr
-                    << "\tDC Entropy Coding Table Destination Selector: "
-                    << (uint16_t)pScsp[i].DcEntropyCodingTableDestSelector()
-                    << std::endl;
-                std::cerr
-                    << "\tAC Entropy Coding Table Destination Selector: "
-                    << (uint16_t)pScsp[i].AcEntropyCodingTableDestSelector()
-                    << std::endl;
+        std::cerr << "MCU: " << mcu << std::endl;
 #endif
+        const int mcu_index_x = mcu % scan_mcu_count_x;
+        const int mcu_index_y = mcu / scan_mcu_count_x;
 
-                // Decode DC
-                uint8_t dc_code =
-                    m_treeHuffman[pScsp[i].DcEntropyCodingTableDestSelector()]
-                        .DecodeSingleValue(scan_data.data(), scan_data.size(),
-                                           &byte_offset, &bit_offset);
-                uint8_t dc_bit_length = dc_code & 0x0F;
-                int16_t dc_value;
-                uint32_t tmp_value;
-
-                if (!dc_code) {
+        for (uint8_t i = 0; i < m_nComponentsInScan; i++) {
+            const uint8_t component = m_scanComponents[i];
+            const FRAME_COMPONENT_SPEC_PARAMS& fcsp =
+                m_tableFrameComponentsSpec[component];
 #if DUMP_DETAILS
-                    std::cerr << "Found EOB when decode DC!" << std::endl;
+            std::cerr << "\tComponent Selector: "
+                      << (uint16_t)pScsp[i].ComponentSelector << std::endl;
+            std::cerr << "\tQuantization Table Destination Selector: "
+                      << (uint16_t)fcsp.QuantizationTableDestSelector
+                      << std::endl;
+            std::cerr << "\tDC Entropy Coding Table Destination Selector: "
+                      << (uint16_t)pScsp[i].DcEntropyCodingTableDestSelector()
+                      << std::endl;
+            std::cerr << "\tAC Entropy Coding Table Destination Selector: "
+                      << (uint16_t)pScsp[i].AcEntropyCodingTableDestSelector()
+                      << std::endl;
 #endif
-                    dc_value = 0;
-                } else {
-                    if (dc_bit_length + bit_offset <= 8) {
-                        tmp_value = ((scan_data[byte_offset] &
-                                      ((0x01u << (8 - bit_offset)) - 1)) >>
-                                     (8 - dc_bit_length - bit_offset));
-                    } else {
-                        uint8_t bits_in_first_byte = 8 - bit_offset;
-                        uint8_t append_full_bytes =
-                            (dc_bit_length - bits_in_first_byte) / 8;
-                        uint8_t bits_in_last_byte = dc_bit_length -
-                                                    bits_in_first_byte -
-                                                    8 * append_full_bytes;
-                        tmp_value = (scan_data[byte_offset] &
-                                     ((0x01u << (8 - bit_offset)) - 1));
-                        for (int m = 1; m <= append_full_bytes; m++) {
-                            tmp_value <<= 8;
-                            tmp_value += scan_data[byte_offset + m];
+            const JpegHuffmanTable& dc =
+                m_dcTables[pScsp[i].DcEntropyCodingTableDestSelector()];
+            const JpegHuffmanTable& ac =
+                m_acTables[pScsp[i].AcEntropyCodingTableDestSelector()];
+            const int blocks_x = m_nComponentsInScan == 1
+                                     ? 1
+                                     : fcsp.HorizontalSamplingFactor();
+            const int blocks_y =
+                m_nComponentsInScan == 1 ? 1 : fcsp.VerticalSamplingFactor();
+            const int32_t pitch = m_componentPitch[component];
+
+            for (int by = 0; by < blocks_y; by++) {
+                for (int bx = 0; bx < blocks_x; bx++) {
+                    const int block_x = mcu_index_x * blocks_x + bx;
+                    const int block_y = mcu_index_y * blocks_y + by;
+
+                    if (m_bProgressive) {
+                        int16_t* coefficients =
+                            m_componentCoefficients[component].data() +
+                            ((ptrdiff_t)block_y * (pitch >> 3) + block_x) * 64;
+                        if (m_nSpectralStart == 0) {
+                            if (m_nApproximationHigh == 0) {
+                                DecodeJpegDcFirst(reader, dc, previous_dc[i],
+                                                  m_nApproximationLow,
+                                                  coefficients);
+                            } else {
+                                DecodeJpegDcRefine(reader,
+                                                   m_nApproximationLow,
+                                                   coefficients);
+                            }
+                        } else if (m_nApproximationHigh == 0) {
+                            DecodeJpegAcFirst(reader, ac, m_nSpectralStart,
+                                              m_nSpectralEnd,
+                                              m_nApproximationLow, eobrun,
+                                              coefficients);
+                        } else {
+                            DecodeJpegAcRefine(reader, ac, m_nSpectralStart,
+                                               m_nSpectralEnd,
+                                               m_nApproximationLow, eobrun,
+                                               coefficients);
                         }
-                        tmp_value <<= bits_in_last_byte;
-                        tmp_value +=
-                            (scan_data[byte_offset + append_full_bytes + 1] >>
-                             (8 - bits_in_last_byte));
+                        continue;
                     }
 
-                    // decode dc value
-                    if ((tmp_value >> (dc_bit_length - 1)) == 0) {
-                        // MSB = 1, turn it to minus value
-                        dc_value = -(int16_t)(~tmp_value &
-                                              ((0x0001u << dc_bit_length) - 1));
-                    } else {
-                        dc_value = tmp_value;
-                    }
+                    int16_t coefficients[64];
+                    memset(coefficients, 0x00, sizeof(coefficients));
+                    DecodeJpegBlock(reader, dc, ac, previous_dc[i],
+                                    coefficients);
+                    IDCT8X8(coefficients,
+                            m_tableQuantization
+                                [fcsp.QuantizationTableDestSelector],
+                            m_componentSamples[component].data() +
+                                (ptrdiff_t)pitch * block_y * 8 + block_x * 8,
+                            pitch);
                 }
+            }
+        }
+    }
 
-                // add with previous DC value
-                dc_value += previous_dc[i];
-                // save the value for next DC
-                previous_dc[i] = dc_value;
-
-#ifdef DUMP_DETAILS
-                printf("DC Code: %x\n", dc_code);
-                printf("DC Bit Length: %d\n", dc_bit_length);
-                printf("DC Value: %d\n", dc_value);
-#endif
+    // MCUs [first_mcu, last_mcu) of the scan, coded in [pData, pDataEnd)
+    void decodeSegment(const uint8_t* pData, const uint8_t* pDataEnd,
+                       const int first_mcu, const int last_mcu) {
+        JpegBitReader reader(pData, pDataEnd);
 
-                block[i][0][0] = dc_value;
+        int16_t
+            previous_dc[4];  // 4 is max num of components defined by ITU-T81
+        memset(previous_dc, 0x00, sizeof(previous_dc));
+        int32_t eobrun = 0;
 
-                // forward pointers to end of DC
-                bit_offset += dc_bit_length;
-                while (bit_offset >= 8) {
-                    bit_offset -= 8;
-                    byte_offset++;
-                }
+        // the blocks of a run of EOBs take no bits
+        for (int mcu = first_mcu;
+             mcu < last_mcu && (eobrun > 0 || !reader.Exhausted()); mcu++) {
+            decodeMcu(reader, mcu, previous_dc, eobrun);
+        }
+    }
 
-                // Decode AC
-                int ac_index = 1;
-                while (byte_offset < scan_data.size() && ac_index < 64) {
-                    uint8_t ac_code =
-                        m_treeHuffman
-                            [2 + pScsp[i].AcEntropyCodingTableDestSelector()]
-                                .DecodeSingleValue(scan_data.data(),
-                                                   scan_data.size(),
-                                                   &byte_offset, &bit_offset);
-
-                    if (!ac_code) {
-#if DUMP_DETAILS
-                        std::cerr << "Found EOB when decode AC!" << std::endl;
-#endif
-                        break;
-                    }
+    size_t parseScanData(const uint8_t* pScanData, const uint8_t* pDataEnd) {
+        // the restart intervals of the scan, each up to the next RST marker
+        std::vector<std::pair<const uint8_t*, const uint8_t*>> intervals;
+        const uint8_t* pIntervalData = pScanData;
+        const uint8_t* pScanEnd = findMarker(pScanData, pDataEnd);
+        intervals.emplace_back(pIntervalData, pScanEnd);
+        while (pScanEnd + 1 < pDataEnd && (pScanEnd[1] & 0xF8) == 0xD0) {
+            pIntervalData = pScanEnd + 2;
+            pScanEnd = findMarker(pIntervalData, pDataEnd);
+            intervals.emplace_back(pIntervalData, pScanEnd);
+        }
 
-                    if (ac_code == 0xF0) {
+        size_t scanLength = static_cast<size_t>(pScanEnd - pScanData);
 #if DUMP_DETAILS
-                        std::cerr << "Found ZRL when decode AC!" << std::endl;
-#endif
-                        ac_index += 16;
-                        continue;
-                    }
-
-                    uint8_t ac_zero_length = ac_code >> 4;
-                    ac_index += ac_zero_length;
-                    uint8_t ac_bit_length = ac_code & 0x0F;
-                    int16_t ac_value;
-
-                    if (ac_bit_length + bit_offset <= 8) {
-                        tmp_value = ((scan_data[byte_offset] &
-                                      ((0x01u << (8 - bit_offset)) - 1)) >>
-                                     (8 - ac_bit_length - bit_offset));
-                    } else {
-                        uint8_t bits_in_first_byte = 8 - bit_offset;
-                        uint8_t append_full_bytes =
-                            (ac_bit_length - bits_in_first_byte) / 8;
-                        uint8_t bits_in_last_byte = ac_bit_length -
-                                                    bits_in_first_byte -
-                                                    8 * append_full_bytes;
-                        tmp_value = (scan_data[byte_offset] &
-                                     ((0x01u << (8 - bit_offset)) - 1));
-                        for (int m = 1; m <= append_full_bytes; m++) {
-                            tmp_value <<= 8;
-                            tmp_value += scan_data[byte_offset + m];
-                        }
-                        tmp_value <<= bits_in_last_byte;
-                        tmp_value +=
-                            (scan_data[byte_offset + append_full_bytes + 1] >>
-                             (8 - bits_in_last_byte));
-                    }
-
-                    // decode ac value
-                    if ((tmp_value >> (ac_bit_length - 1)) == 0) {
-                        // MSB = 1, turn it to minus value
-                        ac_value = -(int16_t)(~tmp_value &
-                                              ((0x0001u << ac_bit_length) - 1));
-                    } else {
-                        ac_value = tmp_value;
-                    }
-
-#ifdef DUMP_DETAILS
-                    printf("AC Code: %x\n", ac_code);
-                    printf("AC Bit Length: %d\n", ac_bit_length);
-                    printf("AC Value: %d\n", ac_value);
+        std::cerr << "Size Of Scan: " << scanLength << " bytes, "
+                  << intervals.size() << " restart intervals" << std::endl;
 #endif
 
-                    int index = m_zigzagIndex[ac_index];
-                    block[i][index >> 3][index & 0x07] = ac_value;
+        const int interval_mcus =
+            m_nRestartInterval ? m_nRestartInterval : mcu_count;
+        const auto interval_count = static_cast<int>(intervals.size());
+        const auto decode_intervals = [&](const int begin, const int end) {
+            for (int i = begin; i < end; i++) {
+                decodeSegment(intervals[i].first, intervals[i].second,
+                              i * interval_mcus,
+                              std::min((i + 1) * interval_mcus, mcu_count));
+            }
+        };
+
+        // the intervals code disjoint blocks, they decode in parallel
+        const int job_count = std::min(
+            {static_cast<int>(
+                 std::max(1u, std::thread::hardware_concurrency())),
+             interval_count, mcu_count / kMinMcusPerJob});
+        if (job_count <= 1) {
+            decode_intervals(0, interval_count);
+        } else {
+            std::vector<std::future<void>> jobs;
+            jobs.reserve(job_count);
+            for (int i = 0; i < job_count; i++) {
+                jobs.push_back(std::async(
+                    std::launch::async, decode_intervals,
+                    interval_count * i / job_count,
+                    interval_count * (i + 1) / job_count));
+            }
 
-                    // forward pointers to end of AC
-                    bit_offset += ac_bit_length;
-                    while (bit_offset >= 8) {
-                        bit_offset -= 8;
-                        byte_offset++;
-                    }
+            for (auto& job : jobs) {
+                job.get();
+            }
+        }
 
-                    ac_index++;
-                }
+        return scanLength;
+    }
 
-#ifdef DUMP_DETAILS
-                printf("Extracted Component[%d] 8x8 block: ", i);
-                std::cerr << block[i];
-#endif
-                MatrixMulByElement(
-                    block[i], block[i],
-                    m_tableQuantization[fcsp.QuantizationTableDestSelector]);
-#ifdef DUMP_DETAILS
-                std::cerr << "After Quantization: " << block[i];
-#endif
-                block[i][0][0] += 1024.0f;  // level shift. same as +128 to each
-                                            // element after IDCT
-                block[i] = IDCT8X8(block[i]);
-#ifdef DUMP_DETAILS
-                std::cerr << "After IDCT: " << block[i];
-#endif
+    // the coefficients of a progressive frame are complete after its last
+    // scan
+    void transformCoefficients() {
+        for (uint8_t i = 0; i < m_nComponentsInFrame; i++) {
+            const int32_t pitch = m_componentPitch[i];
+            const auto& quantization =
+                m_tableQuantization[m_tableFrameComponentsSpec[i]
+                                        .QuantizationTableDestSelector];
+            const size_t block_count = m_componentCoefficients[i].size() / 64;
+            for (size_t block = 0; block < block_count; block++) {
+                const auto block_x =
+                    static_cast<int32_t>(block % (size_t)(pitch >> 3));
+                const auto block_y =
+                    static_cast<int32_t>(block / (size_t)(pitch >> 3));
+                IDCT8X8(m_componentCoefficients[i].data() + block * 64,
+                        quantization,
+                        m_componentSamples[i].data() +
+                            (ptrdiff_t)pitch * block_y * 8 + block_x * 8,
+                        pitch);
             }
+        }
+    }
 
-            assert(m_nComponentsInFrame <= 4);
-
-            YCbCrf ycbcr;
-            RGBf rgb;
-            int mcu_index_x = mcu_index % mcu_count_x;
-            int mcu_index_y = mcu_index / mcu_count_x;
-            uint8_t* pBuf;
+    // samples of a component inside the image, the rest of the plane is
+    // padding of the MCUs
+    int32_t componentExtent(const int32_t component,
+                            const bool horizontal) const {
+        const auto& fcsp = m_tableFrameComponentsSpec[component];
+        const int32_t size = horizontal ? m_nSamplesPerLine : m_nLines;
+        const int32_t factor =
+            horizontal ? fcsp.HorizontalSamplingFactor()
+                       : fcsp.VerticalSamplingFactor();
+        const int32_t max_factor = horizontal
+                                       ? m_nMaxHorizontalSamplingFactor
+                                       : m_nMaxVerticalSamplingFactor;
+        return std::max((size * factor + max_factor - 1) /
+                            std::max(max_factor, 1),
+                        1);
+    }
 
-            for (int i = 0; i < 8; i++) {
-                for (int j = 0; j < 8; j++) {
-                    for (int k = 0; k < m_nComponentsInFrame; k++) {
-                        ycbcr[k] = block[k][i][j];
-                    }
+    // row `row` of a component upsampled by `factor` vertically, and the
+    // row on the other side of it for the triangle filter
+    void componentRows(const int32_t component, const int32_t factor,
+                       const int32_t row, const uint8_t*& pNear,
+                       const uint8_t*& pFar) const {
+        const int32_t rows = componentExtent(component, false);
+        const int32_t near = std::min(row / factor, rows - 1);
+        int32_t far = near;
+        if (factor == 2) {
+            far = std::clamp(near + ((row & 1) ? 1 : -1), 0, rows - 1);
+        }
+        pNear = m_componentSamples[component].data() +
+                (ptrdiff_t)m_componentPitch[component] * near;
+        pFar = m_componentSamples[component].data() +
+               (ptrdiff_t)m_componentPitch[component] * far;
+    }
 
-                    pBuf = reinterpret_cast<uint8_t*>(img.data) +
-                           ((ptrdiff_t)img.pitch *
-                                ((ptrdiff_t)mcu_index_y * 8 + i) +
-                            ((ptrdiff_t)mcu_index_x * 8 + j) *
-                                (img.bitcount >> 3));
-                    rgb = ConvertYCbCr2RGB(ycbcr);
-                    reinterpret_cast<R8G8B8A8Unorm*>(pBuf)->data[0] =
-                        (uint8_t)rgb[0];
-                    reinterpret_cast<R8G8B8A8Unorm*>(pBuf)->data[1] =
-                        (uint8_t)rgb[1];
-                    reinterpret_cast<R8G8B8A8Unorm*>(pBuf)->data[2] =
-                        (uint8_t)rgb[2];
-                    reinterpret_cast<R8G8B8A8Unorm*>(pBuf)->data[3] = 255;
-                }
+    // upsamples the chroma and converts the samples into the pixels of the
+    // image, a frame of 1 or 2 components is grayscale
+    void convertSamples(Image& img) const {
+        const int32_t width = static_cast<int32_t>(img.pitch) / 4;
+        const auto height = static_cast<int32_t>(img.data_size / img.pitch);
+        const bool color = m_nComponentsInFrame >= 3;
+
+        std::vector<uint8_t> neutral;
+        if (!color) neutral.assign(width, 128);
+        std::vector<uint8_t> luma;
+
+        const auto factor = [this](const int32_t component,
+                                   const bool horizontal) {
+            const auto& fcsp = m_tableFrameComponentsSpec[component];
+            const int32_t f =
+                horizontal
+                    ? m_nMaxHorizontalSamplingFactor /
+                          std::max<uint16_t>(fcsp.HorizontalSamplingFactor(), 1)
+                    : m_nMaxVerticalSamplingFactor /
+                          std::max<uint16_t>(fcsp.VerticalSamplingFactor(), 1);
+            return std::max(f, 1);
+        };
+
+        for (int32_t row = 0; row < height; row++) {
+            uint8_t* pRGBA = reinterpret_cast<uint8_t*>(img.data) +
+                             (ptrdiff_t)img.pitch * row;
+
+            const uint8_t* pY;
+            const uint8_t* pYFar;
+            componentRows(0, factor(0, false), row, pY, pYFar);
+            if (factor(0, true) != 1 || factor(0, false) != 1) {
+                // only the chroma is subsampled by the usual encoders
+                luma.resize(width);
+                UpsampleChroma(pY, pYFar, componentExtent(0, true),
+                               factor(0, true), factor(0, false) == 2, 0,
+                               width, luma.data());
+                pY = luma.data();
             }
 
-            mcu_index++;
-
-            if (m_nRestartInterval != 0 &&
-                (mcu_index % m_nRestartInterval == 0)) {
-                if (bit_offset) {
-                    // finish current byte
-                    bit_offset = 0;
-                    byte_offset++;
-                }
-                assert(byte_offset == scan_data.size());
-                break;
+            if (!color) {
+                ConvertYCbCr2RGBA8(pY, neutral.data(), neutral.data(), pRGBA,
+                                   width);
+                continue;
             }
-        }
 
-        return scanLength;
+            const uint8_t* pCb;
+            const uint8_t* pCbFar;
+            const uint8_t* pCr;
+            const uint8_t* pCrFar;
+            const int32_t v_factor = factor(1, false);
+            componentRows(1, v_factor, row, pCb, pCbFar);
+            componentRows(2, v_factor, row, pCr, pCrFar);
+            ConvertYCbCr2RGBA8Row(
+                pY, pCb, pCbFar, pCr, pCrFar,
+                std::min(componentExtent(1, true), componentExtent(2, true)),
+                factor(1, true), v_factor == 2, pRGBA, width);
+        }
     }
 
    public:
@@ -457,9 +472,12 @@ class JfifParser : _implements_ ImageParser {
 #endif
                 switch (endian_net_unsigned_int(pSegmentHeader->Marker)) {
                     case 0xFFC0:
+                    case 0xFFC1:
                     case 0xFFC2: {
-                        if (endian_net_unsigned_int(pSegmentHeader->Marker) ==
-                            0xFFC0)
+                        m_bProgressive =
+                            endian_net_unsigned_int(pSegmentHeader->Marker) ==
+                            0xFFC2;
+                        if (!m_bProgressive)
                             std::cerr << "Start Of Frame0 (baseline DCT)"
                                       << std::endl;
                         else
@@ -472,16 +490,19 @@ class JfifParser : _implements_ ImageParser {
                         const auto* pFrameHeader =
                             reinterpret_cast<const FRAME_HEADER*>(pData);
                         m_nSamplePrecision = pFrameHeader->SamplePrecision;
+                        if (m_nSamplePrecision != 8) {
+                            std::cerr << "Unsupported Sample Precision "
+                                      << m_nSamplePrecision << "."
+                                      << std::endl;
+                            return Image();
+                        }
                         m_nLines = endian_net_unsigned_int(
                             (uint16_t)pFrameHeader->NumOfLines);
                         m_nSamplesPerLine = endian_net_unsigned_int(
                             (uint16_t)pFrameHeader->NumOfSamplesPerLine);
                         m_nComponentsInFrame =
                             pFrameHeader->NumOfComponentsInFrame;
-                        mcu_index = 0;
-                        mcu_count_x = ((m_nSamplesPerLine + 7) >> 3);
-                        mcu_count_y = ((m_nLines + 7) >> 3);
-                        mcu_count = mcu_count_x * mcu_count_y;
+                        assert(m_nComponentsInFrame <= 4);
 
                         std::cerr << "Sample Precision: " << m_nSamplePrecision
                                   << std::endl;
@@ -491,8 +512,6 @@ class JfifParser : _implements_ ImageParser {
                             << std::endl;
                         std::cerr << "Num of Components In Frame: "
                                   << m_nComponentsInFrame << std::endl;
-                        std::cerr << "Total MCU count: " << mcu_count
-                                  << std::endl;
 
                         const uint8_t* pTmp = pData + sizeof(FRAME_HEADER);
                         const auto* pFcsp = reinterpret_cast<
@@ -520,13 +539,53 @@ class JfifParser : _implements_ ImageParser {
                             pFcsp++;
                         }
 
+                        m_nMaxHorizontalSamplingFactor = 1;
+                        m_nMaxVerticalSamplingFactor = 1;
+                        for (const auto& fcsp : m_tableFrameComponentsSpec) {
+                            m_nMaxHorizontalSamplingFactor =
+                                std::max(m_nMaxHorizontalSamplingFactor,
+                                         fcsp.HorizontalSamplingFactor());
+                            m_nMaxVerticalSamplingFactor =
+                                std::max(m_nMaxVerticalSamplingFactor,
+                                         fcsp.VerticalSamplingFactor());
+                        }
+
+                        const int mcu_width =
+                            8 * m_nMaxHorizontalSamplingFactor;
+                        const int mcu_height = 8 * m_nMaxVerticalSamplingFactor;
+                        mcu_count_x =
+                            (m_nSamplesPerLine + mcu_width - 1) / mcu_width;
+                        mcu_count_y = (m_nLines + mcu_height - 1) / mcu_height;
+                        std::cerr << "Total MCU count: "
+                                  << mcu_count_x * mcu_count_y << std::endl;
+
+                        for (uint8_t i = 0; i < m_nComponentsInFrame; i++) {
+                            const auto& fcsp = m_tableFrameComponentsSpec[i];
+                            m_componentPitch[i] =
+                                mcu_count_x * 8 *
+                                std::max<uint16_t>(
+                                    fcsp.HorizontalSamplingFactor(), 1);
+                            m_componentSamples[i].assign(
+                                (size_t)m_componentPitch[i] * mcu_count_y * 8 *
+                                    std::max<uint16_t>(
+                                        fcsp.VerticalSamplingFactor(), 1),
+                                0);
+                            if (m_bProgressive) {
+                                // 64 coefficients per sample
+                                m_componentCoefficients[i].assign(
+                                    m_componentSamples[i].size(), 0);
+                            }
+                        }
+
                         img.Width = m_nSamplesPerLine;
                         img.Height = m_nLines;
                         img.bitcount = 32;
                         img.bitdepth = 8;
                         img.pixel_format = PIXEL_FORMAT::RGBA8; // alpha is fixed to 0xFF
-                        img.pitch = mcu_count_x * 8 * (img.bitcount >> 3);
-                        img.data_size = (size_t)img.pitch * mcu_count_y * 8;
+                        img.pitch =
+                            mcu_count_x * mcu_width * (img.bitcount >> 3);
+                        img.data_size =
+                            (size_t)img.pitch * mcu_count_y * mcu_height;
                         img.data = new uint8_t[img.data_size];
 
                         pData += (ptrdiff_t)endian_net_unsigned_int(
@@ -555,22 +614,25 @@ class JfifParser : _implements_ ImageParser {
                                       << pHtable->DestinationIdentifier()
                                       << std::endl;
 
+                            if (pHtable->TableClass() > 1 ||
+                                pHtable->DestinationIdentifier() > 3) {
+                                std::cerr << "Invalid Huffman Table."
+                                          << std::endl;
+                                return Image();
+                            }
+
                             const uint8_t* pCodeValueStart =
                                 reinterpret_cast<const uint8_t*>(pHtable) +
                                 sizeof(HUFFMAN_TABLE_SPEC);
 
-                            auto num_symbo =
-                                m_treeHuffman[(pHtable->TableClass() << 1) |
-                                              pHtable->DestinationIdentifier()]
-                                    .PopulateWithHuffmanTable(
-                                        pHtable->NumOfHuffmanCodes,
-                                        pCodeValueStart);
-
-#ifdef DUMP_DETAILS
-                            m_treeHuffman[(pHtable->TableClass() << 1) |
-                                          pHtable->DestinationIdentifier()]
-                                .Dump();
-#endif
+                            auto& table =
+                                pHtable->TableClass()
+                                    ? m_acTables[pHtable
+                                                     ->DestinationIdentifier()]
+                                    : m_dcTables[pHtable
+                                                     ->DestinationIdentifier()];
+                            auto num_symbo = table.PopulateWithHuffmanTable(
+                                pHtable->NumOfHuffmanCodes, pCodeValueStart);
 
                             size_t processed_length =
                                 sizeof(HUFFMAN_TABLE_SPEC) + num_symbo;
@@ -607,25 +669,19 @@ class JfifParser : _implements_ ImageParser {
                                 sizeof(QUANTIZATION_TABLE_SPEC);
 
                             for (int i = 0; i < 64; i++) {
-                                int index = m_zigzagIndex[i];
+                                int index = kJpegZigzagIndex[i];
                                 if (pQtable->ElementPrecision() == 0) {
                                     m_tableQuantization
                                         [pQtable->DestinationIdentifier()]
-                                        [index >> 3][index & 0x7] =
-                                            pElementDataStart[i];
+                                        [index] = pElementDataStart[i];
                                 } else {
                                     m_tableQuantization
                                         [pQtable->DestinationIdentifier()]
-                                        [index >> 3][index & 0x7] =
-                                            endian_net_unsigned_int(
-                                                *((uint16_t*)pElementDataStart +
-                                                  i));
+                                        [index] = endian_net_unsigned_int(
+                                            *((uint16_t*)pElementDataStart +
+                                              i));
                                 }
                             }
-#ifdef DUMP_DETAILS
-                            std::cerr << m_tableQuantization
-                                    [pQtable->DestinationIdentifier()];
-#endif
 
                             size_t processed_length =
                                 sizeof(QUANTIZATION_TABLE_SPEC) +
@@ -661,7 +717,7 @@ class JfifParser : _implements_ ImageParser {
                         std::cerr << "Image Conponents in Scan: "
                                   << (uint16_t)pScanHeader->NumOfComponents
                                   << std::endl;
-                        assert(pScanHeader->NumOfComponents ==
+                        assert(pScanHeader->NumOfComponents <=
                                m_nComponentsInFrame);
 
                         const uint8_t* pTmp = pData + sizeof(SCAN_HEADER);
@@ -669,13 +725,72 @@ class JfifParser : _implements_ ImageParser {
                             reinterpret_cast<const SCAN_COMPONENT_SPEC_PARAMS*>(
                                 pTmp);
 
+                        m_nComponentsInScan = pScanHeader->NumOfComponents;
+                        for (uint8_t i = 0; i < m_nComponentsInScan; i++) {
+                            if (pScsp[i].DcEntropyCodingTableDestSelector() >
+                                    3 ||
+                                pScsp[i].AcEntropyCodingTableDestSelector() >
+                                    3) {
+                                std::cerr << "Invalid Huffman Table Selector."
+                                          << std::endl;
+                                return Image();
+                            }
+
+                            m_scanComponents[i] = i;
+                            for (uint8_t j = 0; j < m_nComponentsInFrame;
+                                 j++) {
+                                if (m_tableFrameComponentsSpec[j]
+                                        .ComponentIdentifier ==
+                                    pScsp[i].ComponentSelector) {
+                                    m_scanComponents[i] = j;
+                                }
+                            }
+                        }
+
+                        const uint8_t* pSelection =
+                            pTmp + m_nComponentsInScan *
+                                       sizeof(SCAN_COMPONENT_SPEC_PARAMS);
+                        m_nSpectralStart = pSelection[0];
+                        m_nSpectralEnd = std::min<uint8_t>(pSelection[1], 63);
+                        m_nApproximationHigh = pSelection[2] >> 4;
+                        m_nApproximationLow = pSelection[2] & 0x0F;
+#if DUMP_DETAILS
+                        std::cerr << "Spectral Selection: "
+                                  << (uint16_t)m_nSpectralStart << "-"
+                                  << (uint16_t)m_nSpectralEnd << std::endl;
+                        std::cerr << "Successive Approximation: "
+                                  << (uint16_t)m_nApproximationHigh << "-"
+                                  << (uint16_t)m_nApproximationLow
+                                  << std::endl;
+#endif
+
+                        if (m_nComponentsInScan == 1) {
+                            // the blocks of the component cover the image
+                            const auto& fcsp =
+                                m_tableFrameComponentsSpec[m_scanComponents[0]];
+                            const int width =
+                                (m_nSamplesPerLine *
+                                     fcsp.HorizontalSamplingFactor() +
+                                 m_nMaxHorizontalSamplingFactor - 1) /
+                                m_nMaxHorizontalSamplingFactor;
+                            const int height =
+                                (m_nLines * fcsp.VerticalSamplingFactor() +
+                                 m_nMaxVerticalSamplingFactor - 1) /
+                                m_nMaxVerticalSamplingFactor;
+                            scan_mcu_count_x = (width + 7) >> 3;
+                            mcu_count = scan_mcu_count_x * ((height + 7) >> 3);
+                        } else {
+                            scan_mcu_count_x = mcu_count_x;
+                            mcu_count = mcu_count_x * mcu_count_y;
+                        }
+
                         const uint8_t* pScanData =
                             pData +
                             endian_net_unsigned_int(
                                 (uint16_t)pScanHeader->Length) +
                             2;
 
-                        scanLength = parseScanData(pScanData, pDataEnd, img);
+                        scanLength = parseScanData(pScanData, pDataEnd);
                         pData += (ptrdiff_t)endian_net_unsigned_int(
                                      pSegmentHeader->Length) +
                                  2 + scanLength /* length of marker */;
@@ -688,15 +803,8 @@ class JfifParser : _implements_ ImageParser {
                     case 0xFFD5:
                     case 0xFFD6:
                     case 0xFFD7: {
-#if DUMP_DETAILS
-                        std::cerr << "Restart Of Scan" << std::endl;
-                        std::cerr << "----------------------------"
-                                  << std::endl;
-#endif
-
-                        const uint8_t* pScanData = pData + 2;
-                        scanLength = parseScanData(pScanData, pDataEnd, img);
-                        pData += 2 + scanLength /* length of marker */;
+                        // the restart intervals are decoded with their scan
+                        pData += 2 /* length of marker */;
                     } break;
                     case 0xFFD9: {
                         std::cerr << "End Of Scan" << std::endl;
@@ -802,6 +910,13 @@ class JfifParser : _implements_ ImageParser {
             std::cerr << "File is not a JPEG file!" << std::endl;
         }
 
+        if (img.data) {
+            if (m_bProgressive) {
+                transformCoefficients();
+            }
+            convertSamples(img);
+        }
+
         img.mipmaps.emplace_back(img.Width, img.Height, img.pitch, 0,
                                  img.data_size);
 
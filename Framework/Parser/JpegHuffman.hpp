@@ -0,0 +1,361 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace My {
+// natural order of the coefficients of a block, in the order they are coded
+inline constexpr uint8_t kJpegZigzagIndex[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// Reads an entropy-coded segment MSB first through a 64-bit buffer, dropping
+// the 0x00 stuffed after each 0xFF. Past the end of the segment it reads
+// zeros.
+class JpegBitReader {
+   protected:
+    const uint8_t* m_pData;
+    const uint8_t* m_pDataEnd;
+    // the next bit is the MSB
+    uint64_t m_nBits{0};
+    int32_t m_nBitCount{0};
+    // zeros appended after the end of the segment
+    int32_t m_nPaddingBits{0};
+
+   protected:
+    static bool hasByteFF(const uint64_t word) {
+        const uint64_t inverted = ~word;
+        return ((inverted - 0x0101010101010101ull) & ~inverted &
+                0x8080808080808080ull) != 0;
+    }
+
+    void refill() {
+        // 8 bytes at once when none of them is stuffed
+        if (m_nBitCount <= 56 && m_pDataEnd - m_pData >= 8) {
+            // big endian, compiles to a load and a byte swap
+            uint64_t word = 0;
+            for (int32_t i = 0; i < 8; i++) {
+                word = (word << 8) | m_pData[i];
+            }
+            if (!hasByteFF(word)) {
+                const int32_t bytes = (64 - m_nBitCount) >> 3;
+                m_nBits |= (word >> (64 - bytes * 8))
+                           << (64 - m_nBitCount - bytes * 8);
+                m_nBitCount += bytes * 8;
+                m_pData += bytes;
+                return;
+            }
+        }
+
+        while (m_nBitCount <= 56) {
+            uint64_t byte = 0;
+            if (m_pData < m_pDataEnd) {
+                byte = *m_pData++;
+                if (byte == 0xFF && m_pData < m_pDataEnd && *m_pData == 0x00) {
+                    m_pData++;
+                }
+            } else {
+                m_nPaddingBits += 8;
+            }
+
+            m_nBits |= byte << (56 - m_nBitCount);
+            m_nBitCount += 8;
+        }
+    }
+
+   public:
+    JpegBitReader(const uint8_t* pData, const uint8_t* pDataEnd)
+        : m_pData(pData), m_pDataEnd(pDataEnd) {}
+
+    // count <= 32
+    uint32_t Peek(const int32_t count) {
+        if (m_nBitCount < count) refill();
+        return static_cast<uint32_t>(m_nBits >> (64 - count));
+    }
+
+    void Skip(const int32_t count) {
+        m_nBits <<= count;
+        m_nBitCount -= count;
+    }
+
+    uint32_t Get(const int32_t count) {
+        if (count == 0) return 0;
+        const auto bits = Peek(count);
+        Skip(count);
+        return bits;
+    }
+
+    // a coefficient of count bits, negative when its MSB is 0
+    static int32_t Extend(const uint32_t bits, const int32_t count) {
+        if (count == 0) return 0;
+        return bits < (1u << (count - 1))
+                   ? static_cast<int32_t>(bits) - ((1 << count) - 1)
+                   : static_cast<int32_t>(bits);
+    }
+
+    int32_t Receive(const int32_t count) { return Extend(Get(count), count); }
+
+    // drops the rest of the current byte, e.g. before a restart marker
+    void AlignToByte() { Skip(m_nBitCount & 0x07); }
+
+    // every bit of the segment has been read
+    bool Exhausted() {
+        refill();
+        return m_nBitCount <= m_nPaddingBits;
+    }
+};
+
+// Decodes a Huffman table of a JPEG file through a lookup table indexed by
+// the next kFastBits bits, falling back to the canonical code ranges for the
+// longer codes. Coefficients short enough are decoded with their magnitude
+// bits by a single lookup.
+class JpegHuffmanTable {
+   public:
+    static constexpr int32_t kFastBits = 9;
+
+    struct FastCoefficient {
+        int16_t value;
+        uint8_t run;
+        // bits of the code and the magnitude, 0 if not in the table
+        uint8_t length;
+    };
+
+   protected:
+    // symbol | code length << 8, 0 for the codes longer than kFastBits
+    uint16_t m_fastSymbols[1 << kFastBits]{};
+    FastCoefficient m_fastCoefficients[1 << kFastBits]{};
+    // first code longer than the length, left aligned to 16 bits
+    uint32_t m_maxCode[18]{};
+    int32_t m_valueOffset[17]{};
+    uint8_t m_symbols[256]{};
+
+   public:
+    size_t PopulateWithHuffmanTable(const uint8_t num_of_codes[16],
+                                    const uint8_t* code_values) {
+        memset(m_fastSymbols, 0x00, sizeof(m_fastSymbols));
+        memset(m_fastCoefficients, 0x00, sizeof(m_fastCoefficients));
+
+        size_t num_symbo = 0;
+        uint32_t code = 0;
+        for (int32_t length = 1; length <= 16; length++) {
+            m_valueOffset[length] =
+                static_cast<int32_t>(num_symbo) - static_cast<int32_t>(code);
+
+            for (int32_t i = 0; i < num_of_codes[length - 1]; i++) {
+                if (num_symbo == sizeof(m_symbols)) break;
+                const uint8_t symbol = code_values[num_symbo];
+                m_symbols[num_symbo++] = symbol;
+
+                if (length <= kFastBits) {
+                    const int32_t shift = kFastBits - length;
+                    for (uint32_t j = 0; j < (1u << shift); j++) {
+                        const uint32_t index = (code << shift) | j;
+                        m_fastSymbols[index] =
+                            static_cast<uint16_t>(symbol | (length << 8));
+
+                        // the magnitude bits follow the code
+                        const int32_t run = symbol >> 4;
+                        const int32_t size = symbol & 0x0F;
+                        if (size && length + size <= kFastBits) {
+                            const uint32_t bits =
+                                (index >> (shift - size)) & ((1u << size) - 1);
+                            m_fastCoefficients[index] = {
+                                static_cast<int16_t>(
+                                    JpegBitReader::Extend(bits, size)),
+                                static_cast<uint8_t>(run),
+                                static_cast<uint8_t>(length + size)};
+                        }
+                    }
+                }
+
+                code++;
+            }
+
+            m_maxCode[length] = code << (16 - length);
+            code <<= 1;
+        }
+        m_maxCode[17] = UINT32_MAX;
+
+        return num_symbo;
+    }
+
+    uint8_t DecodeSymbol(JpegBitReader& reader) const {
+        const uint32_t bits = reader.Peek(16);
+        const uint16_t fast = m_fastSymbols[bits >> (16 - kFastBits)];
+        if (fast) {
+            reader.Skip(fast >> 8);
+            return fast & 0xFF;
+        }
+
+        int32_t length = kFastBits + 1;
+        while (bits >= m_maxCode[length]) length++;
+        if (length > 16) {
+            // not a code of the table
+            reader.Skip(16);
+            return 0;
+        }
+
+        reader.Skip(length);
+        return m_symbols[(bits >> (16 - length)) + m_valueOffset[length]];
+    }
+
+    [[nodiscard]] const FastCoefficient& LookupCoefficient(
+        const uint32_t bits) const {
+        return m_fastCoefficients[bits];
+    }
+};
+
+// Decodes the DC difference and the AC coefficients of a block of a
+// baseline scan into natural order, coefficients must be zeroed.
+inline void DecodeJpegBlock(JpegBitReader& reader, const JpegHuffmanTable& dc,
+                            const JpegHuffmanTable& ac, int16_t& previous_dc,
+                            int16_t coefficients[64]) {
+    const int32_t dc_bit_length = dc.DecodeSymbol(reader) & 0x0F;
+    previous_dc = static_cast<int16_t>(previous_dc +
+                                       reader.Receive(dc_bit_length));
+    coefficients[0] = previous_dc;
+
+    int32_t ac_index = 1;
+    while (ac_index < 64) {
+        const auto& fast = ac.LookupCoefficient(
+            reader.Peek(JpegHuffmanTable::kFastBits));
+        if (fast.length) {
+            reader.Skip(fast.length);
+            ac_index += fast.run;
+            if (ac_index > 63) break;
+            coefficients[kJpegZigzagIndex[ac_index++]] = fast.value;
+            continue;
+        }
+
+        const uint8_t ac_code = ac.DecodeSymbol(reader);
+        const int32_t ac_bit_length = ac_code & 0x0F;
+        if (ac_bit_length == 0) {
+            if (ac_code != 0xF0) break;  // EOB
+            ac_index += 16;              // ZRL
+            continue;
+        }
+
+        ac_index += ac_code >> 4;
+        if (ac_index > 63) break;
+        coefficients[kJpegZigzagIndex[ac_index++]] =
+            static_cast<int16_t>(reader.Receive(ac_bit_length));
+    }
+}
+
+// Scans of a progressive frame, Annex G. Each scan adds the coefficients
+// [ss, se] of a block shifted left by `al`, or refines them by one bit when
+// the block was coded by a previous scan. `eobrun` counts the blocks left
+// in the current run of end of bands, it starts at 0 in each restart
+// interval.
+
+inline void DecodeJpegDcFirst(JpegBitReader& reader, const JpegHuffmanTable& dc,
+                              int16_t& previous_dc, const int32_t al,
+                              int16_t coefficients[64]) {
+    const int32_t dc_bit_length = dc.DecodeSymbol(reader) & 0x0F;
+    previous_dc = static_cast<int16_t>(previous_dc +
+                                       reader.Receive(dc_bit_length));
+    coefficients[0] = static_cast<int16_t>(previous_dc * (1 << al));
+}
+
+inline void DecodeJpegDcRefine(JpegBitReader& reader, const int32_t al,
+                               int16_t coefficients[64]) {
+    if (reader.Get(1)) {
+        coefficients[0] = static_cast<int16_t>(coefficients[0] | (1 << al));
+    }
+}
+
+inline void DecodeJpegAcFirst(JpegBitReader& reader, const JpegHuffmanTable& ac,
+                              const int32_t ss, const int32_t se,
+                              const int32_t al, int32_t& eobrun,
+                              int16_t coefficients[64]) {
+    if (eobrun > 0) {
+        eobrun--;
+        return;
+    }
+
+    for (int32_t k = ss; k <= se; k++) {
+        const uint8_t ac_code = ac.DecodeSymbol(reader);
+        const int32_t run = ac_code >> 4;
+        const int32_t ac_bit_length = ac_code & 0x0F;
+        if (ac_bit_length == 0) {
+            if (run == 15) {
+                k += 15;  // ZRL
+                continue;
+            }
+
+            // EOBn, this block is the first of the run
+            eobrun = (1 << run) - 1;
+            if (run) eobrun += static_cast<int32_t>(reader.Get(run));
+            break;
+        }
+
+        k += run;
+        if (k > 63) break;
+        coefficients[kJpegZigzagIndex[k]] =
+            static_cast<int16_t>(reader.Receive(ac_bit_length) * (1 << al));
+    }
+}
+
+// a correction bit for a coefficient which is already nonzero
+inline void RefineJpegCoefficient(JpegBitReader& reader, int16_t& coefficient,
+                                  const int32_t bit) {
+    if (reader.Get(1) && (coefficient & bit) == 0) {
+        coefficient = static_cast<int16_t>(coefficient >= 0 ? coefficient + bit
+                                                            : coefficient - bit);
+    }
+}
+
+inline void DecodeJpegAcRefine(JpegBitReader& reader,
+                               const JpegHuffmanTable& ac, const int32_t ss,
+                               const int32_t se, const int32_t al,
+                               int32_t& eobrun, int16_t coefficients[64]) {
+    const int32_t bit = 1 << al;
+    int32_t k = ss;
+
+    if (eobrun == 0) {
+        for (; k <= se; k++) {
+            const uint8_t ac_code = ac.DecodeSymbol(reader);
+            int32_t run = ac_code >> 4;
+            int32_t value = 0;
+            if (ac_code & 0x0F) {
+                // a coefficient which becomes nonzero, only its sign is coded
+                value = reader.Get(1) ? bit : -bit;
+            } else if (run != 15) {
+                eobrun = 1 << run;
+                if (run) eobrun += static_cast<int32_t>(reader.Get(run));
+                break;
+            }
+
+            // skip `run` zero coefficients, the nonzero ones on the way get
+            // their correction bits. A ZRL skips 16 zeros.
+            while (k <= se) {
+                int16_t& coefficient = coefficients[kJpegZigzagIndex[k]];
+                if (coefficient != 0) {
+                    RefineJpegCoefficient(reader, coefficient, bit);
+                } else {
+                    if (run == 0) break;
+                    run--;
+                }
+                k++;
+            }
+
+            if (value && k <= se) {
+                coefficients[kJpegZigzagIndex[k]] =
+                    static_cast<int16_t>(value);
+            }
+        }
+    }
+
+    if (eobrun > 0) {
+        // the rest of the band only has correction bits
+        for (; k <= se; k++) {
+            int16_t& coefficient = coefficients[kJpegZigzagIndex[k]];
+            if (coefficient != 0) {
+                RefineJpegCoefficient(reader, coefficient, bit);
+            }
+        }
+        eobrun--;
+    }
+}
+}  // namespace My
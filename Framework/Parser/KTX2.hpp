@@ -0,0 +1,618 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "IImageParser.hpp"
+
+namespace My {
+namespace KTX2 {
+static constexpr uint8_t kIdentifier[12] = {0xAB, 'K',  'T',  'X',
+                                            ' ',  '2',  '0',  0xBB,
+                                            '\r', '\n', 0x1A, '\n'};
+
+struct Header {
+    uint8_t identifier[12];
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t layer_count;
+    uint32_t face_count;
+    uint32_t level_count;
+    uint32_t supercompression_scheme;
+    // index
+    uint32_t dfd_byte_offset;
+    uint32_t dfd_byte_length;
+    uint32_t kvd_byte_offset;
+    uint32_t kvd_byte_length;
+    uint64_t sgd_byte_offset;
+    uint64_t sgd_byte_length;
+};
+static_assert(sizeof(Header) == 80);
+
+struct LevelIndex {
+    uint64_t byte_offset;
+    uint64_t byte_length;
+    uint64_t uncompressed_byte_length;
+};
+
+// the VkFormat values of the formats Image describes
+enum class VkFormat : uint32_t {
+    UNDEFINED = 0,
+    R8_UNORM = 9,
+    R8G8_UNORM = 16,
+    R8G8B8_UNORM = 23,
+    R8G8B8_SRGB = 29,
+    R8G8B8A8_UNORM = 37,
+    R8G8B8A8_SRGB = 43,
+    R16_SFLOAT = 76,
+    R16G16_SFLOAT = 83,
+    R16G16B16A16_UNORM = 91,
+    R16G16B16A16_SFLOAT = 97,
+    R32_SFLOAT = 100,
+    R32G32_SFLOAT = 103,
+    R32G32B32_SFLOAT = 106,
+    R32G32B32A32_SFLOAT = 109,
+    BC1_RGB_UNORM_BLOCK = 131,
+    BC1_RGB_SRGB_BLOCK = 132,
+    BC1_RGBA_UNORM_BLOCK = 133,
+    BC1_RGBA_SRGB_BLOCK = 134,
+    BC2_UNORM_BLOCK = 135,
+    BC2_SRGB_BLOCK = 136,
+    BC3_UNORM_BLOCK = 137,
+    BC3_SRGB_BLOCK = 138,
+    BC4_UNORM_BLOCK = 139,
+    BC4_SNORM_BLOCK = 140,
+    BC5_UNORM_BLOCK = 141,
+    BC5_SNORM_BLOCK = 142,
+    BC6H_UFLOAT_BLOCK = 143,
+    BC6H_SFLOAT_BLOCK = 144,
+    BC7_UNORM_BLOCK = 145,
+    BC7_SRGB_BLOCK = 146,
+    ETC2_R8G8B8_UNORM_BLOCK = 147,
+    ETC2_R8G8B8_SRGB_BLOCK = 148,
+    ASTC_4x4_UNORM_BLOCK = 157,
+    ASTC_12x12_SRGB_BLOCK = 184
+};
+
+class Ktx2Parser : _implements_ ImageParser {
+   public:
+    // describes the levels, faces and layers in place, the image takes over
+    // the buffer
+    Image Parse(Buffer& buf) override {
+        Image img;
+        const auto* pHeader = reinterpret_cast<const Header*>(buf.GetData());
+        if (buf.GetDataSize() < sizeof(Header) ||
+            memcmp(pHeader->identifier, kIdentifier, sizeof(kIdentifier))) {
+            std::cerr << "Not a KTX2 file." << std::endl;
+            return img;
+        }
+        std::cerr << "The image is KTX2 format" << std::endl;
+
+        if (pHeader->supercompression_scheme) {
+            std::cerr << "Supercompressed KTX2 is not supported."
+                      << std::endl;
+            return img;
+        }
+        if (!setVkFormat(static_cast<VkFormat>(pHeader->vk_format), img)) {
+            std::cerr << "Unsupported VkFormat " << pHeader->vk_format << "."
+                      << std::endl;
+            return img;
+        }
+        if (pHeader->pixel_depth > 1) {
+            std::cerr << "Volume textures are not supported." << std::endl;
+            return img;
+        }
+
+        img.Width = pHeader->pixel_width;
+        img.Height = std::max(1u, pHeader->pixel_height);  // 1D
+        img.array_size = std::max(1u, pHeader->layer_count);
+        img.face_count = pHeader->face_count;
+        // 0 asks the loader to generate the levels
+        const uint32_t level_count = std::max(1u, pHeader->level_count);
+        const size_t index_size =
+            sizeof(Header) + level_count * sizeof(LevelIndex);
+        if (!img.Width || (img.face_count != 1 && img.face_count != 6) ||
+            level_count > 32 ||
+            (std::max(img.Width, img.Height) >> (level_count - 1)) == 0 ||
+            buf.GetDataSize() < index_size) {
+            std::cerr << "Corrupt KTX2 header." << std::endl;
+            return img;
+        }
+
+        // the levels are in any order in the file, each holding every face
+        // of every layer
+        const auto* pLevels = reinterpret_cast<const LevelIndex*>(
+            buf.GetData() + sizeof(Header));
+        size_t begin = SIZE_MAX;
+        size_t end = 0;
+        for (uint32_t level = 0; level < level_count; level++) {
+            begin = std::min(begin, (size_t)pLevels[level].byte_offset);
+        }
+
+        img.mipmaps.resize((size_t)img.array_size * img.face_count *
+                               level_count,
+                           {0, 0, 0, 0, 0});
+        for (uint32_t level = 0; level < level_count; level++) {
+            const uint32_t width = std::max(1u, img.Width >> level);
+            const uint32_t height = std::max(1u, img.Height >> level);
+            size_t pitch;
+            const size_t size = GetMipSize(img, width, height, pitch);
+            const LevelIndex& index = pLevels[level];
+            const uint64_t images = (uint64_t)img.array_size * img.face_count;
+            if (!size || index.byte_length < size * images ||
+                index.byte_offset > buf.GetDataSize() ||
+                buf.GetDataSize() - index.byte_offset < index.byte_length) {
+                std::cerr << "Corrupt KTX2 level " << level << "."
+                          << std::endl;
+                img.mipmaps.clear();
+                return img;
+            }
+
+            for (uint32_t layer = 0; layer < img.array_size; layer++) {
+                for (uint32_t face = 0; face < img.face_count; face++) {
+                    const size_t image = (size_t)layer * img.face_count + face;
+                    img.mipmaps[image * level_count + level] = {
+                        width, height, pitch,
+                        index.byte_offset - begin + image * size, size};
+                }
+            }
+            end = std::max(end,
+                           (size_t)(index.byte_offset + index.byte_length));
+        }
+
+        img.data_size = end - begin;
+        img.pitch = img.mipmaps[0].pitch;
+        img.storage = std::move(buf);
+        img.data = img.storage.GetData() + begin;
+
+        return img;
+    }
+
+   private:
+    static void setPixelFormat(Image& img, const PIXEL_FORMAT format,
+                               const uint16_t bitcount,
+                               const uint16_t bitdepth, const bool is_float) {
+        img.pixel_format = format;
+        img.bitcount = bitcount;
+        img.bitdepth = bitdepth;
+        img.is_float = is_float;
+    }
+
+    static void setCompressedFormat(Image& img, const COMPRESSED_FORMAT format,
+                                    const uint16_t bitcount) {
+        img.compressed = true;
+        img.compress_format = format;
+        img.bitcount = bitcount;  // per texel
+    }
+
+    static bool setVkFormat(const VkFormat format, Image& img) {
+        switch (format) {
+            case VkFormat::R8_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::R8, 8, 8, false);
+                break;
+            case VkFormat::R8G8_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::RG8, 16, 8, false);
+                break;
+            case VkFormat::R8G8B8_UNORM:
+            case VkFormat::R8G8B8_SRGB:
+                setPixelFormat(img, PIXEL_FORMAT::RGB8, 24, 8, false);
+                break;
+            case VkFormat::R8G8B8A8_UNORM:
+            case VkFormat::R8G8B8A8_SRGB:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA8, 32, 8, false);
+                break;
+            case VkFormat::R16_SFLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::R16, 16, 16, true);
+                break;
+            case VkFormat::R16G16_SFLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RG16, 32, 16, true);
+                break;
+            case VkFormat::R16G16B16A16_UNORM:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA16, 64, 16, false);
+                break;
+            case VkFormat::R16G16B16A16_SFLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA16, 64, 16, true);
+                break;
+            case VkFormat::R32_SFLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::R32, 32, 32, true);
+                break;
+            case VkFormat::R32G32_SFLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RG32, 64, 32, true);
+                break;
+            case VkFormat::R32G32B32_SFLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RGB32, 96, 32, true);
+                break;
+            case VkFormat::R32G32B32A32_SFLOAT:
+                setPixelFormat(img, PIXEL_FORMAT::RGBA32, 128, 32, true);
+                break;
+            case VkFormat::BC1_RGB_UNORM_BLOCK:
+            case VkFormat::BC1_RGB_SRGB_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC1, 4);
+                break;
+            case VkFormat::BC1_RGBA_UNORM_BLOCK:
+            case VkFormat::BC1_RGBA_SRGB_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC1A, 4);
+                break;
+            case VkFormat::BC2_UNORM_BLOCK:
+            case VkFormat::BC2_SRGB_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC2, 8);
+                break;
+            case VkFormat::BC3_UNORM_BLOCK:
+            case VkFormat::BC3_SRGB_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC3, 8);
+                break;
+            case VkFormat::BC4_UNORM_BLOCK:
+            case VkFormat::BC4_SNORM_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC4, 4);
+                img.is_signed = format == VkFormat::BC4_SNORM_BLOCK;
+                break;
+            case VkFormat::BC5_UNORM_BLOCK:
+            case VkFormat::BC5_SNORM_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC5, 8);
+                img.is_signed = format == VkFormat::BC5_SNORM_BLOCK;
+                break;
+            case VkFormat::BC6H_UFLOAT_BLOCK:
+            case VkFormat::BC6H_SFLOAT_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC6H, 8);
+                img.is_float = true;
+                img.is_signed = format == VkFormat::BC6H_SFLOAT_BLOCK;
+                break;
+            case VkFormat::BC7_UNORM_BLOCK:
+            case VkFormat::BC7_SRGB_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::BC7, 8);
+                break;
+            case VkFormat::ETC2_R8G8B8_UNORM_BLOCK:
+            case VkFormat::ETC2_R8G8B8_SRGB_BLOCK:
+                setCompressedFormat(img, COMPRESSED_FORMAT::ETC, 4);
+                break;
+            default:
+                if (format >= VkFormat::ASTC_4x4_UNORM_BLOCK &&
+                    format <= VkFormat::ASTC_12x12_SRGB_BLOCK) {
+                    // UNORM and SRGB of each 2D block size, in the order of
+                    // COMPRESSED_FORMAT
+                    const uint32_t index =
+                        (static_cast<uint32_t>(format) -
+                         static_cast<uint32_t>(
+                             VkFormat::ASTC_4x4_UNORM_BLOCK)) >>
+                        1;
+                    const auto astc = static_cast<uint32_t>(
+                        COMPRESSED_FORMAT::ASTC_4x4);
+                    setCompressedFormat(
+                        img, static_cast<COMPRESSED_FORMAT>(astc + index), 0);
+                    break;
+                }
+                return false;
+        }
+        return true;
+    }
+};
+
+class Ktx2Writer {
+   public:
+    // Writes every subresource of the image with a basic data format
+    // descriptor, the smallest level first and the rows packed. Returns false
+    // for the formats left out of VkFormat above.
+    bool Write(std::ostream& out, const Image& image,
+               const bool srgb = false) {
+        const VkFormat format = getVkFormat(image, srgb);
+        if (format == VkFormat::UNDEFINED || !image.data) return false;
+
+        std::vector<Image::Mipmap> mipmaps = image.mipmaps;
+        if (mipmaps.empty()) {
+            mipmaps.emplace_back(image.Width, image.Height, image.pitch, 0,
+                                 image.data_size);
+        }
+        const uint32_t images = image.face_count * image.array_size;
+        const uint32_t levels = static_cast<uint32_t>(mipmaps.size()) / images;
+
+        const std::vector<uint32_t> dfd = makeDfd(image, srgb);
+        const size_t dfd_offset = sizeof(Header) + levels * sizeof(LevelIndex);
+        const size_t dfd_size = dfd.size() * sizeof(uint32_t);
+
+        Header header{};
+        memcpy(header.identifier, kIdentifier, sizeof(kIdentifier));
+        header.vk_format = static_cast<uint32_t>(format);
+        header.type_size = image.compressed ? 1 : image.bitdepth >> 3;
+        header.pixel_width = image.Width;
+        header.pixel_height = image.Height;
+        header.layer_count = image.array_size > 1 ? image.array_size : 0;
+        header.face_count = image.face_count;
+        header.level_count = levels;
+        header.dfd_byte_offset = static_cast<uint32_t>(dfd_offset);
+        header.dfd_byte_length = static_cast<uint32_t>(dfd_size);
+
+        // each level aligned to its texel blocks and to 4 bytes, the
+        // smallest one first
+        size_t pitch;
+        const size_t alignment = std::lcm<size_t>(
+            image.compressed ? GetMipSize(image, 1, 1, pitch)
+                             : image.bitcount >> 3,
+            4);
+        std::vector<LevelIndex> index(levels);
+        size_t offset = dfd_offset + dfd_size;
+        for (uint32_t level = levels; level-- > 0;) {
+            offset = (offset + alignment - 1) / alignment * alignment;
+            const Image::Mipmap& mip = mipmaps[level];
+            index[level].byte_offset = offset;
+            index[level].byte_length =
+                (uint64_t)GetMipSize(image, mip.Width, mip.Height, pitch) *
+                images;
+            index[level].uncompressed_byte_length = index[level].byte_length;
+            offset += index[level].byte_length;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(index.data()),
+                  index.size() * sizeof(LevelIndex));
+        out.write(reinterpret_cast<const char*>(dfd.data()), dfd_size);
+
+        size_t written = dfd_offset + dfd_size;
+        const char padding[16] = {};
+        for (uint32_t level = levels; level-- > 0;) {
+            out.write(padding, index[level].byte_offset - written);
+            for (uint32_t i = 0; i < images; i++) {
+                const Image::Mipmap& mip = mipmaps[i * levels + level];
+                const auto* data =
+                    reinterpret_cast<const char*>(image.data + mip.offset);
+                const size_t size =
+                    GetMipSize(image, mip.Width, mip.Height, pitch);
+                const size_t rows = size / pitch;
+                for (size_t row = 0; row < rows; row++) {
+                    out.write(data + row * mip.pitch, pitch);
+                }
+            }
+            written = index[level].byte_offset + index[level].byte_length;
+        }
+        return out.good();
+    }
+
+   private:
+    // the data format descriptor values used here
+    enum : uint32_t {
+        kModelRgbsda = 1,
+        kModelBc1a = 128,
+        kModelBc2 = 129,
+        kModelBc3 = 130,
+        kModelBc4 = 131,
+        kModelBc5 = 132,
+        kModelBc6h = 133,
+        kModelBc7 = 134,
+        kModelEtc2 = 161,
+        kModelAstc = 162,
+        kChannelAlpha = 15,
+        kQualifierLinear = 0x10,
+        kQualifierSigned = 0x40,
+        kQualifierFloat = 0x80
+    };
+
+    struct Sample {
+        uint32_t bit_offset;
+        uint32_t bit_length;
+        uint32_t channel;  // and qualifiers
+        uint32_t lower;
+        uint32_t upper;
+    };
+
+    static void astcBlock(const COMPRESSED_FORMAT format, uint32_t& width,
+                          uint32_t& height) {
+        static constexpr uint8_t kBlocks[][2] = {
+            {4, 4}, {5, 4}, {5, 5},  {6, 5},   {6, 6},   {8, 5},   {8, 6},
+            {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}};
+        const auto index = static_cast<uint32_t>(format) -
+                           static_cast<uint32_t>(COMPRESSED_FORMAT::ASTC_4x4);
+        width = kBlocks[index][0];
+        height = kBlocks[index][1];
+    }
+
+    static std::vector<uint32_t> makeDfd(const Image& image, const bool srgb) {
+        uint32_t model = kModelRgbsda;
+        uint32_t block_width = 1;
+        uint32_t block_height = 1;
+        size_t pitch;
+        const uint32_t bytes =
+            image.compressed
+                ? static_cast<uint32_t>(GetMipSize(image, 1, 1, pitch))
+                : image.bitcount >> 3;
+        const uint32_t alpha =
+            kChannelAlpha | (srgb ? (uint32_t)kQualifierLinear : 0);
+        const uint32_t snorm_lower = image.is_signed ? 0x80000000 : 0;
+        const uint32_t snorm_upper = image.is_signed ? 0x7FFFFFFF : UINT32_MAX;
+        const uint32_t snorm = image.is_signed ? (uint32_t)kQualifierSigned : 0;
+        std::vector<Sample> samples;
+
+        if (image.compressed) {
+            block_width = block_height = 4;
+            switch (image.compress_format) {
+                case COMPRESSED_FORMAT::DXT1:
+                case COMPRESSED_FORMAT::BC1:
+                    model = kModelBc1a;
+                    samples.push_back({0, 64, 0, 0, UINT32_MAX});
+                    break;
+                case COMPRESSED_FORMAT::BC1A:
+                    model = kModelBc1a;
+                    samples.push_back({0, 64, 1, 0, UINT32_MAX});
+                    break;
+                case COMPRESSED_FORMAT::DXT2:
+                case COMPRESSED_FORMAT::DXT3:
+                case COMPRESSED_FORMAT::BC2:
+                    model = kModelBc2;
+                    samples.push_back({0, 64, alpha, 0, UINT32_MAX});
+                    samples.push_back({64, 64, 0, 0, UINT32_MAX});
+                    break;
+                case COMPRESSED_FORMAT::DXT4:
+                case COMPRESSED_FORMAT::DXT5:
+                case COMPRESSED_FORMAT::BC3:
+                    model = kModelBc3;
+                    samples.push_back({0, 64, alpha, 0, UINT32_MAX});
+                    samples.push_back({64, 64, 0, 0, UINT32_MAX});
+                    break;
+                case COMPRESSED_FORMAT::BC4:
+                    model = kModelBc4;
+                    samples.push_back(
+                        {0, 64, snorm, snorm_lower, snorm_upper});
+                    break;
+                case COMPRESSED_FORMAT::BC5:
+                    model = kModelBc5;
+                    samples.push_back(
+                        {0, 64, snorm, snorm_lower, snorm_upper});
+                    samples.push_back(
+                        {64, 64, 1 | snorm, snorm_lower, snorm_upper});
+                    break;
+                case COMPRESSED_FORMAT::BC6H:
+                    model = kModelBc6h;
+                    samples.push_back(
+                        {0, 128, kQualifierFloat | snorm,
+                         image.is_signed ? 0xBF800000 : 0, 0x3F800000});
+                    break;
+                case COMPRESSED_FORMAT::BC7:
+                    model = kModelBc7;
+                    samples.push_back({0, 128, 0, 0, UINT32_MAX});
+                    break;
+                case COMPRESSED_FORMAT::ETC:
+                    model = kModelEtc2;
+                    samples.push_back({0, 64, 0, 0, UINT32_MAX});
+                    break;
+                default:
+                    model = kModelAstc;
+                    astcBlock(image.compress_format, block_width,
+                              block_height);
+                    samples.push_back({0, 128, 0, 0, UINT32_MAX});
+            }
+        } else {
+            // a sample a channel, R, G, B then A
+            const uint32_t channels = image.bitcount / image.bitdepth;
+            const uint32_t bits = image.bitdepth;
+            for (uint32_t c = 0; c < channels; c++) {
+                const uint32_t channel = c == 3 ? alpha : c;
+                if (image.is_float) {
+                    samples.push_back(
+                        {c * bits, bits,
+                         channel | kQualifierFloat | kQualifierSigned,
+                         0xBF800000, 0x3F800000});
+                } else {
+                    samples.push_back(
+                        {c * bits, bits, channel, 0,
+                         bits == 32 ? UINT32_MAX : (1u << bits) - 1});
+                }
+            }
+        }
+
+        const auto block_size =
+            static_cast<uint32_t>(24 + samples.size() * 16);
+        std::vector<uint32_t> dfd = {
+            4 + block_size,
+            0,  // vendor and descriptor type
+            2 | block_size << 16,
+            model | 1 << 8 /* BT709 */ | (srgb ? 2 : 1) << 16,
+            (block_width - 1) | (block_height - 1) << 8,
+            bytes,
+            0};
+        for (const auto& sample : samples) {
+            dfd.push_back(sample.bit_offset | (sample.bit_length - 1) << 16 |
+                          sample.channel << 24);
+            dfd.push_back(0);  // the sample position
+            dfd.push_back(sample.lower);
+            dfd.push_back(sample.upper);
+        }
+        return dfd;
+    }
+
+    static VkFormat getVkFormat(const Image& image, const bool srgb) {
+        const auto pick = [srgb](const VkFormat unorm, const VkFormat srgb_) {
+            return srgb ? srgb_ : unorm;
+        };
+        if (image.compressed) {
+            switch (image.compress_format) {
+                case COMPRESSED_FORMAT::DXT1:
+                case COMPRESSED_FORMAT::BC1:
+                    return pick(VkFormat::BC1_RGB_UNORM_BLOCK,
+                                VkFormat::BC1_RGB_SRGB_BLOCK);
+                case COMPRESSED_FORMAT::BC1A:
+                    return pick(VkFormat::BC1_RGBA_UNORM_BLOCK,
+                                VkFormat::BC1_RGBA_SRGB_BLOCK);
+                case COMPRESSED_FORMAT::DXT2:
+                case COMPRESSED_FORMAT::DXT3:
+                case COMPRESSED_FORMAT::BC2:
+                    return pick(VkFormat::BC2_UNORM_BLOCK,
+                                VkFormat::BC2_SRGB_BLOCK);
+                case COMPRESSED_FORMAT::DXT4:
+                case COMPRESSED_FORMAT::DXT5:
+                case COMPRESSED_FORMAT::BC3:
+                    return pick(VkFormat::BC3_UNORM_BLOCK,
+                                VkFormat::BC3_SRGB_BLOCK);
+                case COMPRESSED_FORMAT::BC7:
+                    return pick(VkFormat::BC7_UNORM_BLOCK,
+                                VkFormat::BC7_SRGB_BLOCK);
+                case COMPRESSED_FORMAT::ETC:
+                    return pick(VkFormat::ETC2_R8G8B8_UNORM_BLOCK,
+                                VkFormat::ETC2_R8G8B8_SRGB_BLOCK);
+                default:;
+            }
+            if (image.compress_format >= COMPRESSED_FORMAT::ASTC_4x4 &&
+                image.compress_format <= COMPRESSED_FORMAT::ASTC_12x12) {
+                // UNORM and SRGB of each 2D block size
+                const uint32_t index =
+                    static_cast<uint32_t>(image.compress_format) -
+                    static_cast<uint32_t>(COMPRESSED_FORMAT::ASTC_4x4);
+                return static_cast<VkFormat>(
+                    static_cast<uint32_t>(VkFormat::ASTC_4x4_UNORM_BLOCK) +
+                    index * 2 + srgb);
+            }
+            if (srgb) return VkFormat::UNDEFINED;
+            switch (image.compress_format) {
+                case COMPRESSED_FORMAT::BC4:
+                    return image.is_signed ? VkFormat::BC4_SNORM_BLOCK
+                                           : VkFormat::BC4_UNORM_BLOCK;
+                case COMPRESSED_FORMAT::BC5:
+                    return image.is_signed ? VkFormat::BC5_SNORM_BLOCK
+                                           : VkFormat::BC5_UNORM_BLOCK;
+                case COMPRESSED_FORMAT::BC6H:
+                    return image.is_signed ? VkFormat::BC6H_SFLOAT_BLOCK
+                                           : VkFormat::BC6H_UFLOAT_BLOCK;
+                default:
+                    return VkFormat::UNDEFINED;
+            }
+        }
+
+        switch (image.pixel_format) {
+            case PIXEL_FORMAT::RGB8:
+                return pick(VkFormat::R8G8B8_UNORM, VkFormat::R8G8B8_SRGB);
+            case PIXEL_FORMAT::RGBA8:
+                return pick(VkFormat::R8G8B8A8_UNORM, VkFormat::R8G8B8A8_SRGB);
+            default:;
+        }
+        if (srgb) return VkFormat::UNDEFINED;
+        switch (image.pixel_format) {
+            case PIXEL_FORMAT::R8:
+                return VkFormat::R8_UNORM;
+            case PIXEL_FORMAT::RG8:
+                return VkFormat::R8G8_UNORM;
+            case PIXEL_FORMAT::R16:
+                return image.is_float ? VkFormat::R16_SFLOAT
+                                      : VkFormat::UNDEFINED;
+            case PIXEL_FORMAT::RG16:
+                return image.is_float ? VkFormat::R16G16_SFLOAT
+                                      : VkFormat::UNDEFINED;
+            case PIXEL_FORMAT::RGBA16:
+                return image.is_float ? VkFormat::R16G16B16A16_SFLOAT
+                                      : VkFormat::R16G16B16A16_UNORM;
+            case PIXEL_FORMAT::R32:
+                return VkFormat::R32_SFLOAT;
+            case PIXEL_FORMAT::RG32:
+                return VkFormat::R32G32_SFLOAT;
+            case PIXEL_FORMAT::RGB32:
+                return VkFormat::R32G32B32_SFLOAT;
+            case PIXEL_FORMAT::RGBA32:
+                return VkFormat::R32G32B32A32_SFLOAT;
+            default:
+                return VkFormat::UNDEFINED;
+        }
+    }
+};
+}  // namespace KTX2
+}  // namespace My
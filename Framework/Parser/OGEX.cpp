@@ -370,10 +370,15 @@ void OgexParser::ConvertOddlStructureToSceneNode(
                         sub_structure = sub_structure->Next();
                     }
 
+                    mesh->Optimize();
+                    mesh->BuildMeshlets();
+
                     _object->AddMesh(std::move(mesh));
                 }
             }
 
+            _object->GenerateLods(GfxConfiguration::kMaxLodCount);
+
             scene.Geometries[_key] = _object;
         }
             return;
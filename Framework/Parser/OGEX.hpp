@@ -4,6 +4,7 @@
 
 #include "Bezier.hpp"
 #include "Curve.hpp"
+#include "GfxConfiguration.hpp"
 #include "ISceneParser.hpp"
 #include "Linear.hpp"
 #include "SceneNode.hpp"
@@ -3,10 +3,11 @@
 #include <cassert>
 #include <cstdio>
 #include <iostream>
-#include <queue>
 #include <string>
+#include <vector>
 
 #include "IImageParser.hpp"
+#include "PngFilter.hpp"
 #include "config.h"
 #include "portable.hpp"
 #include "zlib.h"
@@ -17,8 +18,8 @@ struct PNG_FILEHEADER {
     uint64_t Signature;
 };
 
-ENUM(PNG_CHUNK_TYPE){IHDR = "IHDR"_u32, PLTE = "PLTE"_u32, IDAT = "IDAT"_u32,
-                     IEND = "IEND"_u32};
+ENUM(PNG_CHUNK_TYPE){IHDR = "IHDR"_u32, PLTE = "PLTE"_u32, tRNS = "tRNS"_u32,
+                     IDAT = "IDAT"_u32, IEND = "IEND"_u32};
 
 #if DUMP_DETAILS
 static std::ostream& operator<<(std::ostream& out, PNG_CHUNK_TYPE type) {
@@ -78,27 +79,272 @@ static void zerr(int ret) {
 
 class PngParser : _implements_ ImageParser {
    protected:
-    uint16_t m_Width;
-    uint16_t m_Height;
+    uint32_t m_Width;
+    uint32_t m_Height;
     uint8_t m_BitDepth;
     uint8_t m_ColorType;
     uint8_t m_CompressionMethod;
     uint8_t m_FilterMethod;
     uint8_t m_InterlaceMethod;
-    int32_t m_ScanLineSize;
+    // bytes of a scanline without its filter type
+    size_t m_ScanLineSize;
+    // bytes of a complete pixel as the filters see it, at least 1
     uint8_t m_BytesPerPixel;
 
+    // RGBA entries of PLTE, the alpha comes from tRNS
+    uint8_t m_Palette[256][4];
+    // tRNS of any color type, the key of grayscale and truecolor images
+    bool m_bHasTransparency;
+    uint16_t m_TransparentColor[3];
+
+    // the scanlines are inflated straight into the image unless the pixels
+    // need expanding, then they go through two scanlines of their own
+    bool m_bExpand;
+    std::vector<uint8_t> m_ScanLines;
+    z_stream m_Stream;
+    bool m_bInflating;
+    uint32_t m_CurrentRow;
+    size_t m_CurrentColumn;
+    uint8_t m_FilterType;
+    bool m_bFilterTypeRead;
+
+   protected:
+    // chooses the pixel format of the image once PLTE and tRNS are known
+    bool setupImage(Image& img) {
+        uint32_t channels = 0;
+        switch (m_ColorType) {
+            case 0:  // grayscale
+                channels = 1;
+                break;
+            case 2:  // rgb true color
+                channels = 3;
+                break;
+            case 3:  // indexed
+                channels = 3;
+                break;
+            case 4:  // grayscale with alpha
+                channels = 2;
+                break;
+            case 6:  // RGBA
+                channels = 4;
+                break;
+            default:
+                std::cerr << "Unkown Color Type: " << (int)m_ColorType
+                          << std::endl;
+                return false;
+        }
+
+        // tRNS adds the alpha channel
+        if (m_bHasTransparency && channels != 2 && channels != 4) {
+            channels++;
+        }
+
+        const bool wide = m_BitDepth == 16;
+        const PIXEL_FORMAT formats[2][4] = {
+            {PIXEL_FORMAT::R8, PIXEL_FORMAT::RG8, PIXEL_FORMAT::RGB8,
+             PIXEL_FORMAT::RGBA8},
+            {PIXEL_FORMAT::R16, PIXEL_FORMAT::RG16, PIXEL_FORMAT::RGB16,
+             PIXEL_FORMAT::RGBA16}};
+        img.pixel_format = formats[wide][channels - 1];
+
+        // palettes and bit depths below 8 always expand
+        m_bExpand =
+            m_ColorType == 3 || m_BitDepth < 8 || m_bHasTransparency;
+
+        img.Width = m_Width;
+        img.Height = m_Height;
+        img.bitcount = channels * (wide ? 16 : 8);
+        img.bitdepth = wide ? 16 : 8;
+        img.pitch = ALIGN(m_Width * (img.bitcount >> 3),
+                          4);  // for GPU address alignment
+        img.data_size = (size_t)img.pitch * img.Height;
+        img.data = new uint8_t[img.data_size];
+
+        // two scanlines for expanding, or the zeros above the first one
+        m_ScanLines.assign(m_bExpand ? m_ScanLineSize * 2 : m_ScanLineSize,
+                           0);
+        m_CurrentRow = 0;
+        m_CurrentColumn = 0;
+        m_bFilterTypeRead = false;
+
+        m_Stream.zalloc = Z_NULL;
+        m_Stream.zfree = Z_NULL;
+        m_Stream.opaque = Z_NULL;
+        m_Stream.avail_in = 0;
+        m_Stream.next_in = Z_NULL;
+        int ret = inflateInit(&m_Stream);
+        if (ret != Z_OK) {
+            std::cerr << "[Error] Failed to init zlib" << std::endl;
+            zerr(ret);
+            return false;
+        }
+        m_bInflating = true;
+
+        return true;
+    }
+
+    uint8_t* scanLine(Image& img, const uint32_t row) {
+        if (m_bExpand) {
+            return m_ScanLines.data() + (row & 1) * m_ScanLineSize;
+        }
+        return img.data + (ptrdiff_t)img.pitch * row;
+    }
+
+    const uint8_t* priorScanLine(Image& img, const uint32_t row) {
+        if (m_bExpand) {
+            return m_ScanLines.data() + ((row + 1) & 1) * m_ScanLineSize;
+        }
+        return row ? img.data + (ptrdiff_t)img.pitch * (row - 1)
+                   : m_ScanLines.data();
+    }
+
+    // the samples of 16-bit images are big endian
+    void swapScanLine(Image& img, const uint32_t row) const {
+        auto* p = reinterpret_cast<uint16_t*>(img.data +
+                                              (ptrdiff_t)img.pitch * row);
+        auto* pEnd = p + m_ScanLineSize / 2;
+        for (; p < pEnd; p++) {
+            *p = endian_net_unsigned_int(*p);
+        }
+    }
+
+    // sample `x` of a scanline with a bit depth of 8 or below
+    uint8_t sample(const uint8_t* in, const uint32_t x) const {
+        if (m_BitDepth == 8) return in[x];
+        const uint32_t bit = x * m_BitDepth;
+        return (in[bit >> 3] >> (8 - m_BitDepth - (bit & 7))) &
+               ((1 << m_BitDepth) - 1);
+    }
+
+    // palette lookup, bit depths below 8 and tRNS
+    void expandScanLine(const uint8_t* in, uint8_t* out) const {
+        if (m_ColorType == 3) {
+            const uint32_t channels = m_bHasTransparency ? 4 : 3;
+            for (uint32_t x = 0; x < m_Width; x++) {
+                memcpy(out + x * channels, m_Palette[sample(in, x)],
+                       channels);
+            }
+        } else if (m_BitDepth <= 8) {
+            const uint32_t channels = m_ColorType == 2 ? 3 : 1;
+            const uint32_t stride = channels + (m_bHasTransparency ? 1 : 0);
+            const uint8_t scale = 255 / ((1 << m_BitDepth) - 1);
+            for (uint32_t x = 0; x < m_Width; x++) {
+                bool transparent = m_bHasTransparency;
+                for (uint32_t k = 0; k < channels; k++) {
+                    const uint8_t value = sample(in, x * channels + k);
+                    transparent &= value == m_TransparentColor[k];
+                    out[x * stride + k] = value * scale;
+                }
+                if (m_bHasTransparency) {
+                    out[x * stride + channels] = transparent ? 0 : 255;
+                }
+            }
+        } else {
+            // 16-bit with a transparent color
+            const uint32_t channels = m_ColorType == 2 ? 3 : 1;
+            auto* pOut = reinterpret_cast<uint16_t*>(out);
+            for (uint32_t x = 0; x < m_Width; x++) {
+                bool transparent = true;
+                for (uint32_t k = 0; k < channels; k++) {
+                    const uint8_t* p = in + (x * channels + k) * 2;
+                    const auto value =
+                        static_cast<uint16_t>((p[0] << 8) | p[1]);
+                    transparent &= value == m_TransparentColor[k];
+                    pOut[x * (channels + 1) + k] = value;
+                }
+                pOut[x * (channels + 1) + channels] = transparent ? 0 : 0xFFFF;
+            }
+        }
+    }
+
+    bool finishScanLine(Image& img) {
+        const uint32_t row = m_CurrentRow;
+        uint8_t* pScanLine = scanLine(img, row);
+        if (!UnfilterPngRow(m_FilterType, pScanLine, priorScanLine(img, row),
+                            m_ScanLineSize, m_BytesPerPixel)) {
+            std::cerr << "[Error] Unknown Filter Type!" << std::endl;
+            return false;
+        }
+
+        if (m_bExpand) {
+            expandScanLine(pScanLine, img.data + (ptrdiff_t)img.pitch * row);
+        } else if (m_BitDepth == 16) {
+            // the scanline above is no longer needed by the filters
+            if (row > 0) swapScanLine(img, row - 1);
+            if (row + 1 == m_Height) swapScanLine(img, row);
+        }
+
+        m_CurrentRow++;
+        m_CurrentColumn = 0;
+        m_bFilterTypeRead = false;
+        return true;
+    }
+
+    // inflates the data of an IDAT chunk, each scanline is unfiltered as
+    // soon as it is complete
+    bool inflateChunk(Image& img, const uint8_t* pData, const size_t size) {
+        m_Stream.next_in = const_cast<Bytef*>(pData);
+        m_Stream.avail_in = static_cast<uInt>(size);
+        while (m_Stream.avail_in > 0 && m_CurrentRow < m_Height) {
+            uint8_t* pOut;
+            size_t out_size;
+            if (!m_bFilterTypeRead) {
+                pOut = &m_FilterType;
+                out_size = 1;
+            } else {
+                pOut = scanLine(img, m_CurrentRow) + m_CurrentColumn;
+                out_size = m_ScanLineSize - m_CurrentColumn;
+            }
+            m_Stream.next_out = static_cast<Bytef*>(pOut);
+            m_Stream.avail_out = static_cast<uInt>(out_size);
+
+            const int ret = inflate(&m_Stream, Z_NO_FLUSH);
+            switch (ret) {
+                case Z_OK:
+                case Z_STREAM_END:
+                case Z_BUF_ERROR:
+                    break;
+                default:
+                    zerr(ret);
+                    return false;
+            }
+
+            const size_t produced = out_size - m_Stream.avail_out;
+            if (!m_bFilterTypeRead) {
+                m_bFilterTypeRead = produced == 1;
+            } else {
+                m_CurrentColumn += produced;
+                if (m_CurrentColumn == m_ScanLineSize &&
+                    !finishScanLine(img)) {
+                    return false;
+                }
+            }
+
+            if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && !produced)) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
    public:
     Image Parse(Buffer& buf) override {
         Image img;
 
-        uint8_t* pData = buf.GetData();
-        uint8_t* pDataEnd = buf.GetData() + buf.GetDataSize();
+        const uint8_t* pData = buf.GetData();
+        const uint8_t* pDataEnd = buf.GetData() + buf.GetDataSize();
 
         bool imageDataStarted = false;
         bool imageDataEnded = false;
-        uint8_t* imageDataStartPos = nullptr;
-        uint8_t* imageDataEndPos = nullptr;
+        bool imageDataFailed = false;
+
+        for (auto& entry : m_Palette) {
+            entry[0] = entry[1] = entry[2] = 0;
+            entry[3] = 255;
+        }
+        m_bHasTransparency = false;
+        m_bInflating = false;
 
         const auto* pFileHeader =
             reinterpret_cast<const PNG_FILEHEADER*>(pData);
@@ -107,13 +353,21 @@ class PngParser : _implements_ ImageParser {
             endian_net_unsigned_int((uint64_t)0x89504E470D0A1A0A)) {
             std::cerr << "Asset is PNG file" << std::endl;
 
-            while (pData < pDataEnd) {
+            while (pData + sizeof(PNG_CHUNK_HEADER) <= pDataEnd) {
                 const auto* pChunkHeader =
                     reinterpret_cast<const PNG_CHUNK_HEADER*>(pData);
                 auto type = static_cast<PNG_CHUNK_TYPE>(endian_net_unsigned_int(
                     static_cast<uint32_t>(pChunkHeader->Type)));
                 uint32_t chunk_data_size =
                     endian_net_unsigned_int(pChunkHeader->Length);
+                const uint8_t* pChunkData = pData + sizeof(PNG_CHUNK_HEADER);
+
+                if (chunk_data_size > (size_t)(pDataEnd - pChunkData)) {
+                    std::cerr << "PNG file looks corrupted. Chunk exceeds "
+                                 "the end of file."
+                              << std::endl;
+                    break;
+                }
 
 #if DUMP_DETAILS
                 std::cerr << "============================" << std::endl;
@@ -136,88 +390,26 @@ class PngParser : _implements_ ImageParser {
                         m_FilterMethod = pIHDRHeader->FilterMethod;
                         m_InterlaceMethod = pIHDRHeader->InterlaceMethod;
 
+                        uint32_t samples_per_pixel = 1;
                         switch (m_ColorType) {
-                            case 0:  // grayscale
-                                m_BytesPerPixel = (m_BitDepth + 7) >> 3;
-                                switch (m_BytesPerPixel) {
-                                    case 1:
-                                        img.pixel_format = PIXEL_FORMAT::R8;
-                                        break;
-                                    case 2:
-                                        img.pixel_format = PIXEL_FORMAT::R16;
-                                        break;
-                                    case 4:
-                                        img.pixel_format = PIXEL_FORMAT::R32;
-                                        break;
-                                    default:
-                                        assert(0);
-                                }
-                                break;
                             case 2:  // rgb true color
-                                m_BytesPerPixel = (m_BitDepth * 3 + 7) >> 3;
-                                switch (m_BytesPerPixel) {
-                                    case 3:
-                                        img.pixel_format = PIXEL_FORMAT::RGB8;
-                                        break;
-                                    case 6:
-                                        img.pixel_format = PIXEL_FORMAT::RGB16;
-                                        break;
-                                    case 12:
-                                        img.pixel_format = PIXEL_FORMAT::RGB32;
-                                        break;
-                                    default:
-                                        assert(0);
-                                }
-                                break;
-                            case 3:  // indexed
-                                m_BytesPerPixel = (m_BitDepth + 7) >> 3;
-                                std::cerr
-                                    << "Color Type 3 is not supported yet: "
-                                    << m_ColorType << std::endl;
-                                assert(0);
+                                samples_per_pixel = 3;
                                 break;
                             case 4:  // grayscale with alpha
-                                m_BytesPerPixel = (m_BitDepth * 2 + 7) >> 3;
-                                std::cerr
-                                    << "Color Type 4 is not supported yet: "
-                                    << m_ColorType << std::endl;
-                                assert(0);
+                                samples_per_pixel = 2;
                                 break;
                             case 6:  // RGBA
-                                m_BytesPerPixel = (m_BitDepth * 4 + 7) >> 3;
-                                switch (m_BytesPerPixel) {
-                                    case 4:
-                                        img.pixel_format = PIXEL_FORMAT::RGBA8;
-                                        break;
-                                    case 8:
-                                        img.pixel_format = PIXEL_FORMAT::RGBA16;
-                                        break;
-                                    case 16:
-                                        img.pixel_format = PIXEL_FORMAT::RGBA32;
-                                        break;
-                                    default:
-                                        assert(0);
-                                }
+                                samples_per_pixel = 4;
                                 break;
                             default:
-                                std::cerr
-                                    << "Unkown Color Type: " << m_ColorType
-                                    << std::endl;
-                                assert(0);
+                                break;
                         }
 
-                        assert(img.pixel_format != PIXEL_FORMAT::UNKNOWN);
-
-                        m_ScanLineSize = m_BytesPerPixel * m_Width;
-
-                        img.Width = m_Width;
-                        img.Height = m_Height;
-                        img.bitcount = m_BytesPerPixel * 8;
-                        img.bitdepth = m_BitDepth;
-                        img.pitch = ALIGN(m_Width * m_BytesPerPixel,
-                                          4);  // for GPU address alignment
-                        img.data_size = (size_t)img.pitch * img.Height;
-                        img.data = new uint8_t[img.data_size];
+                        const uint32_t bits_per_pixel =
+                            samples_per_pixel * m_BitDepth;
+                        m_BytesPerPixel = (bits_per_pixel + 7) >> 3;
+                        m_ScanLineSize =
+                            ((size_t)m_Width * bits_per_pixel + 7) >> 3;
 
 #if DUMP_DETAILS
                         std::cerr << "Width: " << m_Width << std::endl;
@@ -240,15 +432,45 @@ class PngParser : _implements_ ImageParser {
                         std::cerr << "PLTE (Palette)" << std::endl;
                         std::cerr << "----------------------------"
                                   << std::endl;
-                        const PNG_PLTE_HEADER* pPLTEHeader =
-                            reinterpret_cast<const PNG_PLTE_HEADER*>(pData);
-                        for (auto i = 0; i < chunk_data_size /
-                                                 sizeof(*pPLTEHeader->pEntries);
-                             i++) {
+#endif
+                        const uint32_t count =
+                            std::min<uint32_t>(chunk_data_size / 3, 256);
+                        for (uint32_t i = 0; i < count; i++) {
+                            memcpy(m_Palette[i], pChunkData + i * 3, 3);
+#if DUMP_DETAILS
                             std::cerr << "Entry " << i << ": "
-                                      << pPLTEHeader->pEntries[i] << std::endl;
+                                      << (int)m_Palette[i][0] << ", "
+                                      << (int)m_Palette[i][1] << ", "
+                                      << (int)m_Palette[i][2] << std::endl;
+#endif
                         }
+                    } break;
+                    case PNG_CHUNK_TYPE::tRNS: {
+#if DUMP_DETAILS
+                        std::cerr << "tRNS (Transparency)" << std::endl;
+                        std::cerr << "----------------------------"
+                                  << std::endl;
 #endif
+                        if (m_ColorType == 3) {
+                            const uint32_t count =
+                                std::min<uint32_t>(chunk_data_size, 256);
+                            for (uint32_t i = 0; i < count; i++) {
+                                m_Palette[i][3] = pChunkData[i];
+                            }
+                            m_bHasTransparency = true;
+                        } else if ((m_ColorType == 0 &&
+                                    chunk_data_size >= 2) ||
+                                   (m_ColorType == 2 &&
+                                    chunk_data_size >= 6)) {
+                            const uint32_t count =
+                                std::min<uint32_t>(chunk_data_size / 2, 3);
+                            for (uint32_t k = 0; k < count; k++) {
+                                m_TransparentColor[k] = static_cast<uint16_t>(
+                                    (pChunkData[k * 2] << 8) |
+                                    pChunkData[k * 2 + 1]);
+                            }
+                            m_bHasTransparency = true;
+                        }
                     } break;
                     case PNG_CHUNK_TYPE::IDAT: {
 #if DUMP_DETAILS
@@ -270,16 +492,20 @@ class PngParser : _implements_ ImageParser {
 
                         if (!imageDataStarted) {
                             imageDataStarted = true;
-                            imageDataStartPos =
-                                pData + sizeof(PNG_CHUNK_HEADER);
-                            imageDataEndPos =
-                                imageDataStartPos + chunk_data_size;
-                        } else {
-                            // concat the IDAT blocks
-                            memcpy(imageDataEndPos,
-                                   pData + sizeof(PNG_CHUNK_HEADER),
-                                   chunk_data_size);
-                            imageDataEndPos += chunk_data_size;
+                            if (m_InterlaceMethod != 0) {
+                                std::cerr << "Interlaced PNG is not supported "
+                                             "yet."
+                                          << std::endl;
+                                imageDataFailed = true;
+                            } else if (!setupImage(img)) {
+                                imageDataFailed = true;
+                            }
+                        }
+
+                        // each IDAT chunk is inflated as it comes
+                        if (!imageDataFailed &&
+                            !inflateChunk(img, pChunkData, chunk_data_size)) {
+                            imageDataFailed = true;
                         }
                     } break;
                     case PNG_CHUNK_TYPE::IEND: {
@@ -289,9 +515,6 @@ class PngParser : _implements_ ImageParser {
                                   << std::endl;
 #endif
 
-                        size_t compressed_data_size =
-                            imageDataEndPos - imageDataStartPos;
-
                         if (!imageDataStarted) {
                             std::cerr << "PNG file looks corrupted. Found IEND "
                                          "before IDAT."
@@ -301,186 +524,11 @@ class PngParser : _implements_ ImageParser {
 
                         imageDataEnded = true;
 
-                        const uint32_t kChunkSize = 256 * 1024;
-                        z_stream strm;
-                        strm.zalloc = Z_NULL;
-                        strm.zfree = Z_NULL;
-                        strm.opaque = Z_NULL;
-                        strm.avail_in = 0;
-                        strm.next_in = Z_NULL;
-                        int ret = inflateInit(&strm);
-                        if (ret != Z_OK) {
-                            std::cerr << "[Error] Failed to init zlib"
-                                      << std::endl;
-                            zerr(ret);
-                            break;
+                        if (!imageDataFailed && m_CurrentRow < m_Height) {
+                            std::cerr << "PNG file looks corrupted. Image data "
+                                         "ends at row "
+                                      << m_CurrentRow << "." << std::endl;
                         }
-
-                        const uint8_t* pIn =
-                            imageDataStartPos;  // point to the start of the
-                                                // input data buffer
-                        auto* pOut = reinterpret_cast<uint8_t*>(
-                            img.data);  // point to the start of the input data
-                                        // buffer
-                        auto* pDecompressedBuffer = new uint8_t[kChunkSize];
-                        uint8_t filter_type = 0;
-                        int current_row = 0;
-                        int current_col =
-                            -1;  // -1 means we need read filter type
-
-                        do {
-                            uint32_t next_in_size =
-                                (compressed_data_size > kChunkSize)
-                                    ? kChunkSize
-                                    : (uint32_t)compressed_data_size;
-                            if (next_in_size == 0) break;
-                            compressed_data_size -= next_in_size;
-                            strm.next_in = const_cast<Bytef*>(pIn);
-                            strm.avail_in = next_in_size;
-                            do {
-                                strm.avail_out = kChunkSize;  // 256K
-                                strm.next_out =
-                                    static_cast<Bytef*>(pDecompressedBuffer);
-                                ret = inflate(&strm, Z_NO_FLUSH);
-                                assert(ret != Z_STREAM_ERROR);
-                                switch (ret) {
-                                    case Z_NEED_DICT:
-                                    case Z_DATA_ERROR:
-                                    case Z_MEM_ERROR:
-                                        zerr(ret);
-                                        ret = Z_STREAM_END;
-                                    default:
-                                        // now we de-filter the data into image
-                                        uint8_t* p = pDecompressedBuffer;
-                                        while (p - pDecompressedBuffer <
-                                               (kChunkSize - strm.avail_out)) {
-                                            if (current_col == -1) {
-                                                // we are at start of scan line,
-                                                // get the filter type and
-                                                // advance the pointer
-                                                filter_type = *p;
-                                            } else {
-                                                //  prediction filter
-                                                //  X is current value
-                                                //
-                                                //  C  B  D
-                                                //  A  X
-
-                                                uint8_t A, B, C;
-                                                if (current_row == 0) {
-                                                    B = C = 0;
-                                                } else {
-                                                    B = *(pOut +
-                                                          (ptrdiff_t)img.pitch *
-                                                              ((ptrdiff_t)
-                                                                   current_row -
-                                                               1) +
-                                                          current_col);
-                                                    C = (current_col <
-                                                         m_BytesPerPixel)
-                                                            ? 0
-                                                            : *(pOut +
-                                                                (ptrdiff_t)img
-                                                                        .pitch *
-                                                                    ((ptrdiff_t)
-                                                                         current_row -
-                                                                     1) +
-                                                                current_col -
-                                                                m_BytesPerPixel);
-                                                }
-
-                                                A = (current_col <
-                                                     m_BytesPerPixel)
-                                                        ? 0
-                                                        : *(pOut +
-                                                            (ptrdiff_t)
-                                                                    img.pitch *
-                                                                current_row +
-                                                            current_col -
-                                                            m_BytesPerPixel);
-
-                                                switch (filter_type) {
-                                                    case 0:
-                                                        *(pOut +
-                                                          (ptrdiff_t)img.pitch *
-                                                              current_row +
-                                                          current_col) = *p;
-                                                        break;
-                                                    case 1:
-                                                        *(pOut +
-                                                          (ptrdiff_t)img.pitch *
-                                                              current_row +
-                                                          current_col) = *p + A;
-                                                        break;
-                                                    case 2:
-                                                        *(pOut +
-                                                          (ptrdiff_t)img.pitch *
-                                                              current_row +
-                                                          current_col) = *p + B;
-                                                        break;
-                                                    case 3:
-                                                        *(pOut +
-                                                          (ptrdiff_t)img.pitch *
-                                                              current_row +
-                                                          current_col) =
-                                                            *p + (A + B) / 2;
-                                                        break;
-                                                    case 4: {
-                                                        int _p = A + B - C;
-                                                        int pa = abs(_p - A);
-                                                        int pb = abs(_p - B);
-                                                        int pc = abs(_p - C);
-                                                        if (pa <= pb &&
-                                                            pa <= pc) {
-                                                            *(pOut +
-                                                              (ptrdiff_t)img
-                                                                      .pitch *
-                                                                  current_row +
-                                                              current_col) =
-                                                                *p + A;
-                                                        } else if (pb <= pc) {
-                                                            *(pOut +
-                                                              (ptrdiff_t)img
-                                                                      .pitch *
-                                                                  current_row +
-                                                              current_col) =
-                                                                *p + B;
-                                                        } else {
-                                                            *(pOut +
-                                                              (ptrdiff_t)img
-                                                                      .pitch *
-                                                                  current_row +
-                                                              current_col) =
-                                                                *p + C;
-                                                        }
-                                                    } break;
-                                                    default:
-                                                        std::cerr
-                                                            << "[Error] "
-                                                               "Unknown Filter "
-                                                               "Type!"
-                                                            << std::endl;
-                                                        assert(0);
-                                                }
-                                            }
-
-                                            current_col++;
-                                            if (current_col == m_ScanLineSize) {
-                                                current_col = -1;
-                                                current_row++;
-                                            }
-
-                                            p++;
-                                        }
-                                }
-
-                            } while (strm.avail_out == 0);
-
-                            pIn += next_in_size;  // move pIn to next chunk
-                        } while (ret != Z_STREAM_END);
-
-                        (void)inflateEnd(&strm);
-                        delete[] pDecompressedBuffer;
                     } break;
                     default: {
 #if DUMP_DETAILS
@@ -489,33 +537,20 @@ class PngParser : _implements_ ImageParser {
 #endif
                     } break;
                 }
-                pData += chunk_data_size + sizeof(PNG_CHUNK_HEADER) +
-                         4 /* length of CRC */;
+                pData = pChunkData + chunk_data_size + 4 /* length of CRC */;
             }
         } else {
             std::cerr << "File is not a PNG file!" << std::endl;
         }
 
+        if (m_bInflating) {
+            (void)inflateEnd(&m_Stream);
+            m_bInflating = false;
+        }
+
         img.mipmaps.emplace_back(img.Width, img.Height, img.pitch, 0,
                                  img.data_size);
 
-        // now swap the endian
-        if (img.bitcount > 32) {
-            if (img.bitcount <= 64) {
-                for (auto* p = reinterpret_cast<uint16_t*>(img.data);
-                     p < reinterpret_cast<uint16_t*>(img.data + img.data_size);
-                     p++) {
-                    *p = endian_net_unsigned_int(*p);
-                }
-            } else {
-                for (auto* p = reinterpret_cast<uint32_t*>(img.data);
-                     p < reinterpret_cast<uint32_t*>(img.data + img.data_size);
-                     p++) {
-                    *p = endian_net_unsigned_int(*p);
-                }
-            }
-        }
-
         return img;
     }
 };
@@ -1,7 +1,10 @@
 
 #pragma once
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <vector>
+
 #include "IImageParser.hpp"
 
 namespace My {
@@ -83,6 +86,8 @@ enum class ChannelType : uint32_t {
     Float = 12
 };
 
+// 52 bytes as in the specification, the 64-bit pixel format would pad it
+#pragma pack(push, 4)
 struct Header {
     uint32_t version = 0x03525650;
     Flags flags;
@@ -97,6 +102,18 @@ struct Header {
     uint32_t mipmap_count;
     uint32_t metadata_size;
 };
+#pragma pack(pop)
+
+// an uncompressed pixel format, the names of the channels in the low bytes
+// and their bits in the high bytes
+constexpr uint64_t ChannelFormat(const char (&names)[5], const uint8_t r,
+                                 const uint8_t g = 0, const uint8_t b = 0,
+                                 const uint8_t a = 0) {
+    return (uint64_t)(uint8_t)names[0] | ((uint64_t)(uint8_t)names[1] << 8) |
+           ((uint64_t)(uint8_t)names[2] << 16) |
+           ((uint64_t)(uint8_t)names[3] << 24) | ((uint64_t)r << 32) |
+           ((uint64_t)g << 40) | ((uint64_t)b << 48) | ((uint64_t)a << 56);
+}
 
 struct MetaData {
     unsigned char fourCC[4];
@@ -136,60 +153,197 @@ inline std::ostream& operator<<(std::ostream& s, const PVR::File f) {
 
 class PvrParser : _implements_ ImageParser {
    public:
+    // describes the levels, faces and surfaces in place, the image takes
+    // over the buffer
     Image Parse(Buffer& buf) override {
         Image img;
-        PVR::Header* pHeader = reinterpret_cast<PVR::Header*>(buf.GetData());
-        if (pHeader->version == 0x03525650) {
-            std::cerr << "Asset is PVR file" << std::endl;
-            std::cerr << "PVR Header" << std::endl;
-            std::cerr << "----------------------------" << std::endl;
-            fprintf(stderr, "Image dimension: (%d x %d x %d)\n", pHeader->width,
-                    pHeader->height, pHeader->depth);
-            //std::cerr << "Image pixel format: " << pHeader->pixel_format << std::endl;
-
-            img.Width = pHeader->width;
-            img.Height = pHeader->height;
-            auto data_offset = sizeof(PVR::Header) + pHeader->metadata_size;
-            img.data_size = (size_t)buf.GetDataSize() - data_offset;
-            img.data = new uint8_t[img.data_size];
-            img.compressed = true;
-            switch (pHeader->pixel_format) {
-                case PVR::PixelFormat::BC1:
-                    img.compress_format = COMPRESSED_FORMAT::BC1;
-                    img.pitch = img.Width / 4 * 8;
+        const auto* pHeader =
+            reinterpret_cast<const PVR::Header*>(buf.GetData());
+        if (buf.GetDataSize() < sizeof(PVR::Header) ||
+            pHeader->version != 0x03525650) {
+            std::cerr << "Not a PVR file." << std::endl;
+            return img;
+        }
+
+        std::cerr << "Asset is PVR file" << std::endl;
+        std::cerr << "PVR Header" << std::endl;
+        std::cerr << "----------------------------" << std::endl;
+        fprintf(stderr, "Image dimension: (%d x %d x %d)\n", pHeader->width,
+                pHeader->height, pHeader->depth);
+
+        if (!setPixelFormat(*pHeader, img)) {
+            std::cerr << "Unsupported PVR pixel format." << std::endl;
+            return img;
+        }
+        if (pHeader->depth > 1) {
+            std::cerr << "Volume textures are not supported." << std::endl;
+            return img;
+        }
+
+        img.Width = pHeader->width;
+        img.Height = pHeader->height;
+        img.face_count = std::max(1u, pHeader->num_faces);
+        img.array_size = std::max(1u, pHeader->num_surfaces);
+        const uint32_t mipmap_count = std::max(1u, pHeader->mipmap_count);
+        const size_t data_size = buf.GetDataSize() - sizeof(PVR::Header);
+        if (!img.Width || !img.Height || mipmap_count > 32 ||
+            (std::max(img.Width, img.Height) >> (mipmap_count - 1)) == 0 ||
+            (uint64_t)img.array_size * img.face_count * mipmap_count >
+                data_size ||
+            pHeader->metadata_size > data_size) {
+            std::cerr << "Corrupt PVR header." << std::endl;
+            return img;
+        }
+
+        // the file holds every surface and face of a level, then the next
+        // level
+        std::vector<size_t> level_offsets(mipmap_count);
+        std::vector<size_t> level_sizes(mipmap_count);
+        std::vector<size_t> level_pitches(mipmap_count);
+        for (uint32_t level = 0; level < mipmap_count; level++) {
+            level_offsets[level] = img.data_size;
+            level_sizes[level] = GetMipSize(
+                img, std::max(1u, img.Width >> level),
+                std::max(1u, img.Height >> level), level_pitches[level]);
+            img.data_size += level_sizes[level] * img.array_size *
+                             img.face_count;
+        }
+
+        img.mipmaps.reserve((size_t)img.array_size * img.face_count *
+                            mipmap_count);
+        for (uint32_t layer = 0; layer < img.array_size; layer++) {
+            for (uint32_t face = 0; face < img.face_count; face++) {
+                for (uint32_t level = 0; level < mipmap_count; level++) {
+                    img.mipmaps.emplace_back(
+                        std::max(1u, img.Width >> level),
+                        std::max(1u, img.Height >> level),
+                        level_pitches[level],
+                        level_offsets[level] +
+                            ((size_t)layer * img.face_count + face) *
+                                level_sizes[level],
+                        level_sizes[level]);
+                }
+            }
+        }
+
+        // files written before the header was packed have 4 more bytes
+        size_t payload_offset = sizeof(PVR::Header) + pHeader->metadata_size;
+        const size_t payload_size = buf.GetDataSize() - payload_offset;
+        if (payload_size != img.data_size &&
+            payload_size == img.data_size + 4) {
+            payload_offset += 4;
+        }
+
+        if (payload_size < img.data_size) {
+            std::cerr << "PVR file is truncated, " << img.data_size
+                      << " bytes expected and " << payload_size << " found."
+                      << std::endl;
+            img.mipmaps.clear();
+            img.data_size = 0;
+            return img;
+        }
+
+        img.pitch = img.mipmaps[0].pitch;
+        img.storage = std::move(buf);
+        img.data = img.storage.GetData() + payload_offset;
+
+        return img;
+    }
+
+   private:
+    static bool setPixelFormat(const PVR::Header& header, Image& img) {
+        const auto format = static_cast<uint64_t>(header.pixel_format);
+        if (format >> 32) {
+            img.bitdepth = 8;
+            switch (format) {
+                case ChannelFormat("rgba", 8, 8, 8, 8):
+                    img.pixel_format = PIXEL_FORMAT::RGBA8;
                     break;
-                case PVR::PixelFormat::BC2:
-                    img.compress_format = COMPRESSED_FORMAT::BC2;
-                    img.pitch = img.Width / 4 * 16;
+                case ChannelFormat("rgb\0", 8, 8, 8):
+                    img.pixel_format = PIXEL_FORMAT::RGB8;
                     break;
-                case PVR::PixelFormat::BC3:
-                    img.compress_format = COMPRESSED_FORMAT::BC3;
-                    img.pitch = img.Width / 4 * 16;
+                case ChannelFormat("rg\0\0", 8, 8):
+                    img.pixel_format = PIXEL_FORMAT::RG8;
                     break;
-                case PVR::PixelFormat::BC4:
-                    img.compress_format = COMPRESSED_FORMAT::BC4;
-                    img.pitch = img.Width / 4 * 8;
+                case ChannelFormat("r\0\0\0", 8):
+                    img.pixel_format = PIXEL_FORMAT::R8;
                     break;
-                case PVR::PixelFormat::BC5:
-                    img.compress_format = COMPRESSED_FORMAT::BC5;
-                    img.pitch = img.Width / 4 * 16;
+                case ChannelFormat("rgba", 16, 16, 16, 16):
+                    img.pixel_format = PIXEL_FORMAT::RGBA16;
+                    img.bitdepth = 16;
                     break;
-                case PVR::PixelFormat::BC6H:
-                    img.compress_format = COMPRESSED_FORMAT::BC6H;
-                    img.pitch = img.Width / 4 * 16;
+                case ChannelFormat("rgba", 32, 32, 32, 32):
+                    img.pixel_format = PIXEL_FORMAT::RGBA32;
+                    img.bitdepth = 32;
                     break;
-                case PVR::PixelFormat::BC7:
-                    img.compress_format = COMPRESSED_FORMAT::BC7;
-                    img.pitch = img.Width / 4 * 16;
+                case ChannelFormat("rgb\0", 32, 32, 32):
+                    img.pixel_format = PIXEL_FORMAT::RGB32;
+                    img.bitdepth = 32;
                     break;
                 default:
-                    assert(0);
+                    return false;
             }
-
-            memcpy(img.data, buf.GetData() + data_offset, img.data_size);
+            // the bits of the channels add up to the texel
+            img.bitcount = 0;
+            for (uint32_t i = 4; i < 8; i++) {
+                img.bitcount += (format >> (i * 8)) & 0xFF;
+            }
+            img.is_float = header.channel_type == ChannelType::Float;
+            if (img.is_float && img.bitdepth == 8) return false;
+            return true;
         }
 
-        return img;
+        img.compressed = true;
+        img.bitcount = 8;
+        switch (header.pixel_format) {
+            case PixelFormat::ETC1:
+            case PixelFormat::ETC2_RGB:
+                img.compress_format = COMPRESSED_FORMAT::ETC;
+                img.bitcount = 4;
+                break;
+            case PixelFormat::BC1:
+                img.compress_format = COMPRESSED_FORMAT::BC1;
+                img.bitcount = 4;
+                break;
+            case PixelFormat::DXT2:
+                img.compress_format = COMPRESSED_FORMAT::DXT2;
+                break;
+            case PixelFormat::BC2:
+                img.compress_format = COMPRESSED_FORMAT::BC2;
+                break;
+            case PixelFormat::DXT4:
+                img.compress_format = COMPRESSED_FORMAT::DXT4;
+                break;
+            case PixelFormat::BC3:
+                img.compress_format = COMPRESSED_FORMAT::BC3;
+                break;
+            case PixelFormat::BC4:
+                img.compress_format = COMPRESSED_FORMAT::BC4;
+                img.bitcount = 4;
+                break;
+            case PixelFormat::BC5:
+                img.compress_format = COMPRESSED_FORMAT::BC5;
+                break;
+            case PixelFormat::BC6H:
+                img.compress_format = COMPRESSED_FORMAT::BC6H;
+                img.is_float = true;
+                break;
+            case PixelFormat::BC7:
+                img.compress_format = COMPRESSED_FORMAT::BC7;
+                break;
+            default:
+                if (header.pixel_format >= PixelFormat::ASTC_4x4 &&
+                    header.pixel_format <= PixelFormat::ASTC_12x12) {
+                    // the 2D block sizes are in the same order
+                    img.compress_format = static_cast<COMPRESSED_FORMAT>(
+                        (uint64_t)COMPRESSED_FORMAT::ASTC_4x4 +
+                        (format - (uint64_t)PixelFormat::ASTC_4x4));
+                    img.bitcount = 0;
+                    break;
+                }
+                return false;
+        }
+        return true;
     }
 };
 
@@ -0,0 +1,245 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PNG_FILTER_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PNG_FILTER_NEON 1
+#endif
+
+namespace My {
+// filter types of a PNG scanline
+enum class PNG_FILTER_TYPE : uint8_t { None, Sub, Up, Average, Paeth };
+
+namespace PngFilter {
+inline uint8_t paethPredictor(const int32_t a, const int32_t b,
+                              const int32_t c) {
+    const int32_t pa = std::abs(b - c);
+    const int32_t pb = std::abs(a - c);
+    const int32_t pc = std::abs(a + b - c - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+inline void unfilterSub(uint8_t* row, const size_t row_bytes,
+                        const uint32_t bpp) {
+    for (size_t i = bpp; i < row_bytes; i++) {
+        row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+    }
+}
+
+inline void unfilterUp(uint8_t* row, const uint8_t* prior,
+                       const size_t row_bytes) {
+    // no dependency along the row, left to the auto-vectorizer
+    for (size_t i = 0; i < row_bytes; i++) {
+        row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+    }
+}
+
+inline void unfilterAverage(uint8_t* row, const uint8_t* prior,
+                            const size_t row_bytes, const uint32_t bpp) {
+    size_t i = 0;
+    for (; i < bpp && i < row_bytes; i++) {
+        row[i] = static_cast<uint8_t>(row[i] + (prior[i] >> 1));
+    }
+    for (; i < row_bytes; i++) {
+        row[i] =
+            static_cast<uint8_t>(row[i] + ((row[i - bpp] + prior[i]) >> 1));
+    }
+}
+
+inline void unfilterPaeth(uint8_t* row, const uint8_t* prior,
+                          const size_t row_bytes, const uint32_t bpp) {
+    size_t i = 0;
+    for (; i < bpp && i < row_bytes; i++) {
+        row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+    }
+    for (; i < row_bytes; i++) {
+        row[i] = static_cast<uint8_t>(
+            row[i] + paethPredictor(row[i - bpp], prior[i], prior[i - bpp]));
+    }
+}
+
+#if defined(PNG_FILTER_SSE2)
+// one pixel of 3 or 4 bytes at a time, the serial dependency on the left
+// pixel leaves no more parallelism than its channels
+inline __m128i load(const uint8_t* p, const uint32_t bpp) {
+    uint32_t value = 0;
+    memcpy(&value, p, bpp);
+    return _mm_cvtsi32_si128(static_cast<int32_t>(value));
+}
+
+inline void store(uint8_t* p, const __m128i v, const uint32_t bpp) {
+    const auto value = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+    memcpy(p, &value, bpp);
+}
+
+inline __m128i abs16(const __m128i x) {
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+inline __m128i select(const __m128i mask, const __m128i a, const __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline void unfilterSubSimd(uint8_t* row, const size_t row_bytes,
+                            const uint32_t bpp) {
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + bpp <= row_bytes; i += bpp) {
+        a = _mm_add_epi8(load(row + i, bpp), a);
+        store(row + i, a, bpp);
+    }
+}
+
+inline void unfilterAverageSimd(uint8_t* row, const uint8_t* prior,
+                                const size_t row_bytes, const uint32_t bpp) {
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + bpp <= row_bytes; i += bpp) {
+        const __m128i b = load(prior + i, bpp);
+        // pavgb rounds up, the filter truncates
+        const __m128i average = _mm_sub_epi8(
+            _mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(load(row + i, bpp), average);
+        store(row + i, a, bpp);
+    }
+}
+
+inline void unfilterPaethSimd(uint8_t* row, const uint8_t* prior,
+                              const size_t row_bytes, const uint32_t bpp) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i c = zero;
+    for (size_t i = 0; i + bpp <= row_bytes; i += bpp) {
+        const __m128i b = _mm_unpacklo_epi8(load(prior + i, bpp), zero);
+        // p - a = b - c, p - b = a - c and p - c = (b - c) + (a - c)
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = _mm_add_epi16(pa, pb);
+        pa = abs16(pa);
+        pb = abs16(pb);
+        pc = abs16(pc);
+        const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        // ties go to a, then b
+        const __m128i predictor =
+            select(_mm_cmpeq_epi16(smallest, pa), a,
+                   select(_mm_cmpeq_epi16(smallest, pb), b, c));
+        // the bytes wrap, the high halves stay zero
+        a = _mm_add_epi8(_mm_unpacklo_epi8(load(row + i, bpp), zero),
+                         predictor);
+        store(row + i, _mm_packus_epi16(a, a), bpp);
+        c = b;
+    }
+}
+#elif defined(PNG_FILTER_NEON)
+inline uint8x8_t load(const uint8_t* p, const uint32_t bpp) {
+    uint32_t value = 0;
+    memcpy(&value, p, bpp);
+    return vreinterpret_u8_u32(vdup_n_u32(value));
+}
+
+inline void store(uint8_t* p, const uint8x8_t v, const uint32_t bpp) {
+    const uint32_t value = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+    memcpy(p, &value, bpp);
+}
+
+inline void unfilterSubSimd(uint8_t* row, const size_t row_bytes,
+                            const uint32_t bpp) {
+    uint8x8_t a = vdup_n_u8(0);
+    for (size_t i = 0; i + bpp <= row_bytes; i += bpp) {
+        a = vadd_u8(load(row + i, bpp), a);
+        store(row + i, a, bpp);
+    }
+}
+
+inline void unfilterAverageSimd(uint8_t* row, const uint8_t* prior,
+                                const size_t row_bytes, const uint32_t bpp) {
+    uint8x8_t a = vdup_n_u8(0);
+    for (size_t i = 0; i + bpp <= row_bytes; i += bpp) {
+        // the halving add truncates like the filter
+        a = vadd_u8(load(row + i, bpp), vhadd_u8(a, load(prior + i, bpp)));
+        store(row + i, a, bpp);
+    }
+}
+
+inline void unfilterPaethSimd(uint8_t* row, const uint8_t* prior,
+                              const size_t row_bytes, const uint32_t bpp) {
+    uint8x8_t a = vdup_n_u8(0);
+    uint8x8_t c = vdup_n_u8(0);
+    for (size_t i = 0; i + bpp <= row_bytes; i += bpp) {
+        const uint8x8_t b = load(prior + i, bpp);
+        // |p - a| = |b - c|, |p - b| = |a - c| and
+        // |p - c| = |(b - c) + (a - c)|
+        const uint16x8_t pa = vmovl_u8(vabd_u8(b, c));
+        const uint16x8_t pb = vmovl_u8(vabd_u8(a, c));
+        const int16x8_t sum = vaddq_s16(
+            vreinterpretq_s16_u16(vsubl_u8(b, c)),
+            vreinterpretq_s16_u16(vsubl_u8(a, c)));
+        const uint16x8_t pc = vreinterpretq_u16_s16(vabsq_s16(sum));
+        // ties go to a, then b
+        const uint8x8_t use_a =
+            vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+        const uint8x8_t use_b = vmovn_u16(vcleq_u16(pb, pc));
+        const uint8x8_t predictor = vbsl_u8(use_a, a, vbsl_u8(use_b, b, c));
+        a = vadd_u8(load(row + i, bpp), predictor);
+        store(row + i, a, bpp);
+        c = b;
+    }
+}
+#endif
+}  // namespace PngFilter
+
+// Reverses the filter of a scanline in place. `prior` is the unfiltered
+// scanline above, all zeros for the first one, and `bpp` the bytes of a
+// complete pixel rounded up to 1.
+inline bool UnfilterPngRow(const uint8_t filter_type, uint8_t* row,
+                           const uint8_t* prior, const size_t row_bytes,
+                           const uint32_t bpp) {
+#if defined(PNG_FILTER_SSE2) || defined(PNG_FILTER_NEON)
+    const bool simd = bpp == 3 || bpp == 4;
+#endif
+    switch (static_cast<PNG_FILTER_TYPE>(filter_type)) {
+        case PNG_FILTER_TYPE::None:
+            break;
+        case PNG_FILTER_TYPE::Sub:
+#if defined(PNG_FILTER_SSE2) || defined(PNG_FILTER_NEON)
+            if (simd) {
+                PngFilter::unfilterSubSimd(row, row_bytes, bpp);
+                break;
+            }
+#endif
+            PngFilter::unfilterSub(row, row_bytes, bpp);
+            break;
+        case PNG_FILTER_TYPE::Up:
+            PngFilter::unfilterUp(row, prior, row_bytes);
+            break;
+        case PNG_FILTER_TYPE::Average:
+#if defined(PNG_FILTER_SSE2) || defined(PNG_FILTER_NEON)
+            if (simd) {
+                PngFilter::unfilterAverageSimd(row, prior, row_bytes, bpp);
+                break;
+            }
+#endif
+            PngFilter::unfilterAverage(row, prior, row_bytes, bpp);
+            break;
+        case PNG_FILTER_TYPE::Paeth:
+#if defined(PNG_FILTER_SSE2) || defined(PNG_FILTER_NEON)
+            if (simd) {
+                PngFilter::unfilterPaethSimd(row, prior, row_bytes, bpp);
+                break;
+            }
+#endif
+            PngFilter::unfilterPaeth(row, prior, row_bytes, bpp);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+}  // namespace My
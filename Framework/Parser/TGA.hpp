@@ -1,10 +1,10 @@
 #pragma once
 #include <algorithm>
-#include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
-#include <queue>
 #include <string>
+#include <vector>
 
 #include "IImageParser.hpp"
 #include "config.h"
@@ -21,17 +21,31 @@ struct TGA_FILEHEADER {
 };
 #pragma pack(pop)
 
+enum class TGA_IMAGE_TYPE : uint8_t {
+    NoImage = 0,
+    ColorMapped = 1,
+    TrueColor = 2,
+    Grayscale = 3,
+    RleColorMapped = 9,
+    RleTrueColor = 10,
+    RleGrayscale = 11
+};
+
 class TgaParser : _implements_ ImageParser {
    public:
     Image Parse(Buffer& buf) override {
         Image img;
 
         const uint8_t* pData = buf.GetData();
-        [[maybe_unused]] const uint8_t* pDataEnd =
-            buf.GetData() + buf.GetDataSize();
+        const uint8_t* pDataEnd = buf.GetData() + buf.GetDataSize();
 
         std::cerr << "Parsing as TGA file:" << std::endl;
 
+        if (buf.GetDataSize() < sizeof(TGA_FILEHEADER)) {
+            std::cerr << "TGA file is too short for its header." << std::endl;
+            return img;
+        }
+
         const auto* pFileHeader =
             reinterpret_cast<const TGA_FILEHEADER*>(pData);
         pData += sizeof(TGA_FILEHEADER);
@@ -41,112 +55,312 @@ class TgaParser : _implements_ ImageParser {
                   << std::endl;
         std::cerr << "Color Map Type: " << (uint16_t)pFileHeader->ColorMapType
                   << std::endl;
-#endif
-        if (pFileHeader->ColorMapType) {
-            std::cerr << "Unsupported Color Map. Only Type 0 is supported."
-                      << std::endl;
-            return img;
-        }
-
-#ifdef DEBUG
         std::cerr << "Image Type: " << (uint16_t)pFileHeader->ImageType
                   << std::endl;
 #endif
-        if (pFileHeader->ImageType != 2) {
-            std::cerr << "Unsupported Image Type. Only Type 2 is supported."
+        const auto image_type =
+            static_cast<TGA_IMAGE_TYPE>(pFileHeader->ImageType);
+        bool color_mapped = false;
+        bool gray = false;
+        bool rle = false;
+        switch (image_type) {
+            case TGA_IMAGE_TYPE::RleColorMapped:
+                rle = true;
+                [[fallthrough]];
+            case TGA_IMAGE_TYPE::ColorMapped:
+                color_mapped = true;
+                break;
+            case TGA_IMAGE_TYPE::RleTrueColor:
+                rle = true;
+                [[fallthrough]];
+            case TGA_IMAGE_TYPE::TrueColor:
+                break;
+            case TGA_IMAGE_TYPE::RleGrayscale:
+                rle = true;
+                [[fallthrough]];
+            case TGA_IMAGE_TYPE::Grayscale:
+                gray = true;
+                break;
+            default:
+                std::cerr << "Unsupported Image Type "
+                          << (uint16_t)pFileHeader->ImageType << "."
+                          << std::endl;
+                return img;
+        }
+
+        if (color_mapped && pFileHeader->ColorMapType != 1) {
+            std::cerr << "Color mapped image without a Color Map."
                       << std::endl;
             return img;
         }
 
-        img.Width =
-            (pFileHeader->ImageSpec[5] << 8) + pFileHeader->ImageSpec[4];
-        img.Height =
-            (pFileHeader->ImageSpec[7] << 8) + pFileHeader->ImageSpec[6];
-        uint8_t pixel_depth = pFileHeader->ImageSpec[8];
-        uint8_t alpha_depth = (pFileHeader->ImageSpec[9] & 0x0F);
+        const uint32_t first_entry = read16(pFileHeader->ColorMapSpec);
+        const uint32_t map_length = read16(pFileHeader->ColorMapSpec + 2);
+        const uint8_t entry_depth = pFileHeader->ColorMapSpec[4];
+
+        const uint32_t width = read16(pFileHeader->ImageSpec + 4);
+        const uint32_t height = read16(pFileHeader->ImageSpec + 6);
+        const uint8_t pixel_depth = pFileHeader->ImageSpec[8];
+        const uint8_t alpha_depth = (pFileHeader->ImageSpec[9] & 0x0F);
+        const bool right_to_left = pFileHeader->ImageSpec[9] & 0x10;
+        const bool top_to_bottom = pFileHeader->ImageSpec[9] & 0x20;
 #ifdef DEBUG
-        std::cerr << "Image Width: " << img.Width << std::endl;
-        std::cerr << "Image Height: " << img.Height << std::endl;
+        std::cerr << "Image Width: " << width << std::endl;
+        std::cerr << "Image Height: " << height << std::endl;
         std::cerr << "Image Pixel Depth: " << (uint16_t)pixel_depth
                   << std::endl;
         std::cerr << "Image Alpha Depth: " << (uint16_t)alpha_depth
                   << std::endl;
 #endif
+        if (!width || !height) {
+            std::cerr << "TGA image is empty." << std::endl;
+            return img;
+        }
+
+        // the depth of the colors, which a color map holds for its indices
+        const uint8_t color_depth = color_mapped ? entry_depth : pixel_depth;
+        bool supported;
+        if (gray) {
+            supported = pixel_depth == 8 || pixel_depth == 16;
+        } else {
+            supported = color_depth == 15 || color_depth == 16 ||
+                        color_depth == 24 || color_depth == 32;
+            if (color_mapped) {
+                supported &= pixel_depth == 8 || pixel_depth == 16;
+            }
+        }
+        if (!supported) {
+            std::cerr << "Unsupported Pixel Depth " << (uint16_t)pixel_depth
+                      << "." << std::endl;
+            return img;
+        }
+
         // skip Image ID
+        const size_t map_size =
+            pFileHeader->ColorMapType
+                ? (size_t)map_length * ((entry_depth + 7) >> 3)
+                : 0;
+        if ((size_t)(pDataEnd - pData) < pFileHeader->IDLength + map_size) {
+            std::cerr << "TGA file is too short for its Color Map."
+                      << std::endl;
+            return img;
+        }
         pData += pFileHeader->IDLength;
-        // skip the Color Map. since we assume the Color Map Type is 0,
-        // nothing to skip
 
-        // reading the pixel data
-        img.bitcount = (alpha_depth ? 32 : 24);
+        img.Width = width;
+        img.Height = height;
         img.bitdepth = 8;
-        img.pixel_format =
-            (alpha_depth ? PIXEL_FORMAT::RGBA8 : PIXEL_FORMAT::RGB8);
-        img.pitch = img.Width *
-                    ALIGN((img.bitcount >> 3), 4);  // for GPU address alignment
+        if (gray) {
+            img.bitcount = pixel_depth;
+            img.pixel_format =
+                pixel_depth == 16 ? PIXEL_FORMAT::RG8 : PIXEL_FORMAT::R8;
+        } else if (color_depth == 32 || (color_depth == 16 && alpha_depth)) {
+            img.bitcount = 32;
+            img.pixel_format = PIXEL_FORMAT::RGBA8;
+        } else {
+            img.bitcount = 24;
+            img.pixel_format = PIXEL_FORMAT::RGB8;
+        }
+        const uint32_t out_bytes = img.bitcount >> 3;
+
+        // the Color Map in the output format, a color map is skipped when
+        // the image does not use it
+        std::vector<uint8_t> palette;
+        if (color_mapped) {
+            palette.resize((size_t)map_length * out_bytes);
+            convertPixels(pData, palette.data(), map_length, color_depth,
+                          out_bytes);
+        }
+        pData += map_size;
 
+        img.pitch = ALIGN(width * out_bytes, 4);
         img.data_size = (size_t)img.pitch * img.Height;
         img.data = new uint8_t[img.data_size];
 
-        auto* pOut = (uint8_t*)img.data;
-        for (decltype(img.Height) i = 0; i < img.Height; i++) {
-            for (decltype(img.Width) j = 0; j < img.Width; j++) {
-                switch (pixel_depth) {
-                    case 15: {
-                        assert(alpha_depth == 0);
-                        uint16_t color = *(uint16_t*)pData;
-                        pData += 2;
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 3) =
-                            ((color & 0x7C00) >> 10);  // R
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 3 +
-                          1) = ((color & 0x03E0) >> 5);  // G
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 3 +
-                          2) = (color & 0x001F);  // B
-                    } break;
-                    case 16: {
-                        assert(alpha_depth == 1);
-                        uint16_t color = *(uint16_t*)pData;
-                        pData += 2;
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4) =
-                            ((color & 0x7C00) >> 10);  // R
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4 +
-                          1) = ((color & 0x03E0) >> 5);  // G
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4 +
-                          2) = (color & 0x001F);  // B
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4 +
-                          3) = ((color & 0x8000) ? 0xFF : 0x00);  // A
-                    } break;
-                    case 24: {
-                        assert(alpha_depth == 0);
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 3 +
-                          2) = *pData++;  // B
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 3 +
-                          1) = *pData++;  // G
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 3) =
-                            *pData++;  // R
-                    } break;
-                    case 32: {
-                        assert(alpha_depth == 8);
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4 +
-                          2) = *pData++;  // B
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4 +
-                          1) = *pData++;  // G
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4 +
-                          0) = *pData++;  // R
-                        *(pOut + (ptrdiff_t)img.pitch * i + (ptrdiff_t)j * 4 +
-                          3) = *pData++;  // A
-                    } break;
-                    default:;
-                }
+        const uint32_t in_bytes = (pixel_depth + 7) >> 3;
+        const size_t row_bytes = (size_t)width * in_bytes;
+        std::vector<uint8_t> row_buffer(rle ? row_bytes : 0);
+        RleReader rle_reader(pData, pDataEnd, in_bytes);
+
+        uint32_t y = 0;
+        for (; y < height; y++) {
+            // the raw scanline, in the order of the file
+            const uint8_t* pRow;
+            if (rle) {
+                if (!rle_reader.Read(row_buffer.data(), width)) break;
+                pRow = row_buffer.data();
+            } else {
+                if ((size_t)(pDataEnd - pData) < row_bytes) break;
+                pRow = pData;
+                pData += row_bytes;
             }
+
+            uint8_t* pOut = outputRow(img, y, top_to_bottom);
+            if (color_mapped) {
+                lookUpPixels(pRow, pOut, width, in_bytes, palette, first_entry,
+                             map_length, out_bytes);
+            } else {
+                convertPixels(pRow, pOut, width, gray ? 0 : pixel_depth,
+                              out_bytes);
+            }
+            if (right_to_left) reverseRow(pOut, width, out_bytes);
         }
 
-        assert(pData <= pDataEnd);
+        if (y < height) {
+            std::cerr << "TGA file is truncated at scanline " << y << " of "
+                      << height << "." << std::endl;
+            for (; y < height; y++) {
+                memset(outputRow(img, y, top_to_bottom), 0, img.pitch);
+            }
+        }
 
         img.mipmaps.emplace_back(img.Width, img.Height, img.pitch, 0,
                                  img.data_size);
 
         return img;
     }
+
+   private:
+    // expands the run length encoded packets, which may straddle scanlines
+    class RleReader {
+       public:
+        RleReader(const uint8_t* data, const uint8_t* data_end,
+                  const uint32_t pixel_bytes)
+            : m_pData(data), m_pDataEnd(data_end), m_PixelBytes(pixel_bytes) {}
+
+        // false when the file ends first
+        bool Read(uint8_t* out, uint32_t pixels) {
+            while (pixels) {
+                if (!m_Remaining) {
+                    if (m_pData >= m_pDataEnd) return false;
+                    const uint8_t header = *m_pData++;
+                    m_Remaining = (header & 0x7F) + 1;
+                    m_bRun = header & 0x80;
+                    if (m_bRun) {
+                        if ((size_t)(m_pDataEnd - m_pData) < m_PixelBytes) {
+                            return false;
+                        }
+                        memcpy(m_Pixel, m_pData, m_PixelBytes);
+                        m_pData += m_PixelBytes;
+                    }
+                }
+
+                const uint32_t count = std::min(m_Remaining, pixels);
+                const size_t size = (size_t)count * m_PixelBytes;
+                if (m_bRun) {
+                    if (m_PixelBytes == 1) {
+                        memset(out, m_Pixel[0], count);
+                    } else {
+                        // doubles the copied pixels until the run is filled
+                        memcpy(out, m_Pixel, m_PixelBytes);
+                        for (size_t filled = m_PixelBytes; filled < size;) {
+                            const size_t copy = std::min(filled, size - filled);
+                            memcpy(out + filled, out, copy);
+                            filled += copy;
+                        }
+                    }
+                } else {
+                    if ((size_t)(m_pDataEnd - m_pData) < size) return false;
+                    memcpy(out, m_pData, size);
+                    m_pData += size;
+                }
+
+                out += size;
+                pixels -= count;
+                m_Remaining -= count;
+            }
+            return true;
+        }
+
+       private:
+        const uint8_t* m_pData;
+        const uint8_t* m_pDataEnd;
+        uint32_t m_PixelBytes;
+        uint32_t m_Remaining{0};
+        bool m_bRun{false};
+        uint8_t m_Pixel[4]{};
+    };
+
+    static uint32_t read16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+    // 5 bits scaled to 8, rounded to nearest like value * 255 / 31
+    static uint8_t expand5(const uint32_t value) {
+        return static_cast<uint8_t>((value * 527 + 23) >> 6);
+    }
+
+    static uint8_t* outputRow(Image& img, const uint32_t y,
+                              const bool top_to_bottom) {
+        // row 0 of the image is the top one, the default origin of TGA is
+        // the bottom left corner
+        const uint32_t row = top_to_bottom ? y : img.Height - 1 - y;
+        return img.data + (ptrdiff_t)img.pitch * row;
+    }
+
+    // BGR(A) of the file to RGB(A), a depth of 0 copies gray as it is
+    static void convertPixels(const uint8_t* in, uint8_t* out,
+                              const uint32_t count, const uint8_t depth,
+                              const uint32_t out_bytes) {
+        switch (depth) {
+            case 0:
+                memcpy(out, in, (size_t)count * out_bytes);
+                break;
+            case 15:
+            case 16:
+                for (uint32_t i = 0; i < count; i++, in += 2) {
+                    const uint32_t color = read16(in);
+                    out[0] = expand5((color >> 10) & 0x1F);  // R
+                    out[1] = expand5((color >> 5) & 0x1F);   // G
+                    out[2] = expand5(color & 0x1F);          // B
+                    if (out_bytes == 4) {
+                        out[3] = (color & 0x8000) ? 0xFF : 0x00;  // A
+                    }
+                    out += out_bytes;
+                }
+                break;
+            case 24:
+                for (uint32_t i = 0; i < count; i++, in += 3, out += 3) {
+                    out[0] = in[2];
+                    out[1] = in[1];
+                    out[2] = in[0];
+                }
+                break;
+            case 32:
+                for (uint32_t i = 0; i < count; i++, in += 4, out += 4) {
+                    out[0] = in[2];
+                    out[1] = in[1];
+                    out[2] = in[0];
+                    out[3] = in[3];
+                }
+                break;
+            default:;
+        }
+    }
+
+    // indices outside of the Color Map are black
+    static void lookUpPixels(const uint8_t* in, uint8_t* out,
+                             const uint32_t count, const uint32_t in_bytes,
+                             const std::vector<uint8_t>& palette,
+                             const uint32_t first_entry,
+                             const uint32_t map_length,
+                             const uint32_t out_bytes) {
+        for (uint32_t i = 0; i < count; i++, in += in_bytes, out += out_bytes) {
+            const uint32_t index = (in_bytes == 2 ? read16(in) : in[0]);
+            if (index >= first_entry && index - first_entry < map_length) {
+                memcpy(out, &palette[(size_t)(index - first_entry) * out_bytes],
+                       out_bytes);
+            } else {
+                memset(out, 0, out_bytes);
+            }
+        }
+    }
+
+    static void reverseRow(uint8_t* row, const uint32_t count,
+                           const uint32_t bytes) {
+        uint8_t* left = row;
+        uint8_t* right = row + (size_t)(count - 1) * bytes;
+        for (; left < right; left += bytes, right -= bytes) {
+            std::swap_ranges(left, left + bytes, right);
+        }
+    }
 };
 }  // namespace My
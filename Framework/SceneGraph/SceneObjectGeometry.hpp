@@ -46,6 +46,27 @@ class SceneObjectGeometry : public BaseSceneObject {
     std::weak_ptr<SceneObjectMesh> GetMeshLOD(size_t lod) {
         return (lod < m_Mesh.size() ? m_Mesh[lod] : nullptr);
     }
+    [[nodiscard]] size_t GetLodCount() const { return m_Mesh.size(); }
+
+    // fills the LOD chain by simplifying LOD 0, each level keeping `ratio`
+    // of the triangles of the previous one. geometries which already come
+    // with authored LODs are left alone.
+    void GenerateLods(uint32_t lod_count, float ratio = 0.5f) {
+        if (m_Mesh.size() != 1) return;
+
+        float lod_ratio = ratio;
+        for (uint32_t i = 1; i < lod_count; i++, lod_ratio *= ratio) {
+            auto mesh = m_Mesh[0]->Simplify(lod_ratio);
+            if (!mesh) break;
+
+            // stop when the mesh does not get meaningfully simpler
+            if (mesh->GetTotalIndexCount() >
+                m_Mesh.back()->GetTotalIndexCount() * 0.8f)
+                break;
+
+            m_Mesh.push_back(std::move(mesh));
+        }
+    }
     [[nodiscard]] BoundingBox GetBoundingBox() const {
         return m_Mesh.empty() ? BoundingBox() : m_Mesh[0]->GetBoundingBox();
     }
@@ -41,6 +41,7 @@ class SceneObjectIndexArray {
     [[nodiscard]] uint32_t GetMaterialIndex() const {
         return m_nMaterialIndex;
     };
+    [[nodiscard]] size_t GetRestartIndex() const { return m_szRestartIndex; };
     [[nodiscard]] IndexDataType GetIndexType() const { return m_DataType; };
     [[nodiscard]] const void* GetData() const { return m_pData; };
     [[nodiscard]] size_t GetDataSize() const {
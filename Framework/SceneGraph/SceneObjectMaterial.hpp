@@ -48,6 +48,7 @@ class SceneObjectMaterial : public BaseSceneObject {
     [[nodiscard]] const Parameter& GetAO() const { return m_AmbientOcclusion; }
     [[nodiscard]] const Parameter& GetHeight() const { return m_Height; }
     [[nodiscard]] const Normal& GetNormal() const { return m_Normal; }
+    [[nodiscard]] const Color& GetOpacity() const { return m_Opacity; }
     void SetName(const std::string& name) { m_Name = name; }
     void SetName(std::string&& name) { m_Name = std::move(name); }
     void SetColor(const std::string& attrib, const Vector4f& color) {
@@ -95,49 +96,65 @@ class SceneObjectMaterial : public BaseSceneObject {
     }
 
     void SetTexture(const std::string& attrib, const std::string& textureName) {
+        // color maps are filtered as linear light, normal maps renormalized
+        MipmapOptions mipmaps;
+        mipmaps.srgb = attrib == "diffuse" || attrib == "specular" ||
+                       attrib == "emission";
+        mipmaps.normal_map = attrib == "normal";
+
         if (attrib == "diffuse") {
-            m_BaseColor = std::make_shared<SceneObjectTexture>(textureName);
+            m_BaseColor =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "specular") {
-            m_Specular = std::make_shared<SceneObjectTexture>(textureName);
+            m_Specular =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "specular_power") {
-            m_SpecularPower = std::make_shared<SceneObjectTexture>(textureName);
+            m_SpecularPower =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "emission") {
-            m_Emission = std::make_shared<SceneObjectTexture>(textureName);
+            m_Emission =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "opacity") {
-            m_Opacity = std::make_shared<SceneObjectTexture>(textureName);
+            m_Opacity =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "transparency") {
-            m_Transparency = std::make_shared<SceneObjectTexture>(textureName);
+            m_Transparency =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "normal") {
-            m_Normal = std::make_shared<SceneObjectTexture>(textureName);
+            m_Normal =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "metallic") {
-            m_Metallic = std::make_shared<SceneObjectTexture>(textureName);
+            m_Metallic =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "roughness") {
-            m_Roughness = std::make_shared<SceneObjectTexture>(textureName);
+            m_Roughness =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "ao") {
             m_AmbientOcclusion =
-                std::make_shared<SceneObjectTexture>(textureName);
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
 
         else if (attrib == "height") {
-            m_Height = std::make_shared<SceneObjectTexture>(textureName);
+            m_Height =
+                std::make_shared<SceneObjectTexture>(textureName, mipmaps);
         }
     }
 
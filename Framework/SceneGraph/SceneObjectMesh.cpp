@@ -1,8 +1,78 @@
 #include "SceneObjectMesh.hpp"
 
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "Meshlet.hpp"
+
 using namespace My;
 using namespace std;
 
+static size_t scalar_size(const VertexDataType type) {
+    switch (type) {
+        case VertexDataType::kVertexDataTypeDouble1:
+        case VertexDataType::kVertexDataTypeDouble2:
+        case VertexDataType::kVertexDataTypeDouble3:
+        case VertexDataType::kVertexDataTypeDouble4:
+            return sizeof(double);
+        default:
+            return sizeof(float);
+    }
+}
+
+static vector<uint32_t> read_indices(const SceneObjectIndexArray& array) {
+    const auto count = array.GetIndexCount();
+    const auto* data = array.GetData();
+    vector<uint32_t> indices(count);
+
+    for (size_t i = 0; i < count; i++) {
+        switch (array.GetIndexType()) {
+            case IndexDataType::kIndexDataTypeInt8:
+                indices[i] = reinterpret_cast<const uint8_t*>(data)[i];
+                break;
+            case IndexDataType::kIndexDataTypeInt16:
+                indices[i] = reinterpret_cast<const uint16_t*>(data)[i];
+                break;
+            case IndexDataType::kIndexDataTypeInt32:
+                indices[i] = reinterpret_cast<const uint32_t*>(data)[i];
+                break;
+            case IndexDataType::kIndexDataTypeInt64:
+                indices[i] = static_cast<uint32_t>(
+                    reinterpret_cast<const uint64_t*>(data)[i]);
+                break;
+            default:
+                assert(0);
+        }
+    }
+
+    return indices;
+}
+
+// indices are narrowed to 16 bits when the vertex count allows
+static SceneObjectIndexArray make_index_array(
+    const SceneObjectIndexArray& source, const vector<uint32_t>& indices,
+    const size_t vertex_count) {
+    const bool narrow = vertex_count < 65536;
+
+    // allocated as bytes, the index array frees it as such
+    uint8_t* data;
+    if (narrow) {
+        data = new uint8_t[indices.size() * sizeof(uint16_t)];
+        auto* data16 = reinterpret_cast<uint16_t*>(data);
+        for (size_t j = 0; j < indices.size(); j++) {
+            data16[j] = static_cast<uint16_t>(indices[j]);
+        }
+    } else {
+        data = new uint8_t[indices.size() * sizeof(uint32_t)];
+        memcpy(data, indices.data(), indices.size() * sizeof(uint32_t));
+    }
+
+    return SceneObjectIndexArray(source.GetMaterialIndex(),
+                                 source.GetRestartIndex(),
+                                 narrow ? IndexDataType::kIndexDataTypeInt16
+                                        : IndexDataType::kIndexDataTypeInt32,
+                                 data, indices.size());
+}
+
 BoundingBox SceneObjectMesh::GetBoundingBox() const {
     Vector3f bbmin(numeric_limits<float>::max());
     Vector3f bbmax(numeric_limits<float>::lowest());
@@ -109,3 +179,174 @@ ConvexHull SceneObjectMesh::GetConvexHull() const {
 
     return hull;
 }
+
+bool SceneObjectMesh::readIndexGroups(
+    vector<vector<uint32_t>>& index_groups) const {
+    if (m_PrimitiveType != PrimitiveType::kPrimitiveTypeTriList) return false;
+
+    const auto vertex_count = GetVertexCount();
+    if (vertex_count == 0 || m_IndexArray.empty()) return false;
+
+    // all the vertex arrays (including morph targets) are remapped together
+    for (const auto& vertex_array : m_VertexArray) {
+        if (vertex_array.GetVertexCount() != vertex_count) return false;
+    }
+
+    index_groups.clear();
+    for (const auto& index_array : m_IndexArray) {
+        auto indices = read_indices(index_array);
+        if (indices.size() % 3) return false;
+
+        for (const auto index : indices) {
+            if (index >= vertex_count) return false;
+        }
+
+        index_groups.push_back(std::move(indices));
+    }
+
+    return true;
+}
+
+const float* SceneObjectMesh::GetPositions(size_t& stride) const {
+    const auto vertex_count = GetVertexCount();
+
+    for (const auto& vertex_array : m_VertexArray) {
+        if (vertex_array.GetAttributeName() == "position" &&
+            vertex_array.GetMorphTargetIndex() == 0) {
+            if (vertex_array.GetDataType() ==
+                    VertexDataType::kVertexDataTypeFloat3 ||
+                vertex_array.GetDataType() ==
+                    VertexDataType::kVertexDataTypeFloat4) {
+                stride = vertex_array.GetDataSize() / vertex_count /
+                         sizeof(float);
+                return reinterpret_cast<const float*>(vertex_array.GetData());
+            }
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+void SceneObjectMesh::compactArrays(const SceneObjectMesh& source,
+                                    vector<vector<uint32_t>>& index_groups) {
+    const auto vertex_count = source.GetVertexCount();
+
+    vector<uint32_t> all_indices;
+    for (const auto& indices : index_groups) {
+        all_indices.insert(all_indices.end(), indices.begin(), indices.end());
+    }
+
+    vector<uint32_t> remap;
+    const auto new_vertex_count =
+        OptimizeVertexFetchRemap(remap, all_indices, vertex_count);
+
+    vector<SceneObjectVertexArray> vertex_arrays;
+    vertex_arrays.reserve(source.m_VertexArray.size());
+    for (const auto& vertex_array : source.m_VertexArray) {
+        const auto vertex_size = vertex_array.GetDataSize() / vertex_count;
+        auto* data = new uint8_t[new_vertex_count * vertex_size];
+        RemapVertexBuffer(
+            data, reinterpret_cast<const uint8_t*>(vertex_array.GetData()),
+            vertex_count, vertex_size, remap);
+        // the vertex array counts its size in scalars
+        vertex_arrays.emplace_back(
+            vertex_array.GetAttributeName().c_str(),
+            vertex_array.GetMorphTargetIndex(), vertex_array.GetDataType(),
+            data,
+            new_vertex_count * vertex_size /
+                scalar_size(vertex_array.GetDataType()));
+    }
+
+    vector<SceneObjectIndexArray> index_arrays;
+    index_arrays.reserve(source.m_IndexArray.size());
+    for (size_t i = 0; i < source.m_IndexArray.size(); i++) {
+        auto& indices = index_groups[i];
+        RemapIndexBuffer(indices, remap);
+        index_arrays.push_back(
+            make_index_array(source.m_IndexArray[i], indices,
+                             new_vertex_count));
+    }
+
+    m_PrimitiveType = source.m_PrimitiveType;
+    m_VertexArray = std::move(vertex_arrays);
+    m_IndexArray = std::move(index_arrays);
+}
+
+void SceneObjectMesh::Optimize() {
+    // the index arrays are per material, optimize them one by one
+    vector<vector<uint32_t>> index_groups;
+    if (!readIndexGroups(index_groups)) return;
+
+    const auto vertex_count = GetVertexCount();
+    size_t position_stride = 0;
+    const float* positions = GetPositions(position_stride);
+
+    for (auto& indices : index_groups) {
+        indices = OptimizeVertexCache(indices, vertex_count);
+        if (positions) {
+            indices = OptimizeOverdraw(indices, positions, vertex_count,
+                                       position_stride);
+        }
+    }
+
+    compactArrays(*this, index_groups);
+}
+
+shared_ptr<SceneObjectMesh> SceneObjectMesh::Simplify(
+    const float ratio, const float target_error) const {
+    vector<vector<uint32_t>> index_groups;
+    if (!readIndexGroups(index_groups)) return nullptr;
+
+    size_t position_stride = 0;
+    const float* positions = GetPositions(position_stride);
+    if (!positions) return nullptr;
+
+    size_t index_count = 0;
+    size_t simplified_index_count = 0;
+    for (auto& indices : index_groups) {
+        const auto target_index_count =
+            static_cast<size_t>(static_cast<float>(indices.size()) * ratio) /
+            3 * 3;
+        index_count += indices.size();
+        indices = SimplifyMesh(indices, positions, GetVertexCount(),
+                               position_stride, target_index_count,
+                               target_error);
+        simplified_index_count += indices.size();
+    }
+
+    if (simplified_index_count >= index_count) return nullptr;
+
+    auto mesh = make_shared<SceneObjectMesh>();
+    mesh->compactArrays(*this, index_groups);
+    mesh->Optimize();
+
+    return mesh;
+}
+
+void SceneObjectMesh::BuildMeshlets() {
+    vector<vector<uint32_t>> index_groups;
+    if (!readIndexGroups(index_groups)) return;
+
+    size_t position_stride = 0;
+    const float* positions = GetPositions(position_stride);
+    if (!positions) return;
+
+    // small meshes are cheaper to draw than to cull
+    if (GetTotalIndexCount() < kMeshletMinTriangleCount * 3) return;
+
+    const auto vertex_count = GetVertexCount();
+
+    vector<SceneObjectIndexArray> index_arrays;
+    index_arrays.reserve(m_IndexArray.size());
+    m_Meshlets.clear();
+    for (size_t i = 0; i < m_IndexArray.size(); i++) {
+        auto& indices = index_groups[i];
+        m_Meshlets.push_back(My::BuildMeshlets(indices, positions, vertex_count,
+                                               position_stride));
+        index_arrays.push_back(
+            make_index_array(m_IndexArray[i], indices, vertex_count));
+    }
+
+    m_IndexArray = std::move(index_arrays);
+}
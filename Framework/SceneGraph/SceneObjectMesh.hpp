@@ -3,6 +3,7 @@
 
 #include "BaseSceneObject.hpp"
 #include "ConvexHull.hpp"
+#include "Meshlet.hpp"
 #include "SceneObjectIndexArray.hpp"
 #include "SceneObjectTypeDef.hpp"
 #include "SceneObjectVertexArray.hpp"
@@ -14,8 +15,13 @@ class SceneObjectMesh : public BaseSceneObject {
     std::vector<SceneObjectIndexArray> m_IndexArray;
     std::vector<SceneObjectVertexArray> m_VertexArray;
     PrimitiveType m_PrimitiveType{PrimitiveType::kPrimitiveTypeNone};
+    // per index array, empty if the mesh is not split into meshlets
+    std::vector<std::vector<Meshlet>> m_Meshlets;
 
    public:
+    // meshes below this triangle count are not split into meshlets
+    static const size_t kMeshletMinTriangleCount = 4096;
+
     explicit SceneObjectMesh(bool visible = true, bool shadow = true,
                              bool motion_blur = true)
         : BaseSceneObject(SceneObjectType::kSceneObjectTypeMesh){};
@@ -23,7 +29,8 @@ class SceneObjectMesh : public BaseSceneObject {
         : BaseSceneObject(SceneObjectType::kSceneObjectTypeMesh),
           m_IndexArray(std::move(mesh.m_IndexArray)),
           m_VertexArray(std::move(mesh.m_VertexArray)),
-          m_PrimitiveType(mesh.m_PrimitiveType){};
+          m_PrimitiveType(mesh.m_PrimitiveType),
+          m_Meshlets(std::move(mesh.m_Meshlets)){};
     void AddIndexArray(SceneObjectIndexArray&& array) {
         m_IndexArray.push_back(std::forward<SceneObjectIndexArray>(array));
     };
@@ -38,6 +45,13 @@ class SceneObjectMesh : public BaseSceneObject {
     [[nodiscard]] size_t GetIndexCount(const size_t index) const {
         return (m_IndexArray.empty() ? 0 : m_IndexArray[index].GetIndexCount());
     };
+    [[nodiscard]] size_t GetTotalIndexCount() const {
+        size_t count = 0;
+        for (const auto& index_array : m_IndexArray) {
+            count += index_array.GetIndexCount();
+        }
+        return count;
+    };
     [[nodiscard]] size_t GetVertexCount() const {
         return (m_VertexArray.empty() ? 0 : m_VertexArray[0].GetVertexCount());
     };
@@ -52,11 +66,41 @@ class SceneObjectMesh : public BaseSceneObject {
         const size_t index) const {
         return m_IndexArray[index];
     };
+    [[nodiscard]] const std::vector<Meshlet>& GetMeshlets(
+        const size_t index) const {
+        static const std::vector<Meshlet> empty;
+        return (index < m_Meshlets.size() ? m_Meshlets[index] : empty);
+    };
     const PrimitiveType& GetPrimitiveType() { return m_PrimitiveType; };
+    // Float positions of the base mesh, `stride` is in floats. Returns
+    // nullptr if the mesh has no such array.
+    const float* GetPositions(size_t& stride) const;
     [[nodiscard]] BoundingBox GetBoundingBox() const;
     [[nodiscard]] ConvexHull GetConvexHull() const;
 
+    // Reorders triangle lists for the post-transform vertex cache and
+    // overdraw, then the vertices for fetch locality. Index arrays are
+    // narrowed to 16 bits when the mesh has fewer than 65536 vertices.
+    void Optimize();
+
+    // Generates a coarser version of this mesh with about `ratio` of its
+    // triangles, stopping early if the relative error would exceed
+    // `target_error`. Returns nullptr if nothing could be removed.
+    [[nodiscard]] std::shared_ptr<SceneObjectMesh> Simplify(
+        const float ratio, const float target_error = 0.05f) const;
+
+    // Splits dense triangle lists into meshlets for cluster culling. The
+    // triangles of every index array are reordered so that each meshlet is
+    // a contiguous range of it.
+    void BuildMeshlets();
+
     friend std::ostream& operator<<(std::ostream& out,
                                     const SceneObjectMesh& obj);
+
+   private:
+    bool readIndexGroups(
+        std::vector<std::vector<uint32_t>>& index_groups) const;
+    void compactArrays(const SceneObjectMesh& source,
+                       std::vector<std::vector<uint32_t>>& index_groups);
 };
 }  // namespace My
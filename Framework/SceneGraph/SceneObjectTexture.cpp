@@ -11,6 +11,7 @@ using namespace std;
 #include "DDS.hpp"
 #include "HDR.hpp"
 #include "JPEG.hpp"
+#include "KTX2.hpp"
 #include "PNG.hpp"
 #include "PVR.hpp"
 #include "TGA.hpp"
@@ -47,7 +48,7 @@ bool SceneObjectTexture::LoadTexture() {
         DdsParser dds_parser;
         image = dds_parser.Parse(buf);
     } else if (ext == ".hdr") {
-        HdrParser hdr_parser;
+        HdrParser hdr_parser(true);
         image = hdr_parser.Parse(buf);
     } else if (ext == ".astc") {
         AstcParser astc_parser;
@@ -55,10 +56,17 @@ bool SceneObjectTexture::LoadTexture() {
     } else if (ext == ".pvr") {
         PVR::PvrParser pvr_parser;
         image = pvr_parser.Parse(buf);
+    } else if (ext == ".ktx2") {
+        KTX2::Ktx2Parser ktx2_parser;
+        image = ktx2_parser.Parse(buf);
     } else {
         assert(0);
     }
 
+    if (m_bGenerateMipmaps && !image.compressed) {
+        GenerateMipmaps(image, m_MipmapOptions);
+    }
+
     cerr << "End async loading of " << m_Name << endl;
 
     atomic_store_explicit(&m_pImage, make_shared<Image>(std::move(image)),
@@ -5,6 +5,7 @@
 #include "BaseSceneObject.hpp"
 #include "geommath.hpp"
 #include "Image.hpp"
+#include "MipmapGenerator.hpp"
 
 namespace My {
 class SceneObjectTexture : public BaseSceneObject {
@@ -14,6 +15,8 @@ class SceneObjectTexture : public BaseSceneObject {
     std::vector<Matrix4X4f> m_Transforms;
     std::shared_ptr<Image> m_pImage;
     std::future<bool> m_asyncLoadFuture;
+    bool m_bGenerateMipmaps{false};
+    MipmapOptions m_MipmapOptions;
 
    public:
     SceneObjectTexture()
@@ -23,6 +26,14 @@ class SceneObjectTexture : public BaseSceneObject {
           m_Name(name) {
         LoadTextureAsync();
     }
+    // an uncompressed image gets its mip chain generated once loaded
+    SceneObjectTexture(const std::string& name, const MipmapOptions& mipmaps)
+        : BaseSceneObject(SceneObjectType::kSceneObjectTypeTexture),
+          m_Name(name),
+          m_bGenerateMipmaps(true),
+          m_MipmapOptions(mipmaps) {
+        LoadTextureAsync();
+    }
 
     void AddTransform(Matrix4X4f& matrix) { m_Transforms.push_back(matrix); }
     void SetName(const std::string& name) {
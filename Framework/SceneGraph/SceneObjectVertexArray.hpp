@@ -50,6 +50,9 @@ class SceneObjectVertexArray {
     [[nodiscard]] const std::string& GetAttributeName() const {
         return m_strAttribute;
     };
+    [[nodiscard]] uint32_t GetMorphTargetIndex() const {
+        return m_nMorphTargetIndex;
+    };
     [[nodiscard]] VertexDataType GetDataType() const { return m_DataType; };
     [[nodiscard]] size_t GetDataSize() const {
         size_t size = m_szData;
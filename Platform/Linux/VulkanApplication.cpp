@@ -84,6 +84,7 @@ void VulkanApplication::CreateMainWindow() {
 
     // 创建逻辑设备
     m_Rhi.createLogicalDevice();
+    m_Rhi.createPipelineCache(m_Config.pipelineCacheDirectory);
 
     // 创建 SwapChain
     m_Rhi.createSwapChain();
@@ -82,6 +82,33 @@ size_t D3d12GraphicsManager::CreateIndexBuffer(
     return rhi.CreateIndexBuffer(pData, size, index_size);
 }
 
+// Keeps the compiled PSO for the next run, unless it was created from the
+// cache. The RHI clears the cached PSO of the description when the driver
+// refused it.
+void D3d12GraphicsManager::storeCachedPSO(
+    D3d12PipelineState& pipelineState,
+    const D3D12_CACHED_PIPELINE_STATE& cachedPSO) {
+    auto pPipelineStateMgr = dynamic_cast<PipelineStateManager*>(
+        dynamic_cast<BaseApplication*>(m_pApp)->GetPipelineStateManager());
+    if (!pPipelineStateMgr) return;
+
+    auto& cache = pPipelineStateMgr->GetPipelineStateCache();
+    if (!cache.IsOpen() || cachedPSO.CachedBlobSizeInBytes) return;
+
+    if (!pipelineState.cachedBlob.empty()) {
+        cache.Remove(pipelineState.cacheKey);
+    }
+
+    ID3DBlob* pBlob = nullptr;
+    if (SUCCEEDED(pipelineState.pipelineState->GetCachedBlob(&pBlob))) {
+        cache.Store(pipelineState.cacheKey, 0, pBlob->GetBufferPointer(),
+                    pBlob->GetBufferSize());
+        SafeRelease(&pBlob);
+    }
+
+    pipelineState.cachedBlob.clear();
+}
+
 // this is the function that loads and prepares the pso
 HRESULT D3d12GraphicsManager::CreatePSO(D3d12PipelineState& pipelineState) {
     HRESULT hr = S_OK;
@@ -271,8 +298,11 @@ HRESULT D3d12GraphicsManager::CreatePSO(D3d12PipelineState& pipelineState) {
             psod.SampleDesc.Quality = DXGI_STANDARD_MULTISAMPLE_QUALITY_PATTERN;
         }
         psod.DSVFormat = ::DXGI_FORMAT_D32_FLOAT;
+        psod.CachedPSO.pCachedBlob = pipelineState.cachedBlob.data();
+        psod.CachedPSO.CachedBlobSizeInBytes = pipelineState.cachedBlob.size();
 
         pipelineState.pipelineState = rhi.CreateGraphicsPipeline(psod);
+        storeCachedPSO(pipelineState, psod.CachedPSO);
     } else {
         assert(pipelineState.pipelineType == PIPELINE_TYPE::COMPUTE);
 
@@ -286,18 +316,16 @@ HRESULT D3d12GraphicsManager::CreatePSO(D3d12PipelineState& pipelineState) {
         pipelineState.rootSignature =
             rhi.CreateRootSignature(computeShaderByteCode);
 
-        D3D12_CACHED_PIPELINE_STATE cachedPSO;
-        cachedPSO.pCachedBlob = nullptr;
-        cachedPSO.CachedBlobSizeInBytes = 0;
         D3D12_COMPUTE_PIPELINE_STATE_DESC psod;
         psod.pRootSignature = pipelineState.rootSignature;
         psod.CS = computeShaderByteCode;
         psod.NodeMask = 0;
-        psod.CachedPSO.pCachedBlob = nullptr;
-        psod.CachedPSO.CachedBlobSizeInBytes = 0;
+        psod.CachedPSO.pCachedBlob = pipelineState.cachedBlob.data();
+        psod.CachedPSO.CachedBlobSizeInBytes = pipelineState.cachedBlob.size();
         psod.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 
         pipelineState.pipelineState = rhi.CreateComputePipeline(psod);
+        storeCachedPSO(pipelineState, psod.CachedPSO);
     }
 
     pipelineState.pipelineState->SetName(
@@ -493,10 +521,12 @@ void D3d12GraphicsManager::EndPass(Frame& frame) {
     rhi.EndPass();
 }
 
-void D3d12GraphicsManager::DrawBatch(const Frame& frame) {
-    for (const auto& pDbc : frame.batchContexts) {
+void D3d12GraphicsManager::DrawBatch(const Frame& frame,
+                                     const std::vector<uint32_t>& batches) {
+    // no batch constant ring yet, D3D12 does not draw per batch constants
+    for (const auto i : batches) {
         const D3dDrawBatchContext& dbc =
-            dynamic_cast<const D3dDrawBatchContext&>(*pDbc);
+            dynamic_cast<const D3dDrawBatchContext&>(*frame.batchContexts[i]);
     }
 
     auto& rhi = dynamic_cast<D3d12Application*>(m_pApp)->GetRHI();
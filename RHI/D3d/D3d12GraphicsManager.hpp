@@ -26,7 +26,8 @@ class D3d12GraphicsManager : public GraphicsManager {
     void SetPipelineState(const std::shared_ptr<PipelineState>& pipelineState,
                           const Frame& frame) final;
 
-    void DrawBatch(const Frame& frame) final;
+    void DrawBatch(const Frame& frame,
+                   const std::vector<uint32_t>& batches) final;
 
     void GenerateCubemapArray(TextureCubeArray& texture_array) final;
 
@@ -72,6 +73,8 @@ class D3d12GraphicsManager : public GraphicsManager {
     size_t CreateVertexBuffer(const SceneObjectVertexArray& v_property_array);
 
     HRESULT CreatePSO(D3d12PipelineState& pipelineState);
+    void storeCachedPSO(D3d12PipelineState& pipelineState,
+                        const D3D12_CACHED_PIPELINE_STATE& cachedPSO);
 
    private:
     ID3D12DescriptorHeap* m_pCbvSrvUavHeapImGui;
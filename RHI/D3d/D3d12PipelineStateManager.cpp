@@ -48,12 +48,40 @@ static void loadShaders(D3d12PipelineState* pState) {
     pState->computeShaderByteCode.pShaderBytecode = computeShader.MoveData();
 }
 
+int D3d12PipelineStateManager::Initialize() {
+    // the driver checks the cached PSOs are its own and from the same
+    // adapter, so the entries are not told apart by device
+    const char* directory = m_pApp->GetConfiguration().pipelineCacheDirectory;
+    if (directory && *directory) {
+        m_PipelineStateCache.Open(directory, "D3D12");
+    }
+
+    return PipelineStateManager::Initialize();
+}
+
 bool D3d12PipelineStateManager::InitializePipelineState(
     PipelineState** ppPipelineState) {
     D3d12PipelineState* pState = new D3d12PipelineState(**ppPipelineState);
 
     loadShaders(pState);
 
+    if (m_PipelineStateCache.IsOpen()) {
+        const vector<PipelineShaderStage> stages = {
+            {0, pState->vertexShaderByteCode.pShaderBytecode,
+             pState->vertexShaderByteCode.BytecodeLength},
+            {1, pState->pixelShaderByteCode.pShaderBytecode,
+             pState->pixelShaderByteCode.BytecodeLength},
+            {2, pState->geometryShaderByteCode.pShaderBytecode,
+             pState->geometryShaderByteCode.BytecodeLength},
+            {3, pState->computeShaderByteCode.pShaderBytecode,
+             pState->computeShaderByteCode.BytecodeLength}};
+        pState->cacheKey = HashPipelineState(*pState, stages);
+
+        uint32_t format;
+        m_PipelineStateCache.Load(pState->cacheKey, format,
+                                  pState->cachedBlob);
+    }
+
     *ppPipelineState = pState;
 
     return true;
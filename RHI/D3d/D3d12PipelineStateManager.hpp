@@ -1,6 +1,8 @@
 #pragma once
 #include <d3d12.h>
 
+#include <vector>
+
 #include "PipelineStateManager.hpp"
 
 namespace My {
@@ -12,6 +14,10 @@ struct D3d12PipelineState : public PipelineState {
     D3D12_SHADER_BYTECODE meshShaderByteCode;
     ID3D12PipelineState* pipelineState{nullptr};
     ID3D12RootSignature* rootSignature{nullptr};
+    // key of the pipeline in the pipeline state cache, and the PSO the
+    // driver gave back when it was last created
+    uint64_t cacheKey{0};
+    std::vector<uint8_t> cachedBlob;
 
     D3d12PipelineState(PipelineState& state) : PipelineState(state) {}
 };
@@ -21,6 +27,8 @@ class D3d12PipelineStateManager : public PipelineStateManager {
     D3d12PipelineStateManager() = default;
     ~D3d12PipelineStateManager() = default;
 
+    int Initialize() override;
+
    protected:
     bool InitializePipelineState(PipelineState** ppPipelineState) final;
     void DestroyPipelineState(PipelineState& pipelineState) final;
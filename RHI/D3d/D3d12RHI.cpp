@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include "D3d/D3d12Utility.hpp"
 #include "D3d12RHI.hpp"
@@ -485,13 +487,18 @@ ID3D12Resource* D3d12RHI::CreateTextureImage(Image& img) {
 
     DXGI_FORMAT format = getDxgiFormat(img);
 
+    // every level of every face and layer the file brings, in the order of
+    // the D3D12 subresources
+    const UINT16 mipLevels =
+        static_cast<UINT16>(std::max(img.GetMipLevels(), 1u));
     D3D12_RESOURCE_DESC textureDesc{};
-    textureDesc.MipLevels = 1;
+    textureDesc.MipLevels = mipLevels;
     textureDesc.Format = format;
     textureDesc.Width = img.Width;
     textureDesc.Height = img.Height;
     textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-    textureDesc.DepthOrArraySize = 1;
+    textureDesc.DepthOrArraySize =
+        static_cast<UINT16>(img.face_count * img.array_size);
     textureDesc.SampleDesc.Count = 1;
     textureDesc.SampleDesc.Quality = 0;
     textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
@@ -531,20 +538,24 @@ ID3D12Resource* D3d12RHI::CreateTextureImage(Image& img) {
 
     // Copy data to the intermediate upload heap and then schedule a copy
     // from the upload heap to the Texture2D.
-    D3D12_SUBRESOURCE_DATA textureData{};
-    if (img.compressed) {
-        textureData.pData = img.data;
-        textureData.RowPitch = img.pitch;
-        textureData.SlicePitch = img.data_size;
+    std::vector<D3D12_SUBRESOURCE_DATA> textureData(subresourceCount);
+    if (img.mipmaps.empty()) {
+        textureData[0].pData = img.data;
+        textureData[0].RowPitch = img.pitch;
+        textureData[0].SlicePitch =
+            img.compressed ? img.data_size : img.pitch * img.Height;
     } else {
-        textureData.pData = img.data;
-        textureData.RowPitch = img.pitch;
-        textureData.SlicePitch = img.pitch * img.Height;
+        for (UINT i = 0; i < subresourceCount; i++) {
+            const auto& mip = img.mipmaps[i];
+            textureData[i].pData = img.data + mip.offset;
+            textureData[i].RowPitch = mip.pitch;
+            textureData[i].SlicePitch = mip.data_size;
+        }
     }
 
     beginSingleTimeCommands();
     UpdateSubresources(m_pCopyCommandList, pTextureBuffer, pTextureUploadHeap,
-                       0, 0, subresourceCount, &textureData);
+                       0, 0, subresourceCount, textureData.data());
     endSingleTimeCommands();
 
     SafeRelease(&pTextureUploadHeap);
@@ -604,8 +615,15 @@ ID3D12PipelineState* D3d12RHI::CreateGraphicsPipeline(
     D3D12_GRAPHICS_PIPELINE_STATE_DESC& psod) {
     ID3D12PipelineState* pPipelineState;
 
-    assert(SUCCEEDED(m_pDev->CreateGraphicsPipelineState(
-        &psod, IID_PPV_ARGS(&pPipelineState))));
+    HRESULT hr = m_pDev->CreateGraphicsPipelineState(
+        &psod, IID_PPV_ARGS(&pPipelineState));
+    if (FAILED(hr) && psod.CachedPSO.pCachedBlob) {
+        // the cached PSO is of another driver or adapter
+        psod.CachedPSO = {nullptr, 0};
+        hr = m_pDev->CreateGraphicsPipelineState(
+            &psod, IID_PPV_ARGS(&pPipelineState));
+    }
+    assert(SUCCEEDED(hr));
 
     return pPipelineState;
 }
@@ -614,8 +632,14 @@ ID3D12PipelineState* D3d12RHI::CreateComputePipeline(
     D3D12_COMPUTE_PIPELINE_STATE_DESC& psod) {
     ID3D12PipelineState* pPipelineState;
 
-    assert(SUCCEEDED(m_pDev->CreateComputePipelineState(
-        &psod, IID_PPV_ARGS(&pPipelineState))));
+    HRESULT hr = m_pDev->CreateComputePipelineState(
+        &psod, IID_PPV_ARGS(&pPipelineState));
+    if (FAILED(hr) && psod.CachedPSO.pCachedBlob) {
+        psod.CachedPSO = {nullptr, 0};
+        hr = m_pDev->CreateComputePipelineState(
+            &psod, IID_PPV_ARGS(&pPipelineState));
+    }
+    assert(SUCCEEDED(hr));
 
     return pPipelineState;
 }
@@ -1,7 +1,7 @@
 #include "EmptyPipelineStateManager.hpp"
-#include "GraphicsManager.hpp"
+#include "EmptyGraphicsManager.hpp"
 
 namespace My {
-using TGraphicsManager = GraphicsManager;
+using TGraphicsManager = EmptyGraphicsManager;
 using TPipelineStateManager = EmptyPipelineStateManager;
 }  // namespace My
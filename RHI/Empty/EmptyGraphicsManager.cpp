@@ -1 +1,40 @@
-// empty file
\ No newline at end of file
+#include "EmptyGraphicsManager.hpp"
+
+using namespace My;
+using namespace std;
+
+bool EmptyGraphicsManager::beginCommandLists(const Frame& frame,
+                                             const uint32_t count) {
+    // every list is only touched by the job recording it
+    m_CommandLists.resize(count);
+    for (auto& list : m_CommandLists) {
+        list.clear();
+    }
+
+    return true;
+}
+
+void EmptyGraphicsManager::recordBatches(const Frame& frame,
+                                         const vector<uint32_t>& batches,
+                                         const BatchRange& range,
+                                         const uint32_t list_index) {
+    auto& list = m_CommandLists[list_index];
+
+    for (size_t i = range.begin; i < range.end; i++) {
+        const auto& pDbc = frame.batchContexts[batches[i]];
+        if (pDbc->occluded) continue;
+
+        list.push_back({pDbc->batchIndex, pDbc->lod,
+                        static_cast<uint32_t>(pDbc->indexRanges.size()),
+                        list_index});
+    }
+}
+
+void EmptyGraphicsManager::executeCommandLists(const Frame& frame,
+                                               const uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        m_ExecutedDraws.insert(m_ExecutedDraws.end(),
+                               m_CommandLists[i].begin(),
+                               m_CommandLists[i].end());
+    }
+}
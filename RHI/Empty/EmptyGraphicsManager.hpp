@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+
+#include "GraphicsManager.hpp"
+
+namespace My {
+// A graphics manager without a GPU. Draws are recorded into command lists
+// which are executed by appending them to a log, so the parallel recording
+// path can be checked headless.
+class EmptyGraphicsManager : public GraphicsManager {
+   public:
+    struct RecordedDraw {
+        int32_t batchIndex;
+        uint32_t lod;
+        uint32_t indexRangeCount;
+        uint32_t commandList;
+    };
+
+    EmptyGraphicsManager() { m_bCullsOccludedBatches = true; }
+
+    [[nodiscard]] const std::vector<RecordedDraw>& GetExecutedDraws() const {
+        return m_ExecutedDraws;
+    }
+    void ClearExecutedDraws() { m_ExecutedDraws.clear(); }
+
+   protected:
+    bool beginCommandLists(const Frame& frame, const uint32_t count) final;
+    void recordBatches(const Frame& frame,
+                       const std::vector<uint32_t>& batches,
+                       const BatchRange& range,
+                       const uint32_t list_index) final;
+    void executeCommandLists(const Frame& frame, const uint32_t count) final;
+
+   private:
+    std::vector<std::vector<RecordedDraw>> m_CommandLists;
+    std::vector<RecordedDraw> m_ExecutedDraws;
+};
+}  // namespace My
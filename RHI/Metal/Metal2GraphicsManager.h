@@ -16,7 +16,7 @@ class Metal2GraphicsManager : public GraphicsManager {
     void SetPipelineState(const std::shared_ptr<PipelineState>& pipelineState,
                           const Frame& frame) final;
 
-    void DrawBatch(const Frame& frame) final;
+    void DrawBatch(const Frame& frame, const std::vector<uint32_t>& batches) final;
 
     void CreateTextureView(Texture2D& texture_view, const TextureArrayBase& texture_array, const uint32_t slice, const uint32_t mip) final; 
 
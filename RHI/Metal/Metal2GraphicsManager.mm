@@ -234,7 +234,9 @@ void Metal2GraphicsManager::SetPipelineState(const std::shared_ptr<PipelineState
     [m_pRenderer setPipelineState:*pState frameContext:frame];
 }
 
-void Metal2GraphicsManager::DrawBatch(const Frame& frame) { [m_pRenderer drawBatch:frame]; }
+void Metal2GraphicsManager::DrawBatch(const Frame& frame, const std::vector<uint32_t>& batches) {
+    [m_pRenderer drawBatch:frame batches:batches];
+}
 
 void Metal2GraphicsManager::GenerateCubemapArray(TextureCubeArray& texture_array) {
     [m_pRenderer generateCubemapArray:texture_array];
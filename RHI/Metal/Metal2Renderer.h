@@ -28,7 +28,7 @@ struct MtlDrawBatchContext : public DrawBatchContext {
 
 - (void)setPerFrameConstants:(const DrawFrameContext &)context frameIndex:(const int32_t)index;
 
-- (void)setLightInfo:(const LightInfo &)lightInfo frameIndex:(const int32_t)index;
+- (void)setLightInfo:(const Frame &)frame;
 
 - (void)createVertexBuffer:(const My::SceneObjectVertexArray &)v_property_array;
 
@@ -44,7 +44,7 @@ struct MtlDrawBatchContext : public DrawBatchContext {
 
 - (void)drawSkyBox:(const Frame&)frame;
 
-- (void)drawBatch:(const Frame &)frame;
+- (void)drawBatch:(const Frame &)frame batches:(const std::vector<uint32_t> &)batches;
 
 - (void)beginCompute;
 
@@ -12,6 +12,21 @@
 
 using namespace My;
 
+// grows the buffer as needed, it is only written once its frame is done
+static void uploadBuffer(id<MTLDevice> device, id<MTLBuffer>& buffer, const void* data,
+                         const size_t size) {
+    // a buffer can not be empty
+    const size_t length = std::max(size, sizeof(uint32_t));
+    if (!buffer || buffer.length < length) {
+        [buffer release];
+        buffer = [device newBufferWithLength:length options:MTLResourceStorageModeShared];
+    }
+
+    if (size) {
+        std::memcpy(buffer.contents, data, size);
+    }
+}
+
 static MTLPixelFormat getMtlPixelFormat(const COMPRESSED_FORMAT compressed_format) {
     MTLPixelFormat format;
 
@@ -147,6 +162,9 @@ static const NSUInteger GEFSMaxBuffersInFlight = GfxConfiguration::kMaxInFlightF
     // Metal objects
     id<MTLBuffer> _uniformBuffers[GEFSMaxBuffersInFlight];
     id<MTLBuffer> _lightInfo[GEFSMaxBuffersInFlight];
+    id<MTLBuffer> _clusteredLights[GEFSMaxBuffersInFlight];
+    id<MTLBuffer> _lightClusters[GEFSMaxBuffersInFlight];
+    id<MTLBuffer> _lightClusterIndices[GEFSMaxBuffersInFlight];
     ShadowMapConstants shadow_map_constants;
     std::vector<id<MTLBuffer>> _vertexBuffers;
     std::vector<id<MTLBuffer>> _indexBuffers;
@@ -256,16 +274,49 @@ static const NSUInteger GEFSMaxBuffersInFlight = GfxConfiguration::kMaxInFlightF
         textureDesc.width = image.Width;
         textureDesc.height = image.Height;
 
+        // the levels, faces and layers the file brings
+        const uint32_t levels = std::max(image.GetMipLevels(), 1u);
+        textureDesc.mipmapLevelCount = levels;
+        if (image.face_count == 6) {
+            textureDesc.textureType = image.array_size > 1
+                                          ? MTLTextureTypeCubeArray
+                                          : MTLTextureTypeCube;
+        } else if (image.array_size > 1) {
+            textureDesc.textureType = MTLTextureType2DArray;
+        }
+        textureDesc.arrayLength = image.array_size;
+
         // create the texture obj
         texture = [_device newTextureWithDescriptor:textureDesc];
 
         // now upload the data
-        MTLRegion region = {
-            {0, 0, 0},                      // MTLOrigin
-            {image.Width, image.Height, 1}  // MTLSize
-        };
+        if (image.mipmaps.empty()) {
+            MTLRegion region = {
+                {0, 0, 0},                      // MTLOrigin
+                {image.Width, image.Height, 1}  // MTLSize
+            };
 
-        [texture replaceRegion:region mipmapLevel:0 withBytes:image.data bytesPerRow:image.pitch];
+            [texture replaceRegion:region mipmapLevel:0 withBytes:image.data bytesPerRow:image.pitch];
+        } else {
+            for (uint32_t layer = 0; layer < image.array_size; layer++) {
+                for (uint32_t face = 0; face < image.face_count; face++) {
+                    for (uint32_t level = 0; level < levels; level++) {
+                        const auto& mip = image.GetSubresource(level, face, layer);
+                        MTLRegion region = {
+                            {0, 0, 0},                  // MTLOrigin
+                            {mip.Width, mip.Height, 1}  // MTLSize
+                        };
+
+                        [texture replaceRegion:region
+                                   mipmapLevel:level
+                                         slice:layer * image.face_count + face
+                                     withBytes:image.data + mip.offset
+                                   bytesPerRow:mip.pitch
+                                 bytesPerImage:mip.data_size];
+                    }
+                }
+            }
+        }
     }
 
     return texture;
@@ -365,7 +416,7 @@ static const NSUInteger GEFSMaxBuffersInFlight = GfxConfiguration::kMaxInFlightF
 
         // now fill the per frame buffers
         [self setPerFrameConstants:frame.frameContext frameIndex:frame.frameIndex];
-        [self setLightInfo:frame.lightInfo frameIndex:frame.frameIndex];
+        [self setLightInfo:frame];
 
         MTLRenderPassDescriptor* renderPassDescriptor = _mtkView.currentRenderPassDescriptor;
         ImGui_ImplMetal_NewFrame(renderPassDescriptor);
@@ -520,6 +571,16 @@ static const NSUInteger GEFSMaxBuffersInFlight = GfxConfiguration::kMaxInFlightF
 
             [_renderEncoder setFragmentBuffer:_lightInfo[frame.frameIndex] offset:0 atIndex:12];
 
+            [_renderEncoder setFragmentBuffer:_clusteredLights[frame.frameIndex]
+                                       offset:0
+                                      atIndex:14];
+            [_renderEncoder setFragmentBuffer:_lightClusters[frame.frameIndex]
+                                       offset:0
+                                      atIndex:15];
+            [_renderEncoder setFragmentBuffer:_lightClusterIndices[frame.frameIndex]
+                                       offset:0
+                                      atIndex:16];
+
             switch (pipelineState.flag) {
                 case PIPELINE_FLAG::SHADOW:
                     [_renderEncoder setVertexBytes:static_cast<const void*>(&shadow_map_constants)
@@ -557,8 +618,19 @@ static const NSUInteger GEFSMaxBuffersInFlight = GfxConfiguration::kMaxInFlightF
                 &static_cast<const PerFrameConstants&>(context), sizeof(PerFrameConstants));
 }
 
-- (void)setLightInfo:(const LightInfo&)lightInfo frameIndex:(const int32_t)frameIndex {
-    std::memcpy(_lightInfo[frameIndex].contents, &lightInfo, sizeof(LightInfo));
+- (void)setLightInfo:(const Frame&)frame {
+    const int32_t frameIndex = frame.frameIndex;
+
+    // only the lights the shaders loop over
+    std::memcpy(_lightInfo[frameIndex].contents, frame.lights.data(),
+                frame.frameContext.numLights * sizeof(Light));
+
+    uploadBuffer(_device, _clusteredLights[frameIndex], frame.lights.data(),
+                 frame.lights.size() * sizeof(Light));
+    uploadBuffer(_device, _lightClusters[frameIndex], frame.lightClusters.data(),
+                 frame.lightClusters.size() * sizeof(LightClusterRange));
+    uploadBuffer(_device, _lightClusterIndices[frameIndex], frame.lightClusterIndices.data(),
+                 frame.lightClusterIndices.size() * sizeof(uint32_t));
 }
 
 - (void)drawSkyBox:(const Frame&)frame {
@@ -590,10 +662,12 @@ static const NSUInteger GEFSMaxBuffersInFlight = GfxConfiguration::kMaxInFlightF
 }
 
 // Called whenever the view needs to render
-- (void)drawBatch:(const Frame&)frame {
+- (void)drawBatch:(const Frame&)frame batches:(const std::vector<uint32_t>&)batches {
     // Push a debug group allowing us to identify render commands in the GPU Frame Capture tool
     [_renderEncoder pushDebugGroup:@"DrawMesh"];
-    for (const auto& pDbc : frame.batchContexts) {
+    for (const auto i : batches) {
+        const auto& pDbc = frame.batchContexts[i];
+        // no batch constant ring on Metal, the model matrix goes with the draw
         [_renderEncoder setVertexBytes:pDbc->modelMatrix length:64 atIndex:11];
 
         const auto& dbc = dynamic_cast<const MtlDrawBatchContext&>(*pDbc);
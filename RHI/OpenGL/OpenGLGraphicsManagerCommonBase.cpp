@@ -1,6 +1,7 @@
 #include "OpenGLGraphicsManagerCommonBase.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <sstream>
@@ -15,43 +16,70 @@
 #endif
 
 #include "BaseApplication.hpp"
+#include "ShaderVariant.hpp"
 
 using namespace std;
 using namespace My;
 
 void OpenGLGraphicsManagerCommonBase::Present() { glFlush(); }
 
-bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
-    const char* paramName, const Matrix4X4f& param) {
-    unsigned int location;
+// the clustered lights are read from storage buffers, which WebGL lacks.
+// The desktop shaders are GLSL 4.20 and require
+// GL_ARB_shader_storage_buffer_object for them before 4.3
+static bool has_storage_buffers() {
+#if defined(OS_WEBASSEMBLY)
+    return false;
+#elif defined(OS_ANDROID)
+    return true;
+#else
+    return GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_shader_storage_buffer_object;
+#endif
+}
 
-    location = glGetUniformLocation(m_CurrentShader, paramName);
-    if (location == -1) {
-        return false;
+static void upload_storage_buffer(uint32_t& buffer, const void* data,
+                                  const size_t size) {
+    if (!buffer) {
+        glGenBuffers(1, &buffer);
     }
-    glUniformMatrix4fv(location, 1, false, param);
 
-    return true;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    // an empty buffer can not be bound
+    if (size) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_STREAM_DRAW);
+    } else {
+        const uint32_t zero = 0;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zero), &zero,
+                     GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+int32_t OpenGLGraphicsManagerCommonBase::getUniformLocation(
+    const ShaderParameterId id) const {
+    if (!m_pCurrentPipelineState) return -1;
+
+    return m_pCurrentPipelineState->GetUniformLocation(id);
 }
 
 bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
-    const char* paramName, const Matrix4X4f* param, const int32_t count) {
-    bool result = true;
-    char uniformName[256];
+    const ShaderParameterId id, const Matrix4X4f& param) {
+    return setShaderParameter(id, &param, 1);
+}
 
-    for (int32_t i = 0; i < count; i++) {
-        sprintf(uniformName, "%s[%d]", paramName, i);
-        result &= setShaderParameter(uniformName, *(param + i));
+bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
+    const ShaderParameterId id, const Matrix4X4f* param, const int32_t count) {
+    const int32_t location = getUniformLocation(id);
+    if (location == -1) {
+        return false;
     }
+    glUniformMatrix4fv(location, count, false, *param);
 
-    return result;
+    return true;
 }
 
 bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
-    const char* paramName, const Vector2f& param) {
-    unsigned int location;
-
-    location = glGetUniformLocation(m_CurrentShader, paramName);
+    const ShaderParameterId id, const Vector2f& param) {
+    const int32_t location = getUniformLocation(id);
     if (location == -1) {
         return false;
     }
@@ -61,10 +89,8 @@ bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
 }
 
 bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
-    const char* paramName, const Vector3f& param) {
-    unsigned int location;
-
-    location = glGetUniformLocation(m_CurrentShader, paramName);
+    const ShaderParameterId id, const Vector3f& param) {
+    const int32_t location = getUniformLocation(id);
     if (location == -1) {
         return false;
     }
@@ -74,10 +100,8 @@ bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
 }
 
 bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
-    const char* paramName, const Vector4f& param) {
-    unsigned int location;
-
-    location = glGetUniformLocation(m_CurrentShader, paramName);
+    const ShaderParameterId id, const Vector4f& param) {
+    const int32_t location = getUniformLocation(id);
     if (location == -1) {
         return false;
     }
@@ -86,11 +110,9 @@ bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
     return true;
 }
 
-bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
-                                                         const float param) {
-    unsigned int location;
-
-    location = glGetUniformLocation(m_CurrentShader, paramName);
+bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
+    const ShaderParameterId id, const float param) {
+    const int32_t location = getUniformLocation(id);
     if (location == -1) {
         return false;
     }
@@ -99,11 +121,9 @@ bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
     return true;
 }
 
-bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
-                                                         const int32_t param) {
-    unsigned int location;
-
-    location = glGetUniformLocation(m_CurrentShader, paramName);
+bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
+    const ShaderParameterId id, const int32_t param) {
+    const int32_t location = getUniformLocation(id);
     if (location == -1) {
         return false;
     }
@@ -112,11 +132,9 @@ bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
     return true;
 }
 
-bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
-                                                         const uint32_t param) {
-    unsigned int location;
-
-    location = glGetUniformLocation(m_CurrentShader, paramName);
+bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
+    const ShaderParameterId id, const uint32_t param) {
+    const int32_t location = getUniformLocation(id);
     if (location == -1) {
         return false;
     }
@@ -125,11 +143,9 @@ bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
     return true;
 }
 
-bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
-                                                         const bool param) {
-    unsigned int location;
-
-    location = glGetUniformLocation(m_CurrentShader, paramName);
+bool OpenGLGraphicsManagerCommonBase::setShaderParameter(
+    const ShaderParameterId id, const bool param) {
+    const int32_t location = getUniformLocation(id);
     if (location == -1) {
         return false;
     }
@@ -138,6 +154,71 @@ bool OpenGLGraphicsManagerCommonBase::setShaderParameter(const char* paramName,
     return true;
 }
 
+// Sets up the vertex attributes of the vertex array object currently bound.
+// The buffers of a mesh are uploaded on first use and can be shared with
+// other vertex array objects by passing them in again.
+void OpenGLGraphicsManagerCommonBase::bindVertexBuffers(
+    const SceneObjectMesh& mesh, vector<uint32_t>& buffers) {
+    for (uint32_t i = 0; i < mesh.GetVertexPropertiesCount(); i++) {
+        const SceneObjectVertexArray& v_property_array =
+            mesh.GetVertexPropertyArray(i);
+
+        if (i < buffers.size()) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        } else {
+            const auto v_property_array_data_size =
+                v_property_array.GetDataSize();
+            const auto v_property_array_data = v_property_array.GetData();
+
+            // Generate an ID for the vertex buffer.
+            uint32_t buffer_id;
+            glGenBuffers(1, &buffer_id);
+
+            // Bind the vertex buffer and load the vertex (position and
+            // color) data into the vertex buffer.
+            glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+            glBufferData(GL_ARRAY_BUFFER, v_property_array_data_size,
+                         v_property_array_data, GL_STATIC_DRAW);
+
+            buffers.push_back(buffer_id);
+            m_Buffers.push_back(buffer_id);
+        }
+
+        glEnableVertexAttribArray(i);
+
+        switch (v_property_array.GetDataType()) {
+            case VertexDataType::kVertexDataTypeFloat1:
+                glVertexAttribPointer(i, 1, GL_FLOAT, false, 0, nullptr);
+                break;
+            case VertexDataType::kVertexDataTypeFloat2:
+                glVertexAttribPointer(i, 2, GL_FLOAT, false, 0, nullptr);
+                break;
+            case VertexDataType::kVertexDataTypeFloat3:
+                glVertexAttribPointer(i, 3, GL_FLOAT, false, 0, nullptr);
+                break;
+            case VertexDataType::kVertexDataTypeFloat4:
+                glVertexAttribPointer(i, 4, GL_FLOAT, false, 0, nullptr);
+                break;
+#if !defined(OS_ANDROID) && !defined(OS_WEBASSEMBLY)
+            case VertexDataType::kVertexDataTypeDouble1:
+                glVertexAttribPointer(i, 1, GL_DOUBLE, false, 0, nullptr);
+                break;
+            case VertexDataType::kVertexDataTypeDouble2:
+                glVertexAttribPointer(i, 2, GL_DOUBLE, false, 0, nullptr);
+                break;
+            case VertexDataType::kVertexDataTypeDouble3:
+                glVertexAttribPointer(i, 3, GL_DOUBLE, false, 0, nullptr);
+                break;
+            case VertexDataType::kVertexDataTypeDouble4:
+                glVertexAttribPointer(i, 4, GL_DOUBLE, false, 0, nullptr);
+                break;
+#endif
+            default:
+                assert(0);
+        }
+    }
+}
+
 void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
     uint32_t batch_index = 0;
 
@@ -151,10 +232,6 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
             const auto& pMesh = pGeometry->GetMesh().lock();
             if (!pMesh) continue;
 
-            // Set the number of vertex properties.
-            const auto vertexPropertiesCount =
-                pMesh->GetVertexPropertiesCount();
-
             // Allocate an OpenGL vertex array object.
             uint32_t vao;
             glGenVertexArrays(1, &vao);
@@ -163,67 +240,10 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
             // attributes we create here.
             glBindVertexArray(vao);
 
-            uint32_t buffer_id;
-
-            for (uint32_t i = 0; i < vertexPropertiesCount; i++) {
-                const SceneObjectVertexArray& v_property_array =
-                    pMesh->GetVertexPropertyArray(i);
-                const auto v_property_array_data_size =
-                    v_property_array.GetDataSize();
-                const auto v_property_array_data = v_property_array.GetData();
-
-                // Generate an ID for the vertex buffer.
-                glGenBuffers(1, &buffer_id);
-
-                // Bind the vertex buffer and load the vertex (position and
-                // color) data into the vertex buffer.
-                glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
-                glBufferData(GL_ARRAY_BUFFER, v_property_array_data_size,
-                             v_property_array_data, GL_STATIC_DRAW);
-
-                glEnableVertexAttribArray(i);
-
-                switch (v_property_array.GetDataType()) {
-                    case VertexDataType::kVertexDataTypeFloat1:
-                        glVertexAttribPointer(i, 1, GL_FLOAT, false, 0,
-                                              nullptr);
-                        break;
-                    case VertexDataType::kVertexDataTypeFloat2:
-                        glVertexAttribPointer(i, 2, GL_FLOAT, false, 0,
-                                              nullptr);
-                        break;
-                    case VertexDataType::kVertexDataTypeFloat3:
-                        glVertexAttribPointer(i, 3, GL_FLOAT, false, 0,
-                                              nullptr);
-                        break;
-                    case VertexDataType::kVertexDataTypeFloat4:
-                        glVertexAttribPointer(i, 4, GL_FLOAT, false, 0,
-                                              nullptr);
-                        break;
-#if !defined(OS_ANDROID) && !defined(OS_WEBASSEMBLY)
-                    case VertexDataType::kVertexDataTypeDouble1:
-                        glVertexAttribPointer(i, 1, GL_DOUBLE, false, 0,
-                                              nullptr);
-                        break;
-                    case VertexDataType::kVertexDataTypeDouble2:
-                        glVertexAttribPointer(i, 2, GL_DOUBLE, false, 0,
-                                              nullptr);
-                        break;
-                    case VertexDataType::kVertexDataTypeDouble3:
-                        glVertexAttribPointer(i, 3, GL_DOUBLE, false, 0,
-                                              nullptr);
-                        break;
-                    case VertexDataType::kVertexDataTypeDouble4:
-                        glVertexAttribPointer(i, 4, GL_DOUBLE, false, 0,
-                                              nullptr);
-                        break;
-#endif
-                    default:
-                        assert(0);
-                }
+            vector<uint32_t> vertex_buffers;
+            bindVertexBuffers(*pMesh, vertex_buffers);
 
-                m_Buffers.push_back(buffer_id);
-            }
+            uint32_t buffer_id;
 
             const auto indexGroupCount = pMesh->GetIndexGroupCount();
 
@@ -252,6 +272,21 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
                     continue;
             }
 
+            // the simplified levels of detail share the index groups
+            // (materials) with LOD 0
+            size_t lod_count = 1;
+            if (mode == GL_TRIANGLES) {
+                while (lod_count < GfxConfiguration::kMaxLodCount) {
+                    const auto& pLodMesh =
+                        pGeometry->GetMeshLOD(lod_count).lock();
+                    if (!pLodMesh ||
+                        pLodMesh->GetIndexGroupCount() != indexGroupCount)
+                        break;
+                    lod_count++;
+                }
+            }
+            vector<vector<uint32_t>> lod_vertex_buffers(lod_count);
+
             for (uint32_t i = 0; i < indexGroupCount; i++) {
                 // Generate an ID for the index buffer.
                 glGenBuffers(1, &buffer_id);
@@ -310,17 +345,44 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
                             uint32_t format, internal_format, type;
                             getOpenGLTextureFormat(*texture, format,
                                                    internal_format, type);
-                            if (texture->compressed) {
-                                glCompressedTexImage2D(
-                                    GL_TEXTURE_2D, 0, internal_format,
-                                    texture->Width, texture->Height, 0,
-                                    static_cast<int32_t>(texture->data_size),
-                                    texture->data);
-                            } else {
-                                glTexImage2D(GL_TEXTURE_2D, 0, internal_format,
-                                             texture->Width, texture->Height, 0,
-                                             format, type, texture->data);
+                            // the levels the file brings, or only the
+                            // image when the parser describes none
+                            const Image::Mipmap whole(
+                                texture->Width, texture->Height,
+                                texture->pitch, 0, texture->data_size);
+                            const uint32_t levels =
+                                std::max(texture->GetMipLevels(), 1u);
+                            // rows are as long as the pitch of their level,
+                            // which the parsers keep tight or pad past the
+                            // width rather than to 4 bytes
+                            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                            for (uint32_t level = 0; level < levels; level++) {
+                                const auto& mip =
+                                    texture->mipmaps.empty()
+                                        ? whole
+                                        : texture->GetSubresource(level);
+                                if (texture->compressed) {
+                                    glCompressedTexImage2D(
+                                        GL_TEXTURE_2D, level, internal_format,
+                                        mip.Width, mip.Height, 0,
+                                        static_cast<int32_t>(mip.data_size),
+                                        texture->data + mip.offset);
+                                } else {
+                                    if (texture->bitcount) {
+                                        glPixelStorei(
+                                            GL_UNPACK_ROW_LENGTH,
+                                            static_cast<int32_t>(
+                                                mip.pitch * 8 /
+                                                texture->bitcount));
+                                    }
+                                    glTexImage2D(
+                                        GL_TEXTURE_2D, level, internal_format,
+                                        mip.Width, mip.Height, 0, format, type,
+                                        texture->data + mip.offset);
+                                }
                             }
+                            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+                            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
                             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
                                             GL_REPEAT);
@@ -331,7 +393,14 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
                             glTexParameteri(GL_TEXTURE_2D,
                                             GL_TEXTURE_MIN_FILTER,
                                             GL_LINEAR_MIPMAP_LINEAR);
-                            glGenerateMipmap(GL_TEXTURE_2D);
+                            // compressed images can not be filtered down
+                            if (levels > 1 || texture->compressed) {
+                                glTexParameteri(GL_TEXTURE_2D,
+                                                GL_TEXTURE_MAX_LEVEL,
+                                                levels - 1);
+                            } else {
+                                glGenerateMipmap(GL_TEXTURE_2D);
+                            }
 
                             glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -412,6 +481,10 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
                                 upload_texture(texture_key, image);
                         }
                     }
+
+                    dbc->shaderVariant = MakeShaderVariantKey(
+                        GetMaterialShaderFeatures(*material),
+                        ShaderPass::Forward);
                 }
 
                 glBindVertexArray(0);
@@ -422,6 +495,46 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
                 dbc->type = type;
                 dbc->count = indexCount;
                 dbc->node = pGeometryNode;
+                dbc->indexGroup = i;
+
+                if (mode == GL_TRIANGLES) {
+                    dbc->meshlets = pMesh->GetMeshlets(i);
+                }
+
+                // one vertex array object per level of detail, so that the
+                // level can be switched every frame by DrawBatch
+                for (size_t lod = 1; lod < lod_count; lod++) {
+                    const auto& pLodMesh = pGeometry->GetMeshLOD(lod).lock();
+                    const SceneObjectIndexArray& lod_index_array =
+                        pLodMesh->GetIndexArray(i);
+
+                    OpenGLDrawRange range;
+                    glGenVertexArrays(1, &range.vao);
+                    glBindVertexArray(range.vao);
+
+                    bindVertexBuffers(*pLodMesh, lod_vertex_buffers[lod]);
+
+                    glGenBuffers(1, &buffer_id);
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer_id);
+                    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                                 lod_index_array.GetDataSize(),
+                                 lod_index_array.GetData(), GL_STATIC_DRAW);
+                    m_Buffers.push_back(buffer_id);
+
+                    // simplified meshes only come with 16 or 32 bit indices
+                    range.type = (lod_index_array.GetIndexType() ==
+                                  IndexDataType::kIndexDataTypeInt16)
+                                     ? GL_UNSIGNED_SHORT
+                                     : GL_UNSIGNED_INT;
+                    range.count =
+                        static_cast<int32_t>(lod_index_array.GetIndexCount());
+
+                    dbc->lods.push_back(range);
+                }
+
+                glBindVertexArray(0);
+
+                dbc->lodCount = static_cast<uint32_t>(lod_count);
 
                 for (int32_t n = 0;
                      n < GfxConfiguration::kMaxInFlightFrameCount; n++) {
@@ -430,6 +543,122 @@ void OpenGLGraphicsManagerCommonBase::initializeGeometries(const Scene& scene) {
             }
         }
     }
+
+    createBatchConstantBuffer(m_Frames[0].batchContexts.size());
+}
+
+void OpenGLGraphicsManagerCommonBase::createBatchConstantBuffer(
+    const size_t batch_count) {
+    if (batch_count == 0) return;
+
+    int32_t alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+
+    const size_t stride =
+        (sizeof(PerBatchConstants) + alignment - 1) / alignment * alignment;
+    const size_t size =
+        stride * batch_count * GfxConfiguration::kMaxInFlightFrameCount;
+
+    glGenBuffers(1, &m_uboDrawBatchConstant);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawBatchConstant);
+
+    uint8_t* pMemory = nullptr;
+#if !defined(OS_ANDROID) && !defined(OS_WEBASSEMBLY)
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+        // coherent, so the writes of UpdateConstants need no flush
+        const GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        pMemory = static_cast<uint8_t*>(
+            glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+
+        if (!pMemory) {
+            // the storage is immutable, start over with a plain buffer
+            glDeleteBuffers(1, &m_uboDrawBatchConstant);
+            glGenBuffers(1, &m_uboDrawBatchConstant);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawBatchConstant);
+        }
+    }
+#endif
+
+    m_bBatchConstantMapped = (pMemory != nullptr);
+
+    if (!m_bBatchConstantMapped) {
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        m_BatchConstantStaging.resize(size);
+        pMemory = m_BatchConstantStaging.data();
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // glBufferSubData copies the data right away, fences are only needed
+    // when the GPU reads the mapped memory directly
+    m_pBatchConstantAllocator = make_unique<FrameRingAllocator>(
+        pMemory, size, GfxConfiguration::kMaxInFlightFrameCount,
+        static_cast<size_t>(alignment),
+        m_bBatchConstantMapped ? &m_BatchConstantFence : nullptr);
+}
+
+void OpenGLGraphicsManagerCommonBase::releaseBatchConstantBuffer() {
+    m_pBatchConstantAllocator.reset();
+
+    if (m_uboDrawBatchConstant) {
+        if (m_bBatchConstantMapped) {
+            // the GPU may still read from the mapping
+            glFinish();
+            glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawBatchConstant);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        glDeleteBuffers(1, &m_uboDrawBatchConstant);
+        m_uboDrawBatchConstant = 0;
+    }
+
+    m_bBatchConstantMapped = false;
+    m_BatchConstantStaging.clear();
+    m_BatchConstantStaging.shrink_to_fit();
+}
+
+OpenGLGraphicsManagerCommonBase::OpenGLFrameFence::~OpenGLFrameFence() {
+    for (auto& sync : m_Syncs) {
+        if (sync) {
+            glDeleteSync(static_cast<GLsync>(sync));
+            sync = nullptr;
+        }
+    }
+}
+
+void OpenGLGraphicsManagerCommonBase::OpenGLFrameFence::Signal(
+    const uint32_t frame_index) {
+    auto& sync = m_Syncs[frame_index];
+    if (sync) {
+        glDeleteSync(static_cast<GLsync>(sync));
+    }
+
+    sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void OpenGLGraphicsManagerCommonBase::OpenGLFrameFence::Wait(
+    const uint32_t frame_index) {
+    auto& sync = m_Syncs[frame_index];
+    if (!sync) return;
+
+    // flush on the first try so the fence is sure to be signaled
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (true) {
+        const auto result = glClientWaitSync(static_cast<GLsync>(sync), flags,
+                                             1000000000);  // 1 second
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED ||
+            result == GL_WAIT_FAILED) {
+            break;
+        }
+        flags = 0;
+    }
+
+    glDeleteSync(static_cast<GLsync>(sync));
+    sync = nullptr;
 }
 
 void OpenGLGraphicsManagerCommonBase::initializeSkyBox(const Scene& scene) {
@@ -559,8 +788,11 @@ void OpenGLGraphicsManagerCommonBase::EndScene() {
         auto& batchContexts = m_Frames[i].batchContexts;
 
         for (auto& dbc : batchContexts) {
-            glDeleteVertexArrays(
-                1, &dynamic_pointer_cast<OpenGLDrawBatchContext>(dbc)->vao);
+            auto pDbc = dynamic_pointer_cast<OpenGLDrawBatchContext>(dbc);
+            glDeleteVertexArrays(1, &pDbc->vao);
+            for (auto& range : pDbc->lods) {
+                glDeleteVertexArrays(1, &range.vao);
+            }
         }
 
         batchContexts.clear();
@@ -570,16 +802,20 @@ void OpenGLGraphicsManagerCommonBase::EndScene() {
             m_uboDrawFrameConstant[i] = 0;
         }
 
-        if (m_uboDrawBatchConstant[i]) {
-            glDeleteBuffers(1, &m_uboDrawBatchConstant[i]);
-            m_uboDrawBatchConstant[i] = 0;
-        }
-
         if (m_uboLightInfo[i]) {
             glDeleteBuffers(1, &m_uboLightInfo[i]);
             m_uboLightInfo[i] = 0;
         }
 
+        for (auto* pBuffer :
+             {&m_ssboClusteredLights[i], &m_ssboLightClusters[i],
+              &m_ssboLightClusterIndices[i]}) {
+            if (*pBuffer) {
+                glDeleteBuffers(1, pBuffer);
+                *pBuffer = 0;
+            }
+        }
+
         if (m_uboShadowMatricesConstant[i]) {
             glDeleteBuffers(1, &m_uboShadowMatricesConstant[i]);
             m_uboShadowMatricesConstant[i] = 0;
@@ -597,6 +833,8 @@ void OpenGLGraphicsManagerCommonBase::EndScene() {
 
     m_Buffers.clear();
 
+    releaseBatchConstantBuffer();
+
     GraphicsManager::EndScene();
 }
 
@@ -604,10 +842,28 @@ void OpenGLGraphicsManagerCommonBase::BeginFrame(Frame& frame) {
     GraphicsManager::BeginFrame(frame);
 
     SetPerFrameConstants(frame.frameContext);
-    SetLightInfo(frame.lightInfo);
+    SetLightInfo(frame);
+
+    // without a persistent mapping the slice written by UpdateConstants is
+    // uploaded here
+    if (m_pBatchConstantAllocator && !m_bBatchConstantMapped) {
+        const auto offset =
+            m_pBatchConstantAllocator->GetSliceOffset(m_nFrameIndex);
+        const auto size = m_pBatchConstantAllocator->GetUsedSize();
+        if (size) {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawBatchConstant);
+            glBufferSubData(GL_UNIFORM_BUFFER, offset, size,
+                            m_BatchConstantStaging.data() + offset);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+    }
 }
 
 void OpenGLGraphicsManagerCommonBase::EndFrame(Frame& frame) {
+    if (m_pBatchConstantAllocator) {
+        m_pBatchConstantAllocator->EndFrame();
+    }
+
     m_nFrameIndex =
         ((m_nFrameIndex + 1) % GfxConfiguration::kMaxInFlightFrameCount);
 
@@ -618,6 +874,7 @@ void OpenGLGraphicsManagerCommonBase::SetPipelineState(
     const std::shared_ptr<PipelineState>& pipelineState, const Frame& frame) {
     const std::shared_ptr<const OpenGLPipelineState> pPipelineState =
         dynamic_pointer_cast<const OpenGLPipelineState>(pipelineState);
+    m_pCurrentPipelineState = pPipelineState;
     m_CurrentShader = pPipelineState->shaderProgram;
 
     // Set the color shader as the current shader program and set the matrices
@@ -686,81 +943,34 @@ void OpenGLGraphicsManagerCommonBase::SetPipelineState(
             assert(0);
     }
 
-    // Prepare & Bind per frame constant buffer
-    uint32_t blockIndex =
-        glGetUniformBlockIndex(m_CurrentShader, "PerFrameConstants");
-
-    if (blockIndex != GL_INVALID_INDEX) {
-        int32_t blockSize;
-
-        glGetActiveUniformBlockiv(m_CurrentShader, blockIndex,
-                                  GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
-
-        assert(blockSize >= sizeof(PerFrameConstants));
-
-        glUniformBlockBinding(m_CurrentShader, blockIndex, 10);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 10,
-                         m_uboDrawFrameConstant[frame.frameIndex]);
-    }
-
-    // Prepare per batch constant buffer binding point
-    blockIndex = glGetUniformBlockIndex(m_CurrentShader, "PerBatchConstants");
-
-    if (blockIndex != GL_INVALID_INDEX) {
-        int32_t blockSize;
-
-        glGetActiveUniformBlockiv(m_CurrentShader, blockIndex,
-                                  GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
-
-        assert(blockSize >= sizeof(PerBatchConstants));
-
-        glUniformBlockBinding(m_CurrentShader, blockIndex, 11);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 11,
-                         m_uboDrawBatchConstant[frame.frameIndex]);
-    }
-
-    // Prepare & Bind light info
-    blockIndex = glGetUniformBlockIndex(m_CurrentShader, "LightInfo");
-
-    if (blockIndex != GL_INVALID_INDEX) {
-        int32_t blockSize;
-
-        glGetActiveUniformBlockiv(m_CurrentShader, blockIndex,
-                                  GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
-
-        assert(blockSize >= sizeof(LightInfo));
-
-        glUniformBlockBinding(m_CurrentShader, blockIndex, 12);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 12,
-                         m_uboLightInfo[frame.frameIndex]);
+    // the blocks were bound to their binding points when the program was
+    // linked, only the buffers are left to bind
+    glBindBufferBase(GL_UNIFORM_BUFFER, kPerFrameConstantsBinding,
+                     m_uboDrawFrameConstant[frame.frameIndex]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kLightInfoBinding,
+                     m_uboLightInfo[frame.frameIndex]);
+
+    if (has_storage_buffers()) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kClusteredLightsBinding,
+                         m_ssboClusteredLights[frame.frameIndex]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLightClustersBinding,
+                         m_ssboLightClusters[frame.frameIndex]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLightClusterIndicesBinding,
+                         m_ssboLightClusterIndices[frame.frameIndex]);
     }
 
     if (pPipelineState->flag == PIPELINE_FLAG::SHADOW) {
-        uint32_t blockIndex =
-            glGetUniformBlockIndex(m_CurrentShader, "ShadowMapConstants");
-        assert(blockIndex != GL_INVALID_INDEX);
-
-        int32_t blockSize;
-
-        glGetActiveUniformBlockiv(m_CurrentShader, blockIndex,
-                                  GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
-
-        assert(blockSize >= sizeof(ShadowMapConstants));
-
-        glUniformBlockBinding(m_CurrentShader, blockIndex, 13);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 13,
+        glBindBufferBase(GL_UNIFORM_BUFFER, kShadowMapConstantsBinding,
                          m_uboShadowMatricesConstant[frame.frameIndex]);
     }
 
     // Set common textures
     // Bind LUT table
     auto texture_id = frame.brdfLUT.handler;
-    setShaderParameter("SPIRV_Cross_CombinedbrdfLUTsamp0", 6);
     glActiveTexture(GL_TEXTURE6);
     glBindTexture(GL_TEXTURE_2D, (GLuint)texture_id);
 
     // Set Sky Box
-    setShaderParameter("SPIRV_Cross_Combinedskyboxsamp0", 10);
     glActiveTexture(GL_TEXTURE10);
     GLenum target;
 #if defined(OS_WEBASSEMBLY)
@@ -776,84 +986,124 @@ void OpenGLGraphicsManagerCommonBase::SetPerFrameConstants(
     const DrawFrameContext& context) {
     if (!m_uboDrawFrameConstant[m_nFrameIndex]) {
         glGenBuffers(1, &m_uboDrawFrameConstant[m_nFrameIndex]);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawFrameConstant[m_nFrameIndex]);
+        glBufferData(GL_UNIFORM_BUFFER, kSizePerFrameConstantBuffer, nullptr,
+                     GL_DYNAMIC_DRAW);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawFrameConstant[m_nFrameIndex]);
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawFrameConstant[m_nFrameIndex]);
+    const auto& constants = static_cast<const PerFrameConstants&>(context);
 
-    auto constants = static_cast<PerFrameConstants>(context);
-
-    glBufferData(GL_UNIFORM_BUFFER, kSizePerFrameConstantBuffer, &constants,
-                 GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerFrameConstants),
+                    &constants);
 
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
-void OpenGLGraphicsManagerCommonBase::SetLightInfo(const LightInfo& lightInfo) {
+void OpenGLGraphicsManagerCommonBase::SetLightInfo(const Frame& frame) {
     if (!m_uboLightInfo[m_nFrameIndex]) {
         glGenBuffers(1, &m_uboLightInfo[m_nFrameIndex]);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_uboLightInfo[m_nFrameIndex]);
+        glBufferData(GL_UNIFORM_BUFFER, kSizeLightInfo, nullptr,
+                     GL_DYNAMIC_DRAW);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_uboLightInfo[m_nFrameIndex]);
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, m_uboLightInfo[m_nFrameIndex]);
-
-    glBufferData(GL_UNIFORM_BUFFER, kSizeLightInfo, &lightInfo,
-                 GL_DYNAMIC_DRAW);
+    // only the lights the shaders loop over
+    const auto count = static_cast<size_t>(frame.frameContext.numLights);
+    if (count) {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(Light),
+                        frame.lights.data());
+    }
 
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (has_storage_buffers()) {
+        upload_storage_buffer(m_ssboClusteredLights[m_nFrameIndex],
+                              frame.lights.data(),
+                              frame.lights.size() * sizeof(Light));
+        upload_storage_buffer(
+            m_ssboLightClusters[m_nFrameIndex], frame.lightClusters.data(),
+            frame.lightClusters.size() * sizeof(LightClusterRange));
+        upload_storage_buffer(
+            m_ssboLightClusterIndices[m_nFrameIndex],
+            frame.lightClusterIndices.data(),
+            frame.lightClusterIndices.size() * sizeof(uint32_t));
+    }
 }
 
-void OpenGLGraphicsManagerCommonBase::SetPerBatchConstants(
-    const DrawBatchContext& context) {
-    if (!m_uboDrawBatchConstant[m_nFrameIndex]) {
-        glGenBuffers(1, &m_uboDrawBatchConstant[m_nFrameIndex]);
+void OpenGLGraphicsManagerCommonBase::DrawBatch(
+    const Frame& frame, const std::vector<uint32_t>& batches) {
+    for (const auto i : batches) {
+        const auto& dbc = *frame.batchContexts[i];
+        // occlusion is computed from the camera, a hidden batch can still
+        // cast a shadow onto a visible one
+        if (dbc.occluded && !m_bDrawingShadowMap) continue;
+
+        drawBatch(dbc);
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, m_uboDrawBatchConstant[m_nFrameIndex]);
+    glBindVertexArray(0);
+}
 
-    const auto& constant = static_cast<const PerBatchConstants&>(context);
+void OpenGLGraphicsManagerCommonBase::drawBatch(
+    const DrawBatchContext& context) {
+    // the ring is created with the batches, without it there is no buffer
+    // to bind the per batch constants from
+    if (!m_pBatchConstantAllocator) return;
 
-    glBufferData(GL_UNIFORM_BUFFER, kSizePerBatchConstantBuffer, &constant,
-                 GL_DYNAMIC_DRAW);
+    // the per batch constants did not fit into the ring this frame
+    if (context.constantsOffset == DrawBatchContext::kInvalidConstantsOffset)
+        return;
 
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-}
+    glBindBufferRange(GL_UNIFORM_BUFFER, kPerBatchConstantsBinding,
+                      m_uboDrawBatchConstant, context.constantsOffset,
+                      sizeof(PerBatchConstants));
 
-void OpenGLGraphicsManagerCommonBase::DrawBatch(const Frame& frame) {
-    for (auto& pDbc : frame.batchContexts) {
-        SetPerBatchConstants(*pDbc);
+    const auto& dbc = dynamic_cast<const OpenGLDrawBatchContext&>(context);
 
-        const auto& dbc = dynamic_cast<const OpenGLDrawBatchContext&>(*pDbc);
+    // Bind textures
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, dbc.material.diffuseMap.handler);
 
-        // Bind textures
-        setShaderParameter("SPIRV_Cross_CombineddiffuseMapsamp0", 0);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, dbc.material.diffuseMap.handler);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, dbc.material.normalMap.handler);
 
-        setShaderParameter("SPIRV_Cross_CombinednormalMapsamp0", 1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, dbc.material.normalMap.handler);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, dbc.material.metallicMap.handler);
 
-        setShaderParameter("SPIRV_Cross_CombinedmetallicMapsamp0", 2);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, dbc.material.metallicMap.handler);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, dbc.material.roughnessMap.handler);
 
-        setShaderParameter("SPIRV_Cross_CombinedroughnessMapsamp0", 3);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, dbc.material.roughnessMap.handler);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, dbc.material.aoMap.handler);
 
-        setShaderParameter("SPIRV_Cross_CombinedaoMapsamp0", 4);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, dbc.material.aoMap.handler);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, dbc.material.heightMap.handler);
 
-        setShaderParameter("SPIRV_Cross_CombinedheightMapsamp0", 5);
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, dbc.material.heightMap.handler);
+    if (dbc.lod > 0 && dbc.lod <= dbc.lods.size()) {
+        const auto& range = dbc.lods[dbc.lod - 1];
+        glBindVertexArray(range.vao);
 
+        glDrawElements(dbc.mode, range.count, range.type, nullptr);
+    } else if (!dbc.meshlets.empty() && !m_bDrawingShadowMap) {
+        // only the clusters which survived culling, the shadow maps see
+        // the scene from the lights so they still need all of them
+        const size_t index_size = (dbc.type == GL_UNSIGNED_INT) ? 4 : 2;
+        glBindVertexArray(dbc.vao);
+
+        for (const auto& range : dbc.indexRanges) {
+            glDrawElements(
+                dbc.mode, static_cast<int32_t>(range.count), dbc.type,
+                reinterpret_cast<const void*>(range.offset * index_size));
+        }
+    } else {
         glBindVertexArray(dbc.vao);
 
         glDrawElements(dbc.mode, dbc.count, dbc.type, nullptr);
     }
-
-    glBindVertexArray(0);
 }
 
 void OpenGLGraphicsManagerCommonBase::GenerateCubemapArray(
@@ -913,13 +1163,15 @@ void OpenGLGraphicsManagerCommonBase::GenerateTextureArray(
 void OpenGLGraphicsManagerCommonBase::BeginShadowMap(
     const int32_t light_index, const TextureBase* pShadowmap,
     const int32_t layer_index, const Frame& frame) {
+    m_bDrawingShadowMap = true;
+
     // The framebuffer, which regroups 0, 1, or more textures, and 0 or 1 depth
     // buffer.
     glGenFramebuffers(1, &m_ShadowmapFramebuffer);
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_ShadowmapFramebuffer);
 
-    if (frame.lightInfo.lights[light_index].lightType == LightType::Omni) {
+    if (frame.lights[light_index].lightType == LightType::Omni) {
 #if defined(OS_WEBASSEMBLY)
         glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
                                   (uint32_t)pShadowmap->handler, 0,
@@ -949,7 +1201,7 @@ void OpenGLGraphicsManagerCommonBase::BeginShadowMap(
 
     // make sure omni light shadowmap arrays get cleared only
     // once, because glClear will clear all cubemaps in the array
-    if (frame.lightInfo.lights[light_index].lightType != LightType::Omni ||
+    if (frame.lights[light_index].lightType != LightType::Omni ||
         layer_index == 0) {
         glClear(GL_DEPTH_BUFFER_BIT);
     }
@@ -982,11 +1234,12 @@ void OpenGLGraphicsManagerCommonBase::EndShadowMap(
     glDeleteFramebuffers(1, &m_ShadowmapFramebuffer);
 
     glViewport(0, 0, m_canvasWidth, m_canvasHeight);
+
+    m_bDrawingShadowMap = false;
 }
 
 void OpenGLGraphicsManagerCommonBase::SetShadowMaps(const Frame& frame) {
     const float color[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    setShaderParameter("SPIRV_Cross_CombinedshadowMapsamp0", 7);
     glActiveTexture(GL_TEXTURE7);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -996,7 +1249,6 @@ void OpenGLGraphicsManagerCommonBase::SetShadowMaps(const Frame& frame) {
     auto texture_id = frame.frameContext.shadowMap.handler;
     glBindTexture(GL_TEXTURE_2D_ARRAY, (GLuint)texture_id);
 
-    setShaderParameter("SPIRV_Cross_CombinedglobalShadowMapsamp0", 8);
     glActiveTexture(GL_TEXTURE8);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -1006,7 +1258,6 @@ void OpenGLGraphicsManagerCommonBase::SetShadowMaps(const Frame& frame) {
     texture_id = frame.frameContext.globalShadowMap.handler;
     glBindTexture(GL_TEXTURE_2D_ARRAY, (GLuint)texture_id);
 
-    setShaderParameter("SPIRV_Cross_CombinedcubeShadowMapsamp0", 9);
     glActiveTexture(GL_TEXTURE9);
     GLenum target;
 #if defined(OS_WEBASSEMBLY)
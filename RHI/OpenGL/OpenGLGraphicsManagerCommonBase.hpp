@@ -5,18 +5,22 @@
 #include "GraphicsManager.hpp"
 #include "IApplication.hpp"
 #include "IPhysicsManager.hpp"
+#include "OpenGLPipelineStateManagerCommonBase.hpp"
 #include "SceneManager.hpp"
 #include "geommath.hpp"
 
 namespace My {
 class OpenGLGraphicsManagerCommonBase : public GraphicsManager {
    public:
+    OpenGLGraphicsManagerCommonBase() { m_bCullsOccludedBatches = true; }
+
     // overrides
     void Present() final;
 
     void SetPipelineState(const std::shared_ptr<PipelineState>& pipelineState,
                           const Frame& frame) final;
-    void DrawBatch(const Frame& frame) final;
+    void DrawBatch(const Frame& frame,
+                   const std::vector<uint32_t>& batches) final;
 
     void GenerateTexture(Texture2D& texture) final;
 
@@ -61,23 +65,32 @@ class OpenGLGraphicsManagerCommonBase : public GraphicsManager {
     void initializeGeometries(const Scene& scene) final;
     void initializeSkyBox(const Scene& scene) final;
 
+    void bindVertexBuffers(const SceneObjectMesh& mesh,
+                           std::vector<uint32_t>& buffers);
+
     void drawPoints(const Point* buffer, const size_t count,
                     const Matrix4X4f& trans, const Vector3f& color);
+    void drawBatch(const DrawBatchContext& context);
 
     void SetPerFrameConstants(const DrawFrameContext& context);
-    void SetPerBatchConstants(const DrawBatchContext& context);
-    void SetLightInfo(const LightInfo& lightInfo);
-
-    bool setShaderParameter(const char* paramName, const Matrix4X4f& param);
-    bool setShaderParameter(const char* paramName, const Matrix4X4f* param,
-                            const int32_t count);
-    bool setShaderParameter(const char* paramName, const Vector4f& param);
-    bool setShaderParameter(const char* paramName, const Vector3f& param);
-    bool setShaderParameter(const char* paramName, const Vector2f& param);
-    bool setShaderParameter(const char* paramName, const float param);
-    bool setShaderParameter(const char* paramName, const int32_t param);
-    bool setShaderParameter(const char* paramName, const uint32_t param);
-    bool setShaderParameter(const char* paramName, const bool param);
+    void createBatchConstantBuffer(const size_t batch_count);
+    void releaseBatchConstantBuffer();
+    void SetLightInfo(const Frame& frame);
+
+    // uniform locations come from the cache filled when the program of the
+    // current pipeline state was linked, the ids from FindShaderParameter
+    int32_t getUniformLocation(const ShaderParameterId id) const;
+    bool setShaderParameter(const ShaderParameterId id,
+                            const Matrix4X4f& param);
+    bool setShaderParameter(const ShaderParameterId id,
+                            const Matrix4X4f* param, const int32_t count);
+    bool setShaderParameter(const ShaderParameterId id, const Vector4f& param);
+    bool setShaderParameter(const ShaderParameterId id, const Vector3f& param);
+    bool setShaderParameter(const ShaderParameterId id, const Vector2f& param);
+    bool setShaderParameter(const ShaderParameterId id, const float param);
+    bool setShaderParameter(const ShaderParameterId id, const int32_t param);
+    bool setShaderParameter(const ShaderParameterId id, const uint32_t param);
+    bool setShaderParameter(const ShaderParameterId id, const bool param);
 
     virtual void getOpenGLTextureFormat(const Image& img, uint32_t& format,
                                         uint32_t& internal_format,
@@ -96,20 +109,54 @@ class OpenGLGraphicsManagerCommonBase : public GraphicsManager {
    private:
     uint32_t m_ShadowmapFramebuffer;
     uint32_t m_CurrentShader;
+    std::shared_ptr<const OpenGLPipelineState> m_pCurrentPipelineState;
+    bool m_bDrawingShadowMap{false};
     uint32_t m_uboDrawFrameConstant[GfxConfiguration::kMaxInFlightFrameCount] =
         {0};
     uint32_t m_uboLightInfo[GfxConfiguration::kMaxInFlightFrameCount] = {0};
-    uint32_t m_uboDrawBatchConstant[GfxConfiguration::kMaxInFlightFrameCount] =
+    uint32_t m_ssboClusteredLights[GfxConfiguration::kMaxInFlightFrameCount] =
         {0};
+    uint32_t m_ssboLightClusters[GfxConfiguration::kMaxInFlightFrameCount] =
+        {0};
+    uint32_t
+        m_ssboLightClusterIndices[GfxConfiguration::kMaxInFlightFrameCount] =
+            {0};
+
+    // fence sync objects guarding the slices of the batch constant buffer
+    class OpenGLFrameFence : _implements_ IFrameFence {
+       public:
+        ~OpenGLFrameFence() override;
+        void Signal(const uint32_t frame_index) final;
+        void Wait(const uint32_t frame_index) final;
+
+       private:
+        void* m_Syncs[GfxConfiguration::kMaxInFlightFrameCount] = {nullptr};
+    };
+
+    // one buffer holds the per batch constants of all the frames in flight,
+    // persistently mapped when the driver can do it. Otherwise the constants
+    // are written into m_BatchConstantStaging and uploaded in BeginFrame.
+    uint32_t m_uboDrawBatchConstant{0};
+    bool m_bBatchConstantMapped{false};
+    std::vector<uint8_t> m_BatchConstantStaging;
+    OpenGLFrameFence m_BatchConstantFence;
     uint32_t
         m_uboShadowMatricesConstant[GfxConfiguration::kMaxInFlightFrameCount] =
             {0};
 
+    struct OpenGLDrawRange {
+        uint32_t vao{0};
+        uint32_t type{0};
+        int32_t count{0};
+    };
+
     struct OpenGLDrawBatchContext : public DrawBatchContext {
         uint32_t vao{0};
         uint32_t mode{0};
         uint32_t type{0};
         int32_t count{0};
+        // LOD 1 and onwards
+        std::vector<OpenGLDrawRange> lods;
     };
 
     std::vector<uint32_t> m_Buffers;
@@ -4,6 +4,7 @@
 
 #define SHADER_ROOT "Shaders/OpenGL/"
 #define SHADER_SUFFIX ".glsl"
+#define SHADER_SPIRV_SUFFIX ".spv"
 
 #include "OpenGLPipelineStateManagerCommonBase.cpp"
 #include "glad/glad.h"
\ No newline at end of file
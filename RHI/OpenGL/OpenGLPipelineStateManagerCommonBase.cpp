@@ -3,6 +3,7 @@
 
 #include "AssetLoader.hpp"
 #include "GraphicsManager.hpp"
+#include "OpenGLPipelineStateManagerCommonBase.hpp"
 
 using namespace My;
 using namespace std;
@@ -91,27 +92,53 @@ static void OutputLinkerErrorMessage(unsigned int programId) {
          << endl;
 }
 
-static bool LoadShaderFromFile(const char* filename, const GLenum shaderType,
-                               GLuint& shader) {
-    std::string cbufferShaderBuffer;
-    std::string commonShaderBuffer;
-    std::string shaderBuffer;
-    int status;
+typedef vector<pair<GLenum, string>> ShaderSourceList;
+
+struct ShaderSource {
+    GLenum shaderType;
+    string filename;
+    string source;
+};
 
-    // Load the shader source file into a text buffer.
+static bool ReadShaderSources(const ShaderSourceList& list,
+                              const char* suffix, const bool binary,
+                              vector<ShaderSource>& sources) {
     AssetLoader assetLoader;
-    shaderBuffer = assetLoader.SyncOpenAndReadTextFileToString(filename);
-    if (shaderBuffer.empty()) {
-        return false;
+
+    for (const auto& [shaderType, name] : list) {
+        if (name.empty()) continue;
+
+        // Load the shader source, or its SPIR-V, into a buffer.
+        const string filename = SHADER_ROOT + name + suffix;
+        string shaderBuffer;
+        if (binary) {
+            const auto buffer =
+                assetLoader.SyncOpenAndReadBinary(filename.c_str());
+            shaderBuffer.assign(
+                reinterpret_cast<const char*>(buffer.GetData()),
+                buffer.GetDataSize());
+        } else {
+            shaderBuffer =
+                assetLoader.SyncOpenAndReadTextFileToString(filename.c_str());
+        }
+        if (shaderBuffer.empty()) {
+            return false;
+        }
+
+        sources.push_back({shaderType, filename, std::move(shaderBuffer)});
     }
 
-    shaderBuffer = cbufferShaderBuffer + commonShaderBuffer + shaderBuffer;
+    return true;
+}
+
+static bool CompileShader(const ShaderSource& source, GLuint& shader) {
+    int status;
 
     // Create a shader object.
-    shader = glCreateShader(shaderType);
+    shader = glCreateShader(source.shaderType);
 
     // Copy the shader source code strings into the shader objects.
-    const char* pStr = shaderBuffer.c_str();
+    const char* pStr = source.source.c_str();
     glShaderSource(shader, 1, &pStr, NULL);
 
     // Compile the shaders.
@@ -122,38 +149,77 @@ static bool LoadShaderFromFile(const char* filename, const GLenum shaderType,
     if (status != 1) {
         // If it did not compile then write the syntax error message out to a
         // text file for review.
-        OutputShaderErrorMessage(shader, filename);
+        OutputShaderErrorMessage(shader, source.filename.c_str());
         return false;
     }
 
     return true;
 }
 
-typedef vector<pair<GLenum, string>> ShaderSourceList;
+#if defined(SHADER_SPIRV_SUFFIX)
+// The SPIR-V is compiled from the generated GLSL at build time, so the
+// driver skips parsing it. Core from GL 4.6.
+static bool has_gl_spirv() {
+    return GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_gl_spirv;
+}
+
+static bool SpecializeShader(const ShaderSource& source, GLuint& shader) {
+    int status;
+
+    shader = glCreateShader(source.shaderType);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V,
+                   source.source.data(),
+                   static_cast<GLsizei>(source.source.size()));
 
-static bool LoadShaderProgram(const ShaderSourceList& source,
+    // glslang names the entry point of GLSL main
+    if (GLAD_GL_VERSION_4_6) {
+        glSpecializeShader(shader, "main", 0, nullptr, nullptr);
+    } else {
+        glSpecializeShaderARB(shader, "main", 0, nullptr, nullptr);
+    }
+
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != 1) {
+        OutputShaderErrorMessage(shader, source.filename.c_str());
+        return false;
+    }
+
+    return true;
+}
+#endif
+
+static bool LoadShaderProgram(const vector<ShaderSource>& sources,
+                              const bool spirv, const bool retrievable,
                               GLuint& shaderProgram) {
     int status;
 
     // Create a shader program object.
     shaderProgram = glCreateProgram();
 
-    for (auto it = source.cbegin(); it != source.cend(); it++) {
-        if (!it->second.empty()) {
-            GLuint shader;
-            status = LoadShaderFromFile(
-                (SHADER_ROOT + it->second + SHADER_SUFFIX).c_str(), it->first,
-                shader);
-            if (!status) {
-                return false;
-            }
-
-            // Attach the shader to the program object.
-            glAttachShader(shaderProgram, shader);
-            glDeleteShader(shader);
+    for (const auto& source : sources) {
+        GLuint shader;
+#if defined(SHADER_SPIRV_SUFFIX)
+        const bool compiled = spirv ? SpecializeShader(source, shader)
+                                    : CompileShader(source, shader);
+#else
+        const bool compiled = CompileShader(source, shader);
+#endif
+        if (!compiled) {
+            return false;
         }
+
+        // Attach the shader to the program object.
+        glAttachShader(shaderProgram, shader);
+        glDeleteShader(shader);
     }
 
+#if !defined(OS_WEBASSEMBLY)
+    if (retrievable) {
+        glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+    }
+#endif
+
     // Link the shader program.
     glLinkProgram(shaderProgram);
 
@@ -168,8 +234,136 @@ static bool LoadShaderProgram(const ShaderSourceList& source,
 
     return true;
 }
+
+#if !defined(OS_WEBASSEMBLY)
+// Creates the program from the binary the driver gave back when it was last
+// linked. The driver refuses binaries of another version of itself.
+static bool LoadShaderProgramBinary(PipelineStateCache& cache,
+                                    const uint64_t key,
+                                    GLuint& shaderProgram) {
+    uint32_t format;
+    vector<uint8_t> binary;
+    if (!cache.Load(key, format, binary)) {
+        return false;
+    }
+
+    shaderProgram = glCreateProgram();
+    glProgramBinary(shaderProgram, format, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+
+    int status;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
+    if (status != 1) {
+        glDeleteProgram(shaderProgram);
+        shaderProgram = 0;
+        cache.Remove(key);
+        return false;
+    }
+
+    return true;
+}
+
+static void StoreShaderProgramBinary(PipelineStateCache& cache,
+                                     const uint64_t key,
+                                     const GLuint shaderProgram) {
+    int length = 0;
+    glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    vector<uint8_t> binary(length);
+    GLenum format;
+    glGetProgramBinary(shaderProgram, length, &length, &format, binary.data());
+    cache.Store(key, format, binary.data(), length);
+}
+#endif
+
+// Looks up the uniforms of a linked program once, so that nothing has to be
+// queried by name while drawing. The uniform blocks are bound to the binding
+// points and the samplers to the texture units of the registers cbuffer.h
+// declares, as ShaderTool reflected them.
+static void ReflectShaderProgram(OpenGLPipelineState& state,
+                                 const ShaderReflection& reflection) {
+    const GLuint program = state.shaderProgram;
+
+    for (const auto& block : reflection.resources) {
+        if (block.type != ShaderResourceType::UniformBlock) continue;
+
+        const auto block_index =
+            glGetUniformBlockIndex(program, block.name.c_str());
+        if (block_index == GL_INVALID_INDEX) continue;
+
+        int32_t block_size;
+        glGetActiveUniformBlockiv(program, block_index,
+                                  GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
+        assert(block_size >= block.size);
+
+        glUniformBlockBinding(program, block_index, block.binding);
+    }
+
+    int32_t uniform_count = 0;
+    int32_t max_name_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+    vector<char> name_buffer(max_name_length + 1);
+
+    glUseProgram(program);
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(uniform_count); i++) {
+        int32_t block_index;
+        glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX,
+                              &block_index);
+        if (block_index != -1) continue;
+
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, (GLsizei)name_buffer.size(), &length,
+                           &size, &type, name_buffer.data());
+        const auto location = glGetUniformLocation(program, name_buffer.data());
+
+        // arrays are reported as "name[0]", they are set from their first
+        // element
+        string name(name_buffer.data(), length);
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.resize(name.size() - 3);
+        }
+
+        const auto id = InternShaderParameter(name);
+        if (state.uniformLocations.size() <= id) {
+            state.uniformLocations.resize(id + 1, -1);
+        }
+        state.uniformLocations[id] = location;
+
+        const auto* sampler =
+            reflection.Find(ShaderResourceType::CombinedSampler, name);
+        if (sampler) {
+            glUniform1i(location, sampler->binding);
+        }
+    }
+
+    glUseProgram(0);
+}
 }  // namespace My
 
+int OpenGLPipelineStateManagerCommonBase::Initialize() {
+#if !defined(OS_WEBASSEMBLY)
+    // program binaries are only worth keeping if the driver can reload them
+    GLint binary_format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_count);
+    const char* directory = m_pApp->GetConfiguration().pipelineCacheDirectory;
+    if (binary_format_count > 0 && directory && *directory) {
+        string device;
+        for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            device += reinterpret_cast<const char*>(glGetString(name));
+            device += '\n';
+        }
+        m_PipelineStateCache.Open(directory, device);
+    }
+#endif
+
+    return PipelineStateManager::Initialize();
+}
+
 bool OpenGLPipelineStateManagerCommonBase::InitializePipelineState(
     PipelineState** ppPipelineState) {
     bool result;
@@ -208,7 +402,55 @@ bool OpenGLPipelineStateManagerCommonBase::InitializePipelineState(
                           (*ppPipelineState)->tessEvaluateShaderName);
     }
 
-    result = LoadShaderProgram(list, pnew_state->shaderProgram);
+    // the precompiled SPIR-V when the driver takes it, the GLSL otherwise
+    vector<ShaderSource> sources;
+    bool spirv = false;
+#if defined(SHADER_SPIRV_SUFFIX)
+    if (has_gl_spirv()) {
+        spirv = ReadShaderSources(list, SHADER_SPIRV_SUFFIX, true, sources);
+        if (!spirv) sources.clear();
+    }
+#endif
+    result =
+        spirv || ReadShaderSources(list, SHADER_SUFFIX, false, sources);
+
+    ShaderReflection reflection;
+    for (const auto& [shaderType, name] : list) {
+        ShaderReflection stage;
+        result = result && LoadShaderReflection(name, stage);
+        reflection.Merge(stage);
+    }
+
+    if (result) {
+#if defined(OS_WEBASSEMBLY)
+        result = LoadShaderProgram(sources, spirv, false,
+                                   pnew_state->shaderProgram);
+#else
+        vector<PipelineShaderStage> stages;
+        for (const auto& source : sources) {
+            stages.push_back({source.shaderType, source.source.data(),
+                              source.source.size()});
+        }
+        const auto key = HashPipelineState(*pnew_state, stages);
+
+        if (!LoadShaderProgramBinary(m_PipelineStateCache, key,
+                                     pnew_state->shaderProgram)) {
+            const bool retrievable = m_PipelineStateCache.IsOpen();
+            result = LoadShaderProgram(sources, spirv, retrievable,
+                                       pnew_state->shaderProgram);
+            if (result && retrievable) {
+                StoreShaderProgramBinary(m_PipelineStateCache, key,
+                                         pnew_state->shaderProgram);
+            }
+        }
+#endif
+    }
+
+    // SPIR-V modules carry the bindings of cbuffer.h themselves, and GL
+    // does not look their resources up by name
+    if (result && !spirv) {
+        ReflectShaderProgram(*pnew_state, reflection);
+    }
 
     *ppPipelineState = pnew_state;
 
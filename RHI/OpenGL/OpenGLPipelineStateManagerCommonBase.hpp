@@ -1,11 +1,60 @@
 #pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "PipelineStateManager.hpp"
 
 namespace My {
+// every program binds its uniform blocks to these binding points
+constexpr uint32_t kPerFrameConstantsBinding = 10;
+constexpr uint32_t kPerBatchConstantsBinding = 11;
+constexpr uint32_t kLightInfoBinding = 12;
+constexpr uint32_t kShadowMapConstantsBinding = 13;
+// storage buffers of the clustered lighting, the t registers of cbuffer.h
+constexpr uint32_t kClusteredLightsBinding = 14;
+constexpr uint32_t kLightClustersBinding = 15;
+constexpr uint32_t kLightClusterIndicesBinding = 16;
+
+using ShaderParameterId = uint32_t;
+constexpr ShaderParameterId kInvalidShaderParameter = UINT32_MAX;
+
+inline std::unordered_map<std::string, ShaderParameterId>&
+shader_parameter_ids() {
+    static std::unordered_map<std::string, ShaderParameterId> ids;
+    return ids;
+}
+
+// Returns a small integer identifying a uniform name, shared by all the
+// programs. Called when a program is linked, from the rendering thread.
+inline ShaderParameterId InternShaderParameter(const std::string& name) {
+    auto& ids = shader_parameter_ids();
+    return ids.emplace(name, static_cast<ShaderParameterId>(ids.size()))
+        .first->second;
+}
+
+// The id of a uniform name, or kInvalidShaderParameter when no program
+// declares it. Resolve the ids once after the pipeline states are created
+// and pass them to setShaderParameter.
+inline ShaderParameterId FindShaderParameter(const std::string& name) {
+    const auto& ids = shader_parameter_ids();
+    const auto it = ids.find(name);
+    return (it == ids.end()) ? kInvalidShaderParameter : it->second;
+}
+
 struct OpenGLPipelineState : public PipelineState {
     uint32_t shaderProgram = 0;
+    // locations of the active uniforms outside of the uniform blocks,
+    // indexed by ShaderParameterId, filled when the program is linked from
+    // GLSL. Programs specialized from SPIR-V leave it empty.
+    std::vector<int32_t> uniformLocations;
+
     OpenGLPipelineState(PipelineState& rhs) : PipelineState(rhs) {}
     OpenGLPipelineState(PipelineState&& rhs) : PipelineState(std::move(rhs)) {}
+
+    [[nodiscard]] int32_t GetUniformLocation(const ShaderParameterId id) const {
+        return (id < uniformLocations.size()) ? uniformLocations[id] : -1;
+    }
 };
 
 class OpenGLPipelineStateManagerCommonBase : public PipelineStateManager {
@@ -13,6 +62,8 @@ class OpenGLPipelineStateManagerCommonBase : public PipelineStateManager {
     using PipelineStateManager::PipelineStateManager;
     virtual ~OpenGLPipelineStateManagerCommonBase() = default;
 
+    int Initialize() override;
+
    protected:
     bool InitializePipelineState(PipelineState** ppPipelineState) final;
     void DestroyPipelineState(PipelineState& pipelineState) final;
@@ -18,6 +18,9 @@
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// the pipeline cache keeps every pipeline, it is a single entry
+const uint64_t kPipelineCacheKey = 0;
+
 static std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
@@ -220,6 +223,14 @@ void VulkanRHI::destroyAll() {
     m_vkDevice.destroyCommandPool(m_vkCommandPool);
     m_vkDevice.destroyCommandPool(m_vkCommandPoolTransfer);
 
+    if (m_vkPipelineCache) {
+        const auto data = m_vkDevice.getPipelineCacheData(m_vkPipelineCache);
+        m_PipelineStateCache.Store(kPipelineCacheKey, 0, data.data(),
+                                   data.size());
+        m_PipelineStateCache.Close();
+        m_vkDevice.destroyPipelineCache(m_vkPipelineCache);
+    }
+
     m_vkDevice.destroy();  // 销毁逻辑设备
 
     if (enableValidationLayers) {
@@ -480,6 +491,30 @@ void VulkanRHI::createLogicalDevice() {
     m_vkDevice = m_vkPhysicalDevice.createDevice(createInfo);
 }
 
+void VulkanRHI::createPipelineCache(const std::string& directory) {
+    if (directory.empty()) return;
+
+    // the driver also checks the header of the data against itself, the
+    // device string spares handing it data of another GPU or driver
+    const auto properties = m_vkPhysicalDevice.getProperties();
+    std::string device = properties.deviceName;
+    device += ' ' + std::to_string(properties.vendorID) + ' ' +
+              std::to_string(properties.deviceID) + ' ' +
+              std::to_string(properties.driverVersion) + ' ';
+    device.append(reinterpret_cast<const char*>(
+                      properties.pipelineCacheUUID.data()),
+                  VK_UUID_SIZE);
+
+    std::vector<uint8_t> data;
+    if (m_PipelineStateCache.Open(directory, device)) {
+        uint32_t format;
+        m_PipelineStateCache.Load(kPipelineCacheKey, format, data);
+    }
+
+    vk::PipelineCacheCreateInfo createInfo({}, data.size(), data.data());
+    m_vkPipelineCache = m_vkDevice.createPipelineCache(createInfo);
+}
+
 static const vk::SurfaceFormatKHR& chooseSwapSurfaceFormat(
     const std::vector<vk::SurfaceFormatKHR>& availableFormats) {
     for (const auto& availableFormat : availableFormats) {
@@ -796,7 +831,7 @@ void VulkanRHI::createGraphicsPipeline() {
 
     vk::Result result;
     std::tie(result, m_vkGraphicPipeline) =
-        m_vkDevice.createGraphicsPipeline(nullptr, pipelineInfo);
+        m_vkDevice.createGraphicsPipeline(m_vkPipelineCache, pipelineInfo);
 
     switch (result) {
         case vk::Result::eSuccess:
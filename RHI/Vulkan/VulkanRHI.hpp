@@ -7,6 +7,7 @@
 #include <vulkan/vulkan.hpp>
 #include "Buffer.hpp"
 #include "Image.hpp"
+#include "PipelineStateCache.hpp"
 #include "geommath.hpp"
 
 namespace My {
@@ -67,6 +68,9 @@ class VulkanRHI {
     void createSurface(const CreateSurfaceFunc& func);
     void pickPhysicalDevice();
     void createLogicalDevice();
+    // seeds the pipeline cache with what the driver compiled in the last
+    // run, left empty without a directory
+    void createPipelineCache(const std::string& directory);
     void createSwapChain();
     void createImageViews();
     void getDeviceQueues();
@@ -117,6 +121,8 @@ class VulkanRHI {
 
     vk::RenderPass m_vkRenderPass;
     vk::Pipeline m_vkGraphicPipeline;
+    vk::PipelineCache m_vkPipelineCache;
+    PipelineStateCache m_PipelineStateCache;
     vk::DescriptorSetLayout m_vkDescriptorSetLayout;
     vk::PipelineLayout m_vkPipelineLayout;
 
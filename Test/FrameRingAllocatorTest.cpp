@@ -0,0 +1,142 @@
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "FrameRingAllocator.hpp"
+
+using namespace My;
+using namespace std;
+
+// Stands in for a GPU which reads the slice of a frame once it is
+// submitted. IsIntact checks nothing written after the submit has
+// clobbered it. The allocator signaling the fence is bound after it is
+// constructed, as it takes the fence.
+class FakeFrameFence : _implements_ IFrameFence {
+   public:
+    explicit FakeFrameFence(const uint8_t* memory) : m_pMemory(memory) {}
+
+    void SetAllocator(const FrameRingAllocator* pAllocator) {
+        m_pAllocator = pAllocator;
+    }
+
+    void Signal(const uint32_t frame_index) final {
+        const auto offset = m_pAllocator->GetSliceOffset(frame_index);
+        m_Submitted.assign(m_pMemory + offset,
+                           m_pMemory + offset + m_pAllocator->GetUsedSize());
+        m_nSubmittedFrame = frame_index;
+        m_nSignalCount++;
+    }
+
+    void Wait(const uint32_t frame_index) final {
+        m_nWaitCount++;
+        m_nLastWaited = frame_index;
+    }
+
+    [[nodiscard]] uint32_t GetSignalCount() const { return m_nSignalCount; }
+    [[nodiscard]] uint32_t GetWaitCount() const { return m_nWaitCount; }
+    [[nodiscard]] uint32_t GetLastWaited() const { return m_nLastWaited; }
+    [[nodiscard]] size_t GetSubmittedSize() const { return m_Submitted.size(); }
+
+    // what the GPU would see for the last submitted frame, now
+    [[nodiscard]] bool IsIntact() const {
+        const auto offset = m_pAllocator->GetSliceOffset(m_nSubmittedFrame);
+        return memcmp(m_Submitted.data(), m_pMemory + offset,
+                      m_Submitted.size()) == 0;
+    }
+
+   private:
+    const uint8_t* m_pMemory;
+    const FrameRingAllocator* m_pAllocator{nullptr};
+    vector<uint8_t> m_Submitted;
+    uint32_t m_nSubmittedFrame{0};
+    uint32_t m_nSignalCount{0};
+    uint32_t m_nWaitCount{0};
+    uint32_t m_nLastWaited{0};
+};
+
+int main(int argc, char** argv) {
+    const uint32_t frame_count = 2;
+    const size_t alignment = 256;
+    const size_t constant_size = 64;
+    const size_t batch_count = 10;
+
+    vector<uint8_t> buffer(alignment * batch_count * frame_count + 100);
+
+    FrameRingAllocator allocator(buffer.data(), buffer.size(), frame_count,
+                                 alignment);
+    FakeFrameFence fence(buffer.data());
+    FrameRingAllocator fenced(buffer.data(), buffer.size(), frame_count,
+                              alignment, &fence);
+    fence.SetAllocator(&fenced);
+
+    // the remainder is dropped so every slice stays aligned
+    assert(fenced.GetSliceSize() == alignment * batch_count);
+    cout << "slice size " << fenced.GetSliceSize() << endl;
+
+    for (uint32_t n = 0; n < 8; n++) {
+        const uint32_t frame_index = n % frame_count;
+        fenced.BeginFrame(frame_index);
+
+        // a frame index is only waited on once it has been submitted
+        if (n < frame_count) {
+            assert(fence.GetWaitCount() == 0);
+        } else {
+            assert(fence.GetWaitCount() == n - frame_count + 1);
+            assert(fence.GetLastWaited() == frame_index);
+        }
+
+        const auto slice_begin = fenced.GetSliceOffset(frame_index);
+        const auto slice_end = slice_begin + fenced.GetSliceSize();
+
+        for (size_t i = 0; i < batch_count; i++) {
+            const auto allocation = fenced.Allocate(constant_size);
+            assert(allocation.data);
+            assert(allocation.offset % alignment == 0);
+            assert(allocation.offset >= slice_begin);
+            assert(allocation.offset + constant_size <= slice_end);
+            assert(allocation.data == buffer.data() + allocation.offset);
+
+            memset(allocation.data, static_cast<int>(n + 1), constant_size);
+        }
+
+        // the frame still in flight is left alone
+        if (n > 0) {
+            assert(fence.IsIntact());
+        }
+
+        // the slice is full
+        assert(fenced.GetAvailableSize() == 0);
+        assert(!fenced.Allocate(constant_size).data);
+        assert(fenced.GetUsedSize() ==
+               alignment * (batch_count - 1) + constant_size);
+
+        fenced.EndFrame();
+        assert(fence.GetSignalCount() == n + 1);
+        // the whole frame is watched, not an empty range
+        assert(fence.GetSubmittedSize() == fenced.GetUsedSize());
+    }
+
+    // every allocation starts on the alignment, however small
+    allocator.BeginFrame(1);
+    assert(allocator.GetAvailableSize() == allocator.GetSliceSize());
+    const auto a = allocator.Allocate(16);
+    const auto b = allocator.Allocate(16);
+    assert(a.offset == allocator.GetSliceOffset(1));
+    assert(b.offset == a.offset + alignment);
+    // the next allocation would start on the alignment too
+    assert(allocator.GetAvailableSize() ==
+           allocator.GetSliceSize() - 2 * alignment);
+    assert(!allocator.Allocate(allocator.GetSliceSize()).data);
+    allocator.EndFrame();
+
+    // a new frame starts from the beginning of its slice
+    allocator.BeginFrame(1);
+    assert(allocator.GetUsedSize() == 0);
+    assert(allocator.Allocate(allocator.GetSliceSize()).data);
+    allocator.EndFrame();
+
+    cout << "done" << endl;
+
+    return 0;
+}
@@ -215,6 +215,131 @@ void matrix_test() {
 
     Matrix8X8f pixel_error = pixel_block_reconstructed - pixel_block;
     cout << "DCT-IDCT error: " << pixel_error;
+
+    // strided copy into a constant buffer, one 64 float slot per matrix
+    const size_t slot = 64;
+    Matrix4X4f sources[3];
+    const float* source_ptrs[3];
+    for (size_t i = 0; i < 3; i++) {
+        MatrixTranslation(sources[i], (float)i, 2.0f * i, 3.0f * i);
+        source_ptrs[i] = sources[i];
+    }
+    alignas(16) float constants[slot * 3] = {};
+    CopyMatrices4X4f(source_ptrs, constants, slot, 3);
+    for (size_t i = 0; i < 3; i++) {
+        const float* matrix = sources[i];
+        for (size_t j = 0; j < 16; j++) {
+            assert(constants[i * slot + j] == matrix[j]);
+        }
+        for (size_t j = 16; j < slot; j++) {
+            assert(constants[i * slot + j] == 0.0f);
+        }
+    }
+    cout << "CopyMatrices4X4f copies into strided slots." << endl;
+}
+
+void cascade_test() {
+    const int32_t count = 4;
+    const float near_plane = 0.5f;
+    const float far_plane = 500.0f;
+    float splits[count + 1];
+
+    // uniform and logarithmic splits
+    SplitCascades(splits, count, near_plane, far_plane, 0.0f);
+    for (int32_t i = 0; i <= count; i++) {
+        assert(abs(splits[i] - (near_plane + (far_plane - near_plane) * i /
+                                                 count)) < 1e-3f);
+    }
+    SplitCascades(splits, count, near_plane, far_plane, 1.0f);
+    for (int32_t i = 1; i < count; i++) {
+        assert(abs(splits[i] / splits[i - 1] - splits[i + 1] / splits[i]) <
+               1e-3f);
+    }
+
+    // practical splits stay in between
+    SplitCascades(splits, count, near_plane, far_plane, 0.75f);
+    cout << "Cascade splits:";
+    for (int32_t i = 0; i <= count; i++) {
+        cout << " " << splits[i];
+    }
+    cout << endl;
+    assert(abs(splits[0] - near_plane) < 1e-4f);
+    assert(abs(splits[count] - far_plane) < 1e-2f);
+    for (int32_t i = 1; i <= count; i++) {
+        assert(splits[i] > splits[i - 1]);
+    }
+
+    // the spheres hold the corners of their slices
+    const float tan_half_fov_x = 0.7f;
+    const float tan_half_fov_y = 0.4f;
+    float depths[count];
+    float radii[count];
+    FitCascadeSpheres(splits, count, tan_half_fov_x, tan_half_fov_y, depths,
+                      radii);
+    for (int32_t i = 0; i < count; i++) {
+        for (const float d : {splits[i], splits[i + 1]}) {
+            const float x = d * tan_half_fov_x;
+            const float y = d * tan_half_fov_y;
+            const float z = d - depths[i];
+            assert(sqrt(x * x + y * y + z * z) <= radii[i] * 1.0001f);
+        }
+    }
+
+    // the cascades bound their slices, and a point of the world stays at
+    // the same place within the texels as the camera moves
+    const uint32_t resolution = 2048;
+    Vector3f light_direction = {0.3f, -0.2f, -1.0f};
+    Normalize(light_direction);
+    Vector3f forward = {0.0f, 1.0f, 0.0f};
+    const Vector4f point = {12.3f, 45.6f, 7.8f, 1.0f};
+
+    Matrix4X4f view;
+    Matrix4X4f projections[count];
+    float texel_phase[count][2];
+    float scale[count];
+
+    for (int32_t n = 0; n < 50; n++) {
+        const Vector3f position = {0.37f * n, 0.11f * n, 0.05f * n};
+        BuildShadowCascades(view, projections, splits, count, position,
+                            forward, tan_half_fov_x, tan_half_fov_y,
+                            light_direction, resolution, 100.0f, false);
+
+        for (int32_t i = 0; i < count; i++) {
+            // a far corner, the camera turns around the z axis
+            const float d = splits[i + 1];
+            const Vector4f corner = {
+                position[0] + forward[0] * d + forward[1] * d * tan_half_fov_x,
+                position[1] + forward[1] * d - forward[0] * d * tan_half_fov_x,
+                position[2] + d * tan_half_fov_y, 1.0f};
+            Vector4f v = corner;
+            Transform(v, view * projections[i]);
+            assert(abs(v[0]) <= 1.0f && abs(v[1]) <= 1.0f);
+            assert(v[2] >= 0.0f && v[2] <= 1.0f);
+
+            v = point;
+            Transform(v, view * projections[i]);
+            for (int32_t axis = 0; axis < 2; axis++) {
+                const float texel = (v[axis] * 0.5f + 0.5f) * resolution;
+                const float phase = texel - floor(texel);
+                if (n == 0) {
+                    texel_phase[i][axis] = phase;
+                } else {
+                    const float drift = abs(phase - texel_phase[i][axis]);
+                    assert(drift < 0.02f || drift > 0.98f);
+                }
+            }
+
+            // turning the camera keeps the size of the cascades
+            if (n == 0) {
+                scale[i] = projections[i][0][0];
+            } else {
+                assert(projections[i][0][0] == scale[i]);
+            }
+        }
+
+        forward = {sin(0.1f * n), cos(0.1f * n), 0.0f};
+    }
+    cout << "Cascades are snapped to the texels" << endl;
 }
 
 int main() {
@@ -222,6 +347,7 @@ int main() {
 
     vector_test();
     matrix_test();
+    cascade_test();
 
     return 0;
 }
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HDR.hpp"
+
+using namespace My;
+using namespace std;
+
+// value of a non-negative half
+static double half_value(const uint16_t bits) {
+    const int exponent = bits >> 10;
+    const int mantissa = bits & 0x3FF;
+    if (!exponent) return ldexp((double)mantissa, -24);
+    return ldexp((double)(mantissa + 1024), exponent - 25);
+}
+
+// the nearest finite half, ties to even, 65520 and above to infinity
+static uint16_t reference_half(const float value) {
+    static vector<double> halves;
+    if (halves.empty()) {
+        for (uint16_t bits = 0; bits < 0x7C00; bits++) {
+            halves.push_back(half_value(bits));
+        }
+    }
+
+    if (value >= 65520.0f) return 0x7C00;
+    const auto upper = lower_bound(halves.begin(), halves.end(), (double)value);
+    auto bits = static_cast<uint16_t>(upper - halves.begin());
+    if (bits && *upper != value) {
+        const double below = value - halves[bits - 1];
+        const double above = *upper - value;
+        if (below < above || (below == above && ((bits - 1) & 1) == 0)) {
+            bits--;
+        }
+    }
+    return bits;
+}
+
+// every mantissa with every exponent
+static int test_conversion() {
+    const int32_t count = 256 * 256 - 3;  // leaves a tail after the SIMD
+    vector<uint8_t> r(count), g(count), b(count), e(count);
+    for (int32_t i = 0; i < count; i++) {
+        r[i] = static_cast<uint8_t>(i & 0xFF);
+        g[i] = static_cast<uint8_t>(255 - (i & 0xFF));
+        b[i] = static_cast<uint8_t>((i & 0xFF) ^ 0x5A);
+        e[i] = static_cast<uint8_t>(i >> 8);
+    }
+
+    vector<float> rgb(count * 3);
+    vector<uint16_t> rgba(count * 4);
+    ConvertRGBE2RGBf(r.data(), g.data(), b.data(), e.data(), rgb.data(),
+                     count);
+    ConvertRGBE2RGBAh(r.data(), g.data(), b.data(), e.data(), rgba.data(),
+                      count);
+
+    int mismatches = 0;
+    for (int32_t i = 0; i < count; i++) {
+        const unsigned char rgbe[4] = {r[i], g[i], b[i], e[i]};
+        float expected[3];
+        rgbe2float(expected, rgbe);
+        if (memcmp(expected, &rgb[i * 3], sizeof(expected))) mismatches++;
+        for (int k = 0; k < 3; k++) {
+            if (rgba[i * 4 + k] != reference_half(expected[k])) mismatches++;
+        }
+        if (rgba[i * 4 + 3] != 0x3C00) mismatches++;
+    }
+
+    cout << count << " RGBE pixels converted, " << mismatches
+         << " mismatches" << endl;
+    return mismatches;
+}
+
+// new-style run length encoding of a scanline, a plane at a time
+static void encode_scanline(const vector<uint8_t>& pixels, const uint32_t width,
+                            string& out) {
+    out += static_cast<char>(2);
+    out += static_cast<char>(2);
+    out += static_cast<char>(width >> 8);
+    out += static_cast<char>(width & 0xFF);
+    for (uint32_t k = 0; k < 4; k++) {
+        uint32_t x = 0;
+        while (x < width) {
+            uint32_t run = 1;
+            while (x + run < width && run < 127 &&
+                   pixels[(x + run) * 4 + k] == pixels[x * 4 + k]) {
+                run++;
+            }
+            if (run >= 3) {
+                out += static_cast<char>(128 + run);
+                out += static_cast<char>(pixels[x * 4 + k]);
+                x += run;
+                continue;
+            }
+
+            // literals up to the next run of 3
+            uint32_t count = 0;
+            while (x + count < width && count < 128) {
+                if (x + count + 2 < width &&
+                    pixels[(x + count) * 4 + k] ==
+                        pixels[(x + count + 1) * 4 + k] &&
+                    pixels[(x + count) * 4 + k] ==
+                        pixels[(x + count + 2) * 4 + k]) {
+                    break;
+                }
+                count++;
+            }
+            out += static_cast<char>(count);
+            for (uint32_t i = 0; i < count; i++) {
+                out += static_cast<char>(pixels[(x + i) * 4 + k]);
+            }
+            x += count;
+        }
+    }
+}
+
+// the first `encoded_rows` scanlines run length encoded, the rest flat
+static bool test_parser(const uint32_t width, const uint32_t height,
+                        const uint32_t encoded_rows, mt19937& generator) {
+    uniform_int_distribution<int> byte(0, 255);
+    uniform_int_distribution<int> exponent(112, 144);
+    vector<uint8_t> pixels((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        // runs of equal pixels, and some black ones
+        if (i % width && byte(generator) < 96) {
+            memcpy(&pixels[i * 4], &pixels[(i - 1) * 4], 4);
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            pixels[i * 4 + k] = static_cast<uint8_t>(byte(generator));
+        }
+        pixels[i * 4 + 3] =
+            byte(generator) < 8 ? 0 : static_cast<uint8_t>(exponent(generator));
+    }
+
+    string file = "#?RADIANCE\n# test image\nFORMAT=32-bit_rle_rgbe\n\n";
+    file += "-Y " + to_string(height) + " +X " + to_string(width) + "\n";
+    for (uint32_t y = 0; y < height; y++) {
+        if (y < encoded_rows) {
+            vector<uint8_t> row(pixels.begin() + (size_t)y * width * 4,
+                                pixels.begin() + (size_t)(y + 1) * width * 4);
+            encode_scanline(row, width, file);
+        } else {
+            file.append(reinterpret_cast<const char*>(&pixels[y * width * 4]),
+                        (size_t)width * 4);
+        }
+    }
+
+    bool match = true;
+    for (const bool half_float : {false, true}) {
+        Buffer buf(file.size());
+        memcpy(buf.GetData(), file.data(), file.size());
+        HdrParser parser(half_float);
+        Image image = parser.Parse(buf);
+        match &= image.Width == width && image.Height == height;
+        match &= image.pixel_format ==
+                 (half_float ? PIXEL_FORMAT::RGBA16 : PIXEL_FORMAT::RGB32);
+
+        for (uint32_t y = 0; match && y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                float expected[3];
+                rgbe2float(expected, &pixels[((size_t)y * width + x) * 4]);
+                const uint8_t* p = image.data + image.pitch * y;
+                if (half_float) {
+                    const auto* rgba = reinterpret_cast<const uint16_t*>(p);
+                    for (int k = 0; k < 3; k++) {
+                        match &= rgba[x * 4 + k] == reference_half(expected[k]);
+                    }
+                } else {
+                    match &= !memcmp(p + x * 12, expected, sizeof(expected));
+                }
+            }
+        }
+    }
+
+    cout << width << "x" << height << " with " << encoded_rows
+         << " encoded scanlines: " << (match ? "ok" : "mismatch") << endl;
+    return match;
+}
+
+int main() {
+    mt19937 generator(45);
+
+    int result = test_conversion() ? 1 : 0;
+
+    if (!test_parser(97, 300, 300, generator)) result = 1;
+    if (!test_parser(64, 200, 120, generator)) result = 1;
+    if (!test_parser(300, 130, 0, generator)) result = 1;
+    // run length encoding is not allowed below 8 pixels
+    if (!test_parser(5, 70, 0, generator)) result = 1;
+
+    return result;
+}
@@ -0,0 +1,116 @@
+#include <cassert>
+#include <iostream>
+#include <limits>
+
+#include "HiZBuffer.hpp"
+
+using namespace My;
+using namespace std;
+
+// a 4x4 quad facing the camera at y = -2
+const float quad_positions[] = {-2.0f, -2.0f, -2.0f, 2.0f,  -2.0f, -2.0f,
+                                2.0f,  -2.0f, 2.0f,  -2.0f, -2.0f, 2.0f};
+const uint16_t quad_indices[] = {0, 1, 2, 0, 2, 3};
+
+Matrix4X4f view_projection() {
+    Matrix4X4f view, projection;
+    BuildViewRHMatrix(view, Vector3f({0.0f, -10.0f, 0.0f}),
+                      Vector3f({0.0f, 0.0f, 0.0f}),
+                      Vector3f({0.0f, 0.0f, 1.0f}));
+    BuildPerspectiveFovRHMatrix(projection, PI / 4.0f, 2.0f, 0.1f, 100.0f);
+    return view * projection;
+}
+
+bool box_visible(const HiZBuffer& buffer, const Matrix4X4f& mvp,
+                 const Vector3f& bbmin, const Vector3f& bbmax) {
+    const bool visible = buffer.IsVisible(bbmin, bbmax, mvp);
+    cout << "Box centered at (" << (bbmin[0] + bbmax[0]) * 0.5f << ", "
+         << (bbmin[1] + bbmax[1]) * 0.5f << ", "
+         << (bbmin[2] + bbmax[2]) * 0.5f
+         << "): " << (visible ? "visible" : "occluded") << endl;
+    return visible;
+}
+
+void pyramid_test(const HiZBuffer& buffer) {
+    // every texel keeps the farthest depth of the texels it covers
+    for (size_t level = 1; level < buffer.GetLevelCount(); level++) {
+        const uint32_t width = buffer.GetWidth() >> level;
+        const uint32_t height = buffer.GetHeight() >> level;
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                const float d = buffer.GetDepth(level, x, y);
+                for (uint32_t k = 0; k < 4; k++) {
+                    assert(d >= buffer.GetDepth(level - 1, x * 2 + (k & 1),
+                                                y * 2 + (k >> 1)));
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const Matrix4X4f mvp = view_projection();
+
+    HiZBuffer buffer;
+    cout << "HiZ buffer " << buffer.GetWidth() << "x" << buffer.GetHeight()
+         << ", " << buffer.GetLevelCount() << " levels" << endl;
+    assert(buffer.GetLevelCount() == 9);
+
+    // nothing is occluded by an empty buffer
+    buffer.Rasterize();
+    assert(box_visible(buffer, mvp, Vector3f({-0.5f, 0.0f, -0.5f}),
+                       Vector3f({0.5f, 1.0f, 0.5f})));
+
+    buffer.AddOccluder(quad_positions, 3, quad_indices, 6, mvp);
+    buffer.Rasterize();
+    assert(buffer.GetTriangleCount() == 2);
+
+    // the center of the quad is written, the corners of the screen are not
+    const float center = buffer.GetDepth(0, buffer.GetWidth() / 2,
+                                         buffer.GetHeight() / 2);
+    assert(center < 1.0f);
+    assert(buffer.GetDepth(0, 0, 0) == numeric_limits<float>::max());
+    pyramid_test(buffer);
+
+    // behind the quad
+    assert(!box_visible(buffer, mvp, Vector3f({-0.5f, 0.0f, -0.5f}),
+                        Vector3f({0.5f, 1.0f, 0.5f})));
+    assert(!box_visible(buffer, mvp, Vector3f({-1.0f, 5.0f, -1.0f}),
+                        Vector3f({1.0f, 20.0f, 1.0f})));
+
+    // beside the quad
+    assert(box_visible(buffer, mvp, Vector3f({4.0f, 0.0f, -0.5f}),
+                       Vector3f({5.0f, 1.0f, 0.5f})));
+
+    // sticking out of the quad silhouette
+    assert(box_visible(buffer, mvp, Vector3f({1.5f, 0.0f, -0.5f}),
+                       Vector3f({2.5f, 1.0f, 0.5f})));
+
+    // in front of the quad
+    assert(box_visible(buffer, mvp, Vector3f({-0.5f, -4.0f, -0.5f}),
+                       Vector3f({0.5f, -3.0f, 0.5f})));
+
+    // crossing the quad
+    assert(box_visible(buffer, mvp, Vector3f({-0.5f, -2.5f, -0.5f}),
+                       Vector3f({0.5f, 0.0f, 0.5f})));
+
+    // behind the camera
+    assert(box_visible(buffer, mvp, Vector3f({-0.5f, -11.0f, -0.5f}),
+                       Vector3f({0.5f, -9.0f, 0.5f})));
+
+    // outside of the screen
+    assert(!box_visible(buffer, mvp, Vector3f({40.0f, 0.0f, -0.5f}),
+                        Vector3f({41.0f, 1.0f, 0.5f})));
+
+    // the same occluder with 32 bit indices and the other winding
+    const uint32_t flipped_indices[] = {0, 2, 1, 0, 3, 2};
+    buffer.Clear();
+    buffer.AddOccluder(quad_positions, 3, flipped_indices, 6, mvp);
+    buffer.Rasterize();
+    assert(buffer.GetDepth(0, buffer.GetWidth() / 2,
+                           buffer.GetHeight() / 2) == center);
+    assert(!box_visible(buffer, mvp, Vector3f({-0.5f, 0.0f, -0.5f}),
+                        Vector3f({0.5f, 1.0f, 0.5f})));
+
+    return 0;
+}
@@ -0,0 +1,605 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "JPEG.hpp"
+
+using namespace My;
+using namespace std;
+
+// JPEG files written by libjpeg, compared with the pixels libjpeg decodes
+// from them up to the rounding of the IDCT and of the chroma upsampling
+
+// 24x16, 4:2:0, spectral selection and successive approximation scans
+const uint8_t kProgressiveJpeg[] = {
+    0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01,
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43,
+    0x00, 0x05, 0x03, 0x04, 0x04, 0x04, 0x03, 0x05, 0x04, 0x04, 0x04, 0x05,
+    0x05, 0x05, 0x06, 0x07, 0x0c, 0x08, 0x07, 0x07, 0x07, 0x07, 0x0f, 0x0b,
+    0x0b, 0x09, 0x0c, 0x11, 0x0f, 0x12, 0x12, 0x11, 0x0f, 0x11, 0x11, 0x13,
+    0x16, 0x1c, 0x17, 0x13, 0x14, 0x1a, 0x15, 0x11, 0x11, 0x18, 0x21, 0x18,
+    0x1a, 0x1d, 0x1d, 0x1f, 0x1f, 0x1f, 0x13, 0x17, 0x22, 0x24, 0x22, 0x1e,
+    0x24, 0x1c, 0x1e, 0x1f, 0x1e, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x05, 0x05,
+    0x05, 0x07, 0x06, 0x07, 0x0e, 0x08, 0x08, 0x0e, 0x1e, 0x14, 0x11, 0x14,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0xff, 0xc2, 0x00, 0x11, 0x08, 0x00, 0x10, 0x00, 0x18, 0x03,
+    0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01, 0xff, 0xc4, 0x00,
+    0x17, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x02, 0x06, 0xff, 0xc4,
+    0x00, 0x16, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x03, 0x04, 0xff, 0xda,
+    0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x10, 0x03, 0x10, 0x00, 0x00, 0x01,
+    0x9d, 0xab, 0xcc, 0x88, 0xf8, 0x05, 0xe5, 0x44, 0xff, 0x00, 0xff, 0xc4,
+    0x00, 0x1a, 0x10, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x01, 0x00, 0x11, 0x02,
+    0x12, 0x21, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x05, 0x02,
+    0x01, 0xb3, 0x1c, 0xb7, 0x18, 0xb0, 0x78, 0x76, 0x8c, 0x5a, 0x8c, 0x5e,
+    0xff, 0x00, 0xff, 0xc4, 0x00, 0x19, 0x11, 0x00, 0x02, 0x03, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x04, 0x01, 0x02, 0x23, 0x24, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03, 0x01,
+    0x01, 0x3f, 0x01, 0xab, 0x9c, 0xe3, 0x2e, 0x69, 0x27, 0xff, 0xc4, 0x00,
+    0x1a, 0x11, 0x00, 0x01, 0x05, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x02, 0x03, 0x04, 0x22,
+    0x51, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01, 0x3f, 0x01, 0x92,
+    0xc3, 0x06, 0x63, 0x38, 0xea, 0x16, 0x57, 0xff, 0xc4, 0x00, 0x17, 0x10,
+    0x00, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x10, 0x11, 0x21, 0xff, 0xda, 0x00, 0x08,
+    0x01, 0x01, 0x00, 0x06, 0x3f, 0x02, 0xd0, 0xe4, 0x7f, 0xff, 0xc4, 0x00,
+    0x19, 0x10, 0x00, 0x02, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x01, 0x31, 0x41, 0x21,
+    0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x3f, 0x21, 0x5b, 0x28,
+    0x82, 0xa2, 0x0e, 0xc9, 0x18, 0x83, 0x31, 0x9b, 0x2f, 0x23, 0xff, 0xda,
+    0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x00, 0x00, 0x10,
+    0x0c, 0x0f, 0xff, 0xc4, 0x00, 0x18, 0x11, 0x01, 0x00, 0x03, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x11, 0x21, 0x41, 0xff, 0xda, 0x00, 0x08, 0x01, 0x03, 0x01, 0x01,
+    0x3f, 0x10, 0x76, 0xcb, 0xb5, 0x3a, 0x53, 0xff, 0xc4, 0x00, 0x1c, 0x11,
+    0x00, 0x01, 0x05, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x21, 0x31, 0x41, 0x51, 0x00, 0x61,
+    0x71, 0xff, 0xda, 0x00, 0x08, 0x01, 0x02, 0x01, 0x01, 0x3f, 0x10, 0x2a,
+    0x54, 0x2d, 0xca, 0x41, 0xc8, 0x1d, 0x55, 0xce, 0x15, 0x03, 0xb5, 0x79,
+    0xcf, 0xff, 0xc4, 0x00, 0x1b, 0x10, 0x00, 0x03, 0x01, 0x00, 0x03, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x11, 0x31, 0x21, 0x41, 0x71, 0x91, 0xff, 0xda, 0x00, 0x08, 0x01, 0x01,
+    0x00, 0x01, 0x3f, 0x10, 0x41, 0x10, 0xd7, 0xa2, 0x37, 0xa6, 0x91, 0x76,
+    0xe5, 0xe1, 0x03, 0xdc, 0xb4, 0xbe, 0xbe, 0x08, 0x59, 0xfb, 0x0f, 0xff,
+    0xd9
+};
+
+// kProgressiveJpeg decoded by libjpeg
+const uint8_t kProgressiveRgb[] = {
+    0x90, 0x27, 0x2c, 0x99, 0x28, 0x2e, 0xa8, 0x29, 0x34, 0xb7, 0x28, 0x3a,
+    0xc3, 0x28, 0x48, 0xce, 0x2a, 0x5f, 0xd6, 0x2d, 0x7e, 0xdb, 0x30, 0x90,
+    0xdd, 0x2f, 0x91, 0xdb, 0x2e, 0x8a, 0xd8, 0x2d, 0x7b, 0xcf, 0x2d, 0x68,
+    0xc1, 0x2b, 0x51, 0xaf, 0x29, 0x41, 0x9e, 0x27, 0x3a, 0x8b, 0x29, 0x36,
+    0x74, 0x2d, 0x35, 0x63, 0x2d, 0x3b, 0x55, 0x29, 0x4c, 0x46, 0x26, 0x55,
+    0x35, 0x27, 0x5c, 0x26, 0x27, 0x57, 0x1e, 0x28, 0x4c, 0x17, 0x28, 0x44,
+    0x8c, 0x29, 0x2c, 0x96, 0x2c, 0x30, 0xa9, 0x2d, 0x35, 0xb9, 0x2f, 0x3f,
+    0xc5, 0x2e, 0x4d, 0xd2, 0x31, 0x65, 0xdb, 0x34, 0x84, 0xe1, 0x37, 0x97,
+    0xde, 0x32, 0x96, 0xdd, 0x32, 0x90, 0xda, 0x31, 0x82, 0xd1, 0x31, 0x6f,
+    0xc2, 0x30, 0x55, 0xb0, 0x2f, 0x45, 0xa0, 0x2d, 0x3c, 0x8d, 0x30, 0x3a,
+    0x77, 0x31, 0x39, 0x66, 0x33, 0x42, 0x59, 0x30, 0x4e, 0x49, 0x2e, 0x57,
+    0x3a, 0x2e, 0x5c, 0x2b, 0x2e, 0x59, 0x20, 0x2f, 0x4c, 0x1a, 0x30, 0x47,
+    0x8c, 0x34, 0x32, 0x97, 0x37, 0x38, 0xaa, 0x39, 0x3b, 0xb8, 0x39, 0x44,
+    0xc6, 0x35, 0x52, 0xcf, 0x35, 0x67, 0xd9, 0x38, 0x84, 0xe0, 0x3b, 0x99,
+    0xe1, 0x38, 0x9f, 0xe1, 0x38, 0x9b, 0xdd, 0x3a, 0x8d, 0xd3, 0x39, 0x79,
+    0xc3, 0x37, 0x5e, 0xb0, 0x35, 0x49, 0x9f, 0x36, 0x3d, 0x8f, 0x3a, 0x3d,
+    0x74, 0x37, 0x3c, 0x64, 0x38, 0x45, 0x58, 0x36, 0x4e, 0x49, 0x36, 0x52,
+    0x3a, 0x37, 0x56, 0x2c, 0x37, 0x53, 0x20, 0x37, 0x49, 0x1a, 0x37, 0x45,
+    0x89, 0x3f, 0x36, 0x94, 0x41, 0x39, 0xa8, 0x42, 0x3d, 0xb5, 0x41, 0x41,
+    0xc3, 0x3c, 0x4a, 0xcd, 0x3b, 0x60, 0xd9, 0x3d, 0x86, 0xe1, 0x40, 0x9d,
+    0xe1, 0x40, 0xa0, 0xe1, 0x40, 0x9d, 0xdf, 0x40, 0x90, 0xd4, 0x40, 0x7a,
+    0xc2, 0x3f, 0x5e, 0xb0, 0x3e, 0x48, 0x9d, 0x3f, 0x3f, 0x8d, 0x42, 0x3f,
+    0x74, 0x3d, 0x42, 0x64, 0x3e, 0x49, 0x56, 0x3e, 0x4b, 0x49, 0x3e, 0x4c,
+    0x38, 0x40, 0x4d, 0x2c, 0x40, 0x4b, 0x21, 0x40, 0x45, 0x19, 0x3f, 0x40,
+    0x7f, 0x44, 0x34, 0x8a, 0x47, 0x34, 0x9e, 0x49, 0x34, 0xb0, 0x49, 0x36,
+    0xc1, 0x49, 0x39, 0xd0, 0x49, 0x57, 0xdc, 0x49, 0x8d, 0xe6, 0x4b, 0xa6,
+    0xe2, 0x46, 0x9a, 0xe2, 0x47, 0x93, 0xde, 0x47, 0x8a, 0xd4, 0x49, 0x73,
+    0xc1, 0x49, 0x52, 0xad, 0x48, 0x3e, 0x9a, 0x47, 0x3f, 0x8a, 0x49, 0x47,
+    0x75, 0x46, 0x4c, 0x66, 0x48, 0x50, 0x57, 0x48, 0x4b, 0x48, 0x48, 0x46,
+    0x37, 0x4a, 0x44, 0x2b, 0x4b, 0x40, 0x21, 0x4b, 0x41, 0x1b, 0x49, 0x3e,
+    0x81, 0x4e, 0x5f, 0x8c, 0x4f, 0x5e, 0xa0, 0x51, 0x57, 0xb1, 0x51, 0x52,
+    0xc3, 0x51, 0x50, 0xd1, 0x51, 0x5e, 0xda, 0x51, 0x7f, 0xe2, 0x52, 0x8f,
+    0xe0, 0x50, 0x85, 0xdf, 0x50, 0x7e, 0xdb, 0x4f, 0x74, 0xd1, 0x50, 0x66,
+    0xc1, 0x53, 0x52, 0xaf, 0x53, 0x48, 0x9b, 0x50, 0x4a, 0x89, 0x51, 0x50,
+    0x77, 0x4f, 0x57, 0x66, 0x4f, 0x55, 0x57, 0x50, 0x4a, 0x45, 0x50, 0x3f,
+    0x36, 0x52, 0x39, 0x28, 0x53, 0x37, 0x20, 0x51, 0x3b, 0x1b, 0x52, 0x3b,
+    0x89, 0x56, 0xb3, 0x93, 0x57, 0xad, 0xa6, 0x58, 0xa3, 0xb8, 0x58, 0x97,
+    0xc9, 0x57, 0x8b, 0xd3, 0x57, 0x7b, 0xd7, 0x58, 0x63, 0xd9, 0x57, 0x57,
+    0xdf, 0x5a, 0x5f, 0xdd, 0x58, 0x5b, 0xd8, 0x59, 0x53, 0xd0, 0x59, 0x55,
+    0xc3, 0x5a, 0x5f, 0xb1, 0x5a, 0x62, 0x9f, 0x5a, 0x5d, 0x8c, 0x5b, 0x5f,
+    0x77, 0x58, 0x60, 0x67, 0x58, 0x5b, 0x56, 0x57, 0x49, 0x44, 0x57, 0x39,
+    0x34, 0x59, 0x30, 0x27, 0x5a, 0x31, 0x1e, 0x5a, 0x36, 0x1a, 0x59, 0x3a,
+    0x88, 0x5a, 0xd4, 0x93, 0x5d, 0xcd, 0xa9, 0x5f, 0xc2, 0xbe, 0x62, 0xb5,
+    0xcf, 0x62, 0xa6, 0xd8, 0x61, 0x87, 0xd8, 0x62, 0x58, 0xd7, 0x60, 0x3e,
+    0xdb, 0x62, 0x43, 0xd8, 0x5f, 0x40, 0xd5, 0x5f, 0x3b, 0xce, 0x60, 0x45,
+    0xc3, 0x61, 0x62, 0xb4, 0x62, 0x6e, 0x9f, 0x61, 0x6c, 0x8d, 0x62, 0x6c,
+    0x7a, 0x60, 0x6b, 0x69, 0x61, 0x5f, 0x57, 0x5f, 0x48, 0x45, 0x5f, 0x38,
+    0x34, 0x60, 0x2d, 0x28, 0x62, 0x2f, 0x1f, 0x62, 0x36, 0x1c, 0x63, 0x3b,
+    0x8c, 0x68, 0xcc, 0x95, 0x68, 0xc5, 0xa8, 0x67, 0xb7, 0xbc, 0x6a, 0xaa,
+    0xce, 0x6a, 0x9c, 0xd8, 0x6b, 0x80, 0xda, 0x6b, 0x58, 0xd9, 0x68, 0x3e,
+    0xde, 0x6b, 0x3c, 0xd9, 0x6a, 0x33, 0xd5, 0x68, 0x30, 0xd0, 0x6b, 0x3f,
+    0xc5, 0x6c, 0x5c, 0xb6, 0x6b, 0x70, 0xa1, 0x68, 0x79, 0x8d, 0x66, 0x79,
+    0x7c, 0x67, 0x70, 0x6a, 0x67, 0x60, 0x57, 0x66, 0x49, 0x44, 0x65, 0x38,
+    0x36, 0x69, 0x30, 0x2a, 0x6b, 0x31, 0x22, 0x6a, 0x38, 0x1b, 0x68, 0x3a,
+    0x87, 0x6b, 0xc0, 0x91, 0x6c, 0xba, 0xa6, 0x6d, 0xb2, 0xbc, 0x71, 0xaa,
+    0xcf, 0x72, 0xa1, 0xd9, 0x72, 0x85, 0xdb, 0x73, 0x58, 0xda, 0x72, 0x3d,
+    0xe1, 0x76, 0x3e, 0xdd, 0x75, 0x38, 0xd9, 0x73, 0x33, 0xd2, 0x74, 0x41,
+    0xc6, 0x73, 0x63, 0xb6, 0x71, 0x76, 0xa0, 0x6d, 0x7e, 0x8c, 0x6c, 0x7b,
+    0x7b, 0x6d, 0x6d, 0x6a, 0x6e, 0x5d, 0x57, 0x6d, 0x49, 0x45, 0x6d, 0x3b,
+    0x35, 0x6f, 0x34, 0x2a, 0x72, 0x33, 0x21, 0x70, 0x39, 0x1b, 0x6f, 0x3b,
+    0x8d, 0x77, 0xc0, 0x98, 0x79, 0xbf, 0xac, 0x79, 0xbb, 0xc0, 0x7a, 0xb8,
+    0xd1, 0x77, 0xb5, 0xd9, 0x76, 0x93, 0xd9, 0x7b, 0x55, 0xd8, 0x7b, 0x38,
+    0xdc, 0x79, 0x40, 0xd8, 0x77, 0x40, 0xd6, 0x78, 0x3a, 0xd1, 0x78, 0x4c,
+    0xc6, 0x77, 0x73, 0xb6, 0x76, 0x86, 0xa2, 0x77, 0x81, 0x90, 0x78, 0x78,
+    0x7a, 0x77, 0x66, 0x69, 0x78, 0x59, 0x56, 0x75, 0x4b, 0x46, 0x75, 0x41,
+    0x37, 0x77, 0x3b, 0x2a, 0x78, 0x3a, 0x21, 0x79, 0x3d, 0x1d, 0x78, 0x3f,
+    0x8c, 0x81, 0xa3, 0x97, 0x82, 0xa1, 0xaa, 0x82, 0x9d, 0xbc, 0x81, 0x9d,
+    0xcd, 0x7d, 0xa0, 0xd5, 0x7d, 0x89, 0xd8, 0x82, 0x5f, 0xdb, 0x84, 0x4e,
+    0xdb, 0x7f, 0x56, 0xda, 0x7e, 0x55, 0xd7, 0x7f, 0x4f, 0xd1, 0x7f, 0x59,
+    0xc3, 0x7d, 0x73, 0xb4, 0x7c, 0x7b, 0xa1, 0x7f, 0x75, 0x90, 0x81, 0x6c,
+    0x79, 0x7f, 0x5d, 0x69, 0x80, 0x54, 0x58, 0x7e, 0x4d, 0x47, 0x7e, 0x47,
+    0x37, 0x7e, 0x44, 0x2a, 0x80, 0x43, 0x22, 0x80, 0x42, 0x1c, 0x80, 0x40,
+    0x80, 0x84, 0x5f, 0x8b, 0x86, 0x60, 0x9e, 0x87, 0x5d, 0xb2, 0x87, 0x5d,
+    0xc3, 0x87, 0x63, 0xd1, 0x87, 0x6a, 0xdb, 0x8a, 0x75, 0xe2, 0x8c, 0x7d,
+    0xe5, 0x8d, 0x7f, 0xe3, 0x8c, 0x79, 0xdf, 0x8b, 0x6f, 0xd4, 0x8a, 0x67,
+    0xc2, 0x88, 0x60, 0xaf, 0x86, 0x5a, 0x9c, 0x83, 0x5a, 0x8a, 0x86, 0x56,
+    0x76, 0x88, 0x4e, 0x67, 0x89, 0x4c, 0x57, 0x87, 0x4d, 0x48, 0x85, 0x4c,
+    0x36, 0x86, 0x4b, 0x29, 0x87, 0x49, 0x21, 0x87, 0x45, 0x1a, 0x87, 0x43,
+    0x81, 0x8d, 0x43, 0x8b, 0x8f, 0x42, 0x9d, 0x91, 0x3f, 0xaf, 0x90, 0x3d,
+    0xbf, 0x90, 0x3e, 0xce, 0x90, 0x55, 0xdb, 0x91, 0x84, 0xe5, 0x94, 0x9b,
+    0xe5, 0x93, 0x97, 0xe4, 0x93, 0x8f, 0xdf, 0x91, 0x84, 0xd3, 0x91, 0x6f,
+    0xc1, 0x91, 0x51, 0xac, 0x8f, 0x41, 0x9b, 0x8d, 0x44, 0x8a, 0x90, 0x46,
+    0x76, 0x91, 0x42, 0x67, 0x93, 0x46, 0x59, 0x90, 0x4d, 0x48, 0x8e, 0x52,
+    0x38, 0x8d, 0x54, 0x2a, 0x8e, 0x50, 0x20, 0x8f, 0x4a, 0x1b, 0x91, 0x45,
+    0x89, 0x97, 0x48, 0x93, 0x9b, 0x46, 0xa5, 0x9c, 0x3d, 0xb4, 0x9d, 0x37,
+    0xc2, 0x9b, 0x32, 0xcf, 0x99, 0x4f, 0xdb, 0x97, 0x8a, 0xe3, 0x99, 0xa8,
+    0xe0, 0x94, 0xa0, 0xe0, 0x95, 0x99, 0xde, 0x95, 0x8f, 0xd3, 0x97, 0x75,
+    0xc2, 0x99, 0x49, 0xb0, 0x9a, 0x34, 0x9f, 0x9a, 0x34, 0x8f, 0x9e, 0x39,
+    0x76, 0x9a, 0x38, 0x67, 0x9c, 0x42, 0x5b, 0x99, 0x50, 0x4a, 0x96, 0x56,
+    0x39, 0x94, 0x5b, 0x2b, 0x95, 0x57, 0x21, 0x97, 0x4d, 0x1b, 0x99, 0x48,
+    0x86, 0x98, 0x46, 0x92, 0x9c, 0x43, 0xa6, 0xa1, 0x3d, 0xb7, 0xa3, 0x33,
+    0xc3, 0xa2, 0x2f, 0xd1, 0xa1, 0x4d, 0xdd, 0x9d, 0x91, 0xe7, 0x9f, 0xb3,
+    0xe5, 0x9d, 0xab, 0xe6, 0x9f, 0xa7, 0xe3, 0x9d, 0x9b, 0xd8, 0x9d, 0x7b,
+    0xc4, 0xa0, 0x48, 0xb1, 0xa0, 0x2c, 0xa0, 0xa1, 0x2a, 0x91, 0xa6, 0x31,
+    0x78, 0x9f, 0x34, 0x69, 0xa1, 0x40, 0x5c, 0x9f, 0x52, 0x4c, 0x9b, 0x5a,
+    0x3a, 0x99, 0x5f, 0x2c, 0x9a, 0x5b, 0x23, 0x9b, 0x51, 0x1e, 0x9e, 0x4b
+};
+
+// 24x16, 4:4:4 baseline, a restart marker after every MCU
+const uint8_t kRestartJpeg[] = {
+    0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01,
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43,
+    0x00, 0x05, 0x03, 0x04, 0x04, 0x04, 0x03, 0x05, 0x04, 0x04, 0x04, 0x05,
+    0x05, 0x05, 0x06, 0x07, 0x0c, 0x08, 0x07, 0x07, 0x07, 0x07, 0x0f, 0x0b,
+    0x0b, 0x09, 0x0c, 0x11, 0x0f, 0x12, 0x12, 0x11, 0x0f, 0x11, 0x11, 0x13,
+    0x16, 0x1c, 0x17, 0x13, 0x14, 0x1a, 0x15, 0x11, 0x11, 0x18, 0x21, 0x18,
+    0x1a, 0x1d, 0x1d, 0x1f, 0x1f, 0x1f, 0x13, 0x17, 0x22, 0x24, 0x22, 0x1e,
+    0x24, 0x1c, 0x1e, 0x1f, 0x1e, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x05, 0x05,
+    0x05, 0x07, 0x06, 0x07, 0x0e, 0x08, 0x08, 0x0e, 0x1e, 0x14, 0x11, 0x14,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e,
+    0x1e, 0x1e, 0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x10, 0x00, 0x18, 0x03,
+    0x01, 0x11, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01, 0xff, 0xc4, 0x00,
+    0x1f, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05,
+    0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xc4, 0x00, 0xb5, 0x10, 0x00,
+    0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00,
+    0x00, 0x01, 0x7d, 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21,
+    0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81,
+    0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24,
+    0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25,
+    0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a,
+    0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56,
+    0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86,
+    0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+    0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3,
+    0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6,
+    0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9,
+    0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1,
+    0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xc4, 0x00,
+    0x1f, 0x01, 0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05,
+    0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0xff, 0xc4, 0x00, 0xb5, 0x11, 0x00,
+    0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00,
+    0x01, 0x02, 0x77, 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31,
+    0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08,
+    0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15,
+    0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18,
+    0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55,
+    0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84,
+    0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+    0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa,
+    0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4,
+    0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7,
+    0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+    0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xff, 0xdd, 0x00,
+    0x04, 0x00, 0x01, 0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x11,
+    0x03, 0x11, 0x00, 0x3f, 0x00, 0xe7, 0x74, 0x1d, 0x16, 0x48, 0x42, 0xbc,
+    0x91, 0xed, 0x51, 0xd4, 0xf5, 0xac, 0xd6, 0x1f, 0x13, 0x97, 0x62, 0x15,
+    0x7c, 0x4c, 0x79, 0x60, 0xaf, 0x77, 0x74, 0xf7, 0x56, 0x5b, 0x36, 0xf7,
+    0x67, 0xeb, 0x39, 0x36, 0x3d, 0x4e, 0x9d, 0x93, 0x3f, 0xff, 0xd0, 0xc1,
+    0xd7, 0xb4, 0xb1, 0x2c, 0x5f, 0x22, 0xe7, 0x1d, 0x6b, 0x97, 0x17, 0x8d,
+    0x8e, 0x3a, 0x51, 0x74, 0x1d, 0xed, 0x7b, 0xf4, 0xdf, 0xd6, 0xdd, 0x8f,
+    0xd8, 0x73, 0x4c, 0x67, 0x2d, 0x37, 0x73, 0xff, 0xd1, 0xf1, 0xfd, 0x6b,
+    0x4a, 0xc3, 0x95, 0x2b, 0xcf, 0xd2, 0xb4, 0xa5, 0x8a, 0xe4, 0xa6, 0xa1,
+    0x2d, 0xd1, 0x39, 0xce, 0x33, 0xf7, 0x8d, 0x9f, 0xff, 0xd2, 0xde, 0xd1,
+    0xec, 0x7e, 0xd1, 0x18, 0x8b, 0xca, 0xdb, 0xbb, 0xbe, 0x73, 0x5e, 0x3e,
+    0x3b, 0x88, 0xff, 0x00, 0xb6, 0x1f, 0xd5, 0x79, 0x39, 0x79, 0xba, 0xde,
+    0xfb, 0x6b, 0xb5, 0x97, 0x6e, 0xe7, 0xd6, 0x64, 0x98, 0x8f, 0x67, 0x05,
+    0x2b, 0x9f, 0xff, 0xd3, 0xde, 0xd6, 0x74, 0x8f, 0x22, 0x22, 0x36, 0xee,
+    0xdd, 0xed, 0x8a, 0xf9, 0x18, 0xd5, 0xfe, 0xcc, 0x76, 0xbf, 0x37, 0x37,
+    0xcb, 0x6f, 0xbf, 0xb9, 0xf6, 0xf9, 0xb6, 0x37, 0x9e, 0x9b, 0x3f, 0xff,
+    0xd4, 0xe6, 0xf5, 0xbd, 0x27, 0x32, 0x96, 0xdb, 0xd6, 0xbc, 0x18, 0x62,
+    0x7d, 0xa2, 0xf6, 0x97, 0xdc, 0xf9, 0x2c, 0xe3, 0x19, 0x69, 0xb4, 0x7f,
+    0xff, 0xd9
+};
+
+// kRestartJpeg decoded by libjpeg
+const uint8_t kRestartRgb[] = {
+    0x85, 0x26, 0x52, 0x92, 0x29, 0x38, 0xa6, 0x2a, 0x35, 0xba, 0x2a, 0x2a,
+    0xca, 0x25, 0x43, 0xd5, 0x2b, 0x48, 0xdd, 0x22, 0xa5, 0xe1, 0x2a, 0x9c,
+    0xe5, 0x27, 0xa3, 0xdf, 0x2d, 0x85, 0xd9, 0x2b, 0x80, 0xd0, 0x25, 0x8f,
+    0xc4, 0x2f, 0x35, 0xb1, 0x27, 0x48, 0x9c, 0x25, 0x4b, 0x8b, 0x2a, 0x31,
+    0x7a, 0x29, 0x38, 0x69, 0x28, 0x4a, 0x50, 0x28, 0x5a, 0x3d, 0x29, 0x5a,
+    0x31, 0x2c, 0x4a, 0x28, 0x2b, 0x3c, 0x21, 0x29, 0x3c, 0x1b, 0x26, 0x42,
+    0x80, 0x30, 0x29, 0x8e, 0x32, 0x27, 0xa4, 0x2f, 0x35, 0xb9, 0x2d, 0x47,
+    0xca, 0x2c, 0x4d, 0xd6, 0x35, 0x47, 0xde, 0x2c, 0xa6, 0xe2, 0x39, 0x8c,
+    0xe5, 0x2b, 0xa8, 0xe0, 0x31, 0x90, 0xda, 0x2f, 0x8d, 0xd3, 0x2a, 0x8f,
+    0xc5, 0x36, 0x32, 0xb3, 0x2f, 0x3a, 0x9e, 0x2e, 0x3e, 0x8f, 0x32, 0x2b,
+    0x7b, 0x30, 0x35, 0x6b, 0x2f, 0x48, 0x55, 0x30, 0x5c, 0x41, 0x31, 0x5e,
+    0x36, 0x33, 0x52, 0x2b, 0x32, 0x44, 0x23, 0x30, 0x41, 0x1e, 0x2e, 0x45,
+    0x82, 0x34, 0x4e, 0x90, 0x38, 0x46, 0xa5, 0x3b, 0x3b, 0xb8, 0x37, 0x49,
+    0xc6, 0x3c, 0x31, 0xd1, 0x40, 0x2f, 0xd9, 0x2f, 0xb3, 0xdf, 0x3b, 0x9c,
+    0xe5, 0x37, 0x96, 0xe2, 0x3b, 0x8d, 0xdc, 0x39, 0x94, 0xd4, 0x34, 0x8c,
+    0xc7, 0x3c, 0x35, 0xb3, 0x38, 0x33, 0x9f, 0x35, 0x3f, 0x93, 0x39, 0x3b,
+    0x7a, 0x37, 0x31, 0x6a, 0x36, 0x43, 0x54, 0x36, 0x58, 0x42, 0x37, 0x5f,
+    0x35, 0x39, 0x56, 0x2c, 0x39, 0x4a, 0x23, 0x36, 0x44, 0x1e, 0x35, 0x43,
+    0x84, 0x41, 0x39, 0x91, 0x42, 0x3d, 0xa5, 0x45, 0x35, 0xb7, 0x3d, 0x56,
+    0xc4, 0x42, 0x2a, 0xcf, 0x44, 0x2d, 0xd9, 0x35, 0xb0, 0xe0, 0x42, 0x97,
+    0xe4, 0x41, 0x94, 0xe1, 0x42, 0x92, 0xdd, 0x3f, 0x9e, 0xd4, 0x3d, 0x8a,
+    0xc7, 0x43, 0x3f, 0xb4, 0x41, 0x2e, 0xa0, 0x3e, 0x3d, 0x91, 0x40, 0x3d,
+    0x77, 0x3f, 0x30, 0x68, 0x3e, 0x40, 0x54, 0x3f, 0x52, 0x42, 0x3f, 0x5c,
+    0x35, 0x40, 0x56, 0x2c, 0x3f, 0x4d, 0x22, 0x3f, 0x43, 0x1b, 0x3e, 0x40,
+    0x7f, 0x42, 0x3f, 0x8b, 0x44, 0x42, 0xa0, 0x49, 0x2e, 0xb5, 0x43, 0x4d,
+    0xc5, 0x4a, 0x28, 0xd4, 0x4c, 0x3e, 0xe1, 0x41, 0xab, 0xe9, 0x4a, 0xa4,
+    0xe3, 0x48, 0x8a, 0xe0, 0x49, 0x8c, 0xda, 0x46, 0x9a, 0xd2, 0x47, 0x7e,
+    0xc4, 0x49, 0x4e, 0xb1, 0x48, 0x33, 0x9d, 0x45, 0x43, 0x8e, 0x47, 0x45,
+    0x78, 0x48, 0x3a, 0x68, 0x49, 0x44, 0x54, 0x49, 0x4f, 0x41, 0x49, 0x54,
+    0x36, 0x48, 0x52, 0x2b, 0x49, 0x4b, 0x22, 0x49, 0x44, 0x1a, 0x4a, 0x3e,
+    0x81, 0x54, 0x3f, 0x8d, 0x55, 0x3c, 0xa0, 0x5b, 0x22, 0xb4, 0x55, 0x37,
+    0xc6, 0x57, 0x2a, 0xd6, 0x51, 0x56, 0xe0, 0x4a, 0x91, 0xe8, 0x4b, 0xa6,
+    0xe3, 0x4b, 0x96, 0xdf, 0x4d, 0x8e, 0xd7, 0x4b, 0x92, 0xd0, 0x4f, 0x6e,
+    0xc4, 0x50, 0x59, 0xb2, 0x55, 0x36, 0x9b, 0x53, 0x3a, 0x8c, 0x56, 0x30,
+    0x78, 0x51, 0x4c, 0x68, 0x51, 0x4b, 0x52, 0x51, 0x4c, 0x40, 0x51, 0x4b,
+    0x33, 0x51, 0x49, 0x2a, 0x50, 0x45, 0x1e, 0x51, 0x3e, 0x19, 0x53, 0x3b,
+    0x86, 0x52, 0xce, 0x90, 0x51, 0xd3, 0xa3, 0x53, 0xc2, 0xb7, 0x51, 0xbf,
+    0xc9, 0x52, 0xa4, 0xd6, 0x50, 0x99, 0xda, 0x5b, 0x48, 0xdd, 0x59, 0x44,
+    0xe4, 0x5f, 0x36, 0xde, 0x5f, 0x32, 0xd6, 0x5c, 0x47, 0xcf, 0x5d, 0x45,
+    0xc6, 0x54, 0x75, 0xb3, 0x57, 0x70, 0x9d, 0x53, 0x84, 0x8d, 0x54, 0x7f,
+    0x7a, 0x56, 0x60, 0x6a, 0x58, 0x56, 0x54, 0x58, 0x49, 0x40, 0x58, 0x42,
+    0x33, 0x56, 0x3e, 0x29, 0x56, 0x3f, 0x1e, 0x59, 0x3b, 0x18, 0x5b, 0x38,
+    0x83, 0x62, 0xbd, 0x8f, 0x61, 0xc4, 0xa3, 0x62, 0xbc, 0xbb, 0x63, 0xba,
+    0xcd, 0x5f, 0xb5, 0xd8, 0x59, 0xb2, 0xdb, 0x68, 0x31, 0xda, 0x61, 0x36,
+    0xe5, 0x5d, 0x47, 0xde, 0x5e, 0x37, 0xd5, 0x5d, 0x42, 0xcf, 0x62, 0x39,
+    0xc7, 0x5b, 0x73, 0xb7, 0x61, 0x6a, 0x9f, 0x60, 0x71, 0x8f, 0x63, 0x62,
+    0x7e, 0x5d, 0x70, 0x6d, 0x5f, 0x5f, 0x56, 0x5f, 0x4c, 0x44, 0x5f, 0x40,
+    0x35, 0x5d, 0x3b, 0x2b, 0x5e, 0x3d, 0x22, 0x5f, 0x3d, 0x1b, 0x63, 0x3d,
+    0x85, 0x6b, 0xcc, 0x91, 0x69, 0xcc, 0xa3, 0x6a, 0xb9, 0xb7, 0x6a, 0xb8,
+    0xc7, 0x6b, 0xae, 0xd6, 0x64, 0xac, 0xe0, 0x6e, 0x38, 0xe4, 0x64, 0x37,
+    0xe6, 0x66, 0x3f, 0xdd, 0x66, 0x3c, 0xd3, 0x66, 0x3b, 0xd0, 0x6d, 0x34,
+    0xc7, 0x63, 0x89, 0xb6, 0x69, 0x7b, 0x9d, 0x6b, 0x74, 0x8a, 0x6a, 0x6b,
+    0x75, 0x69, 0x75, 0x66, 0x69, 0x5e, 0x50, 0x6a, 0x45, 0x3e, 0x68, 0x38,
+    0x34, 0x67, 0x3c, 0x2b, 0x67, 0x43, 0x21, 0x69, 0x41, 0x17, 0x6b, 0x3a,
+    0x80, 0x6d, 0xc7, 0x8d, 0x6b, 0xc9, 0xa1, 0x6e, 0xb9, 0xb7, 0x71, 0xb9,
+    0xc8, 0x72, 0xaf, 0xd5, 0x6d, 0xaa, 0xde, 0x76, 0x43, 0xe3, 0x6d, 0x3f,
+    0xea, 0x72, 0x40, 0xe3, 0x71, 0x3d, 0xd9, 0x71, 0x3e, 0xd3, 0x75, 0x38,
+    0xc9, 0x6c, 0x81, 0xb7, 0x70, 0x78, 0x9e, 0x70, 0x72, 0x8c, 0x6f, 0x6b,
+    0x77, 0x6f, 0x6d, 0x68, 0x70, 0x5b, 0x53, 0x70, 0x44, 0x40, 0x6f, 0x39,
+    0x35, 0x6e, 0x3b, 0x2c, 0x6e, 0x40, 0x21, 0x6f, 0x3d, 0x19, 0x70, 0x39,
+    0x85, 0x7b, 0xc2, 0x92, 0x7a, 0xc6, 0xa8, 0x7b, 0xbe, 0xba, 0x7c, 0xbb,
+    0xc9, 0x7d, 0xac, 0xd2, 0x78, 0x9e, 0xdb, 0x7c, 0x4e, 0xde, 0x75, 0x45,
+    0xe4, 0x76, 0x3b, 0xde, 0x75, 0x3b, 0xd6, 0x77, 0x3f, 0xd1, 0x7b, 0x40,
+    0xc9, 0x75, 0x75, 0xb9, 0x78, 0x74, 0xa2, 0x7a, 0x72, 0x91, 0x79, 0x6d,
+    0x79, 0x78, 0x63, 0x69, 0x79, 0x54, 0x53, 0x78, 0x44, 0x42, 0x78, 0x3c,
+    0x37, 0x76, 0x3d, 0x2d, 0x76, 0x3e, 0x23, 0x79, 0x3c, 0x1b, 0x7a, 0x38,
+    0x85, 0x81, 0xb4, 0x94, 0x7d, 0xc1, 0xa9, 0x7a, 0xca, 0xbc, 0x78, 0xcb,
+    0xc9, 0x7b, 0xb5, 0xd1, 0x7e, 0x92, 0xda, 0x84, 0x55, 0xe0, 0x85, 0x3c,
+    0xe2, 0x82, 0x38, 0xdd, 0x82, 0x3b, 0xd6, 0x82, 0x44, 0xd1, 0x81, 0x4e,
+    0xc8, 0x7c, 0x6c, 0xb7, 0x7c, 0x74, 0xa1, 0x7e, 0x7c, 0x91, 0x7d, 0x7c,
+    0x79, 0x80, 0x57, 0x69, 0x81, 0x51, 0x54, 0x81, 0x4a, 0x43, 0x80, 0x44,
+    0x35, 0x7f, 0x42, 0x2b, 0x7f, 0x41, 0x22, 0x81, 0x3f, 0x1b, 0x82, 0x3b,
+    0x7e, 0x89, 0x4d, 0x8d, 0x8b, 0x40, 0xa4, 0x8c, 0x32, 0xb8, 0x8e, 0x2a,
+    0xc6, 0x8f, 0x35, 0xd1, 0x8c, 0x51, 0xde, 0x84, 0x8d, 0xe7, 0x82, 0xa4,
+    0xe9, 0x85, 0x9d, 0xe3, 0x87, 0x94, 0xdc, 0x88, 0x86, 0xd3, 0x88, 0x75,
+    0xc5, 0x8a, 0x52, 0xb1, 0x89, 0x41, 0x9b, 0x8b, 0x34, 0x8c, 0x8e, 0x2d,
+    0x78, 0x87, 0x4e, 0x69, 0x88, 0x4f, 0x53, 0x88, 0x50, 0x41, 0x88, 0x4e,
+    0x33, 0x87, 0x4b, 0x2b, 0x87, 0x46, 0x21, 0x88, 0x43, 0x19, 0x89, 0x41,
+    0x7e, 0x90, 0x3e, 0x8f, 0x8e, 0x3b, 0xa6, 0x8c, 0x3f, 0xb9, 0x8c, 0x3b,
+    0xc5, 0x8d, 0x40, 0xd0, 0x92, 0x47, 0xde, 0x8d, 0x93, 0xe9, 0x92, 0x9b,
+    0xe7, 0x92, 0x99, 0xe3, 0x93, 0x94, 0xdb, 0x92, 0x8b, 0xd1, 0x8f, 0x83,
+    0xc3, 0x91, 0x48, 0xaf, 0x8d, 0x43, 0x9b, 0x8f, 0x3d, 0x8d, 0x91, 0x3c,
+    0x78, 0x90, 0x44, 0x69, 0x90, 0x4d, 0x54, 0x91, 0x56, 0x40, 0x91, 0x57,
+    0x34, 0x90, 0x51, 0x29, 0x90, 0x49, 0x20, 0x90, 0x44, 0x1b, 0x91, 0x45,
+    0x83, 0x9d, 0x38, 0x95, 0x9d, 0x38, 0xac, 0x98, 0x42, 0xbc, 0x97, 0x3c,
+    0xc6, 0x97, 0x3d, 0xcf, 0x9d, 0x3c, 0xdb, 0x93, 0x9f, 0xe3, 0x9a, 0xa1,
+    0xe1, 0x96, 0x93, 0xdd, 0x98, 0x91, 0xd8, 0x98, 0x8c, 0xd0, 0x94, 0x8a,
+    0xc3, 0x9b, 0x3b, 0xb1, 0x98, 0x3e, 0x9e, 0x99, 0x3d, 0x92, 0x9b, 0x3e,
+    0x79, 0x99, 0x38, 0x6a, 0x99, 0x48, 0x55, 0x9a, 0x57, 0x41, 0x9a, 0x5a,
+    0x33, 0x98, 0x52, 0x29, 0x99, 0x47, 0x21, 0x98, 0x44, 0x1b, 0x99, 0x45,
+    0x7e, 0x9f, 0x34, 0x90, 0xa0, 0x35, 0xab, 0x9d, 0x44, 0xbc, 0x9e, 0x3e,
+    0xc6, 0x9e, 0x3e, 0xcf, 0xa7, 0x38, 0xd9, 0x9b, 0xa8, 0xe2, 0xa4, 0xa9,
+    0xe5, 0xa1, 0x94, 0xe3, 0xa4, 0x95, 0xdd, 0xa3, 0x8f, 0xd4, 0x9b, 0x90,
+    0xc5, 0xa3, 0x35, 0xb3, 0x9d, 0x3a, 0xa0, 0x9e, 0x3a, 0x95, 0xa1, 0x3f,
+    0x7a, 0x9e, 0x30, 0x6c, 0x9f, 0x42, 0x57, 0xa1, 0x56, 0x43, 0xa0, 0x5a,
+    0x34, 0x9f, 0x51, 0x2a, 0x9f, 0x46, 0x22, 0x9f, 0x41, 0x1d, 0xa0, 0x42
+};
+
+static Image decode(const uint8_t* data, const size_t size) {
+    Buffer buf(size);
+    memcpy(buf.GetData(), data, size);
+    JfifParser parser;
+    return parser.Parse(buf);
+}
+
+static Image decode(const vector<uint8_t>& bytes) {
+    return decode(bytes.data(), bytes.size());
+}
+
+// the largest difference of a channel from the RGB pixels of `rgb`
+static int32_t compare(const Image& image, const uint8_t* rgb,
+                       const uint32_t width, const uint32_t height) {
+    assert(image.data);
+    assert(image.Width == width && image.Height == height);
+    int32_t difference = 0;
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = image.data + (size_t)image.pitch * y;
+        for (uint32_t x = 0; x < width; x++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                difference =
+                    max(difference, abs(row[x * 4 + c] -
+                                        rgb[((size_t)y * width + x) * 3 + c]));
+            }
+            assert(row[x * 4 + 3] == 0xFF);
+        }
+    }
+    return difference;
+}
+
+// calls `edit` with the marker and the body of each segment up to and
+// including the first SOS
+static void edit_segments(
+    vector<uint8_t>& bytes,
+    const function<void(uint16_t marker, uint8_t* body, size_t length)>&
+        edit) {
+    size_t offset = 2;  // SOI
+    while (offset + 4 <= bytes.size()) {
+        const uint16_t marker = (bytes[offset] << 8) | bytes[offset + 1];
+        const size_t length = (bytes[offset + 2] << 8) | bytes[offset + 3];
+        edit(marker, bytes.data() + offset + 4, length - 2);
+        if (marker == 0xFFDA) break;
+        offset += 2 + length;
+    }
+}
+
+static void progressive_test() {
+    const auto image = decode(kProgressiveJpeg, sizeof(kProgressiveJpeg));
+    const auto difference = compare(image, kProgressiveRgb, 24, 16);
+    cout << "progressive: " << difference << " off libjpeg" << endl;
+    assert(difference <= 2);
+}
+
+static void restart_test() {
+    const auto image = decode(kRestartJpeg, sizeof(kRestartJpeg));
+    const auto difference = compare(image, kRestartRgb, 24, 16);
+    cout << "restart intervals: " << difference << " off libjpeg" << endl;
+    assert(difference <= 2);
+
+    // the extended process may keep its tables at destinations 2 and 3,
+    // the DC and the AC tables of the same destination are distinct
+    vector<uint8_t> extended(kRestartJpeg, kRestartJpeg + sizeof(kRestartJpeg));
+    edit_segments(extended, [](const uint16_t marker, uint8_t* body,
+                               const size_t length) {
+        if (marker == 0xFFC0) {
+            body[-3] = 0xC1;
+        } else if (marker == 0xFFC4) {
+            for (size_t i = 0; i < length;) {
+                body[i] += 2;
+                size_t count = 0;
+                for (size_t j = 1; j <= 16; j++) count += body[i + j];
+                i += 17 + count;
+            }
+        } else if (marker == 0xFFDA) {
+            for (uint8_t i = 0; i < body[0]; i++) {
+                body[2 + i * 2] += 0x22;
+            }
+        }
+    });
+    const auto remapped = decode(extended);
+    assert(remapped.data && remapped.data_size == image.data_size);
+    assert(memcmp(remapped.data, image.data, image.data_size) == 0);
+}
+
+static void reject_test() {
+    const vector<uint8_t> original(kRestartJpeg,
+                                   kRestartJpeg + sizeof(kRestartJpeg));
+
+    // 12 bit samples
+    auto bytes = original;
+    edit_segments(bytes, [](const uint16_t marker, uint8_t* body, size_t) {
+        if (marker == 0xFFC0) body[0] = 12;
+    });
+    assert(!decode(bytes).data);
+
+    // a table beyond destination 3
+    bytes = original;
+    edit_segments(bytes, [](const uint16_t marker, uint8_t* body, size_t) {
+        if (marker == 0xFFC4) body[0] = (body[0] & 0xF0) | 4;
+    });
+    assert(!decode(bytes).data);
+
+    // a scan selecting one
+    bytes = original;
+    edit_segments(bytes, [](const uint16_t marker, uint8_t* body, size_t) {
+        if (marker == 0xFFDA) body[2] = 0x04;
+    });
+    assert(!decode(bytes).data);
+}
+
+// writes bits MSB first, stuffing a 0x00 after each 0xFF
+struct BitWriter {
+    vector<uint8_t>& data;
+    uint32_t accumulator{0};
+    int32_t count{0};
+
+    void Put(const uint32_t bits, const int32_t length) {
+        for (int32_t i = length - 1; i >= 0; i--) {
+            accumulator = (accumulator << 1) | ((bits >> i) & 1);
+            if (++count == 8) {
+                data.push_back(static_cast<uint8_t>(accumulator));
+                if (accumulator == 0xFF) data.push_back(0x00);
+                accumulator = 0;
+                count = 0;
+            }
+        }
+    }
+
+    // pads the last byte with 1 bits
+    void Flush() {
+        if (count) Put((1u << (8 - count)) - 1, 8 - count);
+    }
+};
+
+static void put_segment(vector<uint8_t>& out, const uint16_t marker,
+                        const vector<uint8_t>& body) {
+    const size_t length = body.size() + 2;
+    out.insert(out.end(),
+               {static_cast<uint8_t>(marker >> 8),
+                static_cast<uint8_t>(marker & 0xFF),
+                static_cast<uint8_t>(length >> 8),
+                static_cast<uint8_t>(length & 0xFF)});
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+// A grayscale baseline JPEG of flat 8x8 blocks of the given levels, with a
+// restart marker every `interval` blocks. The blocks carry only their DC
+// coefficient and the quantization is 1, so every pixel is exact.
+static vector<uint8_t> flat_blocks_jpeg(const uint32_t blocks_x,
+                                        const uint32_t blocks_y,
+                                        const uint16_t interval,
+                                        const vector<uint8_t>& levels) {
+    // the luminance DC table of ITU-T81 Annex K, the AC table only codes
+    // EOB
+    const uint8_t dc_bits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1};
+    uint32_t dc_codes[12];
+    int32_t dc_lengths[12];
+    uint32_t code = 0;
+    uint32_t symbol = 0;
+    for (int32_t length = 1; length <= 16; length++) {
+        for (uint8_t i = 0; i < dc_bits[length - 1]; i++) {
+            dc_codes[symbol] = code++;
+            dc_lengths[symbol++] = length;
+        }
+        code <<= 1;
+    }
+
+    const uint16_t width = blocks_x * 8;
+    const uint16_t height = blocks_y * 8;
+
+    vector<uint8_t> out = {0xFF, 0xD8};
+    vector<uint8_t> quantization(65, 1);
+    quantization[0] = 0;
+    put_segment(out, 0xFFDB, quantization);
+    put_segment(out, 0xFFC0,
+                {8, static_cast<uint8_t>(height >> 8),
+                 static_cast<uint8_t>(height & 0xFF),
+                 static_cast<uint8_t>(width >> 8),
+                 static_cast<uint8_t>(width & 0xFF), 1, 1, 0x11, 0});
+    vector<uint8_t> tables = {0x00};
+    tables.insert(tables.end(), dc_bits, dc_bits + 16);
+    for (uint8_t i = 0; i < 12; i++) tables.push_back(i);
+    tables.insert(tables.end(), {0x10, 1});
+    tables.insert(tables.end(), 15, 0);
+    tables.push_back(0x00);
+    put_segment(out, 0xFFC4, tables);
+    put_segment(out, 0xFFDD,
+                {static_cast<uint8_t>(interval >> 8),
+                 static_cast<uint8_t>(interval & 0xFF)});
+    put_segment(out, 0xFFDA, {1, 1, 0x00, 0, 63, 0});
+
+    BitWriter writer{out};
+    int32_t previous = 0;
+    const auto block_count = blocks_x * blocks_y;
+    for (uint32_t block = 0; block < block_count; block++) {
+        if (block && block % interval == 0) {
+            writer.Flush();
+            out.push_back(0xFF);
+            out.push_back(
+                static_cast<uint8_t>(0xD0 + (block / interval - 1) % 8));
+            previous = 0;
+        }
+
+        const int32_t dc = (levels[block] - 128) * 8;
+        const int32_t difference = dc - previous;
+        previous = dc;
+        int32_t category = 0;
+        while ((1 << category) <= abs(difference)) category++;
+        writer.Put(dc_codes[category], dc_lengths[category]);
+        writer.Put(difference < 0 ? difference + (1 << category) - 1
+                                  : difference,
+                   category);
+        writer.Put(0, 1);  // EOB
+    }
+    writer.Flush();
+    out.insert(out.end(), {0xFF, 0xD9});
+
+    return out;
+}
+
+static void parallel_test() {
+    // enough MCUs for the restart intervals to be decoded by several jobs
+    const uint32_t blocks_x = 64;
+    const uint32_t blocks_y = 16;
+    mt19937 random(7);
+    vector<uint8_t> levels(blocks_x * blocks_y);
+    for (auto& level : levels) level = static_cast<uint8_t>(random());
+
+    for (const uint16_t interval : {1, 5, 64, 1000}) {
+        const auto jpeg =
+            flat_blocks_jpeg(blocks_x, blocks_y, interval, levels);
+        const auto image = decode(jpeg);
+        assert(image.data);
+        assert(image.Width == blocks_x * 8 && image.Height == blocks_y * 8);
+
+        for (uint32_t y = 0; y < image.Height; y++) {
+            const uint8_t* row = image.data + (size_t)image.pitch * y;
+            for (uint32_t x = 0; x < image.Width; x++) {
+                const uint8_t level = levels[(y / 8) * blocks_x + x / 8];
+                assert(row[x * 4] == level && row[x * 4 + 1] == level &&
+                       row[x * 4 + 2] == level);
+            }
+        }
+    }
+    cout << "restart intervals in parallel: exact" << endl;
+}
+
+int main() {
+    progressive_test();
+    restart_test();
+    reject_test();
+    parallel_test();
+
+    return 0;
+}
@@ -0,0 +1,398 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AssetLoader.hpp"
+#include "HuffmanTree.hpp"
+#include "JpegHuffman.hpp"
+
+using namespace My;
+using namespace std;
+
+// the luminance AC table of ITU-T81 Annex K, codes up to 16 bits
+const uint8_t kAcLuminanceCodes[16] = {0, 2, 1, 3, 3, 2, 4, 3,
+                                       5, 5, 4, 4, 0, 0, 1, 0x7d};
+const uint8_t kAcLuminanceValues[] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06,
+    0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+    0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45,
+    0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75,
+    0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+    0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9,
+    0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4,
+    0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+const char* const kCorpus[] = {
+    "Textures/huff_simple0.jpg",
+    "Textures/jpeg_decoder_test.jpg",
+    "Textures/jpeg_decoder_test_2.jpg",
+    "Textures/jpeg_decoder_test_3.jpg",
+    "Textures/jpeg_decoder_test_4.jpg",
+    "Textures/jpeg_decoder_test_5.jpg",
+    "Textures/jpeg_decoder_test_6.jpg",
+    "Textures/jpeg_decoder_test_7.jpg",
+    "Textures/jpeg_decoder_test_8.jpg",
+    "Textures/b.jpg",
+    "Textures/b_NRM.jpg",
+    "Textures/w.jpg",
+    "Textures/w_DISP.jpg",
+    "Textures/w_NRM.jpg",
+    "Textures/w_test.jpg",
+    "Textures/icelogo-normal.jpg",
+    "Textures/Lamborghinilogo.jpg",
+    "Textures/apple-metal-2-3d-api.jpg",
+    "Textures/framed-square-metal-pattern1-preview.jpg",
+    "Textures/loose-tablecloth_preview.jpg"};
+
+// writes bits MSB first, stuffing a 0x00 after each 0xFF
+struct BitWriter {
+    vector<uint8_t> data;
+    uint32_t accumulator{0};
+    int32_t count{0};
+
+    void Put(const uint32_t bits, const int32_t length) {
+        for (int32_t i = length - 1; i >= 0; i--) {
+            accumulator = (accumulator << 1) | ((bits >> i) & 1);
+            if (++count == 8) {
+                data.push_back(static_cast<uint8_t>(accumulator));
+                if (accumulator == 0xFF) data.push_back(0x00);
+                accumulator = 0;
+                count = 0;
+            }
+        }
+    }
+
+    void Flush() {
+        if (count) Put((1u << (8 - count)) - 1, 8 - count);
+    }
+};
+
+static int32_t magnitude_size(int32_t value) {
+    value = abs(value);
+    int32_t size = 0;
+    while (value) {
+        size++;
+        value >>= 1;
+    }
+    return size;
+}
+
+static void put_coefficient(BitWriter& writer, const int32_t value,
+                            const int32_t size) {
+    writer.Put(value > 0 ? value : value + (1 << size) - 1, size);
+}
+
+// run and size symbols for the DC difference as well as the AC coefficients
+static void encode_block(BitWriter& writer, const int16_t block[64],
+                         int16_t& previous_dc, const uint32_t codes[256],
+                         const int32_t lengths[256]) {
+    const int32_t difference = block[0] - previous_dc;
+    previous_dc = block[0];
+    const int32_t dc_size = magnitude_size(difference);
+    const uint8_t dc_symbol = static_cast<uint8_t>(dc_size);
+    writer.Put(codes[dc_symbol], lengths[dc_symbol]);
+    put_coefficient(writer, difference, dc_size);
+
+    int32_t run = 0;
+    for (int32_t k = 1; k < 64; k++) {
+        const int32_t value = block[kJpegZigzagIndex[k]];
+        if (!value) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            writer.Put(codes[0xF0], lengths[0xF0]);
+            run -= 16;
+        }
+        const int32_t size = magnitude_size(value);
+        const uint8_t symbol = static_cast<uint8_t>((run << 4) | size);
+        writer.Put(codes[symbol], lengths[symbol]);
+        put_coefficient(writer, value, size);
+        run = 0;
+    }
+    if (run) writer.Put(codes[0x00], lengths[0x00]);
+}
+
+// reads the magnitude bits the way the tree decoder did, on unstuffed data
+struct ReferenceBitReader {
+    const vector<uint8_t>& data;
+    size_t byte_offset{0};
+    uint8_t bit_offset{0};
+
+    [[nodiscard]] bool Exhausted() const { return byte_offset >= data.size(); }
+
+    uint32_t Get(const int32_t length) {
+        uint32_t bits = 0;
+        for (int32_t i = 0; i < length; i++) {
+            const uint8_t byte =
+                byte_offset < data.size() ? data[byte_offset] : 0;
+            bits = (bits << 1) | ((byte >> (7 - bit_offset)) & 1);
+            if (++bit_offset == 8) {
+                bit_offset = 0;
+                byte_offset++;
+            }
+        }
+        return bits;
+    }
+};
+
+static void reference_decode_block(ReferenceBitReader& reader,
+                                   HuffmanTree<uint8_t>& dc,
+                                   HuffmanTree<uint8_t>& ac,
+                                   int16_t& previous_dc,
+                                   int16_t coefficients[64]) {
+    const uint8_t dc_code = dc.DecodeSingleValue(
+        reader.data.data(), reader.data.size(), &reader.byte_offset,
+        &reader.bit_offset);
+    const int32_t dc_bit_length = dc_code & 0x0F;
+    previous_dc = static_cast<int16_t>(
+        previous_dc +
+        JpegBitReader::Extend(reader.Get(dc_bit_length), dc_bit_length));
+    coefficients[0] = previous_dc;
+
+    int32_t ac_index = 1;
+    while (!reader.Exhausted() && ac_index < 64) {
+        const uint8_t ac_code = ac.DecodeSingleValue(
+            reader.data.data(), reader.data.size(), &reader.byte_offset,
+            &reader.bit_offset);
+        if (!ac_code) break;
+        if (ac_code == 0xF0) {
+            ac_index += 16;
+            continue;
+        }
+
+        ac_index += ac_code >> 4;
+        const int32_t ac_bit_length = ac_code & 0x0F;
+        coefficients[kJpegZigzagIndex[ac_index++]] = static_cast<int16_t>(
+            JpegBitReader::Extend(reader.Get(ac_bit_length), ac_bit_length));
+    }
+}
+
+static vector<uint8_t> remove_stuffing(const uint8_t* data, size_t size) {
+    vector<uint8_t> result;
+    for (size_t i = 0; i < size; i++) {
+        result.push_back(data[i]);
+        if (data[i] == 0xFF && i + 1 < size && data[i + 1] == 0x00) i++;
+    }
+    return result;
+}
+
+// decodes every baseline scan of a file with both decoders, returns the
+// number of blocks compared or -1 when they differ
+static int64_t compare_file(const Buffer& buf) {
+    const uint8_t* p = buf.GetData();
+    const uint8_t* end = p + buf.GetDataSize();
+    if (buf.GetDataSize() < 4 || p[0] != 0xFF || p[1] != 0xD8) return 0;
+    p += 2;
+
+    // the DC tables at 0 to 3, the AC tables at 4 to 7
+    HuffmanTree<uint8_t> trees[8];
+    JpegHuffmanTable tables[8];
+    uint8_t components = 0;
+    uint32_t mcu_count = 0;
+    uint32_t restart_interval = 0;
+    uint32_t mcu_index = 0;
+    uint8_t selectors[4] = {};
+    int64_t blocks = 0;
+
+    while (p + 4 <= end && p[0] == 0xFF) {
+        const uint16_t marker = (p[0] << 8) | p[1];
+        if (marker == 0xFFD9) break;
+
+        const uint8_t* scan = nullptr;
+        if (marker >= 0xFFD0 && marker <= 0xFFD7) {
+            scan = p + 2;
+        } else {
+            const uint16_t length = (p[2] << 8) | p[3];
+            const uint8_t* segment = p + 4;
+            if (marker == 0xFFC2) return 0;  // progressive
+            if (marker == 0xFFC0 || marker == 0xFFC1) {
+                const uint32_t lines = (segment[1] << 8) | segment[2];
+                const uint32_t samples = (segment[3] << 8) | segment[4];
+                components = segment[5];
+                mcu_count = ((samples + 7) >> 3) * ((lines + 7) >> 3);
+            } else if (marker == 0xFFC4) {
+                const uint8_t* table = segment;
+                while (table < p + 2 + length) {
+                    if ((table[0] >> 4) > 1 || (table[0] & 0x0F) > 3) return 0;
+                    const int index = ((table[0] >> 4) << 2) | (table[0] & 3);
+                    trees[index].PopulateWithHuffmanTable(table + 1,
+                                                          table + 17);
+                    table += 17 + tables[index].PopulateWithHuffmanTable(
+                                      table + 1, table + 17);
+                }
+            } else if (marker == 0xFFDD) {
+                restart_interval = (segment[0] << 8) | segment[1];
+            } else if (marker == 0xFFDA) {
+                for (uint8_t i = 0; i < segment[0] && i < 4; i++) {
+                    selectors[i] = segment[2 + i * 2];
+                    if ((selectors[i] >> 4) > 3 || (selectors[i] & 0x0F) > 3)
+                        return 0;
+                }
+                scan = p + 2 + length;
+            }
+            if (!scan) {
+                p += 2 + length;
+                continue;
+            }
+        }
+
+        const uint8_t* scan_end = scan;
+        while (scan_end + 1 < end &&
+               (scan_end[0] != 0xFF || scan_end[1] == 0x00)) {
+            scan_end += scan_end[0] == 0xFF ? 2 : 1;
+        }
+
+        JpegBitReader reader(scan, scan_end);
+        ReferenceBitReader reference{remove_stuffing(scan, scan_end - scan)};
+        int16_t previous_dc[4] = {};
+        int16_t reference_dc[4] = {};
+
+        while (mcu_index < mcu_count && !reference.Exhausted()) {
+            assert(!reader.Exhausted());
+            for (uint8_t i = 0; i < components; i++) {
+                int16_t expected[64] = {};
+                int16_t actual[64] = {};
+                reference_decode_block(reference, trees[selectors[i] >> 4],
+                                       trees[4 + (selectors[i] & 3)],
+                                       reference_dc[i], expected);
+                DecodeJpegBlock(reader, tables[selectors[i] >> 4],
+                                tables[4 + (selectors[i] & 3)], previous_dc[i],
+                                actual);
+                if (memcmp(expected, actual, sizeof(expected))) return -1;
+                blocks++;
+            }
+
+            mcu_index++;
+            if (restart_interval && mcu_index % restart_interval == 0) break;
+        }
+
+        p = scan_end;
+    }
+
+    return blocks;
+}
+
+int main(int argc, char** argv) {
+    // symbols of every length and the stuffing of 0xFF
+    JpegHuffmanTable table;
+    HuffmanTree<uint8_t> tree;
+    assert(table.PopulateWithHuffmanTable(kAcLuminanceCodes,
+                                          kAcLuminanceValues) == 162);
+    tree.PopulateWithHuffmanTable(kAcLuminanceCodes, kAcLuminanceValues);
+
+    uint32_t codes[256] = {};
+    int32_t lengths[256] = {};
+    {
+        uint32_t code = 0;
+        size_t k = 0;
+        for (int32_t length = 1; length <= 16; length++) {
+            for (int32_t i = 0; i < kAcLuminanceCodes[length - 1]; i++) {
+                codes[kAcLuminanceValues[k]] = code++;
+                lengths[kAcLuminanceValues[k++]] = length;
+            }
+            code <<= 1;
+        }
+    }
+
+    mt19937 generator(81);
+    uniform_int_distribution<size_t> pick(0, sizeof(kAcLuminanceValues) - 1);
+    vector<uint8_t> symbols;
+    vector<uint32_t> magnitudes;
+    BitWriter writer;
+    for (int i = 0; i < 100000; i++) {
+        const uint8_t symbol = kAcLuminanceValues[pick(generator)];
+        const int32_t size = symbol & 0x0F;
+        const uint32_t magnitude = generator() & ((1u << size) - 1);
+        writer.Put(codes[symbol], lengths[symbol]);
+        writer.Put(magnitude, size);
+        symbols.push_back(symbol);
+        magnitudes.push_back(magnitude);
+    }
+    writer.Flush();
+
+    JpegBitReader reader(writer.data.data(),
+                         writer.data.data() + writer.data.size());
+    const auto unstuffed =
+        remove_stuffing(writer.data.data(), writer.data.size());
+    ReferenceBitReader reference{unstuffed};
+    for (size_t i = 0; i < symbols.size(); i++) {
+        const uint8_t expected = tree.DecodeSingleValue(
+            unstuffed.data(), unstuffed.size(), &reference.byte_offset,
+            &reference.bit_offset);
+        const int32_t size = expected & 0x0F;
+        assert(expected == symbols[i]);
+        assert(reference.Get(size) == magnitudes[i]);
+
+        assert(table.DecodeSymbol(reader) == symbols[i]);
+        assert(reader.Get(size) == magnitudes[i]);
+    }
+
+    cout << "table tests passed" << endl;
+
+    // blocks of random coefficients, the DC codes share the AC table which
+    // has the sizes up to 10
+    {
+        BitWriter block_writer;
+        vector<int16_t> encoded;
+        int16_t previous = 0;
+        for (int i = 0; i < 2000; i++) {
+            int16_t block[64] = {};
+            block[0] = static_cast<int16_t>(generator() % 1023) - 511;
+            for (int k = 1; k < 64; k++) {
+                if (generator() % 4 == 0) {
+                    block[kJpegZigzagIndex[k]] =
+                        static_cast<int16_t>(generator() % 1023) - 511;
+                }
+            }
+
+            encode_block(block_writer, block, previous, codes, lengths);
+            encoded.insert(encoded.end(), block, block + 64);
+        }
+        block_writer.Flush();
+
+        JpegBitReader block_reader(
+            block_writer.data.data(),
+            block_writer.data.data() + block_writer.data.size());
+        int16_t previous_dc = 0;
+        for (size_t i = 0; i < encoded.size(); i += 64) {
+            int16_t block[64] = {};
+            DecodeJpegBlock(block_reader, table, table, previous_dc, block);
+            assert(!memcmp(block, &encoded[i], sizeof(block)));
+        }
+    }
+
+    cout << "block tests passed" << endl;
+
+    // the corpus against the tree decoder
+    AssetLoader assetLoader;
+    assert(!assetLoader.Initialize());
+
+    vector<string> files(argv + 1, argv + argc);
+    if (files.empty()) files.assign(begin(kCorpus), end(kCorpus));
+
+    int64_t blocks = 0;
+    for (const auto& file : files) {
+        const auto buf = assetLoader.SyncOpenAndReadBinary(file.c_str());
+        const auto result = compare_file(buf);
+        cout << file << ": " << result << " blocks" << endl;
+        assert(result >= 0);
+        blocks += result;
+    }
+
+    cout << "corpus tests passed, " << blocks << " blocks" << endl;
+
+    assetLoader.Finalize();
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "ColorSpaceConversion.hpp"
+#include "geommath.hpp"
+
+using namespace My;
+using namespace std;
+
+// luminance quantization table of Annex K in natural order
+static const uint8_t kLuminanceQuantization[64] = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+    14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+    18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+
+// the float IDCT with the level shift, rounded to 8 bits
+static void float_idct(const int16_t coefficients[64],
+                       const uint16_t quantization[64], uint8_t samples[64]) {
+    Matrix8X8f block;
+    for (int i = 0; i < 64; i++) {
+        block[i >> 3][i & 7] =
+            static_cast<float>(coefficients[i] * quantization[i]);
+    }
+    block[0][0] += 1024.0f;
+    block = IDCT8X8(block);
+    for (int i = 0; i < 64; i++) {
+        samples[i] = static_cast<uint8_t>(
+            std::clamp(block[i >> 3][i & 7] + 0.5f, 0.0f, 255.0f));
+    }
+}
+
+// blocks of pixels, quantized like an encoder would
+static int test_idct(const int quality, const int block_count,
+                     mt19937& generator) {
+    const int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    uint16_t quantization[64];
+    for (int i = 0; i < 64; i++) {
+        quantization[i] = static_cast<uint16_t>(std::clamp(
+            (kLuminanceQuantization[i] * scale + 50) / 100, 1, 255));
+    }
+
+    uniform_int_distribution<int> pixel(0, 255);
+    uniform_int_distribution<int> noise(-24, 24);
+    int max_error = 0;
+    for (int n = 0; n < block_count; n++) {
+        // a gradient with noise, or noise alone
+        Matrix8X8f block;
+        const int base = pixel(generator);
+        const int dx = noise(generator) / 4;
+        const int dy = noise(generator) / 4;
+        const bool flat = n & 1;
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < 8; j++) {
+                const int value =
+                    flat ? pixel(generator)
+                         : base + dx * j + dy * i + noise(generator);
+                block[i][j] =
+                    static_cast<float>(std::clamp(value, 0, 255) - 128);
+            }
+        }
+        block = DCT8X8(block);
+
+        int16_t coefficients[64];
+        for (int i = 0; i < 64; i++) {
+            coefficients[i] = static_cast<int16_t>(
+                lroundf(block[i >> 3][i & 7] / quantization[i]));
+        }
+
+        uint8_t expected[64];
+        float_idct(coefficients, quantization, expected);
+
+        // written into a wider buffer to check the pitch
+        uint8_t samples[8 * 13];
+        IDCT8X8(coefficients, quantization, samples, 13);
+
+        for (int i = 0; i < 64; i++) {
+            const int error =
+                abs(samples[(i >> 3) * 13 + (i & 7)] - expected[i]);
+            max_error = std::max(max_error, error);
+        }
+    }
+
+    cout << "quality " << quality << ": max IDCT error " << max_error
+         << endl;
+    return max_error;
+}
+
+static int test_color_conversion() {
+    uint8_t y[256];
+    uint8_t cb[256];
+    uint8_t cr[256];
+    uint8_t rgba[256 * 4];
+    for (int i = 0; i < 256; i++) {
+        y[i] = static_cast<uint8_t>(i);
+    }
+
+    int max_error = 0;
+    for (int b = 0; b < 256; b++) {
+        for (int r = 0; r < 256; r++) {
+            memset(cb, b, sizeof(cb));
+            memset(cr, r, sizeof(cr));
+            // odd count to cover the tail after the SIMD loop
+            const int count = 256 - (r & 7);
+            ConvertYCbCr2RGBA8(y, cb, cr, rgba, count);
+
+            for (int i = 0; i < count; i++) {
+                const RGBf expected = ConvertYCbCr2RGB(
+                    YCbCrf({(float)i, (float)b, (float)r}));
+                for (int k = 0; k < 3; k++) {
+                    const int error =
+                        abs(rgba[i * 4 + k] - static_cast<int>(expected[k]));
+                    max_error = std::max(max_error, error);
+                }
+                assert(rgba[i * 4 + 3] == 255);
+            }
+        }
+    }
+
+    cout << "max color conversion error " << max_error << endl;
+    return max_error;
+}
+
+static void test_upsampling(mt19937& generator) {
+    const int width = 37;
+    uint8_t near[width];
+    uint8_t far[width];
+    uint8_t out[width * 2];
+
+    // flat chroma stays flat
+    memset(near, 77, sizeof(near));
+    memset(far, 77, sizeof(far));
+    UpsampleChroma(near, far, width, 2, true, 0, width * 2, out);
+    for (unsigned char i : out) assert(i == 77);
+
+    uniform_int_distribution<int> sample(0, 255);
+    for (int i = 0; i < width; i++) {
+        near[i] = static_cast<uint8_t>(sample(generator));
+        far[i] = static_cast<uint8_t>(sample(generator));
+    }
+
+    // the edges keep the samples, the rest lies between the neighbors
+    UpsampleChroma(near, far, width, 2, false, 0, width * 2, out);
+    assert(out[0] == near[0]);
+    assert(out[width * 2 - 1] == near[width - 1]);
+    for (int i = 1; i < width * 2 - 1; i++) {
+        const int center = near[i >> 1];
+        const int side = near[(i & 1) ? (i >> 1) + 1 : (i >> 1) - 1];
+        assert(out[i] >= std::min(center, side));
+        assert(out[i] <= std::max(center, side));
+    }
+
+    // starting in the middle of a row gives the same samples
+    uint8_t part[width];
+    UpsampleChroma(near, far, width, 2, true, 0, width * 2, out);
+    UpsampleChroma(near, far, width, 2, true, width - 1, width, part);
+    assert(!memcmp(part, out + width - 1, width));
+
+    // the fused row matches upsampling then converting
+    const int count = width * 2;
+    uint8_t y[count];
+    uint8_t cb[count];
+    uint8_t cr[count];
+    for (auto& i : y) i = static_cast<uint8_t>(sample(generator));
+    UpsampleChroma(near, far, width, 2, true, 0, count, cb);
+    UpsampleChroma(far, near, width, 2, true, 0, count, cr);
+
+    uint8_t expected[count * 4];
+    uint8_t rgba[count * 4];
+    ConvertYCbCr2RGBA8(y, cb, cr, expected, count);
+    ConvertYCbCr2RGBA8Row(y, near, far, far, near, width, 2, true, rgba,
+                          count);
+    assert(!memcmp(rgba, expected, sizeof(rgba)));
+
+    cout << "upsampling ok" << endl;
+}
+
+int main() {
+    mt19937 generator(42);
+
+    int result = 0;
+    for (const int quality : {20, 50, 75, 90, 100}) {
+        if (test_idct(quality, 2000, generator) > 1) result = 1;
+    }
+
+    if (test_color_conversion() > 1) result = 1;
+
+    test_upsampling(generator);
+
+    return result;
+}
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 #include <string>
 
@@ -27,6 +28,21 @@ int main(int argc, const char** argv) {
 
         std::cout << image;
 
+        // throughput benchmark
+        const int32_t rounds = argc >= 3 ? std::stoi(argv[2]) : 10;
+        const auto start = std::chrono::steady_clock::now();
+        for (int32_t n = 0; n < rounds; n++) {
+            JfifParser parser;
+            Image decoded = parser.Parse(buf);
+        }
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        const double milliseconds = elapsed.count() / std::max(rounds, 1);
+        std::cout << image.Width << "x" << image.Height << " decoded in "
+                  << milliseconds << " ms, "
+                  << image.Width * image.Height / (milliseconds * 1000.0)
+                  << " megapixels/s" << std::endl;
+
         assetLoader.Finalize();
     }
 
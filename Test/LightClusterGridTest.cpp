@@ -0,0 +1,122 @@
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "LightClusterGrid.hpp"
+
+using namespace My;
+using namespace std;
+
+const float kNearClip = 0.5f;
+const float kFarClip = 200.0f;
+const float kTanHalfFovY = 0.5f;
+const float kTanHalfFovX = kTanHalfFovY * 16.0f / 9.0f;
+
+vector<LightClusterGrid::LightBounds> random_lights(const size_t count,
+                                                   mt19937& generator) {
+    uniform_real_distribution<float> depth(-10.0f, kFarClip + 10.0f);
+    uniform_real_distribution<float> side(-1.2f, 1.2f);
+    uniform_real_distribution<float> radius(0.2f, 8.0f);
+
+    vector<LightClusterGrid::LightBounds> lights(count);
+    for (auto& light : lights) {
+        const float d = depth(generator);
+        light.center = {side(generator) * kTanHalfFovX * abs(d),
+                        side(generator) * kTanHalfFovY * abs(d), -d};
+        light.radius = radius(generator);
+    }
+
+    return lights;
+}
+
+int main(int argc, char** argv) {
+    mt19937 generator(1234);
+
+    LightClusterGrid grid;
+    grid.Build(kTanHalfFovX, kTanHalfFovY, kNearClip, kFarClip);
+    cout << grid.GetClusterCount() << " clusters" << endl;
+
+    // slices follow the log of the depth
+    assert(grid.GetSlice(kNearClip) == 0);
+    assert(grid.GetSlice(kFarClip * 0.999f) ==
+           LightClusterGrid::kDefaultCountZ - 1);
+    assert(grid.GetSlice(sqrt(kNearClip * kFarClip) * 1.001f) ==
+           LightClusterGrid::kDefaultCountZ / 2);
+
+    auto lights = random_lights(1000, generator);
+    // a light reaching everywhere, like the sun
+    lights.push_back({{0.0f, 0.0f, 0.0f}, -1.0f});
+
+    vector<LightClusterRange> clusters;
+    vector<uint32_t> indices;
+    grid.Assign(lights, 1, clusters, indices);
+    assert(clusters.size() == grid.GetClusterCount());
+
+    // the indices of each cluster are sorted, end with the global light and
+    // the clusters tile the index list
+    uint32_t offset = 0;
+    for (const auto& cluster : clusters) {
+        assert(cluster.offset == offset);
+        assert(cluster.count >= 1);
+        for (uint32_t i = 1; i < cluster.count; i++) {
+            assert(indices[cluster.offset + i - 1] <
+                   indices[cluster.offset + i]);
+        }
+        assert(indices[cluster.offset + cluster.count - 1] ==
+               lights.size() - 1);
+        offset += cluster.count;
+    }
+    assert(offset == indices.size());
+
+    // a point lit by a light finds the light in its cluster
+    uniform_real_distribution<float> unit(-0.999f, 0.999f);
+    uniform_real_distribution<float> depth(kNearClip, kFarClip);
+    size_t lit_points = 0;
+    for (int32_t n = 0; n < 20000; n++) {
+        const float d = depth(generator);
+        const Vector3f point = {unit(generator) * kTanHalfFovX * d,
+                                unit(generator) * kTanHalfFovY * d, -d};
+        const auto& cluster = clusters[grid.GetClusterIndex(point)];
+        const auto begin = indices.begin() + cluster.offset;
+        const auto end = begin + cluster.count;
+
+        for (uint32_t i = 0; i < lights.size() - 1; i++) {
+            const auto& light = lights[i];
+            const Vector3f v = point - light.center;
+            if (Length(v) < light.radius * 0.999f) {
+                assert(binary_search(begin, end, i));
+                lit_points++;
+            }
+        }
+    }
+    cout << lit_points << " lit points found their lights" << endl;
+
+    // binning in parallel gives the same lists
+    vector<LightClusterRange> parallel_clusters;
+    vector<uint32_t> parallel_indices;
+    grid.Assign(lights, 5, parallel_clusters, parallel_indices);
+    assert(parallel_indices == indices);
+    for (size_t i = 0; i < clusters.size(); i++) {
+        assert(parallel_clusters[i].offset == clusters[i].offset);
+        assert(parallel_clusters[i].count == clusters[i].count);
+    }
+
+    // benchmark
+    const auto many_lights = random_lights(4096, generator);
+    for (const uint32_t jobs : {1u, 4u}) {
+        const auto start = chrono::steady_clock::now();
+        const int32_t rounds = 10;
+        for (int32_t n = 0; n < rounds; n++) {
+            grid.Assign(many_lights, jobs, clusters, indices);
+        }
+        const chrono::duration<double, milli> elapsed =
+            chrono::steady_clock::now() - start;
+        cout << many_lights.size() << " lights binned with " << jobs
+             << " jobs in " << elapsed.count() / rounds << " ms, "
+             << indices.size() << " indices" << endl;
+    }
+
+    return 0;
+}
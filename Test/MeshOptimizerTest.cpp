@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "MeshOptimizer.hpp"
+#include "SceneObjectMesh.hpp"
+
+using namespace My;
+using namespace std;
+
+constexpr uint32_t kGridSize = 64;
+
+// build a kGridSize x kGridSize vertex grid with shuffled triangles
+void build_grid(vector<float>& positions, vector<uint32_t>& indices) {
+    for (uint32_t y = 0; y < kGridSize; y++) {
+        for (uint32_t x = 0; x < kGridSize; x++) {
+            positions.push_back(static_cast<float>(x));
+            positions.push_back(static_cast<float>(y));
+            positions.push_back(0.0f);
+        }
+    }
+
+    vector<array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < kGridSize - 1; y++) {
+        for (uint32_t x = 0; x < kGridSize - 1; x++) {
+            uint32_t i0 = y * kGridSize + x;
+            uint32_t i1 = i0 + 1;
+            uint32_t i2 = i0 + kGridSize;
+            uint32_t i3 = i2 + 1;
+            triangles.push_back({i0, i1, i3});
+            triangles.push_back({i0, i3, i2});
+        }
+    }
+
+    default_random_engine generator;
+    shuffle(triangles.begin(), triangles.end(), generator);
+
+    for (const auto& triangle : triangles) {
+        indices.insert(indices.end(), triangle.begin(), triangle.end());
+    }
+}
+
+// canonical sorted list of triangles (with winding) for comparison
+vector<array<uint32_t, 3>> canonical(const vector<uint32_t>& indices) {
+    vector<array<uint32_t, 3>> result;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        array<uint32_t, 3> t = {indices[i], indices[i + 1], indices[i + 2]};
+        rotate(t.begin(), min_element(t.begin(), t.end()), t.end());
+        result.push_back(t);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+void vertex_cache_test() {
+    vector<float> positions;
+    vector<uint32_t> indices;
+    build_grid(positions, indices);
+    const size_t vertex_count = positions.size() / 3;
+
+    auto before = AnalyzeVertexCache(indices, vertex_count);
+    auto optimized = OptimizeVertexCache(indices, vertex_count);
+    auto after = AnalyzeVertexCache(optimized, vertex_count);
+
+    cout << "ACMR: " << before.acmr << " -> " << after.acmr << endl;
+    cout << "ATVR: " << before.atvr << " -> " << after.atvr << endl;
+
+    assert(canonical(indices) == canonical(optimized));
+    assert(after.acmr < before.acmr);
+    // a regular grid should get well below 1 miss per triangle
+    assert(after.acmr < 0.8f);
+
+    auto overdraw = OptimizeOverdraw(optimized, positions.data(),
+                                     vertex_count, 3, 1.05f);
+    auto after_overdraw = AnalyzeVertexCache(overdraw, vertex_count);
+
+    cout << "ACMR after overdraw ordering: " << after_overdraw.acmr << endl;
+
+    assert(canonical(indices) == canonical(overdraw));
+    assert(after_overdraw.acmr <= after.acmr * 1.1f);
+
+    vector<uint32_t> remap;
+    auto used = OptimizeVertexFetchRemap(remap, overdraw, vertex_count);
+    assert(used == vertex_count);
+
+    auto fetch_before = AnalyzeVertexFetch(overdraw, vertex_count, 12);
+    RemapIndexBuffer(overdraw, remap);
+    auto fetch_after = AnalyzeVertexFetch(overdraw, vertex_count, 12);
+
+    cout << "Overfetch: " << fetch_before.overfetch << " -> "
+         << fetch_after.overfetch << endl;
+
+    assert(fetch_after.overfetch <= fetch_before.overfetch);
+}
+
+void scene_object_mesh_test() {
+    vector<float> positions;
+    vector<uint32_t> indices;
+    build_grid(positions, indices);
+
+    auto* vertex_data = new float[positions.size()];
+    memcpy(vertex_data, positions.data(), positions.size() * sizeof(float));
+    auto* index_data = new uint32_t[indices.size()];
+    memcpy(index_data, indices.data(), indices.size() * sizeof(uint32_t));
+
+    SceneObjectMesh mesh;
+    mesh.SetPrimitiveType(PrimitiveType::kPrimitiveTypeTriList);
+    mesh.AddVertexArray(SceneObjectVertexArray(
+        "position", 0, VertexDataType::kVertexDataTypeFloat3,
+        reinterpret_cast<uint8_t*>(vertex_data), positions.size()));
+    mesh.AddIndexArray(SceneObjectIndexArray(
+        0, 0, IndexDataType::kIndexDataTypeInt32,
+        reinterpret_cast<uint8_t*>(index_data), indices.size()));
+
+    mesh.Optimize();
+
+    const auto& index_array = mesh.GetIndexArray(0);
+    assert(index_array.GetIndexType() == IndexDataType::kIndexDataTypeInt16);
+    assert(index_array.GetIndexCount() == indices.size());
+    assert(mesh.GetVertexCount() == positions.size() / 3);
+
+    // map the new indices back to positions and compare triangle sets
+    const auto* new_positions = reinterpret_cast<const float*>(
+        mesh.GetVertexPropertyArray(0).GetData());
+    const auto* new_indices =
+        reinterpret_cast<const uint16_t*>(index_array.GetData());
+
+    vector<uint32_t> mapped;
+    for (size_t i = 0; i < index_array.GetIndexCount(); i++) {
+        const float* p = new_positions + new_indices[i] * 3;
+        mapped.push_back(static_cast<uint32_t>(p[1]) * kGridSize +
+                         static_cast<uint32_t>(p[0]));
+    }
+
+    assert(canonical(indices) == canonical(mapped));
+
+    cout << "Index Type: " << index_array.GetIndexType() << endl;
+}
+
+int main(int argc, char** argv) {
+    vertex_cache_test();
+    scene_object_mesh_test();
+
+    return 0;
+}
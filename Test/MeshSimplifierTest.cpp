@@ -0,0 +1,129 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#include "MeshSimplifier.hpp"
+#include "SceneObjectGeometry.hpp"
+
+using namespace My;
+using namespace std;
+
+// build a closed unit sphere by subdividing an octahedron
+void build_sphere(vector<float>& positions, vector<uint32_t>& indices,
+                  const uint32_t subdivisions) {
+    positions = {1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1};
+    indices = {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,
+               2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5};
+
+    for (uint32_t s = 0; s < subdivisions; s++) {
+        map<pair<uint32_t, uint32_t>, uint32_t> midpoints;
+        auto midpoint = [&](uint32_t a, uint32_t b) {
+            auto key = make_pair(min(a, b), max(a, b));
+            auto it = midpoints.find(key);
+            if (it != midpoints.end()) return it->second;
+
+            float p[3];
+            for (size_t k = 0; k < 3; k++) {
+                p[k] = (positions[a * 3 + k] + positions[b * 3 + k]) * 0.5f;
+            }
+            const float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            auto index = static_cast<uint32_t>(positions.size() / 3);
+            for (size_t k = 0; k < 3; k++) {
+                positions.push_back(p[k] / length);
+            }
+            midpoints.emplace(key, index);
+            return index;
+        };
+
+        vector<uint32_t> subdivided;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            uint32_t ab = midpoint(a, b), bc = midpoint(b, c),
+                     ca = midpoint(c, a);
+            subdivided.insert(subdivided.end(), {a, ab, ca, ab, b, bc, ca, bc,
+                                                 c, ab, bc, ca});
+        }
+        indices = std::move(subdivided);
+    }
+}
+
+void simplify_test() {
+    vector<float> positions;
+    vector<uint32_t> indices;
+    build_sphere(positions, indices, 5);
+    const size_t vertex_count = positions.size() / 3;
+
+    float error = 0.0f;
+    auto simplified = SimplifyMesh(indices, positions.data(), vertex_count, 3,
+                                   indices.size() / 4, 0.05f, &error);
+
+    cout << "Triangles: " << indices.size() / 3 << " -> "
+         << simplified.size() / 3 << " (error " << error << ")" << endl;
+
+    assert(simplified.size() % 3 == 0);
+    assert(simplified.size() <= indices.size() / 4);
+    assert(simplified.size() >= indices.size() / 8);
+    assert(error <= 0.05f);
+
+    for (size_t i = 0; i < simplified.size(); i += 3) {
+        assert(simplified[i] < vertex_count);
+        assert(simplified[i] != simplified[i + 1]);
+        assert(simplified[i + 1] != simplified[i + 2]);
+        assert(simplified[i + 2] != simplified[i]);
+    }
+
+    // a tight error bound stops the simplification early
+    auto bounded = SimplifyMesh(indices, positions.data(), vertex_count, 3, 0,
+                                0.0002f, &error);
+    cout << "Bounded: " << bounded.size() / 3 << " (error " << error << ")"
+         << endl;
+    assert(bounded.size() > simplified.size());
+    assert(error <= 0.0002f);
+}
+
+void scene_object_mesh_test() {
+    vector<float> positions;
+    vector<uint32_t> indices;
+    build_sphere(positions, indices, 4);
+
+    auto* vertex_data = new float[positions.size()];
+    memcpy(vertex_data, positions.data(), positions.size() * sizeof(float));
+    auto* index_data = new uint32_t[indices.size()];
+    memcpy(index_data, indices.data(), indices.size() * sizeof(uint32_t));
+
+    SceneObjectMesh mesh;
+    mesh.SetPrimitiveType(PrimitiveType::kPrimitiveTypeTriList);
+    mesh.AddVertexArray(SceneObjectVertexArray(
+        "position", 0, VertexDataType::kVertexDataTypeFloat3,
+        reinterpret_cast<uint8_t*>(vertex_data), positions.size()));
+    mesh.AddIndexArray(SceneObjectIndexArray(
+        0, 0, IndexDataType::kIndexDataTypeInt32,
+        reinterpret_cast<uint8_t*>(index_data), indices.size()));
+
+    auto lod = mesh.Simplify(0.5f);
+    assert(lod);
+
+    const auto& index_array = lod->GetIndexArray(0);
+    cout << "LOD: " << index_array.GetIndexCount() / 3 << " triangles, "
+         << lod->GetVertexCount() << " vertices" << endl;
+
+    assert(index_array.GetIndexCount() <= indices.size() / 2);
+    // unreferenced vertices are dropped from the LOD
+    assert(lod->GetVertexCount() < mesh.GetVertexCount());
+    assert(index_array.GetIndexType() == IndexDataType::kIndexDataTypeInt16);
+
+    SceneObjectGeometry geometry;
+    geometry.AddMesh(make_shared<SceneObjectMesh>(std::move(mesh)));
+    geometry.GenerateLods(4);
+    cout << "LOD count: " << geometry.GetLodCount() << endl;
+    assert(geometry.GetLodCount() == 4);
+}
+
+int main(int argc, char** argv) {
+    simplify_test();
+    scene_object_mesh_test();
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#include "Meshlet.hpp"
+#include "SceneObjectMesh.hpp"
+
+using namespace My;
+using namespace std;
+
+// build a closed unit sphere by subdividing an octahedron
+void build_sphere(vector<float>& positions, vector<uint32_t>& indices,
+                  const uint32_t subdivisions) {
+    positions = {1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1};
+    indices = {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,
+               2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5};
+
+    for (uint32_t s = 0; s < subdivisions; s++) {
+        map<pair<uint32_t, uint32_t>, uint32_t> midpoints;
+        auto midpoint = [&](uint32_t a, uint32_t b) {
+            auto key = make_pair(min(a, b), max(a, b));
+            auto it = midpoints.find(key);
+            if (it != midpoints.end()) return it->second;
+
+            float p[3];
+            for (size_t k = 0; k < 3; k++) {
+                p[k] = (positions[a * 3 + k] + positions[b * 3 + k]) * 0.5f;
+            }
+            const float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            auto index = static_cast<uint32_t>(positions.size() / 3);
+            for (size_t k = 0; k < 3; k++) {
+                positions.push_back(p[k] / length);
+            }
+            midpoints.emplace(key, index);
+            return index;
+        };
+
+        vector<uint32_t> subdivided;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            uint32_t ab = midpoint(a, b), bc = midpoint(b, c),
+                     ca = midpoint(c, a);
+            subdivided.insert(subdivided.end(), {a, ab, ca, ab, b, bc, ca, bc,
+                                                 c, ab, bc, ca});
+        }
+        indices = std::move(subdivided);
+    }
+}
+
+// canonical sorted list of triangles (with winding) for comparison
+vector<array<uint32_t, 3>> canonical(const vector<uint32_t>& indices) {
+    vector<array<uint32_t, 3>> result;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        array<uint32_t, 3> t = {indices[i], indices[i + 1], indices[i + 2]};
+        rotate(t.begin(), min_element(t.begin(), t.end()), t.end());
+        result.push_back(t);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+Vector3f position_of(const vector<float>& positions, uint32_t index) {
+    return Vector3f({positions[index * 3], positions[index * 3 + 1],
+                     positions[index * 3 + 2]});
+}
+
+void build_test(const vector<float>& positions,
+                const vector<uint32_t>& original,
+                const vector<uint32_t>& indices,
+                const vector<Meshlet>& meshlets) {
+    cout << "Meshlets: " << meshlets.size() << " for "
+         << original.size() / 3 << " triangles" << endl;
+
+    assert(canonical(original) == canonical(indices));
+
+    uint32_t offset = 0;
+    for (const auto& meshlet : meshlets) {
+        // meshlets tile the index buffer
+        assert(meshlet.index_offset == offset);
+        offset += meshlet.index_count;
+
+        assert(meshlet.index_count / 3 <= kMeshletMaxTriangles);
+        assert(meshlet.vertex_count <= kMeshletMaxVertices);
+
+        vector<uint32_t> vertices(indices.begin() + meshlet.index_offset,
+                                  indices.begin() + meshlet.index_offset +
+                                      meshlet.index_count);
+        sort(vertices.begin(), vertices.end());
+        vertices.erase(unique(vertices.begin(), vertices.end()),
+                       vertices.end());
+        assert(vertices.size() == meshlet.vertex_count);
+
+        // the bounding sphere contains the whole cluster
+        for (const auto v : vertices) {
+            const Vector3f d = position_of(positions, v) - meshlet.center;
+            assert(Length(d) <= meshlet.radius * 1.0001f);
+        }
+    }
+    assert(offset == indices.size());
+
+    // a fine sphere is made of clusters with narrow normal cones
+    size_t with_cone = 0;
+    for (const auto& meshlet : meshlets) {
+        if (Length(meshlet.cone_axis) > 0.0f) with_cone++;
+    }
+    assert(with_cone == meshlets.size());
+}
+
+// every triangle facing the camera with a vertex in the frustum must be
+// in one of the ranges
+void cull_test(const vector<float>& positions, const vector<uint32_t>& indices,
+               const vector<Meshlet>& meshlets, const Vector3f& eye,
+               const Vector3f& look_at) {
+    Matrix4X4f view, projection;
+    BuildViewRHMatrix(view, eye, look_at, Vector3f({0.0f, 0.0f, 1.0f}));
+    BuildPerspectiveFovRHMatrix(projection, PI / 4.0f, 1.0f, 0.1f, 100.0f);
+    const Matrix4X4f view_projection = view * projection;
+
+    vector<IndexRange> ranges;
+    const auto visible = CullMeshlets(ranges, meshlets, view_projection, eye);
+
+    vector<bool> drawn(indices.size() / 3, false);
+    size_t drawn_triangles = 0;
+    for (const auto& range : ranges) {
+        for (uint32_t i = range.offset; i < range.offset + range.count;
+             i += 3) {
+            drawn[i / 3] = true;
+            drawn_triangles++;
+        }
+    }
+
+    size_t needed_triangles = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const Vector3f p0 = position_of(positions, indices[i]);
+        const Vector3f p1 = position_of(positions, indices[i + 1]);
+        const Vector3f p2 = position_of(positions, indices[i + 2]);
+
+        Vector3f normal;
+        CrossProduct(normal, p1 - p0, p2 - p0);
+        float facing;
+        DotProduct(facing, normal, eye - p0);
+        if (facing <= 0.0f) continue;
+
+        bool inside = false;
+        for (const auto& p : {p0, p1, p2}) {
+            Vector4f clip({p[0], p[1], p[2], 1.0f});
+            Transform(clip, view_projection);
+            if (fabsf(clip[0]) <= clip[3] && fabsf(clip[1]) <= clip[3] &&
+                clip[2] >= -clip[3] && clip[2] <= clip[3]) {
+                inside = true;
+            }
+        }
+        if (!inside) continue;
+
+        needed_triangles++;
+        assert(drawn[i / 3]);
+    }
+
+    cout << "Visible meshlets: " << visible << "/" << meshlets.size()
+         << ", ranges: " << ranges.size() << ", triangles drawn "
+         << drawn_triangles << " (needed " << needed_triangles << " of "
+         << indices.size() / 3 << ")" << endl;
+
+    assert(drawn_triangles >= needed_triangles);
+}
+
+void scene_object_mesh_test(const vector<float>& positions,
+                            const vector<uint32_t>& indices) {
+    auto* vertex_data = new float[positions.size()];
+    memcpy(vertex_data, positions.data(), positions.size() * sizeof(float));
+    auto* index_data = new uint32_t[indices.size()];
+    memcpy(index_data, indices.data(), indices.size() * sizeof(uint32_t));
+
+    SceneObjectMesh mesh;
+    mesh.SetPrimitiveType(PrimitiveType::kPrimitiveTypeTriList);
+    mesh.AddVertexArray(SceneObjectVertexArray(
+        "position", 0, VertexDataType::kVertexDataTypeFloat3,
+        reinterpret_cast<uint8_t*>(vertex_data), positions.size()));
+    mesh.AddIndexArray(SceneObjectIndexArray(
+        0, 0, IndexDataType::kIndexDataTypeInt32,
+        reinterpret_cast<uint8_t*>(index_data), indices.size()));
+
+    mesh.BuildMeshlets();
+
+    const auto& meshlets = mesh.GetMeshlets(0);
+    const auto& index_array = mesh.GetIndexArray(0);
+    assert(!meshlets.empty());
+    assert(index_array.GetIndexCount() == indices.size());
+    assert(meshlets.back().index_offset + meshlets.back().index_count ==
+           indices.size());
+
+    vector<uint32_t> reordered;
+    const auto* data = reinterpret_cast<const uint16_t*>(index_array.GetData());
+    assert(index_array.GetIndexType() == IndexDataType::kIndexDataTypeInt16);
+    reordered.assign(data, data + index_array.GetIndexCount());
+    assert(canonical(reordered) == canonical(indices));
+}
+
+int main(int argc, char** argv) {
+    vector<float> positions;
+    vector<uint32_t> original;
+    build_sphere(positions, original, 6);
+    const size_t vertex_count = positions.size() / 3;
+
+    vector<uint32_t> indices = original;
+    auto meshlets =
+        BuildMeshlets(indices, positions.data(), vertex_count, 3);
+
+    build_test(positions, original, indices, meshlets);
+    scene_object_mesh_test(positions, original);
+
+    // looking at the sphere, the back half is culled by the normal cones
+    cull_test(positions, indices, meshlets, Vector3f({0.0f, -5.0f, 0.0f}),
+              Vector3f({0.0f, 0.0f, 0.0f}));
+
+    // close up, most of the sphere is outside of the frustum
+    cull_test(positions, indices, meshlets, Vector3f({0.0f, -1.5f, 0.0f}),
+              Vector3f({0.0f, 0.0f, 1.0f}));
+
+    // looking away, nothing should be left
+    vector<IndexRange> ranges;
+    Matrix4X4f view, projection;
+    Vector3f eye({0.0f, -5.0f, 0.0f});
+    BuildViewRHMatrix(view, eye, Vector3f({0.0f, -10.0f, 0.0f}),
+                      Vector3f({0.0f, 0.0f, 1.0f}));
+    BuildPerspectiveFovRHMatrix(projection, PI / 4.0f, 1.0f, 0.1f, 100.0f);
+    auto visible = CullMeshlets(ranges, meshlets, view * projection, eye);
+    assert(visible == 0 && ranges.empty());
+
+    return 0;
+}
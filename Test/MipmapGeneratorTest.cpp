@@ -0,0 +1,325 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+
+#include "MipmapGenerator.hpp"
+#include "portable.hpp"
+
+using namespace My;
+using namespace std;
+
+// an image with a single level of bytes_per_texel texels, rows 4 byte aligned
+static Image make_image(const uint32_t width, const uint32_t height,
+                        const PIXEL_FORMAT format,
+                        const uint32_t bytes_per_texel,
+                        const bool is_float = false,
+                        const uint32_t faces = 1) {
+    Image image;
+    image.Width = width;
+    image.Height = height;
+    image.pixel_format = format;
+    image.bitcount = bytes_per_texel * 8;
+    image.is_float = is_float;
+    image.face_count = faces;
+    image.pitch = ALIGN((size_t)width * bytes_per_texel, 4);
+    const size_t face_size = image.pitch * height;
+    image.data_size = face_size * faces;
+    image.data = new uint8_t[image.data_size]();
+    for (uint32_t face = 0; face < faces; face++) {
+        image.mipmaps.emplace_back(width, height, image.pitch,
+                                   face * face_size, face_size);
+    }
+    return image;
+}
+
+static uint8_t* texel(Image& image, const uint32_t level, const uint32_t x,
+                      const uint32_t y, const uint32_t face = 0) {
+    const auto& mip = image.GetSubresource(level, face);
+    return image.data + mip.offset + y * mip.pitch +
+           (size_t)x * (image.bitcount >> 3);
+}
+
+// every texel of every level passes the predicate
+static bool all_texels(Image& image, const uint32_t face,
+                       const function<bool(const uint8_t*)>& predicate) {
+    for (uint32_t level = 0; level < image.GetMipLevels(); level++) {
+        const auto& mip = image.GetSubresource(level, face);
+        for (uint32_t y = 0; y < mip.Height; y++) {
+            for (uint32_t x = 0; x < mip.Width; x++) {
+                if (!predicate(texel(image, level, x, y, face))) return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void chain_test() {
+    Image image = make_image(13, 7, PIXEL_FORMAT::RGB8, 3);
+    for (size_t i = 0; i < image.data_size; i++) {
+        image.data[i] = static_cast<uint8_t>(i * 7);
+    }
+    const Image original = make_image(13, 7, PIXEL_FORMAT::RGB8, 3);
+    memcpy(original.data, image.data, image.data_size);
+
+    assert(GenerateMipmaps(image));
+    const uint32_t sizes[][2] = {{13, 7}, {6, 3}, {3, 1}, {1, 1}};
+    assert(image.GetMipLevels() == 4);
+    // the levels follow each other, rows 4 byte aligned
+    size_t offset = 0;
+    for (uint32_t level = 0; level < 4; level++) {
+        const auto& mip = image.GetSubresource(level);
+        assert(mip.Width == sizes[level][0] && mip.Height == sizes[level][1]);
+        assert(mip.pitch == ALIGN(mip.Width * 3, 4));
+        assert(mip.offset == offset);
+        offset += mip.pitch * mip.Height;
+    }
+    assert(image.data_size == offset);
+
+    // level 0 is kept as is
+    bool same = true;
+    for (uint32_t y = 0; y < 7; y++) {
+        same &= memcmp(image.data + y * image.pitch,
+                       original.data + y * original.pitch, 13 * 3) == 0;
+    }
+    assert(same);
+
+    Image limited = make_image(16, 16, PIXEL_FORMAT::R8, 1);
+    MipmapOptions options;
+    options.max_levels = 2;
+    assert(GenerateMipmaps(limited, options) && limited.GetMipLevels() == 2);
+}
+
+static void box_test() {
+    // the 2x2 footprints average exactly
+    Image image = make_image(4, 4, PIXEL_FORMAT::RGBA8, 4);
+    for (uint32_t y = 0; y < 4; y++) {
+        for (uint32_t x = 0; x < 4; x++) {
+            uint8_t* p = texel(image, 0, x, y);
+            p[0] = static_cast<uint8_t>(10 * (x + 1));
+            p[1] = static_cast<uint8_t>(20 * (y + 1));
+            p[2] = static_cast<uint8_t>(4 * (x + y * 4));
+            p[3] = 255;
+        }
+    }
+    MipmapOptions options;
+    options.filter = MIPMAP_FILTER::Box;
+    assert(GenerateMipmaps(image, options) && image.GetMipLevels() == 3);
+    const uint8_t* p = texel(image, 1, 1, 0);
+    assert(p[0] == 35 && p[1] == 30 && p[2] == 18 && p[3] == 255);
+    p = texel(image, 2, 0, 0);
+    assert(p[0] == 25 && p[1] == 50 && p[2] == 30 && p[3] == 255);
+}
+
+static void srgb_test() {
+    // black and white average to middle gray in linear light, alpha linear
+    for (const bool srgb : {false, true}) {
+        Image image = make_image(2, 1, PIXEL_FORMAT::RGBA8, 4);
+        memset(texel(image, 0, 1, 0), 255, 4);
+        MipmapOptions options;
+        options.filter = MIPMAP_FILTER::Box;
+        options.srgb = srgb;
+        GenerateMipmaps(image, options);
+        const uint8_t* p = texel(image, 1, 0, 0);
+        cout << (srgb ? "sRGB" : "linear") << " average of 0 and 255: "
+             << (int)p[0] << ", alpha " << (int)p[3] << endl;
+        assert(p[0] == (srgb ? 188 : 128) && p[1] == p[0] && p[2] == p[0]);
+        assert(p[3] == 128);
+    }
+}
+
+static void normal_map_test() {
+    mt19937 generator(7);
+    uniform_real_distribution<float> angle(0.0f, 1.2f);
+    Image image = make_image(32, 32, PIXEL_FORMAT::RGB8, 3);
+    for (uint32_t y = 0; y < 32; y++) {
+        for (uint32_t x = 0; x < 32; x++) {
+            const float theta = angle(generator);
+            const float phi = angle(generator) * 5.0f;
+            const float n[3] = {sinf(theta) * cosf(phi),
+                                sinf(theta) * sinf(phi), cosf(theta)};
+            uint8_t* p = texel(image, 0, x, y);
+            for (uint32_t c = 0; c < 3; c++) {
+                p[c] = static_cast<uint8_t>(lroundf(n[c] * 127.5f + 127.5f));
+            }
+        }
+    }
+    MipmapOptions options;
+    options.normal_map = true;
+    assert(GenerateMipmaps(image, options));
+
+    float worst = 0.0f;
+    for (uint32_t level = 1; level < image.GetMipLevels(); level++) {
+        const auto& mip = image.GetSubresource(level);
+        for (uint32_t y = 0; y < mip.Height; y++) {
+            for (uint32_t x = 0; x < mip.Width; x++) {
+                const uint8_t* p = texel(image, level, x, y);
+                float length = 0.0f;
+                for (uint32_t c = 0; c < 3; c++) {
+                    const float v = p[c] / 127.5f - 1.0f;
+                    length += v * v;
+                }
+                worst = max(worst, fabsf(sqrtf(length) - 1.0f));
+            }
+        }
+    }
+    cout << "normal map: worst unit length error " << worst << endl;
+    assert(worst < 0.02f);
+}
+
+static double coverage(Image& image, const uint32_t level,
+                       const uint8_t reference) {
+    const auto& mip = image.GetSubresource(level);
+    size_t passed = 0;
+    for (uint32_t y = 0; y < mip.Height; y++) {
+        for (uint32_t x = 0; x < mip.Width; x++) {
+            passed += texel(image, level, x, y)[3] >= reference;
+        }
+    }
+    return (double)passed / (mip.Width * mip.Height);
+}
+
+static void alpha_coverage_test() {
+    // thin blades of grass every 32 texels, soft edged
+    for (const bool keep : {false, true}) {
+        Image image = make_image(64, 64, PIXEL_FORMAT::RGBA8, 4);
+        for (uint32_t y = 0; y < 64; y++) {
+            for (uint32_t x = 0; x < 64; x++) {
+                const float d = fabsf((float)(x % 32) - 16.0f);
+                uint8_t* p = texel(image, 0, x, y);
+                p[0] = p[1] = p[2] = 200;
+                p[3] = static_cast<uint8_t>(
+                    lroundf(max(0.0f, 1.0f - d / 2.0f) * 255.0f));
+            }
+        }
+        MipmapOptions options;
+        options.alpha_reference = keep ? 0.5f : 0.0f;
+        GenerateMipmaps(image, options);
+
+        // the levels still wide enough for the blades to stand apart
+        const double expected = coverage(image, 0, 128);
+        double worst = 0.0;
+        for (uint32_t level = 1; (64u >> level) >= 16; level++) {
+            worst = max(worst, fabs(coverage(image, level, 128) - expected));
+        }
+        cout << "alpha coverage " << expected << (keep ? ", kept" : ", as is")
+             << ": worst level error " << worst << endl;
+        if (keep) assert(worst < 0.07);
+    }
+}
+
+static void format_test() {
+    // constants stay constant through every filter and format
+    for (const auto filter : {MIPMAP_FILTER::Box, MIPMAP_FILTER::Kaiser,
+                              MIPMAP_FILTER::Lanczos}) {
+        MipmapOptions options;
+        options.filter = filter;
+
+        Image half = make_image(9, 5, PIXEL_FORMAT::RGBA16, 8, true);
+        const uint16_t half_values[4] = {0x3800, 0x63D0, 0xC000, 0x3C00};
+        for (uint32_t y = 0; y < 5; y++) {
+            for (uint32_t x = 0; x < 9; x++) {
+                memcpy(texel(half, 0, x, y), half_values, 8);
+            }
+        }
+        assert(GenerateMipmaps(half, options));
+        assert(all_texels(half, 0, [&](const uint8_t* p) {
+            return memcmp(p, half_values, 8) == 0;
+        }));
+
+        Image single = make_image(7, 6, PIXEL_FORMAT::RGB32, 12, true);
+        const float float_values[3] = {3.25f, -1.5f, 0.0f};
+        for (uint32_t y = 0; y < 6; y++) {
+            for (uint32_t x = 0; x < 7; x++) {
+                memcpy(texel(single, 0, x, y), float_values, 12);
+            }
+        }
+        assert(GenerateMipmaps(single, options));
+        assert(all_texels(single, 0, [&](const uint8_t* p) {
+            float v[3];
+            memcpy(v, p, 12);
+            for (uint32_t c = 0; c < 3; c++) {
+                if (fabsf(v[c] - float_values[c]) > 1e-5f) return false;
+            }
+            return true;
+        }));
+
+        Image unorm16 = make_image(5, 5, PIXEL_FORMAT::RG16, 4);
+        const uint16_t unorm16_values[2] = {40000, 123};
+        for (uint32_t y = 0; y < 5; y++) {
+            for (uint32_t x = 0; x < 5; x++) {
+                memcpy(texel(unorm16, 0, x, y), unorm16_values, 4);
+            }
+        }
+        assert(GenerateMipmaps(unorm16, options));
+        assert(all_texels(unorm16, 0, [&](const uint8_t* p) {
+            return memcmp(p, unorm16_values, 4) == 0;
+        }));
+
+        Image packed = make_image(6, 3, PIXEL_FORMAT::R10G10B10A2, 4);
+        const uint32_t packed_value = 700 | (12 << 10) | (1023u << 20) |
+                                      (2u << 30);
+        for (uint32_t y = 0; y < 3; y++) {
+            for (uint32_t x = 0; x < 6; x++) {
+                memcpy(texel(packed, 0, x, y), &packed_value, 4);
+            }
+        }
+        assert(GenerateMipmaps(packed, options));
+        assert(all_texels(packed, 0, [&](const uint8_t* p) {
+            return memcmp(p, &packed_value, 4) == 0;
+        }));
+
+        Image rgb565 = make_image(3, 6, PIXEL_FORMAT::R5G6B5, 2);
+        const uint16_t rgb565_value = (17 << 11) | (50 << 5) | 3;
+        for (uint32_t y = 0; y < 6; y++) {
+            for (uint32_t x = 0; x < 3; x++) {
+                memcpy(texel(rgb565, 0, x, y), &rgb565_value, 2);
+            }
+        }
+        assert(GenerateMipmaps(rgb565, options));
+        assert(all_texels(rgb565, 0, [&](const uint8_t* p) {
+            return memcmp(p, &rgb565_value, 2) == 0;
+        }));
+    }
+}
+
+static void cube_test() {
+    // the faces are filtered apart and stay in layer, face, level order
+    Image cube = make_image(8, 8, PIXEL_FORMAT::RGBA8, 4, false, 6);
+    for (uint32_t face = 0; face < 6; face++) {
+        memset(cube.data + cube.mipmaps[face].offset,
+               static_cast<int>(face * 40), cube.mipmaps[face].data_size);
+    }
+    assert(GenerateMipmaps(cube) && cube.GetMipLevels() == 4 &&
+           cube.mipmaps.size() == 24);
+    for (uint32_t face = 0; face < 6; face++) {
+        assert(all_texels(cube, face, [&](const uint8_t* p) {
+            return p[0] == face * 40 && p[3] == face * 40;
+        }));
+    }
+}
+
+static void rejection_test() {
+    Image depth = make_image(4, 4, PIXEL_FORMAT::D24R8, 4);
+    assert(!GenerateMipmaps(depth) && depth.mipmaps.size() == 1);
+
+    Image compressed = make_image(8, 8, PIXEL_FORMAT::RGBA8, 4);
+    compressed.compressed = true;
+    compressed.compress_format = COMPRESSED_FORMAT::BC1;
+    assert(!GenerateMipmaps(compressed) && compressed.mipmaps.size() == 1);
+}
+
+int main(int argc, char** argv) {
+    chain_test();
+    box_test();
+    srgb_test();
+    normal_map_test();
+    alpha_coverage_test();
+    format_test();
+    cube_test();
+    rejection_test();
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <cassert>
+#include <iostream>
+#include <numeric>
+#include <set>
+
+#include "Empty/EmptyGraphicsManager.hpp"
+
+using namespace My;
+using namespace std;
+
+void split_test(const size_t batch_count, const size_t max_ranges,
+                const size_t min_batches_per_range) {
+    const auto ranges =
+        SplitBatchRanges(batch_count, max_ranges, min_batches_per_range);
+
+    cout << batch_count << " batches -> " << ranges.size() << " ranges"
+         << endl;
+
+    if (batch_count == 0) {
+        assert(ranges.empty());
+        return;
+    }
+
+    assert(!ranges.empty() && ranges.size() <= max_ranges);
+
+    // the ranges tile the batches in order
+    size_t begin = 0;
+    for (const auto& range : ranges) {
+        assert(range.begin == begin);
+        assert(range.end > range.begin);
+        if (ranges.size() > 1) {
+            assert(range.end - range.begin >= min_batches_per_range);
+        }
+        begin = range.end;
+    }
+    assert(begin == batch_count);
+}
+
+class TestGraphicsManager : public EmptyGraphicsManager {
+   public:
+    explicit TestGraphicsManager(const uint32_t jobs) {
+        m_nMaxRecordingJobs = jobs;
+    }
+    Frame& GetFrame() { return m_Frames[0]; }
+};
+
+int main(int argc, char** argv) {
+    split_test(0, 8, 16);
+    split_test(1, 8, 16);
+    split_test(15, 8, 16);
+    split_test(33, 8, 16);
+    split_test(1000, 8, 16);
+    split_test(1000, 1, 16);
+    split_test(7, 8, 1);
+
+    TestGraphicsManager graphics_manager(4);
+    auto& frame = graphics_manager.GetFrame();
+
+    const int32_t batch_count = 1000;
+    for (int32_t i = 0; i < batch_count; i++) {
+        auto dbc = make_shared<DrawBatchContext>();
+        dbc->batchIndex = i;
+        dbc->lod = i % 3;
+        dbc->occluded = (i % 7 == 0);
+        frame.batchContexts.push_back(dbc);
+    }
+    vector<uint32_t> batches(batch_count);
+    iota(batches.begin(), batches.end(), 0);
+
+    // the executed draws must come in batch order every time, whatever the
+    // order the lists were recorded in
+    for (int32_t pass = 0; pass < 20; pass++) {
+        graphics_manager.ClearExecutedDraws();
+        graphics_manager.DrawBatch(frame, batches);
+
+        const auto& draws = graphics_manager.GetExecutedDraws();
+        set<uint32_t> lists;
+        int32_t expected = 0;
+        for (const auto& draw : draws) {
+            while (expected % 7 == 0) expected++;
+            assert(draw.batchIndex == expected);
+            assert(draw.lod == static_cast<uint32_t>(expected % 3));
+            lists.insert(draw.commandList);
+            expected++;
+        }
+        while (expected < batch_count && expected % 7 == 0) expected++;
+        assert(expected == batch_count);
+
+        if (pass == 0) {
+            cout << draws.size() << " draws recorded into " << lists.size()
+                 << " command lists" << endl;
+        }
+
+        assert(lists.size() == 4);
+    }
+
+    // a part of the batches, such as the casters of a shadow map or the
+    // batches of a shader variant, draws only those, in list order
+    vector<uint32_t> odd_batches;
+    for (uint32_t i = 1; i < batch_count; i += 2) {
+        odd_batches.push_back(i);
+    }
+    graphics_manager.ClearExecutedDraws();
+    graphics_manager.DrawBatch(frame, odd_batches);
+    int32_t expected = 1;
+    for (const auto& draw : graphics_manager.GetExecutedDraws()) {
+        while (expected % 7 == 0) expected += 2;
+        assert(draw.batchIndex == expected);
+        expected += 2;
+    }
+    assert(expected >= batch_count);
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "PipelineStateCache.hpp"
+
+using namespace My;
+using namespace std;
+
+namespace {
+const char kVertexShader[] = "void main() { gl_Position = vec4(0.0); }";
+const char kPixelShader[] = "void main() { outputColor = vec4(1.0); }";
+
+vector<PipelineShaderStage> stages(const char* vs, const char* ps) {
+    return {{0, vs, strlen(vs)}, {1, ps, strlen(ps)}};
+}
+
+PipelineState base_state() {
+    PipelineState state;
+    state.pipelineStateName = "BASIC";
+    state.depthTestMode = DEPTH_TEST_MODE::LESS_EQUAL;
+    state.a2vType = A2V_TYPES::A2V_TYPES_FULL;
+    state.flag = PIPELINE_FLAG::NONE;
+    return state;
+}
+
+vector<uint8_t> read_file(const string& path) {
+    ifstream file(path, ios::binary);
+    return vector<uint8_t>(istreambuf_iterator<char>(file),
+                           istreambuf_iterator<char>());
+}
+
+void write_file(const string& path, const vector<uint8_t>& data) {
+    ofstream file(path, ios::binary | ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    // keys
+    const auto shaders = stages(kVertexShader, kPixelShader);
+    const PipelineState state = base_state();
+    const uint64_t key = HashPipelineState(state, shaders);
+    assert(key == HashPipelineState(base_state(), shaders));
+
+    PipelineState renamed = state;
+    renamed.pipelineStateName = "BASIC_COPY";
+    assert(HashPipelineState(renamed, shaders) == key);
+
+    const char kOtherPixelShader[] = "void main() { outputColor = vec4(0.5); }";
+    assert(HashPipelineState(state, stages(kVertexShader, kOtherPixelShader)) !=
+           key);
+    // the same code in another stage is another pipeline
+    assert(HashPipelineState(state, stages(kPixelShader, kVertexShader)) !=
+           key);
+
+    auto differs = [&](auto change) {
+        PipelineState changed = state;
+        change(changed);
+        return HashPipelineState(changed, shaders) != key;
+    };
+    assert(differs([](auto& s) { s.a2vType = A2V_TYPES::A2V_TYPES_SIMPLE; }));
+    assert(differs([](auto& s) { s.depthTestMode = DEPTH_TEST_MODE::LESS; }));
+    assert(differs([](auto& s) { s.bDepthWrite = false; }));
+    assert(differs([](auto& s) { s.cullFaceMode = CULL_FACE_MODE::FRONT; }));
+    assert(differs([](auto& s) { s.pixelFormat = PIXEL_FORMAT::RGBA16; }));
+    assert(differs([](auto& s) { s.sampleCount = 4; }));
+    assert(differs([](auto& s) { s.flag = PIPELINE_FLAG::SHADOW; }));
+    assert(differs([](auto& s) { s.pipelineType = PIPELINE_TYPE::COMPUTE; }));
+
+    cout << "key tests passed" << endl;
+
+    // persistence
+    const auto directory =
+        (filesystem::temp_directory_path() / "PipelineStateCacheTest")
+            .string();
+    filesystem::remove_all(directory);
+
+    const vector<uint8_t> binary = {0xde, 0xad, 0xbe, 0xef, 1, 2, 3, 4, 5};
+    uint32_t format;
+    vector<uint8_t> loaded;
+
+    {
+        PipelineStateCache cache;
+        assert(!cache.Load(key, format, loaded));
+        assert(cache.Open(directory, "GPU 1.0"));
+        assert(!cache.Load(key, format, loaded) && cache.GetMissCount() == 1);
+        assert(cache.Store(key, 0x8741, binary.data(), binary.size()));
+        cache.Close();
+    }
+
+    PipelineStateCache cache;
+    assert(cache.Open(directory, "GPU 1.0"));
+    assert(cache.Load(key, format, loaded));
+    assert(format == 0x8741 && loaded == binary && cache.GetHitCount() == 1);
+
+    // damaged entries are rejected and removed
+    const auto path = cache.GetEntryPath(key);
+    const auto entry = read_file(path);
+    auto rejected = [&](const vector<uint8_t>& file) {
+        write_file(path, file);
+        const uint32_t count = cache.GetRejectedCount();
+        const bool refused = !cache.Load(key, format, loaded) &&
+                             loaded.empty() &&
+                             cache.GetRejectedCount() == count + 1;
+        return refused && !filesystem::exists(path);
+    };
+
+    assert(rejected(vector<uint8_t>(entry.begin(), entry.end() - 1)));
+    assert(rejected(vector<uint8_t>(entry.begin(), entry.begin() + 8)));
+    auto corrupted = entry;
+    corrupted.back() ^= 0xff;
+    assert(rejected(corrupted));
+    auto longer = entry;
+    longer.push_back(0);
+    assert(rejected(longer));
+    // the entry of another key copied over
+    write_file(cache.GetEntryPath(key + 1), entry);
+    assert(!cache.Load(key + 1, format, loaded));
+    assert(!filesystem::exists(cache.GetEntryPath(key + 1)));
+
+    // a driver update invalidates the entries
+    write_file(path, entry);
+    {
+        PipelineStateCache other;
+        assert(other.Open(directory, "GPU 1.1"));
+        assert(!other.Load(key, format, loaded));
+        assert(other.GetRejectedCount() == 1);
+    }
+
+    // so does the driver refusing the binary
+    write_file(path, entry);
+    assert(cache.Load(key, format, loaded));
+    cache.Remove(key);
+    assert(!filesystem::exists(path));
+
+    cache.Close();
+    filesystem::remove_all(directory);
+
+    cout << "persistence tests passed" << endl;
+
+    return 0;
+}
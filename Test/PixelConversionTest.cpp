@@ -0,0 +1,325 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "PixelConversion.hpp"
+
+using namespace My;
+using namespace std;
+
+static uint32_t float_bits(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// the value of a half by its definition
+static float reference_half(const uint16_t half) {
+    const float sign = (half & 0x8000) ? -1.0f : 1.0f;
+    const int32_t exponent = (half >> 10) & 0x1F;
+    const int32_t mantissa = half & 0x3FF;
+    if (exponent == 0x1F) {
+        return mantissa ? NAN : sign * INFINITY;
+    }
+    if (!exponent) return sign * ldexpf((float)mantissa, -24);
+    return sign * ldexpf((float)(mantissa | 0x400), exponent - 25);
+}
+
+static void half_test() {
+    // every half to float and back, in one call so the SIMD loops run
+    vector<uint16_t> halves(65536);
+    for (uint32_t i = 0; i < 65536; i++) {
+        halves[i] = static_cast<uint16_t>(i);
+    }
+    vector<float> floats(65536);
+    ConvertHalfToFloat(halves.data(), floats.data(), 65536);
+    vector<uint16_t> back(65536);
+    ConvertFloatToHalf(floats.data(), back.data(), 65536);
+
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < 65536; i++) {
+        const float expected = reference_half(static_cast<uint16_t>(i));
+        const bool nan = std::isnan(expected);
+        if (nan ? !std::isnan(floats[i])
+                : float_bits(floats[i]) != float_bits(expected)) {
+            wrong++;
+        }
+        if (nan ? (back[i] & 0x7FFF) <= 0x7C00 || (back[i] ^ i) & 0x8000
+                : back[i] != i) {
+            wrong++;
+        }
+    }
+    cout << "halves: " << wrong << " wrong of 65536" << endl;
+    assert(!wrong);
+
+    // half way between neighbors rounds to the even one, then overflow
+    vector<float> values;
+    vector<uint16_t> expected;
+    for (uint32_t i = 0; i < 0x7BFF; i += 37) {
+        const float low = reference_half(static_cast<uint16_t>(i));
+        const float high = reference_half(static_cast<uint16_t>(i + 1));
+        values.push_back((low + high) * 0.5f);
+        expected.push_back(static_cast<uint16_t>((i & 1) ? i + 1 : i));
+        values.push_back(-(low + high) * 0.5f);
+        expected.push_back(static_cast<uint16_t>(0x8000 | expected.back()));
+    }
+    const float edges[] = {65504.0f, 65519.0f, 65520.0f, 1e10f, -1e10f,
+                           1e-10f, 5.9604645e-8f, 2.9802322e-8f};
+    const uint16_t edge_halves[] = {0x7BFF, 0x7BFF, 0x7C00, 0x7C00,
+                                    0xFC00, 0x0000, 0x0001, 0x0000};
+    for (size_t i = 0; i < size(edges); i++) {
+        values.push_back(edges[i]);
+        expected.push_back(edge_halves[i]);
+    }
+    vector<uint16_t> rounded(values.size());
+    ConvertFloatToHalf(values.data(), rounded.data(),
+                       static_cast<int32_t>(values.size()));
+    assert(rounded == expected);
+}
+
+static void unorm_test() {
+    vector<uint8_t> bytes(256);
+    for (uint32_t i = 0; i < 256; i++) bytes[i] = static_cast<uint8_t>(i);
+    vector<float> floats(256);
+    ConvertUnorm8ToFloat(bytes.data(), floats.data(), 256);
+    vector<uint8_t> back(256);
+    ConvertFloatToUnorm8(floats.data(), back.data(), 256);
+    bool exact = back == bytes;
+    for (uint32_t i = 0; i < 256; i++) {
+        exact &= fabsf(floats[i] - i / 255.0f) < 1e-6f;
+    }
+    assert(exact);
+
+    vector<uint16_t> words(65536);
+    for (uint32_t i = 0; i < 65536; i++) words[i] = static_cast<uint16_t>(i);
+    floats.resize(65536);
+    ConvertUnorm16ToFloat(words.data(), floats.data(), 65536);
+    vector<uint16_t> words_back(65536);
+    ConvertFloatToUnorm16(floats.data(), words_back.data(), 65536);
+    assert(words_back == words);
+
+    // out of range and NaN saturate, in the SIMD loop and in the tail
+    vector<float> odd(35);
+    for (size_t i = 0; i < odd.size(); i++) {
+        const float pattern[] = {-1.0f, 2.0f, NAN, 0.5f, -INFINITY};
+        odd[i] = pattern[i % 5];
+    }
+    vector<uint8_t> saturated(odd.size());
+    ConvertFloatToUnorm8(odd.data(), saturated.data(), (int32_t)odd.size());
+    vector<uint16_t> saturated16(odd.size());
+    ConvertFloatToUnorm16(odd.data(), saturated16.data(), (int32_t)odd.size());
+    bool ok = true;
+    for (size_t i = 0; i < odd.size(); i++) {
+        const uint8_t expected[] = {0, 255, 0, 128, 0};
+        const uint16_t expected16[] = {0, 65535, 0, 32768, 0};
+        ok &= saturated[i] == expected[i % 5];
+        ok &= saturated16[i] == expected16[i % 5];
+    }
+    assert(ok);
+}
+
+struct Format {
+    const char* name;
+    PIXEL_FORMAT format;
+    bool is_float;
+};
+
+const Format formats[] = {
+    {"R8", PIXEL_FORMAT::R8, false},
+    {"RG8", PIXEL_FORMAT::RG8, false},
+    {"RGB8", PIXEL_FORMAT::RGB8, false},
+    {"RGBA8", PIXEL_FORMAT::RGBA8, false},
+    {"R16", PIXEL_FORMAT::R16, false},
+    {"RGB16", PIXEL_FORMAT::RGB16, false},
+    {"RGBA16", PIXEL_FORMAT::RGBA16, false},
+    {"R16F", PIXEL_FORMAT::R16, true},
+    {"RG16F", PIXEL_FORMAT::RG16, true},
+    {"RGBA16F", PIXEL_FORMAT::RGBA16, true},
+    {"R32F", PIXEL_FORMAT::R32, true},
+    {"RGB32F", PIXEL_FORMAT::RGB32, true},
+    {"RGBA32F", PIXEL_FORMAT::RGBA32, true},
+    {"R10G10B10A2", PIXEL_FORMAT::R10G10B10A2, false},
+    {"R5G6B5", PIXEL_FORMAT::R5G6B5, false},
+};
+
+// random pixels that every format holds exactly
+static vector<uint8_t> random_pixels(const PixelLayout& layout,
+                                     const uint32_t count, mt19937& random) {
+    vector<float> rgba((size_t)count * 4);
+    for (auto& value : rgba) {
+        value = (random() % 4) / 3.0f;
+    }
+    vector<uint8_t> pixels((size_t)count * layout.bytes);
+    EncodePixels(rgba.data(), pixels.data(), layout, count);
+    return pixels;
+}
+
+static void convert_test() {
+    mt19937 random(11);
+    const uint32_t count = 77;  // SIMD loops and tails
+    PixelLayout rgba32f;
+    GetPixelLayout(PIXEL_FORMAT::RGBA32, true, rgba32f);
+    uint32_t pairs = 0;
+    for (const auto& from : formats) {
+        PixelLayout src;
+        const bool known = GetPixelLayout(from.format, from.is_float, src);
+        assert(known);
+        const auto pixels = random_pixels(src, count, random);
+
+        // through RGBA floats and back is lossless
+        vector<float> rgba((size_t)count * 4);
+        DecodePixels(pixels.data(), src, rgba.data(), count);
+        vector<uint8_t> back(pixels.size());
+        EncodePixels(rgba.data(), back.data(), src, count);
+        assert(back == pixels);
+
+        for (const auto& to : formats) {
+            PixelLayout dst;
+            GetPixelLayout(to.format, to.is_float, dst);
+            vector<uint8_t> converted((size_t)count * dst.bytes);
+            ConvertPixels(pixels.data(), src, converted.data(), dst, count);
+
+            // the same as going through floats, missing channels 0 and 1
+            vector<uint8_t> expected(converted.size());
+            EncodePixels(rgba.data(), expected.data(), dst, count);
+            if (converted != expected) {
+                cout << from.name << " to " << to.name << " ";
+            }
+            assert(converted == expected);
+            pairs++;
+        }
+    }
+    cout << pairs << " format pairs converted" << endl;
+
+    // missing channels
+    const uint8_t rgb[] = {10, 20, 30};
+    PixelLayout rgb8, rgba8, r16f;
+    GetPixelLayout(PIXEL_FORMAT::RGB8, false, rgb8);
+    GetPixelLayout(PIXEL_FORMAT::RGBA8, false, rgba8);
+    GetPixelLayout(PIXEL_FORMAT::R16, true, r16f);
+    uint8_t rgba[4];
+    ConvertPixels(rgb, rgb8, rgba, rgba8, 1);
+    // RGB8 to RGBA8 adds an opaque alpha
+    assert(rgba[0] == 10 && rgba[1] == 20 && rgba[2] == 30 && rgba[3] == 255);
+    float decoded[4];
+    const uint16_t half_two = 0x4000;
+    DecodePixels(reinterpret_cast<const uint8_t*>(&half_two), r16f, decoded,
+                 1);
+    assert(decoded[0] == 2.0f && decoded[1] == 0.0f && decoded[2] == 0.0f &&
+           decoded[3] == 1.0f);
+}
+
+static void swizzle_test() {
+    PixelLayout rgba8, rg8, r8;
+    GetPixelLayout(PIXEL_FORMAT::RGBA8, false, rgba8);
+    GetPixelLayout(PIXEL_FORMAT::RG8, false, rg8);
+    GetPixelLayout(PIXEL_FORMAT::R8, false, r8);
+
+    const uint8_t pixels[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t bgra[8];
+    const int8_t to_bgra[4] = {2, 1, 0, 3};
+    assert(SwizzlePixels(pixels, rgba8, bgra, rgba8, to_bgra, 2));
+    assert(bgra[0] == 3 && bgra[2] == 1 && bgra[4] == 7 && bgra[7] == 8);
+
+    uint8_t ag[4];
+    const int8_t to_ag[4] = {3, 1};
+    assert(SwizzlePixels(pixels, rgba8, ag, rg8, to_ag, 2));
+    assert(ag[0] == 4 && ag[1] == 2 && ag[2] == 8 && ag[3] == 6);
+
+    uint8_t constant[8];
+    const int8_t zero_one[4] = {0, kSwizzleZero, kSwizzleOne, 0};
+    assert(SwizzlePixels(pixels, r8, constant, rgba8, zero_one, 2));
+    assert(constant[0] == 1 && constant[1] == 0 && constant[2] == 255 &&
+           constant[3] == 1 && constant[4] == 2);
+
+    const int8_t out_of_range[4] = {1, 0, 0, 0};
+    // missing channels and differing channel types are rejected
+    assert(!SwizzlePixels(pixels, r8, constant, rgba8, out_of_range, 2));
+    PixelLayout rgba16;
+    GetPixelLayout(PIXEL_FORMAT::RGBA16, false, rgba16);
+    assert(!SwizzlePixels(pixels, rgba8, constant, rgba16, to_bgra, 1));
+
+    uint8_t packed[8] = {};
+    const uint8_t roughness[] = {100, 200};
+    assert(InsertChannel(roughness, r8, 0, packed, rgba8, 1, 2));
+    assert(packed[1] == 100 && packed[5] == 200 && packed[0] == 0);
+}
+
+static void image_test() {
+    // two levels of RGB8 into RGBA16F, rows 4 byte aligned
+    Image image;
+    image.Width = 3;
+    image.Height = 2;
+    image.pixel_format = PIXEL_FORMAT::RGB8;
+    image.bitcount = 24;
+    image.pitch = 12;
+    image.data_size = 24 + 4;
+    image.data = new uint8_t[image.data_size]();
+    image.mipmaps.emplace_back(3, 2, 12, 0, 24);
+    image.mipmaps.emplace_back(1, 1, 4, 24, 4);
+    image.data[0] = 255;
+    image.data[24 + 1] = 51;
+
+    assert(ConvertImage(image, PIXEL_FORMAT::RGBA16, true));
+    assert(image.pitch == 24 && image.bitcount == 64 && image.bitdepth == 16 &&
+           image.is_float && image.mipmaps[1].offset == 48 &&
+           image.data_size == 56);
+    uint16_t texel[4];
+    memcpy(texel, image.data, sizeof(texel));
+    assert(texel[0] == 0x3C00 && texel[1] == 0 && texel[3] == 0x3C00);
+    memcpy(texel, image.data + image.mipmaps[1].offset, sizeof(texel));
+    assert(texel[1] == 0x3266 && texel[3] == 0x3C00);
+
+    Image compressed;
+    compressed.compressed = true;
+    assert(!ConvertImage(compressed, PIXEL_FORMAT::RGBA8, false));
+}
+
+static void accessor_test() {
+    // per pixel accessors against a bulk conversion to RGBA8
+    constexpr uint32_t kSize = 33;
+    Image image;
+    image.Width = image.Height = kSize;
+    image.pixel_format = PIXEL_FORMAT::RGB8;
+    image.bitcount = 24;
+    image.pitch = kSize * 3;
+    image.data_size = image.pitch * kSize;
+    image.data = new uint8_t[image.data_size];
+    for (size_t i = 0; i < image.data_size; i++) {
+        image.data[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+    }
+    vector<uint8_t> accessors((size_t)kSize * kSize * 4);
+    vector<uint8_t> bulk(accessors.size());
+
+    for (uint32_t y = 0; y < kSize; y++) {
+        for (uint32_t x = 0; x < kSize; x++) {
+            uint8_t* p = accessors.data() + ((size_t)y * kSize + x) * 4;
+            p[0] = image.GetR(x, y);
+            p[1] = image.GetG(x, y);
+            p[2] = image.GetB(x, y);
+            p[3] = image.GetA(x, y);
+        }
+    }
+    PixelLayout rgb8, rgba8;
+    GetPixelLayout(image, rgb8);
+    GetPixelLayout(PIXEL_FORMAT::RGBA8, false, rgba8);
+    for (uint32_t y = 0; y < kSize; y++) {
+        ConvertPixels(image.data + y * image.pitch, rgb8,
+                      bulk.data() + (size_t)y * kSize * 4, rgba8, kSize);
+    }
+    assert(bulk == accessors);
+}
+
+int main(int argc, char** argv) {
+    half_test();
+    unorm_test();
+    convert_test();
+    swizzle_test();
+    image_test();
+    accessor_test();
+
+    return 0;
+}
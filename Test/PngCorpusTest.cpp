@@ -0,0 +1,286 @@
+#include <png.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "PNG.hpp"
+
+using namespace My;
+using namespace std;
+
+// PNG files written by libpng and decoded by both libpng and PngParser
+
+struct PngCase {
+    int color_type;
+    int bit_depth;
+    bool transparency;
+    int filters;
+    uint32_t width;
+    uint32_t height;
+};
+
+static void write_data(png_structp png, png_bytep data, png_size_t length) {
+    auto* out = static_cast<vector<uint8_t>*>(png_get_io_ptr(png));
+    out->insert(out->end(), data, data + length);
+}
+
+static void flush_data(png_structp) {}
+
+struct ReadState {
+    const uint8_t* data;
+    size_t remaining;
+};
+
+static void read_data(png_structp png, png_bytep data, png_size_t length) {
+    auto* state = static_cast<ReadState*>(png_get_io_ptr(png));
+    if (length > state->remaining) png_error(png, "read past the end");
+    memcpy(data, state->data, length);
+    state->data += length;
+    state->remaining -= length;
+}
+
+static int samples_per_pixel(const int color_type) {
+    switch (color_type) {
+        case PNG_COLOR_TYPE_RGB:
+            return 3;
+        case PNG_COLOR_TYPE_GRAY_ALPHA:
+            return 2;
+        case PNG_COLOR_TYPE_RGB_ALPHA:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+// a gradient with noise so that every filter wins somewhere
+static vector<uint8_t> make_rows(const PngCase& c, const size_t row_bytes,
+                                 mt19937& generator) {
+    uniform_int_distribution<int> noise(0, 255);
+    vector<uint8_t> rows(row_bytes * c.height);
+    for (uint32_t y = 0; y < c.height; y++) {
+        for (size_t i = 0; i < row_bytes; i++) {
+            const int value = (int)(i * 3 + y * 5) + (noise(generator) & 15);
+            rows[y * row_bytes + i] =
+                (y & 4) ? static_cast<uint8_t>(noise(generator))
+                        : static_cast<uint8_t>(value);
+        }
+    }
+
+    if (c.color_type == PNG_COLOR_TYPE_PALETTE && c.bit_depth == 8) {
+        // a palette of 180 entries
+        for (auto& index : rows) index %= 180;
+    }
+    return rows;
+}
+
+static vector<uint8_t> encode(const PngCase& c, const vector<uint8_t>& rows,
+                              const size_t row_bytes, mt19937& generator) {
+    vector<uint8_t> out;
+    png_structp png =
+        png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+                                nullptr);
+    png_infop info = png_create_info_struct(png);
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        return {};
+    }
+
+    png_set_write_fn(png, &out, write_data, flush_data);
+    png_set_IHDR(png, info, c.width, c.height, c.bit_depth, c.color_type,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+                 PNG_FILTER_TYPE_DEFAULT);
+
+    uniform_int_distribution<int> byte(0, 255);
+    png_color palette[256];
+    png_byte alpha[256];
+    for (int i = 0; i < 256; i++) {
+        palette[i] = {static_cast<png_byte>(byte(generator)),
+                      static_cast<png_byte>(byte(generator)),
+                      static_cast<png_byte>(byte(generator))};
+        alpha[i] = static_cast<png_byte>(byte(generator));
+    }
+
+    if (c.color_type == PNG_COLOR_TYPE_PALETTE) {
+        const int count = std::min(1 << c.bit_depth, 180);
+        png_set_PLTE(png, info, palette, count);
+        if (c.transparency) png_set_tRNS(png, info, alpha, count / 2, nullptr);
+    } else if (c.transparency) {
+        // the color of the first pixel, so that some pixels match
+        png_color_16 color{};
+        const int max = (1 << c.bit_depth) - 1;
+        const auto first = [&](const int k) {
+            if (c.bit_depth == 16) {
+                return static_cast<png_uint_16>((rows[k * 2] << 8) |
+                                                rows[k * 2 + 1]);
+            }
+            if (c.bit_depth == 8) return static_cast<png_uint_16>(rows[k]);
+            return static_cast<png_uint_16>((rows[0] >> (8 - c.bit_depth)) &
+                                            max);
+        };
+        color.gray = first(0);
+        if (c.color_type == PNG_COLOR_TYPE_RGB) {
+            color.red = first(0);
+            color.green = first(1);
+            color.blue = first(2);
+        }
+        png_set_tRNS(png, info, nullptr, 0, &color);
+    }
+
+    png_set_filter(png, 0, c.filters);
+    // small IDAT chunks, so that scanlines straddle them
+    png_set_compression_buffer_size(png, 777);
+    png_write_info(png, info);
+    for (uint32_t y = 0; y < c.height; y++) {
+        png_write_row(png, rows.data() + y * row_bytes);
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+
+    return out;
+}
+
+// decodes with the expansions of PngParser, 16-bit samples stay big endian
+static vector<uint8_t> decode(const vector<uint8_t>& file,
+                              size_t& row_bytes) {
+    ReadState state{file.data(), file.size()};
+    png_structp png =
+        png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+                               nullptr);
+    png_infop info = png_create_info_struct(png);
+    vector<uint8_t> pixels;
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return {};
+    }
+
+    png_set_read_fn(png, &state, read_data);
+    png_read_info(png, info);
+    png_set_expand(png);
+    png_read_update_info(png, info);
+
+    row_bytes = png_get_rowbytes(png, info);
+    const uint32_t height = png_get_image_height(png, info);
+    pixels.resize(row_bytes * height);
+    for (uint32_t y = 0; y < height; y++) {
+        png_read_row(png, pixels.data() + y * row_bytes, nullptr);
+    }
+    png_read_end(png, nullptr);
+    png_destroy_read_struct(&png, &info, nullptr);
+
+    return pixels;
+}
+
+static bool test_case(const PngCase& c, mt19937& generator) {
+    const size_t row_bytes =
+        ((size_t)c.width * samples_per_pixel(c.color_type) * c.bit_depth + 7) >>
+        3;
+    const auto rows = make_rows(c, row_bytes, generator);
+    const auto file = encode(c, rows, row_bytes, generator);
+    assert(!file.empty());
+
+    size_t expected_row_bytes = 0;
+    const auto expected = decode(file, expected_row_bytes);
+    assert(!expected.empty());
+
+    Buffer buf(file.size());
+    memcpy(buf.GetData(), file.data(), file.size());
+    PngParser parser;
+    Image image = parser.Parse(buf);
+
+    bool match = image.data && image.Width == c.width &&
+                 image.Height == c.height &&
+                 image.Width * (image.bitcount >> 3) == expected_row_bytes;
+    for (uint32_t y = 0; match && y < c.height; y++) {
+        const uint8_t* row = image.data + image.pitch * y;
+        const uint8_t* expected_row = expected.data() + expected_row_bytes * y;
+        if (image.bitdepth == 16) {
+            for (size_t i = 0; i < expected_row_bytes; i += 2) {
+                uint16_t sample;
+                memcpy(&sample, row + i, 2);
+                sample = endian_net_unsigned_int(sample);
+                match &= !memcmp(&sample, expected_row + i, 2);
+            }
+        } else {
+            match &= !memcmp(row, expected_row, expected_row_bytes);
+        }
+    }
+
+    if (!match) {
+        cerr << "mismatch: color type " << c.color_type << ", bit depth "
+             << c.bit_depth << ", tRNS " << c.transparency << ", filters "
+             << c.filters << ", " << c.width << "x" << c.height << endl;
+    }
+    return match;
+}
+
+static void benchmark(mt19937& generator) {
+    const PngCase c{PNG_COLOR_TYPE_RGB_ALPHA, 8, false, PNG_ALL_FILTERS,
+                    2048, 1024};
+    const size_t row_bytes = (size_t)c.width * 4;
+    const auto rows = make_rows(c, row_bytes, generator);
+    const auto file = encode(c, rows, row_bytes, generator);
+
+    const int32_t rounds = 5;
+    const auto start = chrono::steady_clock::now();
+    for (int32_t n = 0; n < rounds; n++) {
+        Buffer buf(file.size());
+        memcpy(buf.GetData(), file.data(), file.size());
+        PngParser parser;
+        Image image = parser.Parse(buf);
+    }
+    const chrono::duration<double, milli> elapsed =
+        chrono::steady_clock::now() - start;
+    const double milliseconds = elapsed.count() / rounds;
+    cout << c.width << "x" << c.height << " RGBA decoded in " << milliseconds
+         << " ms, " << c.width * c.height / (milliseconds * 1000.0)
+         << " megapixels/s" << endl;
+}
+
+int main() {
+    mt19937 generator(7);
+
+    const struct {
+        int color_type;
+        vector<int> bit_depths;
+    } formats[] = {{PNG_COLOR_TYPE_GRAY, {1, 2, 4, 8, 16}},
+                   {PNG_COLOR_TYPE_RGB, {8, 16}},
+                   {PNG_COLOR_TYPE_PALETTE, {1, 2, 4, 8}},
+                   {PNG_COLOR_TYPE_GRAY_ALPHA, {8, 16}},
+                   {PNG_COLOR_TYPE_RGB_ALPHA, {8, 16}}};
+    const int filters[] = {PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP,
+                           PNG_FILTER_AVG, PNG_FILTER_PAETH, PNG_ALL_FILTERS};
+    const uint32_t widths[] = {1, 7, 33, 130};
+
+    int count = 0;
+    int failed = 0;
+    for (const auto& format : formats) {
+        for (const int bit_depth : format.bit_depths) {
+            for (const bool transparency : {false, true}) {
+                if (transparency &&
+                    (format.color_type & PNG_COLOR_MASK_ALPHA)) {
+                    continue;
+                }
+                for (const int filter : filters) {
+                    for (const uint32_t width : widths) {
+                        const PngCase c{format.color_type, bit_depth,
+                                        transparency,      filter,
+                                        width,             width / 3 + 9};
+                        count++;
+                        if (!test_case(c, generator)) failed++;
+                    }
+                }
+            }
+        }
+    }
+
+    cout << count << " images compared with libpng, " << failed
+         << " mismatches" << endl;
+
+    benchmark(generator);
+
+    return failed ? 1 : 0;
+}
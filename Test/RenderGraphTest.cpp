@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+
+#include "RenderGraph.hpp"
+
+using namespace My;
+using namespace std;
+
+using State = RenderGraphResourceState;
+
+// position of each pass in the execution order
+vector<uint32_t> positions(const RenderGraph& graph, const size_t pass_count) {
+    vector<uint32_t> result(pass_count, RenderGraph::kInvalidIndex);
+    const auto& order = graph.GetPassOrder();
+    for (uint32_t i = 0; i < order.size(); i++) {
+        result[order[i]] = i;
+    }
+    return result;
+}
+
+// transient resources sharing memory are never alive at the same time
+void check_aliasing(const RenderGraph& graph, const uint32_t resource_count) {
+    for (uint32_t a = 0; a < resource_count; a++) {
+        const uint32_t physical = graph.GetPhysicalIndex(a);
+        if (physical == RenderGraph::kInvalidIndex) continue;
+        assert(graph.GetPhysicalSize(physical) >= graph.GetResourceSize(a));
+
+        for (uint32_t b = a + 1; b < resource_count; b++) {
+            if (graph.GetPhysicalIndex(b) != physical) continue;
+            const auto la = graph.GetLifetime(a);
+            const auto lb = graph.GetLifetime(b);
+            assert(la.last < lb.first || lb.last < la.first);
+        }
+    }
+    assert(graph.GetTransientMemory() <= graph.GetUnaliasedTransientMemory());
+}
+
+bool has_barrier(const RenderGraph& graph, const uint32_t pass,
+                 const RenderGraphBarrier& expected) {
+    for (const auto& barrier : graph.GetBarriers(pass)) {
+        if (barrier.resource == expected.resource &&
+            barrier.before == expected.before &&
+            barrier.after == expected.after &&
+            barrier.aliasing == expected.aliasing) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void frame_test() {
+    RenderGraph graph;
+
+    auto target = [&](const char* name, const float scale,
+                      const uint32_t bytes_per_pixel) {
+        RenderGraphResourceDesc desc;
+        desc.name = name;
+        desc.scaleX = desc.scaleY = scale;
+        desc.bytesPerPixel = bytes_per_pixel;
+        return graph.AddResource(desc);
+    };
+
+    RenderGraphResourceDesc shadow_desc;
+    shadow_desc.name = "ShadowMap";
+    shadow_desc.width = shadow_desc.height = 1024;
+    const uint32_t shadow_map = graph.AddResource(shadow_desc);
+
+    const uint32_t albedo = target("GBufferAlbedo", 1.0f, 4);
+    const uint32_t normal = target("GBufferNormal", 1.0f, 8);
+    const uint32_t depth = target("Depth", 1.0f, 4);
+    const uint32_t hdr = target("SceneColor", 1.0f, 8);
+    const uint32_t bloom = target("Bloom", 0.5f, 8);
+    const uint32_t debug_view = target("DebugView", 1.0f, 4);
+
+    RenderGraphResourceDesc back_buffer_desc;
+    back_buffer_desc.name = "BackBuffer";
+    back_buffer_desc.imported = true;
+    back_buffer_desc.initialState = State::Present;
+    const uint32_t back_buffer = graph.AddResource(back_buffer_desc);
+
+    // added out of order, the graph orders them
+    const uint32_t tonemap = graph.AddPass(
+        {"Tonemap",
+         RenderGraphQueue::Graphics,
+         {{hdr, State::ShaderRead}, {bloom, State::ShaderRead}},
+         {{back_buffer, State::RenderTarget}}});
+    const uint32_t lighting = graph.AddPass(
+        {"Lighting",
+         RenderGraphQueue::Graphics,
+         {{albedo, State::ShaderRead},
+          {normal, State::ShaderRead},
+          {depth, State::ShaderRead},
+          {shadow_map, State::ShaderRead}},
+         {{hdr, State::RenderTarget}}});
+    const uint32_t gbuffer = graph.AddPass({"GBuffer",
+                                            RenderGraphQueue::Graphics,
+                                            {},
+                                            {{albedo, State::RenderTarget},
+                                             {normal, State::RenderTarget},
+                                             {depth, State::DepthWrite}}});
+    const uint32_t shadow = graph.AddPass({"ShadowMap",
+                                           RenderGraphQueue::Graphics,
+                                           {},
+                                           {{shadow_map, State::DepthWrite}}});
+    const uint32_t blur = graph.AddPass({"Bloom",
+                                         RenderGraphQueue::Compute,
+                                         {{hdr, State::ShaderRead}},
+                                         {{bloom, State::UnorderedAccess}}});
+    const uint32_t debug = graph.AddPass({"Debug",
+                                          RenderGraphQueue::Graphics,
+                                          {{depth, State::ShaderRead}},
+                                          {{debug_view, State::RenderTarget}}});
+    const uint32_t gui = graph.AddPass({"Gui",
+                                        RenderGraphQueue::Graphics,
+                                        {{back_buffer, State::RenderTarget}},
+                                        {{back_buffer, State::RenderTarget}}});
+    const size_t pass_count = 7;
+
+    assert(graph.FindPass("Bloom") == blur);
+    assert(graph.FindResource("Depth") == depth);
+
+    assert(graph.Compile(1920, 1080));
+
+    // nothing reads the debug view
+    assert(graph.IsCulled(debug));
+    assert(graph.GetPhysicalIndex(debug_view) == RenderGraph::kInvalidIndex);
+
+    const vector<uint32_t> expected = {gbuffer, shadow, lighting,
+                                       blur,    tonemap, gui};
+    assert(graph.GetPassOrder() == expected);
+
+    const auto position = positions(graph, pass_count);
+    assert(graph.GetLifetime(albedo).first == position[gbuffer]);
+    assert(graph.GetLifetime(albedo).last == position[lighting]);
+    assert(graph.GetLifetime(hdr).last == position[tonemap]);
+    assert(graph.GetResourceSize(bloom) == 960 * 540 * 8);
+    assert(graph.GetResourceSize(shadow_map) == 1024 * 1024 * 4);
+
+    // the bloom target takes the memory of the g-buffer
+    check_aliasing(graph, 8);
+    assert(graph.GetPhysicalIndex(back_buffer) == RenderGraph::kInvalidIndex);
+    const uint32_t bloom_memory = graph.GetPhysicalIndex(bloom);
+    assert(bloom_memory == graph.GetPhysicalIndex(albedo) ||
+           bloom_memory == graph.GetPhysicalIndex(normal) ||
+           bloom_memory == graph.GetPhysicalIndex(depth) ||
+           bloom_memory == graph.GetPhysicalIndex(shadow_map));
+    assert(graph.GetTransientMemory() < graph.GetUnaliasedTransientMemory());
+    cout << graph.GetPhysicalCount() << " allocations, "
+         << graph.GetTransientMemory() / 1024 << " KiB instead of "
+         << graph.GetUnaliasedTransientMemory() / 1024 << " KiB" << endl;
+
+    // barriers
+    assert(has_barrier(graph, gbuffer,
+                       {depth, State::Undefined, State::DepthWrite, false}));
+    assert(has_barrier(graph, lighting,
+                       {depth, State::DepthWrite, State::ShaderRead, false}));
+    assert(has_barrier(graph, blur,
+                       {bloom, State::Undefined, State::UnorderedAccess, true}));
+    assert(has_barrier(graph, blur,
+                       {hdr, State::RenderTarget, State::ShaderRead, false}));
+    assert(has_barrier(graph, tonemap, {bloom, State::UnorderedAccess,
+                                        State::ShaderRead, false}));
+    assert(has_barrier(graph, tonemap, {back_buffer, State::Present,
+                                        State::RenderTarget, false}));
+    assert(graph.GetBarriers(gui).empty());
+
+    // the compute queue waits for the lighting and the tone mapping for it
+    assert(graph.GetQueueWaits(blur) == vector<uint32_t>{lighting});
+    assert(graph.GetQueueWaits(tonemap) == vector<uint32_t>{blur});
+    assert(graph.GetQueueWaits(lighting).empty());
+
+    cout << "frame test passed" << endl;
+}
+
+void cycle_test() {
+    RenderGraph graph;
+    RenderGraphResourceDesc desc;
+    desc.imported = true;
+    const uint32_t x = graph.AddResource(desc);
+    const uint32_t y = graph.AddResource(desc);
+
+    graph.AddPass({"A",
+                   RenderGraphQueue::Graphics,
+                   {{x, State::ShaderRead}},
+                   {{y, State::RenderTarget}}});
+    graph.AddPass({"B",
+                   RenderGraphQueue::Graphics,
+                   {{y, State::ShaderRead}},
+                   {{x, State::RenderTarget}}});
+
+    assert(!graph.Compile(800, 600));
+    assert(graph.GetPassOrder().empty());
+
+    cout << "cycle test passed" << endl;
+}
+
+// random graphs keep every writer of a resource ahead of its readers and
+// the writers in the order they were added
+void random_test() {
+    mt19937 generator(42);
+
+    for (int32_t n = 0; n < 200; n++) {
+        RenderGraph graph;
+
+        const uint32_t resource_count = 12;
+        uniform_int_distribution<uint32_t> bytes(1, 16);
+        for (uint32_t i = 0; i < resource_count; i++) {
+            RenderGraphResourceDesc desc;
+            desc.width = 64;
+            desc.height = 64;
+            desc.bytesPerPixel = bytes(generator);
+            desc.imported = (i == 0);
+            graph.AddResource(desc);
+        }
+
+        // the last pass writes the imported resource
+        const uint32_t pass_count = 16;
+        vector<uint32_t> outputs(pass_count);
+        vector<uint32_t> last_writer(resource_count, 0);
+        for (uint32_t i = 0; i < pass_count; i++) {
+            outputs[i] = (i == pass_count - 1)
+                             ? 0
+                             : 1 + generator() % (resource_count - 1);
+            last_writer[outputs[i]] = i;
+        }
+
+        // passes read resources which are no longer written, so there is no
+        // cycle
+        vector<RenderGraphPassDesc> descs(pass_count);
+        for (uint32_t i = 0; i < pass_count; i++) {
+            auto& desc = descs[i];
+            desc.queue = (generator() % 4 == 0) ? RenderGraphQueue::Compute
+                                                : RenderGraphQueue::Graphics;
+            for (uint32_t k = 0; k < 3 && i > 0; k++) {
+                const uint32_t resource = outputs[generator() % i];
+                if (last_writer[resource] < i) {
+                    desc.reads.push_back({resource, State::ShaderRead});
+                }
+            }
+            desc.writes.push_back({outputs[i], State::RenderTarget});
+            graph.AddPass(desc);
+        }
+        assert(graph.Compile(640, 480));
+
+        const auto position = positions(graph, pass_count);
+        for (uint32_t i = 0; i < pass_count; i++) {
+            if (graph.IsCulled(i)) continue;
+            for (uint32_t j = 0; j < pass_count; j++) {
+                const bool read = any_of(
+                    descs[i].reads.begin(), descs[i].reads.end(),
+                    [&](const RenderGraphAccess& access) {
+                        return access.resource == outputs[j];
+                    });
+                const bool overwritten = j < i && outputs[j] == outputs[i];
+                if (read || overwritten) {
+                    assert(!graph.IsCulled(j));
+                    assert(position[j] < position[i]);
+                }
+            }
+        }
+        assert(!graph.IsCulled(pass_count - 1));
+        check_aliasing(graph, resource_count);
+    }
+
+    cout << "random test passed" << endl;
+}
+
+int main(int argc, char** argv) {
+    frame_test();
+    cycle_test();
+    random_test();
+
+    return 0;
+}
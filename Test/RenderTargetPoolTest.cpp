@@ -0,0 +1,166 @@
+#include <cassert>
+#include <iostream>
+#include <set>
+
+#include "RenderTargetPool.hpp"
+
+using namespace My;
+using namespace std;
+
+// stands in for the graphics API, hands out handles and tracks which are
+// alive
+struct FakeRHI {
+    TextureHandler next{1};
+    set<TextureHandler> alive;
+    uint32_t created{0};
+    uint32_t released{0};
+
+    void connect(RenderTargetPool& pool) {
+        pool.SetCreateTextureCB(
+            [this](const RenderTargetDesc& desc, TextureBase& texture) {
+                texture.handler = next++;
+                texture.width = desc.width;
+                texture.height = desc.height;
+                texture.pixel_format = desc.format;
+                texture.samples = desc.samples;
+                alive.insert(texture.handler);
+                created++;
+            });
+        pool.SetReleaseTextureCB([this](TextureBase& texture) {
+            const size_t erased = alive.erase(texture.handler);
+            assert(erased == 1);
+            released += static_cast<uint32_t>(erased);
+        });
+    }
+};
+
+RenderTargetDesc color(const uint32_t width, const uint32_t height) {
+    RenderTargetDesc desc;
+    desc.width = width;
+    desc.height = height;
+    return desc;
+}
+
+int main(int argc, char** argv) {
+    // sizes
+    const RenderTargetDesc hd = color(1920, 1080);
+    assert(GetRenderTargetSize(hd) == 1920 * 1080 * 4);
+    RenderTargetDesc cubes = {RenderTargetType::TextureCubeArray,
+                              PIXEL_FORMAT::D32,
+                              512,
+                              512,
+                              2,
+                              1,
+                              RenderTargetUsage::Depth};
+    assert(GetRenderTargetSize(cubes) == 512 * 512 * 4 * 6 * 2);
+    RenderTargetDesc msaa = hd;
+    msaa.samples = 4;
+    assert(GetRenderTargetSize(msaa) == 4 * GetRenderTargetSize(hd));
+
+    FakeRHI rhi;
+    RenderTargetPool pool;
+    rhi.connect(pool);
+
+    // a released texture is handed out again for the same description
+    Texture2D a;
+    pool.Acquire(hd, a);
+    assert(a.handler && a.width == 1920 && rhi.created == 1);
+    pool.Release(a);
+
+    Texture2D b;
+    pool.Acquire(hd, b);
+    assert(b.handler == a.handler);
+    assert(rhi.created == 1 && pool.GetReusedCount() == 1);
+
+    // but not one in use, nor for another description
+    Texture2D c;
+    pool.Acquire(hd, c);
+    assert(c.handler != b.handler && rhi.created == 2);
+
+    Texture2D d;
+    pool.Acquire(msaa, d);
+    RenderTargetDesc depth = hd;
+    depth.format = PIXEL_FORMAT::D32;
+    Texture2D e;
+    pool.Acquire(depth, e);
+    RenderTargetDesc depth_usage = depth;
+    depth_usage.usage = RenderTargetUsage::Depth;
+    Texture2D f;
+    pool.Acquire(depth_usage, f);
+    Texture2DArray g;
+    pool.Acquire(cubes, g);
+    assert(rhi.created == 6 && pool.GetTextureCount() == 6);
+
+    for (const TextureBase* texture : {&b, &c, &d, &e, &f}) {
+        pool.Release(*texture);
+    }
+    pool.Release(g);
+
+    // releasing twice or textures of elsewhere is harmless
+    pool.Release(b);
+    Texture2D foreign;
+    foreign.handler = 1000;
+    pool.Release(foreign);
+    pool.Release(Texture2D());
+
+    cout << "reuse tests passed" << endl;
+
+    // idle textures are destroyed after a few frames
+    const size_t all_memory = pool.GetAllocatedMemory();
+    assert(pool.GetPeakMemory() == all_memory);
+    for (uint32_t i = 0; i < RenderTargetPool::kDefaultMaxIdleFrames; i++) {
+        pool.BeginFrame();
+        // the frame buffer is used every frame
+        pool.Acquire(hd, b);
+        pool.Release(b);
+    }
+    assert(rhi.released == 0);
+    pool.BeginFrame();
+    assert(rhi.released == 5 && pool.GetTextureCount() == 1);
+    assert(pool.GetAllocatedMemory() == GetRenderTargetSize(hd));
+    assert(pool.GetPeakMemory() == all_memory);
+
+    cout << "eviction tests passed" << endl;
+
+    // resizing: frames use a color and a depth target, the old size
+    // lingers for a few frames
+    auto frame = [&](const uint32_t width, const uint32_t height) {
+        pool.BeginFrame();
+        Texture2D color_target, depth_target;
+        const RenderTargetDesc color_desc = color(width, height);
+        RenderTargetDesc depth_desc = color_desc;
+        depth_desc.format = PIXEL_FORMAT::D32;
+        depth_desc.usage = RenderTargetUsage::Depth;
+        pool.Acquire(color_desc, color_target);
+        pool.Acquire(depth_desc, depth_target);
+        pool.Release(color_target);
+        pool.Release(depth_target);
+    };
+
+    for (int32_t i = 0; i < 8; i++) {
+        frame(1280, 720);
+    }
+    const size_t small = 2 * GetRenderTargetSize(color(1280, 720));
+    assert(pool.GetAllocatedMemory() == small);
+    assert(pool.GetSteadyStateMemory() == small);
+
+    const uint32_t created = rhi.created;
+    for (int32_t i = 0; i < 8; i++) {
+        frame(1920, 1080);
+    }
+    assert(rhi.created == created + 2);
+    const size_t large = 2 * GetRenderTargetSize(hd);
+    assert(pool.GetAllocatedMemory() == large);
+    assert(pool.GetSteadyStateMemory() == large);
+    assert(pool.GetPeakMemory() >= small + large);
+
+    cout << "memory: steady " << pool.GetSteadyStateMemory() << " bytes, peak "
+         << pool.GetPeakMemory() << " bytes" << endl;
+
+    pool.Clear();
+    assert(rhi.alive.empty() && pool.GetAllocatedMemory() == 0);
+
+    cout << "memory tests passed" << endl;
+
+    return 0;
+}
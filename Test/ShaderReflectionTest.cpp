@@ -0,0 +1,96 @@
+#include <cassert>
+#include <iostream>
+
+#include "ShaderReflection.hpp"
+
+using namespace My;
+using namespace std;
+
+// what ShaderTool reflects from pbr.frag, with the HLSL packing rules
+const char kManifest[] =
+    "uniform_block PerFrameConstants 0 10 440\n"
+    "member viewMatrix 0 64\n"
+    "member projectionMatrix 64 64\n"
+    "member camPos 128 16\n"
+    "member clusterDepthParams 144 16\n"
+    "member shadowCascadeMatrices 160 256\n"
+    "member shadowCascadeSplits 416 16\n"
+    "member numLights 432 4\n"
+    "member clip_space_type 436 4\n"
+    "uniform_block PerBatchConstants 0 11 64\n"
+    "member modelMatrix 0 64\n"
+    "texture diffuseMap 0 0\n"
+    "texture brdfLUT 0 6\n"
+    "sampler samp0 0 0\n"
+    "combined_sampler SPIRV_Cross_CombineddiffuseMapsamp0 0 0\n"
+    "combined_sampler SPIRV_Cross_CombinedbrdfLUTsamp0 0 6\n"
+    "storage_buffer clusteredLights 0 14\n";
+
+int main(int argc, char** argv) {
+    // manifests
+    ShaderReflection reflection;
+    assert(ParseShaderReflection(kManifest, reflection));
+    assert(reflection.resources.size() == 8);
+
+    const auto* per_frame =
+        reflection.Find(ShaderResourceType::UniformBlock, "PerFrameConstants");
+    assert(per_frame && per_frame->binding == 10 && per_frame->size == 440);
+    assert(per_frame->members.size() == 8);
+    assert(per_frame->members[4].name == "shadowCascadeMatrices");
+    assert(per_frame->members[4].offset == 160);
+
+    const auto* brdf = reflection.Find(ShaderResourceType::CombinedSampler,
+                                       "SPIRV_Cross_CombinedbrdfLUTsamp0");
+    assert(brdf && brdf->binding == 6);
+    assert(!reflection.Find(ShaderResourceType::Texture,
+                            "SPIRV_Cross_CombinedbrdfLUTsamp0"));
+
+    assert(SerializeShaderReflection(reflection) == kManifest);
+
+    ShaderReflection malformed;
+    assert(!ParseShaderReflection("member viewMatrix 0 64\n", malformed));
+    assert(!ParseShaderReflection("uniform_block Foo 0 1\n", malformed));
+    assert(!ParseShaderReflection("image foo 0 1\n", malformed));
+    ShaderReflection blank;
+    assert(ParseShaderReflection("\n\n", blank) && blank.resources.empty());
+
+    // stages of a program share their uniform blocks
+    ShaderReflection vertex;
+    assert(ParseShaderReflection(
+        "uniform_block PerBatchConstants 0 11 64\n"
+        "member modelMatrix 0 64\n"
+        "uniform_block LightInfo 0 12 28800\n"
+        "member lights 0 28800\n",
+        vertex));
+    vertex.Merge(reflection);
+    assert(vertex.resources.size() == 9);
+
+    cout << "manifest tests passed" << endl;
+
+    // the layouts of cbuffer.h
+    vector<string> errors;
+    assert(CheckShaderReflection(reflection, GetConstantBufferLayouts(),
+                                 errors));
+    assert(CheckShaderReflection(vertex, GetConstantBufferLayouts(), errors));
+    assert(errors.empty());
+
+    ShaderReflection moved = reflection;
+    auto& block = moved.resources[0];
+    block.members[6].offset = 440;
+    block.size = 448;
+    assert(!CheckShaderReflection(moved, GetConstantBufferLayouts(), errors));
+    assert(errors.size() == 2);
+    for (const auto& error : errors) {
+        cout << error << endl;
+    }
+
+    errors.clear();
+    block = reflection.resources[0];
+    block.members.pop_back();
+    assert(!CheckShaderReflection(moved, GetConstantBufferLayouts(), errors));
+    assert(errors.size() == 1);
+
+    cout << "layout tests passed" << endl;
+
+    return 0;
+}
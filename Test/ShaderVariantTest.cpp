@@ -0,0 +1,107 @@
+#include <cassert>
+#include <iostream>
+
+#include "ShaderVariant.hpp"
+
+using namespace My;
+using namespace std;
+
+static shared_ptr<SceneGeometryNode> add_geometry(
+    Scene& scene, const string& name, const vector<string>& materials) {
+    auto pMesh = make_shared<SceneObjectMesh>();
+    for (uint32_t i = 0; i < materials.size(); i++) {
+        pMesh->AddIndexArray(SceneObjectIndexArray(i));
+    }
+
+    auto pGeometry = make_shared<SceneObjectGeometry>();
+    pGeometry->AddMesh(std::move(pMesh));
+    scene.Geometries.emplace(name, pGeometry);
+
+    auto pNode = make_shared<SceneGeometryNode>(name);
+    pNode->SetVisibility(true);
+    pNode->AddSceneObjectRef(name);
+    for (const auto& material : materials) {
+        pNode->AddMaterialRef(material);
+    }
+    scene.GeometryNodes.emplace(name, pNode);
+
+    return pNode;
+}
+
+int main(int argc, char** argv) {
+    // key derivation
+    SceneObjectMaterial plain("plain");
+    assert(GetMaterialShaderFeatures(plain) == 0);
+
+    SceneObjectMaterial bricks("bricks");
+    bricks.SetTexture("diffuse", "Textures/bricks-albedo.png");
+    bricks.SetTexture("normal", "Textures/bricks-normal.png");
+    bricks.SetTexture("metallic", "Textures/bricks-metallic.png");
+    const auto bricks_features = GetMaterialShaderFeatures(bricks);
+    assert(bricks_features ==
+           (SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_METALLIC_MAP));
+
+    SceneObjectMaterial leaves("leaves");
+    leaves.SetTexture("roughness", "Textures/leaves-rough.png");
+    leaves.SetTexture("ao", "Textures/leaves-ao.png");
+    leaves.SetTexture("opacity", "Textures/leaves-mask.png");
+    // constant parameters are not features
+    leaves.SetParam("metallic", 0.0f);
+    const auto leaves_features = GetMaterialShaderFeatures(leaves);
+    assert(leaves_features ==
+           (SHADER_FEATURE_ROUGHNESS_MAP | SHADER_FEATURE_AO_MAP |
+            SHADER_FEATURE_ALPHA_TEST));
+
+    // pass masking
+    assert(MakeShaderVariantKey(leaves_features, ShaderPass::Forward) ==
+           leaves_features);
+    assert(MakeShaderVariantKey(leaves_features, ShaderPass::Shadow) == 0);
+    assert(MakeShaderVariantKey(SHADER_FEATURE_SKINNED |
+                                    SHADER_FEATURE_NORMAL_MAP,
+                                ShaderPass::Shadow) == SHADER_FEATURE_SKINNED);
+
+    assert(GetShaderVariantCount(ShaderPass::Forward) == 64);
+    assert(GetShaderVariantCount(ShaderPass::Shadow) == 2);
+
+    cout << "key tests passed" << endl;
+
+    // names and defines of the permutations
+    assert(GetShaderVariantName("pbr.frag", 0) == "pbr.frag.v00");
+    assert(GetShaderVariantName("pbr.frag", 0x1f) == "pbr.frag.v1f");
+    assert(GetShaderVariantDefines(0).empty());
+
+    const auto defines = GetShaderVariantDefines(leaves_features);
+    assert(defines.size() == 3);
+    assert(defines[0] == "HAS_ROUGHNESS_MAP");
+    assert(defines[1] == "HAS_AO_MAP");
+    assert(defines[2] == "ALPHA_TEST");
+
+    cout << "name tests passed" << endl;
+
+    // only the permutations the scene references
+    Scene scene("variants");
+    scene.Materials.emplace("bricks",
+                            make_shared<SceneObjectMaterial>(std::move(bricks)));
+    scene.Materials.emplace("leaves",
+                            make_shared<SceneObjectMaterial>(std::move(leaves)));
+    scene.Materials.emplace("unused", make_shared<SceneObjectMaterial>("x"));
+    scene.Materials.at("unused")->SetTexture("normal", "Textures/x.png");
+
+    const auto wall = add_geometry(scene, "wall", {"bricks"});
+    const auto tree = add_geometry(scene, "tree", {"bricks", "leaves"});
+    // missing materials fall back to the default one
+    const auto rock = add_geometry(scene, "rock", {"missing"});
+
+    const auto forward = CollectShaderVariants(scene, ShaderPass::Forward);
+    assert(forward.size() == 3);
+    assert(forward.count(0));
+    assert(forward.count(bricks_features));
+    assert(forward.count(leaves_features));
+
+    const auto shadow = CollectShaderVariants(scene, ShaderPass::Shadow);
+    assert(shadow.size() == 1 && shadow.count(0));
+
+    cout << "scene tests passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "ShadowMapCache.hpp"
+
+using namespace My;
+using namespace std;
+
+// a unit cube at the position
+shared_ptr<DrawBatchContext> make_batch(const Vector3f& position) {
+    auto pDbc = make_shared<DrawBatchContext>();
+    pDbc->boundingBox.centroid = {0.0f, 0.0f, 0.0f};
+    pDbc->boundingBox.extent = {0.5f, 0.5f, 0.5f};
+    BuildIdentityMatrix(pDbc->modelMatrix);
+    pDbc->modelMatrix[3][0] = position[0];
+    pDbc->modelMatrix[3][1] = position[1];
+    pDbc->modelMatrix[3][2] = position[2];
+    pDbc->moved = false;
+    return pDbc;
+}
+
+Light make_light(const LightType type, const Vector3f& position,
+                 const Vector3f& direction, const float range) {
+    Light light{};
+    light.lightType = type;
+    light.lightIntensity = 1.0f;
+    light.lightCastShadow = 1;
+    light.lightPosition = {position[0], position[1], position[2], 1.0f};
+    light.lightDirection = {direction[0], direction[1], direction[2], 0.0f};
+    light.lightDistAttenCurveType = AttenCurveType::kLinear;
+    light.lightDistAttenCurveParams[0][1] = range;
+
+    Vector3f look_at = position + direction;
+    Vector3f up = {0.0f, 1.0f, 0.0f};
+    BuildViewRHMatrix(light.lightViewMatrix, position, look_at, up);
+    BuildIdentityMatrix(light.lightProjectionMatrix);
+
+    return light;
+}
+
+// the layer of the shadow map of the light, drawn with its own matrices
+bool update(ShadowMapCache& cache, const Light& light,
+            const vector<uint32_t>& casters,
+            const vector<shared_ptr<DrawBatchContext>>& batches) {
+    return cache.Update(light, light.lightShadowMapIndex,
+                        light.lightViewMatrix * light.lightProjectionMatrix,
+                        casters, batches);
+}
+
+int main(int argc, char** argv) {
+    const Vector3f down = {0.0f, 0.0f, -1.0f};
+
+    // omni lights reach a sphere
+    const auto omni = make_light(LightType::Omni, {0.0f, 0.0f, 0.0f}, down,
+                                 10.0f);
+    assert(GetLightRange(omni) == 10.0f);
+    assert(IsShadowCaster(omni, *make_batch({5.0f, 0.0f, 0.0f})));
+    assert(IsShadowCaster(omni, *make_batch({10.5f, 0.0f, 0.0f})));
+    assert(!IsShadowCaster(omni, *make_batch({12.0f, 0.0f, 0.0f})));
+
+    // scaling grows the bounding sphere
+    auto scaled = make_batch({12.0f, 0.0f, 0.0f});
+    MatrixScale(scaled->modelMatrix, 4.0f, 4.0f, 4.0f);
+    scaled->modelMatrix[3][0] = 12.0f;
+    assert(IsShadowCaster(omni, *scaled));
+
+    // lights without a range reach everything
+    auto endless = omni;
+    endless.lightDistAttenCurveType = AttenCurveType::kNone;
+    assert(GetLightRange(endless) < 0.0f);
+    assert(IsShadowCaster(endless, *make_batch({1000.0f, 0.0f, 0.0f})));
+
+    // spot lights reach a cone, 30 degrees around the axis
+    auto spot = make_light(LightType::Spot, {0.0f, 0.0f, 0.0f}, down, 20.0f);
+    spot.lightAngleAttenCurveParams[0][1] = PI / 6.0f;
+    assert(IsShadowCaster(spot, *make_batch({0.0f, 0.0f, -10.0f})));
+    assert(IsShadowCaster(spot, *make_batch({5.0f, 0.0f, -10.0f})));
+    assert(!IsShadowCaster(spot, *make_batch({8.0f, 0.0f, -10.0f})));
+    assert(!IsShadowCaster(spot, *make_batch({0.0f, 0.0f, 10.0f})));
+    assert(!IsShadowCaster(spot, *make_batch({0.0f, 0.0f, -25.0f})));
+    // the apex is within the batch
+    assert(IsShadowCaster(spot, *make_batch({0.0f, 0.0f, 0.2f})));
+
+    // the sun reaches the box of its shadow map
+    auto sun = make_light(LightType::Infinity, {0.0f, 0.0f, 100.0f}, down,
+                          0.0f);
+    BuildOrthographicRHMatrix(sun.lightProjectionMatrix, -10.0f, 10.0f, 10.0f,
+                              -10.0f, 1.0f, 200.0f);
+    assert(IsShadowCaster(sun, *make_batch({0.0f, 0.0f, 0.0f})));
+    assert(IsShadowCaster(sun, *make_batch({10.2f, 0.0f, 0.0f})));
+    assert(!IsShadowCaster(sun, *make_batch({12.0f, 0.0f, 0.0f})));
+    assert(!IsShadowCaster(sun, *make_batch({0.0f, -12.0f, 0.0f})));
+    assert(!IsShadowCaster(sun, *make_batch({0.0f, 0.0f, -150.0f})));
+
+    cout << "caster tests passed" << endl;
+
+    // the cache
+    vector<shared_ptr<DrawBatchContext>> batches = {
+        make_batch({1.0f, 0.0f, 0.0f}), make_batch({2.0f, 0.0f, 0.0f}),
+        make_batch({3.0f, 0.0f, 0.0f})};
+    vector<uint32_t> casters = {0, 2};
+
+    ShadowMapCache cache;
+    assert(!update(cache, omni, casters, batches));
+    assert(update(cache, omni, casters, batches));
+
+    // a batch which is not a caster may move
+    batches[1]->moved = true;
+    assert(update(cache, omni, casters, batches));
+    batches[1]->moved = false;
+
+    // a caster moving draws the map again, once
+    batches[2]->moved = true;
+    assert(!update(cache, omni, casters, batches));
+    batches[2]->moved = false;
+    assert(update(cache, omni, casters, batches));
+
+    // so does a batch coming into reach or a new LOD
+    casters.push_back(1);
+    assert(!update(cache, omni, casters, batches));
+    assert(update(cache, omni, casters, batches));
+    batches[0]->lod = 1;
+    assert(!update(cache, omni, casters, batches));
+    assert(update(cache, omni, casters, batches));
+
+    // or the light moving
+    auto moved_omni = omni;
+    moved_omni.lightViewMatrix[3][0] += 1.0f;
+    assert(!update(cache, moved_omni, casters, batches));
+    assert(update(cache, moved_omni, casters, batches));
+
+    // other shadow maps are cached on their own, spot and area lights share
+    // the layers
+    spot.lightShadowMapIndex = 0;
+    assert(!update(cache, spot, casters, batches));
+    assert(update(cache, spot, casters, batches));
+    assert(update(cache, moved_omni, casters, batches));
+
+    auto area = spot;
+    area.lightType = LightType::Area;
+    assert(update(cache, area, casters, batches));
+    area.lightViewMatrix[3][1] += 1.0f;
+    assert(!update(cache, area, casters, batches));
+    assert(!update(cache, spot, casters, batches));
+
+    // the cascades of the sun are layers of their own
+    sun.lightShadowMapIndex = 0;
+    Matrix4X4f cascade = sun.lightViewMatrix * sun.lightProjectionMatrix;
+    assert(!cache.Update(sun, 0, cascade, casters, batches));
+    assert(!cache.Update(sun, 1, cascade, casters, batches));
+    assert(cache.Update(sun, 0, cascade, casters, batches));
+    cascade[3][0] += 0.5f;
+    assert(!cache.Update(sun, 0, cascade, casters, batches));
+    assert(cache.Update(sun, 1, sun.lightViewMatrix * sun.lightProjectionMatrix,
+                        casters, batches));
+
+    cache.Invalidate();
+    assert(!update(cache, spot, casters, batches));
+
+    cout << "cache tests passed" << endl;
+
+    return 0;
+}
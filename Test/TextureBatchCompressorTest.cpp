@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "DDS.hpp"
+#include "KTX2.hpp"
+
+using namespace My;
+using namespace std;
+namespace fs = std::filesystem;
+
+// Runs the TextureBatchCompressor given on the command line over a few
+// synthesized textures, through the ISPC encoders it is linked with, and
+// checks the blocks and the mip chains it writes.
+
+constexpr uint32_t kWidth = 40;
+constexpr uint32_t kHeight = 24;
+// 40, 20, 10, 5, 2, 1
+constexpr uint32_t kLevels = 6;
+constexpr uint8_t kMaskValue = 0x80;
+
+// an RGBA8 texture in a DDS file, one level
+static void write_input(const fs::path& path, const bool constant) {
+    Image image;
+    image.Width = kWidth;
+    image.Height = kHeight;
+    image.bitcount = 32;
+    image.pixel_format = PIXEL_FORMAT::RGBA8;
+    image.pitch = kWidth * 4;
+    image.data_size = image.pitch * kHeight;
+    image.data = new uint8_t[image.data_size];
+    for (uint32_t y = 0; y < kHeight; y++) {
+        for (uint32_t x = 0; x < kWidth; x++) {
+            uint8_t* pixel = image.data + y * image.pitch + x * 4;
+            pixel[0] = constant ? kMaskValue : static_cast<uint8_t>(x * 6);
+            pixel[1] = constant ? kMaskValue : static_cast<uint8_t>(y * 10);
+            pixel[2] = constant ? kMaskValue : static_cast<uint8_t>(x + y);
+            pixel[3] = 0xFF;
+        }
+    }
+
+    ofstream file(path, ios::binary);
+    DdsWriter writer;
+    const bool written = writer.Write(file, image);
+    assert(written);
+}
+
+template <typename Parser>
+static Image read_output(const fs::path& path) {
+    ifstream file(path, ios::binary | ios::ate);
+    assert(file.is_open());
+    Buffer buf(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buf.GetData()),
+              static_cast<streamsize>(buf.GetDataSize()));
+    Parser parser;
+    return parser.Parse(buf);
+}
+
+// every level of the chain, whole blocks of block_bytes each
+static void check_chain(const Image& image, const COMPRESSED_FORMAT format,
+                        const uint32_t block_size, const size_t block_bytes) {
+    assert(image.compressed);
+    assert(image.compress_format == format);
+    assert(image.Width == kWidth && image.Height == kHeight);
+    assert(image.GetMipLevels() == kLevels);
+
+    for (uint32_t level = 0; level < kLevels; level++) {
+        const auto& mip = image.GetSubresource(level);
+        assert(mip.Width == max(1u, kWidth >> level));
+        assert(mip.Height == max(1u, kHeight >> level));
+        const size_t blocks = (size_t)((mip.Width + block_size - 1) /
+                                       block_size) *
+                              ((mip.Height + block_size - 1) / block_size);
+        assert(mip.data_size == blocks * block_bytes);
+    }
+}
+
+static int run(const string& compressor, const fs::path& input,
+               const fs::path& output, const char* container) {
+    const string command = "\"" + compressor + "\" \"" + input.string() +
+                           "\" \"" + output.string() + "\" " + container;
+    return system(command.c_str());
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: TextureBatchCompressorTest <TextureBatchCompressor>"
+             << endl;
+        return 1;
+    }
+
+    const fs::path root =
+        fs::temp_directory_path() / "TextureBatchCompressorTest";
+    fs::remove_all(root);
+    const fs::path input = root / "input";
+    fs::create_directories(input);
+    write_input(input / "stone.dds", false);
+    write_input(input / "stone_n.dds", false);
+    write_input(input / "stone_rough.dds", true);
+
+    const fs::path dds = root / "dds";
+    const int dds_result = run(argv[1], input, dds, "dds");
+    assert(dds_result == 0);
+
+    check_chain(read_output<DdsParser>(dds / "stone.dds"),
+                COMPRESSED_FORMAT::BC7, 4, 16);
+    check_chain(read_output<DdsParser>(dds / "stone_n.dds"),
+                COMPRESSED_FORMAT::BC5, 4, 16);
+
+    // a constant mask has both BC4 endpoints at its value, in every block
+    // of every level
+    const Image mask = read_output<DdsParser>(dds / "stone_rough.dds");
+    check_chain(mask, COMPRESSED_FORMAT::BC4, 4, 8);
+    for (const auto& mip : mask.mipmaps) {
+        for (size_t offset = 0; offset < mip.data_size; offset += 8) {
+            const uint8_t* block = mask.data + mip.offset + offset;
+            assert(block[0] == kMaskValue && block[1] == kMaskValue);
+        }
+    }
+    cout << "BC4, BC5 and BC7 chains written" << endl;
+
+    const fs::path astc = root / "astc";
+    const int astc_result = run(argv[1], input, astc, "astc");
+    assert(astc_result == 0);
+    for (const char* name :
+         {"stone.ktx2", "stone_n.ktx2", "stone_rough.ktx2"}) {
+        check_chain(read_output<KTX2::Ktx2Parser>(astc / name),
+                    COMPRESSED_FORMAT::ASTC_6x6, 6, 16);
+    }
+    cout << "ASTC 6x6 chains written" << endl;
+
+    fs::remove_all(root);
+
+    return 0;
+}
@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AssetLoader.hpp"
+#include "DDS.hpp"
+#include "KTX2.hpp"
+#include "PVR.hpp"
+
+using namespace My;
+using namespace std;
+
+// DDS, PVR and KTX2 containers synthesized with every level of every face
+// and layer holding a different pattern
+
+struct Layout {
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    uint32_t faces;
+    uint32_t layers;
+    COMPRESSED_FORMAT compress_format;  // NONE for 32-bit pixels
+};
+
+// the bytes of a level, whole 4x4 blocks when compressed
+static size_t level_size(const Layout& l, const uint32_t level,
+                         size_t& pitch) {
+    const uint32_t width = max(1u, l.width >> level);
+    const uint32_t height = max(1u, l.height >> level);
+    switch (l.compress_format) {
+        case COMPRESSED_FORMAT::NONE:
+            pitch = (size_t)width * 4;
+            return pitch * height;
+        case COMPRESSED_FORMAT::DXT1:
+        case COMPRESSED_FORMAT::BC1:
+            pitch = (size_t)((width + 3) / 4) * 8;
+            break;
+        default:
+            pitch = (size_t)((width + 3) / 4) * 16;
+    }
+    return pitch * ((height + 3) / 4);
+}
+
+static uint8_t pattern(const uint32_t level, const uint32_t face,
+                       const uint32_t layer, const size_t i) {
+    return static_cast<uint8_t>(level * 31 + face * 7 + layer * 53 + i * 3);
+}
+
+static void append_subresource(const Layout& l, const uint32_t level,
+                               const uint32_t face, const uint32_t layer,
+                               vector<uint8_t>& out) {
+    size_t pitch;
+    const size_t size = level_size(l, level, pitch);
+    for (size_t i = 0; i < size; i++) {
+        out.push_back(pattern(level, face, layer, i));
+    }
+}
+
+template <typename T>
+static void append(vector<uint8_t>& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static vector<uint8_t> make_dds(const Layout& l, const bool dx10) {
+    vector<uint8_t> out;
+    append(out, endian_net_unsigned_int("DDS "_u32));
+
+    DDS_HEADER header{};
+    header.dwSize = 124;
+    header.dwFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;
+    header.dwHeight = l.height;
+    header.dwWidth = l.width;
+    header.dwMipMapCount = l.levels;
+    header.ddspf.dwSize = 32;
+    header.dwCaps = 0x1000;
+    if (l.faces == 6 && !dx10) header.dwCaps2 = 0x200 | 0xFC00;
+    if (dx10 || l.compress_format != COMPRESSED_FORMAT::NONE) {
+        header.ddspf.dwFlags = 0x4;
+        header.ddspf.dwFourCC =
+            endian_net_unsigned_int(dx10 ? "DX10"_u32 : "DXT1"_u32);
+    } else {
+        header.ddspf.dwFlags = 0x40 | 0x1;
+        header.ddspf.dwRGBBitCount = 32;
+        header.ddspf.dwRBitMask = 0x000000FF;
+        header.ddspf.dwGBitMask = 0x0000FF00;
+        header.ddspf.dwBBitMask = 0x00FF0000;
+        header.ddspf.dwABitMask = 0xFF000000;
+    }
+    append(out, header);
+
+    if (dx10) {
+        DDS_HEADER_DXT10 header_dx10{};
+        switch (l.compress_format) {
+            case COMPRESSED_FORMAT::BC7:
+                header_dx10.dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+                break;
+            case COMPRESSED_FORMAT::BC1:
+                header_dx10.dxgiFormat = DXGI_FORMAT_BC1_UNORM;
+                break;
+            default:
+                header_dx10.dxgiFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+        header_dx10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+        header_dx10.miscFlag = l.faces == 6 ? 0x4 : 0;
+        header_dx10.arraySize = l.layers;
+        append(out, header_dx10);
+    }
+
+    // layer, face, level
+    for (uint32_t layer = 0; layer < l.layers; layer++) {
+        for (uint32_t face = 0; face < l.faces; face++) {
+            for (uint32_t level = 0; level < l.levels; level++) {
+                append_subresource(l, level, face, layer, out);
+            }
+        }
+    }
+    return out;
+}
+
+static vector<uint8_t> make_pvr(const Layout& l, const bool legacy_header) {
+    vector<uint8_t> out;
+    PVR::Header header{};
+    header.pixel_format =
+        l.compress_format == COMPRESSED_FORMAT::NONE
+            ? static_cast<PVR::PixelFormat>(
+                  PVR::ChannelFormat("rgba", 8, 8, 8, 8))
+            : PVR::PixelFormat::BC1;
+    header.height = l.height;
+    header.width = l.width;
+    header.depth = 1;
+    header.num_surfaces = l.layers;
+    header.num_faces = l.faces;
+    header.mipmap_count = l.levels;
+    append(out, header);
+    // the padding older writers left after the pixel format
+    if (legacy_header) out.insert(out.end(), 4, 0);
+
+    // level, layer, face
+    for (uint32_t level = 0; level < l.levels; level++) {
+        for (uint32_t layer = 0; layer < l.layers; layer++) {
+            for (uint32_t face = 0; face < l.faces; face++) {
+                append_subresource(l, level, face, layer, out);
+            }
+        }
+    }
+    return out;
+}
+
+static vector<uint8_t> make_ktx2(const Layout& l) {
+    KTX2::Header header{};
+    memcpy(header.identifier, KTX2::kIdentifier, sizeof(header.identifier));
+    switch (l.compress_format) {
+        case COMPRESSED_FORMAT::BC7:
+            header.vk_format =
+                static_cast<uint32_t>(KTX2::VkFormat::BC7_UNORM_BLOCK);
+            break;
+        case COMPRESSED_FORMAT::BC1:
+            header.vk_format =
+                static_cast<uint32_t>(KTX2::VkFormat::BC1_RGB_UNORM_BLOCK);
+            break;
+        default:
+            header.vk_format =
+                static_cast<uint32_t>(KTX2::VkFormat::R8G8B8A8_UNORM);
+    }
+    header.type_size = 1;
+    header.pixel_width = l.width;
+    header.pixel_height = l.height;
+    header.layer_count = l.layers > 1 ? l.layers : 0;
+    header.face_count = l.faces;
+    header.level_count = l.levels;
+
+    // the smallest level first, as the specification recommends
+    const size_t index_size =
+        sizeof(KTX2::Header) + l.levels * sizeof(KTX2::LevelIndex);
+    vector<KTX2::LevelIndex> levels(l.levels);
+    vector<uint8_t> payload;
+    for (uint32_t level = l.levels; level-- > 0;) {
+        levels[level].byte_offset = index_size + payload.size();
+        for (uint32_t layer = 0; layer < l.layers; layer++) {
+            for (uint32_t face = 0; face < l.faces; face++) {
+                append_subresource(l, level, face, layer, payload);
+            }
+        }
+        levels[level].byte_length =
+            index_size + payload.size() - levels[level].byte_offset;
+        levels[level].uncompressed_byte_length = levels[level].byte_length;
+    }
+
+    vector<uint8_t> out;
+    append(out, header);
+    for (const auto& level : levels) append(out, level);
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+template <typename Parser>
+static Image parse(const vector<uint8_t>& bytes) {
+    Buffer buf(bytes.size());
+    if (!bytes.empty()) memcpy(buf.GetData(), bytes.data(), bytes.size());
+    Parser parser;
+    return parser.Parse(buf);
+}
+
+// written back by a writer and parsed again
+template <typename Parser, typename Writer>
+static Image rewrite(const Image& image) {
+    ostringstream out;
+    Writer writer;
+    if (!writer.Write(out, image)) return Image();
+    const string bytes = out.str();
+    return parse<Parser>(vector<uint8_t>(bytes.begin(), bytes.end()));
+}
+
+// every subresource is where the layout puts it, inside the parsed file
+static bool matches(const Image& image, const Layout& l) {
+    if (!image.data || !image.storage.GetData() || image.Width != l.width ||
+        image.Height != l.height || image.GetMipLevels() != l.levels ||
+        image.face_count != l.faces || image.array_size != l.layers ||
+        image.mipmaps.size() != (size_t)l.levels * l.faces * l.layers) {
+        return false;
+    }
+    const uint8_t* begin = image.storage.GetData();
+    const uint8_t* end = begin + image.storage.GetDataSize();
+    for (uint32_t layer = 0; layer < l.layers; layer++) {
+        for (uint32_t face = 0; face < l.faces; face++) {
+            for (uint32_t level = 0; level < l.levels; level++) {
+                const auto& mip = image.GetSubresource(level, face, layer);
+                const uint8_t* data =
+                    image.GetSubresourceData(level, face, layer);
+                size_t pitch;
+                const size_t size = level_size(l, level, pitch);
+                if (mip.Width != max(1u, l.width >> level) ||
+                    mip.Height != max(1u, l.height >> level) ||
+                    mip.pitch != pitch || mip.data_size != size ||
+                    data < begin || data + size > end) {
+                    return false;
+                }
+                for (size_t i = 0; i < size; i++) {
+                    if (data[i] != pattern(level, face, layer, i)) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// truncated files give empty images instead of reading past their end
+template <typename Parser>
+static bool rejects_truncated(const vector<uint8_t>& bytes) {
+    for (size_t size = 0; size < bytes.size(); size += 1 + size / 8) {
+        const vector<uint8_t> truncated(bytes.begin(), bytes.begin() + size);
+        const Image image = parse<Parser>(truncated);
+        if (image.data || !image.mipmaps.empty()) return false;
+    }
+    return true;
+}
+
+// the subresources of a texture of the assets tile the parsed file
+static bool check_asset(AssetLoader& asset_loader, const string& name) {
+    Buffer buf = asset_loader.SyncOpenAndReadBinary(name.c_str());
+    const char lfs_pointer[] = "version https://git-lfs";
+    if (buf.GetDataSize() < sizeof(lfs_pointer) ||
+        !memcmp(buf.GetData(), lfs_pointer, sizeof(lfs_pointer) - 1)) {
+        cout << name << " is not checked out, skipped" << endl;
+        return true;
+    }
+
+    Image image;
+    if (name.substr(name.find_last_of('.')) == ".pvr") {
+        PVR::PvrParser pvr_parser;
+        image = pvr_parser.Parse(buf);
+    } else {
+        DdsParser dds_parser;
+        image = dds_parser.Parse(buf);
+    }
+
+    const uint8_t* end = image.storage.GetData() + image.storage.GetDataSize();
+    vector<pair<size_t, size_t>> ranges;
+    for (const auto& mip : image.mipmaps) {
+        size_t pitch;
+        if (mip.data_size != GetMipSize(image, mip.Width, mip.Height, pitch) ||
+            image.data + mip.offset + mip.data_size > end) {
+            cerr << name << ": subresource at " << mip.offset
+                 << " out of place" << endl;
+            return false;
+        }
+        ranges.emplace_back(mip.offset, mip.offset + mip.data_size);
+    }
+    sort(ranges.begin(), ranges.end());
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].first < ranges[i - 1].second) {
+            cerr << name << ": subresources overlap" << endl;
+            return false;
+        }
+    }
+    cout << name << ": " << image.GetMipLevels() << " levels, "
+         << image.face_count << " faces, " << image.array_size << " layers"
+         << endl;
+    return !image.mipmaps.empty();
+}
+
+int main() {
+    int failed = 0;
+
+    struct {
+        const char* name;
+        Layout layout;
+        bool dx10;
+    } const dds_cases[] = {
+        {"DXT1 mip chain", {8, 2, 4, 1, 1, COMPRESSED_FORMAT::DXT1}, false},
+        {"RGBA8 legacy cube", {4, 4, 3, 6, 1, COMPRESSED_FORMAT::NONE}, false},
+        {"BC7 cube", {16, 16, 5, 6, 1, COMPRESSED_FORMAT::BC7}, true},
+        {"RGBA8 array", {5, 3, 3, 1, 4, COMPRESSED_FORMAT::NONE}, true},
+        {"BC1 cube array", {8, 8, 2, 6, 2, COMPRESSED_FORMAT::BC1}, true}};
+    for (const auto& c : dds_cases) {
+        const auto bytes = make_dds(c.layout, c.dx10);
+        const Image image = parse<DdsParser>(bytes);
+        if (!matches(image, c.layout) ||
+            !rejects_truncated<DdsParser>(bytes)) {
+            cerr << "DDS " << c.name << " mismatch" << endl;
+            failed++;
+        }
+        // rewritten as DDS and as KTX2
+        if (!matches(rewrite<DdsParser, DdsWriter>(image), c.layout) ||
+            !matches(rewrite<KTX2::Ktx2Parser, KTX2::Ktx2Writer>(image),
+                     c.layout)) {
+            cerr << "DDS " << c.name << " rewritten mismatch" << endl;
+            failed++;
+        }
+    }
+
+    struct {
+        const char* name;
+        Layout layout;
+        bool legacy_header;
+    } const pvr_cases[] = {
+        {"BC1 cube", {16, 8, 5, 6, 1, COMPRESSED_FORMAT::BC1}, false},
+        {"RGBA8 surfaces", {6, 6, 3, 1, 3, COMPRESSED_FORMAT::NONE}, false},
+        {"legacy RGBA8", {4, 2, 2, 1, 1, COMPRESSED_FORMAT::NONE}, true},
+        {"legacy BC1 cube", {8, 8, 4, 6, 1, COMPRESSED_FORMAT::BC1}, true}};
+    for (const auto& c : pvr_cases) {
+        const auto bytes = make_pvr(c.layout, c.legacy_header);
+        // a legacy file 4 bytes short reads as a packed one
+        if (!matches(parse<PVR::PvrParser>(bytes), c.layout) ||
+            (!c.legacy_header && !rejects_truncated<PVR::PvrParser>(bytes))) {
+            cerr << "PVR " << c.name << " mismatch" << endl;
+            failed++;
+        }
+    }
+
+    struct {
+        const char* name;
+        Layout layout;
+    } const ktx2_cases[] = {
+        {"BC7 layers", {32, 16, 6, 1, 3, COMPRESSED_FORMAT::BC7}},
+        {"RGBA8 cube", {8, 8, 4, 6, 1, COMPRESSED_FORMAT::NONE}},
+        {"BC1 single level", {12, 12, 1, 1, 1, COMPRESSED_FORMAT::BC1}}};
+    for (const auto& c : ktx2_cases) {
+        const auto bytes = make_ktx2(c.layout);
+        const Image image = parse<KTX2::Ktx2Parser>(bytes);
+        if (!matches(image, c.layout) ||
+            !rejects_truncated<KTX2::Ktx2Parser>(bytes)) {
+            cerr << "KTX2 " << c.name << " mismatch" << endl;
+            failed++;
+        }
+        if (!matches(rewrite<KTX2::Ktx2Parser, KTX2::Ktx2Writer>(image),
+                     c.layout) ||
+            !matches(rewrite<DdsParser, DdsWriter>(image), c.layout)) {
+            cerr << "KTX2 " << c.name << " rewritten mismatch" << endl;
+            failed++;
+        }
+    }
+
+    cout << sizeof(dds_cases) / sizeof(dds_cases[0]) +
+                sizeof(pvr_cases) / sizeof(pvr_cases[0]) +
+                sizeof(ktx2_cases) / sizeof(ktx2_cases[0])
+         << " containers parsed, " << failed << " mismatches" << endl;
+
+    AssetLoader asset_loader;
+    if (!asset_loader.Initialize()) {
+        for (const char* name :
+             {"Textures/cubemap.dds", "Textures/hdr/PaperMill_posx.dds",
+              "Textures/hdr/PaperMill_radiance_posx.dds",
+              "Textures/viking_room.pvr"}) {
+            if (!check_asset(asset_loader, name)) failed++;
+        }
+        asset_loader.Finalize();
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "TGA.hpp"
+
+using namespace My;
+using namespace std;
+
+// TGA files synthesized for every image type, depth and origin
+
+struct TgaCase {
+    uint8_t image_type;
+    uint8_t pixel_depth;
+    uint8_t entry_depth;  // of the color map
+    uint8_t alpha_depth;
+    bool top_to_bottom;
+    bool right_to_left;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct TgaFile {
+    vector<uint8_t> bytes;
+    vector<uint8_t> expected;  // tightly packed, top row first
+    uint32_t out_bytes;
+};
+
+static bool is_rle(const TgaCase& c) { return c.image_type >= 9; }
+
+static bool is_color_mapped(const TgaCase& c) {
+    return (c.image_type & 7) == 1;
+}
+
+static bool is_gray(const TgaCase& c) { return (c.image_type & 7) == 3; }
+
+// the reference conversion of a pixel or color map entry of the file
+static void reference_color(const uint8_t* in, const uint8_t depth,
+                            const uint32_t out_bytes, uint8_t* out) {
+    if (depth == 15 || depth == 16) {
+        const uint32_t color = in[0] | (in[1] << 8);
+        const uint32_t channels[3] = {(color >> 10) & 31, (color >> 5) & 31,
+                                      color & 31};
+        for (int k = 0; k < 3; k++) {
+            out[k] = static_cast<uint8_t>((channels[k] * 255 + 15) / 31);
+        }
+        if (out_bytes == 4) out[3] = (color & 0x8000) ? 255 : 0;
+    } else {
+        out[0] = in[2];
+        out[1] = in[1];
+        out[2] = in[0];
+        if (out_bytes == 4) out[3] = in[3];
+    }
+}
+
+static void put16(vector<uint8_t>& out, const uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+// run length encodes the whole image, so that packets straddle scanlines
+static void encode_rle(const vector<uint8_t>& pixels, const uint32_t bytes,
+                       vector<uint8_t>& out) {
+    const size_t count = pixels.size() / bytes;
+    const auto same = [&](const size_t a, const size_t b) {
+        return !memcmp(&pixels[a * bytes], &pixels[b * bytes], bytes);
+    };
+    size_t i = 0;
+    while (i < count) {
+        size_t run = 1;
+        while (i + run < count && run < 128 && same(i, i + run)) run++;
+        if (run >= 2) {
+            out.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+            out.insert(out.end(), &pixels[i * bytes], &pixels[(i + 1) * bytes]);
+            i += run;
+            continue;
+        }
+
+        size_t raw = 1;
+        while (i + raw < count && raw < 128 &&
+               !(i + raw + 1 < count && same(i + raw, i + raw + 1))) {
+            raw++;
+        }
+        out.push_back(static_cast<uint8_t>(raw - 1));
+        out.insert(out.end(), &pixels[i * bytes],
+                   &pixels[(i + raw) * bytes]);
+        i += raw;
+    }
+}
+
+static TgaFile make_file(const TgaCase& c, mt19937& generator) {
+    uniform_int_distribution<int> byte(0, 255);
+    const uint32_t in_bytes = (c.pixel_depth + 7) >> 3;
+    const uint8_t color_depth =
+        is_color_mapped(c) ? c.entry_depth : c.pixel_depth;
+
+    TgaFile file;
+    if (is_gray(c)) {
+        file.out_bytes = in_bytes;
+    } else if (color_depth == 32 || (color_depth == 16 && c.alpha_depth)) {
+        file.out_bytes = 4;
+    } else {
+        file.out_bytes = 3;
+    }
+
+    // a color map with 200 entries starting at index 5
+    const uint32_t first_entry = 5;
+    const uint32_t map_length = 200;
+    const uint32_t entry_bytes = (c.entry_depth + 7) >> 3;
+    vector<uint8_t> color_map;
+    if (is_color_mapped(c)) {
+        color_map.resize(map_length * entry_bytes);
+        for (auto& value : color_map) {
+            value = static_cast<uint8_t>(byte(generator));
+        }
+    }
+
+    // pixels in file order, with runs
+    const size_t count = (size_t)c.width * c.height;
+    vector<uint8_t> pixels(count * in_bytes);
+    for (size_t i = 0; i < count; i++) {
+        if (i && byte(generator) < 128) {
+            memcpy(&pixels[i * in_bytes], &pixels[(i - 1) * in_bytes],
+                   in_bytes);
+            continue;
+        }
+        for (uint32_t k = 0; k < in_bytes; k++) {
+            pixels[i * in_bytes + k] = static_cast<uint8_t>(byte(generator));
+        }
+        if (is_color_mapped(c)) {
+            // mostly inside the color map
+            const uint32_t index = byte(generator) < 16
+                                       ? static_cast<uint32_t>(byte(generator))
+                                       : first_entry + byte(generator) % 200;
+            pixels[i * in_bytes] = static_cast<uint8_t>(index);
+            if (in_bytes == 2) pixels[i * in_bytes + 1] = 0;
+        }
+    }
+
+    file.expected.resize(count * file.out_bytes);
+    for (uint32_t y = 0; y < c.height; y++) {
+        for (uint32_t x = 0; x < c.width; x++) {
+            const uint8_t* in = &pixels[((size_t)y * c.width + x) * in_bytes];
+            const uint32_t row = c.top_to_bottom ? y : c.height - 1 - y;
+            const uint32_t column = c.right_to_left ? c.width - 1 - x : x;
+            uint8_t* out = &file.expected[((size_t)row * c.width + column) *
+                                          file.out_bytes];
+            if (is_gray(c)) {
+                memcpy(out, in, in_bytes);
+            } else if (is_color_mapped(c)) {
+                const uint32_t index = in[0] | (in_bytes == 2 ? in[1] << 8 : 0);
+                if (index >= first_entry && index < first_entry + map_length) {
+                    reference_color(
+                        &color_map[(index - first_entry) * entry_bytes],
+                        c.entry_depth, file.out_bytes, out);
+                } else {
+                    memset(out, 0, file.out_bytes);
+                }
+            } else {
+                reference_color(in, c.pixel_depth, file.out_bytes, out);
+            }
+        }
+    }
+
+    auto& out = file.bytes;
+    const char id[] = "test";
+    out.push_back(sizeof(id));
+    out.push_back(is_color_mapped(c) ? 1 : 0);
+    out.push_back(c.image_type);
+    put16(out, is_color_mapped(c) ? first_entry : 0);
+    put16(out, is_color_mapped(c) ? map_length : 0);
+    out.push_back(is_color_mapped(c) ? c.entry_depth : 0);
+    put16(out, 0);
+    put16(out, 0);
+    put16(out, c.width);
+    put16(out, c.height);
+    out.push_back(c.pixel_depth);
+    out.push_back(static_cast<uint8_t>(c.alpha_depth |
+                                       (c.right_to_left ? 0x10 : 0) |
+                                       (c.top_to_bottom ? 0x20 : 0)));
+    out.insert(out.end(), id, id + sizeof(id));
+    out.insert(out.end(), color_map.begin(), color_map.end());
+    if (is_rle(c)) {
+        encode_rle(pixels, in_bytes, out);
+    } else {
+        out.insert(out.end(), pixels.begin(), pixels.end());
+    }
+    return file;
+}
+
+static Image parse(const vector<uint8_t>& bytes) {
+    Buffer buf(bytes.size());
+    if (!bytes.empty()) memcpy(buf.GetData(), bytes.data(), bytes.size());
+    TgaParser parser;
+    return parser.Parse(buf);
+}
+
+static bool matches(const Image& image, const TgaCase& c,
+                    const TgaFile& file) {
+    if (!image.data || image.Width != c.width || image.Height != c.height ||
+        image.bitcount != file.out_bytes * 8) {
+        return false;
+    }
+    const size_t row_bytes = (size_t)c.width * file.out_bytes;
+    for (uint32_t y = 0; y < c.height; y++) {
+        if (memcmp(image.data + image.pitch * y,
+                   &file.expected[y * row_bytes], row_bytes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// truncated and corrupted files decode without reading past their end
+static void fuzz(const TgaFile& file, mt19937& generator) {
+    for (size_t size = 0; size < file.bytes.size();
+         size += 1 + size / 16) {
+        vector<uint8_t> truncated(file.bytes.begin(),
+                                  file.bytes.begin() + size);
+        Image image = parse(truncated);
+    }
+
+    // flips bytes of everything but the image size
+    uniform_int_distribution<size_t> position(0, file.bytes.size() - 1);
+    uniform_int_distribution<int> byte(0, 255);
+    for (int n = 0; n < 64; n++) {
+        auto corrupted = file.bytes;
+        for (int k = 0; k < 4; k++) {
+            const size_t i = position(generator);
+            if (i >= 12 && i < 16) continue;
+            corrupted[i] = static_cast<uint8_t>(byte(generator));
+        }
+        Image image = parse(corrupted);
+    }
+}
+
+int main() {
+    mt19937 generator(46);
+
+    struct {
+        uint8_t image_type;
+        uint8_t pixel_depth;
+        uint8_t entry_depth;
+        uint8_t alpha_depth;
+    } const formats[] = {
+        {2, 15, 0, 0},  {2, 16, 0, 1},  {2, 16, 0, 0},  {2, 24, 0, 0},
+        {2, 32, 0, 8},  {3, 8, 0, 0},   {3, 16, 0, 8},  {1, 8, 24, 0},
+        {1, 8, 32, 8},  {1, 16, 15, 0}, {1, 8, 16, 1},  {10, 15, 0, 0},
+        {10, 16, 0, 1}, {10, 24, 0, 0}, {10, 32, 0, 8}, {11, 8, 0, 0},
+        {11, 16, 0, 8}, {9, 8, 24, 0},  {9, 16, 32, 8}, {9, 8, 16, 1}};
+    const uint32_t sizes[][2] = {{1, 1}, {7, 5}, {130, 33}};
+
+    int count = 0;
+    int failed = 0;
+    for (const auto& format : formats) {
+        for (const auto& size : sizes) {
+            for (int origin = 0; origin < 4; origin++) {
+                const TgaCase c{format.image_type, format.pixel_depth,
+                                format.entry_depth, format.alpha_depth,
+                                (origin & 1) != 0,  (origin & 2) != 0,
+                                size[0],            size[1]};
+                const TgaFile file = make_file(c, generator);
+                count++;
+                if (!matches(parse(file.bytes), c, file)) {
+                    failed++;
+                    cerr << "mismatch: type " << (int)c.image_type
+                         << ", depth " << (int)c.pixel_depth << "/"
+                         << (int)c.entry_depth << ", origin " << origin
+                         << ", " << c.width << "x" << c.height << endl;
+                }
+                if (size[0] == 7) fuzz(file, generator);
+            }
+        }
+    }
+
+    cout << count << " TGA images decoded, " << failed << " mismatches"
+         << endl;
+
+    return failed ? 1 : 0;
+}
@@ -9,6 +9,7 @@
 #include "AssetLoader.hpp"
 #include "BaseApplication.hpp"
 #include "PVR.hpp"
+#include "PixelConversion.hpp"
 #include "SceneManager.hpp"
 #include "ispc_texcomp.h"
 
@@ -25,6 +26,42 @@ static ostream& operator<<(ostream& out,
     return out;
 }
 
+// The texture converted into the layout and resized to width x height by
+// nearest sampling, a row at a time. Black for compressed textures.
+static vector<uint8_t> resample_texture(const Image& texture,
+                                        const PixelLayout& layout,
+                                        const int32_t width,
+                                        const int32_t height) {
+    vector<uint8_t> out((size_t)width * height * layout.bytes);
+    PixelLayout texture_layout;
+    if (!GetPixelLayout(texture, texture_layout)) return out;
+
+    vector<uint8_t> row((size_t)texture.Width * layout.bytes);
+    const float ratio_x = (float)texture.Width / width;
+    const float ratio_y = (float)texture.Height / height;
+    int64_t converted = -1;
+    for (int32_t y = 0; y < height; y++) {
+        const auto source_y = static_cast<int64_t>(std::floor(y * ratio_y));
+        if (source_y != converted) {
+            ConvertPixels(texture.data + source_y * texture.pitch,
+                          texture_layout, row.data(), layout, texture.Width);
+            converted = source_y;
+        }
+
+        uint8_t* dst = out.data() + (size_t)y * width * layout.bytes;
+        if ((uint32_t)width == texture.Width) {
+            memcpy(dst, row.data(), row.size());
+            continue;
+        }
+        for (int32_t x = 0; x < width; x++) {
+            const auto source_x = static_cast<size_t>(std::floor(x * ratio_x));
+            memcpy(dst + (size_t)x * layout.bytes,
+                   row.data() + source_x * layout.bytes, layout.bytes);
+        }
+    }
+    return out;
+}
+
 void save_as_tga(const rgba_surface& surface, int32_t channels,
                  const std::string&& filename) {
     assert(filename != "");
@@ -246,31 +283,19 @@ int main(int argc, char** argv) {
                 surf.height = max_height_1;
                 int32_t channels = 4;
                 surf.stride = channels * surf.width;
-                std::vector<uint8_t> buf1(surf.stride * surf.height);
+                PixelLayout rgba8;
+                GetPixelLayout(PIXEL_FORMAT::RGBA8, false, rgba8);
+                std::vector<uint8_t> buf1 = resample_texture(
+                    *albedo_texture, rgba8, surf.width, surf.height);
                 surf.ptr = buf1.data();
-                float albedo_ratio_x = (float)albedo_texture_width / surf.width;
-                float albedo_ratio_y =
-                    (float)albedo_texture_height / surf.height;
-
-                for (int32_t y = 0; y < surf.height; y++) {
-                    for (int32_t x = 0; x < surf.width; x++) {
-                        *(surf.ptr + y * surf.stride + x * channels) =
-                            albedo_texture->GetR(
-                                std::floor(x * albedo_ratio_x),
-                                std::floor(y * albedo_ratio_y));
-                        *(surf.ptr + y * surf.stride + x * channels + 1) =
-                            albedo_texture->GetG(
-                                std::floor(x * albedo_ratio_x),
-                                std::floor(y * albedo_ratio_y));
-                        *(surf.ptr + y * surf.stride + x * channels + 2) =
-                            albedo_texture->GetB(
-                                std::floor(x * albedo_ratio_x),
-                                std::floor(y * albedo_ratio_y));
-                        *(surf.ptr + y * surf.stride + x * channels + 3) =
-                            albedo_texture->GetA(
-                                std::floor(x * albedo_ratio_x),
-                                std::floor(y * albedo_ratio_y));
-                    }
+
+                // gray albedo replicated, as the accessors read it
+                PixelLayout albedo_layout;
+                if (GetPixelLayout(*albedo_texture, albedo_layout) &&
+                    albedo_layout.channels == 1) {
+                    const int8_t gray[4] = {0, 0, 0, 3};
+                    SwizzlePixels(surf.ptr, rgba8, surf.ptr, rgba8, gray,
+                                  surf.width * surf.height);
                 }
 
                 // Now, compress surf with BC7
@@ -296,32 +321,19 @@ int main(int argc, char** argv) {
                 surf.stride = channels * surf.width;
                 std::vector<uint8_t> buf2(surf.stride * surf.height);
                 surf.ptr = buf2.data();
-                float metallic_ratio_x =
-                    (float)metallic_texture_width / surf.width;
-                float metallic_ratio_y =
-                    (float)metallic_texture_height / surf.height;
-                float roughness_ratio_x =
-                    (float)roughness_texture_width / surf.width;
-                float roughness_ratio_y =
-                    (float)roughness_texture_height / surf.height;
-                float ao_ratio_x = (float)ao_texture_width / surf.width;
-                float ao_ratio_y = (float)ao_texture_height / surf.height;
-
-                for (int32_t y = 0; y < surf.height; y++) {
-                    for (int32_t x = 0; x < surf.width; x++) {
-                        *(surf.ptr + y * surf.stride + x * channels) =
-                            metallic_texture->GetX(
-                                std::floor(x * metallic_ratio_x),
-                                std::floor(y * metallic_ratio_y));
-                        *(surf.ptr + y * surf.stride + x * channels + 1) =
-                            roughness_texture->GetX(
-                                std::floor(x * roughness_ratio_x),
-                                std::floor(y * roughness_ratio_y));
-                        *(surf.ptr + y * surf.stride + x * channels + 2) =
-                            ao_texture->GetX(std::floor(x * ao_ratio_x),
-                                             std::floor(y * ao_ratio_y));
-                        *(surf.ptr + y * surf.stride + x * channels + 3) = 0;
-                    }
+
+                // the first channel of each texture packed into RGB
+                PixelLayout r8, rgba8;
+                GetPixelLayout(PIXEL_FORMAT::R8, false, r8);
+                GetPixelLayout(PIXEL_FORMAT::RGBA8, false, rgba8);
+                const Image* sources[] = {metallic_texture.get(),
+                                          roughness_texture.get(),
+                                          ao_texture.get()};
+                for (uint32_t c = 0; c < 3; c++) {
+                    const auto channel = resample_texture(
+                        *sources[c], r8, surf.width, surf.height);
+                    InsertChannel(channel.data(), r8, 0, surf.ptr, rgba8, c,
+                                  surf.width * surf.height);
                 }
 
                 // Now, compress surf with BC1
@@ -345,18 +357,12 @@ int main(int argc, char** argv) {
                 surf.width = normal_texture_width;
                 surf.height = normal_texture_height;
                 surf.stride = channels * surf.width;
-                std::vector<uint8_t> buf2(surf.stride * surf.height);
+                PixelLayout rg8;
+                GetPixelLayout(PIXEL_FORMAT::RG8, false, rg8);
+                std::vector<uint8_t> buf2 = resample_texture(
+                    *normal_texture, rg8, surf.width, surf.height);
                 surf.ptr = buf2.data();
 
-                for (int32_t y = 0; y < surf.height; y++) {
-                    for (int32_t x = 0; x < surf.width; x++) {
-                        *(surf.ptr + y * surf.stride + x * channels) =
-                            normal_texture->GetX(x, y);
-                        *(surf.ptr + y * surf.stride + x * channels + 1) =
-                            normal_texture->GetY(x, y);
-                    }
-                }
-
                 // Now, compress surf with BC5
                 auto outputFileName = pMaterial->GetName();
                 if (argc >= 3) {
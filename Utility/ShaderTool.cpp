@@ -0,0 +1,278 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "OGEX.hpp"
+#include "ShaderReflection.hpp"
+#include "ShaderVariant.hpp"
+#include "spirv_cross/spirv_glsl.hpp"
+#include "spirv_cross/spirv_msl.hpp"
+
+using namespace My;
+using namespace std;
+
+static bool read_spirv(const char* filename, vector<uint32_t>& spirv) {
+    ifstream file(filename, ios::binary | ios::ate);
+    if (!file) return false;
+
+    const auto size = static_cast<size_t>(file.tellg());
+    if (size == 0 || size % sizeof(uint32_t)) return false;
+
+    spirv.resize(size / sizeof(uint32_t));
+    file.seekg(0);
+    return static_cast<bool>(
+        file.read(reinterpret_cast<char*>(spirv.data()), size));
+}
+
+static bool write_text(const char* filename, const string& text) {
+    ofstream file(filename, ios::binary | ios::trunc);
+    file << text;
+    return static_cast<bool>(file);
+}
+
+// permuted by the material features of the forward pass
+const char* const kPermutedShaders[] = {"pbr.frag"};
+
+static bool write_variants(const char* filename,
+                           const vector<const char*>& scenes) {
+    set<ShaderVariantKey> keys;
+    for (const auto* scene_file : scenes) {
+        ifstream file(scene_file);
+        if (!file) {
+            fprintf(stderr, "can not read %s\n", scene_file);
+            return false;
+        }
+        const string text((istreambuf_iterator<char>(file)),
+                          istreambuf_iterator<char>());
+
+        OgexParser ogex_parser;
+        const auto scene = ogex_parser.Parse(text);
+        if (!scene) {
+            fprintf(stderr, "%s: not an OpenGEX scene\n", scene_file);
+            return false;
+        }
+        keys.merge(CollectShaderVariants(*scene, ShaderPass::Forward));
+    }
+
+    string text =
+        "# the shader permutations the scenes draw with, written by\n"
+        "# ShaderTool --variants\n"
+        "# <shader>.v<key> [defines]\n";
+    for (const auto* shader : kPermutedShaders) {
+        for (const auto key : keys) {
+            text += GetShaderVariantName(shader, key);
+            for (const auto& define : GetShaderVariantDefines(key)) {
+                text += ' ' + define;
+            }
+            text += '\n';
+        }
+    }
+
+    return write_text(filename, text);
+}
+
+static void add_resources(const spirv_cross::Compiler& compiler,
+                          const spirv_cross::SmallVector<spirv_cross::Resource>&
+                              resources,
+                          const ShaderResourceType type,
+                          ShaderReflection& reflection) {
+    for (const auto& resource : resources) {
+        ShaderResource item;
+        item.type = type;
+        item.name = resource.name;
+        item.set =
+            compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+        item.binding =
+            compiler.get_decoration(resource.id, spv::DecorationBinding);
+
+        if (type == ShaderResourceType::UniformBlock) {
+            // blocks are named after their type, as GL looks them up
+            const auto& block_name = compiler.get_name(resource.base_type_id);
+            if (!block_name.empty()) item.name = block_name;
+
+            const auto& block = compiler.get_type(resource.base_type_id);
+            item.size = static_cast<uint32_t>(
+                compiler.get_declared_struct_size(block));
+            for (uint32_t i = 0; i < block.member_types.size(); i++) {
+                ShaderBlockMember member;
+                member.name =
+                    compiler.get_member_name(resource.base_type_id, i);
+                member.offset = compiler.type_struct_member_offset(block, i);
+                member.size = static_cast<uint32_t>(
+                    compiler.get_declared_struct_member_size(block, i));
+                item.members.push_back(member);
+            }
+        }
+
+        reflection.resources.push_back(item);
+    }
+}
+
+// GL has no separate samplers, the texture and the sampler a shader reads
+// together are merged into one uniform, named as spirv-cross does. It takes
+// the binding of the texture, so that the GLSL compiled to SPIR-V declares
+// the texture unit itself.
+static void combine_image_samplers(spirv_cross::CompilerGLSL& compiler,
+                                   ShaderReflection* reflection) {
+    compiler.build_combined_image_samplers();
+
+    for (const auto& remap : compiler.get_combined_image_samplers()) {
+        const auto name = "SPIRV_Cross_Combined" +
+                          compiler.get_name(remap.image_id) +
+                          compiler.get_name(remap.sampler_id);
+        compiler.set_name(remap.combined_id, name);
+        compiler.set_decoration(
+            remap.combined_id, spv::DecorationBinding,
+            compiler.get_decoration(remap.image_id, spv::DecorationBinding));
+
+        if (reflection) {
+            ShaderResource item;
+            item.type = ShaderResourceType::CombinedSampler;
+            item.name = name;
+            item.set = compiler.get_decoration(remap.image_id,
+                                               spv::DecorationDescriptorSet);
+            item.binding =
+                compiler.get_decoration(remap.image_id, spv::DecorationBinding);
+            reflection->resources.push_back(item);
+        }
+    }
+}
+
+static void remove_unused_variables(spirv_cross::Compiler& compiler) {
+    auto active = compiler.get_active_interface_variables();
+    compiler.get_shader_resources(active);
+    compiler.set_enabled_interface_variables(std::move(active));
+}
+
+int main(int argc, char** argv) {
+    const char* input = nullptr;
+    const char* variants_output = nullptr;
+    vector<const char*> scenes;
+    const char* glsl_output = nullptr;
+    const char* msl_output = nullptr;
+    const char* reflection_output = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--glsl") == 0) {
+            glsl_output = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--msl") == 0) {
+            msl_output = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--reflect") == 0) {
+            reflection_output = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--variants") == 0) {
+            variants_output = argv[++i];
+        } else {
+            input = argv[i];
+            scenes.push_back(argv[i]);
+        }
+    }
+
+    if (variants_output) {
+        return write_variants(variants_output, scenes) ? 0 : 1;
+    }
+
+    if (!input) {
+        fprintf(stderr,
+                "Usage: ShaderTool <input.spv> [--glsl <output>] "
+                "[--msl <output>] [--reflect <output>]\n"
+                "       ShaderTool --variants <output> <scene.ogex>...\n");
+        return 1;
+    }
+
+    vector<uint32_t> spirv;
+    if (!read_spirv(input, spirv)) {
+        fprintf(stderr, "%s: not a SPIR-V module\n", input);
+        return 1;
+    }
+
+    try {
+        if (reflection_output) {
+            ShaderReflection reflection;
+
+            spirv_cross::Compiler compiler(spirv);
+            const auto resources = compiler.get_shader_resources();
+            add_resources(compiler, resources.uniform_buffers,
+                          ShaderResourceType::UniformBlock, reflection);
+            add_resources(compiler, resources.separate_images,
+                          ShaderResourceType::Texture, reflection);
+            add_resources(compiler, resources.sampled_images,
+                          ShaderResourceType::Texture, reflection);
+            add_resources(compiler, resources.separate_samplers,
+                          ShaderResourceType::Sampler, reflection);
+            add_resources(compiler, resources.storage_buffers,
+                          ShaderResourceType::StorageBuffer, reflection);
+            add_resources(compiler, resources.storage_images,
+                          ShaderResourceType::StorageImage, reflection);
+
+            spirv_cross::CompilerGLSL glsl(spirv);
+            remove_unused_variables(glsl);
+            combine_image_samplers(glsl, &reflection);
+
+            // the shader and the C++ side must agree on the constant buffers
+            vector<string> errors;
+            if (!CheckShaderReflection(reflection, GetConstantBufferLayouts(),
+                                       errors)) {
+                for (const auto& error : errors) {
+                    fprintf(stderr, "%s: %s\n", input, error.c_str());
+                }
+                return 1;
+            }
+
+            if (!write_text(reflection_output,
+                            SerializeShaderReflection(reflection))) {
+                fprintf(stderr, "can not write %s\n", reflection_output);
+                return 1;
+            }
+        }
+
+        if (glsl_output) {
+            spirv_cross::CompilerGLSL glsl(spirv);
+            auto options = glsl.get_common_options();
+            options.version = 420;
+            options.es = false;
+            glsl.set_common_options(options);
+            remove_unused_variables(glsl);
+            combine_image_samplers(glsl, nullptr);
+
+            // storage buffers, such as the light clusters, are core from
+            // GLSL 4.30 only
+            const auto resources = glsl.get_shader_resources(
+                glsl.get_active_interface_variables());
+            if (!resources.storage_buffers.empty()) {
+                glsl.require_extension("GL_ARB_shader_storage_buffer_object");
+            }
+
+            if (!write_text(glsl_output, glsl.compile())) {
+                fprintf(stderr, "can not write %s\n", glsl_output);
+                return 1;
+            }
+        }
+
+        if (msl_output) {
+            spirv_cross::CompilerMSL msl(spirv);
+            auto msl_options = msl.get_msl_options();
+            msl_options.set_msl_version(2, 1, 1);
+            msl_options.enable_decoration_binding = true;
+            msl.set_msl_options(msl_options);
+            auto options = msl.get_common_options();
+            options.vertex.flip_vert_y = true;
+            msl.set_common_options(options);
+            remove_unused_variables(msl);
+
+            if (!write_text(msl_output, msl.compile())) {
+                fprintf(stderr, "can not write %s\n", msl_output);
+                return 1;
+            }
+        }
+    } catch (const exception& e) {
+        fprintf(stderr, "%s: %s\n", input, e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,595 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BMP.hpp"
+#include "DDS.hpp"
+#include "HDR.hpp"
+#include "JPEG.hpp"
+#include "KTX2.hpp"
+#include "MipmapGenerator.hpp"
+#include "PNG.hpp"
+#include "PVR.hpp"
+#include "PipelineStateCache.hpp"
+#include "PixelConversion.hpp"
+#include "TGA.hpp"
+#include "ispc_texcomp.h"
+
+using namespace My;
+using namespace std;
+namespace fs = std::filesystem;
+
+// Compresses a directory of textures, or the ones a manifest lists, with
+// their whole mip chains into DDS or KTX2 files. The format follows what a
+// texture holds: BC7 for albedo, BC5 for normals, BC4 for single channel
+// masks such as roughness and AO, BC6H for HDR, or ASTC 6x6 for all but HDR.
+// Inputs whose content hash matches the last run are skipped.
+
+// bumped whenever the same input compresses to different output
+constexpr uint32_t kCacheVersion = 1;
+constexpr const char* kCacheFileName = "TextureCache.txt";
+
+// blocks compressed by one job at a time
+constexpr uint32_t kBlocksPerTile = 1024;
+
+enum class TEXTURE_ROLE : uint8_t { Albedo, Normal, Mask, Hdr };
+
+struct Job {
+    fs::path input;
+    string name;  // the output relative to the output directory, no extension
+    TEXTURE_ROLE role;
+    bool role_given;  // by the manifest, else guessed from the name
+};
+
+// how the chain is generated and compressed
+struct Target {
+    COMPRESSED_FORMAT format;
+    bool srgb;
+    PIXEL_FORMAT chain_format;  // the mip chain is generated in
+    bool chain_float;
+    PIXEL_FORMAT input_format;  // the compressor reads
+    bool input_float;
+    int8_t swizzle[4];  // chain channels to input channels
+    uint32_t block_width;
+    uint32_t block_height;
+};
+
+struct EncoderSettings {
+    bc6h_enc_settings bc6h;
+    bc7_enc_settings bc7;
+    astc_enc_settings astc;
+};
+
+static string lowercase(string text) {
+    transform(text.begin(), text.end(), text.begin(),
+              [](unsigned char c) { return (char)tolower(c); });
+    return text;
+}
+
+static bool is_texture(const fs::path& path) {
+    const string ext = lowercase(path.extension().string());
+    for (const char* known : {".jpg", ".jpeg", ".png", ".bmp", ".tga", ".dds",
+                              ".hdr", ".pvr", ".ktx2"}) {
+        if (ext == known) return true;
+    }
+    return false;
+}
+
+static bool parse_role(const string& text, TEXTURE_ROLE& role) {
+    static const map<string, TEXTURE_ROLE> roles = {
+        {"albedo", TEXTURE_ROLE::Albedo},   {"basecolor", TEXTURE_ROLE::Albedo},
+        {"color", TEXTURE_ROLE::Albedo},    {"diffuse", TEXTURE_ROLE::Albedo},
+        {"normal", TEXTURE_ROLE::Normal},   {"roughness", TEXTURE_ROLE::Mask},
+        {"ao", TEXTURE_ROLE::Mask},         {"occlusion", TEXTURE_ROLE::Mask},
+        {"metallic", TEXTURE_ROLE::Mask},   {"height", TEXTURE_ROLE::Mask},
+        {"mask", TEXTURE_ROLE::Mask},       {"hdr", TEXTURE_ROLE::Hdr}};
+    const auto it = roles.find(lowercase(text));
+    if (it == roles.end()) return false;
+    role = it->second;
+    return true;
+}
+
+// from the suffix of the file name, such as wall_n.png or brick_rough.tga
+static TEXTURE_ROLE guess_role(const fs::path& path) {
+    if (lowercase(path.extension().string()) == ".hdr") {
+        return TEXTURE_ROLE::Hdr;
+    }
+    const string stem = lowercase(path.stem().string());
+    const auto separator = stem.find_last_of("_-");
+    if (separator == string::npos) return TEXTURE_ROLE::Albedo;
+    const string suffix = stem.substr(separator + 1);
+    for (const char* normal : {"n", "nor", "nrm", "norm", "normal"}) {
+        if (suffix == normal) return TEXTURE_ROLE::Normal;
+    }
+    for (const char* mask : {"r", "rough", "roughness", "ao", "occlusion",
+                             "m", "metal", "metallic", "metalness", "h",
+                             "height", "disp", "displacement", "mask"}) {
+        if (suffix == mask) return TEXTURE_ROLE::Mask;
+    }
+    return TEXTURE_ROLE::Albedo;
+}
+
+static string output_name(const fs::path& relative) {
+    fs::path name = relative;
+    name.replace_extension();
+    return name.generic_string();
+}
+
+// skips the output directory, which may lie inside the input directory, so
+// the files written by a previous run are not compressed again
+static bool collect_directory(const fs::path& directory,
+                              const fs::path& output_directory,
+                              vector<Job>& jobs) {
+    const fs::path skipped = fs::weakly_canonical(output_directory);
+    for (auto entry = fs::recursive_directory_iterator(directory);
+         entry != fs::recursive_directory_iterator(); ++entry) {
+        if (entry->is_directory() &&
+            fs::weakly_canonical(entry->path()) == skipped) {
+            entry.disable_recursion_pending();
+            continue;
+        }
+        if (!entry->is_regular_file() || !is_texture(entry->path())) continue;
+        const fs::path relative = fs::relative(entry->path(), directory);
+        jobs.push_back({entry->path(), output_name(relative),
+                        guess_role(entry->path()), false});
+    }
+    // the same order whatever the file system lists
+    sort(jobs.begin(), jobs.end(),
+         [](const Job& a, const Job& b) { return a.name < b.name; });
+    return true;
+}
+
+// a texture a line, relative to the manifest, optionally followed by its
+// role. # starts a comment
+static bool collect_manifest(const fs::path& manifest, vector<Job>& jobs) {
+    ifstream file(manifest);
+    if (!file) {
+        fprintf(stderr, "Cannot open manifest %s\n",
+                manifest.string().c_str());
+        return false;
+    }
+    string line;
+    uint32_t line_number = 0;
+    while (getline(file, line)) {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+        istringstream fields(line);
+        string path;
+        string role;
+        if (!(fields >> path)) continue;
+
+        Job job;
+        job.input = manifest.parent_path() / path;
+        job.name = output_name(fs::path(path).is_absolute()
+                                   ? fs::path(path).filename()
+                                   : fs::path(path));
+        job.role_given = static_cast<bool>(fields >> role);
+        if (!job.role_given) {
+            job.role = guess_role(job.input);
+        } else if (!parse_role(role, job.role)) {
+            fprintf(stderr, "%s:%u: unknown role %s\n",
+                    manifest.string().c_str(), line_number, role.c_str());
+            return false;
+        }
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
+
+static map<string, uint64_t> load_cache(const fs::path& path) {
+    map<string, uint64_t> cache;
+    ifstream file(path);
+    string line;
+    while (getline(file, line)) {
+        const auto separator = line.find(' ');
+        if (separator == string::npos) continue;
+        cache[line.substr(separator + 1)] =
+            strtoull(line.substr(0, separator).c_str(), nullptr, 16);
+    }
+    return cache;
+}
+
+static void save_cache(const fs::path& path,
+                       const map<string, uint64_t>& cache) {
+    ofstream file(path);
+    for (const auto& [name, hash] : cache) {
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+        file << hex << ' ' << name << '\n';
+    }
+}
+
+static Target target_for(const TEXTURE_ROLE role, const bool astc) {
+    const auto block = [astc](COMPRESSED_FORMAT bc) {
+        return astc ? COMPRESSED_FORMAT::ASTC_6x6 : bc;
+    };
+    const uint32_t size = astc ? 6 : 4;
+    switch (role) {
+        case TEXTURE_ROLE::Normal:
+            // ASTC keeps x in the color and y in the alpha, the channels it
+            // codes apart
+            return {block(COMPRESSED_FORMAT::BC5),
+                    false,
+                    PIXEL_FORMAT::RG8,
+                    false,
+                    astc ? PIXEL_FORMAT::RGBA8 : PIXEL_FORMAT::RG8,
+                    false,
+                    {0, static_cast<int8_t>(astc ? 0 : 1), 0, 1},
+                    size,
+                    size};
+        case TEXTURE_ROLE::Mask:
+            return {block(COMPRESSED_FORMAT::BC4),
+                    false,
+                    PIXEL_FORMAT::R8,
+                    false,
+                    astc ? PIXEL_FORMAT::RGBA8 : PIXEL_FORMAT::R8,
+                    false,
+                    {0, 0, 0, kSwizzleOne},
+                    size,
+                    size};
+        case TEXTURE_ROLE::Hdr:
+            // the ISPC ASTC encoder is LDR only
+            return {COMPRESSED_FORMAT::BC6H,
+                    false,
+                    PIXEL_FORMAT::RGBA16,
+                    true,
+                    PIXEL_FORMAT::RGBA16,
+                    true,
+                    {0, 1, 2, 3},
+                    4,
+                    4};
+        default:
+            return {block(COMPRESSED_FORMAT::BC7),
+                    true,
+                    PIXEL_FORMAT::RGBA8,
+                    false,
+                    PIXEL_FORMAT::RGBA8,
+                    false,
+                    {0, 1, 2, 3},
+                    size,
+                    size};
+    }
+}
+
+static const char* format_name(const COMPRESSED_FORMAT format) {
+    switch (format) {
+        case COMPRESSED_FORMAT::BC4:
+            return "BC4";
+        case COMPRESSED_FORMAT::BC5:
+            return "BC5";
+        case COMPRESSED_FORMAT::BC6H:
+            return "BC6H";
+        case COMPRESSED_FORMAT::BC7:
+            return "BC7";
+        default:
+            return "ASTC 6x6";
+    }
+}
+
+static Image load_image(const fs::path& path) {
+    Image image;
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) return image;
+    Buffer buf(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buf.GetData()),
+              static_cast<streamsize>(buf.GetDataSize()));
+
+    const string ext = lowercase(path.extension().string());
+    if (ext == ".jpg" || ext == ".jpeg") {
+        JfifParser jfif_parser;
+        image = jfif_parser.Parse(buf);
+    } else if (ext == ".png") {
+        PngParser png_parser;
+        image = png_parser.Parse(buf);
+    } else if (ext == ".bmp") {
+        BmpParser bmp_parser;
+        image = bmp_parser.Parse(buf);
+    } else if (ext == ".tga") {
+        TgaParser tga_parser;
+        image = tga_parser.Parse(buf);
+    } else if (ext == ".dds") {
+        DdsParser dds_parser;
+        image = dds_parser.Parse(buf);
+    } else if (ext == ".hdr") {
+        HdrParser hdr_parser(true);
+        image = hdr_parser.Parse(buf);
+    } else if (ext == ".pvr") {
+        PVR::PvrParser pvr_parser;
+        image = pvr_parser.Parse(buf);
+    } else if (ext == ".ktx2") {
+        KTX2::Ktx2Parser ktx2_parser;
+        image = ktx2_parser.Parse(buf);
+    }
+    return image;
+}
+
+static uint64_t hash_input(const fs::path& path, const TEXTURE_ROLE role,
+                           const bool ktx2, const bool astc) {
+    Fnv1aHash hash;
+    hash.Update(kCacheVersion);
+    hash.Update(role);
+    hash.Update(ktx2);
+    hash.Update(astc);
+
+    ifstream file(path, ios::binary);
+    vector<char> chunk(1 << 16);
+    while (file) {
+        file.read(chunk.data(), static_cast<streamsize>(chunk.size()));
+        hash.Update(chunk.data(), static_cast<size_t>(file.gcount()));
+    }
+    return hash.Get();
+}
+
+// any texel of level 0 less than opaque
+static bool has_alpha(const Image& image) {
+    const uint32_t levels = image.GetMipLevels();
+    for (size_t i = 0; i < image.mipmaps.size(); i += levels) {
+        const Image::Mipmap& mip = image.mipmaps[i];
+        for (uint32_t y = 0; y < mip.Height; y++) {
+            const uint8_t* row = image.data + mip.offset + y * mip.pitch;
+            for (uint32_t x = 0; x < mip.Width; x++) {
+                if (row[x * 4 + 3] != 0xFF) return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void compress_blocks(const rgba_surface& surface, uint8_t* blocks,
+                            const COMPRESSED_FORMAT format,
+                            EncoderSettings& settings) {
+    switch (format) {
+        case COMPRESSED_FORMAT::BC4:
+            CompressBlocksBC4(&surface, blocks);
+            break;
+        case COMPRESSED_FORMAT::BC5:
+            CompressBlocksBC5(&surface, blocks);
+            break;
+        case COMPRESSED_FORMAT::BC6H:
+            CompressBlocksBC6H(&surface, blocks, &settings.bc6h);
+            break;
+        case COMPRESSED_FORMAT::BC7:
+            CompressBlocksBC7(&surface, blocks, &settings.bc7);
+            break;
+        default:
+            CompressBlocksASTC(&surface, blocks, &settings.astc);
+    }
+}
+
+// Compresses every subresource of the chain. The block rows of each level
+// are split in tiles, which the workers take in turn, each padding its
+// tile to whole blocks by repeating the edge texels.
+static Image compress_image(const Image& chain, const Target& target,
+                            EncoderSettings& settings) {
+    Image image;
+    image.Width = chain.Width;
+    image.Height = chain.Height;
+    image.face_count = chain.face_count;
+    image.array_size = chain.array_size;
+    image.compressed = true;
+    image.compress_format = target.format;
+    image.bitcount = target.format == COMPRESSED_FORMAT::BC4 ? 4 : 8;
+    image.is_float = target.format == COMPRESSED_FORMAT::BC6H;
+
+    struct Tile {
+        uint32_t subresource;
+        uint32_t first_block_row;
+        uint32_t block_rows;
+    };
+    vector<Tile> tiles;
+    for (const auto& mip : chain.mipmaps) {
+        size_t pitch;
+        const size_t size = GetMipSize(image, mip.Width, mip.Height, pitch);
+        const auto subresource = static_cast<uint32_t>(image.mipmaps.size());
+        image.mipmaps.emplace_back(mip.Width, mip.Height, pitch,
+                                   image.data_size, size);
+        image.data_size += size;
+
+        const uint32_t blocks_x =
+            (mip.Width + target.block_width - 1) / target.block_width;
+        const uint32_t blocks_y =
+            (mip.Height + target.block_height - 1) / target.block_height;
+        const uint32_t rows_per_tile = max(1u, kBlocksPerTile / blocks_x);
+        for (uint32_t row = 0; row < blocks_y; row += rows_per_tile) {
+            tiles.push_back(
+                {subresource, row, min(rows_per_tile, blocks_y - row)});
+        }
+    }
+    image.data = new uint8_t[image.data_size];
+    image.pitch = image.mipmaps[0].pitch;
+
+    PixelLayout chain_layout;
+    PixelLayout input_layout;
+    GetPixelLayout(chain, chain_layout);
+    GetPixelLayout(target.input_format, target.input_float, input_layout);
+    const uint32_t bytes = input_layout.bytes;
+
+    atomic<size_t> next_tile{0};
+    const auto worker = [&]() {
+        vector<uint8_t> padded;
+        for (size_t i = next_tile++; i < tiles.size(); i = next_tile++) {
+            const Tile& tile = tiles[i];
+            const Image::Mipmap& src = chain.mipmaps[tile.subresource];
+            const Image::Mipmap& dst = image.mipmaps[tile.subresource];
+            const uint32_t width =
+                (src.Width + target.block_width - 1) / target.block_width *
+                target.block_width;
+            const uint32_t rows = tile.block_rows * target.block_height;
+            const size_t stride = (size_t)width * bytes;
+            padded.resize(stride * rows);
+
+            for (uint32_t row = 0; row < rows; row++) {
+                const uint32_t y = min(
+                    tile.first_block_row * target.block_height + row,
+                    src.Height - 1);
+                uint8_t* out = padded.data() + row * stride;
+                SwizzlePixels(chain.data + src.offset + y * src.pitch,
+                              chain_layout, out, input_layout, target.swizzle,
+                              src.Width);
+                for (uint32_t x = src.Width; x < width; x++) {
+                    memcpy(out + x * bytes, out + (src.Width - 1) * bytes,
+                           bytes);
+                }
+            }
+
+            rgba_surface surface;
+            surface.ptr = padded.data();
+            surface.width = static_cast<int32_t>(width);
+            surface.height = static_cast<int32_t>(rows);
+            surface.stride = static_cast<int32_t>(stride);
+            compress_blocks(
+                surface,
+                image.data + dst.offset + tile.first_block_row * dst.pitch,
+                target.format, settings);
+        }
+    };
+
+    const auto worker_count = static_cast<uint32_t>(
+        min<size_t>(max(1u, thread::hardware_concurrency()), tiles.size()));
+    vector<future<void>> workers;
+    for (uint32_t i = 1; i < worker_count; i++) {
+        workers.push_back(async(launch::async, worker));
+    }
+    worker();
+    for (auto& job : workers) {
+        job.get();
+    }
+    return image;
+}
+
+static bool compress_texture(const Job& job, const fs::path& output,
+                             const bool ktx2, const bool astc) {
+    Image image = load_image(job.input);
+    PixelLayout layout;
+    if (!GetPixelLayout(image, layout)) {
+        fprintf(stderr, "%s: not an uncompressed color image\n",
+                job.input.string().c_str());
+        return false;
+    }
+
+    // a float image guessed as albedo is HDR
+    const TEXTURE_ROLE role = !job.role_given && image.is_float
+                                  ? TEXTURE_ROLE::Hdr
+                                  : job.role;
+    const Target target = target_for(role, astc);
+    if (!ConvertImage(image, target.chain_format, target.chain_float)) {
+        fprintf(stderr, "%s: cannot convert the pixels\n",
+                job.input.string().c_str());
+        return false;
+    }
+
+    // a chain the file brings is kept
+    if (image.GetMipLevels() <= 1) {
+        MipmapOptions options;
+        options.srgb = target.srgb;
+        options.normal_map = role == TEXTURE_ROLE::Normal;
+        GenerateMipmaps(image, options);
+    }
+    if (image.mipmaps.empty()) {
+        image.mipmaps.emplace_back(image.Width, image.Height, image.pitch, 0,
+                                   image.data_size);
+    }
+
+    EncoderSettings settings;
+    GetProfile_bc6h_basic(&settings.bc6h);
+    const bool alpha = role == TEXTURE_ROLE::Albedo && has_alpha(image);
+    if (alpha) {
+        GetProfile_alpha_basic(&settings.bc7);
+        GetProfile_astc_alpha_fast(&settings.astc, 6, 6);
+    } else {
+        GetProfile_basic(&settings.bc7);
+        GetProfile_astc_fast(&settings.astc, 6, 6);
+    }
+
+    const Image compressed = compress_image(image, target, settings);
+
+    fs::create_directories(output.parent_path());
+    ofstream file(output, ios::binary);
+    bool written;
+    if (ktx2) {
+        KTX2::Ktx2Writer writer;
+        written = writer.Write(file, compressed, target.srgb);
+    } else {
+        DdsWriter writer;
+        written = writer.Write(file, compressed, target.srgb);
+    }
+    if (!written) {
+        fprintf(stderr, "%s: cannot write %s\n", job.input.string().c_str(),
+                output.string().c_str());
+        return false;
+    }
+
+    fprintf(stderr, "%s: %s, %u levels, %zu to %zu bytes\n", job.name.c_str(),
+            format_name(target.format), compressed.GetMipLevels(),
+            image.data_size, compressed.data_size);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr,
+                "Usage: TextureBatchCompressor <input directory | manifest> "
+                "<output directory> [dds | ktx2 | astc]\n");
+        return 1;
+    }
+
+    const fs::path input = argv[1];
+    const fs::path output_directory = argv[2];
+    const string container = argc > 3 ? argv[3] : "dds";
+    // ASTC has no DXGI format, so it is written as KTX2
+    const bool astc = container == "astc";
+    const bool ktx2 = astc || container == "ktx2";
+    if (!astc && !ktx2 && container != "dds") {
+        fprintf(stderr, "Unknown container %s\n", container.c_str());
+        return 1;
+    }
+
+    vector<Job> jobs;
+    const bool collected = fs::is_directory(input)
+                               ? collect_directory(input, output_directory,
+                                                   jobs)
+                               : collect_manifest(input, jobs);
+    if (!collected) return 1;
+
+    fs::create_directories(output_directory);
+    const fs::path cache_path = output_directory / kCacheFileName;
+    map<string, uint64_t> cache = load_cache(cache_path);
+
+    uint32_t compressed = 0;
+    uint32_t skipped = 0;
+    uint32_t failed = 0;
+    for (const auto& job : jobs) {
+        const fs::path output =
+            output_directory / (job.name + (ktx2 ? ".ktx2" : ".dds"));
+        const uint64_t hash = hash_input(job.input, job.role, ktx2, astc);
+        const auto cached = cache.find(job.name);
+        if (cached != cache.end() && cached->second == hash &&
+            fs::exists(output)) {
+            skipped++;
+            continue;
+        }
+
+        if (compress_texture(job, output, ktx2, astc)) {
+            cache[job.name] = hash;
+            compressed++;
+        } else {
+            cache.erase(job.name);
+            failed++;
+        }
+    }
+    save_cache(cache_path, cache);
+
+    fprintf(stderr, "%u compressed, %u unchanged, %u failed\n", compressed,
+            skipped, failed);
+    return failed ? 1 : 0;
+}